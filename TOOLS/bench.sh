@@ -0,0 +1,43 @@
+#!/bin/sh
+
+: "${MPV:=mpv}"
+: "${BENCH_DURATION:=10}"
+: "${BENCH_SIZE:=1920x1080}"
+: "${BENCH_RATE:=60}"
+: "${BENCH_MPVFLAGS:=}"
+: "${BENCH_LABEL:=}"
+
+# Run the player core headless on synthetic lavfi sources and print one JSON
+# report per test case (see TOOLS/lua/bench.lua for the fields). Compare the
+# output between builds to spot performance regressions.
+#
+# usage: bench.sh [outdir]
+# With outdir, each report is written to outdir/<case>.json instead of stdout.
+#
+# Cases:
+#   decode      video and audio as fast as possible (--untimed, no sync)
+#   playback    realtime playback with audio sync, on the null outputs
+#   filters     like decode, with a filter chain inserted
+
+BENCH_DIR=$(dirname "$0")
+OUTDIR=$1
+
+SRC="av://lavfi:testsrc2=size=$BENCH_SIZE:rate=$BENCH_RATE:duration=$BENCH_DURATION[out0];sine=frequency=440:sample_rate=48000:duration=$BENCH_DURATION[out1]"
+
+run()
+{
+    name=$1
+    shift
+    opts="bench-label=${BENCH_LABEL:+$BENCH_LABEL }$name"
+    [ -n "$OUTDIR" ] && opts="$opts:bench-output=$OUTDIR/$name.json"
+    $MPV "$SRC" --no-config --really-quiet --vo=null --ao=null \
+        --lua="$BENCH_DIR/lua/bench.lua" \
+        --lua-opts="$opts" \
+        $BENCH_MPVFLAGS "$@" || exit $?
+}
+
+[ -n "$OUTDIR" ] && mkdir -p "$OUTDIR"
+
+run decode --untimed --no-audio
+run playback
+run filters --untimed --no-audio --vf=scale=1280:720,format=yuv420p
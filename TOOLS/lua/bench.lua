@@ -0,0 +1,151 @@
+-- Collect playback performance statistics and write them as JSON when the
+-- player exits. Meant to be driven by TOOLS/bench.sh, but it can be used
+-- with any file:
+--
+--   mpv --vo=null --ao=null --untimed --lua=TOOLS/lua/bench.lua file.mkv
+--
+-- Unlike most scripts here, it's not suitable for the lua script directory,
+-- since it writes a report on every exit.
+--
+-- Options (--lua-opts=bench-<name>=<value>):
+--   output    file to write the report to (default: stdout)
+--   label     arbitrary string copied into the report, e.g. a version
+--   interval  sampling interval in seconds (default: 1)
+--
+-- The report contains:
+--   wall_time           seconds from the first to the last sample
+--   frames              estimated-frame-number delta (video frames played)
+--   fps                 frames / wall_time
+--   vf_fps              last estimated-vf-fps (filter chain output rate)
+--   decoder_drops       drop-frame-count
+--   vo_drops            vo-drop-frame-count
+--   vo_missed_vsyncs    vo-missed-vsync-count
+--   avsync_mean_abs     mean of abs(avsync) over all samples
+--   avsync_max_abs      maximum of abs(avsync) over all samples
+--   cpu_per_sec         process CPU seconds per wall clock second (can be
+--                       above 1 with several busy threads)
+--   gpu_passes          per render pass GPU time in microseconds, from
+--                       vo-pass-timings: the last reported average, and the
+--                       maximum of the reported peaks (only with --vo=opengl
+--                       and timer query support)
+
+local msg = require 'mp.msg'
+require 'mp.options'
+
+local options = {
+    output = "",
+    label = "",
+    interval = 1,
+}
+read_options(options, "bench")
+
+local start_time, start_cpu, start_frame
+local last_time, last_cpu, last_frame = 0, 0, 0
+local avsync_sum, avsync_max, avsync_samples = 0, 0, 0
+-- Counters are sampled while the file is loaded; they're gone at shutdown.
+local counters = {}
+local passes, pass_order = {}, {}
+
+local function update_counter(name)
+    counters[name] = mp.get_property_number(name, counters[name] or 0)
+end
+
+local function sample()
+    local frame = mp.get_property_number("estimated-frame-number")
+    if frame == nil then
+        return
+    end
+    local now, cpu = mp.get_time(), os.clock()
+    if start_time == nil then
+        start_time, start_cpu, start_frame = now, cpu, frame
+    end
+    last_time, last_cpu, last_frame = now, cpu, frame
+    for _, name in ipairs({"estimated-vf-fps", "drop-frame-count",
+                           "vo-drop-frame-count", "vo-missed-vsync-count"}) do
+        update_counter(name)
+    end
+
+    for _, t in ipairs(mp.get_property_native("vo-pass-timings") or {}) do
+        local p = passes[t.name]
+        if p == nil then
+            p = {avg = 0, peak = 0}
+            passes[t.name] = p
+            pass_order[#pass_order + 1] = t.name
+        end
+        p.avg = t.avg
+        p.peak = math.max(p.peak, t.peak)
+    end
+
+    local avsync = mp.get_property_number("avsync")
+    if avsync ~= nil then
+        avsync = math.abs(avsync)
+        avsync_sum = avsync_sum + avsync
+        avsync_max = math.max(avsync_max, avsync)
+        avsync_samples = avsync_samples + 1
+    end
+end
+
+local function json_string(s)
+    return '"' .. s:gsub('[%c"\\]', function(c)
+        return string.format("\\u%04x", c:byte())
+    end) .. '"'
+end
+
+local function write_report()
+    local wall = start_time and last_time - start_time or 0
+    local frames = start_frame and last_frame - start_frame or 0
+    local fields = {
+        {"label", json_string(options.label)},
+        {"wall_time", wall},
+        {"frames", frames},
+        {"fps", wall > 0 and frames / wall or 0},
+        {"vf_fps", counters["estimated-vf-fps"] or 0},
+        {"decoder_drops", counters["drop-frame-count"] or 0},
+        {"vo_drops", counters["vo-drop-frame-count"] or 0},
+        {"vo_missed_vsyncs", counters["vo-missed-vsync-count"] or 0},
+        {"avsync_mean_abs",
+         avsync_samples > 0 and avsync_sum / avsync_samples or 0},
+        {"avsync_max_abs", avsync_max},
+        {"cpu_per_sec", wall > 0 and (last_cpu - start_cpu) / wall or 0},
+    }
+    if #pass_order > 0 then
+        local list = {}
+        for _, name in ipairs(pass_order) do
+            local p = passes[name]
+            list[#list + 1] = string.format(
+                '%s: {"avg_us": %d, "peak_us": %d}', json_string(name),
+                p.avg, p.peak)
+        end
+        fields[#fields + 1] = {"gpu_passes",
+                               "{" .. table.concat(list, ", ") .. "}"}
+    end
+    local items = {}
+    for _, f in ipairs(fields) do
+        local v = f[2]
+        if type(v) == "number" then
+            v = string.format("%.6g", v)
+        end
+        items[#items + 1] = string.format('  "%s": %s', f[1], v)
+    end
+    local json = "{\n" .. table.concat(items, ",\n") .. "\n}\n"
+
+    local out = io.stdout
+    if options.output ~= "" then
+        local err
+        out, err = io.open(options.output, "w")
+        if not out then
+            msg.error("Could not open " .. options.output .. ": " .. err)
+            return
+        end
+    end
+    out:write(json)
+    if out ~= io.stdout then
+        out:close()
+    end
+end
+
+mp.add_periodic_timer(options.interval, sample)
+-- Take a last sample before the file is unloaded, so short runs and the tail
+-- of the file are accounted for.
+mp.register_event("end-file", sample)
+mp.register_event("shutdown", write_report)
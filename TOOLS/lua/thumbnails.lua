@@ -0,0 +1,67 @@
+-- This script writes evenly spaced thumbnails of a file with a single player
+-- instance, instead of starting mpv once per thumbnail. It seeks to each
+-- position with a keyframe seek, writes a screenshot, and quits when done.
+--
+-- Example:
+--
+--   mpv --lua=thumbnails.lua --no-audio --vo=null --vf=screenshot \
+--       --vd-lavc-skipframe=nonkey --screenshot-max-size=320 \
+--       --lua-opts=thumbnails.count=100 file.mkv
+--
+-- Options (passed with --lua-opts):
+--   thumbnails.count=<n>       number of thumbnails (default: 10)
+--   thumbnails.template=<fmt>  output file name, a string.format() pattern
+--                              taking the thumbnail number (default:
+--                              thumb-%03d.jpg)
+--
+-- The files are written in the background (see --screenshot-threads). The
+-- player waits for all of them to finish when quitting.
+require "mp.msg"
+
+script_name = mp.get_script_name()
+
+function get_opt(name, def)
+    return mp.get_opt(string.format("%s.%s", script_name, name)) or def
+end
+
+count = tonumber(get_opt("count", 10))
+template = get_opt("template", "thumb-%03d.jpg")
+
+positions = {}
+current = 0
+
+function seek_next()
+    current = current + 1
+    if current > #positions then
+        mp.command("quit")
+        return
+    end
+    mp.commandv("seek", positions[current], "absolute", "keyframes")
+end
+
+function on_playback_restart()
+    if current == 0 then
+        return
+    end
+    mp.commandv("screenshot_to_file", string.format(template, current), "video")
+    seek_next()
+end
+
+function on_file_loaded()
+    local length = mp.get_property_number("length")
+    if not length or length <= 0 then
+        mp.msg.error("File has no known duration.")
+        mp.command("quit")
+        return
+    end
+    positions = {}
+    for i = 1, count do
+        positions[i] = length * (i - 0.5) / count
+    end
+    current = 0
+    mp.set_property("pause", "yes")
+    seek_next()
+end
+
+mp.register_event("file-loaded", on_file_loaded)
+mp.register_event("playback-restart", on_playback_restart)
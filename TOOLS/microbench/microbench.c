@@ -0,0 +1,590 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmarks for single internal functions, run on synthetic data. This
+// complements TOOLS/bench.sh, which measures playback as a whole.
+//
+// Build with "./waf configure --enable-microbench", then run:
+//
+//   build/mpv-microbench [-t seconds] [-j] [-l] [kernel...]
+//
+//   -t   minimum run time per kernel (default: 1)
+//   -j   print one JSON object per kernel instead of a table
+//   -l   list the kernels and exit
+//
+// Without kernel names, all kernels are run. Each kernel is set up once, run
+// once to warm up, and then run repeatedly until the minimum time is reached.
+// The reported throughput counts the units given in the kernel list.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "osdep/timer.h"
+#include "misc/bstr.h"
+#include "misc/ring.h"
+#include "options/m_property.h"
+#include "stream/stream.h"
+#include "demux/demux.h"
+#include "demux/stheader.h"
+#include "demux/packet.h"
+#include "sub/osd.h"
+#include "sub/draw_bmp.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+#include "video/mp_image_pool.h"
+#include "video/out/bitmap_packer.h"
+#include "audio/audio.h"
+#include "audio/format.h"
+#include "audio/filter/af.h"
+#include "player/core.h"
+
+struct kernel {
+    const char *name;
+    const char *unit;
+    // Allocate the state (as talloc child of ta_ctx); NULL on failure.
+    void *(*init)(void *ta_ctx, struct mpv_global *global);
+    // Run the kernel once, and return the number of units processed.
+    int64_t (*run)(void *state);
+    // Optional; the state is freed with talloc_free() after this.
+    void (*uninit)(void *state);
+};
+
+// Deterministic pseudo random numbers, so that runs are comparable.
+static uint32_t rnd(uint32_t *state)
+{
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 8;
+}
+
+/* demux_mkv: SimpleBlock parsing from a memory stream */
+
+#define MKV_BLOCKS 20000
+#define MKV_BLOCK_SIZE 192
+#define MKV_BLOCKS_PER_CLUSTER 250
+
+static void ebml_id(bstr *b, uint32_t id)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if ((id >> shift) || shift == 0)
+            bstr_xappend(NULL, b, (bstr){(unsigned char[]){id >> shift}, 1});
+    }
+}
+
+// Always use 8 byte sizes; UINT64_MAX writes the "unknown size" value.
+static void ebml_size(bstr *b, uint64_t size)
+{
+    unsigned char buf[8] = {0x01};
+    for (int n = 1; n < 8; n++)
+        buf[n] = size == UINT64_MAX ? 0xFF : (size >> ((7 - n) * 8)) & 0xFF;
+    bstr_xappend(NULL, b, (bstr){buf, 8});
+}
+
+static void ebml_elem(bstr *b, uint32_t id, bstr data)
+{
+    ebml_id(b, id);
+    ebml_size(b, data.len);
+    bstr_xappend(NULL, b, data);
+}
+
+static void ebml_uint(bstr *b, uint32_t id, uint64_t val)
+{
+    unsigned char buf[8];
+    for (int n = 0; n < 8; n++)
+        buf[n] = val >> ((7 - n) * 8);
+    ebml_elem(b, id, (bstr){buf, 8});
+}
+
+static void ebml_float(bstr *b, uint32_t id, double val)
+{
+    union { double d; uint64_t i; } u = {val};
+    ebml_uint(b, id, u.i);
+}
+
+// A PCM audio file with MKV_BLOCKS SimpleBlocks.
+static bstr make_mkv(void)
+{
+    bstr file = {0}, elem = {0}, sub = {0};
+
+    ebml_uint(&elem, 0x4286, 1);                    // EBMLVersion
+    ebml_elem(&elem, 0x4282, bstr0("matroska"));    // DocType
+    ebml_uint(&elem, 0x4287, 2);                    // DocTypeVersion
+    ebml_uint(&elem, 0x4285, 2);                    // DocTypeReadVersion
+    ebml_elem(&file, 0x1A45DFA3, elem);             // EBML
+    elem.len = 0;
+
+    ebml_id(&file, 0x18538067);                     // Segment
+    ebml_size(&file, UINT64_MAX);
+
+    ebml_uint(&elem, 0x2AD7B1, 1000000);            // TimecodeScale
+    ebml_elem(&file, 0x1549A966, elem);             // Info
+    elem.len = 0;
+
+    ebml_float(&sub, 0xB5, 48000);                  // SamplingFrequency
+    ebml_uint(&sub, 0x9F, 2);                       // Channels
+    ebml_uint(&sub, 0x6264, 16);                    // BitDepth
+    bstr track = {0};
+    ebml_uint(&track, 0xD7, 1);                     // TrackNumber
+    ebml_uint(&track, 0x73C5, 1);                   // TrackUID
+    ebml_uint(&track, 0x83, 2);                     // TrackType (audio)
+    ebml_elem(&track, 0x86, bstr0("A_PCM/INT/LIT")); // CodecID
+    ebml_elem(&track, 0xE1, sub);                   // Audio
+    ebml_elem(&elem, 0xAE, track);                  // TrackEntry
+    ebml_elem(&file, 0x1654AE6B, elem);             // Tracks
+    elem.len = 0;
+
+    // 48 samples of 16 bit stereo = 1 ms per block
+    unsigned char block[4 + MKV_BLOCK_SIZE] = {0x81};
+    for (int n = 0; n < MKV_BLOCKS; n += MKV_BLOCKS_PER_CLUSTER) {
+        ebml_uint(&elem, 0xE7, n);                  // Timecode
+        for (int i = 0; i < MKV_BLOCKS_PER_CLUSTER; i++) {
+            block[1] = i >> 8;                      // relative timecode
+            block[2] = i & 0xFF;
+            block[3] = 0x80;                        // keyframe
+            memset(block + 4, i, MKV_BLOCK_SIZE);
+            ebml_elem(&elem, 0xA3, (bstr){block, sizeof(block)}); // SimpleBlock
+        }
+        ebml_elem(&file, 0x1F43B675, elem);         // Cluster
+        elem.len = 0;
+    }
+
+    talloc_free(elem.start);
+    talloc_free(sub.start);
+    talloc_free(track.start);
+    return file;
+}
+
+struct mkv_state {
+    struct mpv_global *global;
+    bstr file;
+};
+
+static void *mkv_init(void *ta_ctx, struct mpv_global *global)
+{
+    struct mkv_state *s = talloc_zero(ta_ctx, struct mkv_state);
+    s->global = global;
+    s->file = make_mkv();
+    talloc_steal(s, s->file.start);
+    return s;
+}
+
+static int64_t mkv_run(void *state)
+{
+    struct mkv_state *s = state;
+    struct stream *stream = stream_open("memory://", s->global);
+    if (!stream)
+        return 0;
+    stream_control(stream, STREAM_CTRL_SET_CONTENTS, &s->file);
+    struct demuxer *demuxer = demux_open(stream, "mkv", NULL, s->global);
+    int64_t bytes = 0;
+    if (demuxer && demuxer->num_streams) {
+        struct sh_stream *sh = demuxer->streams[0];
+        demuxer_select_track(demuxer, sh, true);
+        struct demux_packet *pkt;
+        while ((pkt = demux_read_packet(sh))) {
+            bytes += pkt->len;
+            talloc_free(pkt);
+        }
+    }
+    free_demuxer(demuxer);
+    free_stream(stream);
+    return bytes;
+}
+
+/* draw_bmp: blending libass glyph bitmaps onto a 1080p yuv420p frame */
+
+#define BMP_PARTS 60
+
+struct bmp_state {
+    struct mp_image *img;
+    struct sub_bitmaps sbs;
+    struct mp_draw_sub_cache *cache;
+    int64_t pixels;
+};
+
+static void *bmp_init(void *ta_ctx, struct mpv_global *global)
+{
+    struct bmp_state *s = talloc_zero(ta_ctx, struct bmp_state);
+    s->img = talloc_steal(s, mp_image_alloc(IMGFMT_420P, 1920, 1080));
+    if (!s->img)
+        return NULL;
+    mp_image_clear(s->img, 0, 0, s->img->w, s->img->h);
+
+    uint32_t r = 1;
+    s->sbs.format = SUBBITMAP_LIBASS;
+    s->sbs.parts = talloc_zero_array(s, struct sub_bitmap, BMP_PARTS);
+    s->sbs.num_parts = BMP_PARTS;
+    for (int n = 0; n < BMP_PARTS; n++) {
+        struct sub_bitmap *p = &s->sbs.parts[n];
+        p->w = p->dw = 40 + rnd(&r) % 160;
+        p->h = p->dh = 30 + rnd(&r) % 40;
+        p->x = rnd(&r) % (1920 - p->w);
+        p->y = 800 + rnd(&r) % (1080 - 800 - p->h);
+        p->stride = p->w;
+        p->libass.color = n % 2 ? 0xFFFFFF00 : 0x00000080;
+        uint8_t *a = talloc_size(s, p->w * p->h);
+        for (int i = 0; i < p->w * p->h; i++)
+            a[i] = rnd(&r) % 3 ? 255 : rnd(&r);
+        p->bitmap = a;
+        s->pixels += p->w * p->h;
+    }
+    return s;
+}
+
+static int64_t bmp_run(void *state)
+{
+    struct bmp_state *s = state;
+    s->sbs.bitmap_id++;
+    s->sbs.bitmap_pos_id++;
+    mp_draw_sub_bitmaps(&s->cache, s->img, &s->sbs);
+    return s->pixels;
+}
+
+static void bmp_uninit(void *state)
+{
+    struct bmp_state *s = state;
+    talloc_free(s->cache);
+}
+
+/* af_scaletempo and af_lavrresample: filtering 48 kHz stereo float */
+
+#define AF_SAMPLES 4096
+
+struct af_state {
+    struct af_stream *afs;
+    struct mp_audio src;
+};
+
+static struct af_state *af_setup(void *ta_ctx, struct mpv_global *global,
+                                 int out_rate, char *filter, char **args)
+{
+    struct af_state *s = talloc_zero(ta_ctx, struct af_state);
+    s->afs = af_new(global);
+    mp_audio_set_format(&s->afs->input, AF_FORMAT_FLOAT);
+    mp_audio_set_num_channels(&s->afs->input, 2);
+    s->afs->input.rate = 48000;
+    mp_audio_copy_config(&s->afs->output, &s->afs->input);
+    s->afs->output.rate = out_rate;
+    if (af_init(s->afs) < 0 || (filter && !af_add(s->afs, filter, args))) {
+        af_destroy(s->afs);
+        return NULL;
+    }
+
+    mp_audio_copy_config(&s->src, &s->afs->input);
+    s->src.samples = AF_SAMPLES;
+    float *data = talloc_array(s, float, AF_SAMPLES * 2);
+    for (int n = 0; n < AF_SAMPLES; n++)
+        data[n * 2] = data[n * 2 + 1] = sin(n * 2 * M_PI * 440 / 48000) * 0.5;
+    s->src.planes[0] = data;
+    return s;
+}
+
+static int64_t af_run(void *state)
+{
+    struct af_state *s = state;
+    // Filters may modify the input in place; the content doesn't matter.
+    struct mp_audio data = s->src;
+    if (af_filter(s->afs, &data, 0) < 0)
+        return 0;
+    return AF_SAMPLES;
+}
+
+static void af_uninit_state(void *state)
+{
+    struct af_state *s = state;
+    af_destroy(s->afs);
+}
+
+static void *scaletempo_init(void *ta_ctx, struct mpv_global *global)
+{
+    char *args[] = {"scale", "1.25", NULL};
+    return af_setup(ta_ctx, global, 48000, "scaletempo", args);
+}
+
+static void *resample_init(void *ta_ctx, struct mpv_global *global)
+{
+    // The chain inserts lavrresample for the rate conversion.
+    return af_setup(ta_ctx, global, 44100, NULL, NULL);
+}
+
+/* bitmap_packer: packing glyph-sized rectangles from scratch */
+
+#define PACKER_RECTS 1000
+
+struct packer_state {
+    struct bitmap_packer *packer;
+    struct pos *sizes;
+};
+
+static void *packer_init(void *ta_ctx, struct mpv_global *global)
+{
+    struct packer_state *s = talloc_zero(ta_ctx, struct packer_state);
+    s->packer = talloc_zero(s, struct bitmap_packer);
+    s->sizes = talloc_array(s, struct pos, PACKER_RECTS);
+    uint32_t r = 2;
+    for (int n = 0; n < PACKER_RECTS; n++)
+        s->sizes[n] = (struct pos){4 + rnd(&r) % 60, 8 + rnd(&r) % 40};
+    return s;
+}
+
+static int64_t packer_run(void *state)
+{
+    struct packer_state *s = state;
+    struct bitmap_packer *packer = s->packer;
+    packer_reset(packer);
+    packer->w_max = packer->h_max = 8192;
+    packer->padding = 1;
+    packer_set_size(packer, PACKER_RECTS);
+    memcpy(packer->in, s->sizes, PACKER_RECTS * sizeof(s->sizes[0]));
+    if (packer_pack(packer) < 0)
+        return 0;
+    return PACKER_RECTS;
+}
+
+/* m_property: looking up and reading properties by name */
+
+#define NUM_PROPS 256
+
+static int prop_get(void *ctx, struct m_property *prop, int action, void *arg)
+{
+    return m_property_int_ro(action, arg, (intptr_t)prop->priv);
+}
+
+struct prop_state {
+    struct m_property *list;
+    struct m_property_index *index;
+    char **names;
+};
+
+static void *prop_init(void *ta_ctx, struct mpv_global *global)
+{
+    struct prop_state *s = talloc_zero(ta_ctx, struct prop_state);
+    s->list = talloc_zero_array(s, struct m_property, NUM_PROPS + 1);
+    s->names = talloc_array(s, char *, NUM_PROPS);
+    for (int n = 0; n < NUM_PROPS; n++) {
+        // Names similar to the real ones, sharing prefixes.
+        static const char *const prefixes[] = {"video-", "audio-", "sub-",
+                                               "playback-", "demuxer-"};
+        s->names[n] = talloc_asprintf(s, "%sprop-%d", prefixes[n % 5], n);
+        s->list[n] = (struct m_property){s->names[n], prop_get,
+                                         (void *)(intptr_t)n};
+    }
+    s->index = m_property_index_new(s, s->list);
+    return s;
+}
+
+static int64_t prop_run(void *state)
+{
+    struct prop_state *s = state;
+    int64_t sum = 0;
+    for (int n = 0; n < NUM_PROPS; n++) {
+        int val = 0;
+        m_property_do(NULL, s->index, s->names[(n * 7) % NUM_PROPS],
+                      M_PROPERTY_GET, &val, NULL);
+        sum += val;
+    }
+    return sum >= 0 ? NUM_PROPS : 0;
+}
+
+/* mp_image_pool: getting and releasing 1080p frames */
+
+#define POOL_IMAGES 6
+
+static void *pool_init(void *ta_ctx, struct mpv_global *global)
+{
+    struct mp_image_pool *pool = mp_image_pool_new(POOL_IMAGES);
+    talloc_steal(ta_ctx, pool);
+    return pool;
+}
+
+static int64_t pool_run(void *state)
+{
+    struct mp_image *imgs[POOL_IMAGES];
+    for (int n = 0; n < POOL_IMAGES; n++)
+        imgs[n] = mp_image_pool_get(state, IMGFMT_420P, 1920, 1080);
+    for (int n = 0; n < POOL_IMAGES; n++)
+        talloc_free(imgs[n]);
+    return POOL_IMAGES;
+}
+
+/* ta: allocating and freeing a tree of small allocations */
+
+#define TA_ALLOCS 10000
+
+static void *ta_init(void *ta_ctx, struct mpv_global *global)
+{
+    return talloc_new(ta_ctx);
+}
+
+static int64_t ta_run(void *state)
+{
+    void *root = talloc_new(state);
+    void *parent = root;
+    uint32_t r = 3;
+    for (int n = 0; n < TA_ALLOCS; n++) {
+        void *p = talloc_size(parent, 8 + rnd(&r) % 120);
+        // Some nesting, as with real object trees.
+        if (n % 16 == 0)
+            parent = p;
+        if (n % 256 == 0)
+            parent = root;
+    }
+    talloc_free(root);
+    return TA_ALLOCS;
+}
+
+/* misc/ring.c: writing and reading through a ring buffer */
+
+#define RING_SIZE (64 * 1024)
+#define RING_CHUNK 3000
+#define RING_BYTES (16 * 1024 * 1024)
+
+struct ring_state {
+    struct mp_ring *ring;
+    unsigned char buf[RING_CHUNK];
+};
+
+static void *ring_init(void *ta_ctx, struct mpv_global *global)
+{
+    struct ring_state *s = talloc_zero(ta_ctx, struct ring_state);
+    s->ring = mp_ring_new(s, RING_SIZE);
+    return s;
+}
+
+static int64_t ring_run(void *state)
+{
+    struct ring_state *s = state;
+    int64_t bytes = 0;
+    while (bytes < RING_BYTES) {
+        // Keep the ring partially filled, so that the positions wrap around.
+        while (mp_ring_available(s->ring) >= RING_CHUNK)
+            mp_ring_write(s->ring, s->buf, RING_CHUNK);
+        bytes += mp_ring_read(s->ring, s->buf, RING_CHUNK * 2);
+    }
+    return bytes;
+}
+
+static const struct kernel kernels[] = {
+    {"demux_mkv",       "bytes",    mkv_init,           mkv_run},
+    {"draw_bmp",        "pixels",   bmp_init,           bmp_run, bmp_uninit},
+    {"af_scaletempo",   "samples",  scaletempo_init,    af_run, af_uninit_state},
+    {"af_lavrresample", "samples",  resample_init,      af_run, af_uninit_state},
+    {"bitmap_packer",   "rects",    packer_init,        packer_run},
+    {"m_property",      "lookups",  prop_init,          prop_run},
+    {"mp_image_pool",   "images",   pool_init,          pool_run},
+    {"ta",              "allocs",   ta_init,            ta_run},
+    {"ring",            "bytes",    ring_init,          ring_run},
+    {0}
+};
+
+static void run_kernel(const struct kernel *k, struct mpv_global *global,
+                       double min_time, bool json)
+{
+    void *ta_ctx = talloc_new(NULL);
+    void *state = k->init(ta_ctx, global);
+    if (!state) {
+        fprintf(stderr, "%s: setup failed\n", k->name);
+        talloc_free(ta_ctx);
+        return;
+    }
+
+    k->run(state); // warm up caches and lazily allocated state
+
+    int64_t runs = 0, units = 0;
+    int64_t start = mp_time_us(), now = start;
+    do {
+        units += k->run(state);
+        runs++;
+        now = mp_time_us();
+    } while (now - start < min_time * 1e6);
+
+    double secs = (now - start) / 1e6;
+    if (json) {
+        printf("{\"kernel\": \"%s\", \"runs\": %"PRId64", \"seconds\": %f, "
+               "\"unit\": \"%s\", \"per_second\": %f, \"us_per_run\": %f}\n",
+               k->name, runs, secs, k->unit, units / secs, secs * 1e6 / runs);
+    } else {
+        printf("%-16s %10"PRId64" runs %12.2f us/run %14.4g %s/s\n",
+               k->name, runs, secs * 1e6 / runs, units / secs, k->unit);
+    }
+    fflush(stdout);
+
+    if (k->uninit)
+        k->uninit(state);
+    talloc_free(ta_ctx);
+}
+
+int main(int argc, char *argv[])
+{
+    double min_time = 1;
+    bool json = false;
+    char **names = NULL;
+    int num_names = 0;
+
+    for (int n = 1; n < argc; n++) {
+        if (strcmp(argv[n], "-t") == 0 && n + 1 < argc) {
+            min_time = atof(argv[++n]);
+        } else if (strcmp(argv[n], "-j") == 0) {
+            json = true;
+        } else if (strcmp(argv[n], "-l") == 0) {
+            for (int i = 0; kernels[i].name; i++)
+                printf("%-16s (%s)\n", kernels[i].name, kernels[i].unit);
+            return 0;
+        } else if (argv[n][0] == '-') {
+            fprintf(stderr, "usage: %s [-t seconds] [-j] [-l] [kernel...]\n",
+                    argv[0]);
+            return 2;
+        } else {
+            MP_TARRAY_APPEND(NULL, names, num_names, argv[n]);
+        }
+    }
+
+    // Provides the global state (options, logging, libav init) the
+    // demuxers and filters expect.
+    struct MPContext *mpctx = mp_create();
+
+    int ret = 0;
+    for (int n = 0; n < num_names; n++) {
+        bool found = false;
+        for (int i = 0; kernels[i].name; i++)
+            found |= strcmp(kernels[i].name, names[n]) == 0;
+        if (!found) {
+            fprintf(stderr, "unknown kernel: %s\n", names[n]);
+            ret = 2;
+        }
+    }
+
+    for (int i = 0; kernels[i].name && !ret; i++) {
+        bool selected = !num_names;
+        for (int n = 0; n < num_names; n++)
+            selected |= strcmp(kernels[i].name, names[n]) == 0;
+        if (selected)
+            run_kernel(&kernels[i], mpctx->global, min_time, json);
+    }
+
+    talloc_free(names);
+    mp_destroy(mpctx);
+    return ret;
+}
@@ -1,31 +1,85 @@
 #!/usr/bin/env python3
-import matplotlib.pyplot as plot
+import struct
 import sys
-
-filename = sys.argv[1]
+import json
 
 """
 This script is meant to display stats written by mpv --dump-stats=filename.
-In general, each line in that file is an event of the form:
-
-    <timestamp in microseconds> <text> '#' <comment>
 
-e.g.:
+    stats-conv.py <file>                 show the events as graph
+    stats-conv.py <file> --chrome <out>  convert to Chrome trace event JSON,
+                                         which can be loaded with
+                                         chrome://tracing or Perfetto
 
-    10474959 start flip #cplayer
+The file is binary, with all integers little endian. It starts with the 8
+bytes "mpvstats" and a 32 bit version (currently 1). This is followed by
+entries, each starting with a 1 byte tag:
 
-<text> is what MP_STATS(log, "...") writes. The rest is added by msg.c.
+    1 (name)    u32 id, u32 length, <length> bytes UTF-8 event name
+    2 (thread)  u32 thread id (the first event of a thread follows)
+    3 (event)   u8 type, u32 thread id, u32 name id, i64 timestamp in
+                microseconds, f64 value
 
-Currently, the following event types are supported:
+Event types:
 
-    'start' <name>              start of the named event
-    'end' <name>                end of the named event
-    'value' <float> <name>      a normal value (as opposed to event)
-    'event-timed' <ts> <name>   singular event at the given timestamp
-    <name>                      singular event
+    1 (start)   start of the named event
+    2 (end)     end of the named event
+    3 (value)   named value (e.g. "phase", or "dropped" if events were lost
+                because a thread's buffer was full)
+    4 (event)   singular event
 
+A name entry always precedes the first event using it.
 """
 
+T_START, T_END, T_VALUE, T_EVENT = 1, 2, 3, 4
+
+def read_events(filename):
+    data = open(filename, "rb").read()
+    if data[0:8] != b"mpvstats":
+        sys.exit("not a mpv stats file")
+    version, = struct.unpack_from("<I", data, 8)
+    if version != 1:
+        sys.exit("unsupported version %d" % version)
+    pos = 12
+    names = {}
+    events = []
+    while pos < len(data):
+        tag = data[pos]
+        pos += 1
+        if tag == 1:
+            id, length = struct.unpack_from("<II", data, pos)
+            pos += 8
+            names[id] = data[pos:pos + length].decode("utf-8", "replace")
+            pos += length
+        elif tag == 2:
+            pos += 4
+        elif tag == 3:
+            t, tid, id, ts, val = struct.unpack_from("<BIIqd", data, pos)
+            pos += 25
+            events.append((ts, t, tid, names[id], val))
+        else:
+            sys.exit("invalid tag %d at %d" % (tag, pos - 1))
+    events.sort(key=lambda e: e[0])
+    return events
+
+def write_chrome(events, out):
+    trace = []
+    for ts, t, tid, name, val in events:
+        e = {"name": name, "pid": 1, "tid": tid, "ts": ts}
+        if t == T_START:
+            e["ph"] = "B"
+        elif t == T_END:
+            e["ph"] = "E"
+        elif t == T_VALUE:
+            e["ph"] = "C"
+            e["args"] = {name: val}
+        else:
+            e["ph"] = "i"
+            e["s"] = "t"
+        trace.append(e)
+    json.dump({"traceEvents": trace, "displayTimeUnit": "ms"},
+              open(out, "w"))
+
 class G:
     events = {}
     sevents = []  # events, deterministically sorted
@@ -58,52 +112,50 @@ def get_event(event, evtype):
             e.marker = find_marker()
     return G.events[event]
 
-for line in [line.split("#")[0].strip() for line in open(filename, "r")]:
-    line = line.strip()
-    if not line:
-        continue
-    ts, event = line.split(" ", 1)
-    ts = int(ts) / 1000 # milliseconds
-    if G.start is None:
-        G.start = ts
-    ts = ts - G.start
-    if event.startswith("start "):
-        e = get_event(event[6:], "event")
-        e.vals.append((ts, 0))
-        e.vals.append((ts, 1))
-    elif event.startswith("end "):
-        e = get_event(event[4:], "event")
-        e.vals.append((ts, 1))
-        e.vals.append((ts, 0))
-    elif event.startswith("value "):
-        _, val, name = event.split(" ", 2)
-        val = float(val)
-        e = get_event(name, "value")
-        e.vals.append((ts, val))
-    elif event.startswith("event-timed "):
-        _, val, name = event.split(" ", 2)
-        val = int(val) / 1000 - G.start
-        e = get_event(name, "event-signal")
-        e.vals.append((val, 1))
-    else:
-        e = get_event(event, "event-signal")
-        e.vals.append((ts, 1))
-
-for e in G.sevents:
-    e.vals = [(x, y * e.numid / len(G.events)) for (x, y) in e.vals]
-
-plot.hold(True)
-mainpl = plot.subplot(2, 1, 1)
-legend = []
-for e in G.sevents:
-    if e.type == "value":
-        plot.subplot(2, 1, 2, sharex=mainpl)
-    else:
-        plot.subplot(2, 1, 1)
-    pl, = plot.plot([x for x,y in e.vals], [y for x,y in e.vals], label=e.name)
-    if e.type == "event-signal":
-        plot.setp(pl, marker = e.marker, linestyle = "None")
-    legend.append(pl)
-plot.subplot(2, 1, 1)
-plot.legend(legend, [pl.get_label() for pl in legend])
-plot.show()
+def show_graph(events):
+    import matplotlib.pyplot as plot
+
+    for ts, t, tid, name, val in events:
+        ts = ts / 1000 # milliseconds
+        if G.start is None:
+            G.start = ts
+        ts = ts - G.start
+        if t == T_START:
+            e = get_event(name, "event")
+            e.vals.append((ts, 0))
+            e.vals.append((ts, 1))
+        elif t == T_END:
+            e = get_event(name, "event")
+            e.vals.append((ts, 1))
+            e.vals.append((ts, 0))
+        elif t == T_VALUE:
+            e = get_event(name, "value")
+            e.vals.append((ts, val))
+        else:
+            e = get_event(name, "event-signal")
+            e.vals.append((ts, 1))
+
+    for e in G.sevents:
+        e.vals = [(x, y * e.numid / len(G.events)) for (x, y) in e.vals]
+
+    mainpl = plot.subplot(2, 1, 1)
+    legend = []
+    for e in G.sevents:
+        if e.type == "value":
+            plot.subplot(2, 1, 2, sharex=mainpl)
+        else:
+            plot.subplot(2, 1, 1)
+        pl, = plot.plot([x for x,y in e.vals], [y for x,y in e.vals],
+                        label=e.name)
+        if e.type == "event-signal":
+            plot.setp(pl, marker = e.marker, linestyle = "None")
+        legend.append(pl)
+    plot.subplot(2, 1, 1)
+    plot.legend(legend, [pl.get_label() for pl in legend])
+    plot.show()
+
+events = read_events(sys.argv[1])
+if len(sys.argv) == 4 and sys.argv[2] == "--chrome":
+    write_chrome(events, sys.argv[3])
+else:
+    show_graph(events)
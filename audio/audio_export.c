@@ -0,0 +1,173 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Reader side of the af_export ring buffer (see libmpv/audio_export.h).
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+
+#if HAVE_SYS_MMAN_H
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "talloc.h"
+#include "osdep/io.h"
+
+#include "audio_export.h"
+
+struct mpv_audio_export {
+    uint8_t *map;
+    size_t map_size;
+    mpv_audio_export_header *hdr;
+    mpv_audio_export_header info;   // copy of the constant fields
+    int frame_size;
+    uint64_t read_pos;
+    uint64_t overruns;
+};
+
+#if HAVE_SYS_MMAN_H
+
+static void destroy_reader(void *ptr)
+{
+    struct mpv_audio_export *ex = ptr;
+    if (ex->map)
+        munmap(ex->map, ex->map_size);
+}
+
+mpv_audio_export *mpv_audio_export_open(const char *filename)
+{
+    int fd = open(filename, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct mpv_audio_export *ex = talloc_zero(NULL, struct mpv_audio_export);
+    talloc_set_destructor(ex, destroy_reader);
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < sizeof(mpv_audio_export_header))
+        goto error;
+
+    ex->map_size = st.st_size;
+    ex->map = mmap(NULL, ex->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    if (ex->map == MAP_FAILED) {
+        ex->map = NULL;
+        goto error;
+    }
+    close(fd);
+    fd = -1;
+
+    ex->hdr = (mpv_audio_export_header *)ex->map;
+    ex->info = *ex->hdr;
+    mpv_audio_export_header *h = &ex->info;
+
+    // The writer creates the file under a different name, and renames it
+    // when it's fully initialized, so these are never partially written.
+    if (memcmp(h->magic, MPV_AUDIO_EXPORT_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != MPV_AUDIO_EXPORT_VERSION ||
+        h->header_size < sizeof(mpv_audio_export_header))
+        goto error;
+
+    ex->frame_size = mp_audio_export_sample_size(h->format) * h->channels;
+    if (!ex->frame_size || !h->ring_frames ||
+        (h->ring_frames & (h->ring_frames - 1)) ||
+        ex->map_size < h->header_size +
+                       (uint64_t)h->ring_frames * ex->frame_size)
+        goto error;
+
+    ex->read_pos = mp_audio_export_load(&ex->hdr->write_pos);
+    ex->overruns = mp_audio_export_load(&ex->hdr->overruns);
+    mp_audio_export_store(&ex->hdr->read_pos, ex->read_pos);
+
+    return ex;
+
+error:
+    if (fd >= 0)
+        close(fd);
+    talloc_free(ex);
+    return NULL;
+}
+
+int mpv_audio_export_read(mpv_audio_export *ex, void *buf, int max_frames,
+                          uint64_t *dropped)
+{
+    mpv_audio_export_header *h = ex->hdr;
+    // Load closed before write_pos: if it was set, the final write_pos is
+    // visible too, and nothing is lost.
+    bool closed = mp_audio_export_load32(&h->closed) != 0;
+    uint64_t write_pos = mp_audio_export_load(&h->write_pos);
+    uint64_t overruns = mp_audio_export_load(&h->overruns);
+
+    if (dropped)
+        *dropped = overruns - ex->overruns;
+    ex->overruns = overruns;
+
+    uint64_t avail = write_pos - ex->read_pos;
+    if (!avail && closed)
+        return -1;
+
+    int frames = avail < max_frames ? avail : max_frames;
+    uint32_t mask = ex->info.ring_frames - 1;
+    uint8_t *ring = ex->map + ex->info.header_size;
+    uint8_t *dst = buf;
+    int done = 0;
+    while (done < frames) {
+        uint32_t pos = (ex->read_pos + done) & mask;
+        int n = ex->info.ring_frames - pos;
+        if (n > frames - done)
+            n = frames - done;
+        memcpy(dst + done * ex->frame_size, ring + pos * ex->frame_size,
+               n * ex->frame_size);
+        done += n;
+    }
+
+    ex->read_pos += frames;
+    mp_audio_export_store(&h->read_pos, ex->read_pos);
+    return frames;
+}
+
+#else /* HAVE_SYS_MMAN_H */
+
+mpv_audio_export *mpv_audio_export_open(const char *filename)
+{
+    return NULL;
+}
+
+int mpv_audio_export_read(mpv_audio_export *ex, void *buf, int max_frames,
+                          uint64_t *dropped)
+{
+    return -1;
+}
+
+#endif /* else HAVE_SYS_MMAN_H */
+
+const mpv_audio_export_header *mpv_audio_export_get_header(mpv_audio_export *ex)
+{
+    return &ex->info;
+}
+
+void mpv_audio_export_close(mpv_audio_export *ex)
+{
+    talloc_free(ex);
+}
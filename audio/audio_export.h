@@ -0,0 +1,80 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_AUDIO_EXPORT_H_
+#define MP_AUDIO_EXPORT_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+#include "libmpv/audio_export.h"
+
+// The positions in mpv_audio_export_header are shared with other processes,
+// so they are plain integers accessed with the compiler builtins, instead of
+// the (possibly emulated) C11 atomic types.
+
+static inline uint64_t mp_audio_export_load(uint64_t *p)
+{
+#if HAVE_STDATOMIC || HAVE_ATOMIC_BUILTINS
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    return __sync_fetch_and_add(p, 0);
+#endif
+}
+
+static inline void mp_audio_export_store(uint64_t *p, uint64_t v)
+{
+#if HAVE_STDATOMIC || HAVE_ATOMIC_BUILTINS
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#else
+    __sync_synchronize();
+    *(volatile uint64_t *)p = v;
+    __sync_synchronize();
+#endif
+}
+
+static inline uint32_t mp_audio_export_load32(uint32_t *p)
+{
+#if HAVE_STDATOMIC || HAVE_ATOMIC_BUILTINS
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    return __sync_fetch_and_add(p, 0);
+#endif
+}
+
+static inline void mp_audio_export_store32(uint32_t *p, uint32_t v)
+{
+#if HAVE_STDATOMIC || HAVE_ATOMIC_BUILTINS
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#else
+    __sync_synchronize();
+    *(volatile uint32_t *)p = v;
+    __sync_synchronize();
+#endif
+}
+
+static inline int mp_audio_export_sample_size(uint32_t format)
+{
+    switch (format) {
+    case MPV_AUDIO_EXPORT_FORMAT_S16:   return 2;
+    case MPV_AUDIO_EXPORT_FORMAT_FLOAT: return 4;
+    default:                            return 0;
+    }
+}
+
+#endif
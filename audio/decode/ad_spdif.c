@@ -201,7 +201,7 @@ static int decode_packet(struct dec_audio *da)
     AVPacket pkt;
     mp_set_av_packet(&pkt, mpkt, NULL);
     pkt.pts = pkt.dts = 0;
-    MP_VERBOSE(da, "spdif packet, size=%d\n", pkt.size);
+    MP_TRACE(da, "spdif packet, size=%d\n", pkt.size);
     if (mpkt->pts != MP_NOPTS_VALUE) {
         da->pts        = mpkt->pts;
         da->pts_offset = 0;
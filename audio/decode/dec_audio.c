@@ -28,6 +28,7 @@
 #include "config.h"
 #include "common/codecs.h"
 #include "common/msg.h"
+#include "common/stats.h"
 #include "misc/bstr.h"
 
 #include "stream/stream.h"
@@ -242,6 +243,28 @@ static int filter_n_bytes(struct dec_audio *da, struct mp_audio_buffer *outbuf,
 
     assert(len > 0); // would break EOF logic below
 
+    // Fast path: if the current decoded frame alone has enough data, filter it
+    // straight from the decoder's buffer, instead of copying it through
+    // decode_buffer first. (Filters may modify it in place; it's valid until
+    // the next decode_packet() call, and the output is copied to outbuf.)
+    if (mp_audio_buffer_samples(da->decode_buffer) == 0 &&
+        da->decoded.samples >= len)
+    {
+        struct mp_audio config;
+        mp_audio_buffer_get_format(da->decode_buffer, &config);
+        if (mp_audio_config_equals(&da->decoded, &config)) {
+            struct mp_audio filter_data = da->decoded;
+            filter_data.rate = da->afilter->input.rate;
+            filter_data.samples = len;
+            if (af_filter(da->afilter, &filter_data, 0) < 0)
+                return AD_ERR;
+            mp_audio_buffer_append(outbuf, &filter_data);
+            mp_audio_skip_samples(&da->decoded, len);
+            da->pts_offset += len;
+            return 0;
+        }
+    }
+
     while (mp_audio_buffer_samples(da->decode_buffer) < len) {
         // Check for a format change
         struct mp_audio config;
@@ -317,7 +340,7 @@ int audio_decode(struct dec_audio *d_audio, struct mp_audio_buffer *outbuf,
 
     int prev_buffered = -1;
     int res = 0;
-    MP_STATS(d_audio, "start audio");
+    MP_STATS_START(d_audio, "audio");
     while (res >= 0 && minsamples >= 0) {
         int buffered = mp_audio_buffer_samples(outbuf);
         if (minsamples < buffered || buffered == prev_buffered)
@@ -346,7 +369,7 @@ int audio_decode(struct dec_audio *d_audio, struct mp_audio_buffer *outbuf,
 
         res = filter_n_bytes(d_audio, outbuf, decsamples);
     }
-    MP_STATS(d_audio, "end audio");
+    MP_STATS_END(d_audio, "audio");
     return res;
 }
 
@@ -430,6 +430,13 @@ static int af_fix_format_conversion(struct af_stream *s,
     struct mp_audio actual = *prev->data;
     if (actual.format == in.format)
         return AF_FALSE;
+    // Filters like af_volume can fold the conversion into their own pass.
+    if (!af_is_conversion_filter(prev) &&
+        prev->control(prev, AF_CONTROL_SET_OUTPUT_FORMAT, &in.format) == AF_OK)
+    {
+        *p_af = prev;
+        return AF_OK;
+    }
     int dstfmt = in.format;
     char *filter = af_find_conversion_filter(actual.format, &dstfmt);
     if (!filter)
@@ -508,6 +515,8 @@ static int af_fix_rate(struct af_stream *s, struct af_instance **p_af,
 static int af_reinit(struct af_stream *s)
 {
     remove_auto_inserted_filters(s);
+    int no_format = 0;
+    af_control_all(s, AF_CONTROL_SET_OUTPUT_FORMAT, &no_format);
     // Start with the second filter, as the first filter is the special input
     // filter which needs no initialization.
     struct af_instance *af = s->first->next;
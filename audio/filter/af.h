@@ -117,6 +117,12 @@ enum af_control {
     AF_CONTROL_SET_PAN_BALANCE,
     AF_CONTROL_GET_PAN_BALANCE,
     AF_CONTROL_SET_PLAYBACK_SPEED,
+    // Ask a (non-conversion) filter to output the given format (int*)
+    // directly, instead of inserting a conversion filter after it. 0 resets.
+    AF_CONTROL_SET_OUTPUT_FORMAT,
+    // Make audio play faster by the given factor (double*, 1 = nominal) by
+    // adding/dropping resampled output samples, without reconfiguring.
+    AF_CONTROL_SET_SPEED_CORRECTION,
 };
 
 // Argument for AF_CONTROL_SET_PAN_LEVEL
@@ -97,6 +97,31 @@ static int control(struct af_instance* af, int cmd, void* arg)
   return AF_UNKNOWN;
 }
 
+// Independent partial sums, so the loops pipeline and vectorize; a single
+// float accumulator would serialize every addition.
+static float sum_squares_float(const float *data, int len)
+{
+  float acc[8] = {0};
+  int i = 0;
+  for (; i + 8 <= len; i += 8)
+    for (int l = 0; l < 8; l++)
+      acc[l] += data[i + l] * data[i + l];
+  float sum = 0;
+  for (int l = 0; l < 8; l++)
+    sum += acc[l];
+  for (; i < len; i++)
+    sum += data[i] * data[i];
+  return sum;
+}
+
+static float sum_squares_int16(const int16_t *data, int len)
+{
+  int64_t sum = 0;
+  for (int i = 0; i < len; i++)
+    sum += data[i] * data[i];
+  return sum;
+}
+
 static void method1_int16(af_drc_t *s, struct mp_audio *c)
 {
   register int i = 0;
@@ -105,12 +130,7 @@ static void method1_int16(af_drc_t *s, struct mp_audio *c)
   float curavg = 0.0, newavg, neededmul;
   int tmp;
 
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
+  curavg = sqrt(sum_squares_int16(data, len) / (float) len);
 
   // Evaluate an adequate 'mul' coefficient based on previous state, current
   // samples level, etc
@@ -144,14 +164,9 @@ static void method1_float(af_drc_t *s, struct mp_audio *c)
   register int i = 0;
   float *data = (float*)c->planes[0];   // Audio data
   int len = c->samples*c->nch;          // Number of samples
-  float curavg = 0.0, newavg, neededmul, tmp;
+  float curavg = 0.0, newavg, neededmul;
 
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
+  curavg = sqrt(sum_squares_float(data, len) / (float) len);
 
   // Evaluate an adequate 'mul' coefficient based on previous state, current
   // samples level, etc
@@ -165,9 +180,10 @@ static void method1_float(af_drc_t *s, struct mp_audio *c)
     s->mul = MPCLAMP(s->mul, MUL_MIN, MUL_MAX);
   }
 
-  // Scale & clamp the samples
+  // Scale & clamp the samples (local copy: data could alias s->mul)
+  float mul = s->mul;
   for (i = 0; i < len; i++)
-    data[i] *= s->mul;
+    data[i] *= mul;
 
   // Evaulation of newavg (not 100% accurate because of values clamping)
   newavg = s->mul * curavg;
@@ -184,12 +200,7 @@ static void method2_int16(af_drc_t *s, struct mp_audio *c)
   float curavg = 0.0, newavg, avg = 0.0;
   int tmp, totallen = 0;
 
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
+  curavg = sqrt(sum_squares_int16(data, len) / (float) len);
 
   // Evaluate an adequate 'mul' coefficient based on previous state, current
   // samples level, etc
@@ -231,15 +242,10 @@ static void method2_float(af_drc_t *s, struct mp_audio *c)
   register int i = 0;
   float *data = (float*)c->planes[0];   // Audio data
   int len = c->samples*c->nch;          // Number of samples
-  float curavg = 0.0, newavg, avg = 0.0, tmp;
+  float curavg = 0.0, newavg, avg = 0.0;
   int totallen = 0;
 
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
+  curavg = sqrt(sum_squares_float(data, len) / (float) len);
 
   // Evaluate an adequate 'mul' coefficient based on previous state, current
   // samples level, etc
@@ -259,9 +265,10 @@ static void method2_float(af_drc_t *s, struct mp_audio *c)
     }
   }
 
-  // Scale & clamp the samples
+  // Scale & clamp the samples (local copy: data could alias s->mul)
+  float mul = s->mul;
   for (i = 0; i < len; i++)
-    data[i] *= s->mul;
+    data[i] *= mul;
 
   // Evaulation of newavg (not 100% accurate because of values clamping)
   newavg = s->mul * curavg;
@@ -63,8 +63,10 @@ typedef struct af_equalizer_s
 {
   float   a[KM][L];             // A weights
   float   b[KM][L];             // B weights
-  float   wq[AF_NCH][KM][L];    // Circular buffer for W data
-  float   g[AF_NCH][KM];        // Gain factor for each channel and band
+  // Channel is the innermost index, so that the filter loop can run all
+  // channels of a sample in parallel (the compiler vectorizes over them).
+  float   wq[KM][L][AF_NCH];    // Circular buffer for W data
+  float   g[KM][AF_NCH];        // Gain factor for each band and channel
   int     K;                    // Number of used eq bands
   int     channels;             // Number of channels
   float   gain_factor;     // applied at output to avoid clipping
@@ -118,9 +120,9 @@ static int control(struct af_instance* af, int cmd, void* arg)
     af->delay = 2.0 / (double)af->data->rate;
 
     // Calculate gain factor to prevent clipping at output
-    for(k=0;k<AF_NCH;k++)
+    for(k=0;k<KM;k++)
     {
-        for(i=0;i<KM;i++)
+        for(i=0;i<AF_NCH;i++)
         {
             if(s->gain_factor < s->g[k][i]) s->gain_factor=s->g[k][i];
         }
@@ -146,36 +148,33 @@ static int filter(struct af_instance* af, struct mp_audio* data, int flags)
 {
   struct mp_audio*       c      = data;                         // Current working data
   af_equalizer_t*  s    = (af_equalizer_t*)af->priv;    // Setup
-  uint32_t         ci   = af->data->nch;                // Index for channels
-  uint32_t         nch  = af->data->nch;                // Number of channels
-
-  while(ci--){
-    float*      g   = s->g[ci];      // Gain factor
-    float*      in  = ((float*)c->planes[0])+ci;
-    float*      out = ((float*)c->planes[0])+ci;
-    float*      end = in + c->samples*c->nch; // Block loop end
-
-    while(in < end){
-      register int      k  = 0;         // Frequency band index
-      register float    yt = *in;       // Current input sample
-      in+=nch;
-
-      // Run the filters
-      for(;k<s->K;k++){
-        // Pointer to circular buffer wq
-        register float* wq = s->wq[ci][k];
+  int              nch  = af->data->nch;                // Number of channels
+  float*           buf  = c->planes[0];
+
+  // The bands are a serial cascade, but channels are independent: run the
+  // whole cascade for one sample of all channels at a time.
+  for(int i = 0; i < c->samples; i++){
+    float* y = buf + i * nch;       // Current sample of each channel
+
+    for(int k = 0; k < s->K; k++){
+      float  a0 = s->a[k][0], a1 = s->a[k][1];
+      float  b0 = s->b[k][0], b1 = s->b[k][1];
+      float* g  = s->g[k];
+      float* w0 = s->wq[k][0];
+      float* w1 = s->wq[k][1];
+      for(int ci = 0; ci < nch; ci++){
         // Calculate output from AR part of current filter
-        register float w=yt*s->b[k][0] + wq[0]*s->a[k][0] + wq[1]*s->a[k][1];
+        float w = y[ci]*b0 + w0[ci]*a0 + w1[ci]*a1;
         // Calculate output form MA part of current filter
-        yt+=(w + wq[1]*s->b[k][1])*g[k];
+        y[ci] += (w + w1[ci]*b1)*g[ci];
         // Update circular buffer
-        wq[1] = wq[0];
-        wq[0] = w;
+        w1[ci] = w0[ci];
+        w0[ci] = w;
       }
-      // Calculate output
-      *out=yt*s->gain_factor;
-      out+=nch;
     }
+    // Calculate output
+    for(int ci = 0; ci < nch; ci++)
+      y[ci] *= s->gain_factor;
   }
   return 0;
 }
@@ -187,7 +186,7 @@ static int af_open(struct af_instance* af){
   af_equalizer_t *priv = af->priv;
   for(int i=0;i<AF_NCH;i++){
       for(int j=0;j<KM;j++){
-        priv->g[i][j] = pow(10.0,MPCLAMP(priv->p[j],G_MIN,G_MAX)/20.0)-1.0;
+        priv->g[j][i] = pow(10.0,MPCLAMP(priv->p[j],G_MIN,G_MAX)/20.0)-1.0;
       }
     }
   return AF_OK;
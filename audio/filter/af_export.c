@@ -1,11 +1,8 @@
 /*
  * This audio filter exports the incoming signal to other processes
- * using memory mapping. The memory mapped area contains a header:
- *   int nch,
- *   int size,
- *   unsigned long long counter (updated every time the  contents of
- *                               the area changes),
- * the rest is payload (non-interleaved).
+ * using memory mapping. The memory mapped file contains a lock-free
+ * single-producer/single-consumer ring buffer, see libmpv/audio_export.h
+ * for the layout and the reader functions.
  *
  * Authors: Anders; Gustavo Sverzut Barbieri <gustavo.barbieri@ic.unicamp.br>
  *
@@ -35,201 +32,210 @@
 
 #include <sys/types.h>
 #include <sys/mman.h>
-#include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 
 #include "osdep/io.h"
 
 #include "talloc.h"
+#include "common/common.h"
 #include "af.h"
-#include "options/path.h"
+#include "audio/audio_export.h"
 
-#define DEF_SZ 512 // default buffer size (in samples)
-#define SHARED_FILE "mpv-af_export" /* default file name
-                                           (relative to ~/.mpv/ */
+#define DEF_SZ 16384 // default ring size (in frames)
 
-#define SIZE_HEADER (2 * sizeof(int) + sizeof(unsigned long long))
+struct priv {
+    // Options
+    char *filename;     // file to export data to
+    int sz;             // ring size in frames (rounded up to a power of 2)
 
-// Data for specific instances of this filter
-typedef struct af_export_s
-{
-  unsigned long long  count; // Used for sync
-  void* buf[AF_NCH];    // Buffers for storing the data before it is exported
-  int   sz;             // Size of buffer in samples
-  int   wi;             // Write index
-  int   fd;             // File descriptor to shared memory area
-  char* filename;       // File to export data
-  uint8_t *mmap_area;   // MMap shared area
-} af_export_t;
-
-
-/* Initialization and runtime control
-   af audio filter instance
-   cmd control command
-   arg argument
-*/
-static int control(struct af_instance* af, int cmd, void* arg)
+    uint8_t *map;       // shared memory area
+    size_t map_size;
+    mpv_audio_export_header *hdr;
+    int frame_size;     // in bytes
+    uint64_t write_pos;
+    uint64_t overruns;
+};
+
+static void close_export(struct af_instance *af)
 {
-  af_export_t* s = af->priv;
-  switch (cmd){
-  case AF_CONTROL_REINIT:{
-    int i=0;
-    int mapsize;
-
-    // Free previous buffers
-    if (s->buf)
-      free(s->buf[0]);
-
-    // unmap previous area
-    if(s->mmap_area)
-      munmap(s->mmap_area, SIZE_HEADER + (af->data->bps*s->sz*af->data->nch));
-    // close previous file descriptor
-    if(s->fd)
-      close(s->fd);
-
-    // Accept only int16_t as input format (which sucks)
-    mp_audio_copy_config(af->data, (struct mp_audio*)arg);
-    mp_audio_set_format(af->data, AF_FORMAT_S16);
-
-    // Allocate new buffers (as one continuous block)
-    s->buf[0] = calloc(s->sz*af->data->nch, af->data->bps);
-    if(NULL == s->buf[0])
-      MP_FATAL(af, "Out of memory\n");
-    for(i = 1; i < af->data->nch; i++)
-      s->buf[i] = (uint8_t *)s->buf[0] + i*s->sz*af->data->bps;
-
-    if (!s->filename) {
-        MP_FATAL(af, "No filename set.\n");
-        return AF_ERROR;
-    }
+    struct priv *s = af->priv;
 
-    // Init memory mapping
-    s->fd = open(s->filename, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
-    MP_INFO(af, "Exporting to file: %s\n", s->filename);
-    if(s->fd < 0) {
-      MP_FATAL(af, "Could not open/create file: %s\n",
-             s->filename);
-      return AF_ERROR;
+    if (s->map) {
+        // Tell the reader that no more data will follow.
+        mp_audio_export_store32(&s->hdr->closed, 1);
+        munmap(s->map, s->map_size);
     }
+    s->map = NULL;
+    s->hdr = NULL;
+}
 
-    // header + buffer
-    mapsize = (SIZE_HEADER + (af->data->bps * s->sz * af->data->nch));
-
-    // grow file to needed size
-    for(i = 0; i < mapsize; i++){
-      char null = 0;
-      write(s->fd, (void*) &null, 1);
+// Create the file under a temporary name, and rename it when it's ready, so
+// a reader never sees a partially initialized file. A reader still using the
+// old file sees the closed flag, and reopens the file.
+static bool open_export(struct af_instance *af, int format)
+{
+    struct priv *s = af->priv;
+    struct mp_audio *data = af->data;
+
+    uint32_t ring_frames = 1;
+    while (ring_frames < s->sz)
+        ring_frames <<= 1;
+
+    s->frame_size = mp_audio_export_sample_size(format) * data->nch;
+    s->map_size = sizeof(mpv_audio_export_header) +
+                  (size_t)ring_frames * s->frame_size;
+
+    char *tmp = talloc_asprintf(NULL, "%s.new", s->filename);
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        MP_FATAL(af, "Could not open/create file: %s\n", tmp);
+        goto error;
+    }
+    if (ftruncate(fd, s->map_size) < 0) {
+        MP_FATAL(af, "Could not resize file: %s\n", tmp);
+        goto error;
+    }
+    s->map = mmap(NULL, s->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (s->map == MAP_FAILED) {
+        s->map = NULL;
+        MP_FATAL(af, "Could not mmap file: %s\n", tmp);
+        goto error;
+    }
+    close(fd);
+    fd = -1;
+
+    s->hdr = (mpv_audio_export_header *)s->map;
+    *s->hdr = (mpv_audio_export_header){
+        .magic = MPV_AUDIO_EXPORT_MAGIC,
+        .version = MPV_AUDIO_EXPORT_VERSION,
+        .header_size = sizeof(mpv_audio_export_header),
+        .format = format,
+        .channels = data->nch,
+        .samplerate = data->rate,
+        .ring_frames = ring_frames,
+    };
+    s->write_pos = 0;
+    s->overruns = 0;
+
+    if (rename(tmp, s->filename) < 0) {
+        MP_FATAL(af, "Could not rename %s to %s\n", tmp, s->filename);
+        goto error;
     }
 
-    // mmap size
-    s->mmap_area = mmap(0, mapsize, PROT_READ|PROT_WRITE,MAP_SHARED, s->fd, 0);
-    if(s->mmap_area == NULL)
-      MP_FATAL(af, "Could not mmap file %s\n", s->filename);
-    MP_INFO(af, "Memory mapped to file: %s (%p)\n",
-           s->filename, s->mmap_area);
-
-    // Initialize header
-    *((int*)s->mmap_area) = af->data->nch;
-    *((int*)s->mmap_area + 1) = s->sz * af->data->bps * af->data->nch;
-    msync(s->mmap_area, mapsize, MS_ASYNC);
-
-    // Use test_output to return FALSE if necessary
-    return af_test_output(af, (struct mp_audio*)arg);
-  }
-  }
-  return AF_UNKNOWN;
+    MP_VERBOSE(af, "Exporting %d frames ring to file: %s\n",
+               (int)ring_frames, s->filename);
+    talloc_free(tmp);
+    return true;
+
+error:
+    if (fd >= 0)
+        close(fd);
+    if (s->map)
+        munmap(s->map, s->map_size);
+    s->map = NULL;
+    s->hdr = NULL;
+    talloc_free(tmp);
+    return false;
 }
 
-/* Free allocated memory and clean up other stuff too.
-   af audio filter instance
-*/
-static void uninit( struct af_instance* af )
+static int control(struct af_instance *af, int cmd, void *arg)
 {
-    af_export_t* s = af->priv;
-    if (s->buf)
-      free(s->buf[0]);
-
-    // Free mmaped area
-    if(s->mmap_area)
-      munmap(s->mmap_area, sizeof(af_export_t));
+    struct priv *s = af->priv;
+
+    switch (cmd) {
+    case AF_CONTROL_REINIT: {
+        struct mp_audio *in = arg;
+
+        mp_audio_copy_config(af->data, in);
+        mp_audio_force_interleaved_format(af->data);
+        int format = MPV_AUDIO_EXPORT_FORMAT_FLOAT;
+        if (af_fmt_from_planar(in->format) == AF_FORMAT_S16) {
+            mp_audio_set_format(af->data, AF_FORMAT_S16);
+            format = MPV_AUDIO_EXPORT_FORMAT_S16;
+        } else {
+            mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+        }
+
+        // Keep the file if nothing changed, so readers can keep reading.
+        mpv_audio_export_header *h = s->hdr;
+        if (!h || h->format != format || h->channels != af->data->nch ||
+            h->samplerate != af->data->rate)
+        {
+            close_export(af);
+            if (!open_export(af, format))
+                return AF_ERROR;
+        }
+
+        return af_test_output(af, in);
+    }
+    }
+    return AF_UNKNOWN;
+}
 
-    if(s->fd > -1)
-      close(s->fd);
+static void uninit(struct af_instance *af)
+{
+    close_export(af);
 }
 
-/* Filter data through filter
-   af audio filter instance
-   data audio data
-*/
-static int filter( struct af_instance* af, struct mp_audio* data, int flags)
+static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 {
-  struct mp_audio*      c   = data;          // Current working data
-  af_export_t*  s   = af->priv;     // Setup for this instance
-  int16_t*      a   = c->planes[0];          // Incomming sound
-  int           nch = c->nch;        // Number of channels
-  int           len = c->samples*c->nch; // Number of sample in data chunk
-  int           sz  = s->sz;         // buffer size (in samples)
-  int           flag = 0;            // Set to 1 if buffer is filled
-
-  int           ch, i;
-
-  // Fill all buffers
-  for(ch = 0; ch < nch; ch++){
-    int         wi = s->wi;      // Reset write index
-    int16_t*    b  = s->buf[ch]; // Current buffer
-
-    // Copy data to export buffers
-    for(i = ch; i < len; i += nch){
-      b[wi++] = a[i];
-      if(wi >= sz){ // Don't write outside the end of the buffer
-        flag = 1;
-        break;
-      }
+    struct priv *s = af->priv;
+    mpv_audio_export_header *h = s->hdr;
+
+    uint32_t ring_frames = h->ring_frames;
+    uint64_t read_pos = mp_audio_export_load(&h->read_pos);
+    uint64_t space = ring_frames - (s->write_pos - read_pos);
+
+    // Never wait for the reader; drop what doesn't fit.
+    int frames = data->samples;
+    if (frames > space) {
+        s->overruns += frames - space;
+        mp_audio_export_store(&h->overruns, s->overruns);
+        frames = space;
     }
-    s->wi = wi % s->sz;
-  }
-
-  // Export buffer to mmaped area
-  if(flag){
-    // update buffer in mapped area
-    memcpy(s->mmap_area + SIZE_HEADER, s->buf[0], sz * c->bps * nch);
-    s->count++; // increment counter (to sync)
-    memcpy(s->mmap_area + SIZE_HEADER - sizeof(s->count),
-           &(s->count), sizeof(s->count));
-  }
-
-  return 0;
+
+    uint8_t *ring = s->map + h->header_size;
+    uint8_t *src = data->planes[0];
+    int done = 0;
+    while (done < frames) {
+        uint32_t pos = (s->write_pos + done) & (ring_frames - 1);
+        int n = MPMIN(frames - done, ring_frames - pos);
+        memcpy(ring + pos * s->frame_size, src + done * s->frame_size,
+               n * s->frame_size);
+        done += n;
+    }
+
+    s->write_pos += frames;
+    mp_audio_export_store(&h->write_pos, s->write_pos);
+
+    return 0;
 }
 
-/* Allocate memory and set function pointers
-   af audio filter instance
-   returns AF_OK or AF_ERROR
-*/
-static int af_open( struct af_instance* af )
+static int af_open(struct af_instance *af)
 {
-  af->control = control;
-  af->uninit  = uninit;
-  af->filter  = filter;
-  af_export_t *priv = af->priv;
+    af->control = control;
+    af->uninit  = uninit;
+    af->filter  = filter;
+    struct priv *priv = af->priv;
 
-  if (!priv->filename || !priv->filename[0]) {
-      MP_FATAL(af, "no export filename given");
-      return AF_ERROR;
-  }
+    if (!priv->filename || !priv->filename[0]) {
+        MP_FATAL(af, "no export filename given\n");
+        return AF_ERROR;
+    }
 
-  return AF_OK;
+    return AF_OK;
 }
 
-#define OPT_BASE_STRUCT af_export_t
+#define OPT_BASE_STRUCT struct priv
 const struct af_info af_info_export = {
     .info = "Sound export filter",
     .name = "export",
     .open = af_open,
-    .priv_size = sizeof(af_export_t),
+    .priv_size = sizeof(struct priv),
     .options = (const struct m_option[]) {
         OPT_STRING("filename", filename, 0),
-        OPT_INTRANGE("buffersamples", sz, 0, 1, 2048, OPTDEF_INT(DEF_SZ)),
+        OPT_INTRANGE("buffersamples", sz, 0, 1, 1 << 22, OPTDEF_INT(DEF_SZ)),
         {0}
     },
 };
@@ -52,6 +52,7 @@ typedef struct af_ac3enc_s {
     struct AVCodec        *lavc_acodec;
     struct AVCodecContext *lavc_actx;
     AVPacket pkt;
+    AVFrame *frame;     // reused for every encoded frame
     int bit_rate;
     struct mp_audio_buffer *pending;
     int in_samples;     // samples of input per AC3 frame
@@ -133,6 +134,10 @@ static int control(struct af_instance *af, int cmd, void *arg)
         }
         return AF_OK;
     }
+    case AF_CONTROL_RESET:
+        mp_audio_buffer_clear(s->pending);
+        af->delay = 0;
+        return AF_OK;
     }
     return AF_UNKNOWN;
 }
@@ -144,6 +149,7 @@ static void uninit(struct af_instance* af)
 
     if (s) {
         av_free_packet(&s->pkt);
+        av_frame_free(&s->frame);
         if(s->lavc_actx) {
             avcodec_close(s->lavc_actx);
             av_free(s->lavc_actx);
@@ -192,11 +198,7 @@ static int filter(struct af_instance* af, struct mp_audio* audio, int flags)
         }
         in_frame.samples = s->in_samples;
 
-        AVFrame *frame = av_frame_alloc();
-        if (!frame) {
-            MP_FATAL(af, "Could not allocate memory \n");
-            return -1;
-        }
+        AVFrame *frame = s->frame;
         frame->nb_samples = s->in_samples;
         frame->format = s->lavc_actx->sample_fmt;
         frame->channel_layout = s->lavc_actx->channel_layout;
@@ -208,7 +210,6 @@ static int filter(struct af_instance* af, struct mp_audio* audio, int flags)
 
         int ok;
         ret = avcodec_encode_audio2(s->lavc_actx, &s->pkt, frame, &ok);
-        av_frame_free(&frame);
         if (ret < 0 || !ok) {
             MP_FATAL(af, "Encode failed.\n");
             return -1;
@@ -251,6 +252,8 @@ static int filter(struct af_instance* af, struct mp_audio* audio, int flags)
     }
 
     mp_audio_buffer_append(s->pending, audio);
+    // Input waiting for a complete AC3 frame hasn't reached the output yet.
+    af->delay = mp_audio_buffer_seconds(s->pending);
 
     *audio = *out;
     return 0;
@@ -292,6 +295,12 @@ static int af_open(struct af_instance* af){
 
     av_init_packet(&s->pkt);
 
+    s->frame = av_frame_alloc();
+    if (!s->frame) {
+        MP_ERR(af, "Could not allocate memory\n");
+        return AF_ERROR;
+    }
+
     s->pending = mp_audio_buffer_create(af);
 
     if (s->cfg_bit_rate) {
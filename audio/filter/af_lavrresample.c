@@ -48,6 +48,7 @@
 #define avresample_convert(ctx, out, out_planesize, out_samples, in, in_planesize, in_samples) \
     swr_convert(ctx, out, out_samples, (const uint8_t**)(in), in_samples)
 #define avresample_set_channel_mapping swr_set_channel_mapping
+#define avresample_set_compensation swr_set_compensation
 #else
 #error "config.h broken or no resampler found"
 #endif
@@ -83,6 +84,8 @@ struct af_resample {
     int reorder_in[MP_NUM_CHANNELS];
     int reorder_out[MP_NUM_CHANNELS];
     uint8_t *reorder_buffer;
+    double speed_correction;       // AF_CONTROL_SET_SPEED_CORRECTION
+    double compensation_error;     // fractional output samples not yet applied
 };
 
 #if HAVE_LIBAVRESAMPLE
@@ -272,8 +275,12 @@ static int control(struct af_instance *af, int cmd, void *arg)
     case AF_CONTROL_SET_RESAMPLE_RATE:
         out->rate = *(int *)arg;
         return AF_OK;
+    case AF_CONTROL_SET_SPEED_CORRECTION:
+        s->speed_correction = *(double *)arg;
+        return AF_OK;
     case AF_CONTROL_RESET:
         drop_all_output(s);
+        s->compensation_error = 0;
         return AF_OK;
     }
     return AF_UNKNOWN;
@@ -317,9 +324,26 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
     struct mp_audio *in   = data;
     struct mp_audio *out  = af->data;
 
+    // Spread the speed correction over the output of this chunk. The
+    // resampler adds or drops the requested number of samples smoothly.
+    int compensation = 0;
+    if (s->speed_correction != 1.0 && in->samples > 0) {
+        double nominal = in->samples * (double)s->ctx.out_rate / s->ctx.in_rate;
+        s->compensation_error += nominal * (1.0 / s->speed_correction - 1.0);
+        compensation = (int)s->compensation_error;
+        s->compensation_error -= compensation;
+        if (compensation) {
+            int distance = FFMAX((int)nominal, abs(compensation)) + 1;
+            if (avresample_set_compensation(s->avrctx, compensation,
+                                            distance) < 0)
+                compensation = 0;
+        }
+    }
+
     out->samples = avresample_available(s->avrctx) +
         av_rescale_rnd(get_delay(s) + in->samples,
-                       s->ctx.out_rate, s->ctx.in_rate, AV_ROUND_UP);
+                       s->ctx.out_rate, s->ctx.in_rate, AV_ROUND_UP) +
+        FFMAX(compensation, 0);
 
     mp_audio_realloc_min(out, out->samples);
 
@@ -362,6 +386,8 @@ static int af_open(struct af_instance *af)
     af->uninit  = uninit;
     af->filter  = filter;
 
+    s->speed_correction = 1.0;
+
     if (s->opts.cutoff <= 0.0)
         s->opts.cutoff = af_resample_default_cutoff(s->opts.filter_size);
 
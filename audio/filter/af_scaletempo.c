@@ -56,6 +56,9 @@ typedef struct af_scaletempo_s
     int bytes_queued;
     int bytes_to_slide;
     int8_t *buf_queue;
+    // planar input/output; buffers above are always interleaved
+    bool planar;
+    void *buf_planar_overlap;
     // overlap
     int samples_overlap;
     int samples_standing;
@@ -81,10 +84,64 @@ typedef struct af_scaletempo_s
     short speed_pitch;
 } af_scaletempo_t;
 
+// Copy/convert between planar audio and the interleaved internal buffers.
+// Doing this while copying into and out of the queue is what lets the filter
+// take planar input without a separate conversion pass over the whole buffer.
+static void interleave(af_scaletempo_t *s, int8_t *dst, struct mp_audio *src,
+                       int src_frame, int frames)
+{
+    int nch = s->num_channels;
+    for (int c = 0; c < nch; c++) {
+        if (src->bps == 2) {
+            int16_t *d = (int16_t *)dst + c;
+            int16_t *p = (int16_t *)src->planes[c] + src_frame;
+            for (int i = 0; i < frames; i++)
+                d[i * nch] = p[i];
+        } else {
+            uint32_t *d = (uint32_t *)dst + c;
+            uint32_t *p = (uint32_t *)src->planes[c] + src_frame;
+            for (int i = 0; i < frames; i++)
+                d[i * nch] = p[i];
+        }
+    }
+}
+
+static void deinterleave(af_scaletempo_t *s, struct mp_audio *dst,
+                         int dst_frame, int8_t *src, int frames)
+{
+    int nch = s->num_channels;
+    for (int c = 0; c < nch; c++) {
+        if (dst->bps == 2) {
+            int16_t *d = (int16_t *)dst->planes[c] + dst_frame;
+            int16_t *p = (int16_t *)src + c;
+            for (int i = 0; i < frames; i++)
+                d[i] = p[i * nch];
+        } else {
+            uint32_t *d = (uint32_t *)dst->planes[c] + dst_frame;
+            uint32_t *p = (uint32_t *)src + c;
+            for (int i = 0; i < frames; i++)
+                d[i] = p[i * nch];
+        }
+    }
+}
+
+// Write bytes (interleaved) from src to the output at frame position out_frame.
+static void write_output(af_scaletempo_t *s, struct mp_audio *out,
+                         int out_frame, int8_t *src, int bytes)
+{
+    if (s->planar) {
+        deinterleave(s, out, out_frame, src, bytes / s->bytes_per_frame);
+    } else {
+        memcpy((int8_t *)out->planes[0] + out_frame * s->bytes_per_frame,
+               src, bytes);
+    }
+}
+
 static int fill_queue(struct af_instance *af, struct mp_audio *data, int offset)
 {
     af_scaletempo_t *s = af->priv;
-    int bytes_in = mp_audio_psize(data) - offset;
+    // offset and all byte counts refer to the interleaved layout
+    int bytes_in = data->samples * s->bytes_per_frame - offset;
     int offset_unchanged = offset;
 
     if (s->bytes_to_slide > 0) {
@@ -107,8 +164,14 @@ static int fill_queue(struct af_instance *af, struct mp_audio *data, int offset)
     if (bytes_in > 0) {
         int bytes_copy = MPMIN(s->bytes_queue - s->bytes_queued, bytes_in);
         assert(bytes_copy >= 0);
-        memcpy(s->buf_queue + s->bytes_queued,
-               (int8_t *)data->planes[0] + offset, bytes_copy);
+        if (s->planar) {
+            interleave(s, s->buf_queue + s->bytes_queued, data,
+                       offset / s->bytes_per_frame,
+                       bytes_copy / s->bytes_per_frame);
+        } else {
+            memcpy(s->buf_queue + s->bytes_queued,
+                   (int8_t *)data->planes[0] + offset, bytes_copy);
+        }
         s->bytes_queued += bytes_copy;
         offset += bytes_copy;
     }
@@ -118,6 +181,41 @@ static int fill_queue(struct af_instance *af, struct mp_audio *data, int offset)
 
 #define UNROLL_PADDING (4 * 4)
 
+// Number of independent partial sums in the correlation kernels. A single
+// accumulator makes every multiply-add depend on the previous one, which
+// neither pipelines nor vectorizes (without -ffast-math the compiler must
+// keep the summation order). 8 lanes cover one AVX or two SSE/NEON registers.
+#define CORR_LANES 8
+
+static float dot_float(const float *restrict a, const float *restrict b, int n)
+{
+    float acc[CORR_LANES] = {0};
+    int i = 0;
+    for (; i + CORR_LANES <= n; i += CORR_LANES) {
+        for (int l = 0; l < CORR_LANES; l++)
+            acc[l] += a[i + l] * b[i + l];
+    }
+    float sum = 0;
+    for (int l = 0; l < CORR_LANES; l++)
+        sum += acc[l];
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+static int64_t dot_s16(const int32_t *restrict a, const int16_t *restrict b,
+                       int n)
+{
+    // Relies on UNROLL_PADDING: a[] is zero-padded, so reading a few samples
+    // past the end of b[] doesn't change the result.
+    int64_t acc[4] = {0};
+    for (int i = 0; i < n; i += 4) {
+        for (int l = 0; l < 4; l++)
+            acc[l] += a[i + l] * (int64_t)b[i + l];
+    }
+    return acc[0] + acc[1] + acc[2] + acc[3];
+}
+
 static int best_overlap_offset_float(af_scaletempo_t *s)
 {
     float best_corr = INT_MIN;
@@ -130,13 +228,10 @@ static int best_overlap_offset_float(af_scaletempo_t *s)
     for (int i = s->num_channels; i < s->samples_overlap; i++)
         *ppc++ = *pw++ **po++;
 
+    int n = s->samples_overlap - s->num_channels;
     float *search_start = (float *)s->buf_queue + s->num_channels;
     for (int off = 0; off < s->frames_search; off++) {
-        float corr = 0;
-        float *ps = search_start;
-        ppc = s->buf_pre_corr;
-        for (int i = s->num_channels; i < s->samples_overlap; i++)
-            corr += *ppc++ **ps++;
+        float corr = dot_float(s->buf_pre_corr, search_start, n);
         if (corr > best_corr) {
             best_corr = corr;
             best_off  = off;
@@ -159,21 +254,10 @@ static int best_overlap_offset_s16(af_scaletempo_t *s)
     for (long i = s->num_channels; i < s->samples_overlap; i++)
         *ppc++ = (*pw++ **po++) >> 15;
 
+    int n = s->samples_overlap - s->num_channels;
     int16_t *search_start = (int16_t *)s->buf_queue + s->num_channels;
     for (int off = 0; off < s->frames_search; off++) {
-        int64_t corr = 0;
-        int16_t *ps = search_start;
-        ppc = s->buf_pre_corr;
-        ppc += s->samples_overlap - s->num_channels;
-        ps  += s->samples_overlap - s->num_channels;
-        long i  = -(s->samples_overlap - s->num_channels);
-        do {
-            corr += ppc[i + 0] * ps[i + 0];
-            corr += ppc[i + 1] * ps[i + 1];
-            corr += ppc[i + 2] * ps[i + 2];
-            corr += ppc[i + 3] * ps[i + 3];
-            i += 4;
-        } while (i < 0);
+        int64_t corr = dot_s16(s->buf_pre_corr, search_start, n);
         if (corr > best_corr) {
             best_corr = corr;
             best_off  = off;
@@ -224,7 +308,8 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
         ((int)(data->samples / s->frames_stride_scaled) + 1) * s->frames_stride);
 
     int offset_in = fill_queue(af, data, 0);
-    int8_t *pout = af->data->planes[0];
+    int frames_out = 0;
+    int frames_overlap = s->bytes_overlap / s->bytes_per_frame;
     while (s->bytes_queued >= s->bytes_queue) {
         int ti;
         float tf;
@@ -234,12 +319,20 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
         if (s->output_overlap) {
             if (s->best_overlap_offset)
                 bytes_off = s->best_overlap_offset(s);
-            s->output_overlap(s, pout, bytes_off);
+            if (s->planar) {
+                s->output_overlap(s, s->buf_planar_overlap, bytes_off);
+                write_output(s, af->data, frames_out, s->buf_planar_overlap,
+                             s->bytes_overlap);
+            } else {
+                int8_t *pout = af->data->planes[0];
+                s->output_overlap(s, pout + frames_out * s->bytes_per_frame,
+                                  bytes_off);
+            }
         }
-        memcpy(pout + s->bytes_overlap,
-               s->buf_queue + bytes_off + s->bytes_overlap,
-               s->bytes_standing);
-        pout += s->bytes_stride;
+        write_output(s, af->data, frames_out + frames_overlap,
+                     s->buf_queue + bytes_off + s->bytes_overlap,
+                     s->bytes_standing);
+        frames_out += s->frames_stride;
 
         // input stride
         memcpy(s->buf_overlap,
@@ -257,10 +350,11 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
     // output corresponding to some length of input can be decided and written
     // after receiving only a part of that input.
     af->delay = (s->bytes_queued - s->bytes_to_slide) / s->scale
-                / af->data->sstride / af->data->rate;
+                / s->bytes_per_frame / af->data->rate;
 
-    data->planes[0] = af->data->planes[0];
-    data->samples   = (pout - (int8_t *)af->data->planes[0]) / af->data->sstride;
+    for (int n = 0; n < af->data->num_planes; n++)
+        data->planes[n] = af->data->planes[n];
+    data->samples = frames_out;
     return 0;
 }
 
@@ -278,7 +372,10 @@ static int control(struct af_instance *af, int cmd, void *arg)
         MP_VERBOSE(af, "%.3f speed * %.3f scale_nominal = %.3f\n",
                s->speed, s->scale_nominal, s->scale);
 
-        mp_audio_force_interleaved_format(data);
+        // Planar input is accepted as-is and interleaved on the fly, so
+        // the decoder's native (usually planar float) output needs no
+        // conversion filter in front of this one.
+        s->planar = af_fmt_is_planar(data->format);
         mp_audio_copy_config(af->data, data);
 
         if (s->scale == 1.0) {
@@ -289,10 +386,11 @@ static int control(struct af_instance *af, int cmd, void *arg)
             return af_test_output(af, data);
         }
 
-        if (data->format == AF_FORMAT_S16) {
+        if (af_fmt_from_planar(data->format) == AF_FORMAT_S16) {
             use_int = 1;
         } else {
-            mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+            mp_audio_set_format(af->data, s->planar ? AF_FORMAT_FLOATP
+                                                    : AF_FORMAT_FLOAT);
         }
         int bps = af->data->bps;
 
@@ -316,7 +414,9 @@ static int control(struct af_instance *af, int cmd, void *arg)
             s->samples_standing = s->bytes_standing / bps;
             s->buf_overlap      = realloc(s->buf_overlap, s->bytes_overlap);
             s->table_blend      = realloc(s->table_blend, s->bytes_overlap * 4);
-            if (!s->buf_overlap || !s->table_blend) {
+            s->buf_planar_overlap = realloc(s->buf_planar_overlap,
+                                            s->bytes_overlap);
+            if (!s->buf_overlap || !s->table_blend || !s->buf_planar_overlap) {
                 MP_FATAL(af, "Out of memory\n");
                 return AF_ERROR;
             }
@@ -441,6 +541,7 @@ static void uninit(struct af_instance *af)
     af_scaletempo_t *s = af->priv;
     free(s->buf_queue);
     free(s->buf_overlap);
+    free(s->buf_planar_overlap);
     free(s->buf_pre_corr);
     free(s->table_blend);
     free(s->table_window);
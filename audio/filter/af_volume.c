@@ -41,6 +41,8 @@ struct priv {
     int fast;                   // Use fix-point volume control
     int detach;                 // Detach if gain volume is neutral
     float cfg_volume;
+    int work_format;            // Format the gain is applied in
+    int out_format;             // If set, convert to this in the same pass
 };
 
 static int control(struct af_instance *af, int cmd, void *arg)
@@ -61,6 +63,7 @@ static int control(struct af_instance *af, int cmd, void *arg)
         }
         if (af_fmt_is_planar(in->format))
             mp_audio_set_format(af->data, af_fmt_to_planar(af->data->format));
+        s->work_format = af->data->format;
         s->rgain = 1.0;
         if ((s->rgain_track || s->rgain_album) && af->replaygain_data) {
             float gain, peak;
@@ -79,9 +82,28 @@ static int control(struct af_instance *af, int cmd, void *arg)
             if (!s->rgain_clip) // clipping prevention
                 s->rgain = MPMIN(s->rgain, 1.0 / peak);
         }
-        if (s->detach && fabs(s->level * s->rgain - 1.0) < 0.00001)
+        if (s->detach && !s->out_format &&
+            fabs(s->level * s->rgain - 1.0) < 0.00001)
             return AF_DETACH;
-        return af_test_output(af, in);
+        int r = af_test_output(af, in);
+        if (s->out_format)
+            mp_audio_set_format(af->data, s->out_format);
+        return r;
+    }
+    case AF_CONTROL_SET_OUTPUT_FORMAT: {
+        int fmt = *(int *)arg;
+        if (!fmt) {
+            s->out_format = 0;
+            return AF_OK;
+        }
+        // Only float -> s16 (same planarity) is done in the gain pass.
+        int want = af_fmt_is_planar(s->work_format) ? AF_FORMAT_S16P
+                                                    : AF_FORMAT_S16;
+        if (af_fmt_from_planar(s->work_format) != AF_FORMAT_FLOAT ||
+            fmt != want || s->out_format == fmt)
+            return AF_FALSE;
+        s->out_format = fmt;
+        return AF_OK;
     }
     case AF_CONTROL_SET_VOLUME:
         s->level = *(float *)arg;
@@ -112,16 +134,48 @@ static void filter_plane(struct af_instance *af, void *ptr, int num_samples)
         float *a = ptr;
         float vol = level;
         if (vol != 1.0) {
-            for (int i = 0; i < num_samples; i++) {
-                float x = a[i] * vol;
-                a[i] = s->soft ? af_softclip(x) : MPCLAMP(x, -1.0, 1.0);
+            // Keep the branch out of the loop, so the common case vectorizes.
+            if (s->soft) {
+                for (int i = 0; i < num_samples; i++)
+                    a[i] = af_softclip(a[i] * vol);
+            } else {
+                for (int i = 0; i < num_samples; i++)
+                    a[i] = MPCLAMP(a[i] * vol, -1.0f, 1.0f);
             }
         }
     }
 }
 
+// Apply gain, clipping and float -> s16 conversion in a single pass.
+static void filter_plane_to_s16(struct af_instance *af, int16_t *dst,
+                                float *src, int num_samples)
+{
+    struct priv *s = af->priv;
+
+    float vol = s->level * s->rgain;
+    for (int i = 0; i < num_samples; i++) {
+        float x = src[i] * vol;
+        x = s->soft ? af_softclip(x) : MPCLAMP(x, -1.0f, 1.0f);
+        dst[i] = MPCLAMP(lrintf(x * 32768.0f), SHRT_MIN, SHRT_MAX);
+    }
+}
+
 static int filter(struct af_instance *af, struct mp_audio *data, int f)
 {
+    struct priv *s = af->priv;
+
+    if (s->out_format) {
+        struct mp_audio *out = af->data;
+        out->samples = data->samples;
+        mp_audio_realloc_min(out, out->samples);
+        for (int n = 0; n < data->num_planes; n++) {
+            filter_plane_to_s16(af, out->planes[n], data->planes[n],
+                                data->samples * data->spf);
+        }
+        *data = *out;
+        return 0;
+    }
+
     for (int n = 0; n < data->num_planes; n++)
         filter_plane(af, data->planes[n], data->samples * data->spf);
 
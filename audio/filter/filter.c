@@ -30,20 +30,27 @@
 
 /* C implementation of FIR filter y=w*x
 
-   n number of filter taps, where mod(n,4)==0
+   n number of filter taps
    w filter taps
    x input signal must be a circular buffer which is indexed backwards
+
+   Four independent partial sums are used, so that the multiply-adds don't
+   all depend on the previous one, and the compiler can vectorize the loop.
 */
 inline FLOAT_TYPE af_filter_fir(register unsigned int n, const FLOAT_TYPE* w,
                                 const FLOAT_TYPE* x)
 {
-  register FLOAT_TYPE y; // Output
-  y = 0.0;
-  do{
-    n--;
-    y+=w[n]*x[n];
-  }while(n != 0);
-  return y;
+  FLOAT_TYPE y0 = 0.0, y1 = 0.0, y2 = 0.0, y3 = 0.0;
+  unsigned int i = 0;
+  for(; i + 4 <= n; i += 4){
+    y0 += w[i + 0] * x[i + 0];
+    y1 += w[i + 1] * x[i + 1];
+    y2 += w[i + 2] * x[i + 2];
+    y3 += w[i + 3] * x[i + 3];
+  }
+  for(; i < n; i++)
+    y0 += w[i] * x[i];
+  return (y0 + y1) + (y2 + y3);
 }
 
 /******************************************************************************
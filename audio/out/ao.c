@@ -153,6 +153,8 @@ static struct ao *ao_create(bool probing, struct mpv_global *global,
         .format = format,
         .log = mp_log_new(ao, log, name),
         .def_buffer = global->opts->audio_buffer,
+        .thread_priority = global->opts->audio_thread_sched.priority,
+        .thread_cpu = global->opts->audio_thread_sched.cpu,
     };
     if (ao->driver->encode != !!ao->encode_lavc_ctx)
         goto error;
@@ -188,6 +190,12 @@ static struct ao *ao_create(bool probing, struct mpv_global *global,
         ao->device_buffer = ao->driver->get_space(ao);
         MP_VERBOSE(ao, "device buffer: %d samples.\n", ao->device_buffer);
     }
+    // With --low-latency, push AOs use only the device's own buffer. Pull
+    // AOs (which have no get_space) need the soft-buffer to feed the
+    // device callback, so it's left alone for them.
+    if (global->opts->low_latency && ao->driver->get_space &&
+        ao->device_buffer > 0)
+        ao->def_buffer = 0;
     ao->buffer = MPMAX(ao->device_buffer, ao->def_buffer * ao->samplerate);
     MP_VERBOSE(ao, "using soft-buffer of %d samples.\n", ao->buffer);
 
@@ -33,11 +33,13 @@
 #include <stdarg.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
 
 #include "config.h"
 #include "options/options.h"
 #include "options/m_option.h"
 #include "common/msg.h"
+#include "common/common.h"
 #include "osdep/endian.h"
 
 #define ALSA_PCM_NEW_HW_PARAMS_API
@@ -57,6 +59,8 @@ struct priv {
     float delay_before_pause;
     int buffersize; // in frames
     int outburst; // in frames
+    bool use_mmap; // mmap access was negotiated
+    bool htstamp_monotonic; // status timestamps use CLOCK_MONOTONIC
 
     int cfg_block;
     char *cfg_device;
@@ -65,6 +69,7 @@ struct priv {
     int cfg_mixer_index;
     int cfg_resample;
     int cfg_ni;
+    int cfg_mmap;
 };
 
 #define BUFFER_TIME 250000  // 250ms
@@ -430,7 +435,30 @@ static int init(struct ao *ao)
     snd_pcm_access_t access = af_fmt_is_planar(ao->format)
                                     ? SND_PCM_ACCESS_RW_NONINTERLEAVED
                                     : SND_PCM_ACCESS_RW_INTERLEAVED;
-    err = snd_pcm_hw_params_set_access(p->alsa, alsa_hwparams, access);
+    p->use_mmap = false;
+    if (p->cfg_mmap) {
+        snd_pcm_access_t mmap_access = af_fmt_is_planar(ao->format)
+                                        ? SND_PCM_ACCESS_MMAP_NONINTERLEAVED
+                                        : SND_PCM_ACCESS_MMAP_INTERLEAVED;
+        err = snd_pcm_hw_params_set_access(p->alsa, alsa_hwparams, mmap_access);
+        if (err < 0 && af_fmt_is_planar(ao->format)) {
+            ao->format = af_fmt_from_planar(ao->format);
+            mmap_access = SND_PCM_ACCESS_MMAP_INTERLEAVED;
+            err = snd_pcm_hw_params_set_access(p->alsa, alsa_hwparams,
+                                               mmap_access);
+        }
+        if (err >= 0) {
+            p->use_mmap = true;
+            access = mmap_access;
+        } else {
+            MP_WARN(ao, "mmap access not supported, using read/write.\n");
+            access = af_fmt_is_planar(ao->format)
+                        ? SND_PCM_ACCESS_RW_NONINTERLEAVED
+                        : SND_PCM_ACCESS_RW_INTERLEAVED;
+        }
+    }
+    if (!p->use_mmap)
+        err = snd_pcm_hw_params_set_access(p->alsa, alsa_hwparams, access);
     if (err < 0 && af_fmt_is_planar(ao->format)) {
         ao->format = af_fmt_from_planar(ao->format);
         access = SND_PCM_ACCESS_RW_INTERLEAVED;
@@ -508,6 +536,17 @@ static int init(struct ao *ao)
             (p->alsa, alsa_swparams, boundary);
     CHECK_ALSA_ERROR("Unable to set silence size");
 
+    /* timestamp status updates, so get_delay() can account for the time
+     * that passed since the hardware pointer was read */
+    p->htstamp_monotonic = false;
+#if defined(SND_LIB_VERSION) && SND_LIB_VERSION >= 0x01001d
+    if (snd_pcm_sw_params_set_tstamp_mode(p->alsa, alsa_swparams,
+                                          SND_PCM_TSTAMP_ENABLE) >= 0 &&
+        snd_pcm_sw_params_set_tstamp_type(p->alsa, alsa_swparams,
+                                          SND_PCM_TSTAMP_TYPE_MONOTONIC) >= 0)
+        p->htstamp_monotonic = true;
+#endif
+
     err = snd_pcm_sw_params(p->alsa, alsa_swparams);
     CHECK_ALSA_ERROR("Unable to get sw-parameters");
 
@@ -515,9 +554,10 @@ static int init(struct ao *ao)
 
     p->can_pause = snd_pcm_hw_params_can_pause(alsa_hwparams);
 
-    MP_VERBOSE(ao, "opened: %d Hz/%d channels/%d bps/%d samples buffer/%s\n",
+    MP_VERBOSE(ao, "opened: %d Hz/%d channels/%d bps/%d samples buffer/%s%s\n",
                ao->samplerate, ao->channels.num, af_fmt2bits(ao->format),
-               p->buffersize, snd_pcm_format_description(p->alsa_fmt));
+               p->buffersize, snd_pcm_format_description(p->alsa_fmt),
+               p->use_mmap ? " (mmap)" : "");
 
     return 0;
 
@@ -620,6 +660,78 @@ static void reset(struct ao *ao)
 alsa_error: ;
 }
 
+// Copy audio straight into the hardware ring buffer. Returns the number of
+// frames written, or a negative ALSA error code.
+static snd_pcm_sframes_t mmap_write(struct ao *ao, void **data, int samples)
+{
+    struct priv *p = ao->priv;
+    bool planar = af_fmt_is_planar(ao->format);
+    int nch = ao->channels.num;
+    int bps = ao->sstride / (planar ? 1 : nch); // bytes per single sample
+
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(p->alsa);
+    if (avail < 0)
+        return avail;
+    int todo = MPMIN(samples, avail);
+
+    int written = 0;
+    while (written < todo) {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset, frames = todo - written;
+        int err = snd_pcm_mmap_begin(p->alsa, &areas, &offset, &frames);
+        if (err < 0)
+            return err;
+
+        uint8_t *dst0 = (uint8_t *)areas[0].addr +
+                        (areas[0].first + offset * areas[0].step) / 8;
+        bool packed = !planar && areas[0].step == ao->sstride * 8;
+        for (int c = 1; c < nch && packed; c++) {
+            packed &= areas[c].addr == areas[0].addr &&
+                      areas[c].step == areas[0].step &&
+                      areas[c].first == areas[0].first + c * bps * 8;
+        }
+        if (packed) {
+            memcpy(dst0, (uint8_t *)data[0] + written * ao->sstride,
+                   frames * ao->sstride);
+        } else {
+            for (int c = 0; c < nch; c++) {
+                const snd_pcm_channel_area_t *a = &areas[c];
+                uint8_t *dst = (uint8_t *)a->addr +
+                               (a->first + offset * a->step) / 8;
+                int dst_step = a->step / 8;
+                uint8_t *src = planar
+                    ? (uint8_t *)data[c] + written * bps
+                    : (uint8_t *)data[0] + written * ao->sstride + c * bps;
+                int src_step = planar ? bps : ao->sstride;
+                if (dst_step == bps && src_step == bps) {
+                    memcpy(dst, src, frames * bps);
+                } else {
+                    for (int i = 0; i < frames; i++)
+                        memcpy(dst + i * dst_step, src + i * src_step, bps);
+                }
+            }
+        }
+
+        snd_pcm_sframes_t r = snd_pcm_mmap_commit(p->alsa, offset, frames);
+        if (r < 0)
+            return r;
+        written += r;
+        if (r != frames)
+            break;
+    }
+
+    // Unlike snd_pcm_writei(), committing doesn't apply the start threshold.
+    if (written > 0 && snd_pcm_state(p->alsa) == SND_PCM_STATE_PREPARED &&
+        p->buffersize - snd_pcm_avail_update(p->alsa) >= p->outburst)
+    {
+        int err = snd_pcm_start(p->alsa);
+        if (err < 0)
+            return err;
+    }
+
+    return written;
+}
+
 static int play(struct ao *ao, void **data, int samples, int flags)
 {
     struct priv *p = ao->priv;
@@ -631,7 +743,11 @@ static int play(struct ao *ao, void **data, int samples, int flags)
         return 0;
 
     do {
-        if (af_fmt_is_planar(ao->format)) {
+        if (p->use_mmap) {
+            res = mmap_write(ao, data, samples);
+            if (res == 0)
+                return 0; // no space; the caller waits for the next period
+        } else if (af_fmt_is_planar(ao->format)) {
             res = snd_pcm_writen(p->alsa, data, samples);
         } else {
             res = snd_pcm_writei(p->alsa, data[0], samples);
@@ -686,6 +802,28 @@ static float get_delay(struct ao *ao)
     if (snd_pcm_state(p->alsa) == SND_PCM_STATE_PAUSED)
         return p->delay_before_pause;
 
+    if (p->htstamp_monotonic &&
+        snd_pcm_state(p->alsa) == SND_PCM_STATE_RUNNING)
+    {
+        // The delay in the status is valid at the time of its timestamp;
+        // subtract what has been played since then.
+        snd_pcm_status_t *status;
+        snd_pcm_status_alloca(&status);
+        snd_htimestamp_t ts;
+        struct timespec now;
+        if (snd_pcm_status(p->alsa, status) >= 0 &&
+            clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+        {
+            delay = snd_pcm_status_get_delay(status);
+            snd_pcm_status_get_htstamp(status, &ts);
+            double elapsed = (now.tv_sec - ts.tv_sec) +
+                             (now.tv_nsec - ts.tv_nsec) / 1e9;
+            double d = delay / (double)ao->samplerate;
+            if (ts.tv_sec && elapsed >= 0 && elapsed < d)
+                return d - elapsed;
+        }
+    }
+
     if (snd_pcm_delay(p->alsa, &delay) < 0)
         return 0;
 
@@ -764,6 +902,7 @@ const struct ao_driver audio_out_alsa = {
         OPT_STRING("mixer-name", cfg_mixer_name, 0),
         OPT_INTRANGE("mixer-index", cfg_mixer_index, 0, 0, 99),
         OPT_FLAG("non-interleaved", cfg_ni, 0),
+        OPT_FLAG("mmap", cfg_mmap, 0),
         {0}
     },
 };
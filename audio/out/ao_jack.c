@@ -35,13 +35,16 @@
 #include "internal.h"
 #include "audio/format.h"
 #include "osdep/timer.h"
+#include "osdep/atomics.h"
 #include "options/m_option.h"
 
 #include <jack/jack.h>
 
 struct priv {
     jack_client_t *client;
-    float jack_latency;
+    // Playback latency of the port graph plus one period, in microseconds.
+    // Written by JACK's non-realtime threads, read in process().
+    atomic_llong graph_latency_us;
     char *cfg_port;
     char *cfg_client_name;
     int connect;
@@ -66,13 +69,39 @@ static int process(jack_nframes_t nframes, void *arg)
         buffers[i] = jack_port_get_buffer(p->ports[i], nframes);
 
     int64_t end_time = mp_time_us();
-    end_time += (p->jack_latency + nframes / (double)ao->samplerate) * 1000000.0;
+    end_time += atomic_load(&p->graph_latency_us);
+    end_time += nframes * 1000000LL / ao->samplerate;
 
     ao_read_data(ao, buffers, nframes, end_time);
 
     return 0;
 }
 
+static void update_latency(struct ao *ao)
+{
+    struct priv *p = ao->priv;
+
+    jack_latency_range_t range;
+    jack_port_get_latency_range(p->ports[0], JackPlaybackLatency, &range);
+    int64_t frames = range.max + jack_get_buffer_size(p->client);
+    atomic_store(&p->graph_latency_us, frames * 1000000LL / ao->samplerate);
+}
+
+// Called by JACK whenever the latency of the graph changes, e.g. after
+// connecting ports. The latency queried at init time doesn't include the
+// connected ports yet.
+static void latency_cb(jack_latency_callback_mode_t mode, void *arg)
+{
+    if (mode == JackPlaybackLatency)
+        update_latency(arg);
+}
+
+static int buffer_size_cb(jack_nframes_t nframes, void *arg)
+{
+    update_latency(arg);
+    return 0;
+}
+
 static int
 connect_to_outports(struct ao *ao)
 {
@@ -188,14 +217,12 @@ static int init(struct ao *ao)
         goto err_create_ports;
 
     jack_set_process_callback(p->client, process, ao);
+    jack_set_latency_callback(p->client, latency_cb, ao);
+    jack_set_buffer_size_callback(p->client, buffer_size_cb, ao);
 
     ao->samplerate = jack_get_sample_rate(p->client);
 
-    jack_latency_range_t jack_latency_range;
-    jack_port_get_latency_range(p->ports[0], JackPlaybackLatency,
-                                &jack_latency_range);
-    p->jack_latency = (float)(jack_latency_range.max + jack_get_buffer_size(p->client))
-                      / (float)ao->samplerate;
+    update_latency(ao);
 
     if (!ao_chmap_sel_get_def(ao, &sel, &ao->channels, p->num_ports))
         goto err_chmap_sel_get_def;
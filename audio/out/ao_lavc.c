@@ -260,7 +260,10 @@ static int encode(struct ao *ao, double apts, void **data)
         ac->lastpts = frame_pts;
 
         frame->quality = ac->stream->codec->global_quality;
+        // See vo_lavc.c encode_video() for why the lock is released.
+        pthread_mutex_unlock(&ectx->lock);
         status = avcodec_encode_audio2(ac->stream->codec, &packet, frame, &gotpacket);
+        pthread_mutex_lock(&ectx->lock);
 
         if (!status) {
             if (ac->savepts == AV_NOPTS_VALUE)
@@ -271,7 +274,9 @@ static int encode(struct ao *ao, double apts, void **data)
     }
     else
     {
+        pthread_mutex_unlock(&ectx->lock);
         status = avcodec_encode_audio2(ac->stream->codec, &packet, NULL, &gotpacket);
+        pthread_mutex_lock(&ectx->lock);
     }
 
     if(status) {
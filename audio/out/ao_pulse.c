@@ -393,12 +393,18 @@ static int init(struct ao *ao)
                                           stream_latency_update_cb, ao);
     pa_buffer_attr bufattr = {
         .maxlength = -1,
-        .tlength = priv->cfg_buffer > 0 ?
-            pa_usec_to_bytes(priv->cfg_buffer * 1000, &ss) : (uint32_t)-1,
+        .tlength = -1,
         .prebuf = -1,
         .minreq = -1,
         .fragsize = -1,
     };
+    if (priv->cfg_buffer > 0) {
+        bufattr.tlength = pa_usec_to_bytes(priv->cfg_buffer * 1000, &ss);
+        // Let the server ask for data only after a quarter of the buffer has
+        // been played. The server default is a few ms, which means lots of
+        // wakeups and tiny writes for no benefit with a buffer this large.
+        bufattr.minreq = pa_usec_to_bytes(priv->cfg_buffer * 1000 / 4, &ss);
+    }
 
     int flags = PA_STREAM_NOT_MONOTONIC;
     if (!priv->cfg_latency_hacks)
@@ -342,6 +342,7 @@ const struct ao_driver audio_out_wasapi = {
     .priv_size = sizeof(wasapi_state),
     .options   = (const struct m_option[]) {
         OPT_FLAG("exclusive", opt_exclusive, 0),
+        OPT_FLAG("min-period", opt_min_period, 0),
         OPT_FLAG("list", opt_list, 0),
         OPT_STRING_VALIDATE("device", opt_device, 0, wasapi_validate_device),
         {NULL},
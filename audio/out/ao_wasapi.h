@@ -91,6 +91,7 @@ typedef struct wasapi_state {
     LARGE_INTEGER qpc_frequency; /* frequency of windows' high resolution timer */
 
     int opt_exclusive;
+    int opt_min_period;
     int opt_list;
     char *opt_device;
 
@@ -462,6 +462,14 @@ static int fix_format(struct wasapi_state *state)
     hr = IAudioClient_GetDevicePeriod(state->pAudioClient,
                                       &state->defaultRequestedDuration,
                                       &state->minRequestedDuration);
+    /* In exclusive event mode, the buffer is exactly one device period, so
+       this directly determines the output latency. Shared mode always uses
+       the engine's period. */
+    if (state->opt_exclusive && state->opt_min_period) {
+        MP_VERBOSE(state, "Using minimum device period: %lld * 100ns\n",
+                   (long long) state->minRequestedDuration);
+        state->defaultRequestedDuration = state->minRequestedDuration;
+    }
 reinit:
     hr = IAudioClient_Initialize(state->pAudioClient,
                                  state->share_mode,
@@ -52,6 +52,8 @@ struct ao {
 
     int buffer;
     double def_buffer;
+    int thread_priority;        // for the push.c thread (--audio-thread-*)
+    int thread_cpu;
     void *api_priv;
 };
 
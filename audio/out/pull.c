@@ -54,11 +54,18 @@ struct ao_pull_state {
 
     // Device delay of the last written sample, in realtime.
     atomic_llong end_time_us;
+
+    // Set by the callback when it requested more data, cleared by the player
+    // once it looks at the buffer again. Waking up the player can be a
+    // syscall (or a pipe write with the OSX semaphore emulation), so don't
+    // do it on every callback while the buffer stays below the threshold.
+    atomic_bool wakeup_sent;
 };
 
 static int get_space(struct ao *ao)
 {
     struct ao_pull_state *p = ao->api_priv;
+    atomic_store(&p->wakeup_sent, false);
     // Since the reader will read the last plane last, its free space is the
     // minimum free space across all planes.
     return mp_ring_available(p->buffers[ao->num_planes - 1]) / ao->sstride;
@@ -124,8 +131,12 @@ int ao_read_data(struct ao *ao, void **data, int samples, int64_t out_time_us)
     }
 
     // Half of the buffer played -> request more.
-    if (buffered_bytes - bytes <= mp_ring_size(p->buffers[0]) / 2)
+    if (buffered_bytes - bytes <= mp_ring_size(p->buffers[0]) / 2 &&
+        !atomic_load(&p->wakeup_sent))
+    {
+        atomic_store(&p->wakeup_sent, true);
         mp_input_wakeup_nolock(ao->input_ctx);
+    }
 
 end:
     // pad with silence (underflow/paused/eof)
@@ -150,6 +161,7 @@ static int control(struct ao *ao, enum aocontrol cmd, void *arg)
 static float get_delay(struct ao *ao)
 {
     struct ao_pull_state *p = ao->api_priv;
+    atomic_store(&p->wakeup_sent, false);
 
     int64_t end = atomic_load(&p->end_time_us);
     int64_t now = mp_time_us();
@@ -176,6 +188,7 @@ static void reset(struct ao *ao)
     for (int n = 0; n < ao->num_planes; n++)
         mp_ring_reset(p->buffers[n]);
     atomic_store(&p->end_time_us, 0);
+    atomic_store(&p->wakeup_sent, false);
 }
 
 static void pause(struct ao *ao)
@@ -220,6 +233,7 @@ static int init(struct ao *ao)
     for (int n = 0; n < ao->num_planes; n++)
         p->buffers[n] = mp_ring_new(ao, ao->buffer * ao->sstride);
     atomic_store(&p->state, AO_STATE_NONE);
+    atomic_store(&p->wakeup_sent, false);
     assert(ao->driver->resume);
     return 0;
 }
@@ -29,6 +29,7 @@
 #include "audio/format.h"
 
 #include "common/msg.h"
+#include "common/stats.h"
 #include "common/common.h"
 
 #include "input/input.h"
@@ -262,11 +263,11 @@ static void ao_play_data(struct ao *ao)
     int flags = 0;
     if (p->final_chunk && data.samples == max)
         flags |= AOPLAY_FINAL_CHUNK;
-    MP_STATS(ao, "start ao fill");
+    MP_STATS_START(ao, "ao fill");
     int r = 0;
     if (data.samples)
         r = ao->driver->play(ao, data.planes, data.samples, flags);
-    MP_STATS(ao, "end ao fill");
+    MP_STATS_END(ao, "ao fill");
     if (r > data.samples) {
         MP_WARN(ao, "Audio device returned non-sense value.\n");
         r = data.samples;
@@ -307,6 +308,7 @@ static void *playthread(void *arg)
 {
     struct ao *ao = arg;
     struct ao_push_state *p = ao->api_priv;
+    mpthread_set_sched(ao->log, ao->thread_priority, ao->thread_cpu);
     pthread_mutex_lock(&p->lock);
     while (!p->terminate) {
         if (!p->paused)
@@ -320,7 +322,7 @@ static void *playthread(void *arg)
         }
 
         if (!p->need_wakeup) {
-            MP_STATS(ao, "start audio wait");
+            MP_STATS_START(ao, "audio wait");
             if (!p->wait_on_ao || p->paused) {
                 // Avoid busy waiting, because the audio API will still report
                 // that it needs new data, even if we're not ready yet, or if
@@ -356,7 +358,7 @@ static void *playthread(void *arg)
                     mpthread_cond_timedwait_rel(&p->wakeup, &p->lock, timeout);
                 }
             }
-            MP_STATS(ao, "end audio wait");
+            MP_STATS_END(ao, "audio wait");
         }
         p->need_wakeup = false;
     }
@@ -29,16 +29,24 @@ struct encode_opts {
     int video_first;
     int audio_first;
     int metadata;
+    char **renditions;
+    char *vaapi_device;
 };
 
 // interface for mplayer.c
 struct encode_lavc_context *encode_lavc_init(struct encode_opts *options,
                                              struct mpv_global *global);
+struct encode_lavc_context *encode_lavc_init_rendition(struct encode_opts *options,
+                                                       const char *spec,
+                                                       struct mpv_global *global);
 void encode_lavc_finish(struct encode_lavc_context *ctx);
 void encode_lavc_free(struct encode_lavc_context *ctx);
 void encode_lavc_discontinuity(struct encode_lavc_context *ctx);
 bool encode_lavc_showhelp(struct mp_log *log, struct encode_opts *options);
 int encode_lavc_getstatus(struct encode_lavc_context *ctx, char *buf, int bufsize, float relative_position);
+bool encode_lavc_get_progress(struct encode_lavc_context *ctx,
+                              float relative_position,
+                              double *out_fps, double *out_eta);
 void encode_lavc_expect_stream(struct encode_lavc_context *ctx, int mt);
 void encode_lavc_set_metadata(struct encode_lavc_context *ctx,
                               struct mp_tags *metadata);
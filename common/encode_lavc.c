@@ -56,11 +56,14 @@ const struct m_sub_options encode_config = {
         OPT_FLAG("ovfirst", video_first, CONF_GLOBAL),
         OPT_FLAG("oafirst", audio_first, CONF_GLOBAL),
         OPT_FLAG("ometadata", metadata, CONF_GLOBAL),
+        OPT_STRINGLIST("orendition*", renditions, CONF_GLOBAL),
+        OPT_STRING("ovaapi-device", vaapi_device, CONF_GLOBAL),
         {0}
     },
     .size = sizeof(struct encode_opts),
     .defaults = &(const struct encode_opts){
         .metadata = 1,
+        .vaapi_device = "/dev/dri/renderD128",
     },
 };
 
@@ -175,6 +178,8 @@ struct encode_lavc_context *encode_lavc_init(struct encode_opts *options,
 
     ctx = talloc_zero(NULL, struct encode_lavc_context);
     pthread_mutex_init(&ctx->lock, NULL);
+    pthread_mutex_init(&ctx->mux_lock, NULL);
+    pthread_cond_init(&ctx->mux_wakeup, NULL);
     ctx->log = mp_log_new(ctx, global->log, "encode-lavc");
     ctx->global = global;
     encode_lavc_discontinuity(ctx);
@@ -219,11 +224,19 @@ struct encode_lavc_context *encode_lavc_init(struct encode_opts *options,
         const char *in = ctx->options->vcodec;
         while (*in) {
             tok = av_get_token(&in, ",");
-            ctx->vc = avcodec_find_encoder_by_name(tok);
+            AVCodec *c = avcodec_find_encoder_by_name(tok);
             av_free(tok);
-            if (ctx->vc && ctx->vc->type != AVMEDIA_TYPE_VIDEO)
-                ctx->vc = NULL;
-            if (ctx->vc)
+            if (c && c->type != AVMEDIA_TYPE_VIDEO)
+                c = NULL;
+            // If a hardware encoder is picked, also remember the next software
+            // encoder, which vo_lavc uses if the device can't be opened.
+            if (c && !ctx->vc) {
+                ctx->vc = c;
+            } else if (c && !encode_lavc_is_vaapi_encoder(c)) {
+                ctx->vc_fallback = c;
+            }
+            if (ctx->vc && (ctx->vc_fallback ||
+                            !encode_lavc_is_vaapi_encoder(ctx->vc)))
                 break;
             if (*in)
                 ++in;
@@ -275,6 +288,77 @@ struct encode_lavc_context *encode_lavc_init(struct encode_opts *options,
     return ctx;
 }
 
+// Create the context for an --orendition entry. The spec has the form
+// "<w>x<h>[/<key>=<value>...]:<file>". The keys "ovc" and "of" override the
+// codec and format of the main output; all other keys are appended to
+// --ovcopts. Renditions contain video only.
+struct encode_lavc_context *encode_lavc_init_rendition(struct encode_opts *options,
+                                                       const char *spec,
+                                                       struct mpv_global *global)
+{
+    struct encode_opts *opts = talloc_ptrtype(NULL, opts);
+    *opts = *options;
+    opts->acodec = NULL;
+    opts->aopts = NULL;
+    opts->renditions = NULL;
+    opts->vopts = NULL;
+    int num_vopts = 0;
+    for (int n = 0; options->vopts && options->vopts[n]; n++)
+        MP_TARRAY_APPEND(opts, opts->vopts, num_vopts,
+                         talloc_strdup(opts, options->vopts[n]));
+
+    struct bstr params, file;
+    if (!bstr_split_tok(bstr0(spec), ":", &params, &file) || !file.len)
+        goto error;
+    opts->file = bstrto0(opts, file);
+
+    struct bstr size = bstr_split(params, "/", &params);
+    struct bstr rest;
+    long long w = bstrtoll(size, &rest, 10);
+    if (!bstr_eatstart0(&rest, "x"))
+        goto error;
+    long long h = bstrtoll(rest, &rest, 10);
+    if (rest.len || w < 0 || h < 0 || w > 16384 || h > 16384 || (!w && !h))
+        goto error;
+
+    while (params.len) {
+        struct bstr item = bstr_split(params, "/", &params);
+        struct bstr key, val;
+        if (!bstr_split_tok(item, "=", &key, &val) || !key.len)
+            goto error;
+        if (bstr_equals0(key, "ovc")) {
+            opts->vcodec = bstrto0(opts, val);
+        } else if (bstr_equals0(key, "of")) {
+            opts->format = bstrto0(opts, val);
+        } else {
+            MP_TARRAY_APPEND(opts, opts->vopts, num_vopts, bstrto0(opts, item));
+        }
+    }
+    MP_TARRAY_APPEND(opts, opts->vopts, num_vopts, NULL);
+
+    struct encode_lavc_context *ctx = encode_lavc_init(opts, global);
+    if (!ctx) {
+        talloc_free(opts);
+        return NULL;
+    }
+    talloc_steal(ctx, opts);
+    ctx->ac = NULL;
+    ctx->rendition_w = w;
+    ctx->rendition_h = h;
+    if (!ctx->vc) {
+        encode_lavc_fail(ctx, "no video codec found for rendition '%s'\n",
+                         opts->file);
+        encode_lavc_free(ctx);
+        return NULL;
+    }
+    return ctx;
+
+error:
+    mp_err(global->log, "Invalid --orendition entry '%s'.\n", spec);
+    talloc_free(opts);
+    return NULL;
+}
+
 void encode_lavc_set_metadata(struct encode_lavc_context *ctx,
                               struct mp_tags *metadata)
 {
@@ -282,6 +366,100 @@ void encode_lavc_set_metadata(struct encode_lavc_context *ctx,
         ctx->metadata = metadata;
 }
 
+// Limits for the packets queued for the mux thread. If they are reached, the
+// encoders wait, so that memory usage stays bounded if the output is slow.
+#define MUX_QUEUE_MAX_PACKETS 512
+#define MUX_QUEUE_MAX_BYTES (64 * 1024 * 1024)
+
+static void *mux_thread(void *ptr)
+{
+    struct encode_lavc_context *ctx = ptr;
+
+    pthread_mutex_lock(&ctx->mux_lock);
+    while (1) {
+        while (!ctx->num_mux_queue && !ctx->mux_terminate)
+            pthread_cond_wait(&ctx->mux_wakeup, &ctx->mux_lock);
+        if (!ctx->num_mux_queue)
+            break;
+        AVPacket packet = ctx->mux_queue[0];
+        MP_TARRAY_REMOVE_AT(ctx->mux_queue, ctx->num_mux_queue, 0);
+        ctx->mux_queue_bytes -= packet.size;
+        pthread_cond_broadcast(&ctx->mux_wakeup);
+
+        bool failed = ctx->mux_failed;
+        pthread_mutex_unlock(&ctx->mux_lock);
+
+        int r = failed ? 0 : av_interleaved_write_frame(ctx->avc, &packet);
+        int64_t pos = ctx->avc->pb ? avio_tell(ctx->avc->pb) : 0;
+        av_free_packet(&packet);
+
+        pthread_mutex_lock(&ctx->mux_lock);
+        if (r < 0) {
+            MP_ERR(ctx, "error writing packet\n");
+            ctx->mux_failed = true;
+            pthread_cond_broadcast(&ctx->mux_wakeup);
+        }
+        ctx->mux_output_size = pos;
+    }
+    pthread_mutex_unlock(&ctx->mux_lock);
+    return NULL;
+}
+
+static void start_mux_thread(struct encode_lavc_context *ctx)
+{
+    // With AVFMT_RAWPICTURE, packets point to the image data, which the
+    // caller frees after writing, so they can't be queued.
+    if (ctx->avc->oformat->flags & AVFMT_RAWPICTURE)
+        return;
+    if (pthread_create(&ctx->mux_thread, NULL, mux_thread, ctx)) {
+        MP_WARN(ctx, "Could not create mux thread.\n");
+        return;
+    }
+    ctx->mux_thread_running = true;
+}
+
+// Write all queued packets and stop the mux thread.
+static void stop_mux_thread(struct encode_lavc_context *ctx)
+{
+    if (!ctx->mux_thread_running)
+        return;
+    pthread_mutex_lock(&ctx->mux_lock);
+    ctx->mux_terminate = true;
+    pthread_cond_broadcast(&ctx->mux_wakeup);
+    pthread_mutex_unlock(&ctx->mux_lock);
+    pthread_join(ctx->mux_thread, NULL);
+    ctx->mux_thread_running = false;
+    talloc_free(ctx->mux_queue);
+    ctx->mux_queue = NULL;
+}
+
+static int queue_packet(struct encode_lavc_context *ctx, AVPacket *packet)
+{
+    AVPacket copy;
+    av_init_packet(&copy);
+    // Makes a copy of the data, unless the packet is refcounted.
+    if (av_packet_ref(&copy, packet) < 0)
+        return -1;
+
+    pthread_mutex_lock(&ctx->mux_lock);
+    while (!ctx->mux_failed && (ctx->num_mux_queue >= MUX_QUEUE_MAX_PACKETS ||
+           ctx->mux_queue_bytes >= MUX_QUEUE_MAX_BYTES))
+        pthread_cond_wait(&ctx->mux_wakeup, &ctx->mux_lock);
+    bool failed = ctx->mux_failed;
+    if (!failed) {
+        MP_TARRAY_APPEND(ctx, ctx->mux_queue, ctx->num_mux_queue, copy);
+        ctx->mux_queue_bytes += copy.size;
+        pthread_cond_broadcast(&ctx->mux_wakeup);
+    }
+    pthread_mutex_unlock(&ctx->mux_lock);
+
+    if (failed) {
+        av_free_packet(&copy);
+        return -1;
+    }
+    return 0;
+}
+
 int encode_lavc_start(struct encode_lavc_context *ctx)
 {
     AVDictionaryEntry *de;
@@ -359,6 +537,8 @@ int encode_lavc_start(struct encode_lavc_context *ctx)
     av_dict_free(&ctx->foptions);
 
     ctx->header_written = 1;
+
+    start_mux_thread(ctx);
     return 1;
 }
 
@@ -371,6 +551,8 @@ void encode_lavc_free(struct encode_lavc_context *ctx)
         encode_lavc_fail(ctx,
                          "called encode_lavc_free without encode_lavc_finish\n");
 
+    pthread_cond_destroy(&ctx->mux_wakeup);
+    pthread_mutex_destroy(&ctx->mux_lock);
     pthread_mutex_destroy(&ctx->lock);
     talloc_free(ctx);
 }
@@ -385,6 +567,8 @@ void encode_lavc_finish(struct encode_lavc_context *ctx)
     if (ctx->finished)
         return;
 
+    stop_mux_thread(ctx);
+
     if (ctx->avc) {
         if (ctx->header_written > 0)
             av_write_trailer(ctx->avc);  // this is allowed to fail
@@ -820,11 +1004,23 @@ int encode_lavc_write_frame(struct encode_lavc_context *ctx, AVPacket *packet)
         break;
     }
 
-    r = av_interleaved_write_frame(ctx->avc, packet);
+    if (ctx->mux_thread_running) {
+        r = queue_packet(ctx, packet);
+    } else {
+        r = av_interleaved_write_frame(ctx->avc, packet);
+    }
 
     return r;
 }
 
+bool encode_lavc_is_vaapi_encoder(const AVCodec *codec)
+{
+    const char *suffix = "_vaapi";
+    size_t len = strlen(codec->name);
+    return len > strlen(suffix) &&
+           strcmp(codec->name + len - strlen(suffix), suffix) == 0;
+}
+
 int encode_lavc_supports_pixfmt(struct encode_lavc_context *ctx,
                                 enum AVPixelFormat pix_fmt)
 {
@@ -1094,7 +1290,13 @@ int encode_lavc_getstatus(struct encode_lavc_context *ctx,
     CHECK_FAIL_UNLOCK(ctx, -1);
 
     minutes = (now - ctx->t0) / 60.0 * (1 - f) / f;
-    megabytes = ctx->avc->pb ? (avio_size(ctx->avc->pb) / 1048576.0 / f) : 0;
+    if (ctx->mux_thread_running) {
+        pthread_mutex_lock(&ctx->mux_lock);
+        megabytes = ctx->mux_output_size / 1048576.0 / f;
+        pthread_mutex_unlock(&ctx->mux_lock);
+    } else {
+        megabytes = ctx->avc->pb ? (avio_size(ctx->avc->pb) / 1048576.0 / f) : 0;
+    }
     fps = ctx->frames / (now - ctx->t0);
     x = ctx->audioseconds / (now - ctx->t0);
     if (ctx->frames)
@@ -1112,6 +1314,33 @@ int encode_lavc_getstatus(struct encode_lavc_context *ctx,
     return 0;
 }
 
+// Report the encoding speed (video frames per second of wallclock time, or
+// 0 if no video is encoded) and the estimated remaining time in seconds.
+// Returns false if not encoding or encoding failed.
+bool encode_lavc_get_progress(struct encode_lavc_context *ctx,
+                              float relative_position,
+                              double *out_fps, double *out_eta)
+{
+    if (!ctx)
+        return false;
+
+    pthread_mutex_lock(&ctx->lock);
+
+    // Not CHECK_FAIL_UNLOCK: this is polled by clients and must not spam.
+    if (ctx->failed || ctx->finished) {
+        pthread_mutex_unlock(&ctx->lock);
+        return false;
+    }
+
+    double elapsed = FFMAX(1e-6, mp_time_sec() - ctx->t0);
+    float f = FFMAX(0.0001, relative_position);
+    *out_fps = ctx->frames / elapsed;
+    *out_eta = relative_position > 0 ? elapsed * (1 - f) / f : -1;
+
+    pthread_mutex_unlock(&ctx->lock);
+    return true;
+}
+
 void encode_lavc_expect_stream(struct encode_lavc_context *ctx, int mt)
 {
     pthread_mutex_lock(&ctx->lock);
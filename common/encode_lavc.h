@@ -47,10 +47,14 @@ struct encode_lavc_context {
 
     float vo_fps;
 
+    // for --orendition outputs: size the video is scaled to (0 if unset)
+    int rendition_w, rendition_h;
+
     // these are processed from the options
     AVFormatContext *avc;
     AVRational timebase;
     AVCodec *vc;
+    AVCodec *vc_fallback; // software encoder listed after a VAAPI one in --ovc
     AVCodec *ac;
     AVDictionary *foptions;
     AVDictionary *aoptions;
@@ -86,6 +90,22 @@ struct encode_lavc_context {
     // has encoding failed?
     bool failed;
     bool finished;
+
+    // Mux thread: encode_lavc_write_frame() queues packets, and the thread
+    // writes them with av_interleaved_write_frame(). This way, the video and
+    // audio encoders don't wait for each other's muxing (or the disk).
+    // All fields below are protected by mux_lock, not lock. While the thread
+    // runs, only it accesses avc.
+    pthread_mutex_t mux_lock;
+    pthread_cond_t mux_wakeup;
+    pthread_t mux_thread;
+    bool mux_thread_running;
+    bool mux_terminate;
+    bool mux_failed;
+    AVPacket *mux_queue;
+    int num_mux_queue;
+    size_t mux_queue_bytes;
+    int64_t mux_output_size;    // output file position after the last write
 };
 
 // interface for vo/ao drivers
@@ -93,6 +113,7 @@ AVStream *encode_lavc_alloc_stream(struct encode_lavc_context *ctx, enum AVMedia
 void encode_lavc_write_stats(struct encode_lavc_context *ctx, AVStream *stream);
 int encode_lavc_write_frame(struct encode_lavc_context *ctx, AVPacket *packet);
 int encode_lavc_supports_pixfmt(struct encode_lavc_context *ctx, enum AVPixelFormat format);
+bool encode_lavc_is_vaapi_encoder(const AVCodec *codec);
 AVCodec *encode_lavc_get_codec(struct encode_lavc_context *ctx, AVStream *stream);
 int encode_lavc_open_codec(struct encode_lavc_context *ctx, AVStream *stream);
 int encode_lavc_available(struct encode_lavc_context *ctx);
@@ -7,6 +7,7 @@
 struct mpv_global {
     struct MPOpts *opts;
     struct mp_log *log;
+    struct m_config *config;
 };
 
 #endif
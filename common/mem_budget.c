@@ -0,0 +1,408 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The registry is process-wide, like the users it tracks (e.g. the image pool
+// lock is global too). The usage is pushed by the owners with atomic stores,
+// so reporting never takes a lock. Trim requests go the other way, through
+// the user's callback, and are rate limited to one per MEM_TRIM_INTERVAL.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "talloc.h"
+
+#include "common/common.h"
+#include "osdep/atomics.h"
+#include "osdep/io.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
+
+#ifdef __MINGW32__
+#include <windows.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include "mem_budget.h"
+
+// How often the budget is checked without pressure events (seconds).
+#define MEM_CHECK_INTERVAL 1.0
+// Min. time between two trim requests (seconds).
+#define MEM_TRIM_INTERVAL 2.0
+// Usage over budget at which trimming becomes hard (in 1/n of the budget).
+#define MEM_HARD_EXCESS 4
+
+// PSI trigger: notify if tasks were stalled on memory for 200ms within 2s.
+// Unprivileged processes can only use windows which are multiples of 2s.
+#define PSI_FILE "/proc/pressure/memory"
+#define PSI_TRIGGER "some 200000 2000000"
+// "full avg10" percentage (all tasks stalled) at which trimming is hard.
+#define PSI_HARD_FULL 5.0
+
+struct mp_mem_user {
+    const char *name;
+    mp_mem_trim_cb trim;
+    void *ctx;
+    atomic_llong usage;
+};
+
+static pthread_mutex_t reg_lock = PTHREAD_MUTEX_INITIALIZER;
+// Serializes mp_mem_monitor_start/stop, so the thread can be joined without
+// holding reg_lock.
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mp_mem_user **users;
+static int num_users;
+
+// Monitor state, protected by reg_lock.
+static struct {
+    int refcount;
+    bool running;
+    bool terminate;
+    pthread_t thread;
+    int64_t budget;
+    bool pressure;
+#ifdef __MINGW32__
+    pthread_cond_t wakeup;
+#else
+    int wakeup_pipe[2];
+#endif
+} mon = {
+#ifdef __MINGW32__
+    .wakeup = PTHREAD_COND_INITIALIZER,
+#endif
+};
+
+static void destroy_user(void *ptr)
+{
+    struct mp_mem_user *u = ptr;
+    pthread_mutex_lock(&reg_lock);
+    for (int n = 0; n < num_users; n++) {
+        if (users[n] == u) {
+            MP_TARRAY_REMOVE_AT(users, num_users, n);
+            break;
+        }
+    }
+    if (!num_users) {
+        talloc_free(users);
+        users = NULL;
+    }
+    pthread_mutex_unlock(&reg_lock);
+}
+
+struct mp_mem_user *mp_mem_user_new(void *ta_parent, const char *name,
+                                    mp_mem_trim_cb trim, void *ctx)
+{
+    struct mp_mem_user *u = talloc_ptrtype(ta_parent, u);
+    *u = (struct mp_mem_user){
+        .name = name,
+        .trim = trim,
+        .ctx = ctx,
+    };
+    talloc_set_destructor(u, destroy_user);
+    pthread_mutex_lock(&reg_lock);
+    MP_TARRAY_APPEND(NULL, users, num_users, u);
+    pthread_mutex_unlock(&reg_lock);
+    return u;
+}
+
+void mp_mem_user_set_usage(struct mp_mem_user *u, int64_t bytes)
+{
+    if (u)
+        atomic_store(&u->usage, bytes);
+}
+
+// Called locked.
+static int64_t get_usage(const char *name)
+{
+    int64_t sum = 0;
+    for (int n = 0; n < num_users; n++) {
+        if (!name || strcmp(users[n]->name, name) == 0)
+            sum += atomic_load(&users[n]->usage);
+    }
+    return sum;
+}
+
+int64_t mp_mem_get_usage(const char *name)
+{
+    pthread_mutex_lock(&reg_lock);
+    int64_t sum = get_usage(name);
+    pthread_mutex_unlock(&reg_lock);
+    return sum;
+}
+
+int64_t mp_mem_get_budget(void)
+{
+    pthread_mutex_lock(&reg_lock);
+    int64_t budget = mon.refcount ? mon.budget : 0;
+    pthread_mutex_unlock(&reg_lock);
+    return budget;
+}
+
+static int compare_usage(const void *pa, const void *pb)
+{
+    int64_t a = atomic_load(&(*(struct mp_mem_user **)pa)->usage);
+    int64_t b = atomic_load(&(*(struct mp_mem_user **)pb)->usage);
+    return a < b ? 1 : (a > b ? -1 : 0);
+}
+
+// Ask the largest users to trim, until they are expected to free at least
+// excess bytes (assuming a soft trim frees half of the usage). Called locked.
+static void request_trim(enum mp_mem_trim level, int64_t excess)
+{
+    if (!num_users)
+        return;
+    struct mp_mem_user **order = talloc_memdup(NULL, users,
+                                               num_users * sizeof(users[0]));
+    qsort(order, num_users, sizeof(order[0]), compare_usage);
+    for (int n = 0; n < num_users && excess > 0; n++) {
+        struct mp_mem_user *u = order[n];
+        if (!u->trim)
+            continue;
+        int64_t usage = atomic_load(&u->usage);
+        u->trim(u->ctx, level);
+        excess -= level == MP_MEM_TRIM_HARD ? usage : usage / 2;
+    }
+    talloc_free(order);
+}
+
+#if defined(__linux__) && !defined(__MINGW32__)
+
+static int open_psi(void)
+{
+    int fd = open(PSI_FILE, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    if (write(fd, PSI_TRIGGER, strlen(PSI_TRIGGER) + 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Classify a PSI event by the share of time all tasks were stalled.
+static enum mp_mem_trim psi_level(void)
+{
+    enum mp_mem_trim level = MP_MEM_TRIM_SOFT;
+    FILE *f = fopen(PSI_FILE, "re");
+    if (!f)
+        return level;
+    char line[256];
+    double avg10;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "full avg10=%lf", &avg10) == 1 && avg10 >= PSI_HARD_FULL)
+            level = MP_MEM_TRIM_HARD;
+    }
+    fclose(f);
+    return level;
+}
+
+#else
+
+static int open_psi(void)
+{
+    return -1;
+}
+
+static enum mp_mem_trim psi_level(void)
+{
+    return MP_MEM_TRIM_SOFT;
+}
+
+#endif
+
+#ifdef __MINGW32__
+
+struct pressure_source {
+    HANDLE low_memory;
+};
+
+static const struct pressure_source pressure_none = {0};
+
+static void pressure_open(struct pressure_source *p)
+{
+    p->low_memory = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+}
+
+static void pressure_close(struct pressure_source *p)
+{
+    if (p->low_memory)
+        CloseHandle(p->low_memory);
+    p->low_memory = NULL;
+}
+
+// Called locked; waits with the lock released.
+static enum mp_mem_trim pressure_wait(struct pressure_source *p, double timeout)
+{
+    mpthread_cond_timedwait_rel(&mon.wakeup, &reg_lock, timeout);
+    BOOL low = FALSE;
+    if (p->low_memory && QueryMemoryResourceNotification(p->low_memory, &low) && low)
+        return MP_MEM_TRIM_HARD;
+    return MP_MEM_TRIM_NONE;
+}
+
+#else
+
+struct pressure_source {
+    int psi_fd;
+};
+
+static const struct pressure_source pressure_none = {.psi_fd = -1};
+
+static void pressure_open(struct pressure_source *p)
+{
+    p->psi_fd = open_psi();
+}
+
+static void pressure_close(struct pressure_source *p)
+{
+    if (p->psi_fd >= 0)
+        close(p->psi_fd);
+    p->psi_fd = -1;
+}
+
+// Called locked; waits with the lock released.
+static enum mp_mem_trim pressure_wait(struct pressure_source *p, double timeout)
+{
+    struct pollfd fds[2] = {
+        { .fd = mon.wakeup_pipe[0], .events = POLLIN },
+        { .fd = p->psi_fd, .events = POLLPRI },
+    };
+    int num_fds = p->psi_fd >= 0 ? 2 : 1;
+    pthread_mutex_unlock(&reg_lock);
+    poll(fds, num_fds, timeout * 1000);
+    enum mp_mem_trim level = MP_MEM_TRIM_NONE;
+    if (fds[0].revents & POLLIN) {
+        char buf[100];
+        (void)read(mon.wakeup_pipe[0], buf, sizeof(buf));
+    }
+    if (num_fds > 1 && (fds[1].revents & POLLERR)) {
+        // The trigger is gone (e.g. the cgroup was removed).
+        pressure_close(p);
+    } else if (num_fds > 1 && (fds[1].revents & POLLPRI)) {
+        level = psi_level();
+    }
+    pthread_mutex_lock(&reg_lock);
+    return level;
+}
+
+#endif
+
+static void *monitor_thread(void *arg)
+{
+    struct pressure_source pressure = pressure_none;
+    bool pressure_opened = false;
+    double last_trim = 0;
+
+    pthread_mutex_lock(&reg_lock);
+    while (!mon.terminate) {
+        if (mon.pressure != pressure_opened) {
+            if (mon.pressure) {
+                pressure_open(&pressure);
+            } else {
+                pressure_close(&pressure);
+            }
+            pressure_opened = mon.pressure;
+        }
+
+        enum mp_mem_trim level = pressure_wait(&pressure, MEM_CHECK_INTERVAL);
+        if (mon.terminate)
+            break;
+
+        int64_t excess = level ? INT64_MAX : 0;
+        int64_t usage = get_usage(NULL);
+        if (mon.budget > 0 && usage > mon.budget) {
+            excess = MPMAX(excess, usage - mon.budget);
+            if (usage - mon.budget > mon.budget / MEM_HARD_EXCESS) {
+                level = MP_MEM_TRIM_HARD;
+            } else {
+                level = MPMAX(level, MP_MEM_TRIM_SOFT);
+            }
+        }
+
+        double now = mp_time_sec();
+        if (level && now - last_trim >= MEM_TRIM_INTERVAL) {
+            request_trim(level, excess);
+            last_trim = now;
+        }
+    }
+    pthread_mutex_unlock(&reg_lock);
+
+    if (pressure_opened)
+        pressure_close(&pressure);
+    return NULL;
+}
+
+void mp_mem_monitor_start(int64_t budget, bool pressure)
+{
+    pthread_mutex_lock(&start_lock);
+    pthread_mutex_lock(&reg_lock);
+    mon.refcount++;
+    mon.budget = budget;
+    mon.pressure = pressure;
+    if (!mon.running && (budget > 0 || pressure)) {
+        mon.terminate = false;
+#ifndef __MINGW32__
+        if (mp_make_wakeup_pipe(mon.wakeup_pipe) < 0)
+            goto done;
+#endif
+        mon.running = !pthread_create(&mon.thread, NULL, monitor_thread, NULL);
+#ifndef __MINGW32__
+        if (!mon.running) {
+            close(mon.wakeup_pipe[0]);
+            close(mon.wakeup_pipe[1]);
+        }
+#endif
+    }
+#ifndef __MINGW32__
+done:
+#endif
+    pthread_mutex_unlock(&reg_lock);
+    pthread_mutex_unlock(&start_lock);
+}
+
+void mp_mem_monitor_stop(void)
+{
+    pthread_mutex_lock(&start_lock);
+    pthread_mutex_lock(&reg_lock);
+    bool join = --mon.refcount == 0 && mon.running;
+    if (join) {
+        mon.terminate = true;
+#ifdef __MINGW32__
+        pthread_cond_signal(&mon.wakeup);
+#else
+        (void)write(mon.wakeup_pipe[1], &(char){0}, 1);
+#endif
+    }
+    pthread_mutex_unlock(&reg_lock);
+
+    if (join) {
+        pthread_join(mon.thread, NULL);
+#ifndef __MINGW32__
+        close(mon.wakeup_pipe[0]);
+        close(mon.wakeup_pipe[1]);
+#endif
+        pthread_mutex_lock(&reg_lock);
+        mon.running = false;
+        pthread_mutex_unlock(&reg_lock);
+    }
+    pthread_mutex_unlock(&start_lock);
+}
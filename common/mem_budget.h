@@ -0,0 +1,45 @@
+#ifndef MP_MEM_BUDGET_H_
+#define MP_MEM_BUDGET_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Process-wide registry of caches and pools. Each registered user reports how
+// much memory it holds. A monitor thread compares the sum against
+// --memory-budget, watches the OS memory pressure signals (Linux PSI, Windows
+// low-memory notification), and asks the users to trim themselves.
+
+enum mp_mem_trim {
+    MP_MEM_TRIM_NONE = 0,
+    MP_MEM_TRIM_SOFT,   // drop data that is cheap to get back
+    MP_MEM_TRIM_HARD,   // also drop useful data, and grow less for a while
+};
+
+struct mp_mem_user;
+
+// Called on the monitor thread, with the registry lock held. It must be
+// thread-safe, must not block for long, and must not call mp_mem_* functions.
+// Usually it only records the request and wakes up the owner's thread.
+typedef void (*mp_mem_trim_cb)(void *ctx, enum mp_mem_trim level);
+
+// name must be a static string; users with the same name are summed up in
+// mp_mem_get_usage(). trim can be NULL. Free the user with talloc_free(),
+// which guarantees the callback is not running and won't be called again.
+// Don't free it while holding a lock the callback takes.
+struct mp_mem_user *mp_mem_user_new(void *ta_parent, const char *name,
+                                    mp_mem_trim_cb trim, void *ctx);
+
+// Lock-free; can be called from any thread. u==NULL is ignored.
+void mp_mem_user_set_usage(struct mp_mem_user *u, int64_t bytes);
+
+// Sum of the usage of all users with the given name (all users if NULL).
+int64_t mp_mem_get_usage(const char *name);
+
+// Start/stop the monitor for a player instance (calls are reference counted).
+// budget is in bytes (0 for none). With several instances, the values passed
+// most recently are used.
+void mp_mem_monitor_start(int64_t budget, bool pressure);
+void mp_mem_monitor_stop(void);
+int64_t mp_mem_get_budget(void);
+
+#endif
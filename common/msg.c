@@ -39,6 +39,7 @@
 
 #include "msg.h"
 #include "msg_control.h"
+#include "stats.h"
 
 /* maximum message length of mp_msg */
 #define MSGSIZE_MAX 6144
@@ -54,12 +55,16 @@ struct mp_log_root {
     bool header;        // indicate that message header should be printed
     int blank_lines;    // number of lines useable by status
     int status_lines;   // number of current status lines
+    char *status;       // text of the current status lines (for termosd)
     bool color;
     int verbose;
     bool force_stderr;
+    // --- protected by mp_msg_lock and mp_msg_buffers_lock (either lock is
+    //     enough for reading)
     struct mp_log_buffer **buffers;
     int num_buffers;
-    FILE *stats_file;
+    // --- protected by mp_msg_lock
+    bool stats_enabled; // --dump-stats file opened by this instance
     // --- semi-atomic access
     bool mute;
     // --- must be accessed atomically
@@ -88,6 +93,9 @@ struct mp_log_buffer {
 
 // Protects some (not all) state in mp_log_root
 static pthread_mutex_t mp_msg_lock = PTHREAD_MUTEX_INITIALIZER;
+// Serializes writers to the log buffers. Separate from mp_msg_lock, so that
+// threads logging to a client don't wait for terminal output.
+static pthread_mutex_t mp_msg_buffers_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static const struct mp_log null_log = {0};
 struct mp_log *const mp_null_log = (struct mp_log *)&null_log;
@@ -119,7 +127,7 @@ static void update_loglevel(struct mp_log *log)
     }
     for (int n = 0; n < log->root->num_buffers; n++)
         log->level = MPMAX(log->level, log->root->buffers[n]->level);
-    if (log->root->stats_file)
+    if (log->root->stats_enabled)
         log->level = MPMAX(log->level, MSGL_STATS);
     atomic_store(&log->reload_counter, atomic_load(&log->root->reload_counter));
     pthread_mutex_unlock(&mp_msg_lock);
@@ -170,6 +178,75 @@ static void prepare_status_line(struct mp_log_root *root, char *new_status)
     root->blank_lines = MPMAX(root->blank_lines, new_lines);
 }
 
+// Update the status line by rewriting only the changed parts of each line,
+// using cursor movement codes. Returns false if the whole status must be
+// redrawn instead: the number of lines changed, or the text contains
+// characters whose terminal width is not known (non-ASCII, control codes), or
+// a line might wrap.
+static bool update_status_line_diff(struct mp_log_root *root,
+                                    const char *new_status)
+{
+    const char *old = root->status;
+    if (!old || !root->status_lines)
+        return false;
+
+    int term_w = 0, term_h = 0;
+    terminal_get_size(&term_w, &term_h);
+    if (term_w <= 0)
+        return false;
+
+    const char *texts[2] = {old, new_status};
+    for (int t = 0; t < 2; t++) {
+        int lines = 1, col = 0;
+        for (const char *s = texts[t]; *s; s++) {
+            if (*s == '\n') {
+                lines++;
+                col = 0;
+            } else if (*s < 32 || *s >= 127 || ++col >= term_w) {
+                return false;
+            }
+        }
+        if (lines != root->status_lines)
+            return false;
+    }
+
+    FILE *f = stderr;
+    // The cursor is at the start of the last line.
+    int cur = root->status_lines - 1;
+    for (int line = 0; line < root->status_lines; line++) {
+        int old_len = strcspn(old, "\n");
+        int new_len = strcspn(new_status, "\n");
+        int start = 0;
+        while (start < old_len && start < new_len &&
+               old[start] == new_status[start])
+            start++;
+        int end = new_len;
+        if (old_len == new_len) {
+            while (end > start && old[end - 1] == new_status[end - 1])
+                end--;
+        }
+        if (start < end || new_len < old_len) {
+            if (line < cur)
+                fprintf(f, "\033[%dA", cur - line);
+            if (line > cur)
+                fprintf(f, "\033[%dB", line - cur);
+            cur = line;
+            fprintf(f, "\r");
+            if (start)
+                fprintf(f, "\033[%dC", start);
+            fwrite(new_status + start, end - start, 1, f);
+            if (new_len < old_len)
+                fprintf(f, "\033[K");
+        }
+        old += old_len + (old[old_len] ? 1 : 0);
+        new_status += new_len + (new_status[new_len] ? 1 : 0);
+    }
+    if (cur < root->status_lines - 1)
+        fprintf(f, "\033[%dB", root->status_lines - 1 - cur);
+    fprintf(f, "\r");
+    return true;
+}
+
 static void flush_status_line(struct mp_log_root *root)
 {
     // If there was a status line, don't overwrite it, but skip it.
@@ -177,6 +254,8 @@ static void flush_status_line(struct mp_log_root *root)
         fprintf(stderr, "\n");
     root->status_lines = 0;
     root->blank_lines = 0;
+    talloc_free(root->status);
+    root->status = NULL;
 }
 
 void mp_msg_flush_status_line(struct mpv_global *global)
@@ -252,6 +331,15 @@ static void print_msg_on_terminal(struct mp_log *log, int lev, char *text)
         if (!text[0] && !root->status_lines)
             return;
         if (root->termosd) {
+            bool diff = !prefix && !root->show_time &&
+                        update_status_line_diff(root, text);
+            talloc_free(root->status);
+            root->status = talloc_strdup(root, text);
+            if (diff) {
+                root->header = true;
+                fflush(stderr);
+                return;
+            }
             prepare_status_line(root, text);
             terminate = "\r";
         } else {
@@ -299,24 +387,42 @@ static void print_msg_on_terminal(struct mp_log *log, int lev, char *text)
     fflush(stream);
 }
 
+// Allocate the entry and both strings as a single block.
+static struct mp_log_buffer_entry *new_entry(const char *prefix,
+                                             size_t prefix_len, int lev,
+                                             const char *text, size_t text_len)
+{
+    struct mp_log_buffer_entry *entry =
+        talloc_size(NULL, sizeof(*entry) + prefix_len + 1 + text_len + 1);
+    char *p = (char *)(entry + 1);
+    *entry = (struct mp_log_buffer_entry) {
+        .prefix = p,
+        .level = lev,
+        .text = p + prefix_len + 1,
+    };
+    memcpy(entry->prefix, prefix, prefix_len + 1);
+    memcpy(entry->text, text, text_len + 1);
+    return entry;
+}
+
 static void write_msg_to_buffers(struct mp_log *log, int lev, char *text)
 {
     struct mp_log_root *root = log->root;
+    size_t prefix_len = strlen(log->verbose_prefix);
+    size_t text_len = strlen(text);
     for (int n = 0; n < root->num_buffers; n++) {
         struct mp_log_buffer *buffer = root->buffers[n];
         if (lev <= buffer->level) {
-            // Assuming a single writer (serialized by msg lock)
+            // Assuming a single writer (serialized by mp_msg_buffers_lock)
             int avail = mp_ring_available(buffer->ring) / sizeof(void *);
             if (avail < 1)
                 continue;
-            struct mp_log_buffer_entry *entry = talloc_ptrtype(NULL, entry);
+            struct mp_log_buffer_entry *entry;
             if (avail > 1) {
-                *entry = (struct mp_log_buffer_entry) {
-                    .prefix = talloc_strdup(entry, log->verbose_prefix),
-                    .level = lev,
-                    .text = talloc_strdup(entry, text),
-                };
+                entry = new_entry(log->verbose_prefix, prefix_len, lev,
+                                  text, text_len);
             } else {
+                entry = talloc_ptrtype(NULL, entry);
                 // write overflow message to signal that messages might be lost
                 *entry = (struct mp_log_buffer_entry) {
                     .prefix = "overflow",
@@ -331,22 +437,12 @@ static void write_msg_to_buffers(struct mp_log *log, int lev, char *text)
     }
 }
 
-static void dump_stats(struct mp_log *log, int lev, char *text)
-{
-    struct mp_log_root *root = log->root;
-    if (lev == MSGL_STATS && root->stats_file) {
-        fprintf(root->stats_file, "%"PRId64" %s #%s\n", mp_time_us(), text,
-                log->verbose_prefix);
-    }
-}
-
 void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
 {
     if (!mp_msg_test(log, lev))
         return; // do not display
 
-    pthread_mutex_lock(&mp_msg_lock);
-
+    // Format without holding any lock.
     char tmp[MSGSIZE_MAX];
     if (vsnprintf(tmp, MSGSIZE_MAX, format, va) < 0)
         snprintf(tmp, MSGSIZE_MAX, "[fprintf error]\n");
@@ -354,11 +450,17 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
     tmp[MSGSIZE_MAX - 1] = 0;
     char *text = tmp;
 
-    print_msg_on_terminal(log, lev, text);
-    write_msg_to_buffers(log, lev, text);
-    dump_stats(log, lev, text);
+    if (lev <= log->terminal_level) {
+        pthread_mutex_lock(&mp_msg_lock);
+        print_msg_on_terminal(log, lev, text);
+        pthread_mutex_unlock(&mp_msg_lock);
+    }
 
-    pthread_mutex_unlock(&mp_msg_lock);
+    if (log->root->num_buffers) {
+        pthread_mutex_lock(&mp_msg_buffers_lock);
+        write_msg_to_buffers(log, lev, text);
+        pthread_mutex_unlock(&mp_msg_buffers_lock);
+    }
 }
 
 // Create a new log context, which uses talloc_ctx as talloc parent, and parent
@@ -465,8 +567,8 @@ void mp_msg_force_stderr(struct mpv_global *global, bool force_stderr)
 void mp_msg_uninit(struct mpv_global *global)
 {
     struct mp_log_root *root = global->log->root;
-    if (root->stats_file)
-        fclose(root->stats_file);
+    if (root->stats_enabled)
+        mp_stats_close();
     talloc_free(root);
     global->log = NULL;
 }
@@ -495,7 +597,9 @@ struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
     if (!buffer->ring)
         abort();
 
+    pthread_mutex_lock(&mp_msg_buffers_lock);
     MP_TARRAY_APPEND(root, root->buffers, root->num_buffers, buffer);
+    pthread_mutex_unlock(&mp_msg_buffers_lock);
 
     atomic_fetch_add(&root->reload_counter, 1);
     pthread_mutex_unlock(&mp_msg_lock);
@@ -509,6 +613,7 @@ void mp_msg_log_buffer_destroy(struct mp_log_buffer *buffer)
         return;
 
     pthread_mutex_lock(&mp_msg_lock);
+    pthread_mutex_lock(&mp_msg_buffers_lock);
 
     struct mp_log_root *root = buffer->root;
     for (int n = 0; n < root->num_buffers; n++) {
@@ -521,6 +626,7 @@ void mp_msg_log_buffer_destroy(struct mp_log_buffer *buffer)
     abort();
 
 found:
+    pthread_mutex_unlock(&mp_msg_buffers_lock);
 
     while (1) {
         struct mp_log_buffer_entry *e = mp_msg_log_buffer_read(buffer);
@@ -554,10 +660,10 @@ int mp_msg_open_stats_file(struct mpv_global *global, const char *path)
 
     pthread_mutex_lock(&mp_msg_lock);
 
-    if (root->stats_file)
-        fclose(root->stats_file);
-    root->stats_file = fopen(path, "wb");
-    r = root->stats_file ? 0 : -1;
+    if (root->stats_enabled)
+        mp_stats_close();
+    r = mp_stats_open(path);
+    root->stats_enabled = r >= 0;
 
     pthread_mutex_unlock(&mp_msg_lock);
 
@@ -75,6 +75,14 @@ void playlist_insert(struct playlist *pl, struct playlist_entry *after,
     }
     add->pl = pl;
     talloc_steal(pl, add);
+
+    if (!add->next && !pl->index_stale) {
+        add->pl_index = pl->num_entries;
+        MP_TARRAY_APPEND(pl, pl->entries, pl->num_entries, add);
+    } else {
+        pl->num_entries++;
+        pl->index_stale = true;
+    }
 }
 
 void playlist_add(struct playlist *pl, struct playlist_entry *add)
@@ -101,11 +109,33 @@ static void playlist_unlink(struct playlist *pl, struct playlist_entry *entry)
     } else {
         pl->first = entry->next;
     }
+    // Removing the last entry keeps the index valid.
+    if (!entry->next && !pl->index_stale) {
+        assert(pl->entries[pl->num_entries - 1] == entry);
+    } else {
+        pl->index_stale = true;
+    }
+    pl->num_entries--;
+
     entry->next = entry->prev = NULL;
     // xxx: we'd want to reset the talloc parent of entry
     entry->pl = NULL;
 }
 
+static void update_index(struct playlist *pl)
+{
+    if (!pl->index_stale)
+        return;
+    MP_TARRAY_GROW(pl, pl->entries, pl->num_entries);
+    int n = 0;
+    for (struct playlist_entry *e = pl->first; e; e = e->next) {
+        e->pl_index = n;
+        pl->entries[n++] = e;
+    }
+    assert(n == pl->num_entries);
+    pl->index_stale = false;
+}
+
 void playlist_entry_unref(struct playlist_entry *e)
 {
     e->reserved--;
@@ -150,27 +180,19 @@ void playlist_add_file(struct playlist *pl, const char *filename)
     playlist_add(pl, playlist_entry_new(filename));
 }
 
-static int playlist_count(struct playlist *pl)
-{
-    int c = 0;
-    for (struct playlist_entry *e = pl->first; e; e = e->next)
-        c++;
-    return c;
-}
-
 void playlist_shuffle(struct playlist *pl)
 {
     struct playlist_entry *save_current = pl->current;
     bool save_replaced = pl->current_was_replaced;
-    int count = playlist_count(pl);
+    int count = pl->num_entries;
     struct playlist_entry **arr = talloc_array(NULL, struct playlist_entry *,
                                                count);
     for (int n = 0; n < count; n++) {
         arr[n] = pl->first;
         playlist_unlink(pl, pl->first);
     }
-    for (int n = 0; n < count; n++) {
-        int other = (int)((double)(count) * rand() / (RAND_MAX + 1.0));
+    for (int n = count - 1; n > 0; n--) {
+        int other = (int)((double)(n + 1) * rand() / (RAND_MAX + 1.0));
         struct playlist_entry *tmp = arr[n];
         arr[n] = arr[other];
         arr[other] = tmp;
@@ -237,32 +259,25 @@ void playlist_append_entries(struct playlist *pl, struct playlist *source_pl)
 // Return -1 if e is not on the list, or if e is NULL.
 int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e)
 {
-    struct playlist_entry *cur = pl->first;
-    int pos = 0;
-    if (!e)
+    if (!e || e->pl != pl)
         return -1;
-    while (cur && cur != e) {
-        cur = cur->next;
-        pos++;
-    }
-    return cur == e ? pos : -1;
+    update_index(pl);
+    return e->pl_index;
 }
 
 int playlist_entry_count(struct playlist *pl)
 {
-    return playlist_entry_to_index(pl, pl->last) + 1;
+    return pl->num_entries;
 }
 
 // Return entry for which playlist_entry_to_index() would return index.
 // Return NULL if not found.
 struct playlist_entry *playlist_entry_from_index(struct playlist *pl, int index)
 {
-    struct playlist_entry *e = pl->first;
-    for (int n = 0; ; n++) {
-        if (!e || n == index)
-            return e;
-        e = e->next;
-    }
+    if (index < 0 || index >= pl->num_entries)
+        return NULL;
+    update_index(pl);
+    return pl->entries[index];
 }
 
 struct playlist *playlist_parse_file(const char *file, struct mpv_global *global)
@@ -28,6 +28,8 @@ struct playlist_param {
 struct playlist_entry {
     struct playlist_entry *prev, *next;
     struct playlist *pl;
+    // Position in pl (valid only if !pl->index_stale)
+    int pl_index;
 
     char *filename;
 
@@ -62,6 +64,12 @@ struct playlist {
     // current_was_replaced is set to true.
     struct playlist_entry *current;
     bool current_was_replaced;
+
+    // Index of the list for O(1) access by position. Appending keeps it
+    // valid; other changes mark it stale, and it's rebuilt on the next query.
+    struct playlist_entry **entries;
+    int num_entries;
+    bool index_stale;
 };
 
 void playlist_entry_add_param(struct playlist_entry *e, bstr name, bstr value);
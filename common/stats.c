@@ -0,0 +1,323 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Each thread that records an event gets its own SPSC ring buffer of fixed
+// size records. A background thread periodically drains all buffers and
+// writes them to the --dump-stats file. The tracer is process-wide; only one
+// file can be open at a time.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "talloc.h"
+
+#include "common/common.h"
+#include "misc/ring.h"
+#include "osdep/atomics.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
+
+#include "stats.h"
+
+#define STATS_BUF_RECORDS 4096
+#define STATS_FLUSH_INTERVAL 0.05
+
+enum {
+    TAG_NAME = 1,
+    TAG_THREAD = 2,
+    TAG_EVENT = 3,
+};
+
+struct stats_record {
+    int64_t ts;
+    const char *name;
+    double value;
+    int type;
+};
+
+struct stats_buf {
+    struct mp_ring *ring;
+    uint32_t tid;
+    atomic_bool dead;           // owning thread has exited
+    atomic_ulong dropped;       // records lost because the ring was full
+    // --- only accessed by the flushing side
+    unsigned long dropped_written;
+    bool announced;
+    struct stats_buf *next;
+};
+
+struct stats_name {
+    const char *name;
+    uint32_t id;
+};
+
+// Set only while a file is open and the flush thread runs.
+static atomic_bool stats_enabled;
+
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+
+// Protects everything below.
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stats_wakeup = PTHREAD_COND_INITIALIZER;
+static struct stats_buf *stats_bufs;
+static uint32_t stats_next_tid;
+static void *stats_strings;     // interned names (never freed)
+static char **stats_interned;
+static int stats_num_interned;
+static bool stats_quit;
+static pthread_t stats_thread;
+
+// --- only accessed by the flushing side (flush thread, or open/close)
+static FILE *stats_file;
+static struct stats_name *stats_names;
+static int stats_num_names;
+
+static void thread_exit(void *p)
+{
+    struct stats_buf *buf = p;
+    atomic_store(&buf->dead, true);
+}
+
+static void init_key(void)
+{
+    pthread_key_create(&stats_key, thread_exit);
+}
+
+static struct stats_buf *get_thread_buf(void)
+{
+    pthread_once(&stats_once, init_key);
+    struct stats_buf *buf = pthread_getspecific(stats_key);
+    if (buf)
+        return buf;
+
+    pthread_mutex_lock(&stats_lock);
+    buf = talloc_zero(NULL, struct stats_buf);
+    buf->ring = mp_ring_new(buf, STATS_BUF_RECORDS * sizeof(struct stats_record));
+    buf->tid = stats_next_tid++;
+    buf->next = stats_bufs;
+    stats_bufs = buf;
+    pthread_mutex_unlock(&stats_lock);
+
+    pthread_setspecific(stats_key, buf);
+    return buf;
+}
+
+void mp_stats_record(enum mp_stats_type type, const char *name, double value)
+{
+    if (!atomic_load(&stats_enabled))
+        return;
+
+    struct stats_buf *buf = get_thread_buf();
+    struct stats_record rec = {
+        .ts = mp_time_us(),
+        .name = name,
+        .value = value,
+        .type = type,
+    };
+    if (mp_ring_available(buf->ring) < sizeof(rec)) {
+        atomic_fetch_add(&buf->dropped, 1);
+        return;
+    }
+    mp_ring_write(buf->ring, (unsigned char *)&rec, sizeof(rec));
+}
+
+// Return a string equal to name, which stays valid until the process exits.
+// This is slow and meant for event names that are not literals.
+const char *mp_stats_intern(const char *name)
+{
+    pthread_mutex_lock(&stats_lock);
+    char *res = NULL;
+    for (int n = 0; n < stats_num_interned; n++) {
+        if (strcmp(stats_interned[n], name) == 0) {
+            res = stats_interned[n];
+            break;
+        }
+    }
+    if (!res) {
+        if (!stats_strings)
+            stats_strings = talloc_new(NULL);
+        res = talloc_strdup(stats_strings, name);
+        MP_TARRAY_APPEND(stats_strings, stats_interned, stats_num_interned, res);
+    }
+    pthread_mutex_unlock(&stats_lock);
+    return res;
+}
+
+static void write_u8(unsigned int v)
+{
+    fputc(v & 0xFF, stats_file);
+}
+
+static void write_u32(uint32_t v)
+{
+    for (int n = 0; n < 4; n++)
+        write_u8(v >> (n * 8));
+}
+
+static void write_u64(uint64_t v)
+{
+    for (int n = 0; n < 8; n++)
+        write_u8(v >> (n * 8));
+}
+
+static void write_double(double v)
+{
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    write_u64(u);
+}
+
+static uint32_t get_name_id(const char *name)
+{
+    for (int n = 0; n < stats_num_names; n++) {
+        if (stats_names[n].name == name)
+            return stats_names[n].id;
+    }
+    uint32_t id = stats_num_names;
+    struct stats_name entry = {name, id};
+    MP_TARRAY_APPEND(NULL, stats_names, stats_num_names, entry);
+    size_t len = strlen(name);
+    write_u8(TAG_NAME);
+    write_u32(id);
+    write_u32(len);
+    fwrite(name, len, 1, stats_file);
+    return id;
+}
+
+static void write_event(uint32_t tid, int type, const char *name, int64_t ts,
+                        double value)
+{
+    uint32_t id = get_name_id(name);
+    write_u8(TAG_EVENT);
+    write_u8(type);
+    write_u32(tid);
+    write_u32(id);
+    write_u64(ts);
+    write_double(value);
+}
+
+// Must be called with stats_lock held. If stats_file is NULL, the records are
+// discarded.
+static void drain_buffers(void)
+{
+    struct stats_buf **pbuf = &stats_bufs;
+    while (*pbuf) {
+        struct stats_buf *buf = *pbuf;
+        // Check before reading, so that all records of a dead thread are
+        // drained when it is freed.
+        bool dead = atomic_load(&buf->dead);
+        struct stats_record rec;
+        while (mp_ring_read(buf->ring, (unsigned char *)&rec, sizeof(rec))
+               == sizeof(rec))
+        {
+            if (!stats_file)
+                continue;
+            if (!buf->announced) {
+                write_u8(TAG_THREAD);
+                write_u32(buf->tid);
+                buf->announced = true;
+            }
+            write_event(buf->tid, rec.type, rec.name, rec.ts, rec.value);
+        }
+        unsigned long dropped = atomic_load(&buf->dropped);
+        if (stats_file && dropped != buf->dropped_written) {
+            write_event(buf->tid, MP_STATS_T_VALUE, "dropped", mp_time_us(),
+                        dropped);
+            buf->dropped_written = dropped;
+        }
+        if (dead) {
+            *pbuf = buf->next;
+            talloc_free(buf);
+        } else {
+            pbuf = &buf->next;
+        }
+    }
+}
+
+static void *flush_thread(void *p)
+{
+    pthread_mutex_lock(&stats_lock);
+    while (!stats_quit) {
+        drain_buffers();
+        fflush(stats_file);
+        mpthread_cond_timedwait_rel(&stats_wakeup, &stats_lock,
+                                    STATS_FLUSH_INTERVAL);
+    }
+    pthread_mutex_unlock(&stats_lock);
+    return NULL;
+}
+
+// Start writing events to the given file. Fails if another file is open.
+int mp_stats_open(const char *path)
+{
+    pthread_mutex_lock(&stats_lock);
+    if (stats_file) {
+        pthread_mutex_unlock(&stats_lock);
+        return -1;
+    }
+    // Records left over from a previous session.
+    drain_buffers();
+    for (struct stats_buf *buf = stats_bufs; buf; buf = buf->next) {
+        buf->announced = false;
+        buf->dropped_written = atomic_load(&buf->dropped);
+    }
+    stats_file = fopen(path, "wb");
+    if (!stats_file)
+        goto fail;
+    fwrite("mpvstats", 8, 1, stats_file);
+    write_u32(1); // version
+    stats_quit = false;
+    if (pthread_create(&stats_thread, NULL, flush_thread, NULL)) {
+        fclose(stats_file);
+        stats_file = NULL;
+        goto fail;
+    }
+    atomic_store(&stats_enabled, true);
+    pthread_mutex_unlock(&stats_lock);
+    return 0;
+
+fail:
+    pthread_mutex_unlock(&stats_lock);
+    return -1;
+}
+
+void mp_stats_close(void)
+{
+    pthread_mutex_lock(&stats_lock);
+    if (!stats_file) {
+        pthread_mutex_unlock(&stats_lock);
+        return;
+    }
+    atomic_store(&stats_enabled, false);
+    stats_quit = true;
+    pthread_cond_signal(&stats_wakeup);
+    pthread_mutex_unlock(&stats_lock);
+
+    pthread_join(stats_thread, NULL);
+
+    pthread_mutex_lock(&stats_lock);
+    drain_buffers();
+    fclose(stats_file);
+    stats_file = NULL;
+    talloc_free(stats_names);
+    stats_names = NULL;
+    stats_num_names = 0;
+    pthread_mutex_unlock(&stats_lock);
+}
@@ -0,0 +1,40 @@
+#ifndef MP_STATS_H_
+#define MP_STATS_H_
+
+#include <stdbool.h>
+
+#include "common/msg.h"
+
+// Binary trace events for --dump-stats. See TOOLS/stats-conv.py for the file
+// format.
+//
+// Recording an event only writes a fixed size record into a buffer owned by
+// the calling thread; no locks are taken and nothing is formatted. The event
+// name must be a string with static lifetime (usually a literal), or returned
+// by mp_stats_intern().
+
+enum mp_stats_type {
+    MP_STATS_T_START = 1,   // start of the named event
+    MP_STATS_T_END,         // end of the named event
+    MP_STATS_T_VALUE,       // named value
+    MP_STATS_T_EVENT,       // singular event
+};
+
+void mp_stats_record(enum mp_stats_type type, const char *name, double value);
+const char *mp_stats_intern(const char *name);
+
+int mp_stats_open(const char *path);
+void mp_stats_close(void);
+
+// The log level check is cheap and makes sure only player instances that
+// enabled --dump-stats record events.
+#define MP_STATS_RECORD(obj, type, name, value) \
+    (mp_msg_test((obj)->log, MSGL_STATS) ? \
+        mp_stats_record(type, name, value) : (void)0)
+
+#define MP_STATS_START(obj, name)   MP_STATS_RECORD(obj, MP_STATS_T_START, name, 0)
+#define MP_STATS_END(obj, name)     MP_STATS_RECORD(obj, MP_STATS_T_END, name, 0)
+#define MP_STATS_VALUE(obj, name, v) MP_STATS_RECORD(obj, MP_STATS_T_VALUE, name, v)
+#define MP_STATS_EVENT(obj, name)   MP_STATS_RECORD(obj, MP_STATS_T_EVENT, name, 0)
+
+#endif
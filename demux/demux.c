@@ -31,8 +31,11 @@
 #include "config.h"
 #include "options/options.h"
 #include "talloc.h"
+#include "common/mem_budget.h"
 #include "common/msg.h"
 #include "common/global.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
 
 #include "stream/stream.h"
 #include "demux.h"
@@ -97,6 +100,14 @@ struct demux_internal {
     pthread_cond_t wakeup;
     pthread_t thread;
 
+    // While the thread runs, read_cancel replaces stream->cancel (and is
+    // linked to it), so that blocking reads can be aborted for seeks without
+    // aborting everything else using the original stream_cancel.
+    struct mp_cancel *read_cancel;
+    struct mp_cancel *stream_cancel;
+
+    struct mp_mem_user *mem;    // memory budget registration
+
     // -- All the following fields are protected by lock.
 
     bool thread_paused;
@@ -114,6 +125,16 @@ struct demux_internal {
     double min_secs;
     int min_packs;
     int min_bytes;
+    double min_secs_type[STREAM_TYPE_COUNT]; // per-type override, or -1
+    size_t max_bytes;           // budget for all packet queues
+    size_t max_back_bytes;      // see demux_stream.back_head
+    double max_back_secs;
+    size_t max_unselected_bytes; // see ds_wants_packets()
+
+    int mem_trim;               // pending enum mp_mem_trim request
+    double mem_limit_until;     // after a hard trim: mp_time_sec() until
+                                // which the readahead is reduced
+    bool mem_limited;           // mem_limit_until is in the future
 
     bool tracks_switched;       // thread needs to inform demuxer of this
 
@@ -128,6 +149,12 @@ struct demux_internal {
     int64_t stream_cache_size;
     int64_t stream_cache_fill;
     int stream_cache_idle;
+    int64_t stream_cache_speed;
+    int64_t stream_readahead;   // STREAM_CTRL_SET_READAHEAD value to pass on
+    bool stream_readahead_set;  // stream_readahead needs to be passed on
+    struct stream_dvb_stats stream_dvb_stats;
+    bool stream_has_dvb_stats;
+    double last_bitrate;        // last estimate for reader_state.bitrate
 };
 
 struct demux_stream {
@@ -143,8 +170,39 @@ struct demux_stream {
     double last_ts;         // timestamp of the last packet added to queue
     struct demux_packet *head;
     struct demux_packet *tail;
+    // Packets moved from the queue to the user thread in one go, so that
+    // reading them doesn't need to take the lock for each packet. These
+    // fields are accessed by the user thread only (lock not needed). The
+    // packets stay accounted in packs/bytes/base_ts until the user thread
+    // takes the lock again (see ds_sync_batch()).
+    struct demux_packet *batch;
+    size_t consumed_packs;  // returned from batch since the last sync
+    size_t consumed_bytes;
+    double consumed_ts;     // timestamp of the last returned packet
+    // References to packets already returned to the user thread, kept for
+    // seeking back (only if in->max_back_bytes > 0). Accessed by the user
+    // thread only.
+    struct demux_packet *back_head;
+    struct demux_packet *back_tail;
+    size_t back_bytes;
+    // Statistics (see demux_get_stream_stats()). Not reset on seeks.
+    uint64_t total_packs;   // packets added to the queue (in->lock)
+    uint64_t total_bytes;   // (in->lock)
+    double total_secs;      // demuxed duration, gaps skipped (in->lock)
+    // User thread only.
+    uint64_t underruns;     // number of times the queue ran empty
+    bool got_packet;        // a packet was returned since the last flush
+    bool in_underrun;       // consumer is currently waiting for a packet
 };
 
+// Max. number of packets moved to demux_stream.batch at once.
+#define MAX_BATCH_PACKS 32
+
+// After a hard memory trim, the readahead is capped to MEM_LIMIT_SECS for
+// MEM_LIMIT_TIME seconds, and unselected streams are not queued.
+#define MEM_LIMIT_SECS 1.0
+#define MEM_LIMIT_TIME 10.0
+
 // If one of the values is NOPTS, always pick the other one.
 #define MP_PTS_MIN(a, b) ((a) == MP_NOPTS_VALUE || ((a) > (b)) ? (b) : (a))
 #define MP_PTS_MAX(a, b) ((a) == MP_NOPTS_VALUE || ((a) < (b)) ? (b) : (a))
@@ -153,21 +211,70 @@ static void demuxer_sort_chapters(demuxer_t *demuxer);
 static void *demux_thread(void *pctx);
 static void update_cache(struct demux_internal *in);
 
-// called locked
-static void ds_flush(struct demux_stream *ds)
+static void free_packet_list(demux_packet_t *dp)
 {
-    demux_packet_t *dp = ds->head;
     while (dp) {
         demux_packet_t *dn = dp->next;
         free_demux_packet(dp);
         dp = dn;
     }
-    ds->head = ds->tail = NULL;
+}
+
+static double packet_ts(struct demux_packet *dp)
+{
+    return dp->pts == MP_NOPTS_VALUE ? dp->dts : dp->pts;
+}
+
+// called locked, by the user thread
+static void ds_flush(struct demux_stream *ds)
+{
+    free_packet_list(ds->head);
+    free_packet_list(ds->batch);
+    free_packet_list(ds->back_head);
+    ds->head = ds->tail = ds->batch = NULL;
+    ds->back_head = ds->back_tail = NULL;
+    ds->back_bytes = 0;
+    ds->consumed_packs = ds->consumed_bytes = 0;
+    ds->consumed_ts = MP_NOPTS_VALUE;
     ds->packs = 0;
     ds->bytes = 0;
     ds->last_ts = ds->base_ts = MP_NOPTS_VALUE;
     ds->eof = false;
     ds->active = false;
+    ds->got_packet = ds->in_underrun = false;
+}
+
+// Whether the demuxer should read packets for the stream. Unselected audio and
+// subtitle streams keep a small queue (if in->max_unselected_bytes > 0), so
+// that switching to them can start with the queued packets.
+// called locked
+static bool ds_wants_packets(struct demux_stream *ds)
+{
+    return ds->selected ||
+           (ds->in->max_unselected_bytes && ds->type != STREAM_VIDEO &&
+            !ds->in->mem_limited);
+}
+
+// Free the oldest queued packet. Called locked.
+static void ds_drop_head(struct demux_stream *ds)
+{
+    struct demux_packet *dp = ds->head;
+    ds->head = dp->next;
+    if (!ds->head)
+        ds->tail = NULL;
+    ds->packs--;
+    ds->bytes -= dp->len;
+    double ts = packet_ts(dp);
+    if (ts != MP_NOPTS_VALUE)
+        ds->base_ts = ts;
+    free_demux_packet(dp);
+}
+
+// Limit the queue of an unselected stream. Called locked.
+static void ds_trim_unselected(struct demux_stream *ds)
+{
+    while (ds->head && ds->bytes > ds->in->max_unselected_bytes)
+        ds_drop_head(ds);
 }
 
 struct sh_stream *new_sh_stream(demuxer_t *demuxer, enum stream_type type)
@@ -196,6 +303,7 @@ struct sh_stream *new_sh_stream(demuxer_t *demuxer, enum stream_type type)
         .in = demuxer->in,
         .type = sh->type,
         .selected = demuxer->in->autoselect,
+        .consumed_ts = MP_NOPTS_VALUE,
     };
     MP_TARRAY_APPEND(demuxer, demuxer->streams, demuxer->num_streams, sh);
     switch (sh->type) {
@@ -215,6 +323,7 @@ void free_demuxer(demuxer_t *demuxer)
     assert(demuxer == in->d_user);
 
     demux_stop_thread(demuxer);
+    talloc_free(in->mem);
 
     if (demuxer->desc->close)
         demuxer->desc->close(in->d_thread);
@@ -232,9 +341,14 @@ void demux_start_thread(struct demuxer *demuxer)
     assert(demuxer == in->d_user);
 
     if (!in->threading) {
+        struct stream *stream = in->d_thread->stream;
+        in->stream_cancel = stream->cancel;
+        stream->cancel = in->read_cancel;
         in->threading = true;
-        if (pthread_create(&in->thread, NULL, demux_thread, in))
+        if (pthread_create(&in->thread, NULL, demux_thread, in)) {
             in->threading = false;
+            stream->cancel = in->stream_cancel;
+        }
     }
 }
 
@@ -246,11 +360,14 @@ void demux_stop_thread(struct demuxer *demuxer)
     if (in->threading) {
         pthread_mutex_lock(&in->lock);
         in->thread_terminate = true;
+        mp_cancel_trigger(in->read_cancel);
         pthread_cond_signal(&in->wakeup);
         pthread_mutex_unlock(&in->lock);
         pthread_join(in->thread, NULL);
         in->threading = false;
         in->thread_terminate = false;
+        mp_cancel_reset(in->read_cancel);
+        in->d_thread->stream->cancel = in->stream_cancel;
     }
 }
 
@@ -284,7 +401,7 @@ int demux_add_packet(struct sh_stream *stream, demux_packet_t *dp)
     }
     struct demux_internal *in = ds->in;
     pthread_mutex_lock(&in->lock);
-    if (!ds->selected || in->seeking) {
+    if (!ds_wants_packets(ds) || in->seeking) {
         pthread_mutex_unlock(&in->lock);
         talloc_free(dp);
         return 0;
@@ -313,7 +430,13 @@ int demux_add_packet(struct sh_stream *stream, demux_packet_t *dp)
     if (stream->type != STREAM_VIDEO && dp->pts == MP_NOPTS_VALUE)
         dp->pts = dp->dts;
 
+    ds->total_packs++;
+    ds->total_bytes += dp->len;
+
     double ts = dp->dts == MP_NOPTS_VALUE ? dp->pts : dp->dts;
+    if (ts != MP_NOPTS_VALUE && ds->last_ts != MP_NOPTS_VALUE &&
+        ts > ds->last_ts && ts < ds->last_ts + 10)
+        ds->total_secs += ts - ds->last_ts;
     if (ts != MP_NOPTS_VALUE && (ts > ds->last_ts || ts + 10 < ds->last_ts))
         ds->last_ts = ts;
     if (ds->base_ts == MP_NOPTS_VALUE)
@@ -323,6 +446,12 @@ int demux_add_packet(struct sh_stream *stream, demux_packet_t *dp)
            "[num=%zd size=%zd]\n", stream_type_name(stream->type),
            dp->len, dp->pts, dp->dts, dp->pos, ds->packs, ds->bytes);
 
+    if (!ds->selected) {
+        ds_trim_unselected(ds);
+        pthread_mutex_unlock(&in->lock);
+        return 1;
+    }
+
     if (ds->in->wakeup_cb && !ds->head->next)
         ds->in->wakeup_cb(ds->in->wakeup_cb_ctx);
     pthread_cond_signal(&in->wakeup);
@@ -330,29 +459,107 @@ int demux_add_packet(struct sh_stream *stream, demux_packet_t *dp)
     return 1;
 }
 
+// Called if the queue budget is exhausted, but an active stream has no
+// packets (badly interleaved file). Drop the oldest half of the queue of the
+// largest stream the user isn't reading from currently. Returns false if there
+// is no such stream.
+static bool drop_inactive_packets(struct demux_internal *in)
+{
+    struct demux_stream *victim = NULL;
+    for (int n = 0; n < in->d_buffer->num_streams; n++) {
+        struct demux_stream *ds = in->d_buffer->streams[n]->ds;
+        if (!ds->active && ds->head && ds->head->next &&
+            (!victim || ds->bytes > victim->bytes))
+            victim = ds;
+    }
+    if (!victim)
+        return false;
+    MP_WARN(in, "Badly interleaved file: dropping %s packets.\n",
+            stream_type_name(victim->type));
+    // (Packets already moved to the user thread are not in the list.)
+    size_t drop = 0;
+    for (struct demux_packet *dp = victim->head; dp; dp = dp->next)
+        drop++;
+    drop /= 2;
+    for (size_t i = 0; i < drop; i++)
+        ds_drop_head(victim);
+    return drop > 0;
+}
+
+// Handle a memory trim request (see mp_mem_user_new()). Only the queues of
+// unselected streams are dropped, because the packets of selected streams
+// can't be read again without seeking. Called locked.
+static void execute_mem_trim(struct demux_internal *in)
+{
+    if (in->mem_trim == MP_MEM_TRIM_HARD)
+        in->mem_limit_until = mp_time_sec() + MEM_LIMIT_TIME;
+    in->mem_trim = MP_MEM_TRIM_NONE;
+
+    size_t dropped = 0;
+    for (int n = 0; n < in->d_buffer->num_streams; n++) {
+        struct demux_stream *ds = in->d_buffer->streams[n]->ds;
+        if (ds->selected)
+            continue;
+        size_t bytes = ds->bytes;
+        while (ds->head)
+            ds_drop_head(ds);
+        dropped += bytes - ds->bytes;
+    }
+    MP_VERBOSE(in, "Memory trim: dropped %zd KiB of unselected packets.\n",
+               dropped / 1024);
+}
+
+// Called by the memory budget monitor thread.
+static void demux_mem_trim(void *ctx, enum mp_mem_trim level)
+{
+    struct demux_internal *in = ctx;
+    pthread_mutex_lock(&in->lock);
+    in->mem_trim = MPMAX(in->mem_trim, level);
+    pthread_cond_signal(&in->wakeup);
+    pthread_mutex_unlock(&in->lock);
+}
+
 // Returns true if there was "progress" (lock was released temporarily).
 static bool read_packet(struct demux_internal *in)
 {
+    bool was_idle = in->idle;
     in->eof = false;
     in->idle = true;
 
+    if (in->mem_trim)
+        execute_mem_trim(in);
+    in->mem_limited = in->mem_limit_until > mp_time_sec();
+
     // Check if we need to read a new packet. We do this if all queues are below
     // the minimum, or if a stream explicitly needs new packets. Also includes
     // safe-guards against packet queue overflow.
-    bool active = false, read_more = false;
+    bool active = false, read_more = false, starving = false;
     size_t packs = 0, bytes = 0;
     for (int n = 0; n < in->d_buffer->num_streams; n++) {
         struct demux_stream *ds = in->d_buffer->streams[n]->ds;
         active |= ds->active;
-        read_more |= ds->active && !ds->head;
+        starving |= ds->active && !ds->head;
         packs += ds->packs;
         bytes += ds->bytes;
-        if (ds->active && ds->last_ts != MP_NOPTS_VALUE && in->min_secs > 0)
-            read_more |= ds->last_ts - ds->base_ts < in->min_secs;
+        double min_secs = in->min_secs_type[ds->type];
+        if (min_secs < 0)
+            min_secs = in->min_secs;
+        if (in->mem_limited)
+            min_secs = MPMIN(min_secs, MEM_LIMIT_SECS);
+        if (ds->active && ds->last_ts != MP_NOPTS_VALUE && min_secs > 0)
+            read_more |= ds->last_ts - ds->base_ts < min_secs;
     }
+    read_more |= starving;
+    mp_mem_user_set_usage(in->mem, bytes);
     MP_DBG(in, "packets=%zd, bytes=%zd, active=%d, more=%d\n",
            packs, bytes, active, read_more);
-    if (packs >= MAX_PACKS || bytes >= MAX_PACK_BYTES) {
+    if ((packs >= MAX_PACKS || bytes >= in->max_bytes) && starving &&
+        drop_inactive_packets(in))
+    {
+        // Retry with the memory freed.
+        return true;
+    }
+    if (packs >= MAX_PACKS || bytes >= in->max_bytes) {
         if (!in->warned_queue_overflow) {
             in->warned_queue_overflow = true;
             MP_ERR(in, "Too many packets in the demuxer packet queues:\n");
@@ -374,8 +581,13 @@ static bool read_packet(struct demux_internal *in)
     if (packs < in->min_packs && bytes < in->min_bytes)
         read_more |= active;
 
-    if (!read_more)
+    if (!read_more) {
+        // The player polls the reader state (e.g. for cache pausing); tell it
+        // when reading stops, so it doesn't have to poll for that.
+        if (!was_idle && in->wakeup_cb)
+            in->wakeup_cb(in->wakeup_cb_ctx);
         return false;
+    }
 
     // Actually read a packet. Drop the lock while doing so, because waiting
     // for disk or network I/O can take time.
@@ -385,6 +597,11 @@ static bool read_packet(struct demux_internal *in)
     bool eof = !demux->desc->fill_buffer || demux->desc->fill_buffer(demux) <= 0;
     pthread_mutex_lock(&in->lock);
 
+    // A seek was queued meanwhile (and possibly aborted the read), so the EOF
+    // state is meaningless.
+    if (in->seeking)
+        return true;
+
     update_cache(in);
 
     if (eof) {
@@ -406,6 +623,17 @@ static bool read_packet(struct demux_internal *in)
 }
 
 // must be called locked; may temporarily unlock
+// Called by the user thread if the queue is empty while it wants a packet.
+// Only the first time after a packet was returned is counted; the initial
+// queue refill after opening or seeking is not an underrun.
+static void ds_note_underrun(struct demux_stream *ds)
+{
+    if (ds->got_packet && !ds->in_underrun) {
+        ds->underruns++;
+        ds->in_underrun = true;
+    }
+}
+
 static void ds_get_packets(struct demux_stream *ds)
 {
     const char *t = stream_type_name(ds->type);
@@ -413,6 +641,8 @@ static void ds_get_packets(struct demux_stream *ds)
     MP_DBG(in, "reading packet for %s\n", t);
     in->eof = false; // force retry
     ds->eof = false;
+    if (in->threading && ds->selected && !ds->head)
+        ds_note_underrun(ds);
     while (ds->selected && !ds->head && !ds->eof) {
         ds->active = true;
         // Note: the following code marks EOF if it can't continue
@@ -443,6 +673,8 @@ static void execute_seek(struct demux_internal *in)
     int flags = in->seek_flags;
     double pts = in->seek_pts;
     in->seeking = false;
+    // A read interrupted by demux_seek() is done; don't abort the seek itself.
+    mp_cancel_reset(in->read_cancel);
 
     pthread_mutex_unlock(&in->lock);
 
@@ -455,6 +687,8 @@ static void execute_seek(struct demux_internal *in)
 static void *demux_thread(void *pctx)
 {
     struct demux_internal *in = pctx;
+    struct mp_thread_sched_opts *sched = &in->d_thread->opts->demuxer_thread_sched;
+    mpthread_set_sched(in->log, sched->priority, sched->cpu);
     pthread_mutex_lock(&in->lock);
     while (!in->thread_terminate) {
         in->thread_paused = in->thread_request_pause > 0;
@@ -471,6 +705,8 @@ static void *demux_thread(void *pctx)
             execute_seek(in);
             continue;
         }
+        if (in->mem_trim)
+            execute_mem_trim(in);
         if (!in->eof) {
             if (read_packet(in))
                 continue; // read_packet unlocked, so recheck conditions
@@ -483,6 +719,119 @@ static void *demux_thread(void *pctx)
     return NULL;
 }
 
+// Apply the accounting for packets returned from ds->batch. Called locked, by
+// the user thread.
+static void ds_sync_batch(struct demux_stream *ds)
+{
+    ds->packs -= ds->consumed_packs;
+    ds->bytes -= ds->consumed_bytes;
+    if (ds->consumed_ts != MP_NOPTS_VALUE)
+        ds->base_ts = ds->consumed_ts;
+    ds->consumed_packs = ds->consumed_bytes = 0;
+    ds->consumed_ts = MP_NOPTS_VALUE;
+}
+
+// Move queued packets to ds->batch. Called locked, by the user thread.
+static void ds_fill_batch(struct demux_stream *ds)
+{
+    assert(!ds->batch);
+    ds_sync_batch(ds);
+    if (!ds->head)
+        return;
+    struct demux_packet *last = ds->head;
+    for (int n = 1; n < MAX_BATCH_PACKS && last->next; n++)
+        last = last->next;
+    ds->batch = ds->head;
+    ds->head = last->next;
+    last->next = NULL;
+    if (!ds->head)
+        ds->tail = NULL;
+}
+
+// Put the packets not returned from ds->batch yet back into the queue. Called
+// locked, by the user thread.
+static void ds_unbatch(struct demux_stream *ds)
+{
+    ds_sync_batch(ds);
+    if (!ds->batch)
+        return;
+    struct demux_packet *last = ds->batch;
+    while (last->next)
+        last = last->next;
+    last->next = ds->head;
+    if (!ds->head)
+        ds->tail = last;
+    ds->head = ds->batch;
+    ds->batch = NULL;
+}
+
+// Drop the oldest packets from the back buffer until it fits the limits.
+static void ds_trim_back(struct demux_stream *ds)
+{
+    struct demux_internal *in = ds->in;
+    while (ds->back_head) {
+        struct demux_packet *dp = ds->back_head;
+        double end = ds->back_tail ? packet_ts(ds->back_tail) : MP_NOPTS_VALUE;
+        bool too_long = in->max_back_secs > 0 && end != MP_NOPTS_VALUE &&
+                        packet_ts(dp) != MP_NOPTS_VALUE &&
+                        end - packet_ts(dp) > in->max_back_secs;
+        if (ds->back_bytes <= in->max_back_bytes && !too_long)
+            break;
+        ds->back_head = dp->next;
+        if (!ds->back_head)
+            ds->back_tail = NULL;
+        ds->back_bytes -= dp->len;
+        free_demux_packet(dp);
+    }
+}
+
+// Keep a reference to a packet returned to the user thread.
+static void ds_add_back(struct demux_stream *ds, struct demux_packet *pkt)
+{
+    if (!ds->in->max_back_bytes)
+        return;
+    // (demux_copy_packet() only references the data.)
+    struct demux_packet *dp = demux_copy_packet(pkt);
+    if (!dp)
+        return;
+    dp->pos = pkt->pos;
+    dp->keyframe = pkt->keyframe;
+    dp->stream = pkt->stream;
+    dp->next = NULL;
+    if (ds->back_tail) {
+        ds->back_tail->next = dp;
+    } else {
+        ds->back_head = dp;
+    }
+    ds->back_tail = dp;
+    ds->back_bytes += dp->len;
+    ds_trim_back(ds);
+}
+
+// Return a packet from ds->batch. Doesn't need the lock.
+static struct demux_packet *ds_pop_batch(struct demux_stream *ds)
+{
+    struct demux_packet *pkt = ds->batch;
+    if (!pkt)
+        return NULL;
+    ds->batch = pkt->next;
+    pkt->next = NULL;
+    ds->consumed_packs++;
+    ds->consumed_bytes += pkt->len;
+
+    double ts = pkt->dts == MP_NOPTS_VALUE ? pkt->pts : pkt->dts;
+    if (ts != MP_NOPTS_VALUE)
+        ds->consumed_ts = ts;
+
+    if (pkt->pos >= ds->in->d_user->filepos)
+        ds->in->d_user->filepos = pkt->pos;
+
+    ds_add_back(ds, pkt);
+    ds->got_packet = true;
+    ds->in_underrun = false;
+    return pkt;
+}
+
 static struct demux_packet *dequeue_packet(struct demux_stream *ds)
 {
     if (!ds->head)
@@ -503,6 +852,9 @@ static struct demux_packet *dequeue_packet(struct demux_stream *ds)
     if (pkt->pos >= ds->in->d_user->filepos)
         ds->in->d_user->filepos = pkt->pos;
 
+    ds_add_back(ds, pkt);
+    ds->got_packet = true;
+    ds->in_underrun = false;
     return pkt;
 }
 
@@ -513,8 +865,11 @@ struct demux_packet *demux_read_packet(struct sh_stream *sh)
 {
     struct demux_stream *ds = sh ? sh->ds : NULL;
     struct demux_packet *pkt = NULL;
+    if (ds && ds->batch)
+        return ds_pop_batch(ds);
     if (ds) {
         pthread_mutex_lock(&ds->in->lock);
+        ds_sync_batch(ds);
         ds_get_packets(ds);
         pkt = dequeue_packet(ds);
         pthread_cond_signal(&ds->in->wakeup); // possibly read more
@@ -538,10 +893,17 @@ int demux_read_packet_async(struct sh_stream *sh, struct demux_packet **out_pkt)
     int r = -1;
     *out_pkt = NULL;
     if (ds) {
-        if (ds->in->threading) {
+        if (ds->batch) {
+            // Fast path: the packets were already taken from the queue.
+            *out_pkt = ds_pop_batch(ds);
+            r = 1;
+        } else if (ds->in->threading) {
             pthread_mutex_lock(&ds->in->lock);
-            *out_pkt = dequeue_packet(ds);
+            ds_fill_batch(ds);
+            *out_pkt = ds_pop_batch(ds);
             r = *out_pkt ? 1 : (ds->eof ? -1 : 0);
+            if (r == 0)
+                ds_note_underrun(ds);
             ds->active = ds->selected; // enable readahead
             ds->in->eof = false; // force retry
             pthread_cond_signal(&ds->in->wakeup); // possibly read more
@@ -561,6 +923,8 @@ double demux_get_next_pts(struct sh_stream *sh)
 {
     double res = MP_NOPTS_VALUE;
     if (sh) {
+        if (sh->ds->batch)
+            return sh->ds->batch->pts;
         pthread_mutex_lock(&sh->ds->in->lock);
         ds_get_packets(sh->ds);
         if (sh->ds->head)
@@ -576,12 +940,37 @@ bool demux_has_packet(struct sh_stream *sh)
     bool has_packet = false;
     if (sh) {
         pthread_mutex_lock(&sh->ds->in->lock);
-        has_packet = sh->ds->head;
+        has_packet = sh->ds->head || sh->ds->batch;
         pthread_mutex_unlock(&sh->ds->in->lock);
     }
     return has_packet;
 }
 
+// Return statistics about the packet queue of the given stream. Must be called
+// from the user thread (like demux_read_packet()).
+void demux_get_stream_stats(struct sh_stream *sh, struct demux_stream_stats *st)
+{
+    struct demux_stream *ds = sh->ds;
+    pthread_mutex_lock(&ds->in->lock);
+    ds_sync_batch(ds);
+    *st = (struct demux_stream_stats){
+        .queued_packets = ds->packs,
+        .queued_bytes = ds->bytes,
+        .queued_secs = -1,
+        .packets_per_sec = -1,
+        .avg_packet_size = -1,
+        .underruns = ds->underruns,
+    };
+    if (ds->base_ts != MP_NOPTS_VALUE && ds->last_ts != MP_NOPTS_VALUE &&
+        ds->last_ts >= ds->base_ts)
+        st->queued_secs = ds->last_ts - ds->base_ts;
+    if (ds->total_secs > 0)
+        st->packets_per_sec = ds->total_packs / ds->total_secs;
+    if (ds->total_packs)
+        st->avg_packet_size = ds->total_bytes / (double)ds->total_packs;
+    pthread_mutex_unlock(&ds->in->lock);
+}
+
 // Read and return any packet we find.
 struct demux_packet *demux_read_any_packet(struct demuxer *demuxer)
 {
@@ -819,9 +1208,28 @@ static struct demuxer *open_given_type(struct mpv_global *global,
                                             : demuxer->opts->demuxer_min_secs,
         .min_packs = demuxer->opts->demuxer_min_packs,
         .min_bytes = demuxer->opts->demuxer_min_bytes,
+        .max_bytes = demuxer->opts->demuxer_max_bytes,
+        .min_secs_type = {
+            [STREAM_VIDEO] = demuxer->opts->demuxer_min_secs_video,
+            [STREAM_AUDIO] = demuxer->opts->demuxer_min_secs_audio,
+            [STREAM_SUB] = -1,
+        },
+        .max_back_bytes = demuxer->opts->demuxer_back_bytes,
+        .max_back_secs = demuxer->opts->demuxer_back_secs,
+        .max_unselected_bytes = demuxer->opts->demuxer_unselected_bytes,
+        .last_bitrate = -1,
     };
+    if (demuxer->opts->low_latency) {
+        // Read ahead only what is needed to get a packet for every stream.
+        in->min_secs = 0;
+        for (int n = 0; n < STREAM_TYPE_COUNT; n++)
+            in->min_secs_type[n] = -1;
+    }
     pthread_mutex_init(&in->lock, NULL);
     pthread_cond_init(&in->wakeup, NULL);
+    in->read_cancel = mp_cancel_new_linkable(in, stream->cancel);
+    mp_cancel_link(in->read_cancel);
+    in->mem = mp_mem_user_new(NULL, "demuxer", demux_mem_trim, in);
 
     *in->d_thread = *demuxer;
     *in->d_buffer = *demuxer;
@@ -894,8 +1302,9 @@ struct demuxer *demux_open(struct stream *stream, char *force_format,
     }
 
     // Peek this much data to avoid that stream_read() run by some demuxers
-    // or stream filters will flush previous peeked data.
-    stream_peek(stream, STREAM_BUFFER_SIZE);
+    // or stream filters will flush previous peeked data. This is also the
+    // data the demuxer probe callbacks check.
+    bstr probe_data = stream_peek(stream, STREAM_BUFFER_SIZE);
 
     // Test demuxers from first to last, one pass for each check_levels[] entry
     for (int pass = 0; check_levels[pass] != -1; pass++) {
@@ -903,6 +1312,8 @@ struct demuxer *demux_open(struct stream *stream, char *force_format,
         for (int n = 0; demuxer_list[n]; n++) {
             const struct demuxer_desc *desc = demuxer_list[n];
             if (!check_desc || desc == check_desc) {
+                if (desc->probe && !desc->probe(stream, probe_data, level))
+                    continue;
                 demuxer = open_given_type(global, log, desc, stream, params, level);
                 if (demuxer) {
                     talloc_steal(demuxer, log);
@@ -937,6 +1348,125 @@ void demux_flush(demuxer_t *demuxer)
     pthread_mutex_unlock(&demuxer->in->lock);
 }
 
+// Find the packet a cached seek to pts would start from: the last keyframe
+// before pts, or with SEEK_FORWARD, the first keyframe after pts. The packets
+// are the back buffer, the batch and the queue (in this order). *out is set to
+// the packet, and *prev to the packet before it (or NULL).
+// Returns false if pts is not within these packets.
+static bool find_seek_packet(struct demux_stream *ds, double pts, int flags,
+                             struct demux_packet **out,
+                             struct demux_packet **prev)
+{
+    struct demux_packet *lists[] = {ds->back_head, ds->batch, ds->head};
+    struct demux_packet *target = NULL, *target_prev = NULL, *last = NULL;
+    struct demux_packet *first_sub = NULL, *first_sub_prev = NULL;
+    bool covered = false;
+    for (int i = 0; i < MP_ARRAY_SIZE(lists); i++) {
+        for (struct demux_packet *dp = lists[i]; dp; last = dp, dp = dp->next) {
+            double ts = packet_ts(dp);
+            if (ts == MP_NOPTS_VALUE)
+                continue;
+            bool after = ts >= pts;
+            if (after && !covered) {
+                first_sub = dp;
+                first_sub_prev = last;
+            }
+            covered |= after;
+            // Audio and subtitle packets are always decodable on their own.
+            if (!dp->keyframe && ds->type == STREAM_VIDEO)
+                continue;
+            if (flags & SEEK_FORWARD) {
+                if (after && !target) {
+                    target = dp;
+                    target_prev = last;
+                }
+            } else if (!after || ts == pts) {
+                target = dp;
+                target_prev = last;
+            }
+        }
+    }
+    if (ds->type == STREAM_SUB) {
+        // Subtitles are sparse, so they can't be used to check whether the
+        // target is cached. Start with the next subtitle.
+        *out = target ? target : first_sub;
+        *prev = target ? target_prev : first_sub_prev;
+        if (!*out)
+            *prev = last; // all packets are before the target
+        return true;
+    }
+    *out = target;
+    *prev = target_prev;
+    return covered && target;
+}
+
+// Try to seek to pts using the packets kept in the back buffers and the packet
+// queues. The demuxer itself is not touched, and continues reading after the
+// queued packets. Called locked, by the user thread.
+static bool try_cached_seek(struct demux_internal *in, double pts, int flags)
+{
+    struct demuxer *demuxer = in->d_user;
+    struct demux_packet *targets[MAX_SH_STREAMS + 1] = {0};
+    struct demux_packet *prevs[MAX_SH_STREAMS + 1] = {0};
+    bool have_stream = false;
+
+    for (int n = 0; n < demuxer->num_streams; n++) {
+        struct demux_stream *ds = demuxer->streams[n]->ds;
+        if (!ds->selected)
+            continue;
+        if (!find_seek_packet(ds, pts, flags, &targets[n], &prevs[n]))
+            return false;
+        have_stream |= ds->type != STREAM_SUB;
+    }
+    if (!have_stream)
+        return false;
+
+    for (int n = 0; n < demuxer->num_streams; n++) {
+        struct demux_stream *ds = demuxer->streams[n]->ds;
+        if (!ds->selected) {
+            ds_flush(ds); // queue of an unselected stream is now out of place
+            continue;
+        }
+
+        // Join back buffer, batch and queue into a single list, and split it
+        // at the seek target: the part before it becomes the back buffer.
+        ds_sync_batch(ds);
+        struct demux_packet *lists[] = {ds->back_head, ds->batch, ds->head};
+        struct demux_packet *all = NULL, **next = &all;
+        for (int i = 0; i < MP_ARRAY_SIZE(lists); i++) {
+            *next = lists[i];
+            while (*next)
+                next = &(*next)->next;
+        }
+        struct demux_packet *split = targets[n];
+        ds->back_head = ds->back_tail = NULL;
+        ds->batch = NULL;
+        if (prevs[n]) {
+            ds->back_head = all;
+            ds->back_tail = prevs[n];
+            prevs[n]->next = NULL;
+        }
+        ds->head = split;
+        ds->tail = NULL;
+        ds->packs = ds->bytes = ds->back_bytes = 0;
+        for (struct demux_packet *dp = ds->back_head; dp; dp = dp->next)
+            ds->back_bytes += dp->len;
+        for (struct demux_packet *dp = ds->head; dp; dp = dp->next) {
+            ds->packs++;
+            ds->bytes += dp->len;
+            ds->tail = dp;
+            if (packet_ts(dp) != MP_NOPTS_VALUE)
+                ds->last_ts = packet_ts(dp);
+        }
+        ds->base_ts = split ? packet_ts(split) : ds->last_ts;
+        ds->eof = false;
+        ds_trim_back(ds);
+    }
+    in->warned_queue_overflow = false;
+    demuxer->filepos = -1;
+    return true;
+}
+
 int demux_seek(demuxer_t *demuxer, float rel_seek_secs, int flags)
 {
     struct demux_internal *in = demuxer->in;
@@ -952,11 +1482,27 @@ int demux_seek(demuxer_t *demuxer, float rel_seek_secs, int flags)
 
     pthread_mutex_lock(&in->lock);
 
+    if (in->max_back_bytes && (flags & SEEK_ABSOLUTE) &&
+        !(flags & SEEK_FACTOR) && !in->seeking &&
+        try_cached_seek(in, rel_seek_secs, flags))
+    {
+        MP_VERBOSE(in, "seeking within cached packets\n");
+        in->eof = false; // force retry
+        pthread_cond_signal(&in->wakeup);
+        pthread_mutex_unlock(&in->lock);
+        return 1;
+    }
+
     flush_locked(demuxer);
     in->seeking = true;
     in->seek_flags = flags;
     in->seek_pts = rel_seek_secs;
 
+    // Abort a stream read the demuxer thread might be blocked in; the data
+    // would be discarded anyway. (The demuxer recovers from it by seeking.)
+    if (in->threading)
+        mp_cancel_trigger(in->read_cancel);
+
     if (!in->threading)
         execute_seek(in);
 
@@ -989,17 +1535,58 @@ void demuxer_switch_track(struct demuxer *demuxer, enum stream_type type,
     }
 }
 
+// Drop queued audio packets from before the position the selected video is
+// read at, so that a decoder switched to the stream starts about at the
+// playback position. Called locked, by the user thread.
+static void ds_skip_to_reader(struct demuxer *demuxer, struct demux_stream *ds)
+{
+    double ref = MP_NOPTS_VALUE;
+    for (int n = 0; n < demuxer->num_streams; n++) {
+        struct demux_stream *other = demuxer->streams[n]->ds;
+        if (other->selected && other->type == STREAM_VIDEO)
+            ref = MP_PTS_MIN(ref, other->base_ts);
+    }
+    if (ref == MP_NOPTS_VALUE)
+        return;
+    ref -= 1.0; // arbitrary slack for decoder delay and A/V sync
+    while (ds->head && ds->head->next) {
+        double ts = packet_ts(ds->head->next);
+        if (ts == MP_NOPTS_VALUE || ts > ref)
+            break;
+        ds_drop_head(ds);
+    }
+}
+
 void demuxer_select_track(struct demuxer *demuxer, struct sh_stream *stream,
                           bool selected)
 {
+    struct demux_stream *ds = stream->ds;
     // don't flush buffers if stream is already selected / unselected
     pthread_mutex_lock(&demuxer->in->lock);
     bool update = false;
-    if (stream->ds->selected != selected) {
-        stream->ds->selected = selected;
-        stream->ds->active = false;
-        ds_flush(stream->ds);
-        update = true;
+    if (ds->selected != selected) {
+        bool was_wanted = ds_wants_packets(ds);
+        ds->selected = selected;
+        ds->active = false;
+        if (was_wanted && ds_wants_packets(ds)) {
+            // Keep the queue; the demuxer keeps reading the stream anyway.
+            ds_unbatch(ds);
+            free_packet_list(ds->back_head);
+            ds->back_head = ds->back_tail = NULL;
+            ds->back_bytes = 0;
+            ds->eof = false;
+            if (!selected) {
+                ds_trim_unselected(ds);
+            } else if (ds->type == STREAM_AUDIO) {
+                ds_skip_to_reader(demuxer, ds);
+            }
+            MP_VERBOSE(demuxer, "%s stream %d %s with %zd queued packets.\n",
+                       stream_type_name(ds->type), stream->index,
+                       selected ? "selected" : "deselected", ds->packs);
+        } else {
+            ds_flush(ds);
+            update = true;
+        }
     }
     pthread_mutex_unlock(&demuxer->in->lock);
     if (update)
@@ -1012,19 +1599,36 @@ void demux_set_stream_autoselect(struct demuxer *demuxer, bool autoselect)
     demuxer->in->autoselect = autoselect;
 }
 
+// Whether the demuxer implementation should output packets for the stream.
+// This is also true for unselected streams that are buffered for switching.
 bool demux_stream_is_selected(struct sh_stream *stream)
 {
     if (!stream)
         return false;
     bool r = false;
     pthread_mutex_lock(&stream->ds->in->lock);
-    r = stream->ds->selected;
+    r = ds_wants_packets(stream->ds);
     pthread_mutex_unlock(&stream->ds->in->lock);
     return r;
 }
 
-int demuxer_add_attachment(demuxer_t *demuxer, struct bstr name,
-                           struct bstr type, struct bstr data)
+// Whether packets are queued for the stream only to make switching to it fast.
+bool demux_stream_is_buffered(struct sh_stream *stream)
+{
+    if (!stream)
+        return false;
+    bool r = false;
+    pthread_mutex_lock(&stream->ds->in->lock);
+    r = !stream->ds->selected && ds_wants_packets(stream->ds);
+    pthread_mutex_unlock(&stream->ds->in->lock);
+    return r;
+}
+
+// Like demuxer_add_attachment(), but reference data instead of copying it. The
+// caller must make sure data stays valid as long as the demuxer exists, e.g.
+// by reparenting the allocation containing it to the demuxer.
+int demuxer_add_attachment_ref(demuxer_t *demuxer, struct bstr name,
+                               struct bstr type, struct bstr data)
 {
     if (!(demuxer->num_attachments % 32))
         demuxer->attachments = talloc_realloc(demuxer, demuxer->attachments,
@@ -1035,13 +1639,21 @@ int demuxer_add_attachment(demuxer_t *demuxer, struct bstr name,
         demuxer->attachments + demuxer->num_attachments;
     att->name = talloc_strndup(demuxer->attachments, name.start, name.len);
     att->type = talloc_strndup(demuxer->attachments, type.start, type.len);
-    att->data = talloc_size(demuxer->attachments, data.len);
-    memcpy(att->data, data.start, data.len);
+    att->data = data.start;
     att->data_size = data.len;
 
     return demuxer->num_attachments++;
 }
 
+int demuxer_add_attachment(demuxer_t *demuxer, struct bstr name,
+                           struct bstr type, struct bstr data)
+{
+    int n = demuxer_add_attachment_ref(demuxer, name, type, data);
+    struct demux_attachment *att = &demuxer->attachments[n];
+    att->data = talloc_memdup(demuxer->attachments, data.start, data.len);
+    return n;
+}
+
 static int chapter_compare(const void *p1, const void *p2)
 {
     struct demux_chapter *c1 = (void *)p1;
@@ -1096,6 +1708,11 @@ static void update_cache(struct demux_internal *in)
                                &in->time_length);
     }
 
+    if (in->stream_readahead_set) {
+        stream_control(stream, STREAM_CTRL_SET_READAHEAD, &in->stream_readahead);
+        in->stream_readahead_set = false;
+    }
+
     struct mp_tags *s_meta = NULL;
     stream_control(stream, STREAM_CTRL_GET_METADATA, &s_meta);
     if (s_meta) {
@@ -1112,6 +1729,11 @@ static void update_cache(struct demux_internal *in)
     stream_control(stream, STREAM_CTRL_GET_CACHE_FILL, &in->stream_cache_fill);
     in->stream_cache_idle = -1;
     stream_control(stream, STREAM_CTRL_GET_CACHE_IDLE, &in->stream_cache_idle);
+    in->stream_cache_speed = -1;
+    stream_control(stream, STREAM_CTRL_GET_CACHE_SPEED, &in->stream_cache_speed);
+    in->stream_has_dvb_stats =
+        stream_control(stream, STREAM_CTRL_GET_DVB_STATS,
+                       &in->stream_dvb_stats) == STREAM_OK;
 }
 
 // must be called locked
@@ -1137,11 +1759,27 @@ static int cached_stream_control(struct demux_internal *in, int cmd, void *arg)
             return STREAM_UNSUPPORTED;
         *(int *)arg = in->stream_cache_idle;
         return STREAM_OK;
+    case STREAM_CTRL_GET_CACHE_SPEED:
+        if (in->stream_cache_speed < 0)
+            return STREAM_UNSUPPORTED;
+        *(int64_t *)arg = in->stream_cache_speed;
+        return STREAM_OK;
+    case STREAM_CTRL_SET_READAHEAD:
+        // Passed on by update_cache().
+        in->stream_readahead = *(int64_t *)arg;
+        in->stream_readahead_set = true;
+        pthread_cond_signal(&in->wakeup);
+        return STREAM_OK;
     case STREAM_CTRL_GET_SIZE:
         if (in->stream_size < 0)
             return STREAM_UNSUPPORTED;
         *(int64_t *)arg = in->stream_size;
         return STREAM_OK;
+    case STREAM_CTRL_GET_DVB_STATS:
+        if (!in->stream_has_dvb_stats)
+            return STREAM_UNSUPPORTED;
+        *(struct stream_dvb_stats *)arg = in->stream_dvb_stats;
+        return STREAM_OK;
     }
     return STREAM_ERROR;
 }
@@ -1174,14 +1812,30 @@ static int cached_demux_control(struct demux_internal *in, int cmd, void *arg)
             .ts_range = {MP_NOPTS_VALUE, MP_NOPTS_VALUE},
             .ts_duration = -1,
         };
+        double bitrate = 0;
+        bool bitrate_ok = false;
         for (int n = 0; n < in->d_user->num_streams; n++) {
             struct demux_stream *ds = in->d_user->streams[n]->ds;
+            ds_sync_batch(ds);
             if (ds->active) {
-                r->underrun |= !ds->head;
+                r->underrun |= !ds->head && !ds->batch;
                 r->ts_range[0] = MP_PTS_MAX(r->ts_range[0], ds->base_ts);
                 r->ts_range[1] = MP_PTS_MIN(r->ts_range[1], ds->last_ts);
             }
+            // Estimate the bitrate from the queued packets. This needs a
+            // sufficiently long range of packets to be meaningful.
+            double duration = ds->last_ts - ds->base_ts;
+            if (ds->active && ds->base_ts != MP_NOPTS_VALUE &&
+                ds->last_ts != MP_NOPTS_VALUE && duration >= 0.5)
+            {
+                bitrate += ds->bytes * 8 / duration;
+                bitrate_ok = true;
+            }
         }
+        // Keep the last estimate if the queues are (nearly) empty.
+        if (bitrate_ok)
+            in->last_bitrate = bitrate;
+        r->bitrate = in->last_bitrate;
         r->idle = (in->idle && !r->underrun) || r->eof;
         r->underrun &= !r->idle;
         if (r->ts_range[0] != MP_NOPTS_VALUE && r->ts_range[1] != MP_NOPTS_VALUE)
@@ -1249,6 +1903,9 @@ void demux_pause(demuxer_t *demuxer)
     pthread_cond_signal(&in->wakeup);
     while (!in->thread_paused)
         pthread_cond_wait(&in->wakeup, &in->lock);
+    // Don't make stream accesses by the caller fail because of a queued seek.
+    // The thread will execute the seek after unpausing anyway.
+    mp_cancel_reset(in->read_cancel);
     pthread_mutex_unlock(&in->lock);
 }
 
@@ -61,6 +61,16 @@ struct demux_ctrl_reader_state {
     bool eof, underrun, idle;
     double ts_range[2]; // start, end
     double ts_duration;
+    double bitrate;     // estimated bits/second of the selected streams, or -1
+};
+
+struct demux_stream_stats {
+    int64_t queued_packets;
+    int64_t queued_bytes;
+    double queued_secs;     // duration of the queued packets, or -1
+    double packets_per_sec; // per second of demuxed media time, or -1
+    double avg_packet_size; // in bytes, or -1
+    int64_t underruns;      // times the packet queue ran empty during playback
 };
 
 struct demux_ctrl_stream_ctrl {
@@ -101,6 +111,7 @@ enum demux_event {
 #define MAX_SH_STREAMS 256
 
 struct demuxer;
+struct stream;
 
 /**
  * Demuxer description structure
@@ -114,6 +125,11 @@ typedef struct demuxer_desc {
     // Return 0 on success, otherwise -1
     int (*open)(struct demuxer *demuxer, enum demux_check check);
     // The following functions are all optional
+    // Cheap test run before open(): return false if open() would certainly
+    // fail with this check level. data is peeked from the current stream
+    // position (shared between all demuxers), and may be shorter than what
+    // open() would look at. The stream must not be read or seeked.
+    bool (*probe)(struct stream *stream, bstr data, enum demux_check check);
     int (*fill_buffer)(struct demuxer *demuxer); // 0 on EOF, otherwise 1
     void (*close)(struct demuxer *demuxer);
     void (*seek)(struct demuxer *demuxer, double rel_seek_secs, int flags);
@@ -173,6 +189,8 @@ struct demuxer_params {
     struct matroska_segment_uid *matroska_wanted_uids;
     int matroska_wanted_segment;
     bool *matroska_was_valid;
+    // If not NULL, set to the segment UID of the file (even if not wanted).
+    struct matroska_segment_uid *matroska_read_uid;
     bool expect_subtitle;
 };
 
@@ -239,8 +257,10 @@ int demux_add_packet(struct sh_stream *stream, demux_packet_t *dp);
 struct demux_packet *demux_read_packet(struct sh_stream *sh);
 int demux_read_packet_async(struct sh_stream *sh, struct demux_packet **out_pkt);
 bool demux_stream_is_selected(struct sh_stream *stream);
+bool demux_stream_is_buffered(struct sh_stream *stream);
 double demux_get_next_pts(struct sh_stream *sh);
 bool demux_has_packet(struct sh_stream *sh);
+void demux_get_stream_stats(struct sh_stream *sh, struct demux_stream_stats *st);
 struct demux_packet *demux_read_any_packet(struct demuxer *demuxer);
 
 struct sh_stream *new_sh_stream(struct demuxer *demuxer, enum stream_type type);
@@ -268,6 +288,8 @@ void demuxer_help(struct mp_log *log);
 
 int demuxer_add_attachment(struct demuxer *demuxer, struct bstr name,
                            struct bstr type, struct bstr data);
+int demuxer_add_attachment_ref(struct demuxer *demuxer, struct bstr name,
+                               struct bstr type, struct bstr data);
 int demuxer_add_chapter(struct demuxer *demuxer, struct bstr name,
                         uint64_t start, uint64_t end, uint64_t demuxer_id);
 
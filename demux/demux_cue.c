@@ -49,9 +49,17 @@ static int try_open_file(struct demuxer *demuxer, enum demux_check check)
     return 0;
 }
 
+static bool probe_file(struct stream *s, bstr data, enum demux_check check)
+{
+    if (check < DEMUX_CHECK_UNSAFE)
+        return true;
+    return mp_probe_cue(bstr_splice(data, 0, PROBE_SIZE));
+}
+
 const struct demuxer_desc demuxer_desc_cue = {
     .name = "cue",
     .desc = "CUE sheet",
     .type = DEMUXER_TYPE_CUE,
     .open = try_open_file,
+    .probe = probe_file,
 };
@@ -345,11 +345,17 @@ static int d_control(demuxer_t *demuxer, int cmd, void *arg)
     return demux_control(p->slave, cmd, arg);
 }
 
+static bool d_probe(struct stream *s, bstr data, enum demux_check check)
+{
+    return check == DEMUX_CHECK_FORCE;
+}
+
 const demuxer_desc_t demuxer_desc_disc = {
     .name = "disc",
     .desc = "CD/DVD/BD wrapper",
     .fill_buffer = d_fill_buffer,
     .open = d_open,
+    .probe = d_probe,
     .close = d_close,
     .seek = d_seek,
     .control = d_control,
@@ -46,9 +46,17 @@ static int try_open_file(struct demuxer *demuxer, enum demux_check check)
     return 0;
 }
 
+static bool probe_file(struct stream *s, bstr data, enum demux_check check)
+{
+    if (s->uncached_type == STREAMTYPE_EDL || check < DEMUX_CHECK_UNSAFE)
+        return true;
+    return bstr_startswith0(data, HEADER);
+}
+
 const struct demuxer_desc demuxer_desc_edl = {
     .name = "edl",
     .desc = "Edit decision list",
     .type = DEMUXER_TYPE_EDL,
     .open = try_open_file,
+    .probe = probe_file,
 };
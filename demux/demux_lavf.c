@@ -23,7 +23,10 @@
 #include <stdbool.h>
 #include <string.h>
 #include <strings.h>
+#include <math.h>
 #include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "config.h"
 
@@ -32,6 +35,9 @@
 #include <libavutil/avutil.h>
 #include <libavutil/avstring.h>
 #include <libavutil/mathematics.h>
+#include <libavutil/intfloat.h>
+#include <libavutil/intreadwrite.h>
+#include <libavutil/md5.h>
 #if HAVE_AVCODEC_REPLAYGAIN_SIDE_DATA
 # include <libavutil/replaygain.h>
 #endif
@@ -41,6 +47,8 @@
 #include <libavutil/opt.h>
 
 #include "options/options.h"
+#include "options/path.h"
+#include "common/common.h"
 #include "common/msg.h"
 #include "common/tags.h"
 #include "common/av_common.h"
@@ -59,6 +67,8 @@
 // Should correspond to IO_BUFFER_SIZE in libavformat/aviobuf.c (not public)
 // libavformat (almost) always reads data in blocks of this size.
 #define BIO_BUFFER_SIZE 32768
+// Upper bound for the automatically chosen AVIO buffer size.
+#define BIO_BUFFER_SIZE_MAX (256 * 1024)
 
 #define OPT_BASE_STRUCT struct demux_lavf_opts
 struct demux_lavf_opts {
@@ -71,6 +81,7 @@ struct demux_lavf_opts {
     char *cryptokey;
     char **avopts;
     int genptsmode;
+    int audio_index;
 };
 
 const struct m_sub_options demux_lavf_conf = {
@@ -78,19 +89,21 @@ const struct m_sub_options demux_lavf_conf = {
         OPT_INTRANGE("probesize", probesize, 0, 32, INT_MAX),
         OPT_STRING("format", format, 0),
         OPT_FLOATRANGE("analyzeduration", analyzeduration, 0, 0, 3600),
-        OPT_INTRANGE("buffersize", buffersize, 0, 1, 10 * 1024 * 1024,
-                     OPTDEF_INT(BIO_BUFFER_SIZE)),
+        OPT_INTRANGE("buffersize", buffersize, 0, 0, 10 * 1024 * 1024),
         OPT_FLAG("allow-mimetype", allow_mimetype, 0),
         OPT_INTRANGE("probescore", probescore, 0, 0, 100),
         OPT_STRING("cryptokey", cryptokey, 0),
         OPT_CHOICE("genpts-mode", genptsmode, 0,
                    ({"lavf", 1}, {"no", 0})),
         OPT_KEYVALUELIST("o", avopts, 0),
+        OPT_CHOICE("audio-index", audio_index, 0,
+                   ({"no", 0}, {"yes", 1}, {"auto", 2})),
         {0}
     },
     .size = sizeof(struct demux_lavf_opts),
     .defaults = &(const struct demux_lavf_opts){
         .allow_mimetype = 1,
+        .audio_index = 2,
     },
 };
 
@@ -106,6 +119,10 @@ typedef struct lavf_priv {
     int cur_program;
     char *mime_type;
     bool merge_track_metadata;
+    struct audio_index *audio_index;
+    bool index_seek;            // next packet is at the seeked-to index entry
+    double index_seek_pts;      // exact timestamp of that packet
+    double ts_offset;           // correction added to timestamps after it
 } lavf_priv_t;
 
 struct format_hack {
@@ -140,7 +157,10 @@ static int mp_read(void *opaque, uint8_t *buf, int size)
     struct stream *stream = demuxer->stream;
     int ret;
 
-    ret = stream_read(stream, buf, size);
+    // Return whatever is available instead of waiting for the full size;
+    // libavformat handles short reads. Reads of at least the stream's fill
+    // size bypass the stream buffer and go straight into buf.
+    ret = stream_read_partial(stream, buf, size);
 
     MP_TRACE(demuxer, "%d=mp_read(%p, %p, %d), pos: %"PRId64", eof:%d\n",
              ret, stream, buf, size, stream_tell(stream), stream->eof);
@@ -386,6 +406,8 @@ static void parse_cryptokey(AVFormatContext *avfc, const char *str)
         *key++ = (char2int(str[0]) << 4) | char2int(str[1]);
 }
 
+// Demuxers with an index (like mov/mp4) don't read the data of discarded
+// streams at all, and seek between the chunks of the selected ones.
 static void select_tracks(struct demuxer *demuxer, int start)
 {
     lavf_priv_t *priv = demuxer->priv;
@@ -656,6 +678,315 @@ static void update_metadata(demuxer_t *demuxer, AVPacket *pkt)
 #endif
 }
 
+// Seek index for audio-only files (--demuxer-lavf-audio-index). A thread reads
+// the whole file once, using its own stream and AVFormatContext, and records
+// the byte position of a packet every AUDIO_INDEX_INTERVAL seconds. Because
+// the file is read from the start, the timestamps are exact, unlike those
+// libavformat estimates from the bitrate or a Xing TOC when seeking.
+#define AUDIO_INDEX_INTERVAL 0.5
+
+// Header of the index files stored in --demuxer-mkv-index-dir (followed by
+// the file identity and the entries).
+#define AUDIO_INDEX_MAGIC "mpv audio index 1\n"
+#define AUDIO_INDEX_ENTRY_SIZE 16
+
+struct audio_index_entry {
+    double pts;
+    int64_t pos;
+};
+
+struct audio_index {
+    struct mp_log *log;
+    struct mpv_global *global;
+    char *url;
+    AVInputFormat *avif;
+    int stream_index;
+    char *file;                 // index file, or NULL
+    char *header;               // identifies the media file in the index file
+    bool loaded;                // entries were loaded from the index file
+
+    pthread_t thread;
+    bool thread_running;
+
+    pthread_mutex_t lock;
+    // --- protected by lock
+    bool cancel;
+    bool complete;              // the entries cover the whole file
+    struct audio_index_entry *entries;
+    int num_entries;
+};
+
+static int index_read(void *opaque, uint8_t *buf, int size)
+{
+    return stream_read_partial(opaque, buf, size);
+}
+
+static int64_t index_seek(void *opaque, int64_t pos, int whence)
+{
+    struct stream *stream = opaque;
+    if (whence == AVSEEK_SIZE) {
+        int64_t end;
+        if (stream_control(stream, STREAM_CTRL_GET_SIZE, &end) != STREAM_OK)
+            return -1;
+        return end;
+    }
+    if (whence == SEEK_CUR) {
+        pos += stream_tell(stream);
+    } else if (whence != SEEK_SET) {
+        return -1;
+    }
+    return pos >= 0 && stream_seek(stream, pos) ? pos : -1;
+}
+
+static void *audio_index_thread(void *ptr)
+{
+    struct audio_index *ix = ptr;
+    AVFormatContext *avfc = NULL;
+    AVIOContext *pb = NULL;
+    bool eof = false;
+
+    struct stream *stream = stream_open(ix->url, ix->global);
+    if (!stream)
+        goto done;
+    void *buffer = av_malloc(BIO_BUFFER_SIZE);
+    if (!buffer)
+        goto done;
+    pb = avio_alloc_context(buffer, BIO_BUFFER_SIZE, 0, stream, index_read,
+                            NULL, index_seek);
+    if (!pb) {
+        av_free(buffer);
+        goto done;
+    }
+    avfc = avformat_alloc_context();
+    if (!avfc)
+        goto done;
+    avfc->pb = pb;
+    if (avformat_open_input(&avfc, ix->url, ix->avif, NULL) < 0)
+        goto done;
+    if (ix->stream_index >= avfc->nb_streams)
+        goto done;
+    for (int n = 0; n < avfc->nb_streams; n++) {
+        avfc->streams[n]->discard =
+            n == ix->stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    AVStream *st = avfc->streams[ix->stream_index];
+
+    double last_pts = -INFINITY;
+    while (1) {
+        pthread_mutex_lock(&ix->lock);
+        bool cancel = ix->cancel;
+        pthread_mutex_unlock(&ix->lock);
+        if (cancel)
+            goto done;
+
+        AVPacket *pkt = &(AVPacket){0};
+        int r = av_read_frame(avfc, pkt);
+        if (r == AVERROR(EAGAIN))
+            continue;
+        if (r < 0) {
+            eof = r == AVERROR_EOF;
+            break;
+        }
+        int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        if (pkt->stream_index == ix->stream_index && ts != AV_NOPTS_VALUE &&
+            pkt->pos >= 0)
+        {
+            double pts = ts * av_q2d(st->time_base);
+            if (pts >= last_pts + AUDIO_INDEX_INTERVAL) {
+                struct audio_index_entry e = {pts, pkt->pos};
+                pthread_mutex_lock(&ix->lock);
+                MP_TARRAY_APPEND(ix, ix->entries, ix->num_entries, e);
+                pthread_mutex_unlock(&ix->lock);
+                last_pts = pts;
+            }
+        }
+        av_free_packet(pkt);
+    }
+
+    pthread_mutex_lock(&ix->lock);
+    ix->complete = eof;
+    pthread_mutex_unlock(&ix->lock);
+    MP_VERBOSE(ix, "Audio seek index %s with %d entries.\n",
+               eof ? "complete" : "incomplete", ix->num_entries);
+
+done:
+    if (avfc)
+        avformat_close_input(&avfc);
+    if (pb)
+        av_freep(&pb->buffer);
+    av_freep(&pb);
+    free_stream(stream);
+    return NULL;
+}
+
+// Find the entry to seek to for pts: the last one at or before pts, or the
+// first one at or after it if forward is set. Fails if the index doesn't
+// reach pts yet.
+static bool audio_index_lookup(struct audio_index *ix, double pts, bool forward,
+                               struct audio_index_entry *out)
+{
+    pthread_mutex_lock(&ix->lock);
+    int num = ix->num_entries;
+    bool ok = num && (ix->complete || ix->entries[num - 1].pts >= pts);
+    if (ok) {
+        // Binary search for the first entry after pts.
+        int lo = 0, hi = num;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (ix->entries[mid].pts <= pts) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        int i = lo - 1;
+        if (i < 0 || (forward && ix->entries[i].pts < pts && lo < num))
+            i = lo;
+        *out = ix->entries[MPMIN(i, num - 1)];
+    }
+    pthread_mutex_unlock(&ix->lock);
+    return ok;
+}
+
+// Setup the index file in --demuxer-mkv-index-dir, and load the index from
+// it if it was stored in a previous session.
+static void audio_index_load(struct audio_index *ix, struct demuxer *demuxer)
+{
+    int64_t size = -1;
+    stream_control(demuxer->stream, STREAM_CTRL_GET_SIZE, &size);
+    if (size <= 0)
+        return;
+
+    char *dir = mp_get_user_path(ix, demuxer->global,
+                                 demuxer->opts->mkv_index_dir);
+    mp_mkdirp(dir);
+    char *key = talloc_asprintf(ix, "%"PRId64"\n%s\n%d\n", size, ix->url,
+                                ix->stream_index);
+    uint8_t md5[16];
+    av_md5_sum(md5, key, strlen(key));
+    char *name = talloc_strdup(ix, "");
+    for (int i = 0; i < 16; i++)
+        name = talloc_asprintf_append(name, "%02X", md5[i]);
+    ix->header = talloc_asprintf(ix, AUDIO_INDEX_MAGIC "%s", key);
+    ix->file = talloc_asprintf(ix, "%s/%s.aindex", dir, name);
+
+    FILE *f = fopen(ix->file, "rb");
+    if (!f)
+        return;
+    size_t header_len = strlen(ix->header);
+    char *header = talloc_size(NULL, header_len);
+    bool ok = fread(header, header_len, 1, f) == 1 &&
+              memcmp(header, ix->header, header_len) == 0;
+    talloc_free(header);
+    uint8_t buf[AUDIO_INDEX_ENTRY_SIZE];
+    while (ok && fread(buf, sizeof(buf), 1, f) == 1) {
+        struct audio_index_entry e = {
+            .pts = av_int2double(AV_RL64(buf)),
+            .pos = AV_RL64(buf + 8),
+        };
+        ok = e.pos >= 0 && e.pos < size && isfinite(e.pts) &&
+             (!ix->num_entries || ix->entries[ix->num_entries - 1].pts < e.pts);
+        if (ok)
+            MP_TARRAY_APPEND(ix, ix->entries, ix->num_entries, e);
+    }
+    fclose(f);
+
+    if (!ok || !ix->num_entries) {
+        MP_WARN(demuxer, "Ignoring invalid index file '%s'.\n", ix->file);
+        ix->num_entries = 0;
+        return;
+    }
+    ix->complete = ix->loaded = true;
+    MP_VERBOSE(demuxer, "Loaded %d audio index entries from '%s'.\n",
+               ix->num_entries, ix->file);
+}
+
+static void audio_index_save(struct audio_index *ix)
+{
+    if (!ix->file || ix->loaded || !ix->complete || !ix->num_entries)
+        return;
+
+    FILE *f = fopen(ix->file, "wb");
+    bool ok = f && fwrite(ix->header, strlen(ix->header), 1, f) == 1;
+    for (int n = 0; ok && n < ix->num_entries; n++) {
+        uint8_t buf[AUDIO_INDEX_ENTRY_SIZE];
+        AV_WL64(buf, av_double2int(ix->entries[n].pts));
+        AV_WL64(buf + 8, ix->entries[n].pos);
+        ok = fwrite(buf, sizeof(buf), 1, f) == 1;
+    }
+    if (f && fclose(f))
+        ok = false;
+    if (!ok) {
+        MP_ERR(ix, "Can't write index file '%s'.\n", ix->file);
+        unlink(ix->file);
+    }
+}
+
+static void audio_index_destroy(void *ptr)
+{
+    struct audio_index *ix = ptr;
+    if (ix->thread_running) {
+        pthread_mutex_lock(&ix->lock);
+        ix->cancel = true;
+        pthread_mutex_unlock(&ix->lock);
+        pthread_join(ix->thread, NULL);
+    }
+    audio_index_save(ix);
+    pthread_mutex_destroy(&ix->lock);
+}
+
+static void audio_index_init(struct demuxer *demuxer)
+{
+    lavf_priv_t *priv = demuxer->priv;
+    struct MPOpts *opts = demuxer->opts;
+    int mode = opts->demux_lavf->audio_index;
+    struct stream *s = demuxer->stream;
+
+    // The indexer opens the file again, so only do it for local files.
+    if (!mode || !demuxer->seekable || s->is_network || s->streaming ||
+        !s->url || (priv->avif->flags & AVFMT_NOFILE))
+        return;
+    // Raw MP3 and AAC have no index, and libavformat guesses where to seek.
+    if (mode == 2 && !matches_avinputformat_name(priv, "mp3") &&
+        !matches_avinputformat_name(priv, "aac"))
+        return;
+
+    // Audio-only files, possibly with cover art.
+    int stream_index = -1;
+    for (int n = 0; n < priv->num_streams; n++) {
+        struct sh_stream *sh = priv->streams[n];
+        if (!sh)
+            continue;
+        if (sh->type == STREAM_AUDIO) {
+            if (stream_index >= 0)
+                return;
+            stream_index = n;
+        } else if (!sh->attached_picture) {
+            return;
+        }
+    }
+    if (stream_index < 0)
+        return;
+
+    struct audio_index *ix = talloc_zero(priv, struct audio_index);
+    ix->log = demuxer->log;
+    ix->global = demuxer->global;
+    ix->url = talloc_strdup(ix, s->url);
+    ix->avif = priv->avif;
+    ix->stream_index = stream_index;
+    pthread_mutex_init(&ix->lock, NULL);
+    talloc_set_destructor(ix, audio_index_destroy);
+    priv->audio_index = ix;
+
+    if (opts->mkv_index_dir && opts->mkv_index_dir[0])
+        audio_index_load(ix, demuxer);
+    if (ix->complete)
+        return;
+
+    ix->thread_running = !pthread_create(&ix->thread, NULL,
+                                         audio_index_thread, ix);
+}
+
 static int demux_open_lavf(demuxer_t *demuxer, enum demux_check check)
 {
     struct MPOpts *opts = demuxer->opts;
@@ -711,10 +1042,18 @@ static int demux_open_lavf(demuxer_t *demuxer, enum demux_check check)
         // This might be incorrect.
         demuxer->seekable = true;
     } else {
-        void *buffer = av_malloc(lavfdopts->buffersize);
+        int buffersize = lavfdopts->buffersize;
+        if (!buffersize) {
+            // Refill libavformat's buffer with one read of the stream's
+            // preferred size, so reads don't get split or go through the
+            // stream buffer as well.
+            buffersize = MPCLAMP(demuxer->stream->read_chunk,
+                                 BIO_BUFFER_SIZE, BIO_BUFFER_SIZE_MAX);
+        }
+        void *buffer = av_malloc(buffersize);
         if (!buffer)
             return -1;
-        priv->pb = avio_alloc_context(buffer, lavfdopts->buffersize, 0,
+        priv->pb = avio_alloc_context(buffer, buffersize, 0,
                                       demuxer, mp_read, NULL, mp_seek);
         if (!priv->pb) {
             av_free(buffer);
@@ -790,6 +1129,8 @@ static int demux_open_lavf(demuxer_t *demuxer, enum demux_check check)
     demuxer->start_time = priv->avfc->start_time == AV_NOPTS_VALUE ?
                           0 : (double)priv->avfc->start_time / AV_TIME_BASE;
 
+    audio_index_init(demuxer);
+
     return 0;
 }
 
@@ -834,6 +1175,25 @@ static int demux_lavf_fill_buffer(demuxer_t *demux)
     dp->duration = pkt->duration * av_q2d(st->time_base);
     if (pkt->convergence_duration > 0)
         dp->duration = pkt->convergence_duration * av_q2d(st->time_base);
+    if (priv->index_seek && pkt->stream_index == priv->audio_index->stream_index) {
+        // libavformat doesn't know the timestamp after a byte seek, or
+        // guesses it. The index knows it exactly; correct all following
+        // packets by the difference.
+        double ts = dp->pts != MP_NOPTS_VALUE ? dp->pts : dp->dts;
+        priv->ts_offset = 0;
+        if (ts != MP_NOPTS_VALUE) {
+            priv->ts_offset = priv->index_seek_pts - ts;
+        } else {
+            dp->pts = priv->index_seek_pts;
+        }
+        priv->index_seek = false;
+    }
+    if (priv->ts_offset) {
+        if (dp->pts != MP_NOPTS_VALUE)
+            dp->pts += priv->ts_offset;
+        if (dp->dts != MP_NOPTS_VALUE)
+            dp->dts += priv->ts_offset;
+    }
     dp->pos = pkt->pos;
     dp->keyframe = pkt->flags & AV_PKT_FLAG_KEY;
     if (dp->pts != MP_NOPTS_VALUE) {
@@ -879,6 +1239,20 @@ static void demux_seek_lavf(demuxer_t *demuxer, double rel_seek_secs, int flags)
         priv->last_pts += rel_seek_secs * AV_TIME_BASE;
     }
 
+    priv->index_seek = false;
+    priv->ts_offset = 0;
+
+    struct audio_index_entry entry;
+    if (priv->audio_index && !(avsflags & AVSEEK_FLAG_BYTE) &&
+        audio_index_lookup(priv->audio_index, priv->last_pts / (double)AV_TIME_BASE,
+                           flags & SEEK_FORWARD, &entry) &&
+        av_seek_frame(priv->avfc, -1, entry.pos, AVSEEK_FLAG_BYTE) >= 0)
+    {
+        priv->index_seek = true;
+        priv->index_seek_pts = entry.pts;
+        return;
+    }
+
     if (!priv->avfc->iformat->read_seek2) {
         // Normal seeking.
         int r = av_seek_frame(priv->avfc, -1, priv->last_pts, avsflags);
@@ -1026,6 +1400,8 @@ static void demux_close_lavf(demuxer_t *demuxer)
 {
     lavf_priv_t *priv = demuxer->priv;
     if (priv) {
+        // Stops the indexer thread.
+        talloc_free(priv->audio_index);
         if (priv->avfc) {
             av_freep(&priv->avfc->key);
             avformat_close_input(&priv->avfc);
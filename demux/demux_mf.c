@@ -19,16 +19,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <strings.h>
+#include <assert.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "osdep/io.h"
 
 #include "talloc.h"
 #include "common/msg.h"
+#include "common/global.h"
 #include "options/options.h"
+#include "misc/thread_pool.h"
 
 #include "stream/stream.h"
 #include "demux.h"
@@ -53,6 +57,174 @@ static void demux_seek_mf(demuxer_t *demuxer, double rel_seek_secs, int flags)
     mf->curr_frame = newpos;
 }
 
+// Read the file of the given frame. s is the already opened stream, or NULL.
+static bstr read_image(struct mpv_global *global, struct stream *s,
+                       const char *filename)
+{
+    struct stream *stream = s;
+    if (!stream && filename)
+        stream = stream_open(filename, global);
+
+    bstr data = {0};
+    if (stream) {
+        stream_seek(stream, 0);
+        data = stream_read_complete(stream, NULL, MF_MAX_FILE_SIZE);
+    }
+
+    if (stream && stream != s)
+        free_stream(stream);
+    return data;
+}
+
+// Image files are read ahead in parallel on the shared thread pool. The
+// demuxer still outputs them in order, and waits for the next frame if its
+// read hasn't finished yet.
+struct mf_read {
+    struct mf_prefetch *p;
+    int frame;
+    char *filename;
+    bstr data;              // set when done (allocated under the mf_read)
+    bool done;
+    bool abandoned;         // not needed anymore; the task frees it
+};
+
+struct mf_prefetch {
+    struct mpv_global *global;
+    struct mp_thread_pool *pool;
+    int max_reads;
+    int64_t max_bytes;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    // --- protected by lock
+    int pending;            // number of queued reads that didn't finish yet
+    int64_t bytes;          // sum of data.len of the finished reads in reads[]
+    // --- accessed by the demuxer only
+    struct mf_read **reads; // consecutive frames, in order
+    int num_reads;
+};
+
+static void read_task(void *ptr)
+{
+    struct mf_read *r = ptr;
+    struct mf_prefetch *p = r->p;
+
+    bstr data = read_image(p->global, NULL, r->filename);
+
+    pthread_mutex_lock(&p->lock);
+    if (r->abandoned) {
+        talloc_free(data.start);
+        talloc_free(r);
+    } else {
+        r->data = data;
+        talloc_steal(r, data.start);
+        r->done = true;
+        p->bytes += data.len;
+    }
+    p->pending--;
+    pthread_cond_broadcast(&p->wakeup);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Remove reads[0]. Its data is returned if it's done, otherwise the read is
+// abandoned, and the returned bstr is empty. lock must be held.
+static bstr remove_read(struct mf_prefetch *p)
+{
+    struct mf_read *r = p->reads[0];
+    MP_TARRAY_REMOVE_AT(p->reads, p->num_reads, 0);
+
+    bstr data = {0};
+    if (r->done) {
+        p->bytes -= r->data.len;
+        data = r->data;
+        talloc_steal(NULL, data.start);
+        talloc_free(r);
+    } else {
+        r->abandoned = true;
+    }
+    return data;
+}
+
+// The pool runs the task directly if it has no worker threads, so this must
+// be called without holding the lock.
+static void queue_reads(struct mf_prefetch *p, mf_t *mf)
+{
+    int next = p->num_reads ? p->reads[p->num_reads - 1]->frame + 1
+                            : mf->curr_frame;
+    while (p->num_reads < p->max_reads && next < mf->nr_of_files) {
+        pthread_mutex_lock(&p->lock);
+        // The frame that is needed now is always read.
+        bool full = p->num_reads && p->bytes >= p->max_bytes;
+        if (!full)
+            p->pending++;
+        pthread_mutex_unlock(&p->lock);
+        if (full)
+            break;
+
+        struct mf_read *r = talloc_ptrtype(NULL, r);
+        *r = (struct mf_read){
+            .p = p,
+            .frame = next++,
+            .filename = talloc_strdup(r, mf->names[r->frame]),
+        };
+        MP_TARRAY_APPEND(p, p->reads, p->num_reads, r);
+        mp_thread_pool_queue(p->pool, read_task, r);
+    }
+}
+
+static bstr prefetch_image(struct mf_prefetch *p, mf_t *mf)
+{
+    pthread_mutex_lock(&p->lock);
+
+    // Drop reads that are not needed anymore after a seek.
+    while (p->num_reads && p->reads[0]->frame != mf->curr_frame)
+        talloc_free(remove_read(p).start);
+
+    pthread_mutex_unlock(&p->lock);
+    queue_reads(p, mf);
+    pthread_mutex_lock(&p->lock);
+
+    while (!p->reads[0]->done)
+        pthread_cond_wait(&p->wakeup, &p->lock);
+    bstr data = remove_read(p);
+
+    pthread_mutex_unlock(&p->lock);
+    return data;
+}
+
+static void destroy_prefetch(void *ptr)
+{
+    struct mf_prefetch *p = ptr;
+
+    pthread_mutex_lock(&p->lock);
+    while (p->num_reads)
+        talloc_free(remove_read(p).start);
+    while (p->pending)
+        pthread_cond_wait(&p->wakeup, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    pthread_cond_destroy(&p->wakeup);
+    pthread_mutex_destroy(&p->lock);
+}
+
+static void init_prefetch(demuxer_t *demuxer, mf_t *mf)
+{
+    struct MPOpts *opts = demuxer->opts;
+    // Single files are read from the already opened stream.
+    if (mf->streams || mf->nr_of_files < 2 || opts->mf_prefetch < 1)
+        return;
+
+    struct mf_prefetch *p = talloc_zero(mf, struct mf_prefetch);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wakeup, NULL);
+    talloc_set_destructor(p, destroy_prefetch);
+    p->global = demuxer->global;
+    p->pool = mp_thread_pool_get_shared(p);
+    p->max_reads = opts->mf_prefetch;
+    p->max_bytes = opts->mf_prefetch_bytes;
+    mf->prefetch = p;
+}
+
 // return value:
 //     0 = EOF or no stream found
 //     1 = successfully read a packet
@@ -62,33 +234,25 @@ static int demux_mf_fill_buffer(demuxer_t *demuxer)
     if (mf->curr_frame >= mf->nr_of_files)
         return 0;
 
-    struct stream *entry_stream = NULL;
-    if (mf->streams)
-        entry_stream = mf->streams[mf->curr_frame];
-    struct stream *stream = entry_stream;
-    if (!stream) {
-        char *filename = mf->names[mf->curr_frame];
-        if (filename)
-            stream = stream_open(filename, demuxer->global);
+    bstr data;
+    if (mf->prefetch) {
+        data = prefetch_image(mf->prefetch, mf);
+    } else {
+        data = read_image(demuxer->global,
+                          mf->streams ? mf->streams[mf->curr_frame] : NULL,
+                          mf->names[mf->curr_frame]);
     }
 
-    if (stream) {
-        stream_seek(stream, 0);
-        bstr data = stream_read_complete(stream, NULL, MF_MAX_FILE_SIZE);
-        if (data.len) {
-            demux_packet_t *dp = new_demux_packet(data.len);
-            if (dp) {
-                memcpy(dp->buffer, data.start, data.len);
-                dp->pts = mf->curr_frame / mf->sh->fps;
-                dp->keyframe = true;
-                demux_add_packet(demuxer->streams[0], dp);
-            }
+    if (data.len) {
+        demux_packet_t *dp = new_demux_packet(data.len);
+        if (dp) {
+            memcpy(dp->buffer, data.start, data.len);
+            dp->pts = mf->curr_frame / mf->sh->fps;
+            dp->keyframe = true;
+            demux_add_packet(demuxer->streams[0], dp);
         }
-        talloc_free(data.start);
     }
-
-    if (stream && stream != entry_stream)
-        free_stream(stream);
+    talloc_free(data.start);
 
     mf->curr_frame++;
     return 1;
@@ -205,6 +369,8 @@ static int demux_open_mf(demuxer_t *demuxer, enum demux_check check)
     demuxer->priv = (void *)mf;
     demuxer->seekable = true;
 
+    init_prefetch(demuxer, mf);
+
     return 0;
 
 error:
@@ -213,6 +379,11 @@ error:
 
 static void demux_close_mf(demuxer_t *demuxer)
 {
+    mf_t *mf = demuxer->priv;
+    if (mf) {
+        talloc_free(mf->prefetch);
+        mf->prefetch = NULL;
+    }
 }
 
 static int demux_control_mf(demuxer_t *demuxer, int cmd, void *arg)
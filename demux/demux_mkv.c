@@ -26,11 +26,13 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include <libavutil/common.h>
 #include <libavutil/lzo.h>
 #include <libavutil/intreadwrite.h>
 #include <libavutil/avstring.h>
+#include <libavutil/md5.h>
 
 #include <libavcodec/avcodec.h>
 #include <libavcodec/version.h>
@@ -44,6 +46,7 @@
 #include "talloc.h"
 #include "common/av_common.h"
 #include "options/options.h"
+#include "options/path.h"
 #include "misc/bstr.h"
 #include "stream/stream.h"
 #include "video/csputils.h"
@@ -152,6 +155,15 @@ typedef struct mkv_index {
     uint64_t timecode, filepos;
 } mkv_index_t;
 
+// Position of a video keyframe block inside a cluster, with the cluster
+// state needed to resume reading from there.
+struct block_position {
+    int tnum;
+    uint64_t timecode;          // in ns
+    int64_t pos;                // file position of the (Simple)Block element
+    uint64_t cluster_start, cluster_end, cluster_tc;
+};
+
 typedef struct mkv_demuxer {
     int64_t segment_start, segment_end;
 
@@ -171,6 +183,15 @@ typedef struct mkv_demuxer {
     mkv_index_t *indexes;
     size_t num_indexes;
     bool index_complete;
+    char *index_file;           // --demuxer-mkv-index-dir file, or NULL
+    char *index_header;         // identifies the file in index_file
+    size_t index_saved;         // entries in index_file when it was loaded
+
+    // Keyframes seen while demuxing, sorted by pos. Unlike the index (which
+    // has cluster granularity, like cues), this allows seeking to the exact
+    // keyframe before the target in visited parts of the file.
+    struct block_position *block_positions;
+    int num_block_positions;
     uint64_t deferred_cues;
 
     struct header_elem {
@@ -183,6 +204,8 @@ typedef struct mkv_demuxer {
     uint64_t skip_to_timecode;
     int v_skip_to_keyframe, a_skip_to_keyframe;
     int subtitle_preroll;
+
+    struct demux_packet_pool *packet_pool;
 } mkv_demuxer_t;
 
 #define REALHEADER_SIZE    16
@@ -190,10 +213,18 @@ typedef struct mkv_demuxer {
 #define RAPROPERTIES4_SIZE 56
 #define RAPROPERTIES5_SIZE 70
 
+// Maximum number of entries in mkv_demuxer.block_positions.
+#define MAX_BLOCK_POSITIONS 4096
+
 // Maximum number of subtitle packets that are accepted for pre-roll.
 // (Subtitle packets added before first A/V keyframe packet is found with seek.)
 #define NUM_SUB_PREROLL_PACKETS 500
 
+// Header of the files in --demuxer-mkv-index-dir (followed by the file
+// identity and the index entries).
+#define INDEX_MAGIC "mpv mkv index 1\n"
+#define INDEX_ENTRY_SIZE 20
+
 #define AAC_SYNC_EXTENSION_TYPE 0x02b7
 static int aac_get_sample_rate_index(uint32_t sample_rate)
 {
@@ -359,6 +390,10 @@ static int demux_mkv_read_info(demuxer_t *demuxer)
                 MP_VERBOSE(demuxer, " %02x",
                        demuxer->matroska_data.uid.segment[i]);
             MP_VERBOSE(demuxer, "\n");
+            if (demuxer->params && demuxer->params->matroska_read_uid) {
+                memcpy(demuxer->params->matroska_read_uid->segment,
+                       info.segment_uid.start, len);
+            }
         }
     }
     if (demuxer->params && demuxer->params->matroska_wanted_uids) {
@@ -683,6 +718,103 @@ static void add_block_position(demuxer_t *demuxer, struct mkv_track *track,
     track->last_index_entry = mkv_d->num_indexes - 1;
 }
 
+// Restore an index built by scanning in a previous session. The entries are
+// used as if they were created by add_block_position().
+static void load_index(demuxer_t *demuxer)
+{
+    mkv_demuxer_t *mkv_d = (mkv_demuxer_t *) demuxer->priv;
+    struct matroska_segment_uid *uid = &demuxer->matroska_data.uid;
+
+    int64_t size = -1;
+    stream_control(demuxer->stream, STREAM_CTRL_GET_SIZE, &size);
+    if (size <= 0 || !demuxer->stream->url)
+        return;
+
+    char *dir = mp_get_user_path(mkv_d, demuxer->global,
+                                 demuxer->opts->mkv_index_dir);
+    mp_mkdirp(dir);
+    // The URL, the file size and the segment identify the file.
+    char *key = talloc_asprintf(mkv_d, "%"PRId64"\n%s\n%"PRId64"\n", size,
+                                demuxer->stream->url, mkv_d->segment_start);
+    for (int i = 0; i < 16; i++)
+        key = talloc_asprintf_append(key, "%02X", uid->segment[i]);
+    key = talloc_asprintf_append(key, "\n");
+    uint8_t md5[16];
+    av_md5_sum(md5, key, strlen(key));
+    char *name = talloc_strdup(mkv_d, "");
+    for (int i = 0; i < 16; i++)
+        name = talloc_asprintf_append(name, "%02X", md5[i]);
+    mkv_d->index_header = talloc_asprintf(mkv_d, INDEX_MAGIC "%s", key);
+    mkv_d->index_file = talloc_asprintf(mkv_d, "%s/%s.index", dir, name);
+
+    FILE *f = fopen(mkv_d->index_file, "rb");
+    if (!f)
+        return;
+    size_t header_len = strlen(mkv_d->index_header);
+    char *header = talloc_size(NULL, header_len);
+    bool ok = fread(header, header_len, 1, f) == 1 &&
+              memcmp(header, mkv_d->index_header, header_len) == 0;
+    talloc_free(header);
+    uint8_t buf[INDEX_ENTRY_SIZE];
+    while (ok && fread(buf, sizeof(buf), 1, f) == 1) {
+        int tnum = AV_RL32(buf);
+        uint64_t timecode = AV_RL64(buf + 4);
+        uint64_t filepos = AV_RL64(buf + 12);
+        struct mkv_track *track = NULL;
+        for (int n = 0; n < mkv_d->num_tracks; n++) {
+            if (mkv_d->tracks[n]->tnum == tnum)
+                track = mkv_d->tracks[n];
+        }
+        ok = track && filepos >= mkv_d->segment_start && filepos < size;
+        if (ok && track->last_index_entry != (size_t)-1)
+            ok = mkv_d->indexes[track->last_index_entry].timecode < timecode;
+        if (ok) {
+            cue_index_add(demuxer, tnum, filepos, timecode);
+            track->last_index_entry = mkv_d->num_indexes - 1;
+        }
+    }
+    fclose(f);
+
+    if (!ok) {
+        MP_WARN(demuxer, "Ignoring invalid index file '%s'.\n",
+                mkv_d->index_file);
+        mkv_d->num_indexes = 0;
+        for (int n = 0; n < mkv_d->num_tracks; n++)
+            mkv_d->tracks[n]->last_index_entry = (size_t)-1;
+        return;
+    }
+    mkv_d->index_saved = mkv_d->num_indexes;
+    MP_VERBOSE(demuxer, "Loaded %zu index entries from '%s'.\n",
+               mkv_d->num_indexes, mkv_d->index_file);
+}
+
+// Write the index for load_index() if more of the file was scanned.
+static void save_index(demuxer_t *demuxer)
+{
+    mkv_demuxer_t *mkv_d = (mkv_demuxer_t *) demuxer->priv;
+    if (!mkv_d->index_file || mkv_d->index_complete ||
+        mkv_d->num_indexes <= mkv_d->index_saved)
+        return;
+
+    FILE *f = fopen(mkv_d->index_file, "wb");
+    bool ok = f && fwrite(mkv_d->index_header, strlen(mkv_d->index_header),
+                          1, f) == 1;
+    for (size_t n = 0; ok && n < mkv_d->num_indexes; n++) {
+        mkv_index_t *index = &mkv_d->indexes[n];
+        uint8_t buf[INDEX_ENTRY_SIZE];
+        AV_WL32(buf, index->tnum);
+        AV_WL64(buf + 4, index->timecode);
+        AV_WL64(buf + 12, index->filepos);
+        ok = fwrite(buf, sizeof(buf), 1, f) == 1;
+    }
+    if (f && fclose(f))
+        ok = false;
+    if (!ok) {
+        MP_ERR(demuxer, "Can't write index file '%s'.\n", mkv_d->index_file);
+        unlink(mkv_d->index_file);
+    }
+}
+
 static int demux_mkv_read_cues(demuxer_t *demuxer)
 {
     struct MPOpts *opts = demuxer->opts;
@@ -962,6 +1094,14 @@ static int demux_mkv_read_attachments(demuxer_t *demuxer)
 {
     stream_t *s = demuxer->stream;
 
+    // Attachments are only used for embedded subtitle fonts. Don't read what
+    // is going to be thrown away; fonts can take up tens of megabytes.
+    if (!demuxer->opts->ass_enabled || !demuxer->opts->use_embedded_fonts) {
+        MP_VERBOSE(demuxer, "Skipping attachments (embedded fonts unused).\n");
+        ebml_read_skip(demuxer->log, -1, s);
+        return 0;
+    }
+
     MP_VERBOSE(demuxer, "/---- [ parsing attachments ] ---------\n");
 
     struct ebml_attachments attachments = {0};
@@ -970,6 +1110,7 @@ static int demux_mkv_read_attachments(demuxer_t *demuxer)
                           &ebml_attachments_desc) < 0)
         return -1;
 
+    int num_before = demuxer->num_attachments;
     for (int i = 0; i < attachments.n_attached_file; i++) {
         struct ebml_attached_file *attachment = &attachments.attached_file[i];
         if (!attachment->n_file_name || !attachment->n_file_mime_type
@@ -979,12 +1120,18 @@ static int demux_mkv_read_attachments(demuxer_t *demuxer)
         }
         struct bstr name = attachment->file_name;
         struct bstr mime = attachment->file_mime_type;
-        demuxer_add_attachment(demuxer, name, mime, attachment->file_data);
+        demuxer_add_attachment_ref(demuxer, name, mime, attachment->file_data);
         MP_VERBOSE(demuxer, "Attachment: %.*s, %.*s, %zu bytes\n",
                    BSTR_P(name), BSTR_P(mime), attachment->file_data.len);
     }
 
-    talloc_free(parse_ctx.talloc_ctx);
+    // The attachment data points into the element buffer; keep it instead of
+    // copying every file out of it.
+    if (demuxer->num_attachments > num_before) {
+        talloc_steal(demuxer, parse_ctx.talloc_ctx);
+    } else {
+        talloc_free(parse_ctx.talloc_ctx);
+    }
     MP_VERBOSE(demuxer, "\\---- [ parsing attachments ] ---------\n");
     return 0;
 }
@@ -1747,6 +1894,7 @@ static int demux_mkv_open(demuxer_t *demuxer, enum demux_check check)
 
     mkv_d = talloc_zero(demuxer, struct mkv_demuxer);
     demuxer->priv = mkv_d;
+    mkv_d->packet_pool = demux_packet_pool_create(mkv_d);
     mkv_d->tc_scale = 1000000;
     mkv_d->segment_start = stream_tell(s);
     mkv_d->segment_end = end_pos;
@@ -1815,6 +1963,12 @@ static int demux_mkv_open(demuxer_t *demuxer, enum demux_check check)
 
     MP_VERBOSE(demuxer, "All headers are parsed!\n");
 
+    // Without cues, the index is built by scanning clusters.
+    if (demuxer->opts->mkv_index_dir && demuxer->opts->mkv_index_dir[0] &&
+        demuxer->opts->index_mode == 1 && !mkv_d->index_complete &&
+        !mkv_d->deferred_cues)
+        load_index(demuxer);
+
     process_tags(demuxer);
     display_create_tracks(demuxer);
 
@@ -1951,7 +2105,7 @@ static void handle_realvideo(demuxer_t *demuxer, mkv_track_t *track,
     demux_packet_t *dp;
     int64_t timestamp = mkv_d->last_pts * 1000;
 
-    dp = new_demux_packet_from(data.start, data.len);
+    dp = new_demux_packet_from_pool(mkv_d->packet_pool, data.start, data.len);
     if (!dp)
         return;
 
@@ -2070,8 +2224,9 @@ static void handle_realaudio(demuxer_t *demuxer, mkv_track_t *track,
                 goto error;
             // Release all the audio packets
             for (int x = 0; x < sph * w / apk_usize; x++) {
-                dp = new_demux_packet_from(track->audio_buf + x * apk_usize,
-                                           apk_usize);
+                dp = new_demux_packet_from_pool(mkv_d->packet_pool,
+                                                track->audio_buf + x * apk_usize,
+                                                apk_usize);
                 if (!dp)
                     goto error;
                 /* Put timestamp only on packets that correspond to original
@@ -2084,7 +2239,7 @@ static void handle_realaudio(demuxer_t *demuxer, mkv_track_t *track,
             }
         }
     } else { // Not a codec that requires reordering
-        dp = new_demux_packet_from(buffer, size);
+        dp = new_demux_packet_from_pool(mkv_d->packet_pool, buffer, size);
         if (!dp)
             goto error;
         if (track->ra_pts == mkv_d->last_pts && !mkv_d->a_skip_to_keyframe)
@@ -2265,6 +2420,7 @@ struct block_info {
     bstr data;
     void *alloc;
     int64_t filepos;
+    int64_t element_pos;    // start of the BlockGroup/SimpleBlock element
 };
 
 static void free_block(struct block_info *block)
@@ -2274,15 +2430,97 @@ static void free_block(struct block_info *block)
     block->data = (bstr){0};
 }
 
+static void cache_block_position(demuxer_t *demuxer, struct block_info *block)
+{
+    mkv_demuxer_t *mkv_d = (mkv_demuxer_t *) demuxer->priv;
+    // Audio usually consists of keyframes only; cluster granularity is fine.
+    if (block->track->type != MATROSKA_TRACK_VIDEO)
+        return;
+
+    // Find the insertion point (usually at the end).
+    int lo = 0, hi = mkv_d->num_block_positions;
+    if (hi && mkv_d->block_positions[hi - 1].pos >= block->element_pos) {
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (mkv_d->block_positions[mid].pos < block->element_pos) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < mkv_d->num_block_positions &&
+            mkv_d->block_positions[lo].pos == block->element_pos)
+            return; // already known
+    } else {
+        lo = hi;
+    }
+
+    if (mkv_d->num_block_positions >= MAX_BLOCK_POSITIONS) {
+        // Forget the entry furthest away from the new one.
+        if (lo > mkv_d->num_block_positions / 2) {
+            MP_TARRAY_REMOVE_AT(mkv_d->block_positions,
+                                mkv_d->num_block_positions, 0);
+            lo--;
+        } else {
+            mkv_d->num_block_positions--;
+        }
+    }
+
+    struct block_position bp = {
+        .tnum = block->track->tnum,
+        .timecode = block->timecode,
+        .pos = block->element_pos,
+        .cluster_start = mkv_d->cluster_start,
+        .cluster_end = mkv_d->cluster_end,
+        .cluster_tc = mkv_d->cluster_tc,
+    };
+    MP_TARRAY_INSERT_AT(mkv_d, mkv_d->block_positions,
+                        mkv_d->num_block_positions, lo, bp);
+}
+
 static void index_block(demuxer_t *demuxer, struct block_info *block)
 {
     mkv_demuxer_t *mkv_d = (mkv_demuxer_t *) demuxer->priv;
     if (block->keyframe) {
         add_block_position(demuxer, block->track, mkv_d->cluster_start,
                            block->timecode / mkv_d->tc_scale);
+        cache_block_position(demuxer, block);
     }
 }
 
+// Look at the Block header at the current position, and if the track is not
+// selected, skip the block without reading its payload. The track, timecode
+// and (for SimpleBlocks) keyframe flag are still set in block, so that the
+// block can be indexed; block->data stays empty.
+static bool skip_unselected_block(demuxer_t *demuxer, uint64_t length,
+                                  struct block_info *block)
+{
+    mkv_demuxer_t *mkv_d = (mkv_demuxer_t *) demuxer->priv;
+    stream_t *s = demuxer->stream;
+
+    bstr header = stream_peek(s, FFMIN(length, 8 + 3));
+    uint64_t num = ebml_read_vlen_uint(&header);
+    if (num == EBML_UINT_INVALID || header.len < 3)
+        return false;
+    mkv_track_t *track = NULL;
+    for (int i = 0; i < mkv_d->num_tracks; i++) {
+        if (mkv_d->tracks[i]->tnum == num) {
+            track = mkv_d->tracks[i];
+            break;
+        }
+    }
+    if (track && demux_stream_is_selected(track->stream))
+        return false;
+    if (!stream_skip(s, length))
+        return false;
+    int16_t time = header.start[0] << 8 | header.start[1];
+    block->track = track;
+    block->timecode = time * mkv_d->tc_scale + mkv_d->cluster_tc;
+    if (block->simple)
+        block->keyframe = header.start[2] & 0x80;
+    return true;
+}
+
 static int read_block(demuxer_t *demuxer, int64_t end, struct block_info *block)
 {
     mkv_demuxer_t *mkv_d = (mkv_demuxer_t *) demuxer->priv;
@@ -2296,13 +2534,23 @@ static int read_block(demuxer_t *demuxer, int64_t end, struct block_info *block)
     length = ebml_read_length(s);
     if (length > 500000000 || stream_tell(s) + length > (uint64_t)end)
         goto exit;
-    block->alloc = malloc(length + AV_LZO_INPUT_PADDING);
-    if (!block->alloc)
-        goto exit;
-    block->data = (bstr){block->alloc, length};
     block->filepos = stream_tell(s);
-    if (stream_read(s, block->data.start, block->data.len) != block->data.len)
+    if (skip_unselected_block(demuxer, length, block)) {
+        res = 0;
         goto exit;
+    }
+    // SimpleBlocks are handled before the next stream access, so the data
+    // can be used without copying it (if the stream supports it).
+    if (block->simple)
+        block->data = stream_read_direct(s, length);
+    if (!block->data.start) {
+        block->alloc = malloc(length + AV_LZO_INPUT_PADDING);
+        if (!block->alloc)
+            goto exit;
+        block->data = (bstr){block->alloc, length};
+        if (stream_read(s, block->data.start, block->data.len) != block->data.len)
+            goto exit;
+    }
 
     // Parse header of the Block element
     /* first byte(s): track num */
@@ -2329,6 +2577,15 @@ static int read_block(demuxer_t *demuxer, int64_t end, struct block_info *block)
         goto exit;
     }
 
+    // Decompression might need input padding.
+    if (!block->alloc && block->track->num_encodings) {
+        block->alloc = malloc(block->data.len + AV_LZO_INPUT_PADDING);
+        if (!block->alloc)
+            goto exit;
+        memcpy(block->alloc, block->data.start, block->data.len);
+        block->data.start = block->alloc;
+    }
+
     res = 1;
 exit:
     if (res <= 0)
@@ -2403,7 +2660,8 @@ static int handle_block(demuxer_t *demuxer, struct block_info *block_info)
                 bstr buffer;
                 while (raw.start && mkv_parse_packet(track, &raw, &buffer)) {
                     demux_packet_t *dp =
-                        new_demux_packet_from(buffer.start, buffer.len);
+                        new_demux_packet_from_pool(mkv_d->packet_pool,
+                                                   buffer.start, buffer.len);
                     if (!dp)
                         break;
                     dp->keyframe = keyframe;
@@ -2511,8 +2769,11 @@ static int read_next_block(demuxer_t *demuxer, struct block_info *block)
                 int res = read_block_group(demuxer, end, block);
                 if (res < 0)
                     goto find_next_cluster;
+                block->element_pos = start_filepos;
                 if (res > 0)
                     return 1;
+                if (block->track)
+                    index_block(demuxer, block); // skipped block
                 break;
             }
 
@@ -2521,8 +2782,11 @@ static int read_next_block(demuxer_t *demuxer, struct block_info *block)
                 int res = read_block(demuxer, mkv_d->cluster_end, block);
                 if (res < 0)
                     goto find_next_cluster;
+                block->element_pos = start_filepos;
                 if (res > 0)
                     return 1;
+                if (block->track)
+                    index_block(demuxer, block); // skipped block
                 break;
             }
 
@@ -2698,6 +2962,47 @@ static struct mkv_index *seek_with_cues(struct demuxer *demuxer, int seek_id,
     return index;
 }
 
+// Return a cached keyframe of the given track that is closer to the target
+// than the index entry (which can be NULL), or NULL.
+static struct block_position *seek_with_block_positions(struct demuxer *demuxer,
+                                    int seek_id, int64_t target_timecode,
+                                    int flags, struct mkv_index *index)
+{
+    struct mkv_demuxer *mkv_d = demuxer->priv;
+    bool backward = flags & SEEK_BACKWARD;
+    struct block_position *best = NULL;
+
+    for (int n = 0; n < mkv_d->num_block_positions; n++) {
+        struct block_position *bp = &mkv_d->block_positions[n];
+        if (bp->tnum != seek_id)
+            continue;
+        int64_t tc = bp->timecode;
+        if (backward ? tc > target_timecode : tc < target_timecode)
+            continue;
+        if (!best || (backward ? tc > best->timecode : tc < best->timecode))
+            best = bp;
+    }
+
+    if (best && index) {
+        int64_t index_tc = index->timecode * mkv_d->tc_scale;
+        bool index_ok = backward ? index_tc <= target_timecode
+                                 : index_tc >= target_timecode;
+        int64_t tc = best->timecode;
+        if (index_ok && (backward ? tc <= index_tc : tc >= index_tc))
+            best = NULL;
+    }
+
+    if (best) {
+        MP_VERBOSE(demuxer, "seeking to cached keyframe at %"PRIu64"\n",
+                   best->pos);
+        stream_seek(demuxer->stream, best->pos);
+        mkv_d->cluster_start = best->cluster_start;
+        mkv_d->cluster_end = best->cluster_end;
+        mkv_d->cluster_tc = best->cluster_tc;
+    }
+    return best;
+}
+
 static void demux_mkv_seek(demuxer_t *demuxer, double rel_seek_secs, int flags)
 {
     mkv_demuxer_t *mkv_d = demuxer->priv;
@@ -2732,6 +3037,7 @@ static void demux_mkv_seek(demuxer_t *demuxer, double rel_seek_secs, int flags)
 
     if (!(flags & SEEK_FACTOR)) {       /* time in secs */
         mkv_index_t *index = NULL;
+        struct block_position *bp = NULL;
 
         if (!(flags & SEEK_ABSOLUTE))   /* relative seek */
             rel_seek_secs += mkv_d->last_pts;
@@ -2745,7 +3051,13 @@ static void demux_mkv_seek(demuxer_t *demuxer, double rel_seek_secs, int flags)
                 index = seek_with_cues(demuxer, -1, target_timecode, flags);
         }
 
-        if (!index)
+        // Subtitle preroll needs to start before the target cluster.
+        if (st_active[STREAM_VIDEO] && !(flags & SEEK_SUBPREROLL)) {
+            bp = seek_with_block_positions(demuxer, v_tnum, target_timecode,
+                                           flags, index);
+        }
+
+        if (!index && !bp)
             stream_seek(demuxer->stream, old_pos);
 
         mkv_d->v_skip_to_keyframe = st_active[STREAM_VIDEO];
@@ -2753,6 +3065,8 @@ static void demux_mkv_seek(demuxer_t *demuxer, double rel_seek_secs, int flags)
 
         if (flags & SEEK_FORWARD) {
             mkv_d->skip_to_timecode = target_timecode;
+        } else if (bp) {
+            mkv_d->skip_to_timecode = bp->timecode;
         } else {
             mkv_d->skip_to_timecode = index ? index->timecode * mkv_d->tc_scale
                                             : 0;
@@ -2823,16 +3137,24 @@ static void mkv_free(struct demuxer *demuxer)
     struct mkv_demuxer *mkv_d = demuxer->priv;
     if (!mkv_d)
         return;
+    save_index(demuxer);
     mkv_seek_reset(demuxer);
     for (int i = 0; i < mkv_d->num_tracks; i++)
         demux_mkv_free_trackentry(mkv_d->tracks[i]);
 }
 
+static bool demux_mkv_probe(struct stream *s, bstr data, enum demux_check check)
+{
+    // EBML header ID (see read_ebml_header())
+    return bstr_startswith0(data, "\x1a\x45\xdf\xa3");
+}
+
 const demuxer_desc_t demuxer_desc_matroska = {
     .name = "mkv",
     .desc = "Matroska",
     .type = DEMUXER_TYPE_MATROSKA,
     .open = demux_mkv_open,
+    .probe = demux_mkv_probe,
     .fill_buffer = demux_mkv_fill_buffer,
     .close = mkv_free,
     .seek = demux_mkv_seek,
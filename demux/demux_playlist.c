@@ -26,6 +26,8 @@
 #include "demux.h"
 
 #define PROBE_SIZE (8 * 1024)
+// Larger files are read line by line.
+#define MAX_FILE_SIZE (64 * 1024 * 1024)
 
 struct pl_parser {
     struct mp_log *log;
@@ -36,6 +38,13 @@ struct pl_parser {
     bool error;
     bool probing;
     bool force;
+    // If in_memory is set, the whole file was read into file, and lines are
+    // scanned from it without copying. (UTF-16 files and files larger than
+    // MAX_FILE_SIZE use the line reader.)
+    bool in_memory;
+    bstr file;
+    bstr rest;          // not yet scanned part of file
+    bool file_eof;      // tried to read a line past the end of file
 };
 
 static char *pl_get_line0(struct pl_parser *p)
@@ -53,6 +62,10 @@ static char *pl_get_line0(struct pl_parser *p)
 
 static bstr pl_get_line(struct pl_parser *p)
 {
+    if (p->in_memory) {
+        p->file_eof |= !p->rest.len;
+        return bstr_strip_linebreaks(bstr_getline(p->rest, &p->rest));
+    }
     return bstr0(pl_get_line0(p));
 }
 
@@ -65,9 +78,29 @@ static void pl_add(struct pl_parser *p, bstr entry)
 
 static bool pl_eof(struct pl_parser *p)
 {
+    if (p->in_memory)
+        return p->error || p->file_eof;
     return p->error || p->s->eof;
 }
 
+// Read the rest of the stream for scanning it in memory, if possible.
+static void pl_read_file(struct pl_parser *p)
+{
+    p->in_memory = p->utf16 != 1 && p->utf16 != 2;
+    if (!p->in_memory)
+        return;
+    int64_t pos = stream_tell(p->s);
+    p->file = stream_read_complete(p->s, p, MAX_FILE_SIZE);
+    if (!p->file.start) {
+        // Too large (or a read error): go back and use the line reader.
+        p->in_memory = false;
+        p->error |= !stream_seek(p->s, pos);
+        return;
+    }
+    p->rest = p->file;
+    p->file_eof = false;
+}
+
 static int parse_m3u(struct pl_parser *p)
 {
     bstr line = bstr_strip(pl_get_line(p));
@@ -189,6 +222,8 @@ static const struct pl_format *probe_pl(struct pl_parser *p)
     for (int n = 0; n < MP_ARRAY_SIZE(formats); n++) {
         const struct pl_format *fmt = &formats[n];
         stream_seek(p->s, start);
+        p->rest = p->file;
+        p->file_eof = false;
         if (check_mimetype(p->s, fmt->mime_types)) {
             MP_VERBOSE(p, "forcing format by mime-type.\n");
             p->force = true;
@@ -214,6 +249,7 @@ static int open_file(struct demuxer *demuxer, enum demux_check check)
     p->utf16 = stream_skip_bom(p->s);
     p->force = force;
     p->probing = true;
+    pl_read_file(p);
     const struct pl_format *fmt = probe_pl(p);
     free_stream(p->s);
     playlist_clear(p->pl);
@@ -226,6 +262,8 @@ static int open_file(struct demuxer *demuxer, enum demux_check check)
     p->error = false;
     p->s = demuxer->stream;
     p->utf16 = stream_skip_bom(p->s);
+    talloc_free(p->file.start);
+    pl_read_file(p);
     bool ok = fmt->parse(p) >= 0 && !p->error;
     if (ok)
         playlist_add_base_path(p->pl, mp_dirname(demuxer->filename));
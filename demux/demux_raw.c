@@ -300,10 +300,16 @@ static int raw_control(demuxer_t *demuxer, int cmd, void *arg)
     }
 }
 
+static bool raw_probe(struct stream *s, bstr data, enum demux_check check)
+{
+    return check == DEMUX_CHECK_REQUEST || check == DEMUX_CHECK_FORCE;
+}
+
 const demuxer_desc_t demuxer_desc_rawaudio = {
     .name = "rawaudio",
     .desc = "Uncompressed audio",
     .open = demux_rawaudio_open,
+    .probe = raw_probe,
     .fill_buffer = raw_fill_buffer,
     .seek = raw_seek,
     .control = raw_control,
@@ -313,6 +319,7 @@ const demuxer_desc_t demuxer_desc_rawvideo = {
     .name = "rawvideo",
     .desc = "Uncompressed video",
     .open = demux_rawvideo_open,
+    .probe = raw_probe,
     .fill_buffer = raw_fill_buffer,
     .seek = raw_seek,
     .control = raw_control,
@@ -821,10 +821,16 @@ static int d_control(struct demuxer *demuxer, int cmd, void *arg)
     }
 }
 
+static bool d_probe(struct stream *s, bstr data, enum demux_check check)
+{
+    return check <= DEMUX_CHECK_REQUEST;
+}
+
 const struct demuxer_desc demuxer_desc_subreader = {
     .name = "subreader",
     .desc = "Deprecated MPlayer subreader",
     .open = d_open_file,
+    .probe = d_probe,
     .fill_buffer = d_fill_buffer,
     .seek = d_seek,
     .control = d_control,
@@ -347,6 +347,24 @@ static double ebml_parse_float(uint8_t *data, int length)
 }
 
 
+// Return the index of the field with the given ID, or -1. Children of a master
+// element mostly come in runs of the same ID (CuePoints in Cues, SimpleTags in
+// a Tag, BlockGroups in a Cluster), so the field found last time is checked
+// before scanning the descriptor table.
+static int find_field(const struct ebml_elem_desc *type, uint32_t id,
+                      int *last_idx)
+{
+    if (*last_idx >= 0 && type->fields[*last_idx].id == id)
+        return *last_idx;
+    for (int i = 0; i < type->field_count; i++) {
+        if (type->fields[i].id == id) {
+            *last_idx = i;
+            return i;
+        }
+    }
+    return -1;
+}
+
 // target must be initialized to zero
 static void ebml_parse_element(struct ebml_parse_ctx *ctx, void *target,
                                uint8_t *data, int size,
@@ -360,6 +378,7 @@ static void ebml_parse_element(struct ebml_parse_ctx *ctx, void *target,
     uint8_t *end = data + size;
     uint8_t *p = data;
     int num_elems[MAX_EBML_SUBELEMENTS] = {0};
+    int last_idx = -1;
     while (p < end) {
         uint8_t *startp = p;
         int len;
@@ -380,17 +399,14 @@ static void ebml_parse_element(struct ebml_parse_ctx *ctx, void *target,
         }
         p += len;
 
-        int field_idx = -1;
-        for (int i = 0; i < type->field_count; i++)
-            if (type->fields[i].id == id) {
-                field_idx = i;
-                num_elems[i]++;
-                if (num_elems[i] >= 0x70000000) {
-                    MP_ERR(ctx, "Too many EBML subelements.\n");
-                    goto other_error;
-                }
-                break;
+        int field_idx = find_field(type, id, &last_idx);
+        if (field_idx >= 0) {
+            num_elems[field_idx]++;
+            if (num_elems[field_idx] >= 0x70000000) {
+                MP_ERR(ctx, "Too many EBML subelements.\n");
+                goto other_error;
             }
+        }
 
         if (length > end - p) {
             if (field_idx >= 0 && type->fields[field_idx].desc->type
@@ -470,12 +486,7 @@ static void ebml_parse_element(struct ebml_parse_ctx *ctx, void *target,
             MP_DBG(ctx, "Next subelement content goes "
                    "past end of containing element, will be truncated\n");
         }
-        int field_idx = -1;
-        for (int i = 0; i < type->field_count; i++)
-            if (type->fields[i].id == id) {
-                field_idx = i;
-                break;
-            }
+        int field_idx = find_field(type, id, &last_idx);
         if (field_idx < 0) {
             if (id == 0xec)
                 MP_DBG(ctx, "%.*sIgnoring Void element "
@@ -26,19 +26,23 @@
 
 #include "packet.h"
 
+// Buffers allocated from a demux_packet_pool are rounded up to a power of 2
+// between these sizes (including padding). Larger packets are not pooled.
+#define POOL_MIN_SIZE 1024
+#define POOL_CLASSES 11
+
+struct demux_packet_pool {
+    AVBufferPool *pools[POOL_CLASSES];
+};
+
 static void packet_destroy(void *ptr)
 {
     struct demux_packet *dp = ptr;
     av_packet_unref(dp->avpacket);
 }
 
-// This actually preserves only data and side data, not PTS/DTS/pos/etc.
-// It also allows avpkt->data==NULL with avpkt->size!=0 - the libavcodec API
-// does not allow it, but we do it to simplify new_demux_packet().
-struct demux_packet *new_demux_packet_from_avpacket(struct AVPacket *avpkt)
+static struct demux_packet *alloc_packet(void)
 {
-    if (avpkt->size > 1000000000)
-        return NULL;
     struct demux_packet *dp = talloc(NULL, struct demux_packet);
     talloc_set_destructor(dp, packet_destroy);
     *dp = (struct demux_packet) {
@@ -50,6 +54,17 @@ struct demux_packet *new_demux_packet_from_avpacket(struct AVPacket *avpkt)
         .avpacket = talloc_zero(dp, AVPacket),
     };
     av_init_packet(dp->avpacket);
+    return dp;
+}
+
+// This actually preserves only data and side data, not PTS/DTS/pos/etc.
+// It also allows avpkt->data==NULL with avpkt->size!=0 - the libavcodec API
+// does not allow it, but we do it to simplify new_demux_packet().
+struct demux_packet *new_demux_packet_from_avpacket(struct AVPacket *avpkt)
+{
+    if (avpkt->size > 1000000000)
+        return NULL;
+    struct demux_packet *dp = alloc_packet();
     int r = -1;
     if (avpkt->data) {
         // We hope that this function won't need/access AVPacket input padding,
@@ -97,6 +112,63 @@ void free_demux_packet(struct demux_packet *dp)
     talloc_free(dp);
 }
 
+static void destroy_pool(void *ptr)
+{
+    struct demux_packet_pool *pool = ptr;
+    for (int n = 0; n < POOL_CLASSES; n++)
+        av_buffer_pool_uninit(&pool->pools[n]);
+}
+
+// Create a pool of packet buffers. Demuxers which allocate a new buffer for
+// each packet can use it to recycle the buffers instead. The pool can be
+// freed while packets allocated from it still exist.
+struct demux_packet_pool *demux_packet_pool_create(void *talloc_ctx)
+{
+    struct demux_packet_pool *pool = talloc_zero(talloc_ctx, struct demux_packet_pool);
+    talloc_set_destructor(pool, destroy_pool);
+    return pool;
+}
+
+// Like new_demux_packet(), but take the (padded) buffer from the pool. Must
+// be called from a single thread per pool (freeing the packet is allowed from
+// any thread).
+struct demux_packet *new_demux_packet_pool(struct demux_packet_pool *pool,
+                                           size_t len)
+{
+    int c = 0;
+    while (c < POOL_CLASSES &&
+           ((size_t)POOL_MIN_SIZE << c) < len + FF_INPUT_BUFFER_PADDING_SIZE)
+        c++;
+    if (!pool || c >= POOL_CLASSES)
+        return new_demux_packet(len);
+    if (!pool->pools[c]) {
+        pool->pools[c] = av_buffer_pool_init(POOL_MIN_SIZE << c, NULL);
+        if (!pool->pools[c])
+            return new_demux_packet(len);
+    }
+    AVBufferRef *buf = av_buffer_pool_get(pool->pools[c]);
+    if (!buf)
+        return NULL;
+    struct demux_packet *dp = alloc_packet();
+    dp->avpacket->buf = buf;
+    dp->avpacket->data = buf->data;
+    dp->avpacket->size = len;
+    memset(buf->data + len, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+    dp->buffer = dp->avpacket->data;
+    dp->len = len;
+    return dp;
+}
+
+// Input data doesn't need to be padded.
+struct demux_packet *new_demux_packet_from_pool(struct demux_packet_pool *pool,
+                                                void *data, size_t len)
+{
+    struct demux_packet *dp = new_demux_packet_pool(pool, len);
+    if (dp)
+        memcpy(dp->buffer, data, len);
+    return dp;
+}
+
 struct demux_packet *demux_copy_packet(struct demux_packet *dp)
 {
     struct demux_packet *new = NULL;
@@ -44,4 +44,11 @@ void demux_packet_shorten(struct demux_packet *dp, size_t len);
 void free_demux_packet(struct demux_packet *dp);
 struct demux_packet *demux_copy_packet(struct demux_packet *dp);
 
+struct demux_packet_pool;
+struct demux_packet_pool *demux_packet_pool_create(void *talloc_ctx);
+struct demux_packet *new_demux_packet_pool(struct demux_packet_pool *pool,
+                                           size_t len);
+struct demux_packet *new_demux_packet_from_pool(struct demux_packet_pool *pool,
+                                                void *data, size_t len);
+
 #endif /* MPLAYER_DEMUX_PACKET_H */
@@ -24,6 +24,7 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <errno.h>
+#include <math.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -45,6 +46,7 @@
 #include "osdep/threads.h"
 #include "osdep/timer.h"
 #include "common/msg.h"
+#include "common/stats.h"
 #include "common/global.h"
 #include "options/m_config.h"
 #include "options/m_option.h"
@@ -64,6 +66,9 @@
 
 #define MP_MAX_KEY_DOWN 4
 
+// Number of hash buckets per bind section (must be a power of 2).
+#define BIND_HASH_SIZE 64
+
 struct cmd_bind {
     int keys[MP_MAX_KEY_DOWN];
     int num_keys;
@@ -79,6 +84,13 @@ struct cmd_bind_section {
     char *section;
     struct mp_rect mouse_area;  // set at runtime, if at all
     bool mouse_area_set;        // mouse_area is valid and should be tested
+    // Binds hashed by their last key (which must match the key that was just
+    // pressed). hash_heads[] and hash_next[] contain indexes into binds[], or
+    // -1 for the end of a chain. Each chain is sorted by index. Rebuilt on
+    // the next lookup if hash_valid is false.
+    int hash_heads[BIND_HASH_SIZE];
+    int *hash_next;
+    bool hash_valid;
     struct cmd_bind_section *next;
 };
 
@@ -89,6 +101,7 @@ struct cmd_bind_section {
 struct active_section {
     char *name;
     int flags;
+    struct cmd_bind_section *bs; // sections are never freed
 };
 
 struct cmd_queue {
@@ -100,6 +113,7 @@ struct input_ctx {
     sem_t wakeup;
     struct mp_log *log;
     struct mpv_global *global;
+    struct m_config_cache *opts_cache;
     struct input_opts *opts;
 
     bool using_alt_gr;
@@ -368,14 +382,46 @@ static void key_buf_add(int *buf, int code)
     buf[0] = code;
 }
 
-static struct cmd_bind *find_bind_for_key_section(struct input_ctx *ictx,
-                                                  char *section, int code)
+static unsigned int bind_hash(int code)
 {
-    struct cmd_bind_section *bs = get_bind_section(ictx, bstr0(section));
+    return ((unsigned int)code * 2654435761u) >> 16 & (BIND_HASH_SIZE - 1);
+}
+
+static void invalidate_bind_hash(struct cmd_bind_section *bs)
+{
+    bs->hash_valid = false;
+}
+
+static void update_bind_hash(struct cmd_bind_section *bs)
+{
+    if (bs->hash_valid)
+        return;
+    for (int n = 0; n < BIND_HASH_SIZE; n++)
+        bs->hash_heads[n] = -1;
+    bs->hash_next = talloc_realloc(bs, bs->hash_next, int, bs->num_binds);
+    // Prepend in reverse order, so that each chain is sorted by index.
+    for (int n = bs->num_binds - 1; n >= 0; n--) {
+        struct cmd_bind *b = &bs->binds[n];
+        if (!b->num_keys) {
+            bs->hash_next[n] = -1;
+            continue;
+        }
+        unsigned int h = bind_hash(b->keys[b->num_keys - 1]);
+        bs->hash_next[n] = bs->hash_heads[h];
+        bs->hash_heads[h] = n;
+    }
+    bs->hash_valid = true;
+}
 
+static struct cmd_bind *find_bind_for_key_in(struct input_ctx *ictx,
+                                             struct cmd_bind_section *bs,
+                                             int code)
+{
     if (!bs->num_binds)
         return NULL;
 
+    update_bind_hash(bs);
+
     int keys[MP_MAX_KEY_DOWN];
     memcpy(keys, ictx->key_history, sizeof(keys));
     key_buf_add(keys, code);
@@ -388,7 +434,9 @@ static struct cmd_bind *find_bind_for_key_section(struct input_ctx *ictx,
             break;
         if (best)
             break;
-        for (int n = 0; n < bs->num_binds; n++) {
+        for (int n = bs->hash_heads[bind_hash(code)]; n >= 0;
+             n = bs->hash_next[n])
+        {
             if (bs->binds[n].is_builtin == (bool)builtin) {
                 struct cmd_bind *b = &bs->binds[n];
                 // we have: keys=[key2 key1 keyX ...]
@@ -406,6 +454,13 @@ static struct cmd_bind *find_bind_for_key_section(struct input_ctx *ictx,
     return best;
 }
 
+static struct cmd_bind *find_bind_for_key_section(struct input_ctx *ictx,
+                                                  char *section, int code)
+{
+    struct cmd_bind_section *bs = get_bind_section(ictx, bstr0(section));
+    return find_bind_for_key_in(ictx, bs, code);
+}
+
 static struct cmd_bind *find_any_bind_for_key(struct input_ctx *ictx,
                                               char *force_section, int code)
 {
@@ -426,7 +481,7 @@ static struct cmd_bind *find_any_bind_for_key(struct input_ctx *ictx,
     struct cmd_bind *best_bind = NULL;
     for (int i = ictx->num_active_sections - 1; i >= 0; i--) {
         struct active_section *s = &ictx->active_sections[i];
-        struct cmd_bind *bind = find_bind_for_key_section(ictx, s->name, code);
+        struct cmd_bind *bind = find_bind_for_key_in(ictx, s->bs, code);
         if (bind) {
             struct cmd_bind_section *bs = bind->owner;
             if (!use_mouse || (bs->mouse_area_set && test_rect(&bs->mouse_area,
@@ -444,13 +499,9 @@ static struct cmd_bind *find_any_bind_for_key(struct input_ctx *ictx,
     return best_bind;
 }
 
-static mp_cmd_t *get_cmd_from_keys(struct input_ctx *ictx, char *force_section,
-                                   int code)
+static mp_cmd_t *get_cmd_from_bind(struct input_ctx *ictx,
+                                   struct cmd_bind *cmd, int code)
 {
-    if (ictx->opts->test)
-        return handle_test(ictx, code);
-
-    struct cmd_bind *cmd = find_any_bind_for_key(ictx, force_section, code);
     if (cmd == NULL) {
         int msgl = MSGL_WARN;
         if (code == MP_KEY_MOUSE_MOVE || code == MP_KEY_MOUSE_LEAVE)
@@ -478,7 +529,18 @@ static mp_cmd_t *get_cmd_from_keys(struct input_ctx *ictx, char *force_section,
     return ret;
 }
 
-static void update_mouse_section(struct input_ctx *ictx)
+static mp_cmd_t *get_cmd_from_keys(struct input_ctx *ictx, char *force_section,
+                                   int code)
+{
+    if (ictx->opts->test)
+        return handle_test(ictx, code);
+
+    struct cmd_bind *cmd = find_any_bind_for_key(ictx, force_section, code);
+    return get_cmd_from_bind(ictx, cmd, code);
+}
+
+// Returns the bind for MP_KEY_MOUSE_MOVE at the current mouse position.
+static struct cmd_bind *update_mouse_section(struct input_ctx *ictx)
 {
     struct cmd_bind *bind =
         find_any_bind_for_key(ictx, NULL, MP_KEY_MOUSE_MOVE);
@@ -493,6 +555,8 @@ static void update_mouse_section(struct input_ctx *ictx)
                old, ictx->mouse_section);
         mp_input_queue_cmd(ictx, get_cmd_from_keys(ictx, old, MP_KEY_MOUSE_LEAVE));
     }
+
+    return bind;
 }
 
 // Called when the currently held-down key is released. This (usually) sends
@@ -732,8 +796,25 @@ void mp_input_set_mouse_pos(struct input_ctx *ictx, int x, int y)
     ictx->mouse_vo_x = x;
     ictx->mouse_vo_y = y;
 
-    update_mouse_section(ictx);
-    struct mp_cmd *cmd = get_cmd_from_keys(ictx, NULL, MP_KEY_MOUSE_MOVE);
+    struct cmd_bind *bind = update_mouse_section(ictx);
+
+    // If the last queued command is a mouse move resolving to the same bind,
+    // update its position instead of parsing the command again.
+    struct mp_cmd *tail = queue_peek_tail(&ictx->cmd_queue);
+    if (tail && tail->mouse_move && !ictx->opts->test &&
+        (bind ? tail->input_section == bind->owner->section &&
+                bstr_equals(tail->original, bstr_strip(bstr0(bind->cmd)))
+              : tail->id == MP_CMD_IGNORE))
+    {
+        tail->mouse_x = x;
+        tail->mouse_y = y;
+        input_unlock(ictx);
+        return;
+    }
+
+    struct mp_cmd *cmd = ictx->opts->test
+        ? handle_test(ictx, MP_KEY_MOUSE_MOVE)
+        : get_cmd_from_bind(ictx, bind, MP_KEY_MOUSE_MOVE);
     if (!cmd)
         cmd = mp_input_parse_cmd(ictx, bstr0("ignore"), "<internal>");
 
@@ -745,7 +826,6 @@ void mp_input_set_mouse_pos(struct input_ctx *ictx, int x, int y)
             talloc_free(cmd);
         } else {
             // Coalesce with previous mouse move events (i.e. replace it)
-            struct mp_cmd *tail = queue_peek_tail(&ictx->cmd_queue);
             if (tail && tail->mouse_move) {
                 queue_remove(&ictx->cmd_queue, tail);
                 talloc_free(tail);
@@ -843,11 +923,15 @@ void mp_input_wait(struct input_ctx *ictx, double seconds)
     while (sem_trywait(&ictx->wakeup) == 0)
         seconds = -1;
     if (seconds > 0) {
-        MP_STATS(ictx, "start sleep");
-        struct timespec ts =
-            mp_time_us_to_timespec(mp_add_timeout(mp_time_us(), seconds));
-        sem_timedwait(&ictx->wakeup, &ts);
-        MP_STATS(ictx, "end sleep");
+        MP_STATS_START(ictx, "sleep");
+        if (isinf(seconds)) {
+            while (sem_wait(&ictx->wakeup) != 0 && errno == EINTR) {}
+        } else {
+            struct timespec ts =
+                mp_time_us_to_timespec(mp_add_timeout(mp_time_us(), seconds));
+            sem_timedwait(&ictx->wakeup, &ts);
+        }
+        MP_STATS_END(ictx, "sleep");
     }
 }
 
@@ -867,6 +951,9 @@ void mp_input_wakeup(struct input_ctx *ictx)
 mp_cmd_t *mp_input_read_cmd(struct input_ctx *ictx)
 {
     input_lock(ictx);
+    // Pick up changes done with e.g. the "input-..." properties.
+    if (ictx->opts_cache)
+        m_config_cache_update(ictx->opts_cache);
     struct mp_cmd *ret = queue_remove_head(&ictx->cmd_queue);
     if (!ret) {
         ret = check_autorepeat(ictx);
@@ -933,7 +1020,11 @@ void mp_input_enable_section(struct input_ctx *ictx, char *name, int flags)
             for (int n = ictx->num_active_sections; n > top; n--)
                 ictx->active_sections[n] = ictx->active_sections[n - 1];
         }
-        ictx->active_sections[top] = (struct active_section){name, flags};
+        ictx->active_sections[top] = (struct active_section){
+            .name = name,
+            .flags = flags,
+            .bs = get_bind_section(ictx, bstr0(name)),
+        };
         ictx->num_active_sections++;
     }
 
@@ -971,7 +1062,7 @@ static bool test_mouse(struct input_ctx *ictx, int x, int y, int rej_flags)
         struct active_section *as = &ictx->active_sections[i];
         if (as->flags & rej_flags)
             continue;
-        struct cmd_bind_section *s = get_bind_section(ictx, bstr0(as->name));
+        struct cmd_bind_section *s = as->bs;
         if (s->mouse_area_set && test_rect(&s->mouse_area, x, y)) {
             res = true;
             break;
@@ -1011,6 +1102,7 @@ static void remove_binds(struct cmd_bind_section *bs, bool builtin)
             bs->num_binds--;
         }
     }
+    invalidate_bind_hash(bs);
 }
 
 void mp_input_define_section(struct input_ctx *ictx, char *name, char *location,
@@ -1063,6 +1155,7 @@ static void bind_keys(struct input_ctx *ictx, bool builtin, bstr section,
         struct cmd_bind empty = {{0}};
         MP_TARRAY_APPEND(bs, bs->binds, bs->num_binds, empty);
         bind = &bs->binds[bs->num_binds - 1];
+        invalidate_bind_hash(bs);
     }
 
     bind_dealloc(bind);
@@ -1220,11 +1313,11 @@ struct input_ctx *mp_input_init(struct mpv_global *global)
 
 void mp_input_load(struct input_ctx *ictx)
 {
-    struct input_opts *input_conf =
-        m_sub_options_copy(ictx, &input_config, ictx->global->opts->input_opts);
-
-    talloc_free(ictx->opts);
-    ictx->opts = input_conf;
+    talloc_free(ictx->opts_cache);
+    ictx->opts_cache =
+        m_config_cache_alloc(ictx, ictx->global->config, &input_config);
+    ictx->opts = ictx->opts_cache->opts;
+    struct input_opts *input_conf = ictx->opts;
 
     // "Uncomment" the default key bindings in etc/input.conf and add them.
     // All lines that do not start with '# ' are parsed.
@@ -227,7 +227,8 @@ void mp_input_load(struct input_ctx *ictx);
 void mp_input_uninit(struct input_ctx *ictx);
 
 // Sleep for the given amount of seconds, until mp_input_wakeup() is called,
-// or new input arrives. seconds<=0 returns immediately.
+// or new input arrives. seconds<=0 returns immediately, INFINITY waits without
+// a timeout.
 void mp_input_wait(struct input_ctx *ictx, double seconds);
 
 // Wake up sleeping input loop from another thread.
@@ -249,6 +250,13 @@ void mp_input_run_cmd(struct input_ctx *ictx, int def_flags, const char **cmd,
                       const char *location);
 
 void mp_input_pipe_add(struct input_ctx *ictx, const char *filename);
+
+struct mp_ipc_ctx;
+struct mp_client_api;
+struct mpv_global;
+struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
+                               struct mpv_global *global);
+void mp_uninit_ipc(struct mp_ipc_ctx *ctx);
 void mp_input_joystick_add(struct input_ctx *ictx, char *dev);
 void mp_input_lirc_add(struct input_ctx *ictx, char *lirc_configfile);
 
@@ -0,0 +1,699 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// UNIX socket server for remote control. Each connection is a libmpv client.
+// Messages are framed binary mpv_node values; see DOCS/man/ipc.rst.
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "misc/bstr.h"
+#include "options/options.h"
+#include "options/path.h"
+#include "osdep/io.h"
+#include "player/client.h"
+#include "input.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Refuse larger frames, and drop clients which don't read their replies.
+#define MAX_FRAME_SIZE (16 * 1024 * 1024)
+#define MAX_OUTPUT_SIZE (64 * 1024 * 1024)
+#define MAX_NODE_DEPTH 32
+
+enum {
+    NODE_NONE       = 0,
+    NODE_STRING     = 1,
+    NODE_FLAG       = 2,
+    NODE_INT64      = 3,
+    NODE_DOUBLE     = 4,
+    NODE_ARRAY      = 5,
+    NODE_MAP        = 6,
+};
+
+struct ipc_conn {
+    int fd;
+    struct mpv_handle *client;
+    int wakeup_fd;
+    bstr in;                // received, not yet complete frame data
+    bstr out;               // encoded frames not yet written
+    size_t out_pos;         // bytes of out already written
+    bool dead;
+};
+
+struct mp_ipc_ctx {
+    struct mp_log *log;
+    struct mp_client_api *client_api;
+    struct mpv_handle *listener;    // only for the SHUTDOWN event
+    char *path;
+    int listen_fd;
+    int conn_counter;
+
+    struct ipc_conn **conns;
+    int num_conns;
+
+    pthread_t thread;
+};
+
+static void put_u32(void *ta_ctx, bstr *dst, uint32_t v)
+{
+    uint8_t b[4] = {v, v >> 8, v >> 16, v >> 24};
+    bstr_xappend(ta_ctx, dst, (bstr){b, 4});
+}
+
+static void put_u64(void *ta_ctx, bstr *dst, uint64_t v)
+{
+    put_u32(ta_ctx, dst, v);
+    put_u32(ta_ctx, dst, v >> 32);
+}
+
+static void put_str(void *ta_ctx, bstr *dst, const char *s)
+{
+    put_u32(ta_ctx, dst, strlen(s));
+    bstr_xappend(ta_ctx, dst, bstr0(s));
+}
+
+static void put_node(void *ta_ctx, bstr *dst, struct mpv_node *node)
+{
+    uint8_t type;
+    switch (node->format) {
+    case MPV_FORMAT_STRING:     type = NODE_STRING; break;
+    case MPV_FORMAT_FLAG:       type = NODE_FLAG; break;
+    case MPV_FORMAT_INT64:      type = NODE_INT64; break;
+    case MPV_FORMAT_DOUBLE:     type = NODE_DOUBLE; break;
+    case MPV_FORMAT_NODE_ARRAY: type = NODE_ARRAY; break;
+    case MPV_FORMAT_NODE_MAP:   type = NODE_MAP; break;
+    default:                    type = NODE_NONE;
+    }
+    bstr_xappend(ta_ctx, dst, (bstr){&type, 1});
+    switch (type) {
+    case NODE_STRING:
+        put_str(ta_ctx, dst, node->u.string);
+        break;
+    case NODE_FLAG: {
+        uint8_t v = !!node->u.flag;
+        bstr_xappend(ta_ctx, dst, (bstr){&v, 1});
+        break;
+    }
+    case NODE_INT64:
+        put_u64(ta_ctx, dst, node->u.int64);
+        break;
+    case NODE_DOUBLE: {
+        uint64_t v;
+        memcpy(&v, &node->u.double_, 8);
+        put_u64(ta_ctx, dst, v);
+        break;
+    }
+    case NODE_ARRAY:
+    case NODE_MAP: {
+        struct mpv_node_list *list = node->u.list;
+        put_u32(ta_ctx, dst, list->num);
+        for (int n = 0; n < list->num; n++) {
+            if (type == NODE_MAP)
+                put_str(ta_ctx, dst, list->keys[n]);
+            put_node(ta_ctx, dst, &list->values[n]);
+        }
+        break;
+    }
+    }
+}
+
+static bool get_bytes(bstr *src, void *dst, size_t len)
+{
+    if (src->len < len)
+        return false;
+    memcpy(dst, src->start, len);
+    *src = bstr_cut(*src, len);
+    return true;
+}
+
+static bool get_u32(bstr *src, uint32_t *v)
+{
+    uint8_t b[4];
+    if (!get_bytes(src, b, 4))
+        return false;
+    *v = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+    return true;
+}
+
+static bool get_u64(bstr *src, uint64_t *v)
+{
+    uint32_t lo, hi;
+    if (!get_u32(src, &lo) || !get_u32(src, &hi))
+        return false;
+    *v = lo | ((uint64_t)hi << 32);
+    return true;
+}
+
+static char *get_str(void *ta_ctx, bstr *src)
+{
+    uint32_t len;
+    if (!get_u32(src, &len) || src->len < len)
+        return NULL;
+    char *s = bstrdup0(ta_ctx, bstr_splice(*src, 0, len));
+    *src = bstr_cut(*src, len);
+    return s;
+}
+
+// Decode a node; all memory is allocated as talloc children of ta_ctx.
+static bool get_node(void *ta_ctx, bstr *src, struct mpv_node *node, int depth)
+{
+    uint8_t type;
+    if (depth > MAX_NODE_DEPTH || !get_bytes(src, &type, 1))
+        return false;
+    *node = (struct mpv_node){0};
+    switch (type) {
+    case NODE_NONE:
+        node->format = MPV_FORMAT_NONE;
+        return true;
+    case NODE_STRING:
+        node->format = MPV_FORMAT_STRING;
+        node->u.string = get_str(ta_ctx, src);
+        return node->u.string;
+    case NODE_FLAG: {
+        uint8_t v;
+        node->format = MPV_FORMAT_FLAG;
+        if (!get_bytes(src, &v, 1))
+            return false;
+        node->u.flag = !!v;
+        return true;
+    }
+    case NODE_INT64: {
+        uint64_t v;
+        node->format = MPV_FORMAT_INT64;
+        if (!get_u64(src, &v))
+            return false;
+        node->u.int64 = v;
+        return true;
+    }
+    case NODE_DOUBLE: {
+        uint64_t v;
+        node->format = MPV_FORMAT_DOUBLE;
+        if (!get_u64(src, &v))
+            return false;
+        memcpy(&node->u.double_, &v, 8);
+        return true;
+    }
+    case NODE_ARRAY:
+    case NODE_MAP: {
+        uint32_t num;
+        // Each entry needs at least 1 byte, which bounds the allocation.
+        if (!get_u32(src, &num) || num > src->len)
+            return false;
+        struct mpv_node_list *list = talloc_zero(ta_ctx, struct mpv_node_list);
+        node->format = type == NODE_MAP ? MPV_FORMAT_NODE_MAP
+                                        : MPV_FORMAT_NODE_ARRAY;
+        node->u.list = list;
+        list->values = talloc_array(list, struct mpv_node, num);
+        if (type == NODE_MAP)
+            list->keys = talloc_array(list, char *, num);
+        for (uint32_t n = 0; n < num; n++) {
+            if (type == NODE_MAP && !(list->keys[n] = get_str(list, src)))
+                return false;
+            if (!get_node(list, src, &list->values[n], depth + 1))
+                return false;
+            list->num++;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+static struct mpv_node *map_get(struct mpv_node *map, const char *key)
+{
+    if (map->format != MPV_FORMAT_NODE_MAP)
+        return NULL;
+    struct mpv_node_list *list = map->u.list;
+    for (int n = 0; n < list->num; n++) {
+        if (strcmp(list->keys[n], key) == 0)
+            return &list->values[n];
+    }
+    return NULL;
+}
+
+// Helper for building reply maps.
+static void map_add(struct mpv_node *map, const char *key, struct mpv_node val)
+{
+    struct mpv_node_list *list = map->u.list;
+    MP_TARRAY_GROW(list, list->values, list->num);
+    MP_TARRAY_GROW(list, list->keys, list->num);
+    list->keys[list->num] = (char *)key;
+    list->values[list->num] = val;
+    list->num++;
+}
+
+static struct mpv_node new_map(void *ta_ctx)
+{
+    return (struct mpv_node){
+        .format = MPV_FORMAT_NODE_MAP,
+        .u.list = talloc_zero(ta_ctx, struct mpv_node_list),
+    };
+}
+
+static void send_message(struct mp_ipc_ctx *ctx, struct ipc_conn *conn,
+                         struct mpv_node *msg)
+{
+    if (conn->dead)
+        return;
+    size_t start = conn->out.len;
+    put_u32(conn, &conn->out, 0); // placeholder for the frame size
+    put_node(conn, &conn->out, msg);
+    uint32_t size = conn->out.len - start - 4;
+    uint8_t b[4] = {size, size >> 8, size >> 16, size >> 24};
+    memcpy(conn->out.start + start, b, 4);
+    if (conn->out.len - conn->out_pos > MAX_OUTPUT_SIZE) {
+        MP_WARN(ctx, "Client %s doesn't read its replies, dropping it.\n",
+                mpv_client_name(conn->client));
+        conn->dead = true;
+    }
+}
+
+static void send_reply(struct mp_ipc_ctx *ctx, struct ipc_conn *conn,
+                       int64_t request_id, int err, struct mpv_node *data)
+{
+    void *tmp = talloc_new(NULL);
+    struct mpv_node msg = new_map(tmp);
+    map_add(&msg, "request_id", (struct mpv_node){
+        .format = MPV_FORMAT_INT64, .u.int64 = request_id});
+    map_add(&msg, "error", (struct mpv_node){
+        .format = MPV_FORMAT_STRING,
+        .u.string = (char *)mpv_error_string(err)});
+    if (data)
+        map_add(&msg, "data", *data);
+    send_message(ctx, conn, &msg);
+    talloc_free(tmp);
+}
+
+// Convert scalar command arguments to the strings mpv_command() expects.
+static char *node_to_arg(void *ta_ctx, struct mpv_node *node)
+{
+    switch (node->format) {
+    case MPV_FORMAT_STRING: return node->u.string;
+    case MPV_FORMAT_FLAG:   return node->u.flag ? "yes" : "no";
+    case MPV_FORMAT_INT64:  return talloc_asprintf(ta_ctx, "%"PRId64,
+                                                   node->u.int64);
+    case MPV_FORMAT_DOUBLE: return talloc_asprintf(ta_ctx, "%f",
+                                                   node->u.double_);
+    default:                return NULL;
+    }
+}
+
+static int run_request(struct ipc_conn *conn, struct mpv_node *msg,
+                       int64_t request_id, void *tmp, bool *replied)
+{
+    struct mpv_node *cmd = map_get(msg, "command");
+    if (!cmd || cmd->format != MPV_FORMAT_NODE_ARRAY || !cmd->u.list->num)
+        return MPV_ERROR_INVALID_PARAMETER;
+    struct mpv_node_list *args = cmd->u.list;
+    if (args->values[0].format != MPV_FORMAT_STRING)
+        return MPV_ERROR_INVALID_PARAMETER;
+    const char *name = args->values[0].u.string;
+    struct mpv_handle *client = conn->client;
+
+    // These are replied with an event later.
+    *replied = true;
+
+    if (strcmp(name, "get_property") == 0) {
+        if (args->num != 2 || args->values[1].format != MPV_FORMAT_STRING)
+            return MPV_ERROR_INVALID_PARAMETER;
+        return mpv_get_property_async(client, request_id,
+                                      args->values[1].u.string,
+                                      MPV_FORMAT_NODE);
+    } else if (strcmp(name, "set_property") == 0) {
+        if (args->num != 3 || args->values[1].format != MPV_FORMAT_STRING)
+            return MPV_ERROR_INVALID_PARAMETER;
+        return mpv_set_property_async(client, request_id,
+                                      args->values[1].u.string,
+                                      MPV_FORMAT_NODE, &args->values[2]);
+    }
+
+    *replied = false;
+
+    if (strcmp(name, "observe_property") == 0) {
+        if (args->num != 3 || args->values[1].format != MPV_FORMAT_INT64 ||
+            args->values[2].format != MPV_FORMAT_STRING)
+            return MPV_ERROR_INVALID_PARAMETER;
+        return mpv_observe_property(client, args->values[1].u.int64,
+                                    args->values[2].u.string, MPV_FORMAT_NODE);
+    } else if (strcmp(name, "unobserve_property") == 0) {
+        if (args->num != 2 || args->values[1].format != MPV_FORMAT_INT64)
+            return MPV_ERROR_INVALID_PARAMETER;
+        int r = mpv_unobserve_property(client, args->values[1].u.int64);
+        return r < 0 ? r : 0;
+    }
+
+    const char **argv = talloc_zero_array(tmp, const char *, args->num + 1);
+    for (int n = 0; n < args->num; n++) {
+        if (!(argv[n] = node_to_arg(tmp, &args->values[n])))
+            return MPV_ERROR_INVALID_PARAMETER;
+    }
+    *replied = true;
+    return mpv_command_async(client, request_id, argv);
+}
+
+static void handle_frame(struct mp_ipc_ctx *ctx, struct ipc_conn *conn,
+                         bstr frame)
+{
+    void *tmp = talloc_new(NULL);
+    struct mpv_node msg;
+    int64_t request_id = 0;
+    int err = MPV_ERROR_INVALID_PARAMETER;
+    bool replied = false;
+    if (get_node(tmp, &frame, &msg, 0) && !frame.len &&
+        msg.format == MPV_FORMAT_NODE_MAP)
+    {
+        struct mpv_node *id = map_get(&msg, "request_id");
+        if (id && id->format == MPV_FORMAT_INT64)
+            request_id = id->u.int64;
+        err = run_request(conn, &msg, request_id, tmp, &replied);
+    } else {
+        MP_VERBOSE(ctx, "Invalid message from client %s.\n",
+                   mpv_client_name(conn->client));
+    }
+    if (err < 0 || !replied)
+        send_reply(ctx, conn, request_id, err, NULL);
+    talloc_free(tmp);
+}
+
+static void read_conn(struct mp_ipc_ctx *ctx, struct ipc_conn *conn)
+{
+    char buf[4096];
+    ssize_t r = recv(conn->fd, buf, sizeof(buf), 0);
+    if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) {
+        conn->dead = true;
+        return;
+    }
+    if (r < 0)
+        return;
+    bstr_xappend(conn, &conn->in, (bstr){buf, r});
+
+    bstr data = conn->in;
+    while (!conn->dead) {
+        bstr hdr = data;
+        uint32_t size;
+        if (!get_u32(&hdr, &size))
+            break;
+        if (size > MAX_FRAME_SIZE) {
+            MP_WARN(ctx, "Client %s sent a too large frame.\n",
+                    mpv_client_name(conn->client));
+            conn->dead = true;
+            break;
+        }
+        if (hdr.len < size)
+            break;
+        handle_frame(ctx, conn, bstr_splice(hdr, 0, size));
+        data = bstr_cut(hdr, size);
+    }
+    memmove(conn->in.start, data.start, data.len);
+    conn->in.len = data.len;
+}
+
+static void write_conn(struct ipc_conn *conn)
+{
+    while (!conn->dead && conn->out_pos < conn->out.len) {
+        ssize_t r = send(conn->fd, conn->out.start + conn->out_pos,
+                         conn->out.len - conn->out_pos, MSG_NOSIGNAL);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN)
+                conn->dead = true;
+            return;
+        }
+        conn->out_pos += r;
+    }
+    conn->out.len = conn->out_pos = 0;
+}
+
+static void drain_fd(int fd)
+{
+    char buf[64];
+    while (read(fd, buf, sizeof(buf)) > 0) {}
+}
+
+static void send_event(struct mp_ipc_ctx *ctx, struct ipc_conn *conn,
+                       struct mpv_event *event)
+{
+    switch (event->event_id) {
+    case MPV_EVENT_COMMAND_REPLY:
+    case MPV_EVENT_SET_PROPERTY_REPLY:
+        send_reply(ctx, conn, event->reply_userdata, event->error, NULL);
+        return;
+    case MPV_EVENT_GET_PROPERTY_REPLY: {
+        struct mpv_event_property *prop = event->data;
+        struct mpv_node *data = NULL;
+        if (event->error >= 0 && prop->format == MPV_FORMAT_NODE)
+            data = prop->data;
+        send_reply(ctx, conn, event->reply_userdata, event->error, data);
+        return;
+    }
+    }
+
+    void *tmp = talloc_new(NULL);
+    struct mpv_node msg = new_map(tmp);
+    map_add(&msg, "event", (struct mpv_node){
+        .format = MPV_FORMAT_STRING,
+        .u.string = (char *)mpv_event_name(event->event_id)});
+    if (event->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+        struct mpv_event_property *prop = event->data;
+        map_add(&msg, "id", (struct mpv_node){
+            .format = MPV_FORMAT_INT64, .u.int64 = event->reply_userdata});
+        map_add(&msg, "name", (struct mpv_node){
+            .format = MPV_FORMAT_STRING, .u.string = (char *)prop->name});
+        struct mpv_node none = {.format = MPV_FORMAT_NONE};
+        map_add(&msg, "data", prop->format == MPV_FORMAT_NODE ?
+                *(struct mpv_node *)prop->data : none);
+    }
+    send_message(ctx, conn, &msg);
+    talloc_free(tmp);
+}
+
+static void process_events(struct mp_ipc_ctx *ctx, struct ipc_conn *conn)
+{
+    drain_fd(conn->wakeup_fd);
+    while (!conn->dead) {
+        struct mpv_event *event = mpv_wait_event(conn->client, 0);
+        if (event->event_id == MPV_EVENT_NONE)
+            break;
+        if (event->event_id == MPV_EVENT_SHUTDOWN) {
+            conn->dead = true;
+            break;
+        }
+        send_event(ctx, conn, event);
+    }
+}
+
+static void close_conn(struct mp_ipc_ctx *ctx, int index)
+{
+    struct ipc_conn *conn = ctx->conns[index];
+    MP_VERBOSE(ctx, "Client %s disconnected.\n", mpv_client_name(conn->client));
+    mpv_detach_destroy(conn->client);
+    close(conn->fd);
+    talloc_free(conn);
+    MP_TARRAY_REMOVE_AT(ctx->conns, ctx->num_conns, index);
+}
+
+static void accept_conn(struct mp_ipc_ctx *ctx)
+{
+    int fd = accept(ctx->listen_fd, NULL, NULL);
+    if (fd < 0)
+        return;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    char name[32];
+    snprintf(name, sizeof(name), "ipc-%d", ctx->conn_counter++);
+    struct mpv_handle *client = mp_new_client(ctx->client_api, name);
+    if (!client) {
+        close(fd);
+        return;
+    }
+
+    struct ipc_conn *conn = talloc_ptrtype(NULL, conn);
+    *conn = (struct ipc_conn){
+        .fd = fd,
+        .client = client,
+        .wakeup_fd = mpv_get_wakeup_pipe(client),
+    };
+    MP_TARRAY_APPEND(ctx, ctx->conns, ctx->num_conns, conn);
+    MP_VERBOSE(ctx, "Client %s connected.\n", mpv_client_name(client));
+}
+
+// All connections are served by this thread. Client API calls are either
+// asynchronous or don't need the playback core, so a slow core doesn't stall
+// reading and writing the sockets.
+static void *ipc_thread(void *p)
+{
+    struct mp_ipc_ctx *ctx = p;
+    int listener_fd = mpv_get_wakeup_pipe(ctx->listener);
+    bool quit = false;
+
+    while (!quit) {
+        int num_fds = 2 + ctx->num_conns * 2;
+        struct pollfd *fds = talloc_array(NULL, struct pollfd, num_fds);
+        fds[0] = (struct pollfd){ .fd = ctx->listen_fd, .events = POLLIN };
+        fds[1] = (struct pollfd){ .fd = listener_fd, .events = POLLIN };
+        for (int n = 0; n < ctx->num_conns; n++) {
+            struct ipc_conn *conn = ctx->conns[n];
+            short events = POLLIN;
+            if (conn->out_pos < conn->out.len)
+                events |= POLLOUT;
+            fds[2 + n * 2 + 0] = (struct pollfd){ .fd = conn->fd,
+                                                  .events = events };
+            fds[2 + n * 2 + 1] = (struct pollfd){ .fd = conn->wakeup_fd,
+                                                  .events = POLLIN };
+        }
+
+        if (poll(fds, num_fds, -1) < 0 && errno != EINTR) {
+            MP_ERR(ctx, "poll() failed.\n");
+            talloc_free(fds);
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            drain_fd(listener_fd);
+            struct mpv_event *event;
+            while ((event = mpv_wait_event(ctx->listener, 0))->event_id) {
+                if (event->event_id == MPV_EVENT_SHUTDOWN)
+                    quit = true;
+            }
+        }
+
+        int num_polled = ctx->num_conns;
+        for (int n = 0; n < num_polled; n++) {
+            struct ipc_conn *conn = ctx->conns[n];
+            short revents = fds[2 + n * 2].revents;
+            if (revents & POLLIN)
+                read_conn(ctx, conn);
+            if (revents & (POLLERR | POLLHUP | POLLNVAL))
+                conn->dead = true;
+            if (fds[2 + n * 2 + 1].revents & POLLIN)
+                process_events(ctx, conn);
+            write_conn(conn);
+        }
+
+        if (!quit && (fds[0].revents & POLLIN))
+            accept_conn(ctx);
+
+        talloc_free(fds);
+
+        for (int n = ctx->num_conns - 1; n >= 0; n--) {
+            if (ctx->conns[n]->dead || quit)
+                close_conn(ctx, n);
+        }
+    }
+
+    while (ctx->num_conns)
+        close_conn(ctx, ctx->num_conns - 1);
+    mpv_detach_destroy(ctx->listener);
+    ctx->listener = NULL;
+    return NULL;
+}
+
+struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
+                               struct mpv_global *global)
+{
+    struct MPOpts *opts = global->opts;
+    if (!opts->ipc_path || !opts->ipc_path[0])
+        return NULL;
+
+    struct mp_ipc_ctx *ctx = talloc_ptrtype(NULL, ctx);
+    *ctx = (struct mp_ipc_ctx){
+        .log = mp_log_new(ctx, global->log, "ipc"),
+        .client_api = client_api,
+        .path = mp_get_user_path(ctx, global, opts->ipc_path),
+        .listen_fd = -1,
+    };
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(ctx->path) + 1 > sizeof(addr.sun_path)) {
+        MP_ERR(ctx, "Socket path too long: %s\n", ctx->path);
+        goto error;
+    }
+    strcpy(addr.sun_path, ctx->path);
+
+    ctx->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (ctx->listen_fd < 0) {
+        MP_ERR(ctx, "Could not create IPC socket.\n");
+        goto error;
+    }
+    fcntl(ctx->listen_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(ctx->listen_fd, F_SETFL, fcntl(ctx->listen_fd, F_GETFL) | O_NONBLOCK);
+
+    unlink(ctx->path);
+    if (bind(ctx->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(ctx->listen_fd, 10) < 0)
+    {
+        MP_ERR(ctx, "Could not bind IPC socket %s: %s\n", ctx->path,
+               strerror(errno));
+        goto error;
+    }
+
+    ctx->listener = mp_new_client(client_api, "ipc");
+    if (!ctx->listener)
+        goto error;
+    // It never runs commands; avoid waking up the thread needlessly.
+    for (int n = 0; n < 64; n++) {
+        if (n != MPV_EVENT_SHUTDOWN)
+            mpv_request_event(ctx->listener, n, 0);
+    }
+
+    if (pthread_create(&ctx->thread, NULL, ipc_thread, ctx)) {
+        mpv_detach_destroy(ctx->listener);
+        goto error;
+    }
+
+    MP_VERBOSE(ctx, "Listening on %s\n", ctx->path);
+    return ctx;
+
+error:
+    if (ctx->listen_fd >= 0)
+        close(ctx->listen_fd);
+    talloc_free(ctx);
+    return NULL;
+}
+
+// Must be called after all clients were told to shut down.
+void mp_uninit_ipc(struct mp_ipc_ctx *ctx)
+{
+    if (!ctx)
+        return;
+    pthread_join(ctx->thread, NULL);
+    close(ctx->listen_fd);
+    unlink(ctx->path);
+    talloc_free(ctx);
+}
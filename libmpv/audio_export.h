@@ -0,0 +1,123 @@
+/* Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef MPV_CLIENT_API_AUDIO_EXPORT_H_
+#define MPV_CLIENT_API_AUDIO_EXPORT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Warning: this API is not stable yet.
+ *
+ * Overview
+ * --------
+ *
+ * The "export" audio filter (--af=export=<file>) writes the audio passing
+ * through it into a ring buffer in a memory mapped file. This header describes
+ * the file layout, and provides functions to read the stream. The functions
+ * don't need a mpv_handle, and can be used from any process.
+ *
+ * The ring buffer has a single writer (the filter) and a single reader. The
+ * writer never waits for the reader: if the ring is full, new audio is
+ * dropped, and the number of dropped frames is reported to the reader.
+ *
+ * If the audio format changes, the filter writes a new file and atomically
+ * renames it over the old one. The old file is marked as closed. The reader
+ * functions report this, and the reader has to reopen the file.
+ *
+ * File layout
+ * -----------
+ *
+ * The file starts with mpv_audio_export_header, followed by the ring data at
+ * offset header_size. The ring contains ring_frames interleaved audio frames.
+ * Frame N (counted since the start of the stream) is at ring index
+ * N % ring_frames. ring_frames is always a power of 2.
+ *
+ * write_pos and read_pos count frames since the start of the stream. Only
+ * the writer changes write_pos, only the reader changes read_pos. They must
+ * be accessed atomically: the writer stores write_pos with release semantics
+ * after writing the data, and the reader loads it with acquire semantics
+ * before reading the data (and vice versa for read_pos).
+ */
+
+#define MPV_AUDIO_EXPORT_MAGIC "mpvaexp"
+#define MPV_AUDIO_EXPORT_VERSION 1
+
+typedef enum mpv_audio_export_format {
+    MPV_AUDIO_EXPORT_FORMAT_S16     = 1,    // int16_t
+    MPV_AUDIO_EXPORT_FORMAT_FLOAT   = 2,    // float
+} mpv_audio_export_format;
+
+typedef struct mpv_audio_export_header {
+    char magic[8];              // MPV_AUDIO_EXPORT_MAGIC, including the 0
+    uint32_t version;           // MPV_AUDIO_EXPORT_VERSION
+    uint32_t header_size;       // byte offset of the ring data
+    uint32_t format;            // mpv_audio_export_format
+    uint32_t channels;
+    uint32_t samplerate;
+    uint32_t ring_frames;       // ring size in frames (power of 2)
+    uint32_t closed;            // 1 if the writer stopped writing this file
+    uint32_t reserved;
+    uint64_t write_pos;         // frames written (changed by writer only)
+    uint64_t read_pos;          // frames read (changed by reader only)
+    uint64_t overruns;          // frames dropped due to a full ring
+} mpv_audio_export_header;
+
+/**
+ * Reader state for an opened export file.
+ */
+typedef struct mpv_audio_export mpv_audio_export;
+
+/**
+ * Open an export file for reading. Only one reader can use a file at a time.
+ * Reading starts at the current writer position, i.e. old data is discarded.
+ *
+ * @param filename the file passed to the export filter
+ * @return the reader, or NULL if the file doesn't exist or is invalid
+ */
+mpv_audio_export *mpv_audio_export_open(const char *filename);
+
+/**
+ * Return the header of the opened file. The format fields are constant for
+ * the lifetime of the reader.
+ */
+const mpv_audio_export_header *mpv_audio_export_get_header(mpv_audio_export *ex);
+
+/**
+ * Read available audio. Never blocks.
+ *
+ * @param buf destination, must be at least max_frames frames large
+ * @param max_frames maximum number of frames to read
+ * @param dropped if not NULL, set to the number of frames the writer dropped
+ *                since the previous call, because the ring was full
+ * @return number of frames read (0 if no data is available), or a negative
+ *         value if the writer closed the file and all data was read. In the
+ *         latter case, the reader should be closed and the file reopened.
+ */
+int mpv_audio_export_read(mpv_audio_export *ex, void *buf, int max_frames,
+                          uint64_t *dropped);
+
+/**
+ * Close the reader. Passing NULL is allowed.
+ */
+void mpv_audio_export_close(mpv_audio_export *ex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -162,7 +162,7 @@ extern "C" {
  * relational operators (<, >, <=, >=).
  */
 #define MPV_MAKE_VERSION(major, minor) (((major) << 16) | (minor) | 0UL)
-#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 4)
+#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 9)
 
 /**
  * Return the MPV_CLIENT_API_VERSION the mpv source has been compiled with.
@@ -676,6 +676,24 @@ int mpv_command_string(mpv_handle *ctx, const char *args);
 int mpv_command_async(mpv_handle *ctx, uint64_t reply_userdata,
                       const char **args);
 
+/**
+ * Run a list of commands, like calling mpv_command() on each of them, but
+ * with a single synchronization with the playback core. The commands are run
+ * in order, and no other command or property access can happen in between.
+ *
+ * A failing command doesn't prevent the following commands from being run.
+ * Commands that can't be parsed are skipped.
+ *
+ * @param num Number of entries in cmds.
+ * @param cmds Array of command argument lists, each like the args parameter
+ *             of mpv_command().
+ * @param[out] errors If not NULL, an array with num entries, which is set to
+ *                    the error code of each command.
+ * @return error code of the first failing command, or 0
+ */
+int mpv_command_list(mpv_handle *ctx, int num, const char **const *cmds,
+                     int *errors);
+
 /**
  * Set a property to a given value. Properties are essentially variables which
  * can be queried or set at runtime. For example, writing to the pause property
@@ -702,6 +720,23 @@ int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format,
  */
 int mpv_set_property_string(mpv_handle *ctx, const char *name, const char *data);
 
+/**
+ * Set several properties at once, like calling mpv_set_property() on each of
+ * them, but with a single synchronization with the playback core. This is
+ * much cheaper than separate calls if many properties are set.
+ *
+ * @param num Number of properties.
+ * @param names Array of num property names.
+ * @param format see enum mpv_format, used for all properties.
+ * @param[in] data Array of num values of the type corresponding to format
+ *                 (e.g. int64_t[num] for MPV_FORMAT_INT64).
+ * @param[out] errors If not NULL, an array with num entries, which is set to
+ *                    the error code of each property.
+ * @return error code of the first failing property, or 0
+ */
+int mpv_set_properties(mpv_handle *ctx, int num, const char **names,
+                       mpv_format format, void *data, int *errors);
+
 /**
  * Set a property asynchronously. You will receive the result of the operation
  * as MPV_EVENT_SET_PROPERTY_REPLY event. The mpv_event.error field will contain
@@ -739,6 +774,27 @@ int mpv_set_property_async(mpv_handle *ctx, uint64_t reply_userdata,
 int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
                      void *data);
 
+/**
+ * Read several properties at once, like calling mpv_get_property() on each of
+ * them, but with a single synchronization with the playback core. All values
+ * are read at the same point in time. (Unlike mpv_get_property(), this always
+ * stops the playback thread, even for frequently polled properties.)
+ *
+ * Entries whose error code is not 0 are not written to.
+ *
+ * @param num Number of properties.
+ * @param names Array of num property names.
+ * @param format see enum mpv_format, used for all properties.
+ * @param[out] data Array of num values of the type corresponding to format
+ *                  (e.g. double[num] for MPV_FORMAT_DOUBLE). Free them as
+ *                  with mpv_get_property().
+ * @param[out] errors If not NULL, an array with num entries, which is set to
+ *                    the error code of each property.
+ * @return error code of the first failing property, or 0
+ */
+int mpv_get_properties(mpv_handle *ctx, int num, const char **names,
+                       mpv_format format, void *data, int *errors);
+
 /**
  * Return the value of the property with the given name as string. This is
  * equivalent to mpv_get_property() with MPV_FORMAT_STRING.
@@ -1132,6 +1188,35 @@ int mpv_request_event(mpv_handle *ctx, mpv_event_id event, int enable);
  */
 int mpv_request_log_messages(mpv_handle *ctx, const char *min_level);
 
+/**
+ * Set the maximum number of events that can be queued for this client handle.
+ * This includes replies to asynchronous requests which are still pending. The
+ * default is 1000.
+ *
+ * Events which merely notify about a state change and carry no data (such as
+ * MPV_EVENT_TICK or MPV_EVENT_VIDEO_RECONFIG) are coalesced: if such an event
+ * is still queued when the same event is sent again, the old one is removed
+ * and only the new one is appended. Property change events are coalesced
+ * in any case (see mpv_observe_property()).
+ *
+ * @param num_events New queue size. Must be at least 1, and at least as large
+ *                   as the number of currently queued or reserved events.
+ * @return error code
+ */
+int mpv_set_event_queue_size(mpv_handle *ctx, int num_events);
+
+/**
+ * Return how many events were lost because the event queue was full, and how
+ * many events were removed by coalescing (see mpv_set_event_queue_size()),
+ * since the client handle was created.
+ *
+ * @param[out] dropped If not NULL, set to the number of dropped events.
+ * @param[out] coalesced If not NULL, set to the number of coalesced events.
+ * @return error code
+ */
+int mpv_get_event_queue_stats(mpv_handle *ctx, uint64_t *dropped,
+                              uint64_t *coalesced);
+
 /**
  * Wait for the next event, or until the timeout expires, or if another thread
  * makes a call to mpv_wakeup(). Passing 0 as timeout will never wait, and
@@ -1141,6 +1226,7 @@ int mpv_request_log_messages(mpv_handle *ctx, const char *min_level);
  * don't empty the event queue quickly enough with mpv_wait_event(), it will
  * overflow and silently discard further events. If this happens, making
  * asynchronous requests will fail as well (with MPV_ERROR_EVENT_QUEUE_FULL).
+ * See mpv_set_event_queue_size() and mpv_get_event_queue_stats().
  *
  * Only one thread is allowed to call this at a time. The API won't complain
  * if more than one thread calls this, but it will cause race conditions in
@@ -1259,6 +1345,32 @@ void mpv_set_wakeup_callback(mpv_handle *ctx, void (*cb)(void *d), void *d);
  */
 int mpv_get_wakeup_pipe(mpv_handle *ctx);
 
+typedef enum mpv_sub_api {
+    /**
+     * For using mpv's OpenGL renderer on an external OpenGL context.
+     * mpv_get_sub_api(MPV_SUB_API_OPENGL_CB) returns mpv_opengl_cb_context*.
+     * This context can be used with mpv_opengl_cb_* functions.
+     * Will return NULL if unavailable (if OpenGL support was not compiled in).
+     * See opengl_cb.h for details.
+     */
+    MPV_SUB_API_OPENGL_CB = 1,
+    /**
+     * For receiving decoded video frames in a callback.
+     * mpv_get_sub_api(MPV_SUB_API_FRAME_CB) returns mpv_frame_cb_context*.
+     * See frame_cb.h for details.
+     */
+    MPV_SUB_API_FRAME_CB = 2
+} mpv_sub_api;
+
+/**
+ * This is used for additional APIs that are not strictly part of the core API.
+ * See the individual mpv_sub_api member values.
+ *
+ * The mpv core must have been initialized with mpv_initialize(), otherwise
+ * NULL is returned.
+ */
+void *mpv_get_sub_api(mpv_handle *ctx, mpv_sub_api sub_api);
+
 #ifdef __cplusplus
 }
 #endif
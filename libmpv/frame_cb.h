@@ -0,0 +1,118 @@
+/* Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef MPV_CLIENT_API_FRAME_CB_H_
+#define MPV_CLIENT_API_FRAME_CB_H_
+
+#include <stdint.h>
+
+#include "client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Warning: this API is not stable yet.
+ *
+ * Overview
+ * --------
+ *
+ * This API delivers decoded video frames to a client callback, for clients
+ * which want to process the video data themselves (e.g. image analysis),
+ * rather than display it. Frames are taken after the video filter chain,
+ * right before they are queued to the video output. The video output is not
+ * involved, so this works with --vo=null too.
+ *
+ * If no format conversion is requested, the frame is passed by reference,
+ * i.e. the client gets the same memory the decoder or the filters wrote to.
+ * Otherwise, the frame is converted with libswscale. The conversion context
+ * is cached, so it is setup only when the video parameters change.
+ *
+ * Threading
+ * ---------
+ *
+ * The callback is invoked on the mpv playback thread. It must not call any
+ * mpv API functions, and it should return quickly, because playback is blocked
+ * while it runs. The usual approach is to pass the frame to another thread.
+ * Frames are refcounted, and can be kept as long as needed: this does not
+ * block mpv, but the decoder might need to allocate more memory.
+ */
+
+/**
+ * Opaque context, returned by mpv_get_sub_api(MPV_SUB_API_FRAME_CB).
+ *
+ * There is only one context per mpv core. It is always the same for all
+ * mpv_handles of the core, and is valid until the core is destroyed.
+ */
+typedef struct mpv_frame_cb_context mpv_frame_cb_context;
+
+typedef struct mpv_frame {
+    /**
+     * Image format name, as used by the --vf=format filter (e.g. "yuv420p").
+     * For hardware decoded frames, this is the hwaccel format name (e.g.
+     * "vaapi" or "vdpau"), and plane 3 contains the surface ID.
+     */
+    const char *format;
+    /**
+     * Size of the image in pixels.
+     */
+    int w, h;
+    /**
+     * Image data. Only the first num_planes entries are set. The stride is in
+     * bytes, and can be negative.
+     */
+    int num_planes;
+    uint8_t *planes[4];
+    int stride[4];
+    /**
+     * Playback time of the frame in seconds (like the "time-pos" property).
+     */
+    double pts;
+} mpv_frame;
+
+/**
+ * @param callback_ctx the value passed to mpv_frame_cb_set_callback()
+ * @param frame the new frame; the callback must eventually free it with
+ *              mpv_frame_free()
+ */
+typedef void (*mpv_frame_cb_fn)(void *callback_ctx, mpv_frame *frame);
+
+/**
+ * Set the callback that receives decoded frames.
+ *
+ * @param format if not NULL or empty, convert frames to this image format
+ *               (e.g. "rgb24" or "gray"). Hardware decoded frames are skipped
+ *               if a format is set. If NULL or empty, the frames are passed
+ *               as they are.
+ * @param max_fps if larger than 0, frames are skipped as needed to deliver at
+ *                most this many frames per second of video.
+ * @param callback the callback; NULL disables frame delivery
+ * @param callback_ctx opaque argument to the callback
+ * @return error code; MPV_ERROR_INVALID_PARAMETER if the format is unknown
+ */
+int mpv_frame_cb_set_callback(mpv_frame_cb_context *ctx, const char *format,
+                              double max_fps, mpv_frame_cb_fn callback,
+                              void *callback_ctx);
+
+/**
+ * Free a frame passed to the frame callback. This only releases the reference
+ * if the frame data is still used by mpv. Passing NULL is allowed.
+ */
+void mpv_frame_free(mpv_frame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
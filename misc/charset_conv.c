@@ -19,13 +19,16 @@
  * with mpv.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <strings.h>
 #include <assert.h>
 
 #include "config.h"
 
+#include "common/common.h"
 #include "common/msg.h"
 
 #if HAVE_ENCA
@@ -87,6 +90,8 @@ bool mp_charset_requires_guess(const char *user_cp)
            (r > 1 && bstrcasecmp0(res[0], "utf8") == 0);
 }
 
+#define GUESS_SAMPLE_SIZE (256 * 1024)
+
 static const char *const utf_bom[3] = {"\xEF\xBB\xBF", "\xFF\xFE", "\xFE\xFF"};
 static const char *const utf_enc[3] = {"utf-8",        "utf-16le", "utf-16be"};
 
@@ -171,6 +176,11 @@ const char *mp_charset_guess(struct mp_log *log, bstr buf, const char *user_cp,
     if (r >= 0 || (r > -8 && (flags & MP_ICONV_ALLOW_CUTOFF)))
         return "UTF-8";
 
+    // The detection libraries don't need the whole file to make a decision,
+    // and are slow on large inputs. (The UTF-8 check above is cheap.)
+    if (buf.len > GUESS_SAMPLE_SIZE)
+        buf.len = GUESS_SAMPLE_SIZE;
+
     bstr params[3] = {{0}};
     split_colon(user_cp, 3, params);
 
@@ -229,44 +239,24 @@ bstr mp_charset_guess_and_conv_to_utf8(struct mp_log *log, bstr buf,
                             flags);
 }
 
-// Use iconv to convert buf to UTF-8.
-// Returns buf.start==NULL on error. Returns buf if cp is NULL, or if there is
-// obviously no conversion required (e.g. if cp is "UTF-8").
-// Returns a newly allocated buffer if conversion is done and succeeds. The
-// buffer will be terminated with 0 for convenience (the terminating 0 is not
-// included in the returned length).
-// Free the returned buffer with talloc_free().
-//  buf: input data
-//  cp: iconv codepage (or NULL)
-//  flags: combination of MP_ICONV_* flags
-//  returns: buf (no conversion), .start==NULL (error), or allocated buffer
-bstr mp_iconv_to_utf8(struct mp_log *log, bstr buf, const char *cp, int flags)
-{
 #if HAVE_ICONV
-    if (!cp || !cp[0] || mp_charset_is_utf8(cp))
-        return buf;
-
-    if (strcasecmp(cp, "ASCII") == 0)
-        return buf;
-
-    if (strcasecmp(cp, "UTF-8-BROKEN") == 0)
-        return bstr_sanitize_utf8_latin1(NULL, buf);
-
-    iconv_t icdsc;
-    if ((icdsc = iconv_open("UTF-8", cp)) == (iconv_t) (-1)) {
-        if (flags & MP_ICONV_VERBOSE)
-            mp_err(log, "Error opening iconv with codepage '%s'\n", cp);
-        goto failure;
+// Run the conversion of buf through icdsc, writing into *outbuf (a talloc
+// buffer of *osize bytes, reallocated as needed with ta_parent). On success,
+// the output is 0-terminated, and its length is written to *olen.
+static bool run_iconv(struct mp_log *log, iconv_t icdsc, bstr buf,
+                      const char *cp, int flags, void *ta_parent,
+                      char **outbuf, size_t *osize, size_t *olen)
+{
+    size_t size = MPMAX(buf.len, 16);
+    if (*osize < buf.len + 1) {
+        *outbuf = talloc_realloc_size(ta_parent, *outbuf, buf.len + 1);
+        *osize = buf.len + 1;
     }
+    size_t ileft = buf.len;
+    size_t oleft = *osize - 1;
 
-    size_t size = buf.len;
-    size_t osize = size;
-    size_t ileft = size;
-    size_t oleft = size - 1;
-
-    char *outbuf = talloc_size(NULL, osize);
     char *ip = buf.start;
-    char *op = outbuf;
+    char *op = *outbuf;
 
     while (1) {
         int clear = 0;
@@ -279,10 +269,10 @@ bstr mp_iconv_to_utf8(struct mp_log *log, bstr buf, const char *cp, int flags)
         }
         if (rc == (size_t) (-1)) {
             if (errno == E2BIG) {
-                size_t offset = op - outbuf;
-                outbuf = talloc_realloc_size(NULL, outbuf, osize + size);
-                op = outbuf + offset;
-                osize += size;
+                size_t offset = op - *outbuf;
+                *outbuf = talloc_realloc_size(ta_parent, *outbuf, *osize + size);
+                op = *outbuf + offset;
+                *osize += size;
                 oleft += size;
             } else {
                 if (errno == EINVAL && (flags & MP_ICONV_ALLOW_CUTOFF)) {
@@ -296,20 +286,184 @@ bstr mp_iconv_to_utf8(struct mp_log *log, bstr buf, const char *cp, int flags)
                 if (flags & MP_ICONV_VERBOSE) {
                     mp_err(log, "Error recoding text with codepage '%s'\n", cp);
                 }
-                talloc_free(outbuf);
-                iconv_close(icdsc);
-                goto failure;
+                return false;
             }
         } else if (clear)
             break;
     }
 
+    *olen = op - *outbuf;
+    (*outbuf)[*olen] = 0;
+    return true;
+}
+#endif
+
+// Use iconv to convert buf to UTF-8.
+// Returns buf.start==NULL on error. Returns buf if cp is NULL, or if there is
+// obviously no conversion required (e.g. if cp is "UTF-8").
+// Returns a newly allocated buffer if conversion is done and succeeds. The
+// buffer will be terminated with 0 for convenience (the terminating 0 is not
+// included in the returned length).
+// Free the returned buffer with talloc_free().
+//  buf: input data
+//  cp: iconv codepage (or NULL)
+//  flags: combination of MP_ICONV_* flags
+//  returns: buf (no conversion), .start==NULL (error), or allocated buffer
+bstr mp_iconv_to_utf8(struct mp_log *log, bstr buf, const char *cp, int flags)
+{
+#if HAVE_ICONV
+    if (!cp || !cp[0] || mp_charset_is_utf8(cp))
+        return buf;
+
+    if (strcasecmp(cp, "ASCII") == 0)
+        return buf;
+
+    if (strcasecmp(cp, "UTF-8-BROKEN") == 0)
+        return bstr_sanitize_utf8_latin1(NULL, buf);
+
+    iconv_t icdsc;
+    if ((icdsc = iconv_open("UTF-8", cp)) == (iconv_t) (-1)) {
+        if (flags & MP_ICONV_VERBOSE)
+            mp_err(log, "Error opening iconv with codepage '%s'\n", cp);
+        goto failure;
+    }
+
+    char *outbuf = NULL;
+    size_t osize = 0, olen = 0;
+    bool ok = run_iconv(log, icdsc, buf, cp, flags, NULL, &outbuf, &osize,
+                        &olen);
     iconv_close(icdsc);
+    if (!ok) {
+        talloc_free(outbuf);
+        goto failure;
+    }
 
-    outbuf[osize - oleft - 1] = 0;
-    return (bstr){outbuf, osize - oleft - 1};
+    return (bstr){outbuf, olen};
 #endif
 
 failure:
     return (bstr){0};
 }
+
+enum {
+    CONV_NONE,          // return input as-is
+    CONV_SANITIZE,      // UTF-8-BROKEN
+    CONV_ICONV,
+    CONV_FAIL,
+};
+
+struct mp_iconv_ctx {
+    struct mp_log *log;
+    char *cp;
+    int flags;
+    int mode;
+    bool ascii_compatible;
+#if HAVE_ICONV
+    iconv_t icdsc;
+#endif
+    char *outbuf;       // reused iconv output buffer
+    size_t osize;
+    char *sanitized;    // last CONV_SANITIZE result, if allocated
+};
+
+#if HAVE_ICONV
+static void iconv_ctx_destroy(void *p)
+{
+    struct mp_iconv_ctx *ctx = p;
+    if (ctx->mode == CONV_ICONV)
+        iconv_close(ctx->icdsc);
+}
+
+// Whether printable ASCII passes through the conversion unchanged (which is
+// not the case for e.g. UTF-16, or UTF-7 and HZ with their shift sequences).
+static bool check_ascii_compatible(struct mp_iconv_ctx *ctx)
+{
+    char test[128];
+    int len = 0;
+    for (int c = ' '; c < 127; c++)
+        test[len++] = c;
+    len += snprintf(test + len, sizeof(test) - len, "~{a~}+A-");
+
+    size_t olen = 0;
+    bool ok = run_iconv(ctx->log, ctx->icdsc, (bstr){test, len}, ctx->cp, 0,
+                        ctx, &ctx->outbuf, &ctx->osize, &olen);
+    return ok && olen == len && memcmp(ctx->outbuf, test, len) == 0;
+}
+#endif
+
+// Create a converter for repeated mp_iconv_ctx_convert() calls with the same
+// codepage. This keeps the iconv handle and output buffer around. cp and
+// flags are as with mp_iconv_to_utf8().
+struct mp_iconv_ctx *mp_iconv_ctx_create(void *ta_parent, struct mp_log *log,
+                                         const char *cp, int flags)
+{
+    struct mp_iconv_ctx *ctx = talloc_zero(ta_parent, struct mp_iconv_ctx);
+    ctx->log = log;
+    ctx->cp = talloc_strdup(ctx, cp ? cp : "");
+    ctx->flags = flags;
+    ctx->mode = CONV_FAIL;
+#if HAVE_ICONV
+    if (!ctx->cp[0] || mp_charset_is_utf8(ctx->cp) ||
+        strcasecmp(ctx->cp, "ASCII") == 0)
+    {
+        ctx->mode = CONV_NONE;
+    } else if (strcasecmp(ctx->cp, "UTF-8-BROKEN") == 0) {
+        ctx->mode = CONV_SANITIZE;
+    } else {
+        ctx->icdsc = iconv_open("UTF-8", ctx->cp);
+        if (ctx->icdsc == (iconv_t) (-1)) {
+            if (flags & MP_ICONV_VERBOSE)
+                mp_err(log, "Error opening iconv with codepage '%s'\n", ctx->cp);
+        } else {
+            ctx->mode = CONV_ICONV;
+            talloc_set_destructor(ctx, iconv_ctx_destroy);
+            ctx->ascii_compatible = check_ascii_compatible(ctx);
+        }
+    }
+#endif
+    return ctx;
+}
+
+#if HAVE_ICONV
+static bool is_plain_ascii(bstr buf)
+{
+    for (size_t n = 0; n < buf.len; n++) {
+        unsigned char c = buf.start[n];
+        if ((c < ' ' && c != '\n' && c != '\r' && c != '\t') || c > '~')
+            return false;
+    }
+    return true;
+}
+#endif
+
+// Like mp_iconv_to_utf8(), but if a new buffer is returned, it's owned by ctx,
+// and valid only until the next call. Input that is printable ASCII skips
+// iconv if the codepage is ASCII compatible.
+bstr mp_iconv_ctx_convert(struct mp_iconv_ctx *ctx, bstr buf)
+{
+    switch (ctx->mode) {
+    case CONV_NONE:
+        return buf;
+    case CONV_SANITIZE: {
+        talloc_free(ctx->sanitized);
+        bstr res = bstr_sanitize_utf8_latin1(ctx, buf);
+        ctx->sanitized = res.start != buf.start ? res.start : NULL;
+        return res;
+    }
+#if HAVE_ICONV
+    case CONV_ICONV: {
+        if (ctx->ascii_compatible && is_plain_ascii(buf))
+            return buf;
+        // Every call converts independent data; start with the initial state.
+        iconv(ctx->icdsc, NULL, NULL, NULL, NULL);
+        size_t olen = 0;
+        if (!run_iconv(ctx->log, ctx->icdsc, buf, ctx->cp, ctx->flags, ctx,
+                       &ctx->outbuf, &ctx->osize, &olen))
+            return (bstr){0};
+        return (bstr){ctx->outbuf, olen};
+    }
+#endif
+    default:
+        return (bstr){0};
+    }
+}
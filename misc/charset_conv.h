@@ -20,4 +20,9 @@ bstr mp_charset_guess_and_conv_to_utf8(struct mp_log *log, bstr buf,
                                        const char *user_cp, int flags);
 bstr mp_iconv_to_utf8(struct mp_log *log, bstr buf, const char *cp, int flags);
 
+struct mp_iconv_ctx;
+struct mp_iconv_ctx *mp_iconv_ctx_create(void *ta_parent, struct mp_log *log,
+                                         const char *cp, int flags);
+bstr mp_iconv_ctx_convert(struct mp_iconv_ctx *ctx, bstr buf);
+
 #endif
@@ -97,6 +97,9 @@ static void mp_dispatch_append(struct mp_dispatch_queue *queue,
                                struct mp_dispatch_item *item)
 {
     pthread_mutex_lock(&queue->lock);
+    // If the queue wasn't empty, the target thread was already woken up for
+    // the previous item, and will process this one in the same batch.
+    bool was_empty = !queue->head;
     if (queue->tail) {
         queue->tail->next = item;
     } else {
@@ -105,9 +108,10 @@ static void mp_dispatch_append(struct mp_dispatch_queue *queue,
     queue->tail = item;
     // Wake up the main thread; note that other threads might wait on this
     // condition for reasons, so broadcast the condition.
-    pthread_cond_broadcast(&queue->cond);
+    if (was_empty)
+        pthread_cond_broadcast(&queue->cond);
     pthread_mutex_unlock(&queue->lock);
-    if (queue->wakeup_fn)
+    if (was_empty && queue->wakeup_fn)
         queue->wakeup_fn(queue->wakeup_ctx);
 }
 
@@ -183,27 +187,35 @@ void mp_dispatch_queue_process(struct mp_dispatch_queue *queue, double timeout)
     pthread_cond_broadcast(&queue->cond);
     while (queue->head || queue->suspend_requested || wait > 0) {
         if (queue->head) {
-            struct mp_dispatch_item *item = queue->head;
-            queue->head = item->next;
-            if (!queue->head)
-                queue->tail = NULL;
-            item->next = NULL;
+            // Take all queued items at once, so that a burst of items costs
+            // a single round of locking.
+            struct mp_dispatch_item *batch = queue->head;
+            queue->head = queue->tail = NULL;
             // Unlock, because we want to allow other threads to queue items
-            // while the dispatch item is processed.
+            // while the dispatch items are processed.
             // At the same time, exclusive_lock must be held to protect the
             // thread's user state.
             pthread_mutex_unlock(&queue->lock);
             pthread_mutex_lock(&queue->exclusive_lock);
-            item->fn(item->fn_data);
+            for (struct mp_dispatch_item *item = batch; item; item = item->next)
+                item->fn(item->fn_data);
             pthread_mutex_unlock(&queue->exclusive_lock);
             pthread_mutex_lock(&queue->lock);
-            if (item->asynchronous) {
-                talloc_free(item);
-            } else {
-                item->completed = true;
-                // Wakeup mp_dispatch_run()
-                pthread_cond_broadcast(&queue->cond);
+            bool completed = false;
+            while (batch) {
+                struct mp_dispatch_item *item = batch;
+                // Synchronous items are gone as soon as they're completed.
+                batch = item->next;
+                if (item->asynchronous) {
+                    talloc_free(item);
+                } else {
+                    item->completed = true;
+                    completed = true;
+                }
             }
+            // Wakeup mp_dispatch_run()
+            if (completed)
+                pthread_cond_broadcast(&queue->cond);
         } else {
             if (wait > 0) {
                 mpthread_cond_timedwait(&queue->cond, &queue->lock, wait);
@@ -0,0 +1,245 @@
+#include <pthread.h>
+
+#include "common/common.h"
+#include "osdep/numcores.h"
+
+#include "thread_pool.h"
+
+#define MAX_THREADS 16
+
+enum {
+    LANE_PRIO,      // mp_thread_pool_run(): a caller is blocked on the result
+    LANE_NORMAL,    // mp_thread_pool_queue(): background tasks
+    NUM_LANES
+};
+
+struct work {
+    struct work *next;
+    void (*fn)(void *ctx, int job);     // for batches
+    void (*task)(void *ctx);            // for queued tasks
+    void *ctx;
+    int num_jobs;
+    int next_job;
+    int jobs_done;
+};
+
+struct mp_thread_pool {
+    pthread_t threads[MAX_THREADS];
+    int num_threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;      // new work or termination
+    pthread_cond_t done;        // a batch was completed
+    bool terminate;
+
+    // Work with unclaimed jobs, oldest first; protected by lock.
+    struct work *lanes[NUM_LANES];
+};
+
+static void append_work(struct mp_thread_pool *pool, int lane, struct work *w)
+{
+    struct work **p = &pool->lanes[lane];
+    while (*p)
+        p = &(*p)->next;
+    *p = w;
+    w->next = NULL;
+}
+
+static void remove_work(struct mp_thread_pool *pool, struct work *w)
+{
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        for (struct work **p = &pool->lanes[lane]; *p; p = &(*p)->next) {
+            if (*p == w) {
+                *p = w->next;
+                return;
+            }
+        }
+    }
+}
+
+// Claim the next job of w. The work is unlinked once all of its jobs are
+// claimed. lock must be held.
+static int claim_job(struct mp_thread_pool *pool, struct work *w)
+{
+    int job = w->next_job++;
+    if (w->next_job == w->num_jobs)
+        remove_work(pool, w);
+    return job;
+}
+
+// Run a claimed job. lock must be held on entry; it is released while the job
+// runs. w must not be accessed after this returns.
+static void run_job(struct mp_thread_pool *pool, struct work *w, int job)
+{
+    pthread_mutex_unlock(&pool->lock);
+    if (w->task) {
+        w->task(w->ctx);
+    } else {
+        w->fn(w->ctx, job);
+    }
+    pthread_mutex_lock(&pool->lock);
+    w->jobs_done++;
+    if (w->jobs_done == w->num_jobs) {
+        if (w->task) {
+            talloc_free(w);
+        } else {
+            pthread_cond_broadcast(&pool->done);
+        }
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    struct mp_thread_pool *pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        struct work *w = NULL;
+        for (int lane = 0; lane < NUM_LANES && !w; lane++)
+            w = pool->lanes[lane];
+        if (w) {
+            run_job(pool, w, claim_job(pool, w));
+        } else if (pool->terminate) {
+            break;
+        } else {
+            pthread_cond_wait(&pool->wakeup, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void thread_pool_dtor(void *ptr)
+{
+    struct mp_thread_pool *pool = ptr;
+
+    // Workers finish all queued tasks before exiting.
+    pthread_mutex_lock(&pool->lock);
+    pool->terminate = true;
+    pthread_cond_broadcast(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int n = 0; n < pool->num_threads; n++)
+        pthread_join(pool->threads[n], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wakeup);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// Create a pool of worker threads. threads is the total number of threads
+// that run jobs, including the thread calling mp_thread_pool_run(). If it's
+// <= 0, the number of CPU cores is used. Freeing the pool with talloc_free()
+// runs the remaining queued tasks and joins all workers.
+struct mp_thread_pool *mp_thread_pool_create(void *ta_parent, int threads)
+{
+    if (threads <= 0)
+        threads = default_thread_count();
+    threads = MPCLAMP(threads, 1, MAX_THREADS + 1);
+
+    struct mp_thread_pool *pool = talloc_zero(ta_parent, struct mp_thread_pool);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wakeup, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    talloc_set_destructor(pool, thread_pool_dtor);
+
+    for (int n = 0; n < threads - 1; n++) {
+        if (pthread_create(&pool->threads[n], NULL, worker_thread, pool))
+            break;
+        pool->num_threads++;
+    }
+
+    return pool;
+}
+
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mp_thread_pool *shared_pool;
+static int shared_refs;
+
+static void shared_ref_dtor(void *ptr)
+{
+    pthread_mutex_lock(&shared_lock);
+    if (--shared_refs == 0) {
+        talloc_free(shared_pool);
+        shared_pool = NULL;
+    }
+    pthread_mutex_unlock(&shared_lock);
+}
+
+// Return the process-wide pool, which is sized to the number of CPU cores and
+// meant to be used by all subsystems instead of creating their own threads.
+// The pool is referenced until ta_parent is freed; it must not be freed by the
+// caller.
+struct mp_thread_pool *mp_thread_pool_get_shared(void *ta_parent)
+{
+    pthread_mutex_lock(&shared_lock);
+    if (!shared_pool) {
+        // At least 1 worker, so that queued tasks run in the background.
+        shared_pool = mp_thread_pool_create(NULL,
+                                            MPMAX(default_thread_count(), 2));
+    }
+    shared_refs++;
+    struct mp_thread_pool *pool = shared_pool;
+    pthread_mutex_unlock(&shared_lock);
+
+    char *ref = talloc_size(ta_parent, 1);
+    talloc_set_destructor(ref, shared_ref_dtor);
+    return pool;
+}
+
+// Number of threads running jobs concurrently (including the caller).
+int mp_thread_pool_get_threads(struct mp_thread_pool *pool)
+{
+    return pool->num_threads + 1;
+}
+
+// Call fn(ctx, job) for each job in [0, num_jobs), distributed over the pool
+// and the calling thread. Returns once all jobs have finished. The jobs must
+// be independent from each other; their order of execution is undefined.
+// Batches take precedence over queued tasks, and several threads can run
+// batches on the same pool at once.
+void mp_thread_pool_run(struct mp_thread_pool *pool, int num_jobs,
+                        void (*fn)(void *ctx, int job), void *ctx)
+{
+    if (num_jobs <= 0)
+        return;
+
+    if (num_jobs == 1 || !pool->num_threads) {
+        for (int n = 0; n < num_jobs; n++)
+            fn(ctx, n);
+        return;
+    }
+
+    struct work w = {.fn = fn, .ctx = ctx, .num_jobs = num_jobs};
+
+    pthread_mutex_lock(&pool->lock);
+    append_work(pool, LANE_PRIO, &w);
+    pthread_cond_broadcast(&pool->wakeup);
+
+    // Help with our own batch only, so that we return as soon as it's done.
+    while (w.next_job < w.num_jobs)
+        run_job(pool, &w, claim_job(pool, &w));
+    while (w.jobs_done < w.num_jobs)
+        pthread_cond_wait(&pool->done, &pool->lock);
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Run task(ctx) on a worker thread and return immediately. Tasks run in the
+// order they were queued (but possibly at the same time). If the pool has no
+// worker threads, the task is run before returning.
+void mp_thread_pool_queue(struct mp_thread_pool *pool,
+                          void (*task)(void *ctx), void *ctx)
+{
+    if (!pool->num_threads) {
+        task(ctx);
+        return;
+    }
+
+    struct work *w = talloc_ptrtype(NULL, w);
+    *w = (struct work){.task = task, .ctx = ctx, .num_jobs = 1};
+
+    pthread_mutex_lock(&pool->lock);
+    append_work(pool, LANE_NORMAL, w);
+    pthread_cond_signal(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+}
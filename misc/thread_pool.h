@@ -0,0 +1,14 @@
+#ifndef MP_THREAD_POOL_H_
+#define MP_THREAD_POOL_H_
+
+struct mp_thread_pool;
+
+struct mp_thread_pool *mp_thread_pool_create(void *ta_parent, int threads);
+struct mp_thread_pool *mp_thread_pool_get_shared(void *ta_parent);
+int mp_thread_pool_get_threads(struct mp_thread_pool *pool);
+void mp_thread_pool_run(struct mp_thread_pool *pool, int num_jobs,
+                        void (*fn)(void *ctx, int job), void *ctx);
+void mp_thread_pool_queue(struct mp_thread_pool *pool,
+                          void (*task)(void *ctx), void *ctx);
+
+#endif
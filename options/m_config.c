@@ -36,6 +36,7 @@
 #include "m_config.h"
 #include "options/m_option.h"
 #include "common/msg.h"
+#include "osdep/atomics.h"
 
 static const union m_option_value default_value;
 
@@ -164,6 +165,32 @@ static int list_options(struct m_config *config)
 // actually casted from struct some_type* ). The dummy struct type is in
 // theory needed, because void* and struct pointers could have different
 // representations, while pointers to different struct types don't.
+struct m_config_group {
+    const struct m_sub_options *group; // NULL for the root group
+    void *data;                        // the group's struct in optstruct
+    atomic_ullong ts;                  // incremented on every change
+};
+
+// Maps option names to indexes into m_config.opts. The option names and their
+// order depend only on the m_option list passed to m_config_new(), so configs
+// created from the same list share an index.
+struct m_config_index {
+    struct m_config_index *next;
+    const struct m_option *options; // key
+    int num_opts;
+    int refcount;
+    // Open addressing hash table; entries are opts index + 1, or 0 if unused.
+    int *table;
+    unsigned int table_mask;
+    // Options accepting any name with a given prefix, in ascending order.
+    int *wildcards;
+    int num_wildcards;
+};
+
+// Protects m_config_indexes and m_config_index.refcount.
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct m_config_index *m_config_indexes;
+
 static void *substruct_read_ptr(const void *ptr)
 {
     struct mp_dummy_ *res;
@@ -178,16 +205,117 @@ static void substruct_write_ptr(void *ptr, void *val)
 
 static void add_options(struct m_config *config,
                         const char *parent_name,
+                        int group,
                         void *optstruct,
                         const void *optstruct_def,
                         const struct m_option *defs);
 
+static unsigned int hash_name(struct bstr name)
+{
+    unsigned int h = 2166136261u; // FNV-1a
+    for (int n = 0; n < name.len; n++)
+        h = (h ^ name.start[n]) * 16777619u;
+    return h;
+}
+
+static bool is_wildcard_option(struct m_config_option *co)
+{
+    return (co->opt->type->flags & M_OPT_TYPE_ALLOW_WILDCARD) &&
+           bstr_endswith0(bstr0(co->name), "*");
+}
+
+static struct m_config_index *create_index(struct m_config *config,
+                                           const struct m_option *options)
+{
+    struct m_config_index *index = talloc_zero(NULL, struct m_config_index);
+    index->options = options;
+    index->num_opts = config->num_opts;
+    index->refcount = 1;
+    unsigned int size = 16;
+    while (size < config->num_opts * 2)
+        size *= 2;
+    index->table = talloc_zero_array(index, int, size);
+    index->table_mask = size - 1;
+    for (int n = 0; n < config->num_opts; n++) {
+        struct m_config_option *co = &config->opts[n];
+        if (is_wildcard_option(co)) {
+            MP_TARRAY_APPEND(index, index->wildcards, index->num_wildcards, n);
+            continue;
+        }
+        unsigned int i = hash_name(bstr0(co->name)) & index->table_mask;
+        while (index->table[i]) {
+            // Like the linear search did, the first option wins.
+            if (strcmp(config->opts[index->table[i] - 1].name, co->name) == 0)
+                break;
+            i = (i + 1) & index->table_mask;
+        }
+        if (!index->table[i])
+            index->table[i] = n + 1;
+    }
+    return index;
+}
+
+static void acquire_index(struct m_config *config, const struct m_option *options)
+{
+    pthread_mutex_lock(&index_lock);
+    struct m_config_index *index = m_config_indexes;
+    while (index && !(index->options == options &&
+                      index->num_opts == config->num_opts))
+        index = index->next;
+    if (index) {
+        index->refcount++;
+    } else {
+        index = create_index(config, options);
+        index->next = m_config_indexes;
+        m_config_indexes = index;
+    }
+    config->index = index;
+    pthread_mutex_unlock(&index_lock);
+}
+
+static void release_index(struct m_config *config)
+{
+    struct m_config_index *index = config->index;
+    if (!index)
+        return;
+    pthread_mutex_lock(&index_lock);
+    if (--index->refcount == 0) {
+        struct m_config_index **p = &m_config_indexes;
+        while (*p != index)
+            p = &(*p)->next;
+        *p = index->next;
+        talloc_free(index);
+    }
+    pthread_mutex_unlock(&index_lock);
+    config->index = NULL;
+}
+
 static void config_destroy(void *p)
 {
     struct m_config *config = p;
     m_config_restore_backups(config);
     for (int n = 0; n < config->num_opts; n++)
         m_option_free(config->opts[n].opt, config->opts[n].data);
+    release_index(config);
+    pthread_mutex_destroy(&config->lock);
+}
+
+static int add_group(struct m_config *config, const struct m_sub_options *group,
+                     void *data)
+{
+    struct m_config_group g = {.group = group, .data = data};
+    MP_TARRAY_APPEND(config, config->groups, config->num_groups, g);
+    return config->num_groups - 1;
+}
+
+// Set co->data to data, and notify option caches.
+static void write_option(struct m_config *config, struct m_config_option *co,
+                         void *data)
+{
+    pthread_mutex_lock(&config->lock);
+    m_option_copy(co->opt, co->data, data);
+    atomic_fetch_add(&config->groups[co->group].ts, 1);
+    pthread_mutex_unlock(&config->lock);
 }
 
 struct m_config *m_config_new(void *talloc_ctx, struct mp_log *log,
@@ -197,14 +325,18 @@ struct m_config *m_config_new(void *talloc_ctx, struct mp_log *log,
     struct m_config *config = talloc(talloc_ctx, struct m_config);
     talloc_set_destructor(config, config_destroy);
     *config = (struct m_config) {.log = log};
+    pthread_mutex_init(&config->lock, NULL);
     // size==0 means a dummy object is created
     if (size) {
         config->optstruct = talloc_zero_size(config, size);
         if (defaults)
             memcpy(config->optstruct, defaults, size);
     }
-    if (options)
-        add_options(config, "", config->optstruct, defaults, options);
+    add_group(config, NULL, config->optstruct);
+    if (options) {
+        add_options(config, "", 0, config->optstruct, defaults, options);
+        acquire_index(config, options);
+    }
     return config;
 }
 
@@ -276,7 +408,7 @@ void m_config_restore_backups(struct m_config *config)
         struct m_opt_backup *bc = config->backup_opts;
         config->backup_opts = bc->next;
 
-        m_option_copy(bc->co->opt, bc->co->data, bc->backup);
+        write_option(config, bc->co, bc->backup);
         m_option_free(bc->co->opt, bc->backup);
         talloc_free(bc);
     }
@@ -345,22 +477,27 @@ static void add_negation_option(struct m_config *config,
 
 static void m_config_add_option(struct m_config *config,
                                 const char *parent_name,
+                                int group,
                                 void *optstruct,
                                 const void *optstruct_def,
                                 const struct m_option *arg);
 
 static void add_options(struct m_config *config,
                         const char *parent_name,
+                        int group,
                         void *optstruct,
                         const void *optstruct_def,
                         const struct m_option *defs)
 {
-    for (int i = 0; defs && defs[i].name; i++)
-        m_config_add_option(config, parent_name, optstruct, optstruct_def, &defs[i]);
+    for (int i = 0; defs && defs[i].name; i++) {
+        m_config_add_option(config, parent_name, group, optstruct,
+                            optstruct_def, &defs[i]);
+    }
 }
 
 static void m_config_add_option(struct m_config *config,
                                 const char *parent_name,
+                                int group,
                                 void *optstruct,
                                 const void *optstruct_def,
                                 const struct m_option *arg)
@@ -371,6 +508,7 @@ static void m_config_add_option(struct m_config *config,
     struct m_config_option co = {
         .opt = arg,
         .name = arg->name,
+        .group = group,
     };
 
     if (arg->offset >= 0) {
@@ -398,16 +536,18 @@ static void m_config_add_option(struct m_config *config,
         const struct m_sub_options *subopts = arg->priv;
 
         void *new_optstruct = NULL;
+        int new_group = group;
         if (co.data) {
             new_optstruct = m_config_alloc_struct(config, subopts);
             substruct_write_ptr(co.data, new_optstruct);
+            new_group = add_group(config, subopts, new_optstruct);
         }
 
         const void *new_optstruct_def = substruct_read_ptr(co.default_data);
         if (!new_optstruct_def)
             new_optstruct_def = subopts->defaults;
 
-        add_options(config, co.name, new_optstruct,
+        add_options(config, co.name, new_group, new_optstruct,
                     new_optstruct_def, subopts->opts);
     } else {
         // Initialize options
@@ -436,19 +576,33 @@ static void m_config_add_option(struct m_config *config,
 struct m_config_option *m_config_get_co(const struct m_config *config,
                                         struct bstr name)
 {
+    struct m_config_index *index = config->index;
+    if (!index)
+        return NULL;
+
+    int found = config->num_opts;
+    unsigned int i = hash_name(name) & index->table_mask;
+    while (index->table[i]) {
+        int n = index->table[i] - 1;
+        if (bstrcmp(bstr0(config->opts[n].name), name) == 0) {
+            found = n;
+            break;
+        }
+        i = (i + 1) & index->table_mask;
+    }
 
-    for (int n = 0; n < config->num_opts; n++) {
-        struct m_config_option *co = &config->opts[n];
-        struct bstr coname = bstr0(co->name);
-        if ((co->opt->type->flags & M_OPT_TYPE_ALLOW_WILDCARD)
-                && bstr_endswith0(coname, "*")) {
-            coname.len--;
-            if (bstrcmp(bstr_splice(name, 0, coname.len), coname) == 0)
-                return co;
-        } else if (bstrcmp(coname, name) == 0)
-            return co;
+    // A wildcard option listed before the exact match takes precedence.
+    for (int w = 0; w < index->num_wildcards; w++) {
+        int n = index->wildcards[w];
+        if (n > found)
+            break;
+        struct bstr coname = bstr0(config->opts[n].name);
+        coname.len--;
+        if (bstrcmp(bstr_splice(name, 0, coname.len), coname) == 0)
+            return &config->opts[n];
     }
-    return NULL;
+
+    return found < config->num_opts ? &config->opts[found] : NULL;
 }
 
 const char *m_config_get_positional_option(const struct m_config *config, int p)
@@ -533,12 +687,19 @@ int m_config_set_option_raw(struct m_config *config, struct m_config_option *co,
     if (r <= 1)
         return r;
 
-    m_option_copy(co->opt, co->data, data);
+    write_option(config, co, data);
     if (flags & M_SETOPT_FROM_CMDLINE)
         handle_set_from_cmdline(config, co);
     return 0;
 }
 
+void m_config_set_option_raw_direct(struct m_config *config,
+                                    struct m_config_option *co, void *data)
+{
+    if (co && co->data)
+        write_option(config, co, data);
+}
+
 static int parse_subopts(struct m_config *config, char *name, char *prefix,
                          struct bstr param, int flags);
 
@@ -592,7 +753,16 @@ static int m_config_parse_option(struct m_config *config, struct bstr name,
         return parse_subopts(config, (char *)co->name, prefix, param, flags);
     }
 
-    r = m_option_parse(config->log, co->opt, name, param, set ? co->data : NULL);
+    if (!set || !co->data)
+        return m_option_parse(config->log, co->opt, name, param, NULL);
+
+    // Parse into a copy (some types modify the old value, e.g. list appends).
+    union m_option_value val = {0};
+    m_option_copy(co->opt, &val, co->data);
+    r = m_option_parse(config->log, co->opt, name, param, &val);
+    if (r >= 0)
+        write_option(config, co, &val);
+    m_option_free(co->opt, &val);
 
     if (r >= 0 && set && (flags & M_SETOPT_FROM_CMDLINE))
         handle_set_from_cmdline(config, co);
@@ -897,6 +1067,8 @@ void *m_sub_options_copy(void *talloc_ctx, const struct m_sub_options *opts,
         memcpy(new, opts->defaults, opts->size);
     for (int n = 0; opts->opts && opts->opts[n].type; n++) {
         const struct m_option *opt = &opts->opts[n];
+        if (opt->offset < 0)
+            continue;
         // not implemented, because it adds lots of complexity
         assert(!(opt->type->flags  & M_OPT_TYPE_HAS_CHILD));
         void *src = (char *)ptr + opt->offset;
@@ -984,3 +1156,52 @@ static const char *const replaced_opts =
     "|volstep#edit input.conf directly instead"
     "|"
 ;
+
+struct m_config_cache *m_config_cache_alloc(void *ta_parent,
+                                            struct m_config *config,
+                                            const struct m_sub_options *group)
+{
+    int group_index = -1;
+    for (int n = 0; n < config->num_groups; n++) {
+        if (config->groups[n].group == group) {
+            group_index = n;
+            break;
+        }
+    }
+    if (group_index < 0)
+        return NULL;
+
+    struct m_config_cache *cache = talloc_ptrtype(ta_parent, cache);
+    *cache = (struct m_config_cache){
+        .config = config,
+        .group = group_index,
+    };
+    struct m_config_group *g = &config->groups[group_index];
+    pthread_mutex_lock(&config->lock);
+    cache->opts = m_sub_options_copy(cache, group, g->data);
+    cache->ts = atomic_load(&g->ts);
+    pthread_mutex_unlock(&config->lock);
+    return cache;
+}
+
+bool m_config_cache_update(struct m_config_cache *cache)
+{
+    struct m_config_group *g = &cache->config->groups[cache->group];
+    if (atomic_load(&g->ts) == cache->ts)
+        return false;
+
+    pthread_mutex_lock(&cache->config->lock);
+    const struct m_option *opts = g->group->opts;
+    for (int n = 0; opts && opts[n].type; n++) {
+        if (opts[n].offset < 0)
+            continue;
+        // m_sub_options_copy() doesn't support these either
+        assert(!(opts[n].type->flags & M_OPT_TYPE_HAS_CHILD));
+        void *src = (char *)g->data + opts[n].offset;
+        void *dst = (char *)cache->opts + opts[n].offset;
+        m_option_copy(&opts[n], dst, src);
+    }
+    cache->ts = atomic_load(&g->ts);
+    pthread_mutex_unlock(&cache->config->lock);
+    return true;
+}
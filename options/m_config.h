@@ -21,6 +21,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "misc/bstr.h"
 
@@ -44,8 +46,12 @@ struct m_config_option {
     const struct m_option *opt;     // Option description
     void *data;                     // Raw value of the option
     const void *default_data;       // Raw default value
+    int group;                      // Index into m_config.groups
 };
 
+struct m_config_group;
+struct m_config_index;
+
 // Config object
 /** \ingroup Config */
 typedef struct m_config {
@@ -54,6 +60,9 @@ typedef struct m_config {
     // Registered options.
     struct m_config_option *opts; // all options, even suboptions
     int num_opts;
+    // Name lookup table for opts (shared between configs with the same
+    // option list).
+    struct m_config_index *index;
 
     // List of defined profiles.
     struct m_profile *profiles;
@@ -71,6 +80,13 @@ typedef struct m_config {
     int recursion_depth;
 
     void *optstruct; // struct mpopts or other
+
+    // Option groups (sub-option structs); groups[0] is optstruct itself.
+    struct m_config_group *groups;
+    int num_groups;
+    // Serializes writing options with the m_config API against copying them
+    // in m_config_cache_update().
+    pthread_mutex_t lock;
 } m_config_t;
 
 // Create a new config object.
@@ -152,6 +168,11 @@ static inline int m_config_set_option0(struct m_config *config,
 int m_config_set_option_raw(struct m_config *config, struct m_config_option *co,
                             void *data, int flags);
 
+// Write data to the option, without checking any flags. This is for code that
+// used to write co->data directly. Option caches are notified.
+void m_config_set_option_raw_direct(struct m_config *config,
+                                    struct m_config_option *co, void *data);
+
 // Similar to m_config_set_option_ext(), but set as data using mpv_node.
 struct mpv_node;
 int m_config_set_option_node(struct m_config *config, bstr name,
@@ -246,4 +267,30 @@ void *m_config_alloc_struct(void *talloc_ctx,
 void *m_sub_options_copy(void *talloc_ctx, const struct m_sub_options *opts,
                          const void *ptr);
 
+// A copy of an option group, which can be used from any thread, and is
+// updated on request. Changes through the m_config API (setting options,
+// properties, restoring per-file backups) are picked up; code writing to the
+// main option struct directly must use m_config_set_option_raw_direct().
+struct m_config_cache {
+    // The copy of the option struct (type as described by the group).
+    void *opts;
+
+    struct m_config *config;
+    int group;
+    uint64_t ts;
+};
+
+// Create a cache for the group described by the given sub-option struct (the
+// first one if it is used several times). The config object must outlive the
+// cache. Returns NULL if the sub-options are not part of the config.
+struct m_config_cache *m_config_cache_alloc(void *ta_parent,
+                                            struct m_config *config,
+                                            const struct m_sub_options *group);
+
+// Copy the group's options to cache->opts if they changed. This is a single
+// atomic load if nothing changed. Returns whether anything was copied.
+// Pointers to option values in cache->opts are invalidated if true is
+// returned.
+bool m_config_cache_update(struct m_config_cache *cache);
+
 #endif /* MPLAYER_M_CONFIG_H */
@@ -80,44 +80,88 @@ static bool translate_legacy_property(struct mp_log *log, const char *name,
     return true;
 }
 
-static struct m_property *m_property_list_find(const struct m_property *list,
-                                                     const char *name)
+struct m_property_index {
+    const struct m_property *list;
+    const struct m_property **sorted;   // entries of list, sorted by name
+    int num;
+};
+
+static int compare_entry(const void *a, const void *b)
 {
-    for (int n = 0; list && list[n].name; n++) {
-        if (strcmp(list[n].name, name) == 0)
-            return (struct m_property *)&list[n];
-    }
-    return NULL;
+    const struct m_property *const *pa = a, *const *pb = b;
+    return strcmp((*pa)->name, (*pb)->name);
 }
 
-static int do_action(const struct m_property *prop_list, const char *name,
-                     int action, void *arg, void *ctx)
+struct m_property_index *m_property_index_new(void *ta_parent,
+                                              const struct m_property *list)
 {
-    const char *sep;
+    struct m_property_index *index = talloc_zero(ta_parent,
+                                                 struct m_property_index);
+    index->list = list;
+    while (list[index->num].name)
+        index->num++;
+    index->sorted = talloc_array(index, const struct m_property *, index->num);
+    for (int n = 0; n < index->num; n++)
+        index->sorted[n] = &list[n];
+    qsort(index->sorted, index->num, sizeof(index->sorted[0]), compare_entry);
+    return index;
+}
+
+int m_property_index_lookup(const struct m_property_index *index, bstr name)
+{
+    int lo = 0, hi = index->num;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = bstrcmp0(name, index->sorted[mid]->name);
+        if (c == 0)
+            return index->sorted[mid] - index->list;
+        if (c > 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+struct resolved_prop {
     struct m_property *prop;
-    struct m_property_action_arg ka;
-    if ((sep = strchr(name, '/')) && sep[1]) {
-        int len = sep - name;
-        char base[len + 1];
-        memcpy(base, name, len);
-        base[len] = 0;
-        prop = m_property_list_find(prop_list, base);
-        ka = (struct m_property_action_arg) {
-            .key = sep + 1,
+    const char *key;        // sub-property path, or NULL
+};
+
+static bool resolve_property(const struct m_property_index *index,
+                             const char *name, struct resolved_prop *res)
+{
+    const char *sep = strchr(name, '/');
+    bstr base = bstr0(name);
+    *res = (struct resolved_prop){0};
+    if (sep && sep[1]) {
+        base = bstr_splice(base, 0, sep - name);
+        res->key = sep + 1;
+    }
+    int id = m_property_index_lookup(index, base);
+    if (id < 0)
+        return false;
+    res->prop = (struct m_property *)&index->list[id];
+    return true;
+}
+
+static int do_action(struct resolved_prop *res, int action, void *arg,
+                     void *ctx)
+{
+    if (res->key) {
+        struct m_property_action_arg ka = {
+            .key = res->key,
             .action = action,
             .arg = arg,
         };
-        action = M_PROPERTY_KEY_ACTION;
-        arg = &ka;
-    } else
-        prop = m_property_list_find(prop_list, name);
-    if (!prop)
-        return M_PROPERTY_UNKNOWN;
-    return prop->call(ctx, prop, action, arg);
+        return res->prop->call(ctx, res->prop, M_PROPERTY_KEY_ACTION, &ka);
+    }
+    return res->prop->call(ctx, res->prop, action, arg);
 }
 
 // (as a hack, log can be NULL on read-only paths)
-int m_property_do(struct mp_log *log, const struct m_property *prop_list,
+int m_property_do(struct mp_log *log, const struct m_property_index *index,
                   const char *in_name, int action, void *arg, void *ctx)
 {
     union m_option_value val = {0};
@@ -127,18 +171,24 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
     if (!translate_legacy_property(log, in_name, name, sizeof(name)))
         return M_PROPERTY_UNKNOWN;
 
+    // Look up the property only once; the fallbacks below may call it
+    // several times.
+    struct resolved_prop prop;
+    if (!resolve_property(index, name, &prop))
+        return M_PROPERTY_UNKNOWN;
+
     struct m_option opt = {0};
-    r = do_action(prop_list, name, M_PROPERTY_GET_TYPE, &opt, ctx);
+    r = do_action(&prop, M_PROPERTY_GET_TYPE, &opt, ctx);
     if (r <= 0)
         return r;
     assert(opt.type);
 
     switch (action) {
     case M_PROPERTY_PRINT: {
-        if ((r = do_action(prop_list, name, M_PROPERTY_PRINT, arg, ctx)) >= 0)
+        if ((r = do_action(&prop, M_PROPERTY_PRINT, arg, ctx)) >= 0)
             return r;
         // Fallback to m_option
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(&prop, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         char *str = m_option_pretty_print(&opt, &val);
         m_option_free(&opt, &val);
@@ -146,7 +196,7 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
         return str != NULL;
     }
     case M_PROPERTY_GET_STRING: {
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(&prop, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         char *str = m_option_print(&opt, &val);
         m_option_free(&opt, &val);
@@ -158,7 +208,7 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
             return M_PROPERTY_ERROR;
         if (m_option_parse(log, &opt, bstr0(name), bstr0(arg), &val) < 0)
             return M_PROPERTY_ERROR;
-        r = do_action(prop_list, name, M_PROPERTY_SET, &val, ctx);
+        r = do_action(&prop, M_PROPERTY_SET, &val, ctx);
         m_option_free(&opt, &val);
         return r;
     }
@@ -166,16 +216,16 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
         if (!log)
             return M_PROPERTY_ERROR;
         struct m_property_switch_arg *sarg = arg;
-        if ((r = do_action(prop_list, name, M_PROPERTY_SWITCH, arg, ctx)) !=
+        if ((r = do_action(&prop, M_PROPERTY_SWITCH, arg, ctx)) !=
             M_PROPERTY_NOT_IMPLEMENTED)
             return r;
         // Fallback to m_option
         if (!opt.type->add)
             return M_PROPERTY_NOT_IMPLEMENTED;
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(&prop, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         opt.type->add(&opt, &val, sarg->inc, sarg->wrap);
-        r = do_action(prop_list, name, M_PROPERTY_SET, &val, ctx);
+        r = do_action(&prop, M_PROPERTY_SET, &val, ctx);
         m_option_free(&opt, &val);
         return r;
     }
@@ -189,13 +239,13 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
             mp_err(log, "Property '%s': invalid value.\n", name);
             return M_PROPERTY_ERROR;
         }
-        return do_action(prop_list, name, M_PROPERTY_SET, arg, ctx);
+        return do_action(&prop, M_PROPERTY_SET, arg, ctx);
     }
     case M_PROPERTY_GET_NODE: {
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET_NODE, arg, ctx)) !=
+        if ((r = do_action(&prop, M_PROPERTY_GET_NODE, arg, ctx)) !=
             M_PROPERTY_NOT_IMPLEMENTED)
             return r;
-        if ((r = do_action(prop_list, name, M_PROPERTY_GET, &val, ctx)) <= 0)
+        if ((r = do_action(&prop, M_PROPERTY_GET, &val, ctx)) <= 0)
             return r;
         struct mpv_node *node = arg;
         int err = m_option_get_node(&opt, NULL, node, &val);
@@ -210,7 +260,7 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
         return r;
     }
     case M_PROPERTY_SET_NODE: {
-        if ((r = do_action(prop_list, name, M_PROPERTY_SET_NODE, arg, ctx)) !=
+        if ((r = do_action(&prop, M_PROPERTY_SET_NODE, arg, ctx)) !=
             M_PROPERTY_NOT_IMPLEMENTED)
             return r;
         struct mpv_node *node = arg;
@@ -220,13 +270,13 @@ int m_property_do(struct mp_log *log, const struct m_property *prop_list,
         } else if (err < 0) {
             r = M_PROPERTY_INVALID_FORMAT;
         } else {
-            r = do_action(prop_list, name, M_PROPERTY_SET, &val, ctx);
+            r = do_action(&prop, M_PROPERTY_SET, &val, ctx);
         }
         m_option_free(&opt, &val);
         return r;
     }
     default:
-        return do_action(prop_list, name, action, arg, ctx);
+        return do_action(&prop, action, arg, ctx);
     }
 }
 
@@ -257,14 +307,14 @@ static void m_property_unkey(int *action, void **arg)
     }
 }
 
-static int m_property_do_bstr(const struct m_property *prop_list, bstr name,
+static int m_property_do_bstr(const struct m_property_index *index, bstr name,
                               int action, void *arg, void *ctx)
 {
     char name0[64];
     if (name.len >= sizeof(name0))
         return M_PROPERTY_UNKNOWN;
     snprintf(name0, sizeof(name0), "%.*s", BSTR_P(name));
-    return m_property_do(NULL, prop_list, name0, action, arg, ctx);
+    return m_property_do(NULL, index, name0, action, arg, ctx);
 }
 
 static void append_str(char **s, int *len, bstr append)
@@ -274,7 +324,7 @@ static void append_str(char **s, int *len, bstr append)
     *len = *len + append.len;
 }
 
-static int expand_property(const struct m_property *prop_list, char **ret,
+static int expand_property(const struct m_property_index *index, char **ret,
                            int *ret_len, bstr prop, bool silent_error, void *ctx)
 {
     bool cond_yes = bstr_eatstart0(&prop, "?");
@@ -288,7 +338,7 @@ static int expand_property(const struct m_property *prop_list, char **ret,
     int method = raw ? M_PROPERTY_GET_STRING : M_PROPERTY_PRINT;
 
     char *s = NULL;
-    int r = m_property_do_bstr(prop_list, prop, method, &s, ctx);
+    int r = m_property_do_bstr(index, prop, method, &s, ctx);
     bool skip;
     if (comp) {
         skip = ((s && bstr_equals0(comp_with, s)) != cond_yes);
@@ -305,19 +355,44 @@ static int expand_property(const struct m_property *prop_list, char **ret,
     return skip;
 }
 
-char *m_properties_expand_string(const struct m_property *prop_list,
-                                 const char *str0, void *ctx)
+enum {
+    TMPL_TEXT,      // literal text
+    TMPL_PROP,      // "${" and the property part up to ":" or "}"
+    TMPL_CLOSE,     // "}" terminating a TMPL_PROP
+};
+
+struct tmpl_token {
+    int type;
+    bstr text;              // literal text, or the property part
+    bool have_fallback;     // TMPL_PROP only
+};
+
+struct m_property_template {
+    struct tmpl_token *tokens;
+    int num_tokens;
+};
+
+static void add_tmpl_text(struct m_property_template *t, bstr text)
 {
-    char *ret = NULL;
-    int ret_len = 0;
-    bool skip = false;
-    int level = 0, skip_level = 0;
+    if (!t->num_tokens || t->tokens[t->num_tokens - 1].type != TMPL_TEXT) {
+        struct tmpl_token tok = {.type = TMPL_TEXT};
+        MP_TARRAY_APPEND(t, t->tokens, t->num_tokens, tok);
+    }
+    bstr_xappend(t, &t->tokens[t->num_tokens - 1].text, text);
+}
+
+struct m_property_template *m_property_template_new(void *ta_parent,
+                                                    const char *str0)
+{
+    struct m_property_template *t = talloc_zero(ta_parent,
+                                                struct m_property_template);
+    int level = 0;
     bstr str = bstr0(str0);
 
     while (str.len) {
         if (level > 0 && bstr_eatstart0(&str, "}")) {
-            if (skip && level <= skip_level)
-                skip = false;
+            struct tmpl_token tok = {.type = TMPL_CLOSE};
+            MP_TARRAY_APPEND(t, t->tokens, t->num_tokens, tok);
             level--;
         } else if (bstr_startswith0(str, "${") && bstr_find0(str, "}") >= 0) {
             str = bstr_cut(str, 2);
@@ -328,16 +403,14 @@ char *m_properties_expand_string(const struct m_property *prop_list,
             int term_pos = bstrcspn(str, ":}");
             bstr name = bstr_splice(str, 0, term_pos < 0 ? str.len : term_pos);
             str = bstr_cut(str, term_pos);
-            bool have_fallback = bstr_eatstart0(&str, ":");
-
-            if (!skip) {
-                skip = expand_property(prop_list, &ret, &ret_len, name,
-                                       have_fallback, ctx);
-                if (skip)
-                    skip_level = level;
-            }
+            struct tmpl_token tok = {
+                .type = TMPL_PROP,
+                .text = bstrdup(t, name),
+                .have_fallback = bstr_eatstart0(&str, ":"),
+            };
+            MP_TARRAY_APPEND(t, t->tokens, t->num_tokens, tok);
         } else if (level == 0 && bstr_eatstart0(&str, "$>")) {
-            append_str(&ret, &ret_len, str);
+            add_tmpl_text(t, str);
             break;
         } else {
             char c;
@@ -352,8 +425,43 @@ char *m_properties_expand_string(const struct m_property *prop_list,
                 str = bstr_cut(str, 1);
             }
 
+            add_tmpl_text(t, (bstr){&c, 1});
+        }
+    }
+
+    return t;
+}
+
+char *m_property_template_expand(const struct m_property_index *index,
+                                 const struct m_property_template *t,
+                                 void *ctx)
+{
+    char *ret = NULL;
+    int ret_len = 0;
+    bool skip = false;
+    int level = 0, skip_level = 0;
+
+    for (int n = 0; n < t->num_tokens; n++) {
+        const struct tmpl_token *tok = &t->tokens[n];
+        switch (tok->type) {
+        case TMPL_CLOSE:
+            if (skip && level <= skip_level)
+                skip = false;
+            level--;
+            break;
+        case TMPL_PROP:
+            level++;
+            if (!skip) {
+                skip = expand_property(index, &ret, &ret_len, tok->text,
+                                       tok->have_fallback, ctx);
+                if (skip)
+                    skip_level = level;
+            }
+            break;
+        case TMPL_TEXT:
             if (!skip)
-                MP_TARRAY_APPEND(NULL, ret, ret_len, c);
+                append_str(&ret, &ret_len, tok->text);
+            break;
         }
     }
 
@@ -361,6 +469,15 @@ char *m_properties_expand_string(const struct m_property *prop_list,
     return ret;
 }
 
+char *m_properties_expand_string(const struct m_property_index *index,
+                                 const char *str, void *ctx)
+{
+    struct m_property_template *t = m_property_template_new(NULL, str);
+    char *ret = m_property_template_expand(index, t, ctx);
+    talloc_free(t);
+    return ret;
+}
+
 void m_properties_print_help_list(struct mp_log *log,
                                   const struct m_property *list)
 {
@@ -129,11 +129,21 @@ struct m_property {
     void *priv;
 };
 
+// Sorted lookup table for a property list (terminated by an entry with
+// name==NULL). The list must outlive the index and must not be changed.
+struct m_property_index;
+struct m_property_index *m_property_index_new(void *ta_parent,
+                                              const struct m_property *list);
+
+// Return the position of the property with exactly this name in the list
+// passed to m_property_index_new(), or -1 if there is none.
+int m_property_index_lookup(const struct m_property_index *index, bstr name);
+
 // Access a property.
 // action: one of m_property_action
 // ctx: opaque value passed through to property implementation
 // returns: one of mp_property_return
-int m_property_do(struct mp_log *log, const struct m_property* prop_list,
+int m_property_do(struct mp_log *log, const struct m_property_index *index,
                   const char* property_name, int action, void* arg, void *ctx);
 
 // Given a path of the form "a/b/c", this function will set *prefix to "a",
@@ -158,9 +168,18 @@ void m_properties_print_help_list(struct mp_log *log,
 // STR is recursively expanded using the same rules.
 // "$$" can be used to escape "$", and "$}" to escape "}".
 // "$>" disables parsing of "$" for the rest of the string.
-char* m_properties_expand_string(const struct m_property *prop_list,
+char* m_properties_expand_string(const struct m_property_index *index,
                                  const char *str, void *ctx);
 
+// A property string as accepted by m_properties_expand_string(), parsed once
+// so that it can be expanded repeatedly without parsing it again.
+struct m_property_template;
+struct m_property_template *m_property_template_new(void *ta_parent,
+                                                    const char *str);
+char *m_property_template_expand(const struct m_property_index *index,
+                                 const struct m_property_template *t,
+                                 void *ctx);
+
 // Trivial helpers for implementing properties.
 int m_property_flag_ro(int action, void* arg, int var);
 int m_property_int_ro(int action, void* arg, int var);
@@ -189,6 +208,10 @@ struct m_sub_property {
     .type = CONF_TYPE_STRING, .value = {.string = (char *)(s)}
 #define SUB_PROP_FLOAT(f) \
     .type = CONF_TYPE_FLOAT, .value = {.float_ = (f)}
+#define SUB_PROP_DOUBLE(f) \
+    .type = CONF_TYPE_DOUBLE, .value = {.double_ = (f)}
+#define SUB_PROP_INT64(i) \
+    .type = CONF_TYPE_INT64, .value = {.int64 = (i)}
 #define SUB_PROP_FLAG(f) \
     .type = CONF_TYPE_FLAG, .value = {.flag = (f)}
 
@@ -108,6 +108,7 @@ const m_option_t mp_opts[] = {
     OPT_GENERAL(char*, "msg-level", msglevels, CONF_GLOBAL|CONF_PRE_PARSE,
                 .type = &m_option_type_msglevels),
     OPT_STRING("dump-stats", dump_stats, CONF_GLOBAL | CONF_PRE_PARSE),
+    OPT_FLAG("dump-startup-timings", dump_startup_timings, CONF_GLOBAL),
     OPT_FLAG("msg-color", msg_color, CONF_GLOBAL | CONF_PRE_PARSE),
     OPT_FLAG("msg-module", msg_module, CONF_GLOBAL),
     OPT_FLAG("msg-time", msg_time, CONF_GLOBAL),
@@ -125,6 +126,7 @@ const m_option_t mp_opts[] = {
     OPT_STRING("config-dir", force_configdir,
                CONF_GLOBAL | CONF_NOCFG | CONF_PRE_PARSE),
     OPT_STRINGLIST("reset-on-next-file", reset_options, M_OPT_GLOBAL),
+    OPT_STRING("input-unix-socket", ipc_path, CONF_GLOBAL | M_OPT_FILE),
 
 #if HAVE_LUA
     OPT_STRINGLIST("lua", lua_files, CONF_GLOBAL | M_OPT_FILE),
@@ -142,8 +144,11 @@ const m_option_t mp_opts[] = {
                       ({"no", 0})),
     OPT_INTRANGE("cache-initial", stream_cache.initial, 0, 0, 0x7fffffff),
     OPT_INTRANGE("cache-seek-min", stream_cache.seek_min, 0, 0, 0x7fffffff),
+    OPT_INTRANGE("cache-connections", stream_cache.connections, 0, 1, 16),
     OPT_STRING("cache-file", stream_cache.file, M_OPT_FILE),
     OPT_INTRANGE("cache-file-size", stream_cache.file_max, 0, 0, 0x7fffffff),
+    OPT_STRING("cache-dir", stream_cache.dir, M_OPT_FILE),
+    OPT_INTRANGE("cache-dir-size", stream_cache.dir_max, 0, 0, 0x7fffffff),
 
 #if HAVE_DVDREAD || HAVE_DVDNAV
     OPT_STRING("dvd-device", dvd_device, M_OPT_FILE),
@@ -201,9 +206,11 @@ const m_option_t mp_opts[] = {
 
     OPT_STRING("quvi-format", quvi_format, 0),
     OPT_FLAG("quvi-fetch-subtitles", quvi_fetch_subtitles, 0),
+    OPT_INTRANGE("quvi-cache-ttl", quvi_cache_ttl, 0, 0, 24 * 60 * 60),
+    OPT_FLAG("quvi-prefetch", quvi_prefetch, 0),
 
-    OPT_CHOICE("hls-bitrate", hls_bitrate, M_OPT_FIXED,
-               ({"no", 0}, {"min", 1}, {"max", 2})),
+    OPT_CHOICE_OR_INT("hls-bitrate", hls_bitrate, M_OPT_FIXED, 0, INT_MAX,
+                      ({"no", -1}, {"min", 0}, {"max", INT_MAX})),
 
 #if HAVE_CDDA
     OPT_SUBSTRUCT("cdda", stream_cdda_opts, stream_cdda_conf, 0),
@@ -219,12 +226,23 @@ const m_option_t mp_opts[] = {
     OPT_DOUBLE("demuxer-readahead-secs", demuxer_min_secs, M_OPT_MIN, .min = 0),
     OPT_INTRANGE("demuxer-readahead-packets", demuxer_min_packs, 0, 0, MAX_PACKS),
     OPT_INTRANGE("demuxer-readahead-bytes", demuxer_min_bytes, 0, 0, MAX_PACK_BYTES),
+    OPT_INTRANGE("demuxer-back-bytes", demuxer_back_bytes, 0, 0, MAX_PACK_BYTES),
+    OPT_INTRANGE("demuxer-unselected-bytes", demuxer_unselected_bytes, 0, 0,
+                 MAX_PACK_BYTES),
+    OPT_INTRANGE("demuxer-max-bytes", demuxer_max_bytes, 0, 1, 0x7fffffff),
+    OPT_DOUBLE("demuxer-readahead-video-secs", demuxer_min_secs_video, 0),
+    OPT_DOUBLE("demuxer-readahead-audio-secs", demuxer_min_secs_audio, 0),
+    OPT_DOUBLE("demuxer-back-secs", demuxer_back_secs, M_OPT_MIN, .min = 0),
 
     OPT_DOUBLE("cache-secs", demuxer_min_secs_cache, M_OPT_MIN, .min = 0),
     OPT_FLAG("cache-pause", cache_pausing, 0),
+    OPT_INTRANGE("memory-budget", memory_budget, CONF_GLOBAL, 0, 0x7fffffff),
+    OPT_FLAG("memory-pressure", memory_pressure, CONF_GLOBAL),
 
     OPT_DOUBLE("mf-fps", mf_fps, 0),
     OPT_STRING("mf-type", mf_type, 0),
+    OPT_INTRANGE("mf-prefetch", mf_prefetch, 0, 0, 256),
+    OPT_INTRANGE("mf-prefetch-bytes", mf_prefetch_bytes, 0, 0, MAX_PACK_BYTES),
 #if HAVE_TV
     OPT_SUBSTRUCT("tv", tv_params, tv_params_conf, 0),
 #endif /* HAVE_TV */
@@ -258,6 +276,7 @@ const m_option_t mp_opts[] = {
     OPT_SETTINGSLIST("af*", af_settings, M_OPT_FIXED, &af_obj_list),
     OPT_SETTINGSLIST("vf-defaults", vf_defs, 0, &vf_obj_list),
     OPT_SETTINGSLIST("vf*", vf_settings, M_OPT_FIXED, &vf_obj_list),
+    OPT_FLAG("vf-pipeline", vf_pipeline, 0),
 
     OPT_CHOICE("deinterlace", deinterlace, M_OPT_OPTIONAL_PARAM | M_OPT_FIXED,
                ({"auto", -1},
@@ -266,6 +285,9 @@ const m_option_t mp_opts[] = {
 
     OPT_STRING("ad", audio_decoders, 0),
     OPT_STRING("vd", video_decoders, 0),
+    OPT_INTRANGE("video-decode-ahead", video_decode_ahead, 0, 0, 32),
+    OPT_FLAG("video-reuse-decoder", video_reuse_decoder, 0),
+    OPT_STRINGLIST("video-wall", video_wall, 0),
 
     OPT_FLAG("ad-spdif-dtshd", dtshd, 0),
     OPT_FLAG("dtshd", dtshd, 0), // old alias
@@ -298,6 +320,7 @@ const m_option_t mp_opts[] = {
 
     OPT_FLAG("demuxer-mkv-subtitle-preroll", mkv_subtitle_preroll, 0),
     OPT_FLAG("mkv-subtitle-preroll", mkv_subtitle_preroll, 0), // old alias
+    OPT_STRING("demuxer-mkv-index-dir", mkv_index_dir, M_OPT_FILE),
 
 // ------------------------- subtitles options --------------------
 
@@ -334,6 +357,10 @@ const m_option_t mp_opts[] = {
     OPT_CHOICE("ass-style-override", ass_style_override, 0,
                ({"no", 0}, {"yes", 1}, {"force", 3})),
     OPT_FLAG("sub-scale-with-window", sub_scale_with_window, 0),
+    OPT_INTRANGE("sub-ass-render-ahead", ass_render_ahead, 0, 0, 16),
+    OPT_INTRANGE("sub-ass-cache-size", ass_cache_size, 0, 0, 4096),
+    OPT_CHOICE_OR_INT("sub-render-height", sub_render_height, 0, 1, 8192,
+                      ({"no", 0}, {"video", -1})),
     OPT_FLAG("osd-bar", osd_bar_visible, 0),
     OPT_FLOATRANGE("osd-bar-align-x", osd_bar_align_x, 0, -1.0, +1.0),
     OPT_FLOATRANGE("osd-bar-align-y", osd_bar_align_y, 0, -1.0, +1.0),
@@ -474,9 +501,22 @@ const m_option_t mp_opts[] = {
     OPT_FLAG("audiodrop", insert_silence, 0),
 
     OPT_FLAG("untimed", untimed, M_OPT_FIXED),
+    OPT_FLAG("low-latency", low_latency, 0),
+
+    OPT_INTRANGE("audio-thread-priority", audio_thread_sched.priority, 0, 0, 99),
+    OPT_INTRANGE("audio-thread-cpu", audio_thread_sched.cpu, 0, -1, 1023),
+    OPT_INTRANGE("video-thread-priority", video_thread_sched.priority, 0, 0, 99),
+    OPT_INTRANGE("video-thread-cpu", video_thread_sched.cpu, 0, -1, 1023),
+    OPT_INTRANGE("demuxer-thread-priority", demuxer_thread_sched.priority, 0,
+                 0, 99),
+    OPT_INTRANGE("demuxer-thread-cpu", demuxer_thread_sched.cpu, 0, -1, 1023),
+    OPT_INTRANGE("cache-thread-priority", stream_cache.thread_sched.priority, 0,
+                 0, 99),
+    OPT_INTRANGE("cache-thread-cpu", stream_cache.thread_sched.cpu, 0, -1, 1023),
 
     OPT_STRING("stream-capture", stream_capture, M_OPT_FIXED | M_OPT_FILE),
     OPT_STRING("stream-dump", stream_dump, M_OPT_FIXED | M_OPT_FILE),
+    OPT_FLAG("stream-file-mmap", stream_file_mmap, 0),
 
     OPT_CHOICE_OR_INT("loop", loop_times, M_OPT_GLOBAL, 2, 10000,
                       ({"no", -1}, {"1", -1},
@@ -491,12 +531,17 @@ const m_option_t mp_opts[] = {
 
     OPT_FLAG("ordered-chapters", ordered_chapters, 0),
     OPT_STRING("ordered-chapters-files", ordered_chapters_files, M_OPT_FILE),
+    OPT_STRING("ordered-chapters-uid-cache", ordered_chapters_uid_cache,
+               M_OPT_FILE),
     OPT_INTRANGE("chapter-merge-threshold", chapter_merge_threshold, 0, 0, 10000),
+    OPT_INTRANGE("timeline-cached-sources", timeline_cached_sources, 0, 0, 1000),
+    OPT_DOUBLE("timeline-preload", timeline_preload, M_OPT_MIN, .min = 0),
 
     OPT_DOUBLE("chapter-seek-threshold", chapter_seek_threshold, 0),
 
     OPT_FLAG("load-unsafe-playlists", load_unsafe_playlists, 0),
     OPT_FLAG("merge-files", merge_files, 0),
+    OPT_FLAG("prefetch-playlist", prefetch_playlist, 0),
 
     // a-v sync stuff:
     OPT_FLAG("correct-pts", correct_pts, 0),
@@ -507,8 +552,13 @@ const m_option_t mp_opts[] = {
                ({"no", -1}, {"absolute", 0}, {"always", 1}, {"yes", 1})),
     OPT_FLOATRANGE("hr-seek-demuxer-offset", hr_seek_demuxer_offset, 0, -9, 99),
     OPT_FLAG("hr-seek-framedrop", hr_seek_framedrop, 0),
+    OPT_INTRANGE("backstep-cache-size", backstep_cache_size, 0, 0, 4096),
+    OPT_DOUBLE("seek-scrub", seek_scrub, M_OPT_MIN, .min = 0),
     OPT_CHOICE_OR_INT("autosync", autosync, 0, 0, 10000,
                       ({"no", -1})),
+    OPT_FLAG("av-sync-resample", av_sync_resample, 0),
+    OPT_DOUBLE("av-sync-resample-max", av_sync_resample_max,
+               M_OPT_RANGE, .min = 0, .max = 0.1),
 
     OPT_CHOICE("term-osd", term_osd, 0,
                ({"force", 1},
@@ -517,6 +567,7 @@ const m_option_t mp_opts[] = {
 
     OPT_FLAG("term-osd-bar", term_osd_bar, 0),
     OPT_STRING("term-osd-bar-chars", term_osd_bar_chars, 0),
+    OPT_DOUBLE("term-status-rate", term_status_rate, M_OPT_MIN, .min = 0),
 
     OPT_STRING("term-playing-msg", playing_msg, 0),
     OPT_STRING("osd-playing-msg", osd_playing_msg, 0),
@@ -531,6 +582,10 @@ const m_option_t mp_opts[] = {
 
     OPT_SUBSTRUCT("screenshot", screenshot_image_opts, image_writer_conf, 0),
     OPT_STRING("screenshot-template", screenshot_template, 0),
+    OPT_INTRANGE("screenshot-threads", screenshot_threads, 0, 0, 16),
+    OPT_INTRANGE("screenshot-queue-size", screenshot_queue_size, 0, 0, 16384),
+    OPT_FLAG("screenshot-queue-drop", screenshot_queue_drop, 0),
+    OPT_INTRANGE("screenshot-max-size", screenshot_max_size, 0, 0, 16384),
 
     OPT_SUBSTRUCT("input", input_opts, input_config, 0),
 
@@ -599,8 +654,11 @@ const struct MPOpts mp_default_opts = {
     .loop_times = -1,
     .ordered_chapters = 1,
     .chapter_merge_threshold = 100,
+    .timeline_cached_sources = 2,
+    .timeline_preload = 5.0,
     .chapter_seek_threshold = 5.0,
     .hr_seek_framedrop = 1,
+    .backstep_cache_size = 64,
     .load_config = 1,
     .position_resume = 1,
     .stream_cache = {
@@ -608,24 +666,38 @@ const struct MPOpts mp_default_opts = {
         .def_size = 25000,
         .initial = 0,
         .seek_min = 500,
+        .connections = 1,
         .file_max = 1024 * 1024,
+        .dir_max = 4 * 1024 * 1024,
+        .thread_sched = {.cpu = -1},
     },
+    .audio_thread_sched = {.cpu = -1},
+    .video_thread_sched = {.cpu = -1},
+    .demuxer_thread_sched = {.cpu = -1},
     .demuxer_thread = 1,
     .demuxer_min_packs = 0,
     .demuxer_min_bytes = 0,
     .demuxer_min_secs = 0.2,
+    .demuxer_max_bytes = MAX_PACK_BYTES,
+    .demuxer_unselected_bytes = 1024 * 1024,
+    .demuxer_min_secs_video = -1,
+    .demuxer_min_secs_audio = -1,
     .network_rtsp_transport = 2,
+    .hls_bitrate = -1,
     .demuxer_min_secs_cache = 2,
     .cache_pausing = 1,
+    .memory_pressure = 1,
     .chapterrange = {-1, -1},
     .edition_id = -1,
     .default_max_pts_correction = -1,
+    .av_sync_resample_max = 0.01,
     .correct_pts = 1,
     .user_pts_assoc_mode = 1,
     .initial_audio_sync = 1,
     .frame_dropping = 1,
     .term_osd = 2,
     .term_osd_bar_chars = "[-+-]",
+    .term_status_rate = 10,
     .consolecontrols = 1,
     .play_frames = -1,
     .keep_open = 0,
@@ -638,6 +710,8 @@ const struct MPOpts mp_default_opts = {
     .sub_pos = 100,
     .sub_speed = 1.0,
     .quvi_fetch_subtitles = 0,
+    .quvi_cache_ttl = 600,
+    .quvi_prefetch = 1,
     .audio_output_channels = MP_CHMAP_INIT_STEREO,
     .audio_output_format = 0,  // AF_FORMAT_UNKNOWN
     .playback_speed = 1.,
@@ -661,10 +735,13 @@ const struct MPOpts mp_default_opts = {
     .hwdec_codecs = "h264,vc1,wmv3",
 
     .index_mode = 1,
+    .screenshot_queue_size = 256,
 
     .dvd_angle = 1,
 
     .mf_fps = 1.0,
+    .mf_prefetch = 8,
+    .mf_prefetch_bytes = 256 * 1024 * 1024,
 };
 
 #endif /* MPLAYER_CFG_MPLAYER_H */
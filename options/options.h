@@ -40,25 +40,36 @@ typedef struct mp_vo_opts {
     struct sws_opts *sws_opts;
 } mp_vo_opts;
 
+struct mp_thread_sched_opts {
+    int priority;
+    int cpu;
+};
+
 struct mp_cache_opts {
     int size;
     int def_size;
     int initial;
     int seek_min;
+    int connections;
     char *file;
     int file_max;
+    char *dir;
+    int dir_max;
+    struct mp_thread_sched_opts thread_sched;
 };
 
 typedef struct MPOpts {
     int use_terminal;
     char *msglevels;
     char *dump_stats;
+    int dump_startup_timings;
     int verbose;
     int msg_color;
     int msg_module;
     int msg_time;
 
     char **reset_options;
+    char *ipc_path;
     char **lua_files;
     char **lua_opts;
     int lua_load_osc;
@@ -103,22 +114,34 @@ typedef struct MPOpts {
 
     char *audio_decoders;
     char *video_decoders;
+    int video_decode_ahead;
+    int video_reuse_decoder;
+    char **video_wall;
 
     int osd_level;
     int osd_duration;
     int osd_fractions;
     int untimed;
+    int low_latency;
+    struct mp_thread_sched_opts audio_thread_sched;
+    struct mp_thread_sched_opts video_thread_sched;
+    struct mp_thread_sched_opts demuxer_thread_sched;
     char *stream_capture;
     char *stream_dump;
+    int stream_file_mmap;
     int loop_times;
     int loop_file;
     int shuffle;
     int ordered_chapters;
     char *ordered_chapters_files;
+    char *ordered_chapters_uid_cache;
     int chapter_merge_threshold;
+    int timeline_cached_sources;
+    double timeline_preload;
     double chapter_seek_threshold;
     int load_unsafe_playlists;
     int merge_files;
+    int prefetch_playlist;
     int quiet;
     int load_config;
     char *force_configdir;
@@ -134,15 +157,20 @@ typedef struct MPOpts {
     int hr_seek;
     float hr_seek_demuxer_offset;
     int hr_seek_framedrop;
+    int backstep_cache_size;
+    double seek_scrub;
     float audio_delay;
     float default_max_pts_correction;
     int autosync;
+    int av_sync_resample;
+    double av_sync_resample_max;
     int frame_dropping;
     double frame_drop_fps;
     int insert_silence;
     int term_osd;
     int term_osd_bar;
     char *term_osd_bar_chars;
+    double term_status_rate;
     char *playing_msg;
     char *osd_playing_msg;
     char *status_msg;
@@ -178,6 +206,8 @@ typedef struct MPOpts {
     int stretch_dvd_subs;
     char *quvi_format;
     int quvi_fetch_subtitles;
+    int quvi_cache_ttl;
+    int quvi_prefetch;
 
     int sub_fix_timing;
     char *sub_cp;
@@ -188,15 +218,28 @@ typedef struct MPOpts {
     int demuxer_min_packs;
     int demuxer_min_bytes;
     double demuxer_min_secs;
+    int demuxer_back_bytes;
+    int demuxer_unselected_bytes;
+    int demuxer_max_bytes;
+    double demuxer_min_secs_video;
+    double demuxer_min_secs_audio;
+    double demuxer_back_secs;
     char *audio_demuxer_name;
     char *sub_demuxer_name;
     int mkv_subtitle_preroll;
+    char *mkv_index_dir;
 
     double demuxer_min_secs_cache;
     int cache_pausing;
+    int memory_budget;
+    int memory_pressure;
 
     struct image_writer_opts *screenshot_image_opts;
     char *screenshot_template;
+    int screenshot_threads;
+    int screenshot_queue_size;
+    int screenshot_queue_drop;
+    int screenshot_max_size;
 
     double force_fps;
     int index_mode;
@@ -207,6 +250,7 @@ typedef struct MPOpts {
     int dtshd;
     double playback_speed;
     struct m_obj_settings *vf_settings, *vf_defs;
+    int vf_pipeline;
     struct m_obj_settings *af_settings, *af_defs;
     int deinterlace;
     float movie_aspect;
@@ -239,6 +283,9 @@ typedef struct MPOpts {
     int ass_hinting;
     int ass_shaper;
     int sub_scale_with_window;
+    int ass_render_ahead;
+    int ass_cache_size;
+    int sub_render_height;
     int sub_clear_on_seek;
 
     int hwdec_api;
@@ -272,6 +319,8 @@ typedef struct MPOpts {
 
     double mf_fps;
     char *mf_type;
+    int mf_prefetch;
+    int mf_prefetch_bytes;
 
     struct demux_rawaudio_opts *demux_rawaudio;
     struct demux_rawvideo_opts *demux_rawvideo;
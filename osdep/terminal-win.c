@@ -222,7 +222,17 @@ void mp_write_console_ansi(HANDLE wstream, char *buf)
             break;
         }
         case 'A': {     // cursor up
-            info.dwCursorPosition.Y -= 1;
+            info.dwCursorPosition.Y -= MPMAX(params[0], 1);
+            SetConsoleCursorPosition(wstream, info.dwCursorPosition);
+            break;
+        }
+        case 'B': {     // cursor down
+            info.dwCursorPosition.Y += MPMAX(params[0], 1);
+            SetConsoleCursorPosition(wstream, info.dwCursorPosition);
+            break;
+        }
+        case 'C': {     // cursor forward
+            info.dwCursorPosition.X += MPMAX(params[0], 1);
             SetConsoleCursorPosition(wstream, info.dwCursorPosition);
             break;
         }
@@ -15,6 +15,18 @@
  * with mpv.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "common/msg.h"
 #include "threads.h"
 #include "timer.h"
 
@@ -40,3 +52,53 @@ int mpthread_mutex_init_recursive(pthread_mutex_t *mutex)
     pthread_mutexattr_destroy(&attr);
     return r;
 }
+
+void mpthread_set_sched(struct mp_log *log, int priority, int cpu)
+{
+    if (priority > 0) {
+#ifdef _WIN32
+        int prio = priority >= 50 ? THREAD_PRIORITY_TIME_CRITICAL
+                                  : THREAD_PRIORITY_HIGHEST;
+        if (!SetThreadPriority(GetCurrentThread(), prio))
+            mp_warn(log, "Could not raise thread priority.\n");
+#else
+        int min = sched_get_priority_min(SCHED_RR);
+        int max = sched_get_priority_max(SCHED_RR);
+        struct sched_param param = {
+            .sched_priority = priority < min ? min : priority > max ? max
+                                                                   : priority,
+        };
+        int err = pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+        if (err) {
+            mp_warn(log, "Could not set realtime priority %d: %s\n",
+                    param.sched_priority, strerror(err));
+        }
+#endif
+    }
+    if (cpu >= 0) {
+#if defined(_WIN32)
+        if (cpu >= sizeof(DWORD_PTR) * 8 ||
+            !SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu))
+            mp_warn(log, "Could not pin thread to CPU %d.\n", cpu);
+#elif defined(CPU_SET)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err) {
+            mp_warn(log, "Could not pin thread to CPU %d: %s\n", cpu,
+                    strerror(err));
+        }
+#else
+        mp_warn(log, "Setting the CPU affinity is not supported.\n");
+#endif
+    }
+}
+
+void mpthread_set_timer_slack(int64_t us)
+{
+#if defined(__linux__) && defined(PR_SET_TIMERSLACK)
+    // 0 would reset the slack to the default.
+    prctl(PR_SET_TIMERSLACK, (unsigned long)(us > 0 ? us * 1000 : 1), 0, 0, 0);
+#endif
+}
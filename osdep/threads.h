@@ -16,4 +16,17 @@ int mpthread_cond_timedwait_rel(pthread_cond_t *cond, pthread_mutex_t *mutex,
 // Helper to reduce boiler plate.
 int mpthread_mutex_init_recursive(pthread_mutex_t *mutex);
 
+struct mp_log;
+
+// Set scheduling parameters of the calling thread. priority: 0 leaves the
+// default policy alone, 1-99 selects realtime scheduling (SCHED_RR; on
+// Windows a raised thread priority). cpu: pin to this CPU, -1 for any CPU.
+// Failures (missing privileges etc.) are only logged.
+void mpthread_set_sched(struct mp_log *log, int priority, int cpu);
+
+// Set the timer slack of the calling thread in microseconds, i.e. how late the
+// kernel may wake it up from sleeps and timed waits. Linux only; a no-op
+// elsewhere.
+void mpthread_set_timer_slack(int64_t us);
+
 #endif
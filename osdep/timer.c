@@ -56,6 +56,21 @@ double mp_time_sec(void)
     return mp_time_us() / (double)(1000 * 1000);
 }
 
+// Spin instead of sleeping for the last part of mp_sleep_until_us(). Sleeps
+// usually overshoot by less than this with a small timer slack.
+#define SPIN_US 200
+
+void mp_sleep_until_us(int64_t time_us)
+{
+    while (1) {
+        int64_t left = time_us - mp_time_us();
+        if (left <= 0)
+            break;
+        if (left > SPIN_US)
+            mp_sleep_us(left - SPIN_US);
+    }
+}
+
 int64_t mp_time_relative_us(int64_t *t)
 {
     int64_t r = 0;
@@ -38,6 +38,11 @@ uint64_t mp_raw_time_us(void);
 // Sleep in microseconds.
 void mp_sleep_us(int64_t us);
 
+// Sleep until mp_time_us() reaches time_us. The last part of the wait is a
+// busy loop, so the deadline is hit precisely regardless of timer slack and
+// scheduler granularity. Meant for short waits on presentation deadlines.
+void mp_sleep_until_us(int64_t time_us);
+
 // Return the amount of time that has passed since the last call, in
 // microseconds. *t is used to calculate the time that has passed by storing
 // the current time in it. If *t is 0, the call will return 0. (So that the
@@ -72,6 +72,18 @@ static int recreate_audio_filters(struct MPContext *mpctx)
         return -1;
     }
 
+    // Speed correction needs a resampler in the chain even if the rates
+    // match. The new filters start uncorrected.
+    mpctx->audio_speed_correction = 1.0;
+    if (opts->av_sync_resample && !AF_FORMAT_IS_SPECIAL(out_format.format) &&
+        !af_control_any_rev(d_audio->afilter, AF_CONTROL_SET_SPEED_CORRECTION,
+                            &mpctx->audio_speed_correction))
+    {
+        if (!af_add(d_audio->afilter, "lavrresample",
+                    (char *[]){"detach", "no", NULL}))
+            MP_WARN(mpctx, "Could not insert resampler for A/V sync.\n");
+    }
+
     mixer_reinit_audio(mpctx->mixer, mpctx->ao, mpctx->d_audio->afilter);
 
     return 0;
@@ -99,6 +111,8 @@ void reset_audio_state(struct MPContext *mpctx)
     if (mpctx->ao_buffer)
         mp_audio_buffer_clear(mpctx->ao_buffer);
     mpctx->audio_status = mpctx->d_audio ? STATUS_SYNCING : STATUS_EOF;
+    mpctx->av_resample_active = false;
+    mpctx->av_resample_integral = 0;
 }
 
 void reinit_audio_chain(struct MPContext *mpctx)
@@ -285,7 +299,8 @@ static int write_to_ao(struct MPContext *mpctx, struct mp_audio *data, int flags
 #endif
     if (data->samples == 0)
         return 0;
-    double real_samplerate = out_format.rate / mpctx->opts->playback_speed;
+    double real_samplerate = out_format.rate /
+        (mpctx->opts->playback_speed * mpctx->audio_speed_correction);
     int played = ao_play(mpctx->ao, data->planes, data->samples, flags);
     assert(played <= data->samples);
     if (played > 0) {
@@ -30,6 +30,7 @@
 #include "options/m_property.h"
 #include "options/path.h"
 #include "options/parse_configfile.h"
+#include "osdep/atomics.h"
 #include "osdep/threads.h"
 #include "osdep/timer.h"
 #include "osdep/io.h"
@@ -53,6 +54,38 @@
  *
  */
 
+// Frequently polled scalar properties. The playback thread publishes their
+// values once per playloop iteration (see mp_client_update_snapshot()), so
+// that clients can read them without stopping the playback thread.
+static const char *const snapshot_props[] = {
+    "time-pos",
+    "playback-time",
+    "time-remaining",
+    "percent-pos",
+    "length",
+    "pause",
+    "core-idle",
+    "paused-for-cache",
+    "cache",
+    "playlist-pos",
+    "track-list/count",
+};
+
+#define NUM_SNAPSHOT_PROPS MP_ARRAY_SIZE(snapshot_props)
+
+// Status of a snapshot value: a property error code (<= 0), or this if the
+// property can't be read from the snapshot.
+#define SNAPSHOT_INVALID 1
+
+// The snapshot is updated only if a client read from it within this time (us).
+#define SNAPSHOT_TIMEOUT (1 * 1000 * 1000)
+
+struct snapshot_value {
+    atomic_int status;          // mpv_error, or SNAPSHOT_INVALID
+    atomic_int format;          // MPV_FORMAT_FLAG/INT64/DOUBLE
+    atomic_ullong bits;         // value (double stored bitwise)
+};
+
 struct mp_client_api {
     struct MPContext *mpctx;
 
@@ -62,6 +95,23 @@ struct mp_client_api {
     struct mpv_handle **clients;
     int num_clients;
     uint64_t event_masks;   // combined events of all clients, or 0 if unknown
+    struct mpv_opengl_cb_context *gl_cb_ctx; // created on first use
+    struct mpv_frame_cb_context *frame_cb_ctx; // created on first use
+
+    // -- atomic
+    // mp_time_us() of the last attempt to read snapshot_props. The snapshot
+    // is kept up to date only while clients read from it.
+    atomic_llong snapshot_read_time;
+    // Incremented after every change requested by a client. The snapshot is
+    // used only if it was made after the last change.
+    atomic_ullong modify_count;
+    atomic_ullong snapshot_count;   // modify_count when the snapshot was made,
+                                    // or -1 if it's invalid
+    // Number of queued asynchronous commands and property changes. The
+    // snapshot is not used while there are any, so a client reading a
+    // property after changing it always gets the new value.
+    atomic_int pending_changes;
+    struct snapshot_value snapshot[NUM_SNAPSHOT_PROPS];
 };
 
 struct observe_property {
@@ -113,6 +163,8 @@ struct mpv_handle {
     int first_event;        // events[first_event] is the first readable event
     int num_events;         // number of readable events
     int reserved_events;    // number of entries reserved for replies
+    uint64_t events_dropped;    // events lost because the queue was full
+    uint64_t events_coalesced;  // events removed by coalesce_event()
 
     struct observe_property **properties;
     int num_properties;
@@ -125,14 +177,16 @@ struct mpv_handle {
 };
 
 static bool gen_property_change_event(struct mpv_handle *ctx);
-static void notify_property_events(struct mpv_handle *ctx, uint64_t event_mask);
 
 void mp_clients_init(struct MPContext *mpctx)
 {
     mpctx->clients = talloc_ptrtype(NULL, mpctx->clients);
     *mpctx->clients = (struct mp_client_api) {
         .mpctx = mpctx,
+        .snapshot_count = ATOMIC_VAR_INIT(-1),
     };
+    for (int n = 0; n < NUM_SNAPSHOT_PROPS; n++)
+        atomic_store(&mpctx->clients->snapshot[n].status, SNAPSHOT_INVALID);
     pthread_mutex_init(&mpctx->clients->lock, NULL);
 }
 
@@ -301,6 +355,68 @@ void mpv_resume(mpv_handle *ctx)
     mp_dispatch_resume(ctx->mpctx->dispatch);
 }
 
+// Invalidate the property snapshot after a client changed something.
+static void mark_modified(struct mp_client_api *clients)
+{
+    atomic_fetch_add(&clients->modify_count, 1);
+}
+
+// Called when an asynchronous change is queued, and after it was run.
+static void add_pending_change(struct mp_client_api *clients, int n)
+{
+    atomic_fetch_add(&clients->pending_changes, n);
+}
+
+// Called by the playback thread once per playloop iteration.
+void mp_client_update_snapshot(struct MPContext *mpctx)
+{
+    struct mp_client_api *clients = mpctx->clients;
+    if (!HAVE_ATOMICS)
+        return;
+    // Nobody read from the snapshot recently: don't evaluate the properties,
+    // and make the next read ask the core (which requests a new snapshot).
+    if (mp_time_us() - atomic_load(&clients->snapshot_read_time) >
+        SNAPSHOT_TIMEOUT)
+    {
+        atomic_store(&clients->snapshot_count, (unsigned long long)-1);
+        return;
+    }
+    uint64_t count = atomic_load(&clients->modify_count);
+    for (int n = 0; n < NUM_SNAPSHOT_PROPS; n++) {
+        struct snapshot_value *v = &clients->snapshot[n];
+        struct mpv_node node = {0};
+        int r = mp_property_do(snapshot_props[n], M_PROPERTY_GET_NODE, &node,
+                               mpctx);
+        if (r == M_PROPERTY_OK) {
+            uint64_t bits = 0;
+            switch (node.format) {
+            case MPV_FORMAT_FLAG:   bits = node.u.flag; break;
+            case MPV_FORMAT_INT64:  bits = node.u.int64; break;
+            case MPV_FORMAT_DOUBLE: memcpy(&bits, &node.u.double_, 8); break;
+            default:
+                mpv_free_node_contents(&node);
+                atomic_store(&v->status, SNAPSHOT_INVALID);
+                continue;
+            }
+            if (atomic_load(&v->status) == 0 &&
+                atomic_load(&v->format) == node.format &&
+                atomic_load(&v->bits) == bits)
+                continue;
+            // Readers check the status first, so make the value valid only
+            // after it was written.
+            atomic_store(&v->status, SNAPSHOT_INVALID);
+            atomic_store(&v->format, node.format);
+            atomic_store(&v->bits, bits);
+            atomic_store(&v->status, 0);
+        } else if (r == M_PROPERTY_UNAVAILABLE) {
+            atomic_store(&v->status, MPV_ERROR_PROPERTY_UNAVAILABLE);
+        } else {
+            atomic_store(&v->status, SNAPSHOT_INVALID);
+        }
+    }
+    atomic_store(&clients->snapshot_count, count);
+}
+
 static void lock_core(mpv_handle *ctx)
 {
     if (ctx->mpctx->initialized)
@@ -490,20 +606,64 @@ static int append_event(struct mpv_handle *ctx, struct mpv_event event, bool cop
     return 0;
 }
 
+// Events which only signal that some state changed. A newer instance makes
+// queued older ones redundant.
+static bool event_is_coalescable(struct mpv_event *event)
+{
+    if (event->data || event->reply_userdata || event->error)
+        return false;
+    switch (event->event_id) {
+    case MPV_EVENT_TICK:
+    case MPV_EVENT_VIDEO_RECONFIG:
+    case MPV_EVENT_AUDIO_RECONFIG:
+    case MPV_EVENT_METADATA_UPDATE:
+    case MPV_EVENT_CHAPTER_CHANGE:
+    case MPV_EVENT_TRACKS_CHANGED:
+    case MPV_EVENT_TRACK_SWITCHED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Remove a queued instance of the event, if it's redundant. Since this is
+// always done, there can be at most one such instance.
+// Called with ctx->lock held.
+static void coalesce_event(struct mpv_handle *ctx, struct mpv_event *event)
+{
+    if (!event_is_coalescable(event))
+        return;
+    for (int n = ctx->num_events - 1; n >= 0; n--) {
+        struct mpv_event *ev = &ctx->events[(ctx->first_event + n) %
+                                            ctx->max_events];
+        if (ev->event_id == event->event_id && event_is_coalescable(ev)) {
+            for (int i = n; i < ctx->num_events - 1; i++) {
+                ctx->events[(ctx->first_event + i) % ctx->max_events] =
+                    ctx->events[(ctx->first_event + i + 1) % ctx->max_events];
+            }
+            ctx->num_events--;
+            ctx->events_coalesced++;
+            return;
+        }
+    }
+}
+
 static int send_event(struct mpv_handle *ctx, struct mpv_event *event, bool copy)
 {
     pthread_mutex_lock(&ctx->lock);
     uint64_t mask = 1ULL << event->event_id;
-    if (ctx->property_event_masks & mask)
-        notify_property_events(ctx, mask);
     if (!(ctx->event_mask & mask)) {
         pthread_mutex_unlock(&ctx->lock);
         return 0;
     }
+    coalesce_event(ctx, event);
     int r = append_event(ctx, *event, copy);
-    if (r < 0 && !ctx->choke_warning) {
-        mp_err(ctx->log, "Too many events queued.\n");
-        ctx->choke_warning = true;
+    if (r < 0) {
+        ctx->events_dropped++;
+        if (!ctx->choke_warning) {
+            mp_err(ctx->log, "Too many events queued.\n");
+            ctx->choke_warning = true;
+        }
     }
     pthread_mutex_unlock(&ctx->lock);
     return r;
@@ -613,6 +773,38 @@ int mpv_request_event(mpv_handle *ctx, mpv_event_id event, int enable)
     return 0;
 }
 
+int mpv_set_event_queue_size(mpv_handle *ctx, int num_events)
+{
+    int r = 0;
+    pthread_mutex_lock(&ctx->lock);
+    if (num_events < 1 || num_events < ctx->num_events + ctx->reserved_events) {
+        r = MPV_ERROR_INVALID_PARAMETER;
+    } else {
+        mpv_event *events = talloc_array(ctx, mpv_event, num_events);
+        for (int n = 0; n < ctx->num_events; n++)
+            events[n] = ctx->events[(ctx->first_event + n) % ctx->max_events];
+        talloc_free(ctx->events);
+        ctx->events = events;
+        ctx->max_events = num_events;
+        ctx->first_event = 0;
+        ctx->choke_warning = false;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return r;
+}
+
+int mpv_get_event_queue_stats(mpv_handle *ctx, uint64_t *dropped,
+                              uint64_t *coalesced)
+{
+    pthread_mutex_lock(&ctx->lock);
+    if (dropped)
+        *dropped = ctx->events_dropped;
+    if (coalesced)
+        *coalesced = ctx->events_coalesced;
+    pthread_mutex_unlock(&ctx->lock);
+    return 0;
+}
+
 mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout)
 {
     mpv_event *event = ctx->cur_event;
@@ -650,13 +842,14 @@ mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout)
             if (msg) {
                 event->event_id = MPV_EVENT_LOG_MESSAGE;
                 struct mpv_event_log_message *cmsg = talloc_ptrtype(event, cmsg);
+                // The strings are part of the msg allocation.
+                talloc_steal(cmsg, msg);
                 *cmsg = (struct mpv_event_log_message){
-                    .prefix = talloc_steal(event, msg->prefix),
+                    .prefix = msg->prefix,
                     .level = mp_log_levels[msg->level],
-                    .text = talloc_steal(event, msg->text),
+                    .text = msg->text,
                 };
                 event->data = cmsg;
-                talloc_free(msg);
                 break;
             }
         }
@@ -763,6 +956,11 @@ static bool compare_value(void *a, void *b, mpv_format format)
     abort();
 }
 
+bool mp_client_node_equal(struct mpv_node *a, struct mpv_node *b)
+{
+    return compare_value(a, b, MPV_FORMAT_NODE);
+}
+
 void mpv_free_node_contents(mpv_node *node)
 {
     static const struct m_option type = { .type = CONF_TYPE_NODE };
@@ -786,6 +984,7 @@ int mpv_set_option(mpv_handle *ctx, const char *name, mpv_format format,
     lock_core(ctx);
     int err = m_config_set_option_node(ctx->mpctx->mconfig, bstr0(name),
                                        data, flags);
+    mark_modified(ctx->clients);
     unlock_core(ctx);
     switch (err) {
     case M_OPT_MISSING_PARAM:
@@ -832,6 +1031,18 @@ static int run_async(mpv_handle *ctx, void (*fn)(void *fn_data), void *fn_data)
     return 0;
 }
 
+// Like run_async(), but for requests that change something. fn must call
+// add_pending_change(clients, -1) when it's done.
+static int run_async_change(mpv_handle *ctx, void (*fn)(void *fn_data),
+                            void *fn_data)
+{
+    add_pending_change(ctx->clients, 1);
+    int err = run_async(ctx, fn, fn_data);
+    if (err < 0)
+        add_pending_change(ctx->clients, -1);
+    return err;
+}
+
 struct cmd_request {
     struct MPContext *mpctx;
     struct mp_cmd *cmd;
@@ -844,6 +1055,9 @@ static void cmd_fn(void *data)
 {
     struct cmd_request *req = data;
     int r = run_command(req->mpctx, req->cmd);
+    mark_modified(req->mpctx->clients);
+    if (req->reply_ctx)
+        add_pending_change(req->mpctx->clients, -1);
     req->status = r >= 0 ? 0 : MPV_ERROR_COMMAND;
     talloc_free(req->cmd);
     if (req->reply_ctx) {
@@ -876,6 +1090,65 @@ int mpv_command(mpv_handle *ctx, const char **args)
                                                            ctx->name));
 }
 
+struct cmd_list_request {
+    struct cmd_request *reqs;
+    int num;
+};
+
+static void cmd_list_fn(void *data)
+{
+    struct cmd_list_request *list = data;
+    for (int n = 0; n < list->num; n++) {
+        if (list->reqs[n].cmd)
+            cmd_fn(&list->reqs[n]);
+    }
+}
+
+// Store per-entry status codes, and return the first error (or 0).
+static int batch_status(int num, int *status, int *errors)
+{
+    int r = 0;
+    for (int n = 0; n < num; n++) {
+        if (status[n] < 0 && r == 0)
+            r = status[n];
+        if (errors)
+            errors[n] = status[n];
+    }
+    return r;
+}
+
+int mpv_command_list(mpv_handle *ctx, int num, const char **const *cmds,
+                     int *errors)
+{
+    if (!ctx->mpctx->initialized)
+        return MPV_ERROR_UNINITIALIZED;
+    if (num < 0)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    void *tmp = talloc_new(NULL);
+    struct cmd_request *reqs = talloc_zero_array(tmp, struct cmd_request, num);
+    int *status = talloc_zero_array(tmp, int, num);
+    for (int n = 0; n < num; n++) {
+        reqs[n] = (struct cmd_request){
+            .mpctx = ctx->mpctx,
+            .cmd = mp_input_parse_cmd_strv(ctx->log, 0, (const char **)cmds[n],
+                                           ctx->name),
+            .status = MPV_ERROR_INVALID_PARAMETER,
+        };
+        if (reqs[n].cmd && mp_input_is_abort_cmd(reqs[n].cmd))
+            mp_cancel_trigger(ctx->mpctx->playback_abort);
+    }
+
+    struct cmd_list_request list = {reqs, num};
+    run_locked(ctx, cmd_list_fn, &list);
+
+    for (int n = 0; n < num; n++)
+        status[n] = reqs[n].status;
+    int r = batch_status(num, status, errors);
+    talloc_free(tmp);
+    return r;
+}
+
 int mpv_command_string(mpv_handle *ctx, const char *args)
 {
     return run_client_command(ctx,
@@ -898,7 +1171,7 @@ int mpv_command_async(mpv_handle *ctx, uint64_t ud, const char **args)
         .reply_ctx = ctx,
         .userdata = ud,
     };
-    return run_async(ctx, cmd_fn, req);
+    return run_async_change(ctx, cmd_fn, req);
 }
 
 static int translate_property_error(int errc)
@@ -960,6 +1233,9 @@ static void setproperty_fn(void *arg)
     }
 
     req->status = translate_property_error(err);
+    mark_modified(req->mpctx->clients);
+    if (req->reply_ctx)
+        add_pending_change(req->mpctx->clients, -1);
 
     if (req->reply_ctx) {
         status_reply(req->reply_ctx, MPV_EVENT_SET_PROPERTY_REPLY,
@@ -985,6 +1261,52 @@ int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format,
     return req.status;
 }
 
+struct setproperties_request {
+    struct setproperty_request *reqs;
+    int num;
+};
+
+static void setproperties_fn(void *arg)
+{
+    struct setproperties_request *list = arg;
+    for (int n = 0; n < list->num; n++)
+        setproperty_fn(&list->reqs[n]);
+}
+
+int mpv_set_properties(mpv_handle *ctx, int num, const char **names,
+                       mpv_format format, void *data, int *errors)
+{
+    const struct m_option *type = get_mp_type(format);
+    if (!ctx->mpctx->initialized)
+        return MPV_ERROR_UNINITIALIZED;
+    if (!type)
+        return MPV_ERROR_PROPERTY_FORMAT;
+    if (num < 0 || (num > 0 && (!names || !data)))
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    void *tmp = talloc_new(NULL);
+    struct setproperty_request *reqs =
+        talloc_zero_array(tmp, struct setproperty_request, num);
+    int *status = talloc_zero_array(tmp, int, num);
+    for (int n = 0; n < num; n++) {
+        reqs[n] = (struct setproperty_request){
+            .mpctx = ctx->mpctx,
+            .name = names[n],
+            .format = format,
+            .data = (char *)data + n * type->type->size,
+        };
+    }
+
+    struct setproperties_request list = {reqs, num};
+    run_locked(ctx, setproperties_fn, &list);
+
+    for (int n = 0; n < num; n++)
+        status[n] = reqs[n].status;
+    int r = batch_status(num, status, errors);
+    talloc_free(tmp);
+    return r;
+}
+
 int mpv_set_property_string(mpv_handle *ctx, const char *name, const char *data)
 {
     return mpv_set_property(ctx, name, MPV_FORMAT_STRING, &data);
@@ -1019,7 +1341,7 @@ int mpv_set_property_async(mpv_handle *ctx, uint64_t ud, const char *name,
     m_option_copy(type, req->data, data);
     talloc_set_destructor(req, free_prop_set_req);
 
-    return run_async(ctx, setproperty_fn, req);
+    return run_async_change(ctx, setproperty_fn, req);
 }
 
 struct getproperty_request {
@@ -1113,6 +1435,48 @@ static void getproperty_fn(void *arg)
     }
 }
 
+// Try to read the property from the snapshot. Returns SNAPSHOT_INVALID if
+// the core has to be asked instead.
+static int get_snapshot_property(mpv_handle *ctx, const char *name,
+                                 mpv_format format, void *data)
+{
+    struct mp_client_api *clients = ctx->clients;
+    if (!HAVE_ATOMICS || format == MPV_FORMAT_STRING ||
+        format == MPV_FORMAT_OSD_STRING)
+        return SNAPSHOT_INVALID;
+    int index = -1;
+    for (int n = 0; n < NUM_SNAPSHOT_PROPS; n++) {
+        if (strcmp(snapshot_props[n], name) == 0)
+            index = n;
+    }
+    if (index < 0)
+        return SNAPSHOT_INVALID;
+    atomic_store(&clients->snapshot_read_time, mp_time_us());
+    if (atomic_load(&clients->pending_changes) > 0 ||
+        atomic_load(&clients->snapshot_count) !=
+        atomic_load(&clients->modify_count))
+        return SNAPSHOT_INVALID;
+
+    struct snapshot_value *v = &clients->snapshot[index];
+    int status = atomic_load(&v->status);
+    if (status != 0)
+        return status;
+    struct mpv_node node = {.format = atomic_load(&v->format)};
+    uint64_t bits = atomic_load(&v->bits);
+    switch (node.format) {
+    case MPV_FORMAT_FLAG:   node.u.flag = bits; break;
+    case MPV_FORMAT_INT64:  node.u.int64 = bits; break;
+    case MPV_FORMAT_DOUBLE: memcpy(&node.u.double_, &bits, 8); break;
+    default:                return SNAPSHOT_INVALID;
+    }
+    if (format == MPV_FORMAT_NODE) {
+        *(struct mpv_node *)data = node;
+    } else if (!conv_node_to_format(data, format, &node)) {
+        return MPV_ERROR_PROPERTY_FORMAT;
+    }
+    return 0;
+}
+
 int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
                      void *data)
 {
@@ -1123,6 +1487,10 @@ int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
     if (!get_mp_type_get(format))
         return MPV_ERROR_PROPERTY_FORMAT;
 
+    int r = get_snapshot_property(ctx, name, format, data);
+    if (r != SNAPSHOT_INVALID)
+        return r;
+
     struct getproperty_request req = {
         .mpctx = ctx->mpctx,
         .name = name,
@@ -1133,6 +1501,54 @@ int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
     return req.status;
 }
 
+struct getproperties_request {
+    struct getproperty_request *reqs;
+    int num;
+};
+
+static void getproperties_fn(void *arg)
+{
+    struct getproperties_request *list = arg;
+    for (int n = 0; n < list->num; n++)
+        getproperty_fn(&list->reqs[n]);
+}
+
+int mpv_get_properties(mpv_handle *ctx, int num, const char **names,
+                       mpv_format format, void *data, int *errors)
+{
+    const struct m_option *type = get_mp_type_get(format);
+    if (!ctx->mpctx->initialized)
+        return MPV_ERROR_UNINITIALIZED;
+    if (!type)
+        return MPV_ERROR_PROPERTY_FORMAT;
+    if (num < 0 || (num > 0 && (!names || !data)))
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    void *tmp = talloc_new(NULL);
+    struct getproperty_request *reqs =
+        talloc_zero_array(tmp, struct getproperty_request, num);
+    int *status = talloc_zero_array(tmp, int, num);
+    for (int n = 0; n < num; n++) {
+        reqs[n] = (struct getproperty_request){
+            .mpctx = ctx->mpctx,
+            .name = names[n],
+            .format = format,
+            .data = (char *)data + n * type->type->size,
+        };
+    }
+
+    // The snapshot is not used, because its values may be older than the
+    // ones read from the core, and all values must be from the same time.
+    struct getproperties_request list = {reqs, num};
+    run_locked(ctx, getproperties_fn, &list);
+
+    for (int n = 0; n < num; n++)
+        status[n] = reqs[n].status;
+    int r = batch_status(num, status, errors);
+    talloc_free(tmp);
+    return r;
+}
+
 char *mpv_get_property_string(mpv_handle *ctx, const char *name)
 {
     char *str = NULL;
@@ -1268,16 +1684,38 @@ void mp_client_property_change(struct MPContext *mpctx, const char *name)
     pthread_mutex_unlock(&clients->lock);
 }
 
-// Mark properties as changed in reaction to specific events.
-// Called with ctx->lock held.
-static void notify_property_events(struct mpv_handle *ctx, uint64_t event_mask)
+// Set ids[id] for each property that is observed by any client, and which
+// might be changed by one of the events in event_mask. ids has num_ids
+// entries. Returns whether any entry was set.
+bool mp_client_get_observed_properties(struct MPContext *mpctx,
+                                       uint64_t event_mask, bool *ids,
+                                       int num_ids)
 {
-    for (int i = 0; i < ctx->num_properties; i++) {
-        if (ctx->properties[i]->event_mask & event_mask)
-            mark_property_changed(ctx, i);
+    struct mp_client_api *clients = mpctx->clients;
+    bool any = false;
+
+    pthread_mutex_lock(&clients->lock);
+
+    for (int n = 0; n < clients->num_clients; n++) {
+        struct mpv_handle *client = clients->clients[n];
+        pthread_mutex_lock(&client->lock);
+        if (client->property_event_masks & event_mask) {
+            for (int i = 0; i < client->num_properties; i++) {
+                struct observe_property *prop = client->properties[i];
+                if ((prop->event_mask & event_mask) && prop->id >= 0 &&
+                    prop->id < num_ids)
+                {
+                    ids[prop->id] = true;
+                    any = true;
+                }
+            }
+        }
+        pthread_mutex_unlock(&client->lock);
     }
-    if (ctx->lowest_changed < ctx->num_properties)
-        wakeup_client(ctx);
+
+    pthread_mutex_unlock(&clients->lock);
+
+    return any;
 }
 
 static void update_prop(void *p)
@@ -1414,6 +1852,92 @@ int mpv_get_wakeup_pipe(mpv_handle *ctx)
     return fd;
 }
 
+// Return the opengl-cb context, if a client has requested it. Used to hand
+// it to the "opengl-cb" VO.
+struct mpv_opengl_cb_context *mp_client_get_gl_cb_context(struct MPContext *mpctx)
+{
+    pthread_mutex_lock(&mpctx->clients->lock);
+    struct mpv_opengl_cb_context *gl_cb_ctx = mpctx->clients->gl_cb_ctx;
+    pthread_mutex_unlock(&mpctx->clients->lock);
+    return gl_cb_ctx;
+}
+
+static void *get_opengl_cb_context(mpv_handle *ctx)
+{
+#if HAVE_GL
+    struct mp_client_api *clients = ctx->clients;
+    pthread_mutex_lock(&clients->lock);
+    if (!clients->gl_cb_ctx) {
+        clients->gl_cb_ctx = mp_opengl_create(clients, ctx->mpctx->global,
+                                              ctx->mpctx->osd);
+    }
+    void *res = clients->gl_cb_ctx;
+    pthread_mutex_unlock(&clients->lock);
+    return res;
+#else
+    return NULL;
+#endif
+}
+
+// Return the frame-cb context, if a client has requested it.
+struct mpv_frame_cb_context *mp_client_get_frame_cb_context(struct MPContext *mpctx)
+{
+    pthread_mutex_lock(&mpctx->clients->lock);
+    struct mpv_frame_cb_context *frame_cb_ctx = mpctx->clients->frame_cb_ctx;
+    pthread_mutex_unlock(&mpctx->clients->lock);
+    return frame_cb_ctx;
+}
+
+static void *get_frame_cb_context(mpv_handle *ctx)
+{
+    struct mp_client_api *clients = ctx->clients;
+    pthread_mutex_lock(&clients->lock);
+    if (!clients->frame_cb_ctx)
+        clients->frame_cb_ctx = mp_frame_cb_create(clients, ctx->mpctx->global);
+    void *res = clients->frame_cb_ctx;
+    pthread_mutex_unlock(&clients->lock);
+    return res;
+}
+
+void *mpv_get_sub_api(mpv_handle *ctx, mpv_sub_api sub_api)
+{
+    if (!ctx->mpctx->initialized)
+        return NULL;
+    switch (sub_api) {
+    case MPV_SUB_API_OPENGL_CB:
+        return get_opengl_cb_context(ctx);
+    case MPV_SUB_API_FRAME_CB:
+        return get_frame_cb_context(ctx);
+    default:
+        return NULL;
+    }
+}
+
+#if !HAVE_GL
+void mpv_opengl_cb_set_update_callback(mpv_opengl_cb_context *ctx,
+                                       mpv_opengl_cb_update_fn callback,
+                                       void *callback_ctx)
+{
+}
+
+int mpv_opengl_cb_init_gl(mpv_opengl_cb_context *ctx, const char *exts,
+                          mpv_opengl_cb_get_proc_address_fn get_proc_address,
+                          void *get_proc_address_ctx)
+{
+    return MPV_ERROR_INVALID_PARAMETER;
+}
+
+int mpv_opengl_cb_render(mpv_opengl_cb_context *ctx, int fbo, int vp[4])
+{
+    return MPV_ERROR_INVALID_PARAMETER;
+}
+
+int mpv_opengl_cb_uninit_gl(mpv_opengl_cb_context *ctx)
+{
+    return MPV_ERROR_INVALID_PARAMETER;
+}
+#endif
+
 unsigned long mpv_client_api_version(void)
 {
     return MPV_CLIENT_API_VERSION;
@@ -2,8 +2,11 @@
 #define MP_CLIENT_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "libmpv/client.h"
+#include "libmpv/opengl_cb.h"
+#include "libmpv/frame_cb.h"
 
 struct MPContext;
 struct mpv_handle;
@@ -20,9 +23,30 @@ int mp_client_send_event(struct MPContext *mpctx, const char *client_name,
                          int event, void *data);
 bool mp_client_event_is_registered(struct MPContext *mpctx, int event);
 void mp_client_property_change(struct MPContext *mpctx, const char *name);
+bool mp_client_get_observed_properties(struct MPContext *mpctx,
+                                       uint64_t event_mask, bool *ids,
+                                       int num_ids);
+bool mp_client_node_equal(struct mpv_node *a, struct mpv_node *b);
+void mp_client_update_snapshot(struct MPContext *mpctx);
 
 struct mpv_handle *mp_new_client(struct mp_client_api *clients, const char *name);
 struct mp_log *mp_client_get_log(struct mpv_handle *ctx);
 struct MPContext *mp_client_get_core(struct mpv_handle *ctx);
 
+struct mpv_opengl_cb_context *mp_client_get_gl_cb_context(struct MPContext *mpctx);
+struct mpv_frame_cb_context *mp_client_get_frame_cb_context(struct MPContext *mpctx);
+
+// vo_opengl_cb.c
+struct mpv_global;
+struct osd_state;
+struct mpv_opengl_cb_context *mp_opengl_create(void *talloc_ctx,
+                                               struct mpv_global *g,
+                                               struct osd_state *osd);
+
+// frame_cb.c
+struct mp_image;
+struct mpv_frame_cb_context *mp_frame_cb_create(void *talloc_ctx,
+                                                struct mpv_global *g);
+void mp_frame_cb_deliver(struct mpv_frame_cb_context *ctx, struct mp_image *img);
+
 #endif
@@ -32,6 +32,7 @@
 #include "config.h"
 #include "talloc.h"
 #include "client.h"
+#include "common/mem_budget.h"
 #include "common/msg.h"
 #include "common/msg_control.h"
 #include "command.h"
@@ -60,6 +61,7 @@
 #include "audio/decode/dec_audio.h"
 #include "options/path.h"
 #include "screenshot.h"
+#include "common/encode.h"
 #if HAVE_SYS_MMAN_H
 #include <sys/mman.h>
 #endif
@@ -84,6 +86,20 @@ struct command_ctx {
     // bitmap list can be manipulated without additional synchronization.
     struct sub_bitmaps overlay_osd[2];
     struct sub_bitmaps *overlay_osd_current;
+
+    // Indexed by property ID (see mp_get_property_id()).
+    struct property_state *prop_state;
+    bool *prop_check;
+    int num_props;
+};
+
+// Last known value of an observed property, used to filter out events which
+// didn't actually change the property.
+struct property_state {
+    uint64_t gen;           // incremented whenever a change was detected
+    bool cached;            // valid/value are set
+    bool valid;             // the property was available
+    struct mpv_node value;
 };
 
 static int edit_filters(struct MPContext *mpctx, enum stream_type mediatype,
@@ -154,7 +170,7 @@ static int mp_property_generic_option(void *ctx, struct m_property *prop,
         m_option_copy(opt->opt, arg, valptr);
         return M_PROPERTY_OK;
     case M_PROPERTY_SET:
-        m_option_copy(opt->opt, valptr, arg);
+        m_config_set_option_raw_direct(mpctx->mconfig, opt, arg);
         return M_PROPERTY_OK;
     }
     return M_PROPERTY_NOT_IMPLEMENTED;
@@ -195,6 +211,42 @@ static int mp_property_path(void *ctx, struct m_property *prop,
     return m_property_strdup_ro(action, arg, mpctx->filename);
 }
 
+static int mp_property_startup_timings(void *ctx, struct m_property *prop,
+                                       int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    char *s = mp_format_startup_timings(NULL, mpctx);
+    int r = m_property_strdup_ro(action, arg, s);
+    talloc_free(s);
+    return r;
+}
+
+static int mp_property_alloc_profiling(void *ctx, struct m_property *prop,
+                                       int action, void *arg)
+{
+    switch (action) {
+    case M_PROPERTY_GET:
+        *(int *)arg = ta_profiling_enabled();
+        return M_PROPERTY_OK;
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_FLAG};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_SET:
+        ta_enable_profiling(*(int *)arg);
+        return M_PROPERTY_OK;
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
+static int mp_property_alloc_profile(void *ctx, struct m_property *prop,
+                                     int action, void *arg)
+{
+    char *s = mp_format_alloc_profile(NULL, 50);
+    int r = m_property_strdup_ro(action, arg, s);
+    talloc_free(s);
+    return r;
+}
+
 static int mp_property_filename(void *ctx, struct m_property *prop,
                                 int action, void *arg)
 {
@@ -384,6 +436,35 @@ static int mp_property_total_avsync_change(void *ctx, struct m_property *prop,
     return m_property_double_ro(action, arg, mpctx->total_avsync_change);
 }
 
+static int mp_property_audio_speed_correction(void *ctx, struct m_property *prop,
+                                             int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->d_audio)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_double_ro(action, arg, mpctx->audio_speed_correction);
+}
+
+static int mp_property_encode_progress(void *ctx, struct m_property *prop,
+                                       int action, void *arg)
+{
+    double fps = 0, eta = -1;
+#if HAVE_ENCODING
+    MPContext *mpctx = ctx;
+    if (!encode_lavc_get_progress(mpctx->encode_lavc_ctx,
+                                  get_current_pos_ratio(mpctx, true),
+                                  &fps, &eta))
+        return M_PROPERTY_UNAVAILABLE;
+#else
+    return M_PROPERTY_UNAVAILABLE;
+#endif
+    if (strcmp(prop->name, "encode-fps") == 0)
+        return m_property_double_ro(action, arg, fps);
+    if (eta < 0)
+        return M_PROPERTY_UNAVAILABLE;
+    return property_time(action, arg, eta);
+}
+
 
 /// Late frames
 static int mp_property_drop_frame_cnt(void *ctx, struct m_property *prop,
@@ -406,6 +487,59 @@ static int mp_property_vo_drop_frame_count(void *ctx, struct m_property *prop,
     return m_property_int_ro(action, arg, vo_get_drop_count(mpctx->video_out));
 }
 
+static int mp_property_vo_missed_vsync_count(void *ctx, struct m_property *prop,
+                                             int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->d_video)
+        return M_PROPERTY_UNAVAILABLE;
+
+    return m_property_int_ro(action, arg, vo_get_missed_count(mpctx->video_out));
+}
+
+static int get_pass_timing_entry(int item, int action, void *arg, void *ctx)
+{
+    struct voctrl_pass_timings *t = ctx;
+    struct voctrl_pass_timing *pass = &t->passes[item];
+
+    struct m_sub_property props[] = {
+        {"name",        SUB_PROP_STR(pass->name)},
+        {"last",        SUB_PROP_INT64(pass->last_ns / 1000)},
+        {"avg",         SUB_PROP_INT64(pass->avg_ns / 1000)},
+        {"peak",        SUB_PROP_INT64(pass->peak_ns / 1000)},
+        {0}
+    };
+
+    return m_property_read_sub(props, action, arg);
+}
+
+static int mp_property_vo_pass_timings(void *ctx, struct m_property *prop,
+                                       int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->video_out)
+        return M_PROPERTY_UNAVAILABLE;
+
+    struct voctrl_pass_timings t;
+    if (vo_control(mpctx->video_out, VOCTRL_GET_PASS_TIMINGS, &t) <= 0)
+        return M_PROPERTY_UNAVAILABLE;
+
+    if (action == M_PROPERTY_PRINT) {
+        char *res = NULL;
+        for (int n = 0; n < t.num_passes; n++) {
+            struct voctrl_pass_timing *pass = &t.passes[n];
+            res = talloc_asprintf_append(res, "%s: %lld us (peak %lld us)\n",
+                                         pass->name,
+                                         (long long)(pass->avg_ns / 1000),
+                                         (long long)(pass->peak_ns / 1000));
+        }
+        *(char **)arg = res ? res : talloc_strdup(NULL, "");
+        return M_PROPERTY_OK;
+    }
+    return m_property_read_list(action, arg, t.num_passes,
+                                get_pass_timing_entry, &t);
+}
+
 /// Current position in percent (RW)
 static int mp_property_percent_pos(void *ctx, struct m_property *prop,
                                    int action, void *arg)
@@ -1156,6 +1290,36 @@ static int mp_property_cache_idle(void *ctx, struct m_property *prop,
     return m_property_flag_ro(action, arg, !!idle);
 }
 
+static int mp_property_cache_speed(void *ctx, struct m_property *prop,
+                                   int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->demuxer)
+        return M_PROPERTY_UNAVAILABLE;
+
+    int64_t speed = -1;
+    demux_stream_control(mpctx->demuxer, STREAM_CTRL_GET_CACHE_SPEED, &speed);
+    if (speed < 0)
+        return M_PROPERTY_UNAVAILABLE;
+    return property_int_kb_size(speed / 1024, action, arg);
+}
+
+static int mp_property_dvb_stat(void *ctx, struct m_property *prop,
+                                int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->demuxer)
+        return M_PROPERTY_UNAVAILABLE;
+
+    struct stream_dvb_stats stats;
+    if (demux_stream_control(mpctx->demuxer, STREAM_CTRL_GET_DVB_STATS,
+                             &stats) < 1)
+        return M_PROPERTY_UNAVAILABLE;
+    int64_t v = strcmp(prop->name, "dvb-overflow-count") == 0
+                ? stats.overflows : stats.cc_errors;
+    return m_property_int64_ro(action, arg, v);
+}
+
 static int mp_property_demuxer_cache_duration(void *ctx, struct m_property *prop,
                                               int action, void *arg)
 {
@@ -1173,6 +1337,38 @@ static int mp_property_demuxer_cache_duration(void *ctx, struct m_property *prop
     return m_property_double_ro(action, arg, s.ts_duration);
 }
 
+/// Estimated delay between demuxing a packet and presenting it (RO)
+static int mp_property_playback_latency(void *ctx, struct m_property *prop,
+                                        int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->demuxer || (!mpctx->ao && !mpctx->d_video))
+        return M_PROPERTY_UNAVAILABLE;
+
+    double demux = 0;
+    struct demux_ctrl_reader_state s;
+    if (demux_control(mpctx->demuxer, DEMUXER_CTRL_GET_READER_STATE, &s) > 0 &&
+        s.ts_duration > 0)
+        demux = s.ts_duration;
+
+    double audio = 0;
+    if (mpctx->ao) {
+        audio = ao_get_delay(mpctx->ao);
+        if (mpctx->ao_buffer)
+            audio += mp_audio_buffer_seconds(mpctx->ao_buffer);
+    }
+
+    double video = 0;
+    if (mpctx->d_video && mpctx->d_video->fps > 0) {
+        int frames = 0;
+        video_vd_control(mpctx->d_video, VDCTRL_QUERY_UNSEEN_FRAMES, &frames);
+        // Plus the frame waiting in the VO.
+        video = (frames + 1) / mpctx->d_video->fps;
+    }
+
+    return m_property_double_ro(action, arg, demux + MPMAX(audio, video));
+}
+
 static int mp_property_demuxer_cache_idle(void *ctx, struct m_property *prop,
                                           int action, void *arg)
 {
@@ -1187,6 +1383,40 @@ static int mp_property_demuxer_cache_idle(void *ctx, struct m_property *prop,
     return m_property_flag_ro(action, arg, s.idle);
 }
 
+static int mp_property_demuxer_bitrate(void *ctx, struct m_property *prop,
+                                       int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->demuxer)
+        return M_PROPERTY_UNAVAILABLE;
+
+    struct demux_ctrl_reader_state s;
+    if (demux_control(mpctx->demuxer, DEMUXER_CTRL_GET_READER_STATE, &s) < 1)
+        return M_PROPERTY_UNAVAILABLE;
+
+    if (s.bitrate < 0)
+        return M_PROPERTY_UNAVAILABLE;
+
+    return m_property_int64_ro(action, arg, s.bitrate);
+}
+
+// Memory used by caches and pools (in bytes). This is process-wide.
+static int mp_property_memory_usage(void *ctx, struct m_property *prop,
+                                    int action, void *arg)
+{
+    int64_t budget = mp_mem_get_budget();
+    struct m_sub_property props[] = {
+        {"total",       SUB_PROP_INT64(mp_mem_get_usage(NULL))},
+        {"budget",      SUB_PROP_INT64(budget), .unavailable = !budget},
+        {"cache",       SUB_PROP_INT64(mp_mem_get_usage("cache"))},
+        {"demuxer",     SUB_PROP_INT64(mp_mem_get_usage("demuxer"))},
+        {"image-pool",  SUB_PROP_INT64(mp_mem_get_usage("image-pool"))},
+        {"libass",      SUB_PROP_INT64(mp_mem_get_usage("libass"))},
+        {0}
+    };
+    return m_property_read_sub(props, action, arg);
+}
+
 static int mp_property_paused_for_cache(void *ctx, struct m_property *prop,
                                         int action, void *arg)
 {
@@ -1516,6 +1746,11 @@ static int get_track_entry(int item, int action, void *arg, void *ctx)
 
     const char *codec = track->stream ? track->stream->codec : NULL;
 
+    struct demux_stream_stats st = {0};
+    bool has_stats = track->stream && track->selected;
+    if (has_stats)
+        demux_get_stream_stats(track->stream, &st);
+
     struct m_sub_property props[] = {
         {"id",          SUB_PROP_INT(track->user_tid)},
         {"type",        SUB_PROP_STR(stream_type_name(track->type)),
@@ -1534,6 +1769,20 @@ static int get_track_entry(int item, int action, void *arg, void *ctx)
                         .unavailable = !track->external_filename},
         {"codec",       SUB_PROP_STR(codec),
                         .unavailable = !codec},
+        {"hls-bitrate", SUB_PROP_INT(track->stream ? track->stream->hls_bitrate : 0),
+                        .unavailable = !track->stream || !track->stream->hls_bitrate},
+        {"demux-queued-packets", SUB_PROP_INT64(st.queued_packets),
+                        .unavailable = !has_stats},
+        {"demux-queued-bytes", SUB_PROP_INT64(st.queued_bytes),
+                        .unavailable = !has_stats},
+        {"demux-queued-duration", SUB_PROP_DOUBLE(st.queued_secs),
+                        .unavailable = !has_stats || st.queued_secs < 0},
+        {"demux-packet-rate", SUB_PROP_DOUBLE(st.packets_per_sec),
+                        .unavailable = !has_stats || st.packets_per_sec < 0},
+        {"demux-packet-size", SUB_PROP_DOUBLE(st.avg_packet_size),
+                        .unavailable = !has_stats || st.avg_packet_size < 0},
+        {"demux-underruns", SUB_PROP_INT64(st.underruns),
+                        .unavailable = !has_stats},
         {0}
     };
 
@@ -2076,6 +2325,30 @@ static int mp_property_video_codec(void *ctx, struct m_property *prop,
 }
 
 
+/// Decoder threading chosen by vd_lavc (RO)
+static int mp_property_video_decoder_threads(void *ctx, struct m_property *prop,
+                                             int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    struct vd_threading t = {0};
+    if (!mpctx->d_video ||
+        video_vd_control(mpctx->d_video, VDCTRL_GET_THREADING, &t) < 1)
+        return M_PROPERTY_UNAVAILABLE;
+
+    if (action == M_PROPERTY_PRINT) {
+        *(char **)arg = talloc_asprintf(NULL, "%d (%s)", t.threads, t.type);
+        return M_PROPERTY_OK;
+    }
+
+    struct m_sub_property props[] = {
+        {"count",   SUB_PROP_INT(t.threads)},
+        {"type",    SUB_PROP_STR(t.type)},
+        {0}
+    };
+
+    return m_property_read_sub(props, action, arg);
+}
+
 /// Video bitrate (RO)
 static int mp_property_video_bitrate(void *ctx, struct m_property *prop,
                                      int action, void *arg)
@@ -2724,10 +2997,18 @@ static const struct m_property mp_properties[] = {
     {"stream-end", mp_property_stream_end},
     {"length", mp_property_length},
     {"avsync", mp_property_avsync},
+    {"encode-fps", mp_property_encode_progress},
+    {"encode-eta", mp_property_encode_progress},
     {"total-avsync-change", mp_property_total_avsync_change},
+    {"audio-speed-correction", mp_property_audio_speed_correction},
     {"drop-frame-count", mp_property_drop_frame_cnt},
     {"vo-drop-frame-count", mp_property_vo_drop_frame_count},
+    {"vo-missed-vsync-count", mp_property_vo_missed_vsync_count},
+    {"vo-pass-timings", mp_property_vo_pass_timings},
     {"percent-pos", mp_property_percent_pos},
+    {"startup-timings", mp_property_startup_timings},
+    {"alloc-profiling", mp_property_alloc_profiling},
+    {"alloc-profile", mp_property_alloc_profile},
     {"time-start", mp_property_time_start},
     {"time-pos", mp_property_time_pos},
     {"time-remaining", mp_property_remaining},
@@ -2753,8 +3034,14 @@ static const struct m_property mp_properties[] = {
     {"cache-used", mp_property_cache_used},
     {"cache-size", mp_property_cache_size},
     {"cache-idle", mp_property_cache_idle},
+    {"cache-speed", mp_property_cache_speed},
+    {"dvb-overflow-count", mp_property_dvb_stat},
+    {"dvb-cc-error-count", mp_property_dvb_stat},
     {"demuxer-cache-duration", mp_property_demuxer_cache_duration},
     {"demuxer-cache-idle", mp_property_demuxer_cache_idle},
+    {"playback-latency", mp_property_playback_latency},
+    {"demuxer-bitrate", mp_property_demuxer_bitrate},
+    {"memory-usage", mp_property_memory_usage},
     {"paused-for-cache", mp_property_paused_for_cache},
     {"pts-association-mode", mp_property_generic_option},
     {"hr-seek", mp_property_generic_option},
@@ -2808,6 +3095,7 @@ static const struct m_property mp_properties[] = {
     {"video-params", mp_property_vd_imgparams},
     {"video-format", mp_property_video_format},
     {"video-codec", mp_property_video_codec},
+    {"video-decoder-threads", mp_property_video_decoder_threads},
     {"video-bitrate", mp_property_video_bitrate},
     M_PROPERTY_ALIAS("dwidth", "video-out-params/dw"),
     M_PROPERTY_ALIAS("dheight", "video-out-params/dh"),
@@ -2883,8 +3171,8 @@ static const char *const *const mp_event_property_change[] = {
     E(MPV_EVENT_TICK, "time-pos", "stream-pos", "stream-time-pos", "avsync",
       "percent-pos", "time-remaining", "playtime-remaining", "playback-time"),
     E(MPV_EVENT_VIDEO_RECONFIG, "video-out-params", "video-params",
-      "video-format", "video-codec", "video-bitrate", "dwidth", "dheight",
-      "width", "height", "fps", "aspect"),
+      "video-format", "video-codec", "video-decoder-threads", "video-bitrate",
+      "dwidth", "dheight", "width", "height", "fps", "aspect"),
     E(MPV_EVENT_AUDIO_RECONFIG, "audio-format", "audio-codec", "audio-bitrate",
       "samplerate", "channels", "audio"),
     E(MPV_EVENT_SEEK, "seeking"),
@@ -2892,7 +3180,8 @@ static const char *const *const mp_event_property_change[] = {
     E(MPV_EVENT_METADATA_UPDATE, "metadata"),
     E(MPV_EVENT_CHAPTER_CHANGE, "chapter", "chapter-metadata"),
     E(MP_EVENT_CACHE_UPDATE, "cache", "cache-free", "cache-used", "cache-idle",
-      "demuxer-cache-duration", "demuxer-cache-idle"),
+      "cache-speed", "demuxer-cache-duration", "demuxer-cache-idle",
+      "demuxer-bitrate"),
 };
 #undef E
 
@@ -2925,15 +3214,27 @@ uint64_t mp_get_property_event_mask(const char *name)
     return mask;
 }
 
+static pthread_once_t prop_index_once = PTHREAD_ONCE_INIT;
+static struct m_property_index *prop_index;
+
+static void init_prop_index(void)
+{
+    prop_index = m_property_index_new(NULL, mp_properties);
+}
+
+// The index is immutable once created, so it can be used from any thread.
+static struct m_property_index *get_prop_index(void)
+{
+    pthread_once(&prop_index_once, init_prop_index);
+    return prop_index;
+}
+
 // Return an ID for the property. It might not be unique, but is good enough
 // for property change handling. Return -1 if property unknown.
 int mp_get_property_id(const char *name)
 {
-    for (int n = 0; mp_properties[n].name; n++) {
-        if (match_property(mp_properties[n].name, name))
-            return n;
-    }
-    return -1;
+    bstr prefix = bstr_splice(bstr0(name), 0, prefix_len(name));
+    return m_property_index_lookup(get_prop_index(), prefix);
 }
 
 static bool is_property_set(int action, void *val)
@@ -2956,7 +3257,7 @@ static bool is_property_set(int action, void *val)
 int mp_property_do(const char *name, int action, void *val,
                    struct MPContext *ctx)
 {
-    int r = m_property_do(ctx->log, mp_properties, name, action, val, ctx);
+    int r = m_property_do(ctx->log, get_prop_index(), name, action, val, ctx);
     if (r == M_PROPERTY_OK && is_property_set(action, val))
         mp_notify_property(ctx, (char *)name);
     return r;
@@ -2964,11 +3265,12 @@ int mp_property_do(const char *name, int action, void *val,
 
 char *mp_property_expand_string(struct MPContext *mpctx, const char *str)
 {
-    return m_properties_expand_string(mp_properties, str, mpctx);
+    return m_properties_expand_string(get_prop_index(), str, mpctx);
 }
 
-// Before expanding properties, parse C-style escapes like "\n"
-char *mp_property_expand_escaped_string(struct MPContext *mpctx, const char *str)
+// Before parsing the property string, parse C-style escapes like "\n"
+struct m_property_template *mp_property_compile_escaped(void *ta_parent,
+                                                        const char *str)
 {
     void *tmp = talloc_new(NULL);
     bstr strb = bstr0(str);
@@ -2976,15 +3278,31 @@ char *mp_property_expand_escaped_string(struct MPContext *mpctx, const char *str
     while (strb.len) {
         if (!mp_append_escaped_string(tmp, &dst, &strb)) {
             talloc_free(tmp);
-            return talloc_strdup(NULL, "(broken escape sequences)");
+            return m_property_template_new(ta_parent,
+                                           "(broken escape sequences)");
         }
         // pass " through literally
         if (!bstr_eatstart0(&strb, "\""))
             break;
         bstr_xappend(tmp, &dst, bstr0("\""));
     }
-    char *r = mp_property_expand_string(mpctx, dst.start);
+    struct m_property_template *t =
+        m_property_template_new(ta_parent, dst.start ? (char *)dst.start : "");
     talloc_free(tmp);
+    return t;
+}
+
+char *mp_property_expand_template(struct MPContext *mpctx,
+                                  struct m_property_template *t)
+{
+    return m_property_template_expand(get_prop_index(), t, mpctx);
+}
+
+char *mp_property_expand_escaped_string(struct MPContext *mpctx, const char *str)
+{
+    struct m_property_template *t = mp_property_compile_escaped(NULL, str);
+    char *r = mp_property_expand_template(mpctx, t);
+    talloc_free(t);
     return r;
 }
 
@@ -3996,7 +4314,12 @@ int run_command(MPContext *mpctx, mp_cmd_t *cmd)
 
 void command_uninit(struct MPContext *mpctx)
 {
+    struct command_ctx *ctx = mpctx->command_ctx;
     overlay_uninit(mpctx);
+    for (int n = 0; n < ctx->num_props; n++) {
+        if (ctx->prop_state[n].valid)
+            mpv_free_node_contents(&ctx->prop_state[n].value);
+    }
     talloc_free(mpctx->command_ctx);
     mpctx->command_ctx = NULL;
 }
@@ -4007,6 +4330,58 @@ void command_init(struct MPContext *mpctx)
     *mpctx->command_ctx = (struct command_ctx){
         .last_seek_pts = MP_NOPTS_VALUE,
     };
+    struct command_ctx *ctx = mpctx->command_ctx;
+    while (mp_properties[ctx->num_props].name)
+        ctx->num_props++;
+    ctx->prop_state = talloc_zero_array(ctx, struct property_state,
+                                        ctx->num_props);
+    ctx->prop_check = talloc_zero_array(ctx, bool, ctx->num_props);
+}
+
+static void property_changed(struct MPContext *mpctx, int id)
+{
+    struct command_ctx *ctx = mpctx->command_ctx;
+    ctx->prop_state[id].gen++;
+    mp_client_property_change(mpctx, mp_properties[id].name);
+}
+
+// Read the observed properties the event might affect, and notify clients
+// only about those whose value is different from the last time.
+static void check_property_changes(struct MPContext *mpctx, int event)
+{
+    struct command_ctx *ctx = mpctx->command_ctx;
+    memset(ctx->prop_check, 0, ctx->num_props * sizeof(bool));
+    if (!mp_client_get_observed_properties(mpctx, 1ULL << event,
+                                           ctx->prop_check, ctx->num_props))
+        return;
+
+    for (int id = 0; id < ctx->num_props; id++) {
+        if (!ctx->prop_check[id])
+            continue;
+        struct property_state *st = &ctx->prop_state[id];
+        struct mpv_node node = {0};
+        int r = m_property_do(mpctx->log, get_prop_index(),
+                              mp_properties[id].name, M_PROPERTY_GET_NODE,
+                              &node, mpctx);
+        if (r == M_PROPERTY_NOT_IMPLEMENTED) {
+            // Can't compare values; assume it changed.
+            property_changed(mpctx, id);
+            continue;
+        }
+        bool valid = r == M_PROPERTY_OK;
+        bool changed = !st->cached || valid != st->valid ||
+                       (valid && !mp_client_node_equal(&node, &st->value));
+        if (changed) {
+            if (st->valid)
+                mpv_free_node_contents(&st->value);
+            st->value = valid ? node : (struct mpv_node){0};
+            st->valid = valid;
+            st->cached = true;
+            property_changed(mpctx, id);
+        } else if (valid) {
+            mpv_free_node_contents(&node);
+        }
+    }
 }
 
 void mp_notify(struct MPContext *mpctx, int event, void *arg)
@@ -4015,10 +4390,28 @@ void mp_notify(struct MPContext *mpctx, int event, void *arg)
     if (event == MPV_EVENT_START_FILE)
         ctx->last_seek_pts = MP_NOPTS_VALUE;
 
+    check_property_changes(mpctx, event);
     mp_client_broadcast_event(mpctx, event, arg);
 }
 
 void mp_notify_property(struct MPContext *mpctx, const char *property)
 {
+    struct command_ctx *ctx = mpctx->command_ctx;
+    int id = mp_get_property_id(property);
+    if (id >= 0) {
+        // The cached value is outdated; the next check will report it again.
+        ctx->prop_state[id].cached = false;
+        ctx->prop_state[id].gen++;
+    }
     mp_client_property_change(mpctx, property);
 }
+
+// Return a counter that is incremented whenever the property was detected to
+// change. Only properties which are observed or set are tracked.
+uint64_t mp_get_property_generation(struct MPContext *mpctx, int id)
+{
+    struct command_ctx *ctx = mpctx->command_ctx;
+    if (id < 0 || id >= ctx->num_props)
+        return 0;
+    return ctx->prop_state[id].gen;
+}
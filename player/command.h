@@ -29,6 +29,11 @@ void command_uninit(struct MPContext *mpctx);
 int run_command(struct MPContext *mpctx, struct mp_cmd *cmd);
 char *mp_property_expand_string(struct MPContext *mpctx, const char *str);
 char *mp_property_expand_escaped_string(struct MPContext *mpctx, const char *str);
+struct m_property_template;
+struct m_property_template *mp_property_compile_escaped(void *ta_parent,
+                                                        const char *str);
+char *mp_property_expand_template(struct MPContext *mpctx,
+                                  struct m_property_template *t);
 void property_print_help(struct mp_log *log);
 int mp_property_do(const char* name, int action, void* val,
                    struct MPContext *mpctx);
@@ -38,6 +43,7 @@ void mp_notify_property(struct MPContext *mpctx, const char *property);
 
 int mp_get_property_id(const char *name);
 uint64_t mp_get_property_event_mask(const char *name);
+uint64_t mp_get_property_generation(struct MPContext *mpctx, int id);
 
 // Must start with the first unused positive value in enum mpv_event_id
 #define INTERNAL_EVENT_BASE 24
@@ -18,10 +18,13 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <assert.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <string.h>
+#include <pthread.h>
 
 #include <libavutil/md5.h>
 
@@ -274,6 +277,201 @@ static bool needs_config_quoting(const char *s)
     return false;
 }
 
+// Background writer for watch_later files. The contents are created on the
+// playback thread, but a slow file system (e.g. a network home directory)
+// should not block quitting or switching to the next file.
+struct watch_later_job {
+    char *filename;
+    char *data;         // file contents, or NULL to remove the file
+    bool running;
+};
+
+struct watch_later_writer {
+    struct mp_log *log;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;      // new job or termination
+    pthread_cond_t done;        // a job was finished
+    bool terminate;
+    // Queued and running jobs, oldest first
+    struct watch_later_job **jobs;
+    int num_jobs;
+};
+
+// Write to a temporary file and rename it, so that an interrupted write
+// never leaves a truncated file behind.
+static bool write_file_atomic(struct mp_log *log, const char *filename,
+                              const char *data)
+{
+    char *tmp = talloc_asprintf(NULL, "%s.tmp", filename);
+    bool ok = false;
+    FILE *file = fopen(tmp, "wb");
+    if (file) {
+        size_t len = strlen(data);
+        ok = fwrite(data, 1, len, file) == len;
+        ok &= fclose(file) == 0;
+    }
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows.
+    if (ok)
+        unlink(filename);
+#endif
+    if (ok && rename(tmp, filename) != 0)
+        ok = false;
+    if (!ok) {
+        mp_err(log, "Could not write '%s'.\n", filename);
+        unlink(tmp);
+    }
+    talloc_free(tmp);
+    return ok;
+}
+
+static struct watch_later_job *find_job(struct watch_later_writer *w,
+                                        const char *filename, bool queued)
+{
+    for (int n = 0; n < w->num_jobs; n++) {
+        struct watch_later_job *job = w->jobs[n];
+        if (!(queued && job->running) && strcmp(job->filename, filename) == 0)
+            return job;
+    }
+    return NULL;
+}
+
+static void *watch_later_thread(void *ptr)
+{
+    struct watch_later_writer *w = ptr;
+
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        while (!w->num_jobs && !w->terminate)
+            pthread_cond_wait(&w->wakeup, &w->lock);
+        if (!w->num_jobs)
+            break;
+        struct watch_later_job *job = w->jobs[0];
+        job->running = true;
+        pthread_mutex_unlock(&w->lock);
+
+        if (job->data) {
+            write_file_atomic(w->log, job->filename, job->data);
+        } else {
+            unlink(job->filename);
+        }
+
+        pthread_mutex_lock(&w->lock);
+        MP_TARRAY_REMOVE_AT(w->jobs, w->num_jobs, 0);
+        talloc_free(job);
+        pthread_cond_broadcast(&w->done);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+static void destroy_watch_later_writer(void *ptr)
+{
+    struct watch_later_writer *w = ptr;
+
+    // Finish all queued jobs first.
+    pthread_mutex_lock(&w->lock);
+    w->terminate = true;
+    pthread_cond_broadcast(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    pthread_cond_destroy(&w->wakeup);
+    pthread_cond_destroy(&w->done);
+    pthread_mutex_destroy(&w->lock);
+}
+
+static struct watch_later_writer *get_watch_later_writer(struct MPContext *mpctx)
+{
+    if (!mpctx->watch_later_writer) {
+        struct watch_later_writer *w =
+            talloc_zero(NULL, struct watch_later_writer);
+        w->log = mpctx->log;
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->wakeup, NULL);
+        pthread_cond_init(&w->done, NULL);
+        if (pthread_create(&w->thread, NULL, watch_later_thread, w)) {
+            pthread_cond_destroy(&w->wakeup);
+            pthread_cond_destroy(&w->done);
+            pthread_mutex_destroy(&w->lock);
+            talloc_free(w);
+            return NULL;
+        }
+        talloc_set_destructor(w, destroy_watch_later_writer);
+        mpctx->watch_later_writer = w;
+    }
+    return mpctx->watch_later_writer;
+}
+
+// Write (data!=NULL) or remove (data==NULL) the file in the background. If the
+// writer thread can't be created, do it synchronously.
+static void queue_watch_later_job(struct MPContext *mpctx, const char *filename,
+                                  const char *data)
+{
+    struct watch_later_writer *w = get_watch_later_writer(mpctx);
+    if (!w) {
+        if (data) {
+            write_file_atomic(mpctx->log, filename, data);
+        } else {
+            unlink(filename);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    // A queued job for the same file is obsolete; replace it.
+    struct watch_later_job *job = find_job(w, filename, true);
+    if (!job) {
+        job = talloc_zero(NULL, struct watch_later_job);
+        job->filename = talloc_strdup(job, filename);
+        MP_TARRAY_APPEND(w, w->jobs, w->num_jobs, job);
+    }
+    talloc_free(job->data);
+    job->data = talloc_strdup(job, data);
+    pthread_cond_signal(&w->wakeup);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Wait until pending jobs for the file are done.
+static void wait_watch_later_file(struct MPContext *mpctx, const char *filename)
+{
+    struct watch_later_writer *w = mpctx->watch_later_writer;
+    if (!w)
+        return;
+    pthread_mutex_lock(&w->lock);
+    while (find_job(w, filename, false))
+        pthread_cond_wait(&w->done, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Whether the file exists, or will exist once pending jobs are done.
+static bool watch_later_file_exists(struct MPContext *mpctx,
+                                    const char *filename)
+{
+    struct watch_later_writer *w = mpctx->watch_later_writer;
+    if (w) {
+        pthread_mutex_lock(&w->lock);
+        struct watch_later_job *job = NULL;
+        for (int n = w->num_jobs - 1; n >= 0 && !job; n--) {
+            if (strcmp(w->jobs[n]->filename, filename) == 0)
+                job = w->jobs[n];
+        }
+        bool pending = !!job, exists = job && job->data;
+        pthread_mutex_unlock(&w->lock);
+        if (pending)
+            return exists;
+    }
+    return mp_path_exists(filename);
+}
+
+// Finish writing all watch_later files.
+void mp_uninit_watch_later(struct MPContext *mpctx)
+{
+    talloc_free(mpctx->watch_later_writer);
+    mpctx->watch_later_writer = NULL;
+}
+
 void mp_write_watch_later_conf(struct MPContext *mpctx)
 {
     char *filename = mpctx->filename;
@@ -293,16 +491,14 @@ void mp_write_watch_later_conf(struct MPContext *mpctx)
 
     MP_INFO(mpctx, "Saving state.\n");
 
-    FILE *file = fopen(conffile, "wb");
-    if (!file)
-        goto exit;
+    char *data = talloc_strdup(conffile, "");
     if (mpctx->opts->write_filename_in_watch_later_config) {
         char write_name[1024] = {0};
         for (int n = 0; filename[n] && n < sizeof(write_name) - 1; n++)
             write_name[n] = (unsigned char)filename[n] < 32 ? '_' : filename[n];
-        fprintf(file, "# %s\n", write_name);
+        data = talloc_asprintf_append(data, "# %s\n", write_name);
     }
-    fprintf(file, "start=%f\n", pos);
+    data = talloc_asprintf_append(data, "start=%f\n", pos);
     for (int i = 0; backup_properties[i]; i++) {
         const char *pname = backup_properties[i];
         char *val = NULL;
@@ -315,15 +511,16 @@ void mp_write_watch_later_conf(struct MPContext *mpctx)
             if (!prev || strcmp(prev, val) != 0) {
                 if (needs_config_quoting(val)) {
                     // e.g. '%6%STRING'
-                    fprintf(file, "%s=%%%d%%%s\n", pname, (int)strlen(val), val);
+                    data = talloc_asprintf_append(data, "%s=%%%d%%%s\n",
+                                                  pname, (int)strlen(val), val);
                 } else {
-                    fprintf(file, "%s=%s\n", pname, val);
+                    data = talloc_asprintf_append(data, "%s=%s\n", pname, val);
                 }
             }
         }
         talloc_free(val);
     }
-    fclose(file);
+    queue_watch_later_job(mpctx, conffile, data);
 
 exit:
     talloc_free(conffile);
@@ -332,13 +529,15 @@ exit:
 void mp_load_playback_resume(struct MPContext *mpctx, const char *file)
 {
     char *fname = mp_get_playback_resume_config_filename(mpctx->global, file);
+    if (fname)
+        wait_watch_later_file(mpctx, fname);
     if (fname && mp_path_exists(fname)) {
         // Never apply the saved start position to following files
         m_config_backup_opt(mpctx->mconfig, "start");
         MP_INFO(mpctx, "Resuming playback. This behavior can "
                "be disabled with --no-resume-playback.\n");
         try_load_config(mpctx, fname, M_SETOPT_PRESERVE_CMDLINE);
-        unlink(fname);
+        queue_watch_later_job(mpctx, fname, NULL);
     }
     talloc_free(fname);
 }
@@ -356,7 +555,7 @@ struct playlist_entry *mp_check_playlist_resume(struct MPContext *mpctx,
     for (struct playlist_entry *e = playlist->first; e; e = e->next) {
         char *conf = mp_get_playback_resume_config_filename(mpctx->global,
                                                             e->filename);
-        bool exists = conf && mp_path_exists(conf);
+        bool exists = conf && watch_later_file_exists(mpctx, conf);
         talloc_free(conf);
         if (exists)
             return e;
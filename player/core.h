@@ -74,6 +74,12 @@ struct chapter {
     char *name;
 };
 
+// A property expansion string from the options, parsed on first use.
+struct osd_template {
+    char *src;
+    struct m_property_template *tmpl;
+};
+
 enum mp_osd_seek_info {
     OSD_SEEK_INFO_BAR           = 1,
     OSD_SEEK_INFO_TEXT          = 2,
@@ -167,8 +173,11 @@ typedef struct MPContext {
     struct m_config *mconfig;
     struct input_ctx *input;
     struct mp_client_api *clients;
+    struct mp_ipc_ctx *ipc_ctx;
     struct mp_dispatch_queue *dispatch;
     struct mp_cancel *playback_abort;
+    struct prefetch *prefetch;  // opening next playlist entry in advance
+    struct mp_resolve_cache *resolve_cache;
 
     struct mp_log *statusline;
     struct osd_state *osd;
@@ -176,7 +185,11 @@ typedef struct MPContext {
     char *term_osd_status;
     char *term_osd_subs;
     char *term_osd_contents;
+    double term_osd_last_update;    // mp_time_sec() of last status output
     char *last_window_title;
+    struct osd_template status_msg_tmpl;
+    struct osd_template osd_status_msg_tmpl;
+    struct osd_template osd_msg_tmpl[3];
 
     int add_osd_seek_info; // bitfield of enum mp_osd_seek_info
     double osd_visible; // for the osd bar only
@@ -207,10 +220,19 @@ typedef struct MPContext {
 
     struct demuxer **sources;
     int num_sources;
+    // Per entry in sources[] (see update_source_caches()), or NULL.
+    struct source_cache *source_caches;
+    int num_source_caches;
+    uint64_t source_use_counter;
 
     struct timeline_part *timeline;
     int num_timeline_parts;
     int timeline_part;
+    // Part whose source was seeked and started in advance (see
+    // timeline_preload_part()), and the parameters of that seek.
+    struct timeline_part *timeline_preload;
+    double timeline_preload_pts;
+    int timeline_preload_flags;
     struct chapter *chapters;
     int num_chapters;
     double video_offset;
@@ -229,6 +251,8 @@ typedef struct MPContext {
     struct track *current_track[NUM_PTRACKS][STREAM_TYPE_COUNT];
 
     struct dec_video *d_video;
+    // Decoder of the previous file, kept with --video-reuse-decoder.
+    struct dec_video *detached_d_video;
     struct dec_audio *d_audio;
     struct dec_sub *d_sub[2];
 
@@ -243,6 +267,9 @@ typedef struct MPContext {
     struct mp_audio_buffer *ao_buffer;  // queued audio; passed to ao_play() later
 
     struct vo *video_out;
+    // Additional outputs showing (parts of) the same video (--video-wall).
+    struct wall_output **wall_outputs;
+    int num_wall_outputs;
     // next_frame[0] is the next frame, next_frame[1] the one after that.
     struct mp_image *next_frame[2];
 
@@ -253,6 +280,7 @@ typedef struct MPContext {
     bool sync_audio_to_video;
     bool hrseek_active;
     bool hrseek_framedrop;
+    bool hrseek_keep_frames; // add skipped frames to backstep_frames
     double hrseek_pts;
     // AV sync: the next frame should be shown when the audio out has this
     // much (in seconds) buffered data left. Increased when more data is
@@ -265,6 +293,12 @@ typedef struct MPContext {
     // How much video timing has been changed to make it match the audio
     // timeline. Used for status line information only.
     double total_avsync_change;
+    // --av-sync-resample: audio is resampled to follow the video timer, as
+    // long as the A/V difference is small. audio_speed_correction is the
+    // current factor (1 = none); the integral is the controller state.
+    bool av_resample_active;
+    double audio_speed_correction;
+    double av_resample_integral;
     // Total number of dropped frames that were "approved" to be dropped.
     // Actual dropping depends on --framedrop and decoder internals.
     int drop_frame_cnt;
@@ -296,6 +330,14 @@ typedef struct MPContext {
     uint64_t vo_pts_history_seek_ts;
     uint64_t backstep_start_seek_ts;
     bool backstep_active;
+    // Recently decoded frames in display order (oldest first), limited by
+    // --backstep-cache-size. Frame stepping within them needs no decoding.
+    struct mp_image **backstep_frames;
+    int num_backstep_frames;
+    size_t backstep_frames_size;
+    // Number of frames the displayed frame is behind the newest cached frame.
+    // If this is not 0, the decoder is ahead of the displayed frame.
+    int backstep_offset;
 
     double audio_delay;
 
@@ -303,7 +345,9 @@ typedef struct MPContext {
     double last_idle_tick;
     double next_cache_update;
 
-    double sleeptime;      // number of seconds to sleep before next iteration
+    // Number of seconds to sleep before next iteration. Every handler that has
+    // a deadline lowers it; INFINITY means wait for the next wakeup.
+    double sleeptime;
 
     double mouse_timer;
     unsigned int mouse_event_ts;
@@ -324,6 +368,12 @@ typedef struct MPContext {
         int exact;  // -1 = disable, 0 = default, 1 = enable
         bool immediate; // disable seek delay logic
     } seek;
+    // Seek scrubbing (--seek-scrub). last_seek_request is the time of the
+    // last seek request, scrub_seek is the final seek done once they stop.
+    double last_seek_request;
+    bool scrub_burst;
+    bool scrubbing;
+    struct seek_params scrub_seek;
 
     /* Heuristic for relative chapter seeks: keep track which chapter
      * the user wanted to go to, even if we aren't exactly within the
@@ -338,6 +388,20 @@ typedef struct MPContext {
     struct ass_renderer *ass_renderer;
     struct ass_library *ass_library;
     struct mp_log *ass_log;
+    // The renderer is also kept across files, unless embedded fonts were
+    // added to the library, or the default font changed.
+    bool ass_fonts_added;
+    char *ass_renderer_font;
+
+    struct mp_subfile_cache *subfile_cache;
+
+    // Initialization trace (see mp_mark_startup())
+    struct startup_phase {
+        const char *name;
+        double time;        // mp_time_sec() at the end of the phase
+    } *startup_phases;
+    int num_startup_phases;
+    double startup_time;    // mp_time_sec() when mpctx was created
 
     int last_dvb_step;
 
@@ -350,14 +414,19 @@ typedef struct MPContext {
 
     bool paused_for_cache;
     double cache_stop_time, cache_wait_time;
+    int64_t cache_readahead;    // last STREAM_CTRL_SET_READAHEAD value, or -1
 
     // Set after showing warning about decoding being too slow for realtime
     // playback rate. Used to avoid showing it multiple times.
     bool drop_message_shown;
 
     struct screenshot_ctx *screenshot_ctx;
+    struct watch_later_writer *watch_later_writer;
     struct command_ctx *command_ctx;
     struct encode_lavc_context *encode_lavc_ctx;
+    // --orendition outputs; fed by wall_outputs entries
+    struct encode_lavc_context **encode_renditions;
+    int num_encode_renditions;
     struct mp_nav_state *nav_state;
 } MPContext;
 
@@ -376,6 +445,7 @@ void mp_load_auto_profiles(struct MPContext *mpctx);
 void mp_get_resume_defaults(struct MPContext *mpctx);
 void mp_load_playback_resume(struct MPContext *mpctx, const char *file);
 void mp_write_watch_later_conf(struct MPContext *mpctx);
+void mp_uninit_watch_later(struct MPContext *mpctx);
 struct playlist_entry *mp_check_playlist_resume(struct MPContext *mpctx,
                                                 struct playlist *playlist);
 
@@ -400,6 +470,8 @@ void mp_mark_user_track_selection(struct MPContext *mpctx, int order,
 struct track *mp_track_by_tid(struct MPContext *mpctx, enum stream_type type,
                               int tid);
 bool timeline_set_part(struct MPContext *mpctx, int i, bool force);
+void timeline_preload_part(struct MPContext *mpctx, int i, double pts,
+                           int flags);
 double timeline_set_from_time(struct MPContext *mpctx, double pts, bool *need_reset);
 void add_demuxer_tracks(struct MPContext *mpctx, struct demuxer *demuxer);
 bool mp_remove_track(struct MPContext *mpctx, struct track *track);
@@ -408,6 +480,8 @@ struct playlist_entry *mp_next_file(struct MPContext *mpctx, int direction,
 void mp_set_playlist_entry(struct MPContext *mpctx, struct playlist_entry *e);
 void mp_play_files(struct MPContext *mpctx);
 void update_demuxer_properties(struct MPContext *mpctx);
+void prefetch_next(struct MPContext *mpctx);
+void prefetch_cancel(struct MPContext *mpctx);
 
 // main.c
 int mpv_main(int argc, char *argv[]);
@@ -440,6 +514,9 @@ void get_current_osd_sym(struct MPContext *mpctx, char *buf, size_t buf_size);
 
 // playloop.c
 void mp_wait_events(struct MPContext *mpctx, double sleeptime);
+void mp_mark_startup(struct MPContext *mpctx, const char *name);
+char *mp_format_startup_timings(void *ta_parent, struct MPContext *mpctx);
+char *mp_format_alloc_profile(void *ta_parent, int max_sites);
 void mp_process_input(struct MPContext *mpctx);
 void reset_playback_state(struct MPContext *mpctx);
 void pause_player(struct MPContext *mpctx);
@@ -489,9 +566,14 @@ void build_cue_timeline(struct MPContext *mpctx);
 // video.c
 void reset_video_state(struct MPContext *mpctx);
 int reinit_video_chain(struct MPContext *mpctx);
+void uninit_video_decoder(struct MPContext *mpctx);
 int reinit_video_filters(struct MPContext *mpctx);
 void write_video(struct MPContext *mpctx, double endpts);
+int video_step_cached_frame(struct MPContext *mpctx, int dir);
 void mp_force_video_refresh(struct MPContext *mpctx);
+void init_video_wall(struct MPContext *mpctx);
+void uninit_video_wall(struct MPContext *mpctx);
+void video_wall_set_paused(struct MPContext *mpctx, bool paused);
 void update_fps(struct MPContext *mpctx);
 
 #endif /* MPLAYER_MP_CORE_H */
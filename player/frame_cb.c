@@ -0,0 +1,186 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+#include "video/sws_utils.h"
+
+#include "client.h"
+
+#include "libmpv/frame_cb.h"
+
+/*
+ * The context is created by the client API (once per core). Settings are
+ * changed by API users, while frames are delivered on the playback thread.
+ */
+
+struct mpv_frame_cb_context {
+    struct mp_log *log;
+
+    pthread_mutex_t lock;
+
+    // --- Protected by lock
+    mpv_frame_cb_fn cb;
+    void *cb_ctx;
+    int imgfmt;                 // 0: pass frames as they are
+    double min_interval;        // 1/max_fps, or 0
+    bool reset;                 // settings changed
+
+    // --- Accessed by the playback thread only
+    struct mp_sws_context *sws;
+    double last_pts;
+    bool warned_hwaccel;
+};
+
+// The mpv_frame must be the first member, so that mpv_frame_free() can get
+// the wrapper from the pointer passed to the API user.
+struct frame_priv {
+    mpv_frame frame;
+    struct mp_image *img;
+    char format[16];
+};
+
+static void free_ctx(void *ptr)
+{
+    struct mpv_frame_cb_context *ctx = ptr;
+    pthread_mutex_destroy(&ctx->lock);
+}
+
+struct mpv_frame_cb_context *mp_frame_cb_create(void *talloc_ctx,
+                                                struct mpv_global *g)
+{
+    struct mpv_frame_cb_context *ctx =
+        talloc_zero(talloc_ctx, struct mpv_frame_cb_context);
+    talloc_set_destructor(ctx, free_ctx);
+    pthread_mutex_init(&ctx->lock, NULL);
+
+    ctx->log = mp_log_new(ctx, g->log, "frame-cb");
+    ctx->sws = mp_sws_alloc(ctx);
+    ctx->sws->log = ctx->log;
+    ctx->last_pts = MP_NOPTS_VALUE;
+
+    return ctx;
+}
+
+int mpv_frame_cb_set_callback(mpv_frame_cb_context *ctx, const char *format,
+                              double max_fps, mpv_frame_cb_fn callback,
+                              void *callback_ctx)
+{
+    int imgfmt = 0;
+    if (format && format[0]) {
+        imgfmt = mp_imgfmt_from_name(bstr0(format), false);
+        if (!imgfmt || !mp_sws_supported_format(imgfmt))
+            return MPV_ERROR_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->cb = callback;
+    ctx->cb_ctx = callback_ctx;
+    ctx->imgfmt = imgfmt;
+    ctx->min_interval = max_fps > 0 ? 1.0 / max_fps : 0;
+    ctx->reset = true;
+    pthread_mutex_unlock(&ctx->lock);
+
+    return 0;
+}
+
+void mpv_frame_free(mpv_frame *frame)
+{
+    talloc_free(frame);
+}
+
+// Return whether a frame with the given pts should be skipped because of the
+// rate limit.
+static bool skip_frame(struct mpv_frame_cb_context *ctx, double interval,
+                       double pts)
+{
+    if (interval <= 0 || pts == MP_NOPTS_VALUE ||
+        ctx->last_pts == MP_NOPTS_VALUE)
+        return false;
+    // Going backwards means a seek happened.
+    if (pts < ctx->last_pts)
+        return false;
+    // Allow some jitter, so that e.g. max_fps=25 doesn't halve 25 fps video.
+    return pts - ctx->last_pts < interval * 0.9;
+}
+
+// Called by the playback thread for each frame that is about to be queued
+// to the VO. img is not modified or freed.
+void mp_frame_cb_deliver(struct mpv_frame_cb_context *ctx, struct mp_image *img)
+{
+    pthread_mutex_lock(&ctx->lock);
+    mpv_frame_cb_fn cb = ctx->cb;
+    void *cb_ctx = ctx->cb_ctx;
+    int imgfmt = ctx->imgfmt;
+    double interval = ctx->min_interval;
+    if (ctx->reset) {
+        ctx->last_pts = MP_NOPTS_VALUE;
+        ctx->warned_hwaccel = false;
+        ctx->reset = false;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (!cb || skip_frame(ctx, interval, img->pts))
+        return;
+
+    struct mp_image *out = NULL;
+    if (!imgfmt || imgfmt == img->imgfmt) {
+        out = mp_image_new_ref(img);
+    } else if (IMGFMT_IS_HWACCEL(img->imgfmt)) {
+        if (!ctx->warned_hwaccel)
+            MP_WARN(ctx, "Can't convert hardware decoded frames.\n");
+        ctx->warned_hwaccel = true;
+        return;
+    } else {
+        out = mp_image_alloc(imgfmt, img->w, img->h);
+        if (!out)
+            return;
+        mp_image_copy_attributes(out, img);
+        if (mp_sws_scale(ctx->sws, out, img) < 0) {
+            talloc_free(out);
+            return;
+        }
+    }
+
+    ctx->last_pts = img->pts;
+
+    struct frame_priv *priv = talloc_zero(NULL, struct frame_priv);
+    priv->img = talloc_steal(priv, out);
+    mp_imgfmt_to_name_buf(priv->format, sizeof(priv->format), out->imgfmt);
+    priv->frame = (mpv_frame) {
+        .format = priv->format,
+        .w = out->w,
+        .h = out->h,
+        .num_planes = out->num_planes,
+        .pts = out->pts,
+    };
+    for (int n = 0; n < 4; n++) {
+        priv->frame.planes[n] = out->planes[n];
+        priv->frame.stride[n] = out->stride[n];
+    }
+
+    cb(cb_ctx, &priv->frame);
+}
@@ -21,6 +21,7 @@
 #include <strings.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include <libavutil/avutil.h>
 
@@ -32,6 +33,7 @@
 #include "osdep/timer.h"
 
 #include "common/msg.h"
+#include "common/global.h"
 #include "options/path.h"
 #include "options/m_config.h"
 #include "options/parse_configfile.h"
@@ -62,6 +64,18 @@
 
 static void reselect_demux_streams(struct MPContext *mpctx);
 
+static void uninit_sub_renderer(struct MPContext *mpctx)
+{
+#if HAVE_LIBASS
+    if (mpctx->ass_renderer)
+        ass_renderer_done(mpctx->ass_renderer);
+    mpctx->ass_renderer = NULL;
+    if (mpctx->ass_fonts_added)
+        ass_clear_fonts(mpctx->ass_library);
+    mpctx->ass_fonts_added = false;
+#endif
+}
+
 static void uninit_sub(struct MPContext *mpctx, int order)
 {
     mpctx->d_sub[order] = NULL; // Note: not free'd.
@@ -102,19 +116,17 @@ void uninit_player(struct MPContext *mpctx, unsigned int mask)
     if (mask & INITIALIZED_LIBASS) {
         mpctx->initialized_flags &= ~INITIALIZED_LIBASS;
 #if HAVE_LIBASS
-        if (mpctx->ass_renderer)
-            ass_renderer_done(mpctx->ass_renderer);
-        mpctx->ass_renderer = NULL;
-        ass_clear_fonts(mpctx->ass_library);
+        // Without embedded fonts, the renderer's font setup is still valid
+        // for the next file; keep it to avoid rescanning the system fonts.
+        if (mpctx->ass_fonts_added)
+            uninit_sub_renderer(mpctx);
 #endif
     }
 
     if (mask & INITIALIZED_VCODEC) {
         mpctx->initialized_flags &= ~INITIALIZED_VCODEC;
         reset_video_state(mpctx);
-        if (mpctx->d_video)
-            video_uninit(mpctx->d_video);
-        mpctx->d_video = NULL;
+        uninit_video_decoder(mpctx);
         mpctx->video_status = STATUS_EOF;
         mpctx->sync_audio_to_video = false;
         reselect_demux_streams(mpctx);
@@ -136,6 +148,9 @@ void uninit_player(struct MPContext *mpctx, unsigned int mask)
         assert(!mpctx->d_video && !mpctx->d_audio &&
                !mpctx->d_sub[0] && !mpctx->d_sub[1]);
         mpctx->master_demuxer = NULL;
+        if (mpctx->timeline_preload)
+            demux_stop_thread(mpctx->timeline_preload->source);
+        mpctx->timeline_preload = NULL;
         for (int i = 0; i < mpctx->num_sources; i++) {
             uninit_subs(mpctx->sources[i]);
             struct demuxer *demuxer = mpctx->sources[i];
@@ -148,6 +163,9 @@ void uninit_player(struct MPContext *mpctx, unsigned int mask)
         mpctx->sources = NULL;
         mpctx->demuxer = NULL;
         mpctx->num_sources = 0;
+        talloc_free(mpctx->source_caches);
+        mpctx->source_caches = NULL;
+        mpctx->num_source_caches = 0;
         talloc_free(mpctx->timeline);
         mpctx->timeline = NULL;
         mpctx->num_timeline_parts = 0;
@@ -167,8 +185,13 @@ void uninit_player(struct MPContext *mpctx, unsigned int mask)
 
     if (mask & INITIALIZED_VO) {
         mpctx->initialized_flags &= ~INITIALIZED_VO;
+        // A detached decoder still references the VO.
+        if (mpctx->detached_d_video)
+            video_uninit(mpctx->detached_d_video);
+        mpctx->detached_d_video = NULL;
         vo_destroy(mpctx->video_out);
         mpctx->video_out = NULL;
+        uninit_video_wall(mpctx);
     }
 
     if (mask & INITIALIZED_AO) {
@@ -272,7 +295,8 @@ static bool need_init_seek(struct demuxer *demux)
     for (int n = 0; n < demux->num_streams; n++) {
         struct sh_stream *stream = demux->streams[n];
         // Subtitle streams are not properly interleaved -> force init. seek.
-        if (stream->type != STREAM_SUB && demux_stream_is_selected(stream))
+        if (stream->type != STREAM_SUB && demux_stream_is_selected(stream) &&
+            !demux_stream_is_buffered(stream))
             return false;
     }
     return true;
@@ -334,6 +358,126 @@ static void enable_demux_thread(struct MPContext *mpctx)
     }
 }
 
+struct source_cache {
+    int64_t size;           // original cache size, or -1 if no cache
+    uint64_t last_use;
+    bool shrunk;
+};
+
+// Every timeline source has its own cache. Keep only the caches of the
+// --timeline-cached-sources most recently used sources at their full size,
+// and reduce the others to the minimum, so that long timelines don't hold
+// a full cache for every file.
+static void update_source_caches(struct MPContext *mpctx,
+                                 struct demuxer *active)
+{
+    int max_cached = mpctx->opts->timeline_cached_sources;
+    if (max_cached < 1 || mpctx->num_timeline_parts <= max_cached)
+        return;
+
+    if (!mpctx->source_caches) {
+        // External files added later are not included (n >= num_caches).
+        mpctx->num_source_caches = mpctx->num_sources;
+        mpctx->source_caches = talloc_array(NULL, struct source_cache,
+                                            mpctx->num_source_caches);
+        for (int n = 0; n < mpctx->num_source_caches; n++) {
+            struct source_cache *c = &mpctx->source_caches[n];
+            *c = (struct source_cache){.size = -1};
+            bool in_timeline = false;
+            for (int i = 0; i < mpctx->num_timeline_parts; i++)
+                in_timeline |= mpctx->timeline[i].source == mpctx->sources[n];
+            if (in_timeline) {
+                demux_stream_control(mpctx->sources[n],
+                                     STREAM_CTRL_GET_CACHE_SIZE, &c->size);
+            }
+        }
+    }
+
+    int num_cached = 0;
+    for (int n = 0; n < mpctx->num_source_caches; n++) {
+        struct source_cache *c = &mpctx->source_caches[n];
+        if (mpctx->sources[n] == active) {
+            c->last_use = ++mpctx->source_use_counter;
+            if (c->shrunk) {
+                MP_VERBOSE(mpctx, "Restoring cache of %s\n",
+                           mpctx->sources[n]->filename);
+                demux_stream_control(active, STREAM_CTRL_SET_CACHE_SIZE,
+                                     &c->size);
+                c->shrunk = false;
+            }
+        }
+        num_cached += c->size > 0 && !c->shrunk;
+    }
+
+    while (num_cached > max_cached) {
+        struct source_cache *lru = NULL;
+        int lru_index = -1;
+        for (int n = 0; n < mpctx->num_source_caches; n++) {
+            struct source_cache *c = &mpctx->source_caches[n];
+            if (c->size > 0 && !c->shrunk && mpctx->sources[n] != active &&
+                (!lru || c->last_use < lru->last_use))
+            {
+                lru = c;
+                lru_index = n;
+            }
+        }
+        if (!lru)
+            break;
+        MP_VERBOSE(mpctx, "Shrinking cache of %s\n",
+                   mpctx->sources[lru_index]->filename);
+        int64_t size = 0; // the cache uses its minimum size
+        demux_stream_control(mpctx->sources[lru_index],
+                             STREAM_CTRL_SET_CACHE_SIZE, &size);
+        lru->shrunk = true;
+        num_cached--;
+    }
+}
+
+static struct sh_stream *timeline_track_stream(struct track *track,
+                                               struct demuxer *d)
+{
+    struct sh_stream *stream =
+        demuxer_stream_by_demuxer_id(d, track->type, track->demuxer_id);
+    // EDL can have mismatched files in the same timeline
+    if (!stream)
+        stream = select_fallback_stream(d, track->type, track->user_tid - 1);
+    return stream;
+}
+
+// Seek the source of part i to pts, and let it start reading ahead while the
+// current part is still playing. If mp_seek() later switches to this part
+// with the same seek parameters, it skips its own seek, and the buffered
+// packets are used directly.
+void timeline_preload_part(struct MPContext *mpctx, int i, double pts,
+                           int flags)
+{
+    struct timeline_part *n = mpctx->timeline + i;
+    struct demuxer *d = n->source;
+    if (d == mpctx->demuxer || !d->seekable)
+        return;
+
+    MP_VERBOSE(mpctx, "Preloading timeline part %d from %s.\n", i, d->filename);
+
+    // Select the same streams that timeline_set_part() will select, so that
+    // the switch doesn't flush the packets read until then.
+    for (int x = 0; x < mpctx->num_tracks; x++) {
+        struct track *track = mpctx->tracks[x];
+        if (track->under_timeline) {
+            struct sh_stream *stream = timeline_track_stream(track, d);
+            if (stream)
+                demuxer_select_track(d, stream, track->selected);
+        }
+    }
+
+    demux_seek(d, pts, flags);
+    if (mpctx->opts->demuxer_thread)
+        demux_start_thread(d);
+
+    mpctx->timeline_preload = n;
+    mpctx->timeline_preload_pts = pts;
+    mpctx->timeline_preload_flags = flags;
+}
+
 bool timeline_set_part(struct MPContext *mpctx, int i, bool force)
 {
     struct timeline_part *p = mpctx->timeline + mpctx->timeline_part;
@@ -353,24 +497,25 @@ bool timeline_set_part(struct MPContext *mpctx, int i, bool force)
         demux_flush(mpctx->demuxer);
     }
 
+    // A preloaded source that is not going to be played.
+    struct timeline_part *pre = mpctx->timeline_preload;
+    if (pre && pre->source != n->source) {
+        demux_stop_thread(pre->source);
+        mpctx->timeline_preload = NULL;
+    }
+
     mpctx->demuxer = n->source;
     mpctx->stream = mpctx->demuxer->stream;
 
+    update_source_caches(mpctx, mpctx->demuxer);
+
     // While another timeline was active, the selection of active tracks might
     // have been changed - possibly we need to update this source.
     for (int x = 0; x < mpctx->num_tracks; x++) {
         struct track *track = mpctx->tracks[x];
         if (track->under_timeline) {
             track->demuxer = mpctx->demuxer;
-            track->stream = demuxer_stream_by_demuxer_id(track->demuxer,
-                                                         track->type,
-                                                         track->demuxer_id);
-            // EDL can have mismatched files in the same timeline
-            if (!track->stream) {
-                track->stream = select_fallback_stream(track->demuxer,
-                                                       track->type,
-                                                       track->user_tid - 1);
-            }
+            track->stream = timeline_track_stream(track, track->demuxer);
         }
     }
     reselect_demux_streams(mpctx);
@@ -489,10 +634,17 @@ static bool compare_track(struct track *t1, struct track *t2, char **langs,
         return t1->default_track;
     if (t1->attached_picture != t2->attached_picture)
         return !t1->attached_picture;
-    if (t1->stream && t2->stream && opts->hls_bitrate) {
-        int d = t1->stream->hls_bitrate - t2->stream->hls_bitrate;
-        if (d)
-            return opts->hls_bitrate == 1 ? d < 0 : d > 0;
+    if (t1->stream && t2->stream && opts->hls_bitrate >= 0 &&
+        t1->stream->hls_bitrate != t2->stream->hls_bitrate)
+    {
+        // Prefer the highest bitrate within the limit, else the lowest.
+        bool t1_ok = t1->stream->hls_bitrate <= opts->hls_bitrate;
+        bool t2_ok = t2->stream->hls_bitrate <= opts->hls_bitrate;
+        if (t1_ok != t2_ok)
+            return t1_ok;
+        if (t1_ok)
+            return t1->stream->hls_bitrate > t2->stream->hls_bitrate;
+        return t1->stream->hls_bitrate < t2->stream->hls_bitrate;
     }
     return t1->user_tid <= t2->user_tid;
 }
@@ -709,7 +861,10 @@ static void open_subtitles_from_options(struct MPContext *mpctx)
                                      &stream_filename) > 0)
                 base_filename = talloc_steal(tmp, stream_filename);
         }
-        struct subfn *list = find_text_subtitles(mpctx->global, base_filename);
+        if (!mpctx->subfile_cache)
+            mpctx->subfile_cache = mp_subfile_cache_new(mpctx);
+        struct subfn *list = find_text_subtitles(mpctx->global, base_filename,
+                                                 mpctx->subfile_cache);
         talloc_steal(tmp, list);
         for (int i = 0; list && list[i].fname; i++) {
             char *filename = list[i].fname;
@@ -772,6 +927,12 @@ static struct track *open_external_file(struct MPContext *mpctx, char *filename,
                 disp_filename);
         goto err_out;
     }
+    // Read external audio in its own thread, so that a slow source doesn't
+    // stall playback. (Subtitle files are preloaded completely instead.)
+    if (filter != STREAM_SUB && opts->demuxer_thread) {
+        demux_set_wakeup_cb(demuxer, wakeup_demux, mpctx);
+        demux_start_thread(demuxer);
+    }
     MP_TARRAY_APPEND(NULL, mpctx->sources, mpctx->num_sources, demuxer);
     return first;
 
@@ -861,8 +1022,13 @@ static void add_subtitle_fonts_from_sources(struct MPContext *mpctx)
                 if (mpctx->opts->use_embedded_fonts &&
                     attachment_is_font(mpctx->log, att))
                 {
+                    // A renderer created before this wouldn't see the font.
+                    if (mpctx->ass_renderer)
+                        ass_renderer_done(mpctx->ass_renderer);
+                    mpctx->ass_renderer = NULL;
                     ass_add_font(mpctx->ass_library, att->name, att->data,
                                  att->data_size);
+                    mpctx->ass_fonts_added = true;
                 }
             }
         }
@@ -874,27 +1040,34 @@ static void init_sub_renderer(struct MPContext *mpctx)
 {
 #if HAVE_LIBASS
     assert(!(mpctx->initialized_flags & INITIALIZED_LIBASS));
-    assert(!mpctx->ass_renderer);
 
-    mpctx->ass_renderer = ass_renderer_init(mpctx->ass_library);
-    if (mpctx->ass_renderer) {
-        mp_ass_configure_fonts(mpctx->ass_renderer, mpctx->opts->sub_text_style,
-                               mpctx->global, mpctx->ass_log);
+    char *font = mpctx->opts->sub_text_style->font;
+    if (mpctx->ass_renderer && !bstr_equals0(bstr0(mpctx->ass_renderer_font),
+                                             font ? font : ""))
+        uninit_sub_renderer(mpctx);
+
+    if (!mpctx->ass_renderer) {
+        mpctx->ass_renderer = ass_renderer_init(mpctx->ass_library);
+        if (mpctx->ass_renderer) {
+            mp_ass_configure_fonts(mpctx->ass_renderer,
+                                   mpctx->opts->sub_text_style,
+                                   mpctx->global, mpctx->ass_log);
+        }
+        talloc_free(mpctx->ass_renderer_font);
+        mpctx->ass_renderer_font = talloc_strdup(mpctx, font ? font : "");
+    } else {
+        MP_VERBOSE(mpctx, "Reusing subtitle renderer.\n");
     }
     mpctx->initialized_flags |= INITIALIZED_LIBASS;
 #endif
 }
 
-static struct mp_resolve_result *resolve_url(const char *filename,
-                                             struct mpv_global *global)
+static struct mp_resolve_result *resolve_url(struct mp_resolve_cache *cache,
+                                             const char *filename)
 {
     if (!mp_is_url(bstr0(filename)))
         return NULL;
-#if HAVE_LIBQUVI
-    return mp_resolve_quvi(filename, global);
-#else
-    return NULL;
-#endif
+    return mp_resolve_cached(cache, filename);
 }
 
 static void print_resolve_contents(struct mp_log *log,
@@ -995,6 +1168,150 @@ static void load_per_file_options(m_config_t *conf,
     }
 }
 
+struct prefetch {
+    struct mpv_global *global;
+    struct mp_log *log;
+    struct playlist_entry *entry; // only for comparison (may be freed)
+    char *filename;
+    int stream_flags;
+    struct mp_resolve_cache *resolve_cache;
+    struct mp_cancel *cancel;
+    // Copies of the options used, as mpctx->opts can change meanwhile.
+    struct mp_cache_opts cache_opts;
+    char *demuxer_name;
+    pthread_t thread;
+    // Set by the prefetch thread
+    char *stream_filename;  // resolved URL, or filename
+    struct stream *stream;
+    struct demuxer *demuxer;
+};
+
+static void *prefetch_thread(void *arg)
+{
+    struct prefetch *p = arg;
+
+    // The result is cached, so play_current_file() gets the same URL.
+    p->stream_filename = p->filename;
+    struct mp_resolve_result *res = resolve_url(p->resolve_cache, p->filename);
+    if (res) {
+        bool ok = res->url && !res->playlist;
+        if (ok)
+            p->stream_filename = talloc_strdup(p, res->url);
+        talloc_free(res);
+        if (!ok)
+            return NULL;
+    }
+
+    struct stream *stream = stream_create(p->stream_filename, p->stream_flags,
+                                          p->cancel, p->global);
+    if (!stream)
+        return NULL;
+    // Plain local files are opened too: probing the file format can take
+    // longer than the audio the AO still has queued, which would cause a
+    // gap with --gapless-audio. Other local streams might need special
+    // handling (such as mp_nav_init()), so leave them to play_current_file().
+    if (!stream->is_network && strcmp(stream->info->name, "file") != 0) {
+        free_stream(stream);
+        return NULL;
+    }
+    stream_enable_cache(&stream, &p->cache_opts);
+    struct demuxer *demuxer = demux_open(stream, p->demuxer_name, NULL,
+                                         p->global);
+    if (!demuxer) {
+        free_stream(stream);
+        return NULL;
+    }
+    p->stream = stream;
+    p->demuxer = demuxer;
+    return NULL;
+}
+
+// Start opening the next playlist entry in a separate thread.
+void prefetch_next(struct MPContext *mpctx)
+{
+    struct MPOpts *opts = mpctx->opts;
+    if (mpctx->prefetch)
+        return;
+    // (mp_next_file() has side effects on looping, so don't use it.)
+    struct playlist_entry *e = playlist_get_next(mpctx->playlist, 1);
+    // Per-file options could change how the file would be opened.
+    if (!e || !e->filename || e->num_params)
+        return;
+
+    struct prefetch *p = talloc_zero(NULL, struct prefetch);
+    *p = (struct prefetch){
+        .global = mpctx->global,
+        .log = mp_log_new(p, mpctx->log, "prefetch"),
+        .entry = e,
+        .filename = talloc_strdup(p, e->filename),
+        .stream_flags = STREAM_READ |
+                        (opts->load_unsafe_playlists ? 0 : e->stream_flags),
+        .cancel = mp_cancel_new_linkable(p, mpctx->playback_abort),
+        .resolve_cache = mpctx->resolve_cache,
+        .cache_opts = opts->stream_cache,
+        .demuxer_name = talloc_strdup(p, opts->demuxer_name),
+    };
+    p->cache_opts.file = talloc_strdup(p, p->cache_opts.file);
+    p->cache_opts.dir = talloc_strdup(p, p->cache_opts.dir);
+    MP_VERBOSE(p, "Opening %s\n", p->filename);
+    if (pthread_create(&p->thread, NULL, prefetch_thread, p)) {
+        talloc_free(p);
+        return;
+    }
+    mpctx->prefetch = p;
+}
+
+static void free_prefetch(struct prefetch *p)
+{
+    if (p->demuxer)
+        free_demuxer(p->demuxer);
+    if (p->stream)
+        free_stream(p->stream);
+    talloc_free(p);
+}
+
+// Abort and discard the prefetched entry (if any).
+void prefetch_cancel(struct MPContext *mpctx)
+{
+    struct prefetch *p = mpctx->prefetch;
+    if (!p)
+        return;
+    mp_cancel_trigger(p->cancel);
+    pthread_join(p->thread, NULL);
+    free_prefetch(p);
+    mpctx->prefetch = NULL;
+}
+
+// If the given file was prefetched, set mpctx->stream and mpctx->demuxer to
+// the prefetched instances, and return true.
+static bool use_prefetch(struct MPContext *mpctx, const char *filename,
+                         int stream_flags)
+{
+    struct prefetch *p = mpctx->prefetch;
+    if (!p)
+        return false;
+    if (p->entry != mpctx->playing || p->stream_flags != stream_flags ||
+        mpctx->playing->num_params)
+    {
+        prefetch_cancel(mpctx);
+        return false;
+    }
+    pthread_join(p->thread, NULL);
+    mpctx->prefetch = NULL;
+    if (!p->demuxer || strcmp(p->stream_filename, filename) != 0) {
+        free_prefetch(p);
+        return false;
+    }
+    MP_VERBOSE(mpctx, "Using prefetched stream.\n");
+    mpctx->stream = p->stream;
+    mpctx->demuxer = p->demuxer;
+    // Aborting the playback must abort the prefetched stream as well.
+    talloc_steal(mpctx->stream, p->cancel);
+    mp_cancel_link(p->cancel);
+    talloc_free(p);
+    return true;
+}
+
 // Start playing the current playlist entry.
 // Handle initialization and deinitialization.
 static void play_current_file(struct MPContext *mpctx)
@@ -1017,12 +1334,14 @@ static void play_current_file(struct MPContext *mpctx)
     mpctx->last_chapter = -2;
     mpctx->paused = false;
     mpctx->paused_for_cache = false;
+    mpctx->cache_readahead = -1;
     mpctx->playing_msg_shown = false;
     mpctx->step_frames = 0;
     mpctx->backstep_active = false;
     mpctx->audio_delay = 0;
     mpctx->max_frames = -1;
     mpctx->seek = (struct seek_params){ 0 };
+    mpctx->scrubbing = false;
 
     reset_playback_state(mpctx);
 
@@ -1074,7 +1393,7 @@ static void play_current_file(struct MPContext *mpctx)
     assert(mpctx->d_sub[1] == NULL);
 
     char *stream_filename = mpctx->filename;
-    mpctx->resolve_result = resolve_url(stream_filename, mpctx->global);
+    mpctx->resolve_result = resolve_url(mpctx->resolve_cache, stream_filename);
     if (mpctx->resolve_result) {
         talloc_steal(tmp, mpctx->resolve_result);
         print_resolve_contents(mpctx->log, mpctx->resolve_result);
@@ -1087,6 +1406,14 @@ static void play_current_file(struct MPContext *mpctx)
     int stream_flags = STREAM_READ;
     if (!opts->load_unsafe_playlists)
         stream_flags |= mpctx->playing->stream_flags;
+    bool prefetched = !(opts->stream_dump && opts->stream_dump[0]) &&
+                      use_prefetch(mpctx, stream_filename, stream_flags);
+    if (prefetched) {
+        mpctx->initialized_flags |= INITIALIZED_STREAM;
+        stream_set_capture_file(mpctx->stream, opts->stream_capture);
+        goto prefetched_demuxer;
+    }
+    prefetch_cancel(mpctx);
     mpctx->stream = stream_create(stream_filename, stream_flags,
                                   mpctx->playback_abort, mpctx->global);
     if (!mpctx->stream) { // error...
@@ -1119,6 +1446,7 @@ goto_reopen_demuxer: ;
 
     mpctx->demuxer = demux_open(mpctx->stream, opts->demuxer_name, NULL,
                                 mpctx->global);
+prefetched_demuxer:
     mpctx->master_demuxer = mpctx->demuxer;
     if (!mpctx->demuxer) {
         MP_ERR(mpctx, "Failed to recognize file format.\n");
@@ -1140,6 +1468,13 @@ goto_reopen_demuxer: ;
         goto terminate_playback;
     }
 
+    // The demuxer was probed while the cache was filling; now wait for the
+    // rest of the initial fill (if any).
+    demux_stream_control(mpctx->demuxer, STREAM_CTRL_WAIT_CACHE_INITIAL, NULL);
+    mp_process_input(mpctx);
+    if (mpctx->stop_play)
+        goto terminate_playback;
+
     if (mpctx->demuxer->matroska_data.ordered_chapters)
         build_ordered_chapter_timeline(mpctx);
 
@@ -1228,6 +1563,12 @@ goto_reopen_demuxer: ;
         encode_lavc_set_metadata(mpctx->encode_lavc_ctx,
                                  mpctx->demuxer->metadata);
     }
+    for (int n = 0; n < mpctx->num_encode_renditions; n++) {
+        struct encode_lavc_context *ctx = mpctx->encode_renditions[n];
+        if (mpctx->current_track[0][STREAM_VIDEO])
+            encode_lavc_expect_stream(ctx, AVMEDIA_TYPE_VIDEO);
+        encode_lavc_set_metadata(ctx, mpctx->demuxer->metadata);
+    }
 #endif
 
     reinit_video_chain(mpctx);
@@ -1279,6 +1620,12 @@ goto_reopen_demuxer: ;
     mpctx->initialized_flags |= INITIALIZED_PLAYBACK;
     mp_notify(mpctx, MPV_EVENT_FILE_LOADED, NULL);
 
+    // Scraping web video URLs is slow, so resolve the next one right away.
+    struct playlist_entry *next = playlist_get_next(mpctx->playlist, 1);
+    if (opts->quvi_prefetch && next && next->filename &&
+        mp_is_url(bstr0(next->filename)))
+        mp_resolve_cache_prefetch(mpctx->resolve_cache, next->filename);
+
     playback_start = mp_time_sec();
     mpctx->error_playing = false;
     while (!mpctx->stop_play)
@@ -75,6 +75,7 @@ struct script_ctx {
     struct mpv_handle *client;
     struct MPContext *mpctx;
     int suspended;
+    void *scratch; // arena for temporary data of a single API call
 };
 
 #if LUA_VERSION_NUM <= 501
@@ -104,6 +105,43 @@ static struct MPContext *get_mpctx(lua_State *L)
     return get_ctx(L)->mpctx;
 }
 
+// Property reads are cached until the script goes back to its event loop
+// (or changes something itself), so that e.g. the OSC reading the same
+// properties many times while rendering doesn't go through the core each time.
+// Only scalar values are cached; tables could be modified by the script.
+static void clear_prop_cache(lua_State *L)
+{
+    lua_newtable(L); // cache
+    lua_setfield(L, LUA_REGISTRYINDEX, "PROP_CACHE"); // -
+}
+
+// Push the cached value and return true, or return false. kind selects the
+// accessor, because each converts to a different Lua type.
+static bool get_prop_cache(lua_State *L, char kind, const char *name)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, "PROP_CACHE"); // cache
+    lua_pushfstring(L, "%c%s", kind, name); // cache key
+    lua_rawget(L, -2); // cache value
+    lua_remove(L, -2); // value
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1); // -
+        return false;
+    }
+    return true;
+}
+
+// Cache the value at the top of the stack.
+static void set_prop_cache(lua_State *L, char kind, const char *name)
+{
+    if (lua_istable(L, -1))
+        return;
+    lua_getfield(L, LUA_REGISTRYINDEX, "PROP_CACHE"); // value cache
+    lua_pushfstring(L, "%c%s", kind, name); // value cache key
+    lua_pushvalue(L, -3); // value cache key value
+    lua_rawset(L, -3); // value cache
+    lua_pop(L, 1); // value
+}
+
 static int error_handler(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
@@ -251,6 +289,8 @@ static int run_lua(lua_State *L)
     lua_setfield(L, LUA_REGISTRYINDEX, "ARRAY"); // mp table
     lua_setfield(L, -2, "ARRAY"); // mp
 
+    clear_prop_cache(L);
+
     lua_pop(L, 1); // -
 
     assert(lua_gettop(L) == 0);
@@ -290,6 +330,7 @@ static int load_lua(struct mpv_handle *client, const char *fname)
         .log = mp_client_get_log(client),
         .filename = fname,
     };
+    ctx->scratch = talloc_new_arena(ctx, 0);
 
     lua_State *L = ctx->state = luaL_newstate();
     if (!L)
@@ -399,6 +440,8 @@ static int script_wait_event(lua_State *L)
 
     double timeout = luaL_optnumber(L, 1, 1e20);
 
+    clear_prop_cache(L);
+
     // This will almost surely lead to a deadlock. (Polling is still ok.)
     if (ctx->suspended && timeout > 0)
         luaL_error(L, "attempting to wait while core is suspended");
@@ -452,7 +495,8 @@ static int script_wait_event(lua_State *L)
         lua_setfield(L, -2, "args"); // event
         break;
     }
-    case MPV_EVENT_PROPERTY_CHANGE: {
+    case MPV_EVENT_PROPERTY_CHANGE:
+    case MPV_EVENT_GET_PROPERTY_REPLY: {
         mpv_event_property *prop = event->data;
         lua_pushstring(L, prop->name);
         lua_setfield(L, -2, "name");
@@ -512,6 +556,7 @@ static int script_enable_messages(lua_State *L)
 static int script_command(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
     const char *s = luaL_checkstring(L, 1);
 
     return check_error(L, mpv_command_string(ctx->client, s));
@@ -520,6 +565,7 @@ static int script_command(lua_State *L)
 static int script_commandv(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
     int num = lua_gettop(L);
     const char *args[50];
     if (num + 1 > MP_ARRAY_SIZE(args))
@@ -534,9 +580,29 @@ static int script_commandv(lua_State *L)
     return check_error(L, mpv_command(ctx->client, args));
 }
 
+static int script_raw_command_async(lua_State *L)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
+    uint64_t id = luaL_checknumber(L, 1);
+    int num = lua_gettop(L) - 1;
+    const char *args[50];
+    if (num + 1 > MP_ARRAY_SIZE(args))
+        luaL_error(L, "too many arguments");
+    for (int n = 0; n < num; n++) {
+        const char *s = lua_tostring(L, n + 2);
+        if (!s)
+            luaL_error(L, "argument %d is not a string", n + 1);
+        args[n] = s;
+    }
+    args[num] = NULL;
+    return check_error(L, mpv_command_async(ctx->client, id, args));
+}
+
 static int script_set_property(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
     const char *p = luaL_checkstring(L, 1);
     const char *v = luaL_checkstring(L, 2);
 
@@ -546,6 +612,7 @@ static int script_set_property(lua_State *L)
 static int script_set_property_bool(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
     const char *p = luaL_checkstring(L, 1);
     int v = lua_toboolean(L, 2);
 
@@ -561,6 +628,7 @@ static bool is_int(double d)
 static int script_set_property_number(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
     const char *p = luaL_checkstring(L, 1);
     double d = luaL_checknumber(L, 2);
     // If the number might be an integer, then set it as integer. The mpv core
@@ -668,7 +736,7 @@ static void makenode(void *tmp, mpv_node *dst, lua_State *L, int t)
                 MP_TARRAY_GROW(tmp, list->keys, list->num);
                 makenode(tmp, &list->values[list->num], L, -1);
                 if (lua_type(L, -2) != LUA_TSTRING) {
-                    talloc_free(tmp);
+                    talloc_free_children(tmp);
                     luaL_error(L, "key must be a string, but got %s",
                                lua_typename(L, -2));
                 }
@@ -681,7 +749,7 @@ static void makenode(void *tmp, mpv_node *dst, lua_State *L, int t)
     }
     default:
         // unknown type
-        talloc_free(tmp);
+        talloc_free_children(tmp);
         luaL_error(L, "disallowed Lua type found: %s\n", lua_typename(L, t));
     }
 }
@@ -689,12 +757,13 @@ static void makenode(void *tmp, mpv_node *dst, lua_State *L, int t)
 static int script_set_property_native(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
     const char *p = luaL_checkstring(L, 1);
     struct mpv_node node;
-    void *tmp = talloc_new(NULL);
+    void *tmp = ctx->scratch;
     makenode(tmp, &node, L, 2);
     int res = mpv_set_property(ctx->client, p, MPV_FORMAT_NODE, &node);
-    talloc_free(tmp);
+    talloc_free_children(tmp);
     return check_error(L, res);
 
 }
@@ -705,12 +774,16 @@ static int script_get_property(lua_State *L)
     const char *name = luaL_checkstring(L, 1);
     int type = lua_tointeger(L, lua_upvalueindex(1))
                ? MPV_FORMAT_OSD_STRING : MPV_FORMAT_STRING;
+    char kind = type == MPV_FORMAT_OSD_STRING ? 'o' : 's';
+    if (get_prop_cache(L, kind, name))
+        return 1;
 
     char *result = NULL;
     int err = mpv_get_property(ctx->client, name, type, &result);
     if (err >= 0) {
         lua_pushstring(L, result);
         talloc_free(result);
+        set_prop_cache(L, kind, name);
         return 1;
     } else {
         if (lua_isnoneornil(L, 2) && type == MPV_FORMAT_OSD_STRING) {
@@ -728,10 +801,14 @@ static int script_get_property_bool(lua_State *L)
     struct script_ctx *ctx = get_ctx(L);
     const char *name = luaL_checkstring(L, 1);
 
+    if (get_prop_cache(L, 'b', name))
+        return 1;
+
     int result = 0;
     int err = mpv_get_property(ctx->client, name, MPV_FORMAT_FLAG, &result);
     if (err >= 0) {
         lua_pushboolean(L, !!result);
+        set_prop_cache(L, 'b', name);
         return 1;
     } else {
         lua_pushvalue(L, 2);
@@ -745,11 +822,15 @@ static int script_get_property_number(lua_State *L)
     struct script_ctx *ctx = get_ctx(L);
     const char *name = luaL_checkstring(L, 1);
 
+    if (get_prop_cache(L, 'n', name))
+        return 1;
+
     // Note: the mpv core will (hopefully) convert INT64 to DOUBLE
     double result = 0;
     int err = mpv_get_property(ctx->client, name, MPV_FORMAT_DOUBLE, &result);
     if (err >= 0) {
         lua_pushnumber(L, result);
+        set_prop_cache(L, 'n', name);
         return 1;
     } else {
         lua_pushvalue(L, 2);
@@ -818,14 +899,19 @@ static int script_get_property_native(lua_State *L)
     struct script_ctx *ctx = get_ctx(L);
     const char *name = luaL_checkstring(L, 1);
 
+    if (get_prop_cache(L, 'N', name))
+        return 1;
+
     mpv_node node;
     int err = mpv_get_property(ctx->client, name, MPV_FORMAT_NODE, &node);
     const char *errstr = mpv_error_string(err);
     if (err >= 0) {
         bool ok = pushnode(L, &node, 50);
         mpv_free_node_contents(&node);
-        if (ok)
+        if (ok) {
+            set_prop_cache(L, 'N', name);
             return 1;
+        }
         errstr = "value too large";
     }
     lua_pushvalue(L, 2);
@@ -858,6 +944,32 @@ static int script_raw_observe_property(lua_State *L)
     return check_error(L, mpv_observe_property(ctx->client, id, name, format));
 }
 
+static int script_raw_get_property_async(lua_State *L)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    uint64_t id = luaL_checknumber(L, 1);
+    const char *name = luaL_checkstring(L, 2);
+    mpv_format format = check_property_format(L, 3);
+    if (format == MPV_FORMAT_NONE)
+        format = MPV_FORMAT_NODE;
+    return check_error(L, mpv_get_property_async(ctx->client, id, name, format));
+}
+
+static int script_raw_set_property_async(lua_State *L)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    clear_prop_cache(L);
+    uint64_t id = luaL_checknumber(L, 1);
+    const char *name = luaL_checkstring(L, 2);
+    struct mpv_node node;
+    void *tmp = ctx->scratch;
+    makenode(tmp, &node, L, 3);
+    int res = mpv_set_property_async(ctx->client, id, name, MPV_FORMAT_NODE,
+                                     &node);
+    talloc_free_children(tmp);
+    return check_error(L, res);
+}
+
 static int script_raw_unobserve_property(lua_State *L)
 {
     struct script_ctx *ctx = get_ctx(L);
@@ -1092,6 +1204,7 @@ static const struct fn_entry main_fns[] = {
     FN_ENTRY(find_config_file),
     FN_ENTRY(command),
     FN_ENTRY(commandv),
+    FN_ENTRY(raw_command_async),
     FN_ENTRY(get_property_bool),
     FN_ENTRY(get_property_number),
     FN_ENTRY(get_property_native),
@@ -1101,6 +1214,8 @@ static const struct fn_entry main_fns[] = {
     FN_ENTRY(set_property_native),
     FN_ENTRY(raw_observe_property),
     FN_ENTRY(raw_unobserve_property),
+    FN_ENTRY(raw_get_property_async),
+    FN_ENTRY(raw_set_property_async),
     FN_ENTRY(set_osd_ass),
     FN_ENTRY(get_osd_resolution),
     FN_ENTRY(get_screen_size),
@@ -277,6 +277,45 @@ local function property_change(ev)
     end
 end
 
+local async_id = 0
+local async_replies = {}
+
+local function async_request(cb)
+    async_id = async_id + 1
+    async_replies[async_id] = cb or false
+    return async_id
+end
+
+local function async_reply(ev)
+    local cb = async_replies[ev.id]
+    async_replies[ev.id] = nil
+    if cb then
+        cb(ev.error == nil, ev.data, ev.error)
+    end
+end
+
+local function async_check(id, res, err)
+    if not res then
+        async_replies[id] = nil
+    end
+    return res, err
+end
+
+function mp.commandv_async(cb, ...)
+    local id = async_request(cb)
+    return async_check(id, mp.raw_command_async(id, ...))
+end
+
+function mp.get_property_async(name, t, cb)
+    local id = async_request(cb)
+    return async_check(id, mp.raw_get_property_async(id, name, t))
+end
+
+function mp.set_property_async(name, value, cb)
+    local id = async_request(cb)
+    return async_check(id, mp.raw_set_property_async(id, name, value))
+end
+
 -- used by default event loop (mp_event_loop()) to decide when to quit
 mp.keep_running = true
 
@@ -323,6 +362,9 @@ mp.register_event("shutdown", function() mp.keep_running = false end)
 mp.register_event("script-input-dispatch", script_dispatch)
 mp.register_event("client-message", message_dispatch)
 mp.register_event("property-change", property_change)
+mp.register_event("command-reply", async_reply)
+mp.register_event("get-property-reply", async_reply)
+mp.register_event("set-property-reply", async_reply)
 
 mp.msg = {
     log = mp.log,
@@ -352,7 +394,9 @@ local function call_event_handlers(e)
     end
 end
 
-mp.use_suspend = true
+-- Suspending the core while handling events makes a slow script stall
+-- playback, so scripts have to opt in.
+mp.use_suspend = false
 
 function mp.dispatch_events(allow_wait)
     local more_events = true
@@ -244,7 +244,7 @@ function set_track(type, next)
         new_track_mpv = tracks_osc[type][new_track_osc].id
     end
 
-    mp.commandv("set", type, new_track_mpv)
+    mp.commandv_async(nil, "set", type, new_track_mpv)
 
         if (new_track_osc == 0) then
         show_message(nicetypes[type] .. " Track: none")
@@ -1004,7 +1004,7 @@ function osc_init()
     ne.content = "\238\132\144"
     ne.visible = have_pl
     ne.eventresponder["mouse_btn0_up"] =
-        function () mp.commandv("playlist_prev", "weak") end
+        function () mp.commandv_async(nil, "playlist_prev", "weak") end
     ne.eventresponder["shift+mouse_btn0_up"] =
         function () show_message(mp.get_property_osd("playlist"), 3) end
 
@@ -1014,7 +1014,7 @@ function osc_init()
     ne.content = "\238\132\129"
     ne.visible = have_pl
     ne.eventresponder["mouse_btn0_up"] =
-        function () mp.commandv("playlist_next", "weak") end
+        function () mp.commandv_async(nil, "playlist_next", "weak") end
     ne.eventresponder["shift+mouse_btn0_up"] =
         function () show_message(mp.get_property_osd("playlist"), 3) end
 
@@ -1032,7 +1032,7 @@ function osc_init()
         end
     end
     ne.eventresponder["mouse_btn0_up"] =
-        function () mp.commandv("cycle", "pause") end
+        function () mp.commandv_async(nil, "cycle", "pause") end
 
     --skipback
     ne = new_element("skipback", "button")
@@ -1040,11 +1040,11 @@ function osc_init()
     ne.softrepeat = true
     ne.content = "\238\128\132"
     ne.eventresponder["mouse_btn0_down"] =
-        function () mp.commandv("seek", -5, "relative", "keyframes") end
+        function () mp.commandv_async(nil, "seek", -5, "relative", "keyframes") end
     ne.eventresponder["shift+mouse_btn0_down"] =
-        function () mp.commandv("frame_back_step") end
+        function () mp.commandv_async(nil, "frame_back_step") end
     ne.eventresponder["mouse_btn2_down"] =
-        function () mp.commandv("seek", -30, "relative", "keyframes") end
+        function () mp.commandv_async(nil, "seek", -30, "relative", "keyframes") end
 
     --skipfrwd
     ne = new_element("skipfrwd", "button")
@@ -1052,11 +1052,11 @@ function osc_init()
     ne.softrepeat = true
     ne.content = "\238\128\133"
     ne.eventresponder["mouse_btn0_down"] =
-        function () mp.commandv("seek", 10, "relative", "keyframes") end
+        function () mp.commandv_async(nil, "seek", 10, "relative", "keyframes") end
     ne.eventresponder["shift+mouse_btn0_down"] =
-        function () mp.commandv("frame_step") end
+        function () mp.commandv_async(nil, "frame_step") end
     ne.eventresponder["mouse_btn2_down"] =
-        function () mp.commandv("seek", 60, "relative", "keyframes") end
+        function () mp.commandv_async(nil, "seek", 60, "relative", "keyframes") end
 
     --ch_prev
     ne = new_element("ch_prev", "button")
@@ -1064,7 +1064,7 @@ function osc_init()
     ne.enabled = have_ch
     ne.content = "\238\132\132"
     ne.eventresponder["mouse_btn0_up"] =
-        function () mp.commandv("osd-msg", "add", "chapter", -1) end
+        function () mp.commandv_async(nil, "osd-msg", "add", "chapter", -1) end
     ne.eventresponder["shift+mouse_btn0_up"] =
         function () show_message(mp.get_property_osd("chapter-list"), 3) end
 
@@ -1074,7 +1074,7 @@ function osc_init()
     ne.enabled = have_ch
     ne.content = "\238\132\133"
     ne.eventresponder["mouse_btn0_up"] =
-        function () mp.commandv("osd-msg", "add", "chapter", 1) end
+        function () mp.commandv_async(nil, "osd-msg", "add", "chapter", 1) end
     ne.eventresponder["shift+mouse_btn0_up"] =
         function () show_message(mp.get_property_osd("chapter-list"), 3) end
 
@@ -1129,7 +1129,7 @@ function osc_init()
         end
     end
     ne.eventresponder["mouse_btn0_up"] =
-        function () mp.commandv("cycle", "fullscreen") end
+        function () mp.commandv_async(nil, "cycle", "fullscreen") end
 
 
     --seekbar
@@ -1168,14 +1168,14 @@ function osc_init()
             local seekto = get_slider_value(element)
             if (element.state.lastseek == nil) or
                 (not (element.state.lastseek == seekto)) then
-                    mp.commandv("seek", seekto,
+                    mp.commandv_async(nil, "seek", seekto,
                         "absolute-percent", "keyframes")
                     element.state.lastseek = seekto
             end
 
         end
     ne.eventresponder["mouse_btn0_down"] = --exact seeks on single clicks
-        function (element) mp.commandv("seek", get_slider_value(element),
+        function (element) mp.commandv_async(nil, "seek", get_slider_value(element),
             "absolute-percent", "exact") end
     ne.eventresponder["reset"] =
         function (element) element.state.lastseek = nil end
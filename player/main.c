@@ -40,6 +40,8 @@
 #include "options/m_property.h"
 #include "common/common.h"
 #include "common/msg.h"
+#include "common/stats.h"
+#include "common/mem_budget.h"
 #include "common/msg_control.h"
 #include "common/global.h"
 #include "options/parse_configfile.h"
@@ -53,6 +55,7 @@
 #include "audio/mixer.h"
 #include "demux/demux.h"
 #include "stream/stream.h"
+#include "stream/resolve/resolve.h"
 #include "sub/ass_mp.h"
 #include "sub/osd.h"
 #include "video/decode/dec_video.h"
@@ -121,20 +124,40 @@ void mp_destroy(struct MPContext *mpctx)
     if (mpctx->initialized)
         uninit_player(mpctx, INITIALIZED_ALL);
 
+    prefetch_cancel(mpctx);
+    talloc_free(mpctx->resolve_cache);
+    mpctx->resolve_cache = NULL;
+
 #if HAVE_ENCODING
     encode_lavc_finish(mpctx->encode_lavc_ctx);
     encode_lavc_free(mpctx->encode_lavc_ctx);
+    for (int n = 0; n < mpctx->num_encode_renditions; n++) {
+        encode_lavc_finish(mpctx->encode_renditions[n]);
+        encode_lavc_free(mpctx->encode_renditions[n]);
+    }
+    mpctx->num_encode_renditions = 0;
 #endif
 
     mpctx->encode_lavc_ctx = NULL;
 
     shutdown_clients(mpctx);
 
+#ifndef __MINGW32__
+    mp_uninit_ipc(mpctx->ipc_ctx);
+    mpctx->ipc_ctx = NULL;
+#endif
+
     command_uninit(mpctx);
 
+    screenshot_uninit(mpctx);
+
+    mp_uninit_watch_later(mpctx);
+
     osd_free(mpctx->osd);
 
 #if HAVE_LIBASS
+    if (mpctx->ass_renderer)
+        ass_renderer_done(mpctx->ass_renderer);
     if (mpctx->ass_library)
         ass_library_done(mpctx->ass_library);
 #endif
@@ -149,6 +172,9 @@ void mp_destroy(struct MPContext *mpctx)
 
     uninit_libav(mpctx->global);
 
+    if (mpctx->initialized)
+        mp_mem_monitor_stop();
+
     if (mpctx->autodetach)
         pthread_detach(pthread_self());
 
@@ -250,6 +276,29 @@ static void detach_ptw32(void)
 }
 #endif
 
+// List the allocation sites using the most memory (see ta_enable_profiling()).
+char *mp_format_alloc_profile(void *ta_parent, int max_sites)
+{
+    size_t num;
+    struct ta_prof_entry *e = ta_get_profile(NULL, &num);
+    char *res = talloc_asprintf(ta_parent, "%12s %12s %10s %10s  %s\n",
+                                "bytes", "peak", "blocks", "total", "site");
+    for (size_t n = 0; n < num && n < max_sites; n++) {
+        res = talloc_asprintf_append(res, "%12zu %12zu %10zu %10zu  %s\n",
+                                     e[n].bytes, e[n].peak, e[n].count,
+                                     e[n].total, e[n].name);
+    }
+    talloc_free(e);
+    return res;
+}
+
+static void print_alloc_profile(void)
+{
+    char *s = mp_format_alloc_profile(NULL, 100);
+    fprintf(stderr, "Allocation profile:\n%s", s);
+    talloc_free(s);
+}
+
 static void osdep_preinit(int *p_argc, char ***p_argv)
 {
     char *enable_talloc = getenv("MPV_LEAK_REPORT");
@@ -259,6 +308,12 @@ static void osdep_preinit(int *p_argc, char ***p_argv)
     if (enable_talloc && strcmp(enable_talloc, "1") == 0)
         talloc_enable_leak_report();
 
+    char *enable_profile = getenv("MPV_ALLOC_PROFILE");
+    if (enable_profile && strcmp(enable_profile, "1") == 0) {
+        ta_enable_profiling(true);
+        atexit(print_alloc_profile);
+    }
+
 #ifdef __MINGW32__
     mp_get_converted_argv(p_argc, p_argv);
 #endif
@@ -309,6 +364,8 @@ struct MPContext *mp_create(void)
         .playlist = talloc_struct(mpctx, struct playlist, {0}),
         .dispatch = mp_dispatch_create(mpctx),
         .playback_abort = mp_cancel_new(mpctx),
+        .audio_speed_correction = 1.0,
+        .startup_time = mp_time_sec(),
     };
 
     mpctx->global = talloc_zero(mpctx, struct mpv_global);
@@ -332,6 +389,7 @@ struct MPContext *mp_create(void)
     mpctx->mconfig->is_toplevel = true;
 
     mpctx->global->opts = mpctx->opts;
+    mpctx->global->config = mpctx->mconfig;
 
     mpctx->input = mp_input_init(mpctx->global);
     screenshot_init(mpctx);
@@ -339,10 +397,36 @@ struct MPContext *mp_create(void)
     command_init(mpctx);
     init_libav(mpctx->global);
     mp_clients_init(mpctx);
+    mpctx->resolve_cache = mp_resolve_cache_new(mpctx, mpctx->global);
+
+    mp_mark_startup(mpctx, "create");
 
     return mpctx;
 }
 
+// Record that the named initialization phase ended now.
+void mp_mark_startup(struct MPContext *mpctx, const char *name)
+{
+    struct startup_phase phase = {name, mp_time_sec()};
+    MP_TARRAY_APPEND(mpctx, mpctx->startup_phases, mpctx->num_startup_phases,
+                     phase);
+    MP_STATS_EVENT(mpctx, mp_stats_intern(name));
+}
+
+char *mp_format_startup_timings(void *ta_parent, struct MPContext *mpctx)
+{
+    char *res = talloc_strdup(ta_parent, "");
+    double prev = mpctx->startup_time;
+    for (int n = 0; n < mpctx->num_startup_phases; n++) {
+        struct startup_phase *p = &mpctx->startup_phases[n];
+        res = talloc_asprintf_append(res, "%s: %.3f ms\n", p->name,
+                                     (p->time - prev) * 1e3);
+        prev = p->time;
+    }
+    return talloc_asprintf_append(res, "total: %.3f ms\n",
+                                  (prev - mpctx->startup_time) * 1e3);
+}
+
 static void wakeup_playloop(void *ctx)
 {
     struct MPContext *mpctx = ctx;
@@ -364,13 +448,14 @@ int mp_initialize(struct MPContext *mpctx)
         if (mp_msg_open_stats_file(mpctx->global, opts->dump_stats) < 0)
             MP_ERR(mpctx, "Failed to open stats file '%s'\n", opts->dump_stats);
     }
-    MP_STATS(mpctx, "start init");
+    MP_STATS_START(mpctx, "init");
 
     if (mpctx->opts->use_terminal && !terminal_initialized) {
         terminal_initialized = true;
         terminal_init();
         mp_msg_update_msglevels(mpctx->global);
     }
+    mp_mark_startup(mpctx, "terminal");
 
     if (opts->slave_mode) {
         MP_WARN(mpctx, "--slave-broken is deprecated (see manpage).\n");
@@ -382,6 +467,7 @@ int mp_initialize(struct MPContext *mpctx)
     mp_input_set_cancel(mpctx->input, mpctx->playback_abort);
 
     mp_dispatch_set_wakeup_fn(mpctx->dispatch, wakeup_playloop, mpctx);
+    mp_mark_startup(mpctx, "input");
 
 #if HAVE_ENCODING
     if (opts->encode_opts->file && opts->encode_opts->file[0]) {
@@ -391,6 +477,18 @@ int mp_initialize(struct MPContext *mpctx)
             MP_INFO(mpctx, "Encoding initialization failed.");
             return -1;
         }
+        char **renditions = opts->encode_opts->renditions;
+        for (int n = 0; renditions && renditions[n]; n++) {
+            struct encode_lavc_context *ctx =
+                encode_lavc_init_rendition(opts->encode_opts, renditions[n],
+                                           mpctx->global);
+            if (!ctx) {
+                MP_INFO(mpctx, "Encoding initialization failed.");
+                return -1;
+            }
+            MP_TARRAY_APPEND(mpctx, mpctx->encode_renditions,
+                             mpctx->num_encode_renditions, ctx);
+        }
         m_config_set_option0(mpctx->mconfig, "vo", "lavc");
         m_config_set_option0(mpctx->mconfig, "ao", "lavc");
         m_config_set_option0(mpctx->mconfig, "fixed-vo", "yes");
@@ -402,6 +500,7 @@ int mp_initialize(struct MPContext *mpctx)
         m_config_set_option0(mpctx->mconfig, "osc", "no");
         m_config_set_option0(mpctx->mconfig, "framedrop", "no");
         mp_input_enable_section(mpctx->input, "encode", MP_INPUT_EXCLUSIVE);
+        mp_mark_startup(mpctx, "encoding");
     }
 #endif
 
@@ -417,6 +516,10 @@ int mp_initialize(struct MPContext *mpctx)
 #endif
 
     mpctx->osd = osd_create(mpctx->global);
+    mp_mark_startup(mpctx, "libass/osd");
+
+    mp_mem_monitor_start(opts->memory_budget * 1024LL * 1024,
+                         opts->memory_pressure);
 
     // From this point on, all mpctx members are initialized.
     mpctx->initialized = true;
@@ -432,7 +535,8 @@ int mp_initialize(struct MPContext *mpctx)
         opts->fixed_vo = 1;
         mpctx->video_out = init_best_video_out(mpctx->global, mpctx->input,
                                                mpctx->osd,
-                                               mpctx->encode_lavc_ctx);
+                                               mpctx->encode_lavc_ctx,
+                                               mp_client_get_gl_cb_context(mpctx));
         if (!mpctx->video_out) {
             MP_FATAL(mpctx, "Error opening/initializing "
                     "the selected video_out (-vo) device.\n");
@@ -440,11 +544,17 @@ int mp_initialize(struct MPContext *mpctx)
         }
         mpctx->mouse_cursor_visible = true;
         mpctx->initialized_flags |= INITIALIZED_VO;
+        mp_mark_startup(mpctx, "vo");
     }
 
     // Lua user scripts (etc.) can call arbitrary functions. Load them at a point
     // where this is safe.
     mp_load_scripts(mpctx);
+    mp_mark_startup(mpctx, "scripts");
+
+#ifndef __MINGW32__
+    mpctx->ipc_ctx = mp_init_ipc(mpctx->clients, mpctx->global);
+#endif
 
     if (opts->shuffle)
         playlist_shuffle(mpctx->playlist);
@@ -455,8 +565,15 @@ int mp_initialize(struct MPContext *mpctx)
     mpctx->playlist->current = mp_check_playlist_resume(mpctx, mpctx->playlist);
     if (!mpctx->playlist->current)
         mpctx->playlist->current = mpctx->playlist->first;
+    mp_mark_startup(mpctx, "playlist");
+
+    if (opts->dump_startup_timings) {
+        char *s = mp_format_startup_timings(NULL, mpctx);
+        MP_INFO(mpctx, "Startup timings:\n%s", s);
+        talloc_free(s);
+    }
 
-    MP_STATS(mpctx, "end init");
+    MP_STATS_END(mpctx, "init");
 
     return 0;
 }
@@ -487,9 +604,11 @@ int mpv_main(int argc, char *argv[])
     mp_print_version(mpctx->log, false);
 
     mp_parse_cfgfiles(mpctx);
+    mp_mark_startup(mpctx, "config files");
 
     int r = m_config_parse_mp_command_line(mpctx->mconfig, mpctx->playlist,
                                            mpctx->global, argc, argv);
+    mp_mark_startup(mpctx, "command line");
     if (r < 0) {
         if (r <= M_OPT_EXIT) {
             exit_player(mpctx, EXIT_NONE);
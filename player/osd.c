@@ -68,6 +68,20 @@ static char *join_lines(void *ta_ctx, char **parts, int num_parts)
     return res;
 }
 
+// Expand the property string src, reusing the parsed template if src didn't
+// change since the last call.
+static char *expand_osd_template(struct MPContext *mpctx,
+                                 struct osd_template *t, const char *src)
+{
+    if (!t->src || strcmp(t->src, src) != 0) {
+        talloc_free(t->src);
+        talloc_free(t->tmpl);
+        t->src = talloc_strdup(mpctx, src);
+        t->tmpl = mp_property_compile_escaped(mpctx, src);
+    }
+    return mp_property_expand_template(mpctx, t->tmpl);
+}
+
 static void term_osd_update(struct MPContext *mpctx)
 {
     int num_parts = 0;
@@ -89,11 +103,26 @@ static void term_osd_update(struct MPContext *mpctx)
         mp_msg_has_status_line(mpctx->global))
     {
         talloc_free(s);
-    } else {
-        talloc_free(mpctx->term_osd_contents);
-        mpctx->term_osd_contents = s;
-        mp_msg(mpctx->statusline, MSGL_STATUS, "%s", s);
+        return;
     }
+
+    // Limit the output rate (slow terminals, SSH). Clearing is not delayed.
+    // The next call after the deadline outputs the current contents.
+    double now = mp_time_sec();
+    double rate = mpctx->opts->term_status_rate;
+    if (rate > 0 && s[0]) {
+        double next = mpctx->term_osd_last_update + 1.0 / rate;
+        if (now < next) {
+            mpctx->sleeptime = MPMIN(mpctx->sleeptime, next - now);
+            talloc_free(s);
+            return;
+        }
+    }
+    mpctx->term_osd_last_update = now;
+
+    talloc_free(mpctx->term_osd_contents);
+    mpctx->term_osd_contents = s;
+    mp_msg(mpctx->statusline, MSGL_STATUS, "%s", s);
 }
 
 static void term_osd_set_subs(struct MPContext *mpctx, const char *text)
@@ -164,7 +193,8 @@ static void print_status(struct MPContext *mpctx)
     }
 
     if (opts->status_msg) {
-        char *r = mp_property_expand_escaped_string(mpctx, opts->status_msg);
+        char *r = expand_osd_template(mpctx, &mpctx->status_msg_tmpl,
+                                      opts->status_msg);
         term_osd_set_status(mpctx, r);
         talloc_free(r);
         return;
@@ -386,7 +416,8 @@ static void sadd_osd_status(char **buffer, struct MPContext *mpctx, int level)
     char *msg = mpctx->opts->osd_msg[level - 1];
 
     if (msg && msg[0]) {
-        char *text = mp_property_expand_escaped_string(mpctx, msg);
+        char *text = expand_osd_template(mpctx,
+                                         &mpctx->osd_msg_tmpl[level - 1], msg);
         *buffer = talloc_strdup_append(*buffer, text);
         talloc_free(text);
     } else if (level >= 2) {
@@ -396,7 +427,8 @@ static void sadd_osd_status(char **buffer, struct MPContext *mpctx, int level)
         saddf(buffer, "%s ", sym);
         char *custom_msg = mpctx->opts->osd_status_msg;
         if (custom_msg && level == 3) {
-            char *text = mp_property_expand_escaped_string(mpctx, custom_msg);
+            char *text = expand_osd_template(mpctx, &mpctx->osd_status_msg_tmpl,
+                                             custom_msg);
             *buffer = talloc_strdup_append(*buffer, text);
             talloc_free(text);
         } else {
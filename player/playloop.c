@@ -56,6 +56,7 @@
 // mp_wait_events() was called. (But see mp_process_input().)
 void mp_wait_events(struct MPContext *mpctx, double sleeptime)
 {
+    mp_client_update_snapshot(mpctx);
     mp_input_wait(mpctx->input, sleeptime);
 }
 
@@ -94,6 +95,7 @@ void pause_player(struct MPContext *mpctx)
         ao_pause(mpctx->ao);
     if (mpctx->video_out)
         vo_set_paused(mpctx->video_out, true);
+    video_wall_set_paused(mpctx, true);
 
 end:
     mp_notify(mpctx, mpctx->opts->pause ? MPV_EVENT_PAUSE : MPV_EVENT_UNPAUSE, 0);
@@ -115,10 +117,15 @@ void unpause_player(struct MPContext *mpctx)
     mpctx->osd_function = 0;
     mpctx->osd_force_update = true;
 
+    // The decoder is ahead of a frame shown from the backstep cache.
+    if (mpctx->backstep_offset)
+        queue_seek(mpctx, MPSEEK_ABSOLUTE, mpctx->last_vo_pts, 2, true);
+
     if (mpctx->ao && mpctx->d_audio)
         ao_resume(mpctx->ao);
     if (mpctx->video_out)
         vo_set_paused(mpctx->video_out, false);
+    video_wall_set_paused(mpctx, false);
 
     (void)get_relative_time(mpctx);     // ignore time that passed during pause
 
@@ -131,6 +138,8 @@ void add_step_frame(struct MPContext *mpctx, int dir)
     if (!mpctx->d_video)
         return;
     if (dir > 0) {
+        if (mpctx->backstep_offset && video_step_cached_frame(mpctx, 1) >= 0)
+            return;
         mpctx->step_frames += 1;
         unpause_player(mpctx);
     } else if (dir < 0) {
@@ -151,6 +160,7 @@ void reset_playback_state(struct MPContext *mpctx)
 
     mpctx->hrseek_active = false;
     mpctx->hrseek_framedrop = false;
+    mpctx->hrseek_keep_frames = false;
     mpctx->playback_pts = MP_NOPTS_VALUE;
     mpctx->last_seek_pts = MP_NOPTS_VALUE;
     mpctx->cache_wait_time = 0;
@@ -158,6 +168,8 @@ void reset_playback_state(struct MPContext *mpctx)
 
 #if HAVE_ENCODING
     encode_lavc_discontinuity(mpctx->encode_lavc_ctx);
+    for (int n = 0; n < mpctx->num_encode_renditions; n++)
+        encode_lavc_discontinuity(mpctx->encode_renditions[n]);
 #endif
 }
 
@@ -250,7 +262,20 @@ static int mp_seek(MPContext *mpctx, struct seek_params seek,
 
     if (hr_seek)
         demuxer_amount -= hr_seek_offset;
-    demux_seek(mpctx->demuxer, demuxer_amount, demuxer_style);
+    struct timeline_part *pre = mpctx->timeline_preload;
+    mpctx->timeline_preload = NULL;
+    if (timeline_fallthrough && pre &&
+        pre == &mpctx->timeline[mpctx->timeline_part] &&
+        mpctx->timeline_preload_pts == demuxer_amount &&
+        mpctx->timeline_preload_flags == demuxer_style)
+    {
+        MP_VERBOSE(mpctx, "Using preloaded timeline part.\n");
+    } else {
+        // Don't let a preloaded source that is not used keep reading ahead.
+        if (pre && pre->source != mpctx->demuxer)
+            demux_stop_thread(pre->source);
+        demux_seek(mpctx->demuxer, demuxer_amount, demuxer_style);
+    }
 
     // Seek external, extra files too:
     for (int t = 0; t < mpctx->num_tracks; t++) {
@@ -291,6 +316,7 @@ static int mp_seek(MPContext *mpctx, struct seek_params seek,
     if (hr_seek || mpctx->timeline) {
         mpctx->hrseek_active = true;
         mpctx->hrseek_framedrop = !hr_seek_very_exact;
+        mpctx->hrseek_keep_frames = hr_seek_very_exact;
         mpctx->hrseek_pts = hr_seek ? seek.amount
                                  : mpctx->timeline[mpctx->timeline_part].start;
     }
@@ -309,6 +335,15 @@ void queue_seek(struct MPContext *mpctx, enum seek_type type, double amount,
                 int exact, bool immediate)
 {
     struct seek_params *seek = &mpctx->seek;
+    if (type != MPSEEK_NONE) {
+        double now = mp_time_sec();
+        mpctx->scrub_burst = now - mpctx->last_seek_request <
+                             mpctx->opts->seek_scrub;
+        mpctx->last_seek_request = now;
+        // A single seek ends scrubbing, and replaces the final seek.
+        if (!mpctx->scrub_burst)
+            mpctx->scrubbing = false;
+    }
     switch (type) {
     case MPSEEK_RELATIVE:
         seek->immediate |= immediate;
@@ -342,8 +377,35 @@ void queue_seek(struct MPContext *mpctx, enum seek_type type, double amount,
     abort();
 }
 
+// While scrubbing, seek only to keyframes and decode only keyframes. Do the
+// actual requested seek once the seek requests stop.
+static void handle_scrub(struct MPContext *mpctx)
+{
+    double timeout = mpctx->opts->seek_scrub;
+    if (mpctx->seek.type && mpctx->scrub_burst) {
+        if (!mpctx->scrubbing)
+            MP_VERBOSE(mpctx, "Scrubbing.\n");
+        mpctx->scrubbing = true;
+        mpctx->scrub_seek = mpctx->seek;
+        mpctx->seek.exact = -1;
+        mpctx->scrub_burst = false;
+    }
+    if (!mpctx->scrubbing || mpctx->seek.type)
+        return;
+    double left = mpctx->last_seek_request + timeout - mp_time_sec();
+    if (left > 0) {
+        mpctx->sleeptime = MPMIN(mpctx->sleeptime, left);
+        return;
+    }
+    MP_VERBOSE(mpctx, "Scrubbing stopped.\n");
+    mpctx->scrubbing = false;
+    mpctx->seek = mpctx->scrub_seek;
+    mpctx->seek.immediate = true;
+}
+
 void execute_queued_seek(struct MPContext *mpctx)
 {
+    handle_scrub(mpctx);
     if (mpctx->seek.type) {
         // Let explicitly imprecise seeks cancel precise seeks:
         if (mpctx->hrseek_active && mpctx->seek.exact < 0)
@@ -355,6 +417,11 @@ void execute_queued_seek(struct MPContext *mpctx)
             mp_time_sec() - mpctx->start_timestamp < 0.3)
             return;
         mp_seek(mpctx, mpctx->seek, false);
+        // Relative seeks are applied to the position reached by now.
+        if (mpctx->scrubbing && mpctx->last_seek_pts != MP_NOPTS_VALUE) {
+            mpctx->scrub_seek.type = MPSEEK_ABSOLUTE;
+            mpctx->scrub_seek.amount = mpctx->last_seek_pts;
+        }
         mpctx->seek = (struct seek_params){0};
     }
 }
@@ -524,6 +591,9 @@ static void handle_osd_redraw(struct MPContext *mpctx)
 {
     if (!mpctx->video_out || !mpctx->video_out->config_ok)
         return;
+    // Redrawing is useless when encoding; the encoder only takes new frames.
+    if (mpctx->encode_lavc_ctx && !mpctx->paused)
+        return;
     // If we're playing normally, let OSD be redrawn naturally as part of
     // video display.
     if (!mpctx->paused) {
@@ -540,6 +610,56 @@ static void handle_osd_redraw(struct MPContext *mpctx)
     mpctx->sleeptime = 0;
 }
 
+// Estimate how many seconds should be buffered before unpausing, so that
+// playback can continue without pausing again. If reading is slower than the
+// media bitrate, the buffer drains at rate (1 - speed/bitrate), so to play the
+// next CACHE_PLAN_AHEAD seconds the buffer must hold that much. Returns -1 if
+// the estimates are not available.
+#define CACHE_PLAN_AHEAD 60.0
+static double estimate_cache_wait_time(struct MPContext *mpctx,
+                                       struct demux_ctrl_reader_state *s)
+{
+    int64_t speed = -1;
+    demux_stream_control(mpctx->demuxer, STREAM_CTRL_GET_CACHE_SPEED, &speed);
+    if (speed <= 0 || s->bitrate <= 0)
+        return -1;
+    double ratio = speed * 8.0 / s->bitrate;
+    if (ratio >= 1.0)
+        return 0;
+    double ahead = CACHE_PLAN_AHEAD;
+    double len = get_time_length(mpctx);
+    double pos = get_current_time(mpctx);
+    if (len > 0 && pos != MP_NOPTS_VALUE)
+        ahead = MPCLAMP(len - pos, 0, ahead);
+    return ahead * (1.0 - ratio);
+}
+
+// Pick how far the stream cache reads ahead. If the source is read at least
+// CACHE_FAST_RATIO times faster than the media bitrate, CACHE_PLAN_AHEAD
+// seconds of media are enough to bridge slowdowns, as refilling is quick;
+// filling the rest of the cache would only waste bandwidth. Otherwise the
+// cache reads as far ahead as its size allows.
+#define CACHE_FAST_RATIO 2.0
+static void update_cache_readahead(struct MPContext *mpctx,
+                                   struct demux_ctrl_reader_state *s)
+{
+    int64_t speed = -1;
+    demux_stream_control(mpctx->demuxer, STREAM_CTRL_GET_CACHE_SPEED, &speed);
+    int64_t readahead = 0;
+    if (speed > 0 && s->bitrate > 0 &&
+        speed * 8.0 / s->bitrate >= CACHE_FAST_RATIO)
+        readahead = s->bitrate / 8 * CACHE_PLAN_AHEAD;
+    // Don't bother the cache with small changes of the estimate.
+    int64_t old = mpctx->cache_readahead;
+    if (old >= 0 && (readahead == old ||
+        (readahead && old && llabs(readahead - old) < old / 4)))
+        return;
+    mpctx->cache_readahead = readahead;
+    MP_VERBOSE(mpctx, "Cache readahead limit: %" PRId64 " KB\n",
+               readahead / 1024);
+    demux_stream_control(mpctx->demuxer, STREAM_CTRL_SET_READAHEAD, &readahead);
+}
+
 static void handle_pause_on_low_cache(struct MPContext *mpctx)
 {
     struct MPOpts *opts = mpctx->opts;
@@ -552,11 +672,17 @@ static void handle_pause_on_low_cache(struct MPContext *mpctx)
     struct demux_ctrl_reader_state s = {.idle = true, .ts_duration = -1};
     demux_control(mpctx->demuxer, DEMUXER_CTRL_GET_READER_STATE, &s);
 
+    if (idle != -1)
+        update_cache_readahead(mpctx, &s);
+
     if (mpctx->restart_complete && idle != -1) {
         if (mpctx->paused && mpctx->paused_for_cache) {
             mpctx->cache_wait_time = MPCLAMP(mpctx->cache_wait_time, 1, 10);
-            if (!opts->cache_pausing || s.ts_duration >= mpctx->cache_wait_time
-                || s.idle)
+            double wait_time = estimate_cache_wait_time(mpctx, &s);
+            if (wait_time < 0)
+                wait_time = mpctx->cache_wait_time;
+            wait_time = MPCLAMP(wait_time, 1, 10);
+            if (!opts->cache_pausing || s.ts_duration >= wait_time || s.idle)
             {
                 double elapsed_time = mp_time_sec() - mpctx->cache_stop_time;
                 if (elapsed_time > mpctx->cache_wait_time) {
@@ -599,6 +725,52 @@ static void handle_pause_on_low_cache(struct MPContext *mpctx)
     }
 }
 
+// Open the next playlist entry once the current file was read completely.
+static void handle_prefetch(struct MPContext *mpctx)
+{
+    if (!mpctx->opts->prefetch_playlist || mpctx->prefetch || !mpctx->demuxer)
+        return;
+
+    struct demux_ctrl_reader_state s = {.idle = true, .ts_duration = -1};
+    demux_control(mpctx->demuxer, DEMUXER_CTRL_GET_READER_STATE, &s);
+    if (s.eof)
+        prefetch_next(mpctx);
+}
+
+// Start reading the source of the next timeline part shortly before the
+// current part ends, so that the transition doesn't stall on the seek.
+static void handle_timeline_preload(struct MPContext *mpctx)
+{
+    struct MPOpts *opts = mpctx->opts;
+    if (!mpctx->timeline || opts->timeline_preload <= 0 ||
+        !mpctx->restart_complete)
+        return;
+
+    int i = mpctx->timeline_part + 1;
+    if (i >= mpctx->num_timeline_parts)
+        return;
+    struct timeline_part *next = mpctx->timeline + i;
+    if (next == mpctx->timeline_preload ||
+        next->source == mpctx->timeline[mpctx->timeline_part].source)
+        return;
+
+    double now = get_current_time(mpctx);
+    if (now == MP_NOPTS_VALUE || now < next->start - opts->timeline_preload)
+        return;
+
+    // Same parameters as the seek done by mp_seek() for timeline_fallthrough.
+    bool hr_seek = opts->correct_pts && opts->hr_seek >= 0;
+    double pts = next->source_start;
+    int flags = SEEK_ABSOLUTE;
+    if (hr_seek) {
+        pts -= opts->hr_seek_demuxer_offset;
+        flags |= SEEK_BACKWARD;
+    }
+    if (hr_seek || opts->mkv_subtitle_preroll)
+        flags |= SEEK_SUBPREROLL;
+    timeline_preload_part(mpctx, i, pts, flags);
+}
+
 static void handle_heartbeat_cmd(struct MPContext *mpctx)
 {
     struct MPOpts *opts = mpctx->opts;
@@ -694,6 +866,11 @@ static void handle_backstep(struct MPContext *mpctx)
     double current_pts = mpctx->last_vo_pts;
     mpctx->backstep_active = false;
     if (mpctx->d_video && current_pts != MP_NOPTS_VALUE) {
+        int r = video_step_cached_frame(mpctx, -1);
+        if (r == 0)
+            mpctx->backstep_active = true; // VO busy; retry
+        if (r >= 0)
+            return;
         double seek_pts = find_previous_pts(mpctx, current_pts);
         if (seek_pts != MP_NOPTS_VALUE) {
             queue_seek(mpctx, MPSEEK_ABSOLUTE, seek_pts, 2, true);
@@ -723,6 +900,7 @@ static void handle_backstep(struct MPContext *mpctx)
                 if (mpctx->hrseek_active) {
                     mpctx->hrseek_pts = current_pts + 10.0;
                     mpctx->hrseek_framedrop = false;
+                    mpctx->hrseek_keep_frames = true;
                     mpctx->backstep_active = true;
                 }
             } else {
@@ -949,10 +1127,14 @@ void run_playloop(struct MPContext *mpctx)
     handle_osd_redraw(mpctx);
 
     mp_wait_events(mpctx, mpctx->sleeptime);
-    mpctx->sleeptime = 100.0; // infinite for all practical purposes
+    mpctx->sleeptime = INFINITY; // until a handler sets a deadline
 
     handle_pause_on_low_cache(mpctx);
 
+    handle_prefetch(mpctx);
+
+    handle_timeline_preload(mpctx);
+
     mp_process_input(mpctx);
 
     handle_backstep(mpctx);
@@ -984,7 +1166,7 @@ void idle_loop(struct MPContext *mpctx)
         }
         handle_dummy_ticks(mpctx);
         mp_wait_events(mpctx, mpctx->sleeptime);
-        mpctx->sleeptime = 100.0;
+        mpctx->sleeptime = INFINITY;
         mp_process_input(mpctx);
         update_osd_msg(mpctx);
         handle_osd_redraw(mpctx);
@@ -18,7 +18,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <time.h>
+#include <math.h>
 
 #include "config.h"
 
@@ -36,6 +38,7 @@
 #include "video/filter/vf.h"
 #include "video/out/vo.h"
 #include "video/image_writer.h"
+#include "video/sws_utils.h"
 #include "sub/osd.h"
 
 #include "video/csputils.h"
@@ -51,6 +54,15 @@ typedef struct screenshot_ctx {
     bool osd;
 
     int frameno;
+
+    // Encodes and writes the images, so that taking a screenshot does not
+    // block playback (created on first use)
+    struct image_writer_queue *queue;
+    bool queue_failed;
+
+    // For --screenshot-max-size (kept, since thumbnails usually have the
+    // same size)
+    struct mp_sws_context *sws;
 } screenshot_ctx;
 
 void screenshot_init(struct MPContext *mpctx)
@@ -85,6 +97,59 @@ static void screenshot_msg(screenshot_ctx *ctx, int status, const char *msg,
     talloc_free(s);
 }
 
+void screenshot_uninit(struct MPContext *mpctx)
+{
+    screenshot_ctx *ctx = mpctx->screenshot_ctx;
+
+    if (!ctx || !ctx->queue)
+        return;
+
+    image_writer_queue_flush(ctx->queue);
+
+    struct image_writer_queue_stats st;
+    image_writer_queue_get_stats(ctx->queue, &st);
+    int lev = st.failed || st.dropped ? MSGL_WARN : MSGL_V;
+    MP_MSG(mpctx, lev, "Screenshots: %"PRIu64" written, %"PRIu64" failed, "
+           "%"PRIu64" dropped (queue full %"PRIu64" times).\n", st.written,
+           st.failed, st.dropped, st.waited);
+
+    talloc_free(ctx->queue);
+    ctx->queue = NULL;
+}
+
+static bool file_exists(screenshot_ctx *ctx, const char *fname)
+{
+    return mp_path_exists(fname) ||
+           (ctx->queue && image_writer_queue_has_file(ctx->queue, fname));
+}
+
+// Takes over ownership of image.
+static void write_screenshot(screenshot_ctx *ctx, struct mp_image *image,
+                             const struct image_writer_opts *opts,
+                             const char *filename)
+{
+    struct MPOpts *mpopts = ctx->mpctx->opts;
+
+    if (!ctx->queue && !ctx->queue_failed) {
+        size_t max_bytes = (size_t)mpopts->screenshot_queue_size * 1024 * 1024;
+        ctx->queue = image_writer_queue_create(ctx, ctx->mpctx->log,
+                                               mpopts->screenshot_threads,
+                                               max_bytes,
+                                               mpopts->screenshot_queue_drop);
+        ctx->queue_failed = !ctx->queue;
+    }
+
+    if (ctx->queue) {
+        if (!image_writer_queue_add(ctx->queue, image, opts, filename))
+            screenshot_msg(ctx, SMSG_ERR, "Screenshot queue full, dropped!");
+        return;
+    }
+
+    if (!write_image(image, opts, filename, ctx->mpctx->log))
+        screenshot_msg(ctx, SMSG_ERR, "Error writing screenshot!");
+    talloc_free(image);
+}
+
 static char *stripext(void *talloc_ctx, const char *s)
 {
     const char *end = strrchr(s, '.');
@@ -280,7 +345,7 @@ static char *gen_fname(screenshot_ctx *ctx, const char *file_ext)
             return NULL;
         }
 
-        if (!mp_path_exists(fname))
+        if (!file_exists(ctx, fname))
             return fname;
 
         if (sequence == prev_sequence) {
@@ -308,6 +373,7 @@ static void add_subs(struct MPContext *mpctx, struct mp_image *image)
                       OSD_DRAW_SUB_ONLY, image);
 }
 
+// Takes over ownership of image.
 static void screenshot_save(struct MPContext *mpctx, struct mp_image *image)
 {
     screenshot_ctx *ctx = mpctx->screenshot_ctx;
@@ -317,10 +383,43 @@ static void screenshot_save(struct MPContext *mpctx, struct mp_image *image)
     char *filename = gen_fname(ctx, image_writer_file_ext(opts));
     if (filename) {
         screenshot_msg(ctx, SMSG_OK, "Screenshot: '%s'", filename);
-        if (!write_image(image, opts, filename, mpctx->log))
-            screenshot_msg(ctx, SMSG_ERR, "Error writing screenshot!");
+        write_screenshot(ctx, image, opts, filename);
         talloc_free(filename);
+    } else {
+        talloc_free(image);
+    }
+}
+
+// Apply --screenshot-max-size. Takes over ownership of image.
+static struct mp_image *scale_screenshot(struct MPContext *mpctx,
+                                         struct mp_image *image)
+{
+    screenshot_ctx *ctx = mpctx->screenshot_ctx;
+    int max_size = mpctx->opts->screenshot_max_size;
+    int d_w = image->params.d_w, d_h = image->params.d_h;
+    if (max_size <= 0 || (d_w <= max_size && d_h <= max_size))
+        return image;
+
+    double f = max_size / (double)MPMAX(d_w, d_h);
+    int w = MPMAX(lrint(d_w * f), 1), h = MPMAX(lrint(d_h * f), 1);
+    struct mp_image *res = mp_image_alloc(image->imgfmt, w, h);
+    if (!res)
+        return image;
+    mp_image_copy_attributes(res, image);
+    res->params.d_w = w;
+    res->params.d_h = h;
+
+    if (!ctx->sws) {
+        ctx->sws = mp_sws_alloc(ctx);
+        ctx->sws->log = mpctx->log;
+        mp_sws_set_from_cmdline(ctx->sws, mpctx->opts->vo.sws_opts);
+    }
+    if (mp_sws_scale(ctx->sws, res, image) < 0) {
+        talloc_free(res);
+        return image;
     }
+    talloc_free(image);
+    return res;
 }
 
 static struct mp_image *screenshot_get(struct MPContext *mpctx, int mode)
@@ -345,6 +444,7 @@ static struct mp_image *screenshot_get(struct MPContext *mpctx, int mode)
         if (image) {
             if (mode == MODE_SUBTITLES && !args.has_osd)
                 add_subs(mpctx, image);
+            image = scale_screenshot(mpctx, image);
         }
     }
     return image;
@@ -358,7 +458,7 @@ void screenshot_to_file(struct MPContext *mpctx, const char *filename, int mode,
     bool old_osd = ctx->osd;
     ctx->osd = osd;
 
-    if (mp_path_exists(filename)) {
+    if (file_exists(ctx, filename)) {
         screenshot_msg(ctx, SMSG_ERR, "Screenshot: file '%s' already exists.",
                        filename);
         goto end;
@@ -372,9 +472,7 @@ void screenshot_to_file(struct MPContext *mpctx, const char *filename, int mode,
         goto end;
     }
     screenshot_msg(ctx, SMSG_OK, "Screenshot: '%s'", filename);
-    if (!write_image(image, &opts, filename, mpctx->log))
-        screenshot_msg(ctx, SMSG_ERR, "Error writing screenshot!");
-    talloc_free(image);
+    write_screenshot(ctx, image, &opts, filename);
 
 end:
     ctx->osd = old_osd;
@@ -406,8 +504,6 @@ void screenshot_request(struct MPContext *mpctx, int mode, bool each_frame,
     } else {
         screenshot_msg(ctx, SMSG_ERR, "Taking screenshot failed.");
     }
-
-    talloc_free(image);
 }
 
 void screenshot_flip(struct MPContext *mpctx)
@@ -134,11 +134,6 @@ static void mp_load_script(struct MPContext *mpctx, const char *fname)
     pthread_t thread;
     if (pthread_create(&thread, NULL, script_thread, arg))
         talloc_free(arg);
-
-    wait_loaded(mpctx);
-    MP_VERBOSE(mpctx, "Done loading %s.\n", fname);
-
-    return;
 }
 
 static int compare_filename(const void *pa, const void *pb)
@@ -169,6 +164,8 @@ static char **list_script_files(void *talloc_ctx, char *path)
     return files;
 }
 
+// The scripts are started in parallel, and this waits until all of them are
+// initialized.
 void mp_load_scripts(struct MPContext *mpctx)
 {
     // Load scripts from options
@@ -179,16 +176,18 @@ void mp_load_scripts(struct MPContext *mpctx)
         if (files[n][0])
             mp_load_script(mpctx, files[n]);
     }
-    if (!mpctx->opts->auto_load_scripts)
-        return;
-
-    // Load all lua scripts
-    void *tmp = talloc_new(NULL);
-    char **luadir = mp_find_all_config_files(tmp, mpctx->global, "lua");
-    for (int i = 0; luadir && luadir[i]; i++) {
-        files = list_script_files(tmp, luadir[i]);
-        for (int n = 0; files && files[n]; n++)
-            mp_load_script(mpctx, files[n]);
+    if (mpctx->opts->auto_load_scripts) {
+        // Load all lua scripts
+        void *tmp = talloc_new(NULL);
+        char **luadir = mp_find_all_config_files(tmp, mpctx->global, "lua");
+        for (int i = 0; luadir && luadir[i]; i++) {
+            files = list_script_files(tmp, luadir[i]);
+            for (int n = 0; files && files[n]; n++)
+                mp_load_script(mpctx, files[n]);
+        }
+        talloc_free(tmp);
     }
-    talloc_free(tmp);
+
+    wait_loaded(mpctx);
+    MP_VERBOSE(mpctx, "Done loading scripts.\n");
 }
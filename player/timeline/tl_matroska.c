@@ -114,6 +114,99 @@ static char **find_files(const char *original_file, const char *suffix)
     return results;
 }
 
+// Segment UIDs of files checked in previous runs (--ordered-chapters-uid-cache).
+struct uid_cache_entry {
+    char *path;
+    int segment;
+    long long mtime, size;
+    bool valid;                         // false if the segment doesn't exist
+    struct matroska_segment_uid uid;    // all 0 if the segment has no UID
+};
+
+struct uid_cache {
+    char *filename;
+    struct uid_cache_entry *entries;
+    int num_entries;
+    bool changed;
+};
+
+static struct uid_cache *load_uid_cache(void *talloc_ctx,
+                                        struct MPContext *mpctx)
+{
+    char *opt = mpctx->opts->ordered_chapters_uid_cache;
+    if (!opt || !opt[0])
+        return NULL;
+    struct uid_cache *cache = talloc_zero(talloc_ctx, struct uid_cache);
+    cache->filename = mp_get_user_path(cache, mpctx->global, opt);
+    FILE *f = fopen(cache->filename, "r");
+    if (!f)
+        return cache;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        // Format: "mtime size segment uid path\n", uid is "-" if not valid
+        struct uid_cache_entry e = {0};
+        char uid[33];
+        int offset = 0;
+        if (sscanf(line, "%lld %lld %d %32s %n", &e.mtime, &e.size,
+                   &e.segment, uid, &offset) < 4 || !offset)
+            continue;
+        e.valid = strcmp(uid, "-") != 0;
+        if (e.valid) {
+            if (strlen(uid) != 32)
+                continue;
+            for (int i = 0; i < 16; i++)
+                sscanf(uid + i * 2, "%2hhx", &e.uid.segment[i]);
+        }
+        e.path = bstrdup0(cache, bstr_strip_linebreaks(bstr0(line + offset)));
+        MP_TARRAY_APPEND(cache, cache->entries, cache->num_entries, e);
+    }
+    fclose(f);
+    return cache;
+}
+
+static void save_uid_cache(struct MPContext *mpctx, struct uid_cache *cache)
+{
+    if (!cache || !cache->changed)
+        return;
+    FILE *f = fopen(cache->filename, "w");
+    if (!f) {
+        MP_WARN(mpctx, "Can't write '%s'.\n", cache->filename);
+        return;
+    }
+    for (int n = 0; n < cache->num_entries; n++) {
+        struct uid_cache_entry *e = &cache->entries[n];
+        fprintf(f, "%lld %lld %d ", e->mtime, e->size, e->segment);
+        if (e->valid) {
+            for (int i = 0; i < 16; i++)
+                fprintf(f, "%02x", e->uid.segment[i]);
+        } else {
+            fprintf(f, "-");
+        }
+        fprintf(f, " %s\n", e->path);
+    }
+    fclose(f);
+}
+
+// Return the entry for the given file and segment (or a new one, with valid
+// set to false and mtime set to -1).
+static struct uid_cache_entry *get_uid_cache_entry(struct uid_cache *cache,
+                                                   const char *path,
+                                                   int segment)
+{
+    for (int n = 0; n < cache->num_entries; n++) {
+        struct uid_cache_entry *e = &cache->entries[n];
+        if (e->segment == segment && strcmp(e->path, path) == 0)
+            return e;
+    }
+    struct uid_cache_entry e = {
+        .path = talloc_strdup(cache, path),
+        .segment = segment,
+        .mtime = -1,
+    };
+    MP_TARRAY_APPEND(cache, cache->entries, cache->num_entries, e);
+    return &cache->entries[cache->num_entries - 1];
+}
+
 static int enable_cache(struct MPContext *mpctx, struct stream **stream,
                         struct demuxer **demuxer, struct demuxer_params *params)
 {
@@ -157,23 +250,61 @@ static bool has_source_request(struct matroska_segment_uid *uids,
     return false;
 }
 
+// Whether a still missing source could be in a file with this segment UID.
+static bool uid_is_missing(struct demuxer **sources, int num_sources,
+                           struct matroska_segment_uid *uids,
+                           struct matroska_segment_uid *uid)
+{
+    for (int i = 1; i < num_sources; i++) {
+        if (!sources[i] && !memcmp(uids[i].segment, uid->segment, 16))
+            return true;
+    }
+    return false;
+}
+
 // segment = get Nth segment of a multi-segment file
 static bool check_file_seg(struct MPContext *mpctx, struct demuxer ***sources,
                            int *num_sources, struct matroska_segment_uid **uids,
-                           char *filename, int segment)
+                           struct uid_cache *cache, char *filename, int segment)
 {
+    struct uid_cache_entry *entry = NULL;
+    struct stat st;
+    if (cache && stat(filename, &st) == 0) {
+        entry = get_uid_cache_entry(cache, filename, segment);
+        if (entry->mtime == st.st_mtime && entry->size == st.st_size) {
+            if (!entry->valid)
+                return false;
+            if (!uid_is_missing(*sources, *num_sources, *uids, &entry->uid))
+                return true;
+        }
+    }
+
     bool was_valid = false;
+    struct matroska_segment_uid read_uid = {{0}};
     struct demuxer_params params = {
         .matroska_num_wanted_uids = *num_sources,
         .matroska_wanted_uids = *uids,
         .matroska_wanted_segment = segment,
         .matroska_was_valid = &was_valid,
+        .matroska_read_uid = &read_uid,
     };
     struct stream *s = stream_open(filename, mpctx->global);
     if (!s)
         return false;
     struct demuxer *d = demux_open(s, "mkv", &params, mpctx->global);
 
+    if (entry) {
+        *entry = (struct uid_cache_entry){
+            .path = entry->path,
+            .segment = segment,
+            .mtime = st.st_mtime,
+            .size = st.st_size,
+            .valid = was_valid,
+            .uid = read_uid,
+        };
+        cache->changed = true;
+    }
+
     if (!d) {
         free_stream(s);
         return was_valid;
@@ -224,11 +355,11 @@ static bool check_file_seg(struct MPContext *mpctx, struct demuxer ***sources,
 
 static void check_file(struct MPContext *mpctx, struct demuxer ***sources,
                        int *num_sources, struct matroska_segment_uid **uids,
-                       char *filename, int first)
+                       struct uid_cache *cache, char *filename, int first)
 {
     for (int segment = first; ; segment++) {
         if (!check_file_seg(mpctx, sources, num_sources,
-                            uids, filename, segment))
+                            uids, cache, filename, segment))
             break;
     }
 }
@@ -251,6 +382,7 @@ static int find_ordered_chapter_sources(struct MPContext *mpctx,
     void *tmp = talloc_new(NULL);
     int num_filenames = 0;
     char **filenames = NULL;
+    struct uid_cache *cache = load_uid_cache(tmp, mpctx);
     if (*num_sources > 1) {
         char *main_filename = mpctx->demuxer->filename;
         MP_INFO(mpctx, "This file references data from "
@@ -274,7 +406,7 @@ static int find_ordered_chapter_sources(struct MPContext *mpctx,
             talloc_steal(tmp, filenames);
         }
         // Possibly get further segments appended to the first segment
-        check_file(mpctx, sources, num_sources, uids, main_filename, 1);
+        check_file(mpctx, sources, num_sources, uids, cache, main_filename, 1);
     }
 
     int old_source_count;
@@ -284,11 +416,14 @@ static int find_ordered_chapter_sources(struct MPContext *mpctx,
             if (!missing(*sources, *num_sources))
                 break;
             MP_INFO(mpctx, "Checking file %s\n", filenames[i]);
-            check_file(mpctx, sources, num_sources, uids, filenames[i], 0);
+            check_file(mpctx, sources, num_sources, uids, cache, filenames[i],
+                       0);
         }
     /* Loop while we have new sources to look for. */
     } while (old_source_count != *num_sources);
 
+    save_uid_cache(mpctx, cache);
+
     if (missing(*sources, *num_sources)) {
         MP_ERR(mpctx, "Failed to find ordered chapter part!\n"
                "There will be parts MISSING from the video!\n");
@@ -34,7 +34,10 @@
 #include "options/m_property.h"
 #include "osdep/timer.h"
 
+#include "input/input.h"
 #include "audio/out/ao.h"
+#include "audio/filter/af.h"
+#include "audio/decode/dec_audio.h"
 #include "demux/demux.h"
 #include "stream/stream.h"
 #include "sub/osd.h"
@@ -45,6 +48,7 @@
 #include "video/out/vo.h"
 
 #include "core.h"
+#include "client.h"
 #include "command.h"
 #include "screenshot.h"
 
@@ -57,6 +61,16 @@ enum {
     VD_WAIT = 3,        // no EOF, but no output; wait until wakeup
 };
 
+// An additional output created with --video-wall. It shows the crop
+// rectangle of the video, using the same (refcounted) frames as the main VO.
+struct wall_output {
+    struct vo *vo;
+    struct mp_vo_opts vo_opts;  // window options (vo->opts points here)
+    struct m_geometry crop;
+    bool failed;                // reconfig failed, ignore this output
+    bool warned_hwaccel;
+};
+
 static const char av_desync_help_text[] =
 "\n\n"
 "           *************************************************\n"
@@ -82,6 +96,8 @@ void update_fps(struct MPContext *mpctx)
     struct dec_video *d_video = mpctx->d_video;
     if (mpctx->encode_lavc_ctx && d_video)
         encode_lavc_set_video_fps(mpctx->encode_lavc_ctx, d_video->fps);
+    for (int n = 0; n < mpctx->num_encode_renditions && d_video; n++)
+        encode_lavc_set_video_fps(mpctx->encode_renditions[n], d_video->fps);
 #endif
 }
 
@@ -144,7 +160,9 @@ static void filter_reconfig(struct MPContext *mpctx,
     if (d_video->vfilter->initialized < 1)
         return;
 
-    if (params.rotate && (params.rotate % 90 == 0)) {
+    // Check the filter output, as vf_rotate can leave the rotation to the VO.
+    int rotate = d_video->vfilter->output_params.rotate;
+    if (rotate && (rotate % 90 == 0)) {
         if (!(mpctx->video_out->driver->caps & VO_CAP_ROTATE90)) {
             // Try to insert a rotation filter.
             char *args[] = {"angle", "auto", NULL};
@@ -168,6 +186,12 @@ static void filter_reconfig(struct MPContext *mpctx,
     }
 }
 
+static void wakeup_playloop(void *ctx)
+{
+    struct MPContext *mpctx = ctx;
+    mp_input_wakeup(mpctx->input);
+}
+
 static void recreate_video_filters(struct MPContext *mpctx)
 {
     struct MPOpts *opts = mpctx->opts;
@@ -177,6 +201,8 @@ static void recreate_video_filters(struct MPContext *mpctx)
     vf_destroy(d_video->vfilter);
     d_video->vfilter = vf_new(mpctx->global);
     d_video->vfilter->hwdec = d_video->hwdec_info;
+    d_video->vfilter->wakeup_cb = wakeup_playloop;
+    d_video->vfilter->wakeup_cb_ctx = mpctx;
 
     vf_append_filter_list(d_video->vfilter, opts->vf_settings);
 
@@ -207,15 +233,111 @@ int reinit_video_filters(struct MPContext *mpctx)
     return d_video->vfilter->initialized;
 }
 
+static size_t image_data_size(struct mp_image *img)
+{
+    size_t size = 0;
+    for (int n = 0; n < img->num_planes; n++)
+        size += (size_t)abs(img->stride[n]) * img->plane_h[n];
+    return size;
+}
+
+static void clear_backstep_frames(struct MPContext *mpctx)
+{
+    for (int n = 0; n < mpctx->num_backstep_frames; n++)
+        talloc_free(mpctx->backstep_frames[n]);
+    mpctx->num_backstep_frames = 0;
+    mpctx->backstep_frames_size = 0;
+    mpctx->backstep_offset = 0;
+}
+
+// Remember a filtered frame for backstepping. The cached frames must be
+// contiguous, so anything that can't be added starts a new sequence.
+static void add_backstep_frame(struct MPContext *mpctx, struct mp_image *img)
+{
+    size_t limit = (size_t)mpctx->opts->backstep_cache_size * 1024 * 1024;
+    int num = mpctx->num_backstep_frames;
+    // Hardware surfaces are usually a limited resource of the decoder.
+    if (!limit || IMGFMT_IS_HWACCEL(img->imgfmt) ||
+        img->pts == MP_NOPTS_VALUE || mpctx->backstep_offset ||
+        (num && mpctx->backstep_frames[num - 1]->pts >= img->pts))
+    {
+        clear_backstep_frames(mpctx);
+        if (!limit || IMGFMT_IS_HWACCEL(img->imgfmt) ||
+            img->pts == MP_NOPTS_VALUE)
+            return;
+    }
+    MP_TARRAY_APPEND(mpctx, mpctx->backstep_frames, mpctx->num_backstep_frames,
+                     mp_image_new_ref(img));
+    mpctx->backstep_frames_size += image_data_size(img);
+    while (mpctx->backstep_frames_size > limit &&
+           mpctx->num_backstep_frames > 1)
+    {
+        struct mp_image *old = mpctx->backstep_frames[0];
+        mpctx->backstep_frames_size -= image_data_size(old);
+        talloc_free(old);
+        MP_TARRAY_REMOVE_AT(mpctx->backstep_frames,
+                            mpctx->num_backstep_frames, 0);
+    }
+}
+
+// Whether frames before the hr-seek target are added to the backstep cache
+// (instead of being dropped before filtering).
+static bool keep_skipped_frames(struct MPContext *mpctx)
+{
+    return mpctx->hrseek_keep_frames && mpctx->opts->backstep_cache_size > 0;
+}
+
+// Display the frame dir (-1 or +1) frames away from the current frame from the
+// backstep cache. Returns 1 on success, 0 if the VO is busy (try again later),
+// and -1 if the frame is not cached.
+int video_step_cached_frame(struct MPContext *mpctx, int dir)
+{
+    struct vo *vo = mpctx->video_out;
+    int num = mpctx->num_backstep_frames;
+    if (!vo || !mpctx->d_video || !num || mpctx->hrseek_active ||
+        mpctx->video_status < STATUS_READY)
+        return -1;
+
+    int cur = num - 1 - mpctx->backstep_offset;
+    if (cur < 0 || mpctx->backstep_frames[cur]->pts != mpctx->last_vo_pts)
+        return -1;
+    int pos = cur + dir;
+    if (pos < 0 || pos >= num)
+        return -1;
+    struct mp_image *img = mpctx->backstep_frames[pos];
+    if (!vo->params || !mp_image_params_equal(&img->params, vo->params))
+        return -1;
+
+    int64_t pts = mp_time_us();
+    if (!vo_is_ready_for_frame(vo, pts))
+        return 0;
+
+    mpctx->backstep_offset = num - 1 - pos;
+    mpctx->video_pts = img->pts;
+    mpctx->last_vo_pts = mpctx->video_pts;
+    mpctx->playback_pts = mpctx->video_pts;
+
+    mpctx->osd_force_update = true;
+    update_osd_msg(mpctx);
+    update_subtitles(mpctx);
+
+    vo_queue_frame(vo, mp_image_new_ref(img), pts, -1);
+    mp_notify(mpctx, MPV_EVENT_TICK, NULL);
+    return 1;
+}
+
 void reset_video_state(struct MPContext *mpctx)
 {
     if (mpctx->d_video)
         video_reset_decoding(mpctx->d_video);
     if (mpctx->video_out)
         vo_seek_reset(mpctx->video_out);
+    for (int n = 0; n < mpctx->num_wall_outputs; n++)
+        vo_seek_reset(mpctx->wall_outputs[n]->vo);
 
     mp_image_unrefp(&mpctx->next_frame[0]);
     mp_image_unrefp(&mpctx->next_frame[1]);
+    clear_backstep_frames(mpctx);
 
     mpctx->delay = 0;
     mpctx->time_frame = 0;
@@ -229,6 +351,47 @@ void reset_video_state(struct MPContext *mpctx)
     mpctx->video_status = mpctx->d_video ? STATUS_SYNCING : STATUS_EOF;
 }
 
+// Called from the decoder thread if a new frame is available.
+static void wakeup_decoder(void *ctx)
+{
+    struct MPContext *mpctx = ctx;
+    mp_input_wakeup(mpctx->input);
+}
+
+// Destroy mpctx->d_video, or keep it for the next file.
+void uninit_video_decoder(struct MPContext *mpctx)
+{
+    struct dec_video *d_video = mpctx->d_video;
+    mpctx->d_video = NULL;
+    if (!d_video)
+        return;
+    if (mpctx->opts->video_reuse_decoder && mpctx->opts->fixed_vo &&
+        d_video->vd_driver)
+    {
+        if (mpctx->detached_d_video)
+            video_uninit(mpctx->detached_d_video);
+        video_detach(d_video);
+        mpctx->detached_d_video = d_video;
+    } else {
+        video_uninit(d_video);
+    }
+}
+
+// Return the decoder kept by uninit_video_decoder() if it can decode sh.
+static struct dec_video *reuse_video_decoder(struct MPContext *mpctx,
+                                             struct sh_stream *sh)
+{
+    struct dec_video *d_video = mpctx->detached_d_video;
+    mpctx->detached_d_video = NULL;
+    if (d_video && (d_video->vo != mpctx->video_out ||
+                    !video_reattach(d_video, sh)))
+    {
+        video_uninit(d_video);
+        d_video = NULL;
+    }
+    return d_video;
+}
+
 int reinit_video_chain(struct MPContext *mpctx)
 {
     struct MPOpts *opts = mpctx->opts;
@@ -248,7 +411,8 @@ int reinit_video_chain(struct MPContext *mpctx)
     if (!opts->fixed_vo || !(mpctx->initialized_flags & INITIALIZED_VO)) {
         mpctx->video_out = init_best_video_out(mpctx->global, mpctx->input,
                                                mpctx->osd,
-                                               mpctx->encode_lavc_ctx);
+                                               mpctx->encode_lavc_ctx,
+                                               mp_client_get_gl_cb_context(mpctx));
         if (!mpctx->video_out) {
             MP_FATAL(mpctx, "Error opening/initializing "
                     "the selected video_out (-vo) device.\n");
@@ -260,21 +424,27 @@ int reinit_video_chain(struct MPContext *mpctx)
 
     update_window_title(mpctx, true);
 
-    struct dec_video *d_video = talloc_zero(NULL, struct dec_video);
+    init_video_wall(mpctx);
+
+    struct dec_video *d_video = reuse_video_decoder(mpctx, sh);
+    bool reused = !!d_video;
+    if (!d_video) {
+        d_video = talloc_zero(NULL, struct dec_video);
+        d_video->global = mpctx->global;
+        d_video->log = mp_log_new(d_video, mpctx->log, "!vd");
+        d_video->opts = mpctx->opts;
+        d_video->header = sh;
+        d_video->fps = sh->video->fps;
+        d_video->vo = mpctx->video_out;
+        vo_control(mpctx->video_out, VOCTRL_GET_HWDEC_INFO,
+                   &d_video->hwdec_info);
+    }
     mpctx->d_video = d_video;
-    d_video->global = mpctx->global;
-    d_video->log = mp_log_new(d_video, mpctx->log, "!vd");
-    d_video->opts = mpctx->opts;
-    d_video->header = sh;
-    d_video->fps = sh->video->fps;
-    d_video->vo = mpctx->video_out;
     mpctx->initialized_flags |= INITIALIZED_VCODEC;
 
-    vo_control(mpctx->video_out, VOCTRL_GET_HWDEC_INFO, &d_video->hwdec_info);
-
     recreate_video_filters(mpctx);
 
-    if (!video_init_best_codec(d_video, opts->video_decoders))
+    if (!reused && !video_init_best_codec(d_video, opts->video_decoders))
         goto err_out;
 
     bool saver_state = opts->pause || !opts->stop_screensaver;
@@ -303,6 +473,11 @@ int reinit_video_chain(struct MPContext *mpctx)
     }
     update_fps(mpctx);
 
+    if (opts->video_decode_ahead > 0 && !sh->attached_picture) {
+        video_start_thread(d_video, opts->video_decode_ahead,
+                           wakeup_decoder, mpctx);
+    }
+
     return 1;
 
 err_out:
@@ -329,6 +504,183 @@ void mp_force_video_refresh(struct MPContext *mpctx)
         queue_seek(mpctx, MPSEEK_ABSOLUTE, mpctx->last_vo_pts, 2, true);
 }
 
+// Parse an entry of --video-wall: "<crop>[@<screen>]".
+static bool parse_wall_entry(struct MPContext *mpctx, struct wall_output *out,
+                             const char *entry)
+{
+    const m_option_t geometry_opt = {.type = &m_option_type_geometry};
+    struct bstr crop = bstr0(entry), screen = {0};
+    bstr_split_tok(crop, "@", &crop, &screen);
+
+    if (m_option_parse(mpctx->log, &geometry_opt, bstr0("video-wall"), crop,
+                       &out->crop) < 0)
+        return false;
+
+    if (screen.len) {
+        struct bstr rest;
+        long long id = bstrtoll(screen, &rest, 10);
+        if (rest.len || id < 0 || id > 32)
+            return false;
+        out->vo_opts.screen_id = id;
+        out->vo_opts.fsscreen_id = id;
+    }
+    return true;
+}
+
+static void add_wall_output(struct MPContext *mpctx, struct wall_output *out,
+                            struct encode_lavc_context *encode_lavc_ctx)
+{
+    out->vo = init_secondary_video_out(mpctx->global, mpctx->input,
+                                       mpctx->osd, encode_lavc_ctx,
+                                       &out->vo_opts);
+    if (!out->vo) {
+        MP_ERR(mpctx, "Could not create video wall output %d.\n",
+               mpctx->num_wall_outputs);
+        talloc_free(out);
+        return;
+    }
+    vo_set_paused(out->vo, mpctx->paused);
+    MP_TARRAY_APPEND(mpctx, mpctx->wall_outputs, mpctx->num_wall_outputs, out);
+}
+
+// Create the --video-wall outputs, if they don't exist yet. When encoding,
+// the --orendition outputs are created instead: they are uncropped outputs
+// with their own encoder (vo_lavc scales the frames).
+void init_video_wall(struct MPContext *mpctx)
+{
+    struct MPOpts *opts = mpctx->opts;
+
+    if (mpctx->num_wall_outputs)
+        return;
+
+    if (mpctx->encode_lavc_ctx) {
+        if (opts->video_wall && opts->video_wall[0])
+            MP_ERR(mpctx, "--video-wall can't be used with encoding.\n");
+        for (int n = 0; n < mpctx->num_encode_renditions; n++) {
+            struct wall_output *out = talloc_zero(NULL, struct wall_output);
+            out->vo_opts = opts->vo;
+            add_wall_output(mpctx, out, mpctx->encode_renditions[n]);
+        }
+        return;
+    }
+
+    for (int n = 0; opts->video_wall && opts->video_wall[n]; n++) {
+        struct wall_output *out = talloc_zero(NULL, struct wall_output);
+        out->vo_opts = opts->vo;
+        if (!parse_wall_entry(mpctx, out, opts->video_wall[n])) {
+            MP_ERR(mpctx, "Invalid --video-wall entry '%s'.\n",
+                   opts->video_wall[n]);
+            talloc_free(out);
+            continue;
+        }
+        add_wall_output(mpctx, out, NULL);
+    }
+}
+
+void uninit_video_wall(struct MPContext *mpctx)
+{
+    for (int n = 0; n < mpctx->num_wall_outputs; n++) {
+        vo_destroy(mpctx->wall_outputs[n]->vo);
+        talloc_free(mpctx->wall_outputs[n]);
+    }
+    talloc_free(mpctx->wall_outputs);
+    mpctx->wall_outputs = NULL;
+    mpctx->num_wall_outputs = 0;
+}
+
+void video_wall_set_paused(struct MPContext *mpctx, bool paused)
+{
+    for (int n = 0; n < mpctx->num_wall_outputs; n++)
+        vo_set_paused(mpctx->wall_outputs[n]->vo, paused);
+}
+
+// Return a new reference to img, cropped for the given output. Cropping only
+// changes the plane pointers, so the image data is shared.
+static struct mp_image *wall_frame(struct MPContext *mpctx,
+                                   struct wall_output *out,
+                                   struct mp_image *img)
+{
+    struct mp_image *res = mp_image_new_ref(img);
+    if (!res)
+        return NULL;
+
+    if (IMGFMT_IS_HWACCEL(img->imgfmt)) {
+        if (!out->warned_hwaccel)
+            MP_WARN(mpctx, "Can't crop hardware decoded video for the video "
+                    "wall; showing the full video.\n");
+        out->warned_hwaccel = true;
+        return res;
+    }
+
+    int x = 0, y = 0, w = img->w, h = img->h;
+    m_geometry_apply(&x, &y, &w, &h, img->w, img->h, &out->crop);
+    struct mp_rect rc = {
+        .x0 = MPCLAMP(x, 0, img->w),
+        .y0 = MPCLAMP(y, 0, img->h),
+    };
+    rc.x1 = MPCLAMP(x + w, rc.x0, img->w);
+    rc.y1 = MPCLAMP(y + h, rc.y0, img->h);
+    // The crop origin must be aligned to the chroma subsampling.
+    rc.x0 &= ~(img->fmt.align_x - 1);
+    rc.y0 &= ~(img->fmt.align_y - 1);
+    if (rc.x1 <= rc.x0 || rc.y1 <= rc.y0)
+        return res;
+
+    mp_image_crop_rc(res, rc);
+    // Keep the display aspect ratio of the cropped part.
+    res->params.d_w = MPMAX(lrint(img->params.d_w * (double)res->w / img->w), 1);
+    res->params.d_h = MPMAX(lrint(img->params.d_h * (double)res->h / img->h), 1);
+    return res;
+}
+
+// Return whether all --video-wall outputs can take img, which is to be shown
+// at pts. Outputs are (re)configured for the image if needed.
+static bool video_wall_ready(struct MPContext *mpctx, struct mp_image *img,
+                             int64_t pts)
+{
+    bool ready = true;
+    for (int n = 0; n < mpctx->num_wall_outputs; n++) {
+        struct wall_output *out = mpctx->wall_outputs[n];
+        if (out->failed)
+            continue;
+
+        struct mp_image *frame = wall_frame(mpctx, out, img);
+        if (!frame)
+            continue;
+        struct mp_image_params p = frame->params;
+        talloc_free(frame);
+
+        if (!out->vo->params || !mp_image_params_equal(&p, out->vo->params)) {
+            if (vo_reconfig(out->vo, &p, 0) < 0) {
+                MP_ERR(mpctx, "Video wall output %d failed to configure, "
+                       "disabling it.\n", n);
+                out->failed = true;
+                continue;
+            }
+        }
+        if (!vo_is_ready_for_frame(out->vo, pts))
+            ready = false;
+    }
+    return ready;
+}
+
+// Queue img on all --video-wall outputs. They use the same target time as the
+// main VO, so all outputs flip at the same time (on the same vsync, if the
+// displays are in sync).
+static void video_wall_queue_frame(struct MPContext *mpctx,
+                                   struct mp_image *img, int64_t pts,
+                                   int64_t duration)
+{
+    for (int n = 0; n < mpctx->num_wall_outputs; n++) {
+        struct wall_output *out = mpctx->wall_outputs[n];
+        if (out->failed || !out->vo->config_ok)
+            continue;
+        struct mp_image *frame = wall_frame(mpctx, out, img);
+        if (frame)
+            vo_queue_frame(out->vo, frame, pts, duration);
+    }
+}
+
 static int check_framedrop(struct MPContext *mpctx)
 {
     struct MPOpts *opts = mpctx->opts;
@@ -346,6 +698,43 @@ static int check_framedrop(struct MPContext *mpctx)
     return 0;
 }
 
+// Return the drop_frame argument to decode pkt with.
+static int get_framedrop_type(struct MPContext *mpctx, struct demux_packet *pkt)
+{
+    if ((pkt && pkt->pts >= mpctx->hrseek_pts - .005) ||
+        video_get_broken_packet_pts(mpctx->d_video) ||
+        !mpctx->opts->hr_seek_framedrop)
+    {
+        mpctx->hrseek_framedrop = false;
+    }
+    if (mpctx->scrubbing)
+        return 3;
+    bool hrseek = mpctx->hrseek_active && mpctx->video_status == STATUS_SYNCING;
+    return hrseek && mpctx->hrseek_framedrop ? 2 : check_framedrop(mpctx);
+}
+
+// Keep the decoder thread busy with packets, and take the next decoded frame.
+// Like decode_image(), but the packet the result belongs to was read earlier.
+static int decode_image_async(struct MPContext *mpctx, bool *had_packet)
+{
+    struct dec_video *d_video = mpctx->d_video;
+
+    while (video_thread_can_send(d_video)) {
+        struct demux_packet *pkt;
+        if (demux_read_packet_async(d_video->header, &pkt) == 0)
+            break;
+        if (pkt && pkt->pts != MP_NOPTS_VALUE)
+            pkt->pts += mpctx->video_offset;
+        video_thread_send(d_video, pkt, get_framedrop_type(mpctx, pkt));
+    }
+
+    int r = video_thread_receive(d_video, &d_video->waiting_decoded_mpi,
+                                 had_packet);
+    if (r == 0)
+        return VD_WAIT;
+    return r < 0 ? VD_EOF : VD_PROGRESS;
+}
+
 // Read a packet, store decoded image into d_video->waiting_decoded_mpi
 // returns VD_* code
 static int decode_image(struct MPContext *mpctx)
@@ -358,30 +747,29 @@ static int decode_image(struct MPContext *mpctx)
         return VD_EOF;
     }
 
-    struct demux_packet *pkt;
-    if (demux_read_packet_async(d_video->header, &pkt) == 0)
-        return VD_WAIT;
-    if (pkt && pkt->pts != MP_NOPTS_VALUE)
-        pkt->pts += mpctx->video_offset;
-    if ((pkt && pkt->pts >= mpctx->hrseek_pts - .005) ||
-        d_video->has_broken_packet_pts ||
-        !mpctx->opts->hr_seek_framedrop)
-    {
-        mpctx->hrseek_framedrop = false;
+    bool had_packet;
+    if (d_video->thread) {
+        int r = decode_image_async(mpctx, &had_packet);
+        if (r != VD_PROGRESS)
+            return r;
+    } else {
+        struct demux_packet *pkt;
+        if (demux_read_packet_async(d_video->header, &pkt) == 0)
+            return VD_WAIT;
+        if (pkt && pkt->pts != MP_NOPTS_VALUE)
+            pkt->pts += mpctx->video_offset;
+        d_video->waiting_decoded_mpi =
+            video_decode(d_video, pkt, get_framedrop_type(mpctx, pkt));
+        had_packet = !!pkt;
+        talloc_free(pkt);
     }
-    bool hrseek = mpctx->hrseek_active && mpctx->video_status == STATUS_SYNCING;
-    int framedrop_type = hrseek && mpctx->hrseek_framedrop ?
-                         2 : check_framedrop(mpctx);
-    d_video->waiting_decoded_mpi =
-        video_decode(d_video, pkt, framedrop_type);
-    bool had_packet = !!pkt;
-    talloc_free(pkt);
 
     if (had_packet && !d_video->waiting_decoded_mpi &&
-        mpctx->video_status == STATUS_PLAYING)
+        mpctx->video_status == STATUS_PLAYING && !mpctx->scrubbing)
     {
         mpctx->drop_frame_cnt++;
         mpctx->dropped_frames++;
+        clear_backstep_frames(mpctx);
     }
 
     return had_packet ? VD_PROGRESS : VD_EOF;
@@ -465,6 +853,20 @@ static int video_decode_and_filter(struct MPContext *mpctx)
             return r;
         if (d_video->waiting_decoded_mpi)
             d_video->decoder_output = d_video->waiting_decoded_mpi->params;
+        // Frames before the hr-seek target would be dropped after filtering
+        // anyway. Skip the filters for them if this can't change the result.
+        struct mp_image *img = d_video->waiting_decoded_mpi;
+        bool hrseek = mpctx->hrseek_active
+                   && mpctx->video_status == STATUS_SYNCING;
+        if (img && hrseek && img->pts != MP_NOPTS_VALUE &&
+            img->pts < mpctx->hrseek_pts - .005 &&
+            !keep_skipped_frames(mpctx) &&
+            vf_chain_is_trivial(d_video->vfilter))
+        {
+            add_frame_pts(mpctx, img->pts);
+            mp_image_unrefp(&d_video->waiting_decoded_mpi);
+            return VD_PROGRESS;
+        }
     }
 
     bool eof = !d_video->waiting_decoded_mpi && (r == VD_EOF || r < 0);
@@ -579,6 +981,8 @@ static int video_output_image(struct MPContext *mpctx, double endpts)
                 r = VD_EOF;
             }
             if (drop) {
+                if (hrseek && keep_skipped_frames(mpctx) && r != VD_EOF)
+                    add_backstep_frame(mpctx, img);
                 talloc_free(img);
             } else {
                 mpctx->next_frame[1] = img;
@@ -605,7 +1009,7 @@ static void update_avsync_before_frame(struct MPContext *mpctx)
         mpctx->time_frame = 0;
     } else if (mpctx->audio_status == STATUS_PLAYING &&
                mpctx->video_status == STATUS_PLAYING &&
-               !ao_untimed(mpctx->ao))
+               !ao_untimed(mpctx->ao) && !mpctx->av_resample_active)
     {
         double buffered_audio = ao_get_delay(mpctx->ao);
         MP_TRACE(mpctx, "audio delay=%f\n", buffered_audio);
@@ -631,22 +1035,67 @@ static void update_avsync_before_frame(struct MPContext *mpctx)
          * frames to catch up; continue with default speed from
          * the current frame instead.
          * If untimed is set always output frames immediately
-         * without sleeping.
+         * without sleeping. Encoding is always untimed: it should run as
+         * fast as the encoders allow.
          */
-        if (mpctx->time_frame < -0.2 || opts->untimed || vo->driver->untimed)
+        if (mpctx->time_frame < -0.2 || opts->untimed || vo->driver->untimed ||
+            mpctx->encode_lavc_ctx)
             mpctx->time_frame = 0;
     }
 }
 
+#define AV_RESAMPLE_MAX_ERROR 0.1   // seconds; beyond this, resync video
+#define AV_RESAMPLE_KP 0.1          // proportional gain (1/s)
+#define AV_RESAMPLE_KI 0.02         // integral gain (1/s^2)
+
+// --av-sync-resample: video is timed by the system clock, and a PI controller
+// makes audio play slightly faster or slower to track it. Bigger errors
+// (after seeks, or if the audio device stalls) are handled the normal way,
+// by timing video to audio again, until the difference is small.
+static void update_av_resample(struct MPContext *mpctx, double frame_time)
+{
+    struct MPOpts *opts = mpctx->opts;
+    double err = mpctx->last_av_difference;
+    double correction = 1.0;
+
+    bool active = opts->av_sync_resample && mpctx->d_audio &&
+                  mpctx->audio_status == STATUS_PLAYING &&
+                  mpctx->video_status == STATUS_PLAYING &&
+                  !ao_untimed(mpctx->ao) && err != MP_NOPTS_VALUE &&
+                  fabs(err) < AV_RESAMPLE_MAX_ERROR;
+    if (active) {
+        mpctx->av_resample_integral += err * frame_time;
+        // Audio ahead of video (err > 0) -> slow down audio.
+        double max = opts->av_sync_resample_max;
+        double adjust = AV_RESAMPLE_KP * err +
+                        AV_RESAMPLE_KI * mpctx->av_resample_integral;
+        correction = 1.0 - MPCLAMP(adjust, -max, max);
+    } else {
+        mpctx->av_resample_integral = 0;
+    }
+    mpctx->av_resample_active = active;
+
+    if (mpctx->d_audio && fabs(correction - mpctx->audio_speed_correction) > 1e-6)
+    {
+        if (af_control_any_rev(mpctx->d_audio->afilter,
+                               AF_CONTROL_SET_SPEED_CORRECTION, &correction))
+            mpctx->audio_speed_correction = correction;
+    }
+}
+
 // Update the A/V sync difference after a video frame has been shown.
 static void update_avsync_after_frame(struct MPContext *mpctx)
 {
-    mpctx->time_frame -= get_relative_time(mpctx);
+    double elapsed = get_relative_time(mpctx);
+    mpctx->time_frame -= elapsed;
     mpctx->last_av_difference = 0;
 
     if (mpctx->audio_status != STATUS_PLAYING ||
         mpctx->video_status != STATUS_PLAYING)
+    {
+        update_av_resample(mpctx, elapsed);
         return;
+    }
 
     double a_pos = playing_audio_pts(mpctx);
 
@@ -661,6 +1110,7 @@ static void update_avsync_after_frame(struct MPContext *mpctx)
         MP_WARN(mpctx, "%s", av_desync_help_text);
         mpctx->drop_message_shown = true;
     }
+    update_av_resample(mpctx, elapsed);
 }
 
 static void init_vo(struct MPContext *mpctx)
@@ -752,6 +1202,8 @@ void write_video(struct MPContext *mpctx, double endpts)
 
     if (!vo_is_ready_for_frame(vo, pts))
         return; // wait until VO wakes us up to get more frames
+    if (!video_wall_ready(mpctx, mpctx->next_frame[0], pts))
+        return;
 
     int64_t duration = -1;
     double diff = -1;
@@ -777,6 +1229,13 @@ void write_video(struct MPContext *mpctx, double endpts)
     update_osd_msg(mpctx);
     update_subtitles(mpctx);
 
+    struct mpv_frame_cb_context *frame_cb =
+        mp_client_get_frame_cb_context(mpctx);
+    if (frame_cb)
+        mp_frame_cb_deliver(frame_cb, mpctx->next_frame[0]);
+
+    add_backstep_frame(mpctx, mpctx->next_frame[0]);
+    video_wall_queue_frame(mpctx, mpctx->next_frame[0], pts, duration);
     vo_queue_frame(vo, mpctx->next_frame[0], pts, duration);
     mpctx->next_frame[0] = NULL;
 
@@ -16,9 +16,10 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-// Time in seconds the main thread waits for the cache thread. On wakeups, the
-// code checks for user requested aborts and also prints warnings that the
-// cache is being slow.
+// Time in seconds the main thread waits for the cache thread. The cache thread
+// wakes it up as soon as the data it waits for is available; the timeout is
+// used to check for user requested aborts and to print warnings that the cache
+// is being slow.
 #define CACHE_WAIT_TIME 0.5
 
 // The time the cache sleeps in idle mode. This controls how often the cache
@@ -36,6 +37,10 @@
 // Time in seconds the cache prints a new message at all.
 #define CACHE_NO_SPAM 5.0
 
+// Time in seconds over which the read speed of the underlying stream is
+// averaged. Time while the cache is idle is not included.
+#define CACHE_SPEED_INTERVAL 1.0
+
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -43,6 +48,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
 #include <assert.h>
 #include <pthread.h>
 #include <time.h>
@@ -52,9 +58,14 @@
 
 #include "config.h"
 
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #include "osdep/timer.h"
 #include "osdep/threads.h"
 
+#include "common/mem_budget.h"
 #include "common/msg.h"
 #include "common/tags.h"
 #include "options/options.h"
@@ -67,15 +78,19 @@
 struct priv {
     pthread_t cache_thread;
     bool cache_thread_running;
+    struct mp_thread_sched_opts thread_sched;
     pthread_mutex_t mutex;
-    pthread_cond_t wakeup;
+    pthread_cond_t wakeup;          // signaled to wake up the cache thread
+    pthread_cond_t reader_wakeup;   // signaled to wake up a waiting reader
 
     // Constants (as long as cache thread is running)
     // Some of these might actually be changed by a synced cache resize.
     unsigned char *buffer;  // base pointer of the allocated buffer memory
     int64_t buffer_size;    // size of the allocated buffer memory
+    int64_t block_size;     // size of each block the buffer is split into
     int64_t back_size;      // keep back_size amount of old bytes for backward seek
     int64_t seek_limit;     // keep filling cache if distance is less that seek limit
+    int64_t initial_fill;   // STREAM_CTRL_WAIT_CACHE_INITIAL waits for this
     bool seekable;          // underlying stream is seekable
 
     struct mp_log *log;
@@ -87,19 +102,38 @@ struct priv {
     // Owned by the cache thread
     stream_t *stream;       // "real" stream, used to read from the source media
 
+    struct cache_worker **workers; // for parallel reading (constant)
+    int num_workers;
+
+    struct mp_mem_user *mem; // memory budget registration (constant)
+
     // All the following members are shared between the threads.
     // You must lock the mutex to access them.
 
-    // Ringbuffer
-    int64_t min_filepos;    // range of file that is cached in the buffer
-    int64_t max_filepos;    // ... max_filepos being the last read position
+    // Block cache
+    struct cache_block *blocks; // blocks[n] uses buffer[n * block_size]
+    int num_blocks;
+    int *hash;              // block index for each bucket (see find_block())
+    int hash_mask;
+    int num_used_blocks;    // blocks with filepos >= 0
+    uint64_t use_serial;    // incremented on each block access (for LRU)
+    int64_t max_filepos;    // position of the underlying stream
     bool eof;               // true if max_filepos = EOF
-    int64_t offset;         // buffer[WRAP(s->max_filepos - offset)] corresponds
-                            // to the byte at max_filepos (must be wrapped by
-                            // buffer_size)
+    int64_t pin_start;      // file range returned by cache_read_direct(),
+    int64_t pin_end;        // which must not be evicted (empty if start=end)
 
     bool idle;              // cache thread has stopped reading
+    bool reader_waiting;    // a thread is in cache_wakeup_and_wait()
+    int64_t reader_need;    // wake the reader once the data up to this
+                            // position is cached (see notify_reader())
+    bool worker_wait;       // cache thread waits for a worker
     int64_t reads;          // number of actual read attempts performed
+    int mem_trim;           // pending enum mp_mem_trim request
+
+    double speed_start;     // start of current measurement interval, or 0
+    int64_t speed_amount;   // bytes read since speed_start
+    int64_t speed;          // last measured read speed in bytes/second, or -1
+    int64_t readahead;      // STREAM_CTRL_SET_READAHEAD limit, or 0
 
     int64_t read_filepos;   // client read position (mirrors cache->pos)
     int control;            // requested STREAM_CTRL_... or CACHE_CTRL_...
@@ -112,6 +146,8 @@ struct priv {
     int64_t stream_size;
     struct mp_tags *stream_metadata;
     double start_pts;
+    struct stream_dvb_stats dvb_stats;
+    bool has_dvb_stats;
 };
 
 enum {
@@ -119,10 +155,39 @@ enum {
 
     CACHE_CTRL_NONE = 0,
     CACHE_CTRL_QUIT = -1,
-    CACHE_CTRL_PING = -2,
 
-    // we should fill buffer only if space>=FILL_LIMIT
-    FILL_LIMIT = 16 * 1024,
+    // The buffer is split into at least MIN_BLOCKS blocks, each sized between
+    // MIN_BLOCK_SIZE and MAX_BLOCK_SIZE (a power of 2).
+    MIN_BLOCK_SIZE = 4 * 1024,
+    MAX_BLOCK_SIZE = 64 * 1024,
+    MIN_BLOCKS = 16,
+};
+
+// Each block caches a contiguous range of the file, which is located within
+// [filepos, filepos + block_size). Blocks are file position aligned, so that
+// the set of cached file ranges can be disjoint. Blocks that are not needed for
+// the current read position are evicted in LRU order.
+struct cache_block {
+    int64_t filepos;        // start of the block in the file, -1 if unused
+    int64_t start, end;     // range of valid data (filepos <= start <= end)
+    uint64_t last_use;      // value of use_serial on last access
+    int next;               // next block in the same hash bucket, or -1
+    bool fetching;          // a worker is filling the block
+};
+
+// Additional threads, which read blocks ahead of the cache thread, each using
+// a separate connection (i.e. a separate stream instance). All fields are
+// protected by the cache mutex.
+struct cache_worker {
+    struct priv *cache;
+    pthread_t thread;
+    pthread_cond_t wakeup;
+    struct mp_log *log;
+    stream_t *stream;           // opened by the worker thread on first use
+    bool failed;                // opening or seeking the stream failed
+    struct cache_block *block;  // currently assigned block (or NULL)
+    bool abort;                 // stop reading the block
+    bool terminate;
 };
 
 static int64_t mp_clipi64(int64_t val, int64_t min, int64_t max)
@@ -135,8 +200,12 @@ static int64_t mp_clipi64(int64_t val, int64_t min, int64_t max)
 // Used by the main thread to wakeup the cache thread, and to wait for the
 // cache thread. The cache mutex has to be locked when calling this function.
 // *retry_time should be set to 0 on the first call.
+// The cache thread ends the wait once the data up to the file position need is
+// cached, on EOF, or when a control was executed. (Pass INT64_MAX to wait for
+// controls only.)
 // Returns CACHE_INTERRUPTED if the caller is supposed to abort.
-static int cache_wakeup_and_wait(struct priv *s, double *retry_time)
+static int cache_wakeup_and_wait(struct priv *s, double *retry_time,
+                                 int64_t need)
 {
     if (mp_cancel_test(s->cache->cancel))
         return CACHE_INTERRUPTED;
@@ -154,18 +223,118 @@ static int cache_wakeup_and_wait(struct priv *s, double *retry_time)
         }
     }
 
+    s->reader_waiting = true;
+    s->reader_need = need;
     pthread_cond_signal(&s->wakeup);
-    mpthread_cond_timedwait_rel(&s->wakeup, &s->mutex, CACHE_WAIT_TIME);
+    mpthread_cond_timedwait_rel(&s->reader_wakeup, &s->mutex, CACHE_WAIT_TIME);
+    s->reader_waiting = false;
 
     *retry_time += mp_time_sec() - start;
 
     return 0;
 }
 
+static int64_t block_align(struct priv *s, int64_t pos)
+{
+    return pos & ~(s->block_size - 1);
+}
+
+static int hash_bucket(struct priv *s, int64_t filepos)
+{
+    return (filepos / s->block_size) & s->hash_mask;
+}
+
+// Return the block which covers the given file position, or NULL.
+static struct cache_block *find_block(struct priv *s, int64_t pos)
+{
+    if (!s->num_blocks || pos < 0)
+        return NULL;
+    int64_t filepos = block_align(s, pos);
+    for (int n = s->hash[hash_bucket(s, filepos)]; n >= 0; n = s->blocks[n].next)
+    {
+        if (s->blocks[n].filepos == filepos)
+            return &s->blocks[n];
+    }
+    return NULL;
+}
+
+static void link_block(struct priv *s, struct cache_block *b, int64_t filepos)
+{
+    int *head = &s->hash[hash_bucket(s, filepos)];
+    b->filepos = filepos;
+    b->start = b->end = filepos;
+    b->next = *head;
+    *head = b - s->blocks;
+    s->num_used_blocks++;
+}
+
+static void unlink_block(struct priv *s, struct cache_block *b)
+{
+    if (b->filepos < 0)
+        return;
+    int *cur = &s->hash[hash_bucket(s, b->filepos)];
+    while (*cur != b - s->blocks)
+        cur = &s->blocks[*cur].next;
+    *cur = b->next;
+    b->filepos = -1;
+    b->next = -1;
+    s->num_used_blocks--;
+}
+
+static unsigned char *block_data(struct priv *s, struct cache_block *b,
+                                 int64_t pos)
+{
+    return s->buffer + (b - s->blocks) * s->block_size + (pos - b->filepos);
+}
+
+// Return the first file position >= pos which is not in the cache.
+static int64_t cached_end(struct priv *s, int64_t pos)
+{
+    for (;;) {
+        struct cache_block *b = find_block(s, pos);
+        if (!b || pos < b->start || pos >= b->end)
+            return pos;
+        pos = b->end;
+    }
+}
+
+// Max. number of bytes the cache reads ahead of the current read position.
+// The rest is used for the backbuffer and for other cached ranges. The player
+// can lower it with STREAM_CTRL_SET_READAHEAD, but not below what the initial
+// fill and small forward seeks need.
+static int64_t readahead_limit(struct priv *s)
+{
+    int64_t limit = s->buffer_size - s->back_size;
+    if (s->readahead > 0) {
+        int64_t min = MPMAX(s->initial_fill, s->seek_limit + s->block_size);
+        limit = MPMIN(limit, MPMAX(s->readahead, min));
+    }
+    return limit;
+}
+
+// Wake up the waiting reader unconditionally (e.g. a control was executed).
+static void wakeup_reader(struct priv *s)
+{
+    s->reader_waiting = false;
+    pthread_cond_signal(&s->reader_wakeup);
+}
+
+// Called after new data was cached. To avoid waking up the reader for each
+// small read, this does nothing until the amount of data the reader asked for
+// is available.
+static void notify_reader(struct priv *s)
+{
+    if (s->reader_waiting &&
+        (s->eof || cached_end(s, s->read_filepos) >= s->reader_need))
+        wakeup_reader(s);
+}
+
 // Runs in the cache thread
 static void cache_drop_contents(struct priv *s)
 {
-    s->offset = s->min_filepos = s->max_filepos = s->read_filepos;
+    for (int n = 0; n < s->num_blocks; n++)
+        unlink_block(s, &s->blocks[n]);
+    s->max_filepos = s->read_filepos;
     s->eof = false;
     s->start_pts = MP_NOPTS_VALUE;
 }
@@ -179,94 +348,246 @@ static size_t read_buffer(struct priv *s, unsigned char *dst,
 {
     size_t read = 0;
     while (read < dst_size) {
-        if (pos >= s->max_filepos || pos < s->min_filepos)
+        struct cache_block *b = find_block(s, pos);
+        if (!b || pos < b->start || pos >= b->end)
             break;
-        int64_t newb = s->max_filepos - pos; // new bytes in the buffer
-
-        int64_t bpos = pos - s->offset; // file pos to buffer memory pos
-        if (bpos < 0) {
-            bpos += s->buffer_size;
-        } else if (bpos >= s->buffer_size) {
-            bpos -= s->buffer_size;
-        }
-
-        if (newb > s->buffer_size - bpos)
-            newb = s->buffer_size - bpos; // handle wrap...
-
-        newb = MPMIN(newb, dst_size - read);
-
+        int64_t newb = MPMIN(b->end - pos, dst_size - read);
         assert(newb >= 0 && read + newb <= dst_size);
-        assert(bpos >= 0 && bpos + newb <= s->buffer_size);
-        memcpy(&dst[read], &s->buffer[bpos], newb);
+        memcpy(&dst[read], block_data(s, b, pos), newb);
+        b->last_use = ++s->use_serial;
         read += newb;
         pos += newb;
     }
     return read;
 }
 
+// Get a free block for the given (aligned) file position, possibly evicting the
+// least recently used block. Data ahead of the read position (up to filepos,
+// or the readahead limit) is never evicted, and the backbuffer only if nothing
+// else is available.
 // Runs in the cache thread.
-// Returns true if reading was attempted, and the mutex was shortly unlocked.
-static bool cache_fill(struct priv *s)
+static struct cache_block *alloc_block(struct priv *s, int64_t filepos)
 {
     int64_t read = s->read_filepos;
-    int len = 0;
-
-    // drop cache contents only if seeking backward or too much fwd.
-    // This is also done for on-disk files, since it loses the backseek cache.
-    // That in turn can cause major bandwidth increase and performance
-    // issues with e.g. mov or badly interleaved files
-    if (read < s->min_filepos || read > s->max_filepos + s->seek_limit) {
-        MP_VERBOSE(s, "Dropping cache at pos %"PRId64", "
-                   "cached range: %"PRId64"-%"PRId64".\n", read,
-                   s->min_filepos, s->max_filepos);
-        cache_drop_contents(s);
+    int64_t ahead = MPMAX(filepos, read + readahead_limit(s));
+    struct cache_block *victim = NULL, *back_victim = NULL;
+    for (int n = 0; n < s->num_blocks; n++) {
+        struct cache_block *b = &s->blocks[n];
+        if (b->filepos < 0) {
+            victim = b;
+            break;
+        }
+        if (b->filepos + s->block_size > read && b->filepos < ahead)
+            continue; // readahead
+        if (b->filepos + s->block_size > s->pin_start && b->filepos < s->pin_end)
+            continue;
+        if (b->fetching)
+            continue;
+        if (b->filepos + s->block_size > read - s->back_size && b->filepos < read)
+        {
+            if (!back_victim || b->last_use < back_victim->last_use)
+                back_victim = b;
+            continue;
+        }
+        if (!victim || b->last_use < victim->last_use)
+            victim = b;
+    }
+    if (!victim)
+        victim = back_victim;
+    if (victim) {
+        if (victim->filepos >= 0) {
+            MP_DBG(s, "Evicting cached range %"PRId64"-%"PRId64".\n",
+                   victim->start, victim->end);
+        }
+        unlink_block(s, victim);
+        link_block(s, victim, filepos);
     }
+    return victim;
+}
 
-    if (stream_tell(s->stream) != s->max_filepos && s->seekable) {
-        MP_VERBOSE(s, "Seeking underlying stream: %"PRId64" -> %"PRId64"\n",
-                   stream_tell(s->stream), s->max_filepos);
-        stream_seek(s->stream, s->max_filepos);
-        if (stream_tell(s->stream) != s->max_filepos)
-            goto done;
+static void *worker_thread(void *arg)
+{
+    struct cache_worker *w = arg;
+    struct priv *s = w->cache;
+    pthread_mutex_lock(&s->mutex);
+    while (!w->terminate) {
+        struct cache_block *b = w->block;
+        if (!b) {
+            pthread_cond_wait(&w->wakeup, &s->mutex);
+            continue;
+        }
+        int64_t pos = b->end;
+        pthread_mutex_unlock(&s->mutex);
+        if (!w->stream && !w->failed) {
+            w->stream = stream_create(s->stream->url, STREAM_READ | STREAM_NO_FILTERS,
+                                      s->stream->cancel, s->stream->global);
+        }
+        bool ok = w->stream && stream_seek(w->stream, pos) &&
+                  stream_tell(w->stream) == pos;
+        pthread_mutex_lock(&s->mutex);
+        if (!ok) {
+            MP_WARN(w, "Could not open or seek additional connection.\n");
+            w->failed = true;
+        }
+        while (ok && !w->abort && !w->terminate &&
+               b->end < b->filepos + s->block_size)
+        {
+            int64_t space = b->filepos + s->block_size - b->end;
+            space = FFMIN(space, w->stream->read_chunk);
+            unsigned char *dst = block_data(s, b, b->end);
+            pthread_mutex_unlock(&s->mutex);
+            int len = stream_read_partial(w->stream, dst, space);
+            pthread_mutex_lock(&s->mutex);
+            if (len <= 0)
+                break;
+            b->end += len;
+            s->speed_amount += len;
+            notify_reader(s);
+        }
+        b->fetching = false;
+        w->block = NULL;
+        // Wake up the cache thread if it's waiting for this block.
+        pthread_cond_broadcast(&s->wakeup);
+        notify_reader(s);
     }
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
 
-    // number of buffer bytes which should be preserved in backwards direction
-    int64_t back = mp_clipi64(read - s->min_filepos, 0, s->back_size);
+// Make idle workers read blocks ahead of fill_pos, which are not cached yet.
+// Runs in the cache thread.
+static void dispatch_workers(struct priv *s, int64_t fill_pos)
+{
+    if (!s->num_workers || s->stream_size < 0)
+        return;
+    int64_t limit = MPMIN(s->read_filepos + readahead_limit(s), s->stream_size);
+    int64_t pos = block_align(s, fill_pos) + s->block_size;
+    for (int n = 0; n < s->num_workers; n++) {
+        struct cache_worker *w = s->workers[n];
+        if (w->block || w->failed)
+            continue;
+        while (pos < limit && find_block(s, pos))
+            pos += s->block_size;
+        if (pos >= limit)
+            break;
+        struct cache_block *b = alloc_block(s, pos);
+        if (!b)
+            break;
+        b->fetching = true;
+        b->last_use = ++s->use_serial;
+        w->block = b;
+        pthread_cond_signal(&w->wakeup);
+        pos += s->block_size;
+    }
+}
 
-    // number of buffer bytes that are valid and can be read
-    int64_t newb = FFMAX(s->max_filepos - read, 0);
+// Wait until no worker is reading. Runs in the cache thread.
+static void stop_workers(struct priv *s)
+{
+    for (int n = 0; n < s->num_workers; n++) {
+        struct cache_worker *w = s->workers[n];
+        w->abort = true;
+        while (w->block)
+            pthread_cond_wait(&s->wakeup, &s->mutex);
+        w->abort = false;
+    }
+}
 
-    // max. number of bytes that can be written (starting from max_filepos)
-    int64_t space = s->buffer_size - (newb + back);
+// Runs in the cache thread.
+// Returns true if reading was attempted, and the mutex was shortly unlocked.
+static bool cache_fill(struct priv *s)
+{
+    int64_t read = s->read_filepos;
+    int len = 0;
 
-    // offset into the buffer that maps to max_filepos
-    int pos = s->max_filepos - s->offset;
-    if (pos >= s->buffer_size)
-        pos -= s->buffer_size; // wrap-around
+    s->worker_wait = false;
+
+    // First byte at or after the read position that is not cached yet. If
+    // the read position is in a range that was cached before (e.g. after
+    // seeking back), this skips the already cached data.
+    int64_t fill_pos = cached_end(s, read);
+
+    if (!s->seekable) {
+        // Data can be appended only at the current stream position.
+        fill_pos = s->max_filepos;
+    } else if (s->max_filepos < fill_pos &&
+               fill_pos - s->max_filepos <= s->seek_limit &&
+               cached_end(s, s->max_filepos) == s->max_filepos)
+    {
+        // Small forward seek: keep reading instead of seeking the stream.
+        fill_pos = s->max_filepos;
+    }
 
-    if (space < FILL_LIMIT) {
+    if (fill_pos - read >= readahead_limit(s)) {
         s->idle = true;
+        s->speed_start = 0;
         s->reads++; // don't stuck main thread
         return false;
     }
 
-    // limit to end of buffer (without wrapping)
-    if (pos + space >= s->buffer_size)
-        space = s->buffer_size - pos;
+    dispatch_workers(s, fill_pos);
+
+    struct cache_block *b = find_block(s, fill_pos);
+    if (b && b->fetching) {
+        // Wait until the worker is done.
+        s->worker_wait = true;
+        return false;
+    }
+    if (b && fill_pos != b->end) {
+        // The block contains data not contiguous to fill_pos. If possible,
+        // fill the hole after the valid data, otherwise drop the block data.
+        if (s->seekable && fill_pos > b->end) {
+            fill_pos = b->end;
+        } else {
+            b->start = b->end = fill_pos;
+        }
+    }
+    if (!b) {
+        b = alloc_block(s, block_align(s, fill_pos));
+        if (!b) {
+            s->idle = true;
+            s->reads++;
+            return false;
+        }
+        b->start = b->end = fill_pos;
+    }
+    b->last_use = ++s->use_serial;
+
+    if (stream_tell(s->stream) != fill_pos && s->seekable) {
+        MP_VERBOSE(s, "Seeking underlying stream: %"PRId64" -> %"PRId64"\n",
+                   stream_tell(s->stream), fill_pos);
+        stream_seek(s->stream, fill_pos);
+        s->max_filepos = stream_tell(s->stream);
+        if (s->max_filepos != fill_pos)
+            goto done;
+    }
+
+    // max. number of bytes that can be written (without leaving the block)
+    int64_t space = b->filepos + s->block_size - fill_pos;
 
     // limit read size (or else would block and read the entire buffer in 1 call)
     space = FFMIN(space, s->stream->read_chunk);
 
-    // back+newb+space <= buffer_size
-    int64_t back2 = s->buffer_size - (space + newb); // max back size
-    if (s->min_filepos < (read - back2))
-        s->min_filepos = read - back2;
+    if (!s->speed_start) {
+        s->speed_start = mp_time_sec();
+        s->speed_amount = 0;
+    }
 
     // The read call might take a long time and block, so drop the lock.
+    // Only the cache thread changes blocks, and readers access only the
+    // already valid data of the block.
     pthread_mutex_unlock(&s->mutex);
-    len = stream_read_partial(s->stream, &s->buffer[pos], space);
+    len = stream_read_partial(s->stream, block_data(s, b, fill_pos), space);
     pthread_mutex_lock(&s->mutex);
 
+    s->speed_amount += MPMAX(len, 0);
+    double now = mp_time_sec();
+    if (now - s->speed_start >= CACHE_SPEED_INTERVAL) {
+        s->speed = s->speed_amount / (now - s->speed_start);
+        s->speed_start = now;
+        s->speed_amount = 0;
+    }
+
     // Do this after reading a block, because at least libdvdnav updates the
     // stream position only after actually reading something after a seek.
     if (s->start_pts == MP_NOPTS_VALUE) {
@@ -275,28 +596,98 @@ static bool cache_fill(struct priv *s)
             s->start_pts = pts;
     }
 
-    s->max_filepos += len;
-    if (pos + len == s->buffer_size)
-        s->offset += s->buffer_size; // wrap...
+    if (len > 0)
+        b->end += len;
+    s->max_filepos = fill_pos + MPMAX(len, 0);
 
 done:
     s->eof = len <= 0;
     s->idle = s->eof;
     s->reads++;
+    if (s->idle)
+        s->speed_start = 0;
     if (s->eof)
         MP_VERBOSE(s, "EOF reached.\n");
 
-    pthread_cond_signal(&s->wakeup);
+    notify_reader(s);
 
     return true;
 }
 
+// Return the memory of an evicted block to the OS. The buffer is allocated
+// once, so the pages would stay resident until the cache is destroyed.
+static void release_block(struct priv *s, struct cache_block *b)
+{
+#if HAVE_SYS_MMAN_H && defined(MADV_DONTNEED)
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0)
+        return;
+    uintptr_t start = (uintptr_t)(s->buffer + (b - s->blocks) * s->block_size);
+    uintptr_t end = start + s->block_size;
+    start = (start + page - 1) & ~(uintptr_t)(page - 1);
+    end &= ~(uintptr_t)(page - 1);
+    if (end > start)
+        madvise((void *)start, end - start, MADV_DONTNEED);
+#endif
+}
+
+// Handle a memory trim request (see mp_mem_user_new()). A soft trim drops the
+// cached ranges away from the read position, a hard trim also drops the
+// backbuffer. Runs in the cache thread.
+static void cache_trim(struct priv *s)
+{
+    int level = s->mem_trim;
+    s->mem_trim = MP_MEM_TRIM_NONE;
+
+    int64_t read = s->read_filepos;
+    int64_t ahead = read + readahead_limit(s);
+    int64_t back = level == MP_MEM_TRIM_HARD ? read : read - s->back_size;
+    int64_t dropped = 0;
+    for (int n = 0; n < s->num_blocks; n++) {
+        struct cache_block *b = &s->blocks[n];
+        if (b->filepos < 0 || b->fetching)
+            continue;
+        if (b->filepos + s->block_size > back && b->filepos < ahead)
+            continue;
+        if (b->filepos + s->block_size > s->pin_start && b->filepos < s->pin_end)
+            continue;
+        unlink_block(s, b);
+        release_block(s, b);
+        dropped += s->block_size;
+    }
+    MP_VERBOSE(s, "Memory trim: dropped %"PRId64" KiB.\n", dropped / 1024);
+}
+
+// Called by the memory budget monitor thread.
+static void cache_mem_trim(void *ctx, enum mp_mem_trim level)
+{
+    struct priv *s = ctx;
+    pthread_mutex_lock(&s->mutex);
+    s->mem_trim = MPMAX(s->mem_trim, level);
+    pthread_cond_signal(&s->wakeup);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+static int compare_last_use(const void *pa, const void *pb)
+{
+    const struct cache_block *a = *(struct cache_block **)pa;
+    const struct cache_block *b = *(struct cache_block **)pb;
+    return a->last_use < b->last_use ? 1 : (a->last_use > b->last_use ? -1 : 0);
+}
+
 // This is called both during init and at runtime.
 static int resize_cache(struct priv *s, int64_t size)
 {
-    int64_t min_size = FILL_LIMIT * 4;
+    if (!s->block_size) {
+        s->block_size = MAX_BLOCK_SIZE;
+        while (s->block_size > MIN_BLOCK_SIZE && size / s->block_size < MIN_BLOCKS)
+            s->block_size /= 2;
+    }
+    int64_t min_size = s->block_size * MIN_BLOCKS;
     int64_t max_size = ((size_t)-1) / 4;
     int64_t buffer_size = MPMIN(MPMAX(size, min_size), max_size);
+    int num_blocks = MPMIN(buffer_size / s->block_size, INT_MAX / 2);
+    buffer_size = num_blocks * s->block_size;
 
     unsigned char *buffer = malloc(buffer_size);
     if (!buffer) {
@@ -304,44 +695,66 @@ static int resize_cache(struct priv *s, int64_t size)
         return STREAM_ERROR;
     }
 
-    if (s->buffer) {
-        // Copy & free the old ringbuffer data.
-        // If the buffer is too small, prefer to copy these regions:
-        // 1. Data starting from read_filepos, until cache end
-        size_t read_1 = read_buffer(s, buffer, buffer_size, s->read_filepos);
-        // 2. then data from before read_filepos until cache start
-        //    (this one needs to be copied to the end of the ringbuffer)
-        size_t read_2 = 0;
-        if (s->min_filepos < s->read_filepos) {
-            size_t copy_len = buffer_size - read_1;
-            copy_len = MPMIN(copy_len, s->read_filepos - s->min_filepos);
-            assert(copy_len + read_1 <= buffer_size);
-            read_2 = read_buffer(s, buffer + buffer_size - copy_len, copy_len,
-                                 s->read_filepos - copy_len);
-            // This shouldn't happen, unless copy_len was computed incorrectly.
-            assert(read_2 == copy_len);
-        }
-        // Set it up such that read_1 is at buffer pos 0, and read_2 wraps
-        // around below it, so that it is located at the end of the buffer.
-        s->min_filepos = s->read_filepos - read_2;
-        s->max_filepos = s->read_filepos + read_1;
-        s->offset = s->max_filepos - read_1;
-    } else {
-        cache_drop_contents(s);
+    int hash_size = 1;
+    while (hash_size < num_blocks)
+        hash_size *= 2;
+
+    struct cache_block *blocks = talloc_array(s, struct cache_block, num_blocks);
+    int *hash = talloc_array(s, int, hash_size);
+    for (int n = 0; n < num_blocks; n++)
+        blocks[n] = (struct cache_block){.filepos = -1, .next = -1};
+    for (int n = 0; n < hash_size; n++)
+        hash[n] = -1;
+
+    struct cache_block *old_blocks = s->blocks;
+    int old_num_blocks = s->num_blocks;
+    unsigned char *old_buffer = s->buffer;
+
+    // Sort the old blocks by last access (most recent first).
+    struct cache_block **order = talloc_array(NULL, struct cache_block *,
+                                              old_num_blocks);
+    int num_order = 0;
+    for (int n = 0; n < old_num_blocks; n++) {
+        if (old_blocks[n].filepos >= 0)
+            order[num_order++] = &old_blocks[n];
     }
+    qsort(order, num_order, sizeof(order[0]), compare_last_use);
 
-    free(s->buffer);
-
+    s->buffer = buffer;
     s->buffer_size = buffer_size;
+    s->blocks = blocks;
+    s->num_blocks = num_blocks;
+    s->hash = hash;
+    s->hash_mask = hash_size - 1;
+    s->num_used_blocks = 0;
+
+    // Copy the most recently used blocks, if the new buffer is too small.
+    for (int n = 0; n < MPMIN(num_order, num_blocks); n++) {
+        struct cache_block *old = order[n];
+        struct cache_block *b = &blocks[n];
+        link_block(s, b, old->filepos);
+        b->start = old->start;
+        b->end = old->end;
+        b->last_use = old->last_use;
+        memcpy(block_data(s, b, b->start),
+               old_buffer + (old - old_blocks) * s->block_size +
+               (old->start - old->filepos), b->end - b->start);
+    }
+
+    talloc_free(order);
+    talloc_free(old_blocks);
+    free(old_buffer);
+
+    s->pin_start = s->pin_end = 0;
+
     s->back_size = buffer_size / 2;
-    s->buffer = buffer;
     s->idle = false;
     s->eof = false;
 
     //make sure that we won't wait from cache_fill
     //more data than it is allowed to fill
-    if (s->seek_limit > s->buffer_size - FILL_LIMIT)
-        s->seek_limit = s->buffer_size - FILL_LIMIT;
+    if (s->seek_limit > readahead_limit(s) - s->block_size)
+        s->seek_limit = readahead_limit(s) - s->block_size;
 
     return STREAM_OK;
 }
@@ -361,6 +774,8 @@ static void update_cached_controls(struct priv *s)
     s->stream_size = -1;
     if (stream_control(s->stream, STREAM_CTRL_GET_SIZE, &i64) == STREAM_OK)
         s->stream_size = i64;
+    s->has_dvb_stats = stream_control(s->stream, STREAM_CTRL_GET_DVB_STATS,
+                                      &s->dvb_stats) == STREAM_OK;
 }
 
 // the core might call these every frame, so cache them...
@@ -372,11 +787,16 @@ static int cache_get_cached_control(stream_t *cache, int cmd, void *arg)
         *(int64_t *)arg = s->buffer_size;
         return STREAM_OK;
     case STREAM_CTRL_GET_CACHE_FILL:
-        *(int64_t *)arg = s->max_filepos - s->read_filepos;
+        *(int64_t *)arg = cached_end(s, s->read_filepos) - s->read_filepos;
         return STREAM_OK;
     case STREAM_CTRL_GET_CACHE_IDLE:
         *(int *)arg = s->idle;
         return STREAM_OK;
+    case STREAM_CTRL_GET_CACHE_SPEED:
+        if (s->speed < 0)
+            return STREAM_UNSUPPORTED;
+        *(int64_t *)arg = s->speed;
+        return STREAM_OK;
     case STREAM_CTRL_GET_TIME_LENGTH:
         *(double *)arg = s->stream_time_length;
         return s->stream_time_length ? STREAM_OK : STREAM_UNSUPPORTED;
@@ -385,6 +805,11 @@ static int cache_get_cached_control(stream_t *cache, int cmd, void *arg)
             return STREAM_UNSUPPORTED;
         *(int64_t *)arg = s->stream_size;
         return STREAM_OK;
+    case STREAM_CTRL_GET_DVB_STATS:
+        if (!s->has_dvb_stats)
+            return STREAM_UNSUPPORTED;
+        *(struct stream_dvb_stats *)arg = s->dvb_stats;
+        return STREAM_OK;
     case STREAM_CTRL_GET_CURRENT_TIME: {
         if (s->start_pts == MP_NOPTS_VALUE)
             return STREAM_UNSUPPORTED;
@@ -404,6 +829,11 @@ static int cache_get_cached_control(stream_t *cache, int cmd, void *arg)
         s->idle = s->eof = false;
         pthread_cond_signal(&s->wakeup);
         return STREAM_OK;
+    case STREAM_CTRL_SET_READAHEAD:
+        s->readahead = MPMAX(*(int64_t *)arg, 0);
+        s->idle = false;
+        pthread_cond_signal(&s->wakeup);
+        return STREAM_OK;
     }
     return STREAM_ERROR;
 }
@@ -429,6 +859,8 @@ static void cache_execute_control(struct priv *s)
     uint64_t old_pos = stream_tell(s->stream);
     s->control_flush = false;
 
+    stop_workers(s);
+
     switch (s->control) {
     case STREAM_CTRL_SET_CACHE_SIZE:
         s->control_res = resize_cache(s, *(int64_t *)s->control_arg);
@@ -451,12 +883,13 @@ static void cache_execute_control(struct priv *s)
 
     update_cached_controls(s);
     s->control = CACHE_CTRL_NONE;
-    pthread_cond_signal(&s->wakeup);
+    wakeup_reader(s);
 }
 
 static void *cache_thread(void *arg)
 {
     struct priv *s = arg;
+    mpthread_set_sched(s->log, s->thread_sched.priority, s->thread_sched.cpu);
     pthread_mutex_lock(&s->mutex);
     update_cached_controls(s);
     double last = mp_time_sec();
@@ -470,14 +903,14 @@ static void *cache_thread(void *arg)
         } else {
             cache_fill(s);
         }
-        if (s->control == CACHE_CTRL_PING) {
-            pthread_cond_signal(&s->wakeup);
-            s->control = CACHE_CTRL_NONE;
-        }
-        if (s->idle && s->control == CACHE_CTRL_NONE)
+        if (s->mem_trim)
+            cache_trim(s);
+        mp_mem_user_set_usage(s->mem, s->num_used_blocks * s->block_size);
+        if ((s->idle || s->worker_wait) && s->control == CACHE_CTRL_NONE)
             mpthread_cond_timedwait_rel(&s->wakeup, &s->mutex, CACHE_IDLE_SLEEP_TIME);
     }
-    pthread_cond_signal(&s->wakeup);
+    stop_workers(s);
+    wakeup_reader(s);
     pthread_mutex_unlock(&s->mutex);
     MP_VERBOSE(s, "Cache exiting...\n");
     return NULL;
@@ -493,6 +926,8 @@ static int cache_fill_buffer(struct stream *cache, char *buffer, int max_len)
     if (cache->pos != s->read_filepos)
         MP_ERR(s, "!!! read_filepos differs !!! report this bug...\n");
 
+    s->pin_start = s->pin_end = 0;
+
     int readb = 0;
     if (max_len > 0) {
         double retry_time = 0;
@@ -505,7 +940,8 @@ static int cache_fill_buffer(struct stream *cache, char *buffer, int max_len)
             if (s->eof && s->read_filepos >= s->max_filepos && s->reads >= retry)
                 break;
             s->idle = false;
-            if (cache_wakeup_and_wait(s, &retry_time) == CACHE_INTERRUPTED)
+            if (cache_wakeup_and_wait(s, &retry_time, s->read_filepos + 1) ==
+                    CACHE_INTERRUPTED)
                 break;
         }
     }
@@ -516,6 +952,46 @@ static int cache_fill_buffer(struct stream *cache, char *buffer, int max_len)
     return readb;
 }
 
+// Return a pointer to len bytes of cached data at the read position, without
+// copying it. This fails if the data is not cached, or is not contiguous in
+// memory (e.g. because it crosses the end of the buffer memory). The data stays
+// valid until the next call on the cache stream.
+static int cache_read_direct(struct stream *cache, void **data, int len)
+{
+    struct priv *s = cache->priv;
+    assert(s->cache_thread_running);
+    int r = 0;
+
+    pthread_mutex_lock(&s->mutex);
+
+    s->pin_start = s->pin_end = 0;
+
+    int64_t pos = s->read_filepos;
+    struct cache_block *b = find_block(s, pos);
+    if (b && pos >= b->start && pos < b->end) {
+        // Consecutive file blocks are usually also consecutive in memory.
+        struct cache_block *last = b;
+        while (last->end - pos < len && last->end == last->filepos + s->block_size
+               && last + 1 < s->blocks + s->num_blocks &&
+               last[1].filepos == last->end && last[1].start == last->end)
+            last++;
+        if (last->end - pos >= len) {
+            for (struct cache_block *cur = b; cur <= last; cur++)
+                cur->last_use = ++s->use_serial;
+            *data = block_data(s, b, pos);
+            s->pin_start = pos;
+            s->pin_end = pos + len;
+            s->read_filepos += len;
+            r = len;
+        }
+    }
+
+    // wakeup the cache thread, possibly make it read more data ahead
+    pthread_cond_signal(&s->wakeup);
+    pthread_mutex_unlock(&s->mutex);
+    return r;
+}
+
 static int cache_seek(stream_t *cache, int64_t pos)
 {
     struct priv *s = cache->priv;
@@ -524,14 +1000,18 @@ static int cache_seek(stream_t *cache, int64_t pos)
 
     pthread_mutex_lock(&s->mutex);
 
-    MP_DBG(s, "request seek: %" PRId64 " <= to=%" PRId64
-           " (cur=%" PRId64 ") <= %" PRId64 "  \n",
-           s->min_filepos, pos, s->read_filepos, s->max_filepos);
+    s->pin_start = s->pin_end = 0;
+
+    MP_DBG(s, "request seek: to=%" PRId64 " (cur=%" PRId64 ", "
+           "stream=%" PRId64 ", cached until %" PRId64 ")\n", pos,
+           s->read_filepos, s->max_filepos, cached_end(s, pos));
 
     if (!s->seekable && pos > s->max_filepos) {
         MP_ERR(s, "Attempting to seek past cached data in unseekable stream.\n");
         r = 0;
-    } else if (!s->seekable && pos < s->min_filepos) {
+    } else if (!s->seekable && pos < s->max_filepos &&
+               cached_end(s, pos) == pos)
+    {
         MP_ERR(s, "Attempting to seek before cached data in unseekable stream.\n");
         r = 0;
     } else {
@@ -545,6 +1025,32 @@ static int cache_seek(stream_t *cache, int64_t pos)
     return r;
 }
 
+// Wait until the cache is filled with at least initial_fill bytes. This is
+// done only once, after the demuxer was opened: probing the demuxers doesn't
+// need to wait for the prefill, and can run while the cache is filling.
+static int wait_initial_fill(struct priv *s)
+{
+    int64_t min = s->initial_fill;
+    s->initial_fill = 0;
+    if (min < 1)
+        return STREAM_OK;
+    for (;;) {
+        if (mp_cancel_test(s->cache->cancel))
+            return STREAM_ERROR;
+        int64_t fill = cached_end(s, s->read_filepos) - s->read_filepos;
+        MP_INFO(s, "\rCache fill: %5.2f%% "
+                "(%" PRId64 " bytes)   ", 100.0 * fill / s->buffer_size, fill);
+        if (fill >= min)
+            break;
+        if (s->idle)
+            break;    // file is smaller than prefill size
+        // Wake up if the cache is filled enough (or on EOF/timeout/abort)
+        cache_wakeup_and_wait(s, &(double){0}, s->read_filepos + min);
+    }
+    MP_INFO(s, "\n");
+    return STREAM_OK;
+}
+
 static int cache_control(stream_t *cache, int cmd, void *arg)
 {
     struct priv *s = cache->priv;
@@ -554,17 +1060,24 @@ static int cache_control(stream_t *cache, int cmd, void *arg)
 
     pthread_mutex_lock(&s->mutex);
 
+    if (cmd == STREAM_CTRL_WAIT_CACHE_INITIAL) {
+        r = wait_initial_fill(s);
+        goto done;
+    }
+
     r = cache_get_cached_control(cache, cmd, arg);
     if (r != STREAM_ERROR)
         goto done;
 
     MP_VERBOSE(s, "blocking for STREAM_CTRL %d\n", cmd);
 
+    s->pin_start = s->pin_end = 0;
+
     s->control = cmd;
     s->control_arg = arg;
     double retry = 0;
     while (s->control != CACHE_CTRL_NONE) {
-        if (cache_wakeup_and_wait(s, &retry) == CACHE_INTERRUPTED) {
+        if (cache_wakeup_and_wait(s, &retry, INT64_MAX) == CACHE_INTERRUPTED) {
             s->eof = 1;
             r = STREAM_UNSUPPORTED;
             goto done;
@@ -593,8 +1106,20 @@ static void cache_uninit(stream_t *cache)
         pthread_mutex_unlock(&s->mutex);
         pthread_join(s->cache_thread, NULL);
     }
+    talloc_free(s->mem);
+    for (int n = 0; n < s->num_workers; n++) {
+        struct cache_worker *w = s->workers[n];
+        pthread_mutex_lock(&s->mutex);
+        w->terminate = true;
+        pthread_cond_signal(&w->wakeup);
+        pthread_mutex_unlock(&s->mutex);
+        pthread_join(w->thread, NULL);
+        pthread_cond_destroy(&w->wakeup);
+        free_stream(w->stream);
+    }
     pthread_mutex_destroy(&s->mutex);
     pthread_cond_destroy(&s->wakeup);
+    pthread_cond_destroy(&s->reader_wakeup);
     free(s->buffer);
     talloc_free(s);
 }
@@ -609,10 +1134,12 @@ int stream_cache_init(stream_t *cache, stream_t *stream,
 
     struct priv *s = talloc_zero(NULL, struct priv);
     s->log = cache->log;
+    s->speed = -1;
 
     cache_drop_contents(s);
 
     s->seek_limit = opts->seek_min * 1024ULL;
+    s->thread_sched = opts->thread_sched;
 
     if (resize_cache(s, opts->size * 1024ULL) != STREAM_OK) {
         MP_ERR(s, "Failed to allocate cache buffer.\n");
@@ -625,22 +1152,47 @@ int stream_cache_init(stream_t *cache, stream_t *stream,
 
     pthread_mutex_init(&s->mutex, NULL);
     pthread_cond_init(&s->wakeup, NULL);
+    pthread_cond_init(&s->reader_wakeup, NULL);
 
     cache->priv = s;
     s->cache = cache;
     s->stream = stream;
 
+    s->mem = mp_mem_user_new(NULL, "cache", cache_mem_trim, s);
+
     cache->seek = cache_seek;
     cache->fill_buffer = cache_fill_buffer;
+    cache->read_direct = cache_read_direct;
     cache->control = cache_control;
     cache->close = cache_uninit;
 
     int64_t min = opts->initial * 1024ULL;
-    if (min > s->buffer_size - FILL_LIMIT)
-        min = s->buffer_size - FILL_LIMIT;
+    if (min > readahead_limit(s) - s->block_size)
+        min = readahead_limit(s) - s->block_size;
 
     s->seekable = stream->seekable;
 
+    // Parallel reading requires opening the same URL again, which makes sense
+    // only for plain network streams.
+    int64_t size = -1;
+    stream_control(stream, STREAM_CTRL_GET_SIZE, &size);
+    if (opts->connections > 1 && stream->seekable && stream->is_network &&
+        !stream->source && !stream->uncached_stream && size > 0)
+    {
+        for (int n = 0; n < opts->connections - 1; n++) {
+            struct cache_worker *w = talloc_zero(s, struct cache_worker);
+            w->cache = s;
+            w->log = mp_log_new(w, s->log, "worker");
+            pthread_cond_init(&w->wakeup, NULL);
+            if (pthread_create(&w->thread, NULL, worker_thread, w) != 0) {
+                pthread_cond_destroy(&w->wakeup);
+                break;
+            }
+            MP_TARRAY_APPEND(s, s->workers, s->num_workers, w);
+        }
+        MP_VERBOSE(s, "Using %d connections.\n", s->num_workers + 1);
+    }
+
     if (pthread_create(&s->cache_thread, NULL, cache_thread, s) != 0) {
         MP_ERR(s, "Starting cache process/thread failed: %s.\n",
                strerror(errno));
@@ -648,31 +1200,7 @@ int stream_cache_init(stream_t *cache, stream_t *stream,
     }
     s->cache_thread_running = true;
 
-    // wait until cache is filled with at least min bytes
-    if (min < 1)
-        return 1;
-    for (;;) {
-        if (mp_cancel_test(cache->cancel))
-            return -1;
-        int64_t fill;
-        int idle;
-        if (stream_control(s->cache, STREAM_CTRL_GET_CACHE_FILL, &fill) < 0)
-            break;
-        if (stream_control(s->cache, STREAM_CTRL_GET_CACHE_IDLE, &idle) < 0)
-            break;
-        MP_INFO(s, "\rCache fill: %5.2f%% "
-                "(%" PRId64 " bytes)   ", 100.0 * fill / s->buffer_size, fill);
-        if (fill >= min)
-            break;
-        if (idle)
-            break;    // file is smaller than prefill size
-        // Wake up if the cache is done reading some data (or on timeout/abort)
-        pthread_mutex_lock(&s->mutex);
-        s->control = CACHE_CTRL_PING;
-        pthread_cond_signal(&s->wakeup);
-        cache_wakeup_and_wait(s, &(double){0});
-        pthread_mutex_unlock(&s->mutex);
-    }
-    MP_INFO(s, "\n");
+    // The wait for the initial fill happens in STREAM_CTRL_WAIT_CACHE_INITIAL.
+    s->initial_fill = min;
     return 1;
 }
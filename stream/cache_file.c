@@ -16,6 +16,12 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <libavutil/md5.h>
 
 #include "osdep/io.h"
 
@@ -23,18 +29,25 @@
 #include "common/msg.h"
 
 #include "options/options.h"
+#include "options/path.h"
 
 #include "stream.h"
 
 #define BLOCK_SIZE 1024LL
 #define BLOCK_ALIGN(p) ((p) & ~(BLOCK_SIZE - 1))
 
+// Header of the block map files in --cache-dir (followed by size and URL).
+#define MAP_MAGIC "mpv cache map 1\n"
+
 struct priv {
     struct stream *original;
     FILE *cache_file;
     uint8_t *block_bits;    // 1 bit for each BLOCK_SIZE, whether block was read
+    size_t block_bits_size;
     int64_t size;           // currently known size
     int64_t max_size;       // max. size for block_bits and cache_file
+    char *map_file;         // if persistent, where block_bits are stored
+    char *map_header;
 };
 
 static bool test_bit(struct priv *p, int64_t pos)
@@ -117,32 +130,174 @@ static void s_close(stream_t *s)
     struct priv *p = s->priv;
     if (p->cache_file)
         fclose(p->cache_file);
+    if (p->map_file) {
+        FILE *f = fopen(p->map_file, "wb");
+        bool ok = f && fwrite(p->map_header, strlen(p->map_header), 1, f) == 1 &&
+                  fwrite(p->block_bits, p->block_bits_size, 1, f) == 1;
+        if (f && fclose(f))
+            ok = false;
+        if (!ok) {
+            MP_ERR(s, "can't write cache map '%s'\n", p->map_file);
+            unlink(p->map_file);
+        }
+    }
     talloc_free(p);
 }
 
+// Restore the block bits from a previous session. Returns false if the map
+// doesn't exist or doesn't match.
+static bool load_map(struct priv *p)
+{
+    FILE *f = fopen(p->map_file, "rb");
+    if (!f)
+        return false;
+    size_t header_len = strlen(p->map_header);
+    char *buf = talloc_size(NULL, header_len + p->block_bits_size);
+    bool ok = fread(buf, header_len + p->block_bits_size, 1, f) == 1 &&
+              memcmp(buf, p->map_header, header_len) == 0;
+    if (ok)
+        memcpy(p->block_bits, buf + header_len, p->block_bits_size);
+    talloc_free(buf);
+    fclose(f);
+    return ok;
+}
+
+struct dir_entry {
+    char *name;             // without extension
+    int64_t size;
+    time_t last_use;
+};
+
+static int compare_last_use(const void *pa, const void *pb)
+{
+    const struct dir_entry *a = pa, *b = pb;
+    return a->last_use > b->last_use ? 1 : (a->last_use < b->last_use ? -1 : 0);
+}
+
+// Delete the least recently used entries in the cache directory, until the
+// total size of the data files is below max_size. The current entry (keep) is
+// never deleted.
+static void trim_cache_dir(struct mp_log *log, const char *dir, int64_t max_size,
+                           const char *keep)
+{
+    void *tmp = talloc_new(NULL);
+    struct dir_entry *entries = NULL;
+    int num_entries = 0;
+    int64_t total = 0;
+
+    DIR *d = opendir(dir);
+    if (!d)
+        goto done;
+    struct dirent *ep;
+    while ((ep = readdir(d))) {
+        bstr name = bstr0(ep->d_name);
+        if (!bstr_endswith0(name, ".map"))
+            continue;
+        name.len -= 4;
+        struct dir_entry e = {.name = bstrto0(tmp, name)};
+        char *path = mp_path_join(tmp, bstr0(dir), bstr0(ep->d_name));
+        struct stat st;
+        if (stat(path, &st) == 0)
+            e.last_use = st.st_mtime;
+        path = talloc_asprintf(tmp, "%s/%s.data", dir, e.name);
+        if (stat(path, &st) == 0)
+            e.size = st.st_size;
+        total += e.size;
+        if (strcmp(e.name, keep) != 0)
+            MP_TARRAY_APPEND(tmp, entries, num_entries, e);
+    }
+    closedir(d);
+
+    qsort(entries, num_entries, sizeof(entries[0]), compare_last_use);
+    for (int n = 0; n < num_entries && total > max_size; n++) {
+        mp_verbose(log, "removing cache entry %s\n", entries[n].name);
+        unlink(talloc_asprintf(tmp, "%s/%s.data", dir, entries[n].name));
+        unlink(talloc_asprintf(tmp, "%s/%s.map", dir, entries[n].name));
+        total -= entries[n].size;
+    }
+
+done:
+    talloc_free(tmp);
+}
+
+// Open the persistent cache file for the stream, and restore the block bits.
+// Only used for network streams with known size.
+static FILE *open_persistent(stream_t *cache, stream_t *stream, struct priv *p,
+                             struct mp_cache_opts *opts)
+{
+    int64_t size = -1;
+    stream_control(stream, STREAM_CTRL_GET_SIZE, &size);
+    if (!stream->streaming || size <= 0)
+        return NULL;
+
+    char *dir = mp_get_user_path(p, cache->global, opts->dir);
+    mp_mkdirp(dir);
+
+    // The URL and the file size identify the file.
+    char *key = talloc_asprintf(p, "%"PRId64"\n%s\n", size, stream->url);
+    uint8_t md5[16];
+    av_md5_sum(md5, key, strlen(key));
+    char *name = talloc_strdup(p, "");
+    for (int i = 0; i < 16; i++)
+        name = talloc_asprintf_append(name, "%02X", md5[i]);
+
+    trim_cache_dir(cache->log, dir, opts->dir_max * 1024LL, name);
+
+    p->map_header = talloc_asprintf(p, MAP_MAGIC "%s", key);
+    p->map_file = talloc_asprintf(p, "%s/%s.map", dir, name);
+    char *data_file = talloc_asprintf(p, "%s/%s.data", dir, name);
+
+    FILE *file = NULL;
+    if (load_map(p)) {
+        file = fopen(data_file, "rb+");
+        if (file)
+            MP_VERBOSE(cache, "reusing cache file '%s'\n", data_file);
+    }
+    if (!file) {
+        memset(p->block_bits, 0, p->block_bits_size);
+        file = fopen(data_file, "wb+");
+    }
+    if (!file) {
+        MP_ERR(cache, "can't open cache file '%s'\n", data_file);
+        p->map_file = NULL;
+        return NULL;
+    }
+    p->size = MPMIN(p->max_size, size);
+    return file;
+}
+
 // return 1 on success, 0 if disabled, -1 on error
 int stream_file_cache_init(stream_t *cache, stream_t *stream,
                            struct mp_cache_opts *opts)
 {
-    if (!opts->file || !opts->file[0] || opts->file_max < 1)
+    bool use_dir = opts->dir && opts->dir[0];
+    if ((!use_dir && (!opts->file || !opts->file[0])) || opts->file_max < 1)
         return 0;
 
-    bool use_anon_file = strcmp(opts->file, "TMP") == 0;
-    FILE *file = use_anon_file ? tmpfile() : fopen(opts->file, "wb+");
-    if (!file) {
-        MP_ERR(cache, "can't open cache file '%s'\n", opts->file);
-        return -1;
-    }
-
     struct priv *p = talloc_zero(NULL, struct priv);
-
-    cache->priv = p;
     p->original = stream;
-    p->cache_file = file;
     p->max_size = opts->file_max * 1024LL;
 
     // file_max can be INT_MAX, so this is at most about 256MB
-    p->block_bits = talloc_zero_size(p, (p->max_size / BLOCK_SIZE + 1) / 8 + 1);
+    p->block_bits_size = (p->max_size / BLOCK_SIZE + 1) / 8 + 1;
+    p->block_bits = talloc_zero_size(p, p->block_bits_size);
+
+    FILE *file = NULL;
+    if (use_dir)
+        file = open_persistent(cache, stream, p, opts);
+    if (!file && opts->file && opts->file[0]) {
+        bool use_anon_file = strcmp(opts->file, "TMP") == 0;
+        file = use_anon_file ? tmpfile() : fopen(opts->file, "wb+");
+        if (!file)
+            MP_ERR(cache, "can't open cache file '%s'\n", opts->file);
+    }
+    if (!file) {
+        talloc_free(p);
+        return use_dir ? 0 : -1;
+    }
+
+    cache->priv = p;
+    p->cache_file = file;
 
     cache->seek = seek;
     cache->fill_buffer = fill_buffer;
@@ -120,6 +120,12 @@ int dvb_open_devices(dvb_priv_t *priv, int n, int demux_cnt)
                 return 0;
         }
 
+        // The kernel default is small enough to overflow on busy multiplexes
+        // if the reader is delayed by a few hundred milliseconds.
+        if(priv->cfg_buffer_size > 0 &&
+           ioctl(priv->dvr_fd, DMX_SET_BUFFER_SIZE, priv->cfg_buffer_size * 1024L) < 0)
+                MP_WARN(priv, "COULDN'T SET DVR BUFFER SIZE TO %d KB: ERRNO %d\n", priv->cfg_buffer_size, errno);
+
         return 1;
 }
 
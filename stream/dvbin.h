@@ -92,10 +92,17 @@ typedef struct dvb_params {
         int timeout;
         int last_freq;
 
+        // TS packet parsing state for continuity checks
+        unsigned char ts_cc[8192];      // last CC per PID, 0xFF if unknown
+        unsigned char ts_hdr[4];
+        int ts_pos;                     // position within the current packet
+        struct stream_dvb_stats stats;
+
         char *cfg_prog;
         int cfg_card;
         int cfg_timeout;
         char *cfg_file;
+        int cfg_buffer_size;
 } dvb_priv_t;
 
 
@@ -49,7 +49,8 @@ void RarFileDelete(rar_file_t *file)
     }
     talloc_free(file->chunk);
     free(file->name);
-    free_stream(file->s);
+    for (int i = 0; i < RAR_MAX_OPEN_VOLUMES; i++)
+        free_stream(file->volumes[i].s);
     free(file);
 }
 
@@ -402,30 +403,67 @@ done:
     return 0;
 }
 
+/* Add an already opened volume to the set of open volumes, replacing the
+ * least recently used one if necessary. Takes ownership of s. */
+void RarAddVolume(rar_file_t *file, stream_t *s)
+{
+    int lru = 0;
+    for (int i = 0; i < RAR_MAX_OPEN_VOLUMES; i++) {
+        if (!file->volumes[i].s) {
+            lru = i;
+            break;
+        }
+        if (file->volumes[i].last_use < file->volumes[lru].last_use)
+            lru = i;
+    }
+    if (file->volumes[lru].s == file->s)
+        file->s = NULL;
+    free_stream(file->volumes[lru].s);
+    file->volumes[lru].s = s;
+    file->volumes[lru].last_use = ++file->use_serial;
+}
+
+/* Return the stream for the given volume, opening it if it's not open yet.
+ * Keeping a few volumes open avoids reopening files when seeking back and
+ * forth across volume boundaries. */
+static stream_t *GetVolume(rar_file_t *file, const char *mrl)
+{
+    for (int i = 0; i < RAR_MAX_OPEN_VOLUMES; i++) {
+        stream_t *s = file->volumes[i].s;
+        if (s && strcmp(s->url, mrl) == 0) {
+            file->volumes[i].last_use = ++file->use_serial;
+            return s;
+        }
+    }
+    stream_t *s = stream_create(mrl, STREAM_READ | STREAM_NO_FILTERS,
+                                file->cancel, file->global);
+    if (s)
+        RarAddVolume(file, s);
+    return s;
+}
+
 int  RarSeek(rar_file_t *file, uint64_t position)
 {
     if (position > file->real_size)
         position = file->real_size;
 
-    /* Search the chunk */
-    const rar_file_chunk_t *old_chunk = file->current_chunk;
-    for (int i = 0; i < file->chunk_count; i++) {
-        file->current_chunk = file->chunk[i];
-        if (position < file->current_chunk->cummulated_size + file->current_chunk->size)
-            break;
+    /* Search the chunk (binary search on the cumulated sizes) */
+    int lo = 0, hi = file->chunk_count - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const rar_file_chunk_t *chunk = file->chunk[mid];
+        if (position < chunk->cummulated_size + chunk->size)
+            hi = mid;
+        else
+            lo = mid + 1;
     }
+    file->current_chunk = file->chunk[lo];
     file->i_pos = position;
 
     const uint64_t offset = file->current_chunk->offset +
                             (position - file->current_chunk->cummulated_size);
 
-    if (strcmp(old_chunk->mrl, file->current_chunk->mrl)) {
-        if (file->s)
-            free_stream(file->s);
-        file->s = stream_create(file->current_chunk->mrl,
-                                STREAM_READ | STREAM_NO_FILTERS,
-                                file->cancel, file->global);
-    }
+    file->s = GetVolume(file, file->current_chunk->mrl);
     return file->s ? stream_seek(file->s, offset) : 0;
 }
 
@@ -27,6 +27,8 @@
 #include <inttypes.h>
 #include <sys/types.h>
 
+#define RAR_MAX_OPEN_VOLUMES 4
+
 typedef struct {
     char     *mrl;
     uint64_t offset;
@@ -49,12 +51,20 @@ typedef struct {
     uint64_t i_pos;
     stream_t *s;
     rar_file_chunk_t *current_chunk;
+
+    // Recently used volumes are kept open (s is one of them)
+    struct {
+        stream_t *s;
+        uint64_t last_use;
+    } volumes[RAR_MAX_OPEN_VOLUMES];
+    uint64_t use_serial;
 } rar_file_t;
 
 int  RarProbe(struct stream *);
 void RarFileDelete(rar_file_t *);
 int  RarParse(struct stream *, int *, rar_file_t ***);
 
+void RarAddVolume(rar_file_t *file, stream_t *s);
 int  RarSeek(rar_file_t *file, uint64_t position);
 ssize_t RarRead(rar_file_t *file, void *data, size_t size);
 
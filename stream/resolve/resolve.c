@@ -0,0 +1,288 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Cache for URL resolution results. Resolving a web URL with libquvi scrapes
+// the site, which can take seconds. Results are kept for --quvi-cache-ttl, and
+// upcoming playlist entries can be resolved in advance on a worker thread.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "config.h"
+#include "talloc.h"
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "options/options.h"
+#include "osdep/timer.h"
+#include "resolve.h"
+
+// Maximum number of cached results.
+#define MAX_ENTRIES 64
+
+struct cache_entry {
+    char *key;
+    bool resolving;                 // resolution in progress, res not set yet
+    struct mp_resolve_result *res;
+    double expires;                 // mp_time_sec() time
+};
+
+struct prefetch_item {
+    char *key;
+    char *url;
+    double ttl;
+};
+
+struct mp_resolve_cache {
+    struct mpv_global *global;
+    struct mp_log *log;
+    bool enabled;                   // a resolver is compiled in
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;          // entry resolved, or prefetch queued
+
+    struct cache_entry **entries;   // oldest first
+    int num_entries;
+
+    pthread_t thread;
+    bool thread_running;
+    bool terminate;
+    struct prefetch_item **queue;
+    int num_queue;
+};
+
+static struct mp_resolve_result *resolve(const char *url,
+                                         struct mpv_global *global)
+{
+#if HAVE_LIBQUVI
+    return mp_resolve_quvi(url, global);
+#else
+    return NULL;
+#endif
+}
+
+static struct mp_resolve_result *copy_result(void *ta_parent,
+                                             struct mp_resolve_result *res)
+{
+    struct mp_resolve_result *r = talloc_zero(ta_parent, struct mp_resolve_result);
+    r->url = talloc_strdup(r, res->url);
+    r->title = talloc_strdup(r, res->title);
+    r->start_time = res->start_time;
+    for (int n = 0; n < res->num_srcs; n++) {
+        struct mp_resolve_src *src = talloc_ptrtype(r, src);
+        *src = (struct mp_resolve_src) {
+            .url = talloc_strdup(src, res->srcs[n]->url),
+            .encid = talloc_strdup(src, res->srcs[n]->encid),
+        };
+        MP_TARRAY_APPEND(r, r->srcs, r->num_srcs, src);
+    }
+    for (int n = 0; n < res->num_subs; n++) {
+        struct mp_resolve_sub *sub = talloc_ptrtype(r, sub);
+        *sub = (struct mp_resolve_sub) {
+            .url = talloc_strdup(sub, res->subs[n]->url),
+            .data = talloc_strdup(sub, res->subs[n]->data),
+            .lang = talloc_strdup(sub, res->subs[n]->lang),
+        };
+        MP_TARRAY_APPEND(r, r->subs, r->num_subs, sub);
+    }
+    return r;
+}
+
+// The options that influence the result are part of the key.
+static char *make_key(void *ta_parent, struct MPOpts *opts, const char *url)
+{
+    return talloc_asprintf(ta_parent, "%s\n%d\n%s",
+                           opts->quvi_format ? opts->quvi_format : "",
+                           opts->quvi_fetch_subtitles, url);
+}
+
+static int find_entry(struct mp_resolve_cache *c, const char *key)
+{
+    for (int n = 0; n < c->num_entries; n++) {
+        if (strcmp(c->entries[n]->key, key) == 0)
+            return n;
+    }
+    return -1;
+}
+
+static void remove_entry(struct mp_resolve_cache *c, int n)
+{
+    talloc_free(c->entries[n]);
+    MP_TARRAY_REMOVE_AT(c->entries, c->num_entries, n);
+}
+
+// Drop expired results, and the oldest ones if there are too many.
+static void prune(struct mp_resolve_cache *c)
+{
+    double now = mp_time_sec();
+    for (int n = c->num_entries - 1; n >= 0; n--) {
+        struct cache_entry *e = c->entries[n];
+        if (!e->resolving && e->expires <= now)
+            remove_entry(c, n);
+    }
+    for (int n = 0; n < c->num_entries && c->num_entries > MAX_ENTRIES;) {
+        if (c->entries[n]->resolving) {
+            n++;
+        } else {
+            remove_entry(c, n);
+        }
+    }
+}
+
+// Called and returns with the lock held, but resolves with the lock released.
+// Returns the result (owned by the caller), or NULL on failure.
+static struct mp_resolve_result *resolve_and_store(struct mp_resolve_cache *c,
+                                                   const char *key,
+                                                   const char *url, double ttl)
+{
+    struct cache_entry *e = talloc_zero(c, struct cache_entry);
+    e->key = talloc_strdup(e, key);
+    e->resolving = true;
+    MP_TARRAY_APPEND(c, c->entries, c->num_entries, e);
+
+    pthread_mutex_unlock(&c->lock);
+    struct mp_resolve_result *res = resolve(url, c->global);
+    pthread_mutex_lock(&c->lock);
+
+    e->resolving = false;
+    // Playlists are not cached: the player takes over their entries.
+    if (res && !res->playlist) {
+        e->res = copy_result(e, res);
+        e->expires = mp_time_sec() + ttl;
+    } else {
+        remove_entry(c, find_entry(c, key));
+    }
+    pthread_cond_broadcast(&c->wakeup);
+    return res;
+}
+
+struct mp_resolve_result *mp_resolve_cached(struct mp_resolve_cache *c,
+                                            const char *url)
+{
+    struct MPOpts *opts = c->global->opts;
+    double ttl = opts->quvi_cache_ttl;
+    if (!c->enabled || ttl <= 0)
+        return resolve(url, c->global);
+
+    char *key = make_key(NULL, opts, url);
+    struct mp_resolve_result *res = NULL;
+
+    pthread_mutex_lock(&c->lock);
+    prune(c);
+    int n = find_entry(c, key);
+    // Wait for a concurrent resolution of the same URL (e.g. by the prefetch
+    // thread), instead of scraping the site twice.
+    while (n >= 0 && c->entries[n]->resolving) {
+        pthread_cond_wait(&c->wakeup, &c->lock);
+        n = find_entry(c, key);
+    }
+    if (n >= 0) {
+        MP_VERBOSE(c, "Using cached result for %s\n", url);
+        res = copy_result(NULL, c->entries[n]->res);
+    } else {
+        res = resolve_and_store(c, key, url, ttl);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    talloc_free(key);
+    return res;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct mp_resolve_cache *c = arg;
+
+    pthread_mutex_lock(&c->lock);
+    while (!c->terminate) {
+        if (!c->num_queue) {
+            pthread_cond_wait(&c->wakeup, &c->lock);
+            continue;
+        }
+        struct prefetch_item *item = c->queue[0];
+        MP_TARRAY_REMOVE_AT(c->queue, c->num_queue, 0);
+        if (find_entry(c, item->key) < 0) {
+            MP_VERBOSE(c, "Resolving %s in advance\n", item->url);
+            talloc_free(resolve_and_store(c, item->key, item->url, item->ttl));
+        }
+        talloc_free(item);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+void mp_resolve_cache_prefetch(struct mp_resolve_cache *c, const char *url)
+{
+    struct MPOpts *opts = c->global->opts;
+    if (!c->enabled || opts->quvi_cache_ttl <= 0)
+        return;
+
+    char *key = make_key(NULL, opts, url);
+
+    pthread_mutex_lock(&c->lock);
+    prune(c);
+    bool queued = find_entry(c, key) >= 0;
+    for (int n = 0; n < c->num_queue; n++)
+        queued |= strcmp(c->queue[n]->key, key) == 0;
+    if (!queued && !c->thread_running)
+        c->thread_running = !pthread_create(&c->thread, NULL, prefetch_thread, c);
+    if (!queued && c->thread_running) {
+        struct prefetch_item *item = talloc_ptrtype(c, item);
+        *item = (struct prefetch_item) {
+            .key = talloc_steal(item, key),
+            .url = talloc_strdup(item, url),
+            .ttl = opts->quvi_cache_ttl,
+        };
+        key = NULL;
+        MP_TARRAY_APPEND(c, c->queue, c->num_queue, item);
+        pthread_cond_broadcast(&c->wakeup);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    talloc_free(key);
+}
+
+static void destroy_cache(void *ptr)
+{
+    struct mp_resolve_cache *c = ptr;
+    if (c->thread_running) {
+        pthread_mutex_lock(&c->lock);
+        c->terminate = true;
+        pthread_cond_broadcast(&c->wakeup);
+        pthread_mutex_unlock(&c->lock);
+        // (libquvi can't be interrupted; this waits for a running resolve.)
+        pthread_join(c->thread, NULL);
+    }
+    pthread_cond_destroy(&c->wakeup);
+    pthread_mutex_destroy(&c->lock);
+}
+
+struct mp_resolve_cache *mp_resolve_cache_new(void *ta_parent,
+                                              struct mpv_global *global)
+{
+    struct mp_resolve_cache *c = talloc_zero(ta_parent, struct mp_resolve_cache);
+    c->global = global;
+    c->log = mp_log_new(c, global->log, "resolve");
+#if HAVE_LIBQUVI
+    c->enabled = true;
+#endif
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->wakeup, NULL);
+    talloc_set_destructor(c, destroy_cache);
+    return c;
+}
@@ -50,4 +50,14 @@ struct mp_resolve_sub {
 struct mp_resolve_result *mp_resolve_quvi(const char *url,
                                           struct mpv_global *global);
 
+// Thread-safe cache in front of mp_resolve_quvi() (see resolve.c).
+struct mp_resolve_cache;
+struct mp_resolve_cache *mp_resolve_cache_new(void *ta_parent,
+                                              struct mpv_global *global);
+// Returns a new result owned by the caller, or NULL.
+struct mp_resolve_result *mp_resolve_cached(struct mp_resolve_cache *c,
+                                            const char *url);
+// Resolve url on a worker thread, so that a later mp_resolve_cached() finds it.
+void mp_resolve_cache_prefetch(struct mp_resolve_cache *c, const char *url);
+
 #endif
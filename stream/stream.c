@@ -324,6 +324,9 @@ static int open_internal(const stream_info_t *sinfo, struct stream *underlying,
 
     if (!s->read_chunk)
         s->read_chunk = 4 * (s->sector_size ? s->sector_size : STREAM_BUFFER_SIZE);
+    if (!s->buf_fill_min)
+        s->buf_fill_min = STREAM_BUFFER_SIZE;
+    s->buf_fill = s->buf_fill_min;
 
     assert(s->seekable == !!s->seek);
 
@@ -511,17 +514,26 @@ static int stream_fill_buffer_by(stream_t *s, int64_t len)
 {
     len = MPMIN(len, s->read_chunk);
     len = MPMAX(len, STREAM_BUFFER_SIZE);
+    // Read whole sectors; several at once if possible, to avoid lots of tiny
+    // device reads on disc media.
     if (s->sector_size)
-        len = s->sector_size;
+        len = MPMAX(len - len % s->sector_size, s->sector_size);
     len = stream_read_unbuffered(s, s->buffer, len);
     s->buf_pos = 0;
     s->buf_len = len;
     return s->buf_len;
 }
 
+// Refill the buffer for small reads. Each time the previous buffer was used up
+// without seeking, the size of the next read is doubled (up to read_chunk), so
+// that sequential reading of small pieces doesn't cause tons of fill_buffer
+// calls. Seeking resets it to buf_fill_min.
 int stream_fill_buffer(stream_t *s)
 {
-    return stream_fill_buffer_by(s, STREAM_BUFFER_SIZE);
+    int r = stream_fill_buffer_by(s, s->buf_fill);
+    int max_fill = MPMIN(s->read_chunk, STREAM_MAX_BUFFER_SIZE);
+    s->buf_fill = MPMAX(MPMIN(s->buf_fill * 2, max_fill), s->buf_fill_min);
+    return r;
 }
 
 // Read between 1..buf_size bytes of data, return how much data has been read.
@@ -534,7 +546,7 @@ int stream_read_partial(stream_t *s, char *buf, int buf_size)
         s->buf_pos = s->buf_len = 0;
         // Do a direct read, but only if there's no sector alignment requirement
         // Also, small reads will be more efficient with buffering & copying
-        if (!s->sector_size && buf_size >= STREAM_BUFFER_SIZE)
+        if (!s->sector_size && buf_size >= MPMAX(s->buf_fill, STREAM_BUFFER_SIZE))
             return stream_read_unbuffered(s, buf, buf_size);
         if (!stream_fill_buffer(s))
             return 0;
@@ -563,6 +575,41 @@ int stream_read(stream_t *s, char *mem, int total)
     return total;
 }
 
+// Read exactly len bytes, but return a pointer to the data instead of copying
+// it. This works only if the data is available in memory in one piece (e.g.
+// with the stream cache). On success, the read position is advanced, and the
+// returned buffer is valid until the next stream call. You must not write to
+// it. On failure, an empty bstr is returned, the read position is not changed,
+// and the caller has to use stream_read().
+struct bstr stream_read_direct(stream_t *s, int len)
+{
+    if (len <= 0)
+        return (bstr){0};
+    int buffered = s->buf_len - s->buf_pos;
+    if (buffered >= len) {
+        bstr r = {&s->buffer[s->buf_pos], len};
+        s->buf_pos += len;
+        return r;
+    }
+    if (!s->read_direct || s->capture_file)
+        return (bstr){0};
+    if (buffered) {
+        // Give the partially buffered data back; the seek is cheap, because
+        // streams implementing read_direct have the data in memory anyway.
+        int64_t pos = stream_tell(s);
+        if (s->seek(s, pos) <= 0)
+            return (bstr){0};
+        s->pos = pos;
+        s->buf_pos = s->buf_len = 0;
+    }
+    void *data = NULL;
+    if (s->read_direct(s, &data, len) < len)
+        return (bstr){0};
+    s->pos += len;
+    s->eof = 0;
+    return (bstr){data, len};
+}
+
 // Read ahead at most len bytes without changing the read position. Return a
 // pointer to the internal buffer, starting from the current read position.
 // Can read ahead at most STREAM_MAX_BUFFER_SIZE bytes.
@@ -632,6 +679,7 @@ static int stream_skip_read(struct stream *s, int64_t len)
 void stream_drop_buffers(stream_t *s)
 {
     s->buf_pos = s->buf_len = 0;
+    s->buf_fill = s->buf_fill_min;
     s->eof = 0;
 }
 
@@ -790,6 +838,7 @@ static stream_t *open_cache(stream_t *orig, const char *name)
     cache->seekable = true;
     cache->mode = STREAM_READ;
     cache->read_chunk = 4 * STREAM_BUFFER_SIZE;
+    cache->buf_fill_min = cache->buf_fill = STREAM_BUFFER_SIZE;
 
     cache->url = talloc_strdup(cache, orig->url);
     cache->mime_type = talloc_strdup(cache, orig->mime_type);
@@ -989,15 +1038,35 @@ struct bstr stream_read_complete(struct stream *s, void *talloc_ctx,
 
 struct mp_cancel {
     atomic_bool triggered;
+    struct mp_cancel *parent;   // constant
+    atomic_bool linked;         // whether parent is checked too
 };
 
 struct mp_cancel *mp_cancel_new(void *talloc_ctx)
+{
+    return mp_cancel_new_linkable(talloc_ctx, NULL);
+}
+
+// Like mp_cancel_new(), but once mp_cancel_link() was called, triggering the
+// parent also aborts users of the returned mp_cancel. This is for objects
+// created independently, which later are handed over to the owner of parent.
+struct mp_cancel *mp_cancel_new_linkable(void *talloc_ctx,
+                                         struct mp_cancel *parent)
 {
     struct mp_cancel *c = talloc_ptrtype(talloc_ctx, c);
-    *c = (struct mp_cancel){.triggered = ATOMIC_VAR_INIT(false)};
+    *c = (struct mp_cancel){
+        .triggered = ATOMIC_VAR_INIT(false),
+        .parent = parent,
+        .linked = ATOMIC_VAR_INIT(false),
+    };
     return c;
 }
 
+void mp_cancel_link(struct mp_cancel *c)
+{
+    atomic_store(&c->linked, true);
+}
+
 // Request abort.
 void mp_cancel_trigger(struct mp_cancel *c)
 {
@@ -1014,7 +1083,11 @@ void mp_cancel_reset(struct mp_cancel *c)
 // For convenience, c==NULL is allowed.
 bool mp_cancel_test(struct mp_cancel *c)
 {
-    return c ? atomic_load(&c->triggered) : false;
+    if (!c)
+        return false;
+    if (atomic_load(&c->linked) && mp_cancel_test(c->parent))
+        return true;
+    return atomic_load(&c->triggered);
 }
 
 void stream_print_proto_list(struct mp_log *log)
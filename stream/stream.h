@@ -82,7 +82,10 @@ enum stream_ctrl {
     STREAM_CTRL_SET_CACHE_SIZE,
     STREAM_CTRL_GET_CACHE_FILL,
     STREAM_CTRL_GET_CACHE_IDLE,
+    STREAM_CTRL_GET_CACHE_SPEED,
+    STREAM_CTRL_SET_READAHEAD,      // int64_t* bytes, 0 for no limit
     STREAM_CTRL_RESUME_CACHE,
+    STREAM_CTRL_WAIT_CACHE_INITIAL, // block until --cache-initial is filled
     STREAM_CTRL_RECONNECT,
     STREAM_CTRL_GET_CHAPTER_TIME,
     STREAM_CTRL_GET_DVD_INFO,
@@ -104,6 +107,7 @@ enum stream_ctrl {
     STREAM_CTRL_TV_LAST_CHAN,
     STREAM_CTRL_DVB_SET_CHANNEL,
     STREAM_CTRL_DVB_STEP_CHANNEL,
+    STREAM_CTRL_GET_DVB_STATS,          // struct stream_dvb_stats*
     STREAM_CTRL_AVSEEK,
 };
 
@@ -113,6 +117,12 @@ struct stream_lang_req {
     char name[50];
 };
 
+// for STREAM_CTRL_GET_DVB_STATS
+struct stream_dvb_stats {
+    int64_t overflows;          // DVR device buffer overflows (data lost)
+    int64_t cc_errors;          // TS continuity counter mismatches
+};
+
 struct stream_dvd_info_req {
     unsigned int palette[16];
     int num_subs;
@@ -153,6 +163,9 @@ typedef struct stream {
 
     // Read
     int (*fill_buffer)(struct stream *s, char *buffer, int max_len);
+    // Zero-copy read (optional): set *data to len bytes at the current
+    // position and return len, or return 0 if not possible.
+    int (*read_direct)(struct stream *s, void **data, int len);
     // Write
     int (*write_buffer)(struct stream *s, char *buffer, int len);
     // Seek
@@ -168,6 +181,8 @@ typedef struct stream {
     enum streamtype uncached_type; // if stream is cache, type of wrapped str.
     int sector_size; // sector size (seek will be aligned on this size if non 0)
     int read_chunk; // maximum amount of data to read at once to limit latency
+    int buf_fill_min; // initial amount of data for buffered reads
+    int buf_fill; // current amount for buffered reads (adapts to access pattern)
     unsigned int buf_pos, buf_len;
     int64_t pos;
     uint64_t end_pos; // static size; use STREAM_CTRL_GET_SIZE instead
@@ -241,6 +256,7 @@ int stream_skip(stream_t *s, int64_t len);
 int stream_seek(stream_t *s, int64_t pos);
 int stream_read(stream_t *s, char *mem, int total);
 int stream_read_partial(stream_t *s, char *buf, int buf_size);
+struct bstr stream_read_direct(stream_t *s, int len);
 struct bstr stream_peek(stream_t *s, int len);
 void stream_drop_buffers(stream_t *s);
 
@@ -260,6 +276,9 @@ void mp_url_unescape_inplace(char *buf);
 char *mp_url_escape(void *talloc_ctx, const char *s, const char *ok);
 
 struct mp_cancel *mp_cancel_new(void *talloc_ctx);
+struct mp_cancel *mp_cancel_new_linkable(void *talloc_ctx,
+                                         struct mp_cancel *parent);
+void mp_cancel_link(struct mp_cancel *c);
 void mp_cancel_trigger(struct mp_cancel *c);
 bool mp_cancel_test(struct mp_cancel *c);
 void mp_cancel_reset(struct mp_cancel *c);
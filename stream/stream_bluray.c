@@ -751,14 +751,16 @@ static int bluray_stream_open(stream_t *s)
             return STREAM_UNSUPPORTED;
         }
 
-        /* parse titles information */
+        /* Try to guess which title may contain the main movie. This reads
+         * the info of every title, which can take a long time on optical
+         * drives, so skip it if the title was given explicitly. */
         uint64_t max_duration = 0;
-        for (int i = 0; i < b->num_titles; i++) {
+        int num_scan = b->cfg_title == BLURAY_DEFAULT_TITLE ? b->num_titles : 0;
+        for (int i = 0; i < num_scan; i++) {
             BLURAY_TITLE_INFO *ti = bd_get_title_info(bd, i, 0);
             if (!ti)
                 continue;
 
-            /* try to guess which title may contain the main movie */
             if (ti->duration > max_duration) {
                 max_duration = ti->duration;
                 title_guess = i;
@@ -796,6 +798,7 @@ static int bluray_stream_open(stream_t *s)
     s->type        = STREAMTYPE_BLURAY;
     s->end_pos     = bd_get_title_size(bd);
     s->sector_size = BLURAY_SECTOR_SIZE;
+    s->read_chunk  = 64 * BLURAY_SECTOR_SIZE;
     s->priv        = b;
     s->demuxer     = "+disc";
 
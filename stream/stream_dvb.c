@@ -44,6 +44,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 #include <libavutil/avstring.h>
 
 #include "osdep/io.h"
+#include "common/common.h"
 #include "misc/ctype.h"
 
 #include "stream.h"
@@ -78,6 +79,7 @@ const struct m_sub_options stream_dvb_conf = {
         OPT_INTRANGE("card", cfg_card, 0, 1, 4),
         OPT_INTRANGE("timeout",  cfg_timeout, 0, 1, 30),
         OPT_STRING("file", cfg_file, 0),
+        OPT_INTRANGE("buffer-size", cfg_buffer_size, 0, 0, 1024 * 1024),
         {0}
     },
     .size = sizeof(struct dvb_params),
@@ -85,6 +87,7 @@ const struct m_sub_options stream_dvb_conf = {
         .cfg_prog = "",
         .cfg_card = 1,
         .cfg_timeout = 30,
+        .cfg_buffer_size = 8 * 1024,
     },
 };
 
@@ -401,6 +404,65 @@ void dvb_free_config(dvb_config_t *config)
         free(config);
 }
 
+#define TS_PACKET_SIZE 188
+#define TS_SYNC_BYTE 0x47
+#define TS_NULL_PID 0x1FFF
+
+static void dvb_reset_ts_check(dvb_priv_t *priv)
+{
+        memset(priv->ts_cc, 0xFF, sizeof(priv->ts_cc));
+        priv->ts_pos = 0;
+}
+
+static void dvb_check_ts_header(stream_t *stream, dvb_priv_t *priv)
+{
+        unsigned char *h = priv->ts_hdr;
+        int pid = ((h[1] & 0x1F) << 8) | h[2];
+        int cc = h[3] & 0xF;
+        bool has_payload = h[3] & 0x10;
+
+        // The CC only increments with packets that have a payload.
+        if(pid == TS_NULL_PID || !has_payload)
+                return;
+
+        int last = priv->ts_cc[pid];
+        // A single repeated packet is allowed.
+        if(last != 0xFF && cc != last && cc != ((last + 1) & 0xF))
+        {
+                priv->stats.cc_errors++;
+                MP_VERBOSE(stream, "TS continuity error on PID %d: %d -> %d\n", pid, last, cc);
+        }
+        priv->ts_cc[pid] = cc;
+}
+
+// Check the continuity counters of the TS packets in buf. Packets can be split
+// across calls.
+static void dvb_check_ts(stream_t *stream, dvb_priv_t *priv,
+                         unsigned char *buf, int len)
+{
+        int i = 0;
+        while(i < len)
+        {
+                if(priv->ts_pos == 0 && buf[i] != TS_SYNC_BYTE)
+                {
+                        i++;    // resync
+                        continue;
+                }
+                if(priv->ts_pos < 4)
+                {
+                        priv->ts_hdr[priv->ts_pos++] = buf[i++];
+                        if(priv->ts_pos == 4)
+                                dvb_check_ts_header(stream, priv);
+                        continue;
+                }
+                int skip = MPMIN(TS_PACKET_SIZE - priv->ts_pos, len - i);
+                i += skip;
+                priv->ts_pos += skip;
+                if(priv->ts_pos == TS_PACKET_SIZE)
+                        priv->ts_pos = 0;
+        }
+}
+
 static int dvb_streaming_read(stream_t *stream, char *buffer, int size)
 {
         struct pollfd pfds[1];
@@ -429,9 +491,17 @@ static int dvb_streaming_read(stream_t *stream, char *buffer, int size)
                 }
                 if((rk = read(fd, &buffer[pos], rk)) > 0)
                 {
+                        dvb_check_ts(stream, priv, (unsigned char *)&buffer[pos], rk);
                         pos += rk;
                         MP_TRACE(stream, "ret (%d) bytes\n", pos);
                 }
+                else if(rk < 0 && errno == EOVERFLOW)
+                {
+                        priv->stats.overflows++;
+                        priv->ts_pos = 0;
+                        MP_WARN(stream, "DVR buffer overflow, data was lost (%"PRId64" total)\n",
+                                priv->stats.overflows);
+                }
         }
 
 
@@ -475,6 +545,7 @@ int dvb_set_channel(stream_t *stream, int card, int n)
 
                 priv->retry = 0;
                 while(dvb_streaming_read(stream, buf, 4096) > 0);       //empty both the stream's and driver's buffer
+                dvb_reset_ts_check(priv);
                 if(priv->card != card)
                 {
                         dvbin_close(stream);
@@ -567,6 +638,11 @@ static int dvbin_stream_control(struct stream *s, int cmd, void *arg)
     case STREAM_CTRL_DVB_STEP_CHANNEL:
         r = dvb_step_channel(s, *(int *)arg);
         return r ? STREAM_OK : STREAM_ERROR;
+    case STREAM_CTRL_GET_DVB_STATS: {
+        dvb_priv_t *priv = s->priv;
+        *(struct stream_dvb_stats *)arg = priv->stats;
+        return STREAM_OK;
+    }
     }
     return STREAM_UNSUPPORTED;
 }
@@ -651,6 +727,7 @@ static int dvb_open(stream_t *stream)
         int tuner_type = 0, i;
 
         priv->fe_fd = priv->sec_fd = priv->dvr_fd = -1;
+        dvb_reset_ts_check(priv);
         priv->config = dvb_get_config(stream);
         if(priv->config == NULL)
         {
@@ -703,6 +780,9 @@ static int dvb_open(stream_t *stream)
         }
 
         stream->type = STREAMTYPE_DVB;
+        // Enables the stream cache by default, so that a separate thread keeps
+        // draining the DVR device while the demuxer is busy.
+        stream->streaming = true;
         stream->fill_buffer = dvb_streaming_read;
         stream->close = dvbin_close;
         stream->control = dvbin_stream_control;
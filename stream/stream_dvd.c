@@ -45,6 +45,9 @@
 #define FIRST_MPG_AID 0
 #define FIRST_PCM_AID 160
 
+// Number of blocks (2048 bytes each) read from the disc at once
+#define DVD_READAHEAD_BLOCKS 128
+
 #include "stream.h"
 #include "options/m_option.h"
 #include "options/options.h"
@@ -93,6 +96,10 @@ typedef struct {
   int packs_left;
   dsi_t dsi_pack;
   int angle_seek;
+// Read-ahead: blocks [ra_start, ra_start + ra_count) of the title
+  unsigned char *ra_buf;
+  int ra_start;
+  int ra_count;
   unsigned int *cell_times_table;
 // audio datas
   int nr_of_channels;
@@ -183,6 +190,23 @@ static int dvd_next_cell(stream_t *stream, dvd_priv_t *d) {
   return next_cell;
 }
 
+// Read a single block, but fetch the following blocks of the cell with the
+// same call. Drive seek latency dominates on optical media, so issuing one
+// large read instead of many single-block reads makes a big difference.
+static int dvd_read_block(dvd_priv_t *d, int pack, unsigned char *data)
+{
+  if (pack < d->ra_start || pack >= d->ra_start + d->ra_count) {
+    int count = MPCLAMP(d->cell_last_pack - pack + 1, 1, DVD_READAHEAD_BLOCKS);
+    int len = DVDReadBlocks(d->title, pack, count, d->ra_buf);
+    d->ra_start = pack;
+    d->ra_count = MPMAX(len, 0);
+    if (len <= 0)
+      return len;
+  }
+  memcpy(data, d->ra_buf + (pack - d->ra_start) * 2048, 2048);
+  return 1;
+}
+
 static int dvd_read_sector(stream_t *stream, dvd_priv_t *d, unsigned char *data)
 {
   int len;
@@ -223,7 +247,7 @@ read_next:
         return -1; // EOF
   }
 
-  len = DVDReadBlocks(d->title, d->cur_pack, 1, data);
+  len = dvd_read_block(d, d->cur_pack, data);
   // only == 0 should indicate an error, but some dvdread version are buggy when used with dvdcss
   if(len <= 0) return -1; //error
 
@@ -291,13 +315,13 @@ read_next:
 
 static int fill_buffer(stream_t *s, char *buf, int len)
 {
-  int64_t pos;
-  if (len < 2048)
-    return -1;
-  pos = dvd_read_sector(s, s->priv, buf);
-  if (pos < 0)
-    return -1;
-  return 2048; // full sector
+  int total = 0;
+  while (len - total >= 2048) {
+    if (dvd_read_sector(s, s->priv, buf + total) < 0)
+      break;
+    total += 2048; // full sector
+  }
+  return total ? total : -1;
 }
 
 static void stream_dvd_close(stream_t *s) {
@@ -767,6 +791,7 @@ static int open_s(stream_t *stream)
     // store data
     d->dvd=dvd;
     d->title=title;
+    d->ra_buf = talloc_size(stream, DVD_READAHEAD_BLOCKS * 2048);
     d->vmg_file=vmg_file;
     d->tt_srpt=tt_srpt;
     d->vts_file=vts_file;
@@ -899,6 +924,7 @@ static int open_s(stream_t *stream)
     stream->demuxer = "+disc";
     stream->lavf_type = "mpeg";
     stream->sector_size = 2048;
+    stream->read_chunk = DVD_READAHEAD_BLOCKS * 2048;
     stream->fill_buffer = fill_buffer;
     stream->control = control;
     stream->close = stream_dvd_close;
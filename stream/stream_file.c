@@ -27,9 +27,15 @@
 #include <unistd.h>
 #include <errno.h>
 
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #include "osdep/io.h"
 
+#include "common/common.h"
 #include "common/msg.h"
+#include "options/options.h"
 #include "stream.h"
 #include "options/m_option.h"
 #include "options/path.h"
@@ -56,15 +62,43 @@
 struct priv {
     int fd;
     bool close;
+    // With --stream-file-mmap: the file mapped at open time, and the current
+    // read position (the fd position is only used past the mapped size).
+    uint8_t *map;
+    int64_t map_size;
+    int64_t pos;
 };
 
 static int fill_buffer(stream_t *s, char *buffer, int max_len)
 {
     struct priv *p = s->priv;
+    if (p->map) {
+        if (p->pos < p->map_size) {
+            int len = MPMIN(max_len, p->map_size - p->pos);
+            memcpy(buffer, p->map + p->pos, len);
+            p->pos += len;
+            return len;
+        }
+        // The file grew since it was mapped.
+        if (lseek(p->fd, p->pos, SEEK_SET) == (off_t)-1)
+            return -1;
+    }
     int r = read(p->fd, buffer, max_len);
+    if (r > 0)
+        p->pos += r;
     return (r <= 0) ? -1 : r;
 }
 
+static int read_direct(stream_t *s, void **data, int len)
+{
+    struct priv *p = s->priv;
+    if (p->pos + len > p->map_size)
+        return 0;
+    *data = p->map + p->pos;
+    p->pos += len;
+    return len;
+}
+
 static int write_buffer(stream_t *s, char *buffer, int len)
 {
     struct priv *p = s->priv;
@@ -83,7 +117,14 @@ static int write_buffer(stream_t *s, char *buffer, int len)
 static int seek(stream_t *s, int64_t newpos)
 {
     struct priv *p = s->priv;
-    return lseek(p->fd, newpos, SEEK_SET) != (off_t)-1;
+    if (p->map && newpos <= p->map_size) {
+        p->pos = newpos;
+        return 1;
+    }
+    if (lseek(p->fd, newpos, SEEK_SET) == (off_t)-1)
+        return 0;
+    p->pos = newpos;
+    return 1;
 }
 
 static int control(stream_t *s, int cmd, void *arg)
@@ -92,7 +133,7 @@ static int control(stream_t *s, int cmd, void *arg)
     switch (cmd) {
     case STREAM_CTRL_GET_SIZE: {
         off_t size = lseek(p->fd, 0, SEEK_END);
-        lseek(p->fd, s->pos, SEEK_SET);
+        lseek(p->fd, p->pos, SEEK_SET);
         if (size != (off_t)-1) {
             *(int64_t *)arg = size;
             return 1;
@@ -106,6 +147,10 @@ static int control(stream_t *s, int cmd, void *arg)
 static void s_close(stream_t *s)
 {
     struct priv *p = s->priv;
+#if HAVE_SYS_MMAN_H
+    if (p->map)
+        munmap(p->map, p->map_size);
+#endif
     if (p->close && p->fd >= 0)
         close(p->fd);
 }
@@ -213,6 +258,29 @@ static bool check_stream_network(stream_t *stream)
 }
 #endif
 
+// Map the whole file, so that reads are served from the page cache directly,
+// and demuxers can use the data without copying it (read_direct).
+static void map_file(stream_t *stream, int64_t size)
+{
+#if HAVE_SYS_MMAN_H
+    struct priv *p = stream->priv;
+    if (size <= 0 || (uint64_t)size > SIZE_MAX)
+        return;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, p->fd, 0);
+    if (map == MAP_FAILED) {
+        MP_VERBOSE(stream, "mmap failed: %s\n", strerror(errno));
+        return;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(map, size, MADV_SEQUENTIAL);
+#endif
+    p->map = map;
+    p->map_size = size;
+    stream->read_direct = read_direct;
+    MP_VERBOSE(stream, "File is memory mapped.\n");
+#endif
+}
+
 static int open_f(stream_t *stream)
 {
     int fd;
@@ -281,8 +349,17 @@ static int open_f(stream_t *stream)
     stream->read_chunk = 64 * 1024;
     stream->close = s_close;
 
-    if (check_stream_network(stream))
+    if (check_stream_network(stream)) {
         stream->streaming = true;
+        // Each read is a network roundtrip.
+        stream->buf_fill_min = 16 * 1024;
+    } else if (stream->opts->stream_file_mmap && !write && priv->close) {
+        // (Network filesystems are excluded, since a failing server would
+        // make accesses to the mapping crash the player.)
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+            map_file(stream, len);
+    }
 
     return STREAM_OK;
 }
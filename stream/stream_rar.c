@@ -121,11 +121,7 @@ static int rar_entry_open(stream_t *stream)
         return STREAM_ERROR;
     }
 
-    rar_file_chunk_t dummy = {
-        .mrl = base,
-    };
-    file->current_chunk = &dummy;
-    file->s = rar; // transfer ownership
+    RarAddVolume(file, rar); // transfer ownership
     file->cancel = stream->cancel;
     file->global = stream->global;
     RarSeek(file, 0);
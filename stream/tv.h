@@ -174,6 +174,8 @@ typedef struct {
 #define TVI_CONTROL_VID_SET_GAIN        0x11f
 #define TVI_CONTROL_VID_GET_GAIN        0x120
 #define TVI_CONTROL_VID_SET_WIDTH_HEIGHT        0x121
+/* arg: struct demux_packet **, set to the next frame (with pts) or NULL */
+#define TVI_CONTROL_VID_GRAB_PACKET     0x122
 
 /* TUNER controls */
 #define TVI_CONTROL_TUN_GET_FREQ        0x201
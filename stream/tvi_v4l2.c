@@ -60,6 +60,7 @@ known issues:
 #include "common/common.h"
 #include "video/img_fourcc.h"
 #include "audio/format.h"
+#include "demux/packet.h"
 #include "tv.h"
 #include "audio_in.h"
 
@@ -97,9 +98,8 @@ struct map {
 
 /** video ringbuffer entry */
 typedef struct {
-    unsigned char               *data;     ///< frame contents
+    struct demux_packet         *dp;       ///< frame contents
     long long                   timestamp; ///< frame timestamp
-    int                         framesize; ///< actual frame size
 } video_buffer_entry;
 
 /* private data */
@@ -131,8 +131,9 @@ typedef struct priv {
     int                         immediate_mode;
 
     int                         video_buffer_size_max;
-    volatile int                video_buffer_size_current;
+    int                         video_cnt_peak;
     video_buffer_entry          *video_ringbuffer;
+    struct demux_packet_pool    *video_packet_pool;
     volatile int                video_head;
     volatile int                video_tail;
     volatile int                video_cnt;
@@ -187,6 +188,7 @@ typedef struct tt_stream_props_s{
 
 static void *audio_grabber(void *data);
 static void *video_grabber(void *data);
+static struct demux_packet *grab_video_packet(priv_t *priv);
 
 /**********************************************************************\
 
@@ -646,6 +648,10 @@ static int do_control(priv_t *priv, int cmd, void *arg)
     case TVI_CONTROL_IS_VIDEO:
         return priv->capability.capabilities & V4L2_CAP_VIDEO_CAPTURE?
             TVI_CONTROL_TRUE: TVI_CONTROL_FALSE;
+    case TVI_CONTROL_VID_GRAB_PACKET:
+        *(struct demux_packet **)arg = grab_video_packet(priv);
+        return *(struct demux_packet **)arg ? TVI_CONTROL_TRUE
+                                            : TVI_CONTROL_FALSE;
     case TVI_CONTROL_IS_AUDIO:
         if (priv->tv_param->force_audio) return TVI_CONTROL_TRUE;
     case TVI_CONTROL_IS_TUNER:
@@ -1043,11 +1049,13 @@ static int uninit(priv_t *priv)
     free(priv->video_dev);        priv->video_dev = NULL;
 
     if (priv->video_ringbuffer) {
-        for (int n = 0; n < priv->video_buffer_size_current; n++) {
-            free(priv->video_ringbuffer[n].data);
+        for (int n = 0; n < priv->video_cnt; n++) {
+            int idx = (priv->video_head + n) % priv->video_buffer_size_max;
+            talloc_free(priv->video_ringbuffer[idx].dp);
         }
         free(priv->video_ringbuffer);
     }
+    talloc_free(priv->video_packet_pool);
     if (priv->tv_param->audio) {
         free(priv->audio_ringbuffer);
         free(priv->audio_skew_buffer);
@@ -1060,7 +1068,7 @@ static int uninit(priv_t *priv)
     MP_INFO(priv, "%s: %d frames successfully processed, %d frames dropped.\n",
            info.short_name, priv->frames, dropped);
     MP_VERBOSE(priv, "%s: up to %u video frames buffered.\n",
-           info.short_name, priv->video_buffer_size_current);
+           info.short_name, priv->video_cnt_peak);
     return 1;
 }
 
@@ -1351,6 +1359,7 @@ static int start(priv_t *priv)
         return 0;
     }
     pthread_mutex_init(&priv->video_buffer_mutex, NULL);
+    priv->video_packet_pool = demux_packet_pool_create(NULL);
 
     priv->video_head = 0;
     priv->video_tail = 0;
@@ -1429,20 +1438,19 @@ static int start(priv_t *priv)
 }
 
 // copies a video frame
-static inline void copy_frame(priv_t *priv, video_buffer_entry *dest, unsigned char *source,int len)
+static inline void copy_frame(priv_t *priv, struct demux_packet *dest, unsigned char *source,int len)
 {
-    dest->framesize=len;
     if(priv->tv_param->automute>0){
         if (v4l2_ioctl(priv->video_fd, VIDIOC_G_TUNER, &priv->tuner) >= 0) {
             if(priv->tv_param->automute<<8>priv->tuner.signal){
-                fill_blank_frame(dest->data,dest->framesize,fcc_vl2mp(priv->format.fmt.pix.pixelformat));
+                fill_blank_frame(dest->buffer,len,fcc_vl2mp(priv->format.fmt.pix.pixelformat));
                 set_mute(priv,1);
                 return;
             }
         }
         set_mute(priv,0);
     }
-    memcpy(dest->data, source, len);
+    memcpy(dest->buffer, source, len);
 }
 
 // maximum skew change, in frames
@@ -1452,7 +1460,6 @@ static void *video_grabber(void *data)
     priv_t *priv = (priv_t*)data;
     long long skew, prev_skew, xskew, interval, prev_interval, delta;
     int i;
-    int framesize = priv->format.fmt.pix.sizeimage;
     fd_set rdset;
     struct timeval timeout;
     struct v4l2_buffer buf;
@@ -1581,23 +1588,12 @@ static void *video_grabber(void *data)
         prev_skew = skew;
         prev_interval = interval;
 
-        /* allocate a new buffer, if needed */
-        pthread_mutex_lock(&priv->video_buffer_mutex);
-        if (priv->video_buffer_size_current < priv->video_buffer_size_max) {
-            if (priv->video_cnt == priv->video_buffer_size_current) {
-                unsigned char *newbuf = malloc(framesize);
-                if (newbuf) {
-                    memmove(priv->video_ringbuffer+priv->video_tail+1, priv->video_ringbuffer+priv->video_tail,
-                            (priv->video_buffer_size_current-priv->video_tail)*sizeof(video_buffer_entry));
-                    priv->video_ringbuffer[priv->video_tail].data = newbuf;
-                    if ((priv->video_head >= priv->video_tail) && (priv->video_cnt > 0)) priv->video_head++;
-                    priv->video_buffer_size_current++;
-                }
-            }
-        }
-        pthread_mutex_unlock(&priv->video_buffer_mutex);
+        /* the frame is copied straight into the packet handed to the demuxer */
+        struct demux_packet *dp = NULL;
+        if (priv->video_cnt < priv->video_buffer_size_max)
+            dp = new_demux_packet_pool(priv->video_packet_pool, buf.bytesused);
 
-        if (priv->video_cnt == priv->video_buffer_size_current) {
+        if (!dp) {
             if (!priv->immediate_mode) {
                 MP_ERR(priv, "\nvideo buffer full - dropping frame\n");
                 if (priv->audio_insert_null_samples) {
@@ -1623,9 +1619,13 @@ static void *video_grabber(void *data)
                     pthread_mutex_unlock(&priv->audio_mutex);
                 }
             }
-            copy_frame(priv, priv->video_ringbuffer+priv->video_tail, priv->map[buf.index].addr,buf.bytesused);
-            priv->video_tail = (priv->video_tail+1)%priv->video_buffer_size_current;
+            copy_frame(priv, dp, priv->map[buf.index].addr,buf.bytesused);
+            priv->video_ringbuffer[priv->video_tail].dp = dp;
+            pthread_mutex_lock(&priv->video_buffer_mutex);
+            priv->video_tail = (priv->video_tail+1)%priv->video_buffer_size_max;
             priv->video_cnt++;
+            priv->video_cnt_peak = MPMAX(priv->video_cnt_peak, priv->video_cnt);
+            pthread_mutex_unlock(&priv->video_buffer_mutex);
         }
         if (v4l2_ioctl(priv->video_fd, VIDIOC_QBUF, &buf) < 0) {
             MP_ERR(priv, "%s: ioctl queue buffer failed: %s\n",
@@ -1637,7 +1637,9 @@ static void *video_grabber(void *data)
 }
 
 #define MAX_LOOP 50
-static double grab_video_frame(priv_t *priv, char *buffer, int len)
+// Take the oldest captured frame out of the ringbuffer, with its pts set.
+// Returns NULL if no frame arrived in time.
+static struct demux_packet *grab_video_packet(priv_t *priv)
 {
     int loop_cnt = 0;
 
@@ -1648,17 +1650,31 @@ static double grab_video_frame(priv_t *priv, char *buffer, int len)
 
     while (priv->video_cnt == 0) {
         usleep(10000);
-        if (loop_cnt++ > MAX_LOOP) return 0;
+        if (loop_cnt++ > MAX_LOOP) return NULL;
     }
 
     pthread_mutex_lock(&priv->video_buffer_mutex);
-    long long interval = priv->video_ringbuffer[priv->video_head].timestamp;
-    memcpy(buffer, priv->video_ringbuffer[priv->video_head].data, len);
+    video_buffer_entry *entry = &priv->video_ringbuffer[priv->video_head];
+    struct demux_packet *dp = entry->dp;
+    long long interval = entry->timestamp;
+    entry->dp = NULL;
     priv->video_cnt--;
-    priv->video_head = (priv->video_head+1)%priv->video_buffer_size_current;
+    priv->video_head = (priv->video_head+1)%priv->video_buffer_size_max;
     pthread_mutex_unlock(&priv->video_buffer_mutex);
 
-    return interval == -1 ? MP_NOPTS_VALUE : interval*1e-6;
+    dp->pts = interval == -1 ? MP_NOPTS_VALUE : interval*1e-6;
+    return dp;
+}
+
+static double grab_video_frame(priv_t *priv, char *buffer, int len)
+{
+    struct demux_packet *dp = grab_video_packet(priv);
+    if (!dp)
+        return 0;
+    memcpy(buffer, dp->buffer, MPMIN(len, dp->len));
+    double pts = dp->pts;
+    talloc_free(dp);
+    return pts;
 }
 
 static int get_video_framesize(priv_t *priv)
@@ -1668,7 +1684,7 @@ static int get_video_framesize(priv_t *priv)
       thus let's return topmost frame's size
     */
     if (priv->video_cnt)
-        return priv->video_ringbuffer[priv->video_head].framesize;
+        return priv->video_ringbuffer[priv->video_head].dp->len;
     /*
       no video frames yet available. i don't know what to do in this case,
       thus let's return some fallback result (for compressed format this will be
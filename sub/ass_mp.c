@@ -183,6 +183,10 @@ void mp_ass_configure_fonts(ASS_Renderer *priv, struct osd_style_opts *opts,
     ass_set_fonts(priv, default_font, opts->font, 1, config, 1);
     mp_verbose(log, "Done.\n");
 
+    int cache_size = global->opts->ass_cache_size;
+    if (cache_size > 0)
+        ass_set_cache_limits(priv, 0, cache_size);
+
     talloc_free(tmp);
 }
 
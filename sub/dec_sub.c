@@ -60,11 +60,13 @@ struct dec_sub {
     pthread_mutex_t lock;
 
     struct mp_log *log;
+    struct mpv_global *global;
     struct MPOpts *opts;
     struct sd init_sd;
 
     double video_fps;
     const char *charset;
+    struct mp_iconv_ctx *iconv; // converter for charset
 
     struct sd *sd[MAX_NUM_SD];
     int num_sd;
@@ -93,6 +95,7 @@ struct dec_sub *sub_create(struct mpv_global *global)
 {
     struct dec_sub *sub = talloc_zero(NULL, struct dec_sub);
     sub->log = mp_log_new(sub, global->log, "sub");
+    sub->global = global;
     sub->opts = global->opts;
 
     mpthread_mutex_init_recursive(&sub->lock);
@@ -213,6 +216,7 @@ void sub_init_from_sh(struct dec_sub *sub, struct sh_stream *sh)
     while (sub->num_sd < MAX_NUM_SD) {
         struct sd *sd = talloc(NULL, struct sd);
         *sd = init_sd;
+        sd->global = sub->global;
         sd->opts = sub->opts;
         if (sub_init_decoder(sub, sd) < 0) {
             talloc_free(sd);
@@ -263,36 +267,37 @@ static void decode_chain(struct sd **sd, int num_sd, struct demux_packet *packet
     }
 }
 
-static struct demux_packet *recode_packet(struct mp_log *log,
-                                          struct demux_packet *in,
-                                          const char *charset)
+// Returns false if no conversion was done. Otherwise, *out refers to data
+// owned by sub->iconv, which is valid until the next call.
+static bool recode_packet(struct dec_sub *sub, struct demux_packet *in,
+                          struct demux_packet *out)
 {
-    struct demux_packet *pkt = NULL;
-    bstr in_buf = {in->buffer, in->len};
-    bstr conv = mp_iconv_to_utf8(log, in_buf, charset, MP_ICONV_VERBOSE);
-    if (conv.start && conv.start != in_buf.start) {
-        pkt = talloc_ptrtype(NULL, pkt);
-        talloc_steal(pkt, conv.start);
-        *pkt = (struct demux_packet) {
-            .buffer = conv.start,
-            .len = conv.len,
-            .pts = in->pts,
-            .duration = in->duration,
-            .avpacket = in->avpacket, // questionable, but gives us sidedata
-        };
+    if (!sub->iconv) {
+        sub->iconv = mp_iconv_ctx_create(sub, sub->log, sub->charset,
+                                         MP_ICONV_VERBOSE);
     }
-    return pkt;
+    bstr in_buf = {in->buffer, in->len};
+    bstr conv = mp_iconv_ctx_convert(sub->iconv, in_buf);
+    if (!conv.start || conv.start == in_buf.start)
+        return false;
+    *out = (struct demux_packet) {
+        .buffer = conv.start,
+        .len = conv.len,
+        .pts = in->pts,
+        .duration = in->duration,
+        .avpacket = in->avpacket, // questionable, but gives us sidedata
+    };
+    return true;
 }
 
 static void decode_chain_recode(struct dec_sub *sub, struct sd **sd, int num_sd,
                                 struct demux_packet *packet)
 {
     if (num_sd > 0) {
-        struct demux_packet *recoded = NULL;
-        if (sub->charset)
-            recoded = recode_packet(sub->log, packet, sub->charset);
-        decode_chain(sd, num_sd, recoded ? recoded : packet);
-        talloc_free(recoded);
+        struct demux_packet recoded;
+        if (sub->charset && recode_packet(sub, packet, &recoded))
+            packet = &recoded;
+        decode_chain(sd, num_sd, packet);
     }
 }
 
@@ -454,8 +459,11 @@ bool sub_read_all_packets(struct dec_sub *sub, struct sh_stream *sh)
         }
     }
 
-    if (opts->sub_cp && !sh->sub->is_utf8)
+    if (opts->sub_cp && !sh->sub->is_utf8) {
         sub->charset = guess_sub_cp(sub->log, subs, opts->sub_cp);
+        talloc_free(sub->iconv);
+        sub->iconv = NULL;
+    }
 
     if (sub->charset && sub->charset[0] && !mp_charset_is_utf8(sub->charset))
         MP_INFO(sub, "Using subtitle charset: %s\n", sub->charset);
@@ -532,6 +540,15 @@ bool sub_has_get_text(struct dec_sub *sub)
     return r;
 }
 
+// Height of the video the subtitles were initialized for (0 if unknown).
+int sub_get_video_height(struct dec_sub *sub)
+{
+    pthread_mutex_lock(&sub->lock);
+    int h = sub->init_sd.sub_video_h;
+    pthread_mutex_unlock(&sub->lock);
+    return h;
+}
+
 // See sub_get_bitmaps() for locking requirements.
 // It can be called unlocked too, but then only 1 thread must call this function
 // at a time (unless exclusive access is guaranteed).
@@ -51,9 +51,32 @@ struct part {
     struct sub_cache *imgs;
 };
 
+// Sub-bitmaps composited and converted for blending into images of a given
+// planar YUV format: premultiplied color and alpha per plane, at the plane's
+// chroma resolution. They are reused as long as the bitmaps don't change, so
+// that each video frame needs a single blend pass per plane.
+struct overlay {
+    struct mp_rect rc;          // covered area of the image
+    struct overlay_plane {
+        int w, h;               // in plane samples
+        float *color;           // premultiplied color, in sample values
+        float *inv_alpha;       // 1 - coverage
+    } planes[3];
+};
+
+struct overlay_part {
+    int bitmap_pos_id;
+    int imgfmt, w, h;
+    enum mp_csp colorspace;
+    enum mp_csp_levels levels;
+    int num_overlays;
+    struct overlay *overlays;
+};
+
 struct mp_draw_sub_cache
 {
     struct part *parts[MAX_OSD_PARTS];
+    struct overlay_part *overlays[MAX_OSD_PARTS];
     struct mp_image *upsample_img;
     struct mp_image upsample_temp;
 };
@@ -61,12 +84,14 @@ struct mp_draw_sub_cache
 
 static struct part *get_cache(struct mp_draw_sub_cache *cache,
                               struct sub_bitmaps *sbs, struct mp_image *format);
-static bool get_sub_area(struct mp_rect bb, struct mp_image *temp,
-                         struct sub_bitmap *sb, struct mp_image *out_area,
+static bool get_sub_rect(struct mp_rect bb, struct mp_image *temp,
+                         struct sub_bitmap *sb, struct mp_rect *out_rc,
                          int *out_src_x, int *out_src_y);
 
 #define ACCURATE
-#define CONDITIONAL
+
+// The blend loops are written without branches, so that the compiler can
+// vectorize them. (With alpha=0, the expressions return dst unchanged.)
 
 static void blend_const16_alpha(void *dst, int dst_stride, uint16_t srcp,
                                 uint8_t *srca, int srca_stride, uint8_t srcamul,
@@ -79,10 +104,6 @@ static void blend_const16_alpha(void *dst, int dst_stride, uint16_t srcp,
         uint8_t *srca_r = srca + srca_stride * y;
         for (int x = 0; x < w; x++) {
             uint32_t srcap = srca_r[x];
-#ifdef CONDITIONAL
-            if (!srcap)
-                continue;
-#endif
             srcap *= srcamul; // now 0..65025
             dst_r[x] = (srcp * srcap + dst_r[x] * (65025 - srcap) + 32512) / 65025;
         }
@@ -100,10 +121,6 @@ static void blend_const8_alpha(void *dst, int dst_stride, uint16_t srcp,
         uint8_t *srca_r = srca + srca_stride * y;
         for (int x = 0; x < w; x++) {
             uint32_t srcap = srca_r[x];
-#ifdef CONDITIONAL
-            if (!srcap)
-                continue;
-#endif
 #ifdef ACCURATE
             srcap *= srcamul; // now 0..65025
             dst_r[x] = (srcp * srcap + dst_r[x] * (65025 - srcap) + 32512) / 65025;
@@ -138,10 +155,6 @@ static void blend_src16_alpha(void *dst, int dst_stride, void *src,
         uint8_t *srca_r = srca + srca_stride * y;
         for (int x = 0; x < w; x++) {
             uint32_t srcap = srca_r[x];
-#ifdef CONDITIONAL
-            if (!srcap)
-                continue;
-#endif
             dst_r[x] = (src_r[x] * srcap + dst_r[x] * (255 - srcap) + 127) / 255;
         }
     }
@@ -157,10 +170,6 @@ static void blend_src8_alpha(void *dst, int dst_stride, void *src,
         uint8_t *srca_r = srca + srca_stride * y;
         for (int x = 0; x < w; x++) {
             uint16_t srcap = srca_r[x];
-#ifdef CONDITIONAL
-            if (!srcap)
-                continue;
-#endif
 #ifdef ACCURATE
             dst_r[x] = (src_r[x] * srcap + dst_r[x] * (255 - srcap) + 127) / 255;
 #else
@@ -258,9 +267,9 @@ static void draw_rgba(struct mp_draw_sub_cache *cache, struct mp_rect bb,
         if (sb->w < 1 || sb->h < 1)
             continue;
 
-        struct mp_image dst;
+        struct mp_rect rc;
         int src_x, src_y;
-        if (!get_sub_area(bb, temp, sb, &dst, &src_x, &src_y))
+        if (!get_sub_rect(bb, temp, sb, &rc, &src_x, &src_y))
             continue;
 
         struct mp_image *sbi = part->imgs[i].i;
@@ -272,59 +281,86 @@ static void draw_rgba(struct mp_draw_sub_cache *cache, struct mp_rect bb,
         if (!(sbi && sba))
             continue;
 
-        int bytes = (bits + 7) / 8;
+        part->imgs[i].i = talloc_steal(part, sbi);
+        part->imgs[i].a = talloc_steal(part, sba);
+
         uint8_t *alpha_p = sba->planes[0] + src_y * sba->stride[0] + src_x;
+
+        struct mp_image dst = *temp;
+        mp_image_crop_rc(&dst, rc);
+
+        int bytes = (bits + 7) / 8;
         for (int p = 0; p < (temp->num_planes > 2 ? 3 : 1); p++) {
             void *src = sbi->planes[p] + src_y * sbi->stride[p] + src_x * bytes;
             blend_src_alpha(dst.planes[p], dst.stride[p], src, sbi->stride[p],
                             alpha_p, sba->stride[0], dst.w, dst.h, bytes);
         }
-
-        part->imgs[i].i = talloc_steal(part, sbi);
-        part->imgs[i].a = talloc_steal(part, sba);
     }
 }
 
-static void draw_ass(struct mp_draw_sub_cache *cache, struct mp_rect bb,
-                     struct mp_image *temp, int bits, struct sub_bitmaps *sbs)
+// Get the matrix for converting libass colors to the colorspace of img.
+static void get_rgb2yuv(struct mp_image *img, int bits, float rgb2yuv[3][4])
 {
     struct mp_csp_params cspar = MP_CSP_PARAMS_DEFAULTS;
-    cspar.colorspace.format = temp->params.colorspace;
-    cspar.colorspace.levels_in = temp->params.colorlevels;
+    cspar.colorspace.format = img->params.colorspace;
+    cspar.colorspace.levels_in = img->params.colorlevels;
     cspar.colorspace.levels_out = MP_CSP_LEVELS_PC; // RGB (libass.color)
     cspar.int_bits_in = bits;
     cspar.int_bits_out = 8;
 
-    float yuv2rgb[3][4], rgb2yuv[3][4];
-    if (temp->flags & MP_IMGFLAG_YUV) {
+    float yuv2rgb[3][4];
+    if (img->flags & MP_IMGFLAG_YUV) {
         mp_get_yuv2rgb_coeffs(&cspar, yuv2rgb);
         mp_invert_yuv2rgb(rgb2yuv, yuv2rgb);
     }
+}
+
+// Return the alpha multiplier of a libass bitmap, and its color in
+// color (mapped to img's planes).
+static int get_ass_color(struct sub_bitmap *sb, struct mp_image *img, int bits,
+                         float rgb2yuv[3][4], int color[3])
+{
+    int r = (sb->libass.color >> 24) & 0xFF;
+    int g = (sb->libass.color >> 16) & 0xFF;
+    int b = (sb->libass.color >> 8) & 0xFF;
+    int a = 255 - (sb->libass.color & 0xFF);
+    if (img->flags & MP_IMGFLAG_YUV) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+        mp_map_int_color(rgb2yuv, bits, color);
+    } else {
+        assert(img->imgfmt == IMGFMT_GBRP);
+        color[0] = g;
+        color[1] = b;
+        color[2] = r;
+    }
+    return a;
+}
+
+static void draw_ass(struct mp_draw_sub_cache *cache, struct mp_rect bb,
+                     struct mp_image *temp, int bits, struct sub_bitmaps *sbs)
+{
+    float rgb2yuv[3][4];
+    get_rgb2yuv(temp, bits, rgb2yuv);
 
     for (int i = 0; i < sbs->num_parts; ++i) {
         struct sub_bitmap *sb = &sbs->parts[i];
 
-        struct mp_image dst;
+        struct mp_rect rc;
         int src_x, src_y;
-        if (!get_sub_area(bb, temp, sb, &dst, &src_x, &src_y))
+        if (!get_sub_rect(bb, temp, sb, &rc, &src_x, &src_y))
             continue;
 
-        int r = (sb->libass.color >> 24) & 0xFF;
-        int g = (sb->libass.color >> 16) & 0xFF;
-        int b = (sb->libass.color >> 8) & 0xFF;
-        int a = 255 - (sb->libass.color & 0xFF);
-        int color_yuv[3] = {r, g, b};
-        if (dst.flags & MP_IMGFLAG_YUV) {
-            mp_map_int_color(rgb2yuv, bits, color_yuv);
-        } else {
-            assert(dst.imgfmt == IMGFMT_GBRP);
-            color_yuv[0] = g;
-            color_yuv[1] = b;
-            color_yuv[2] = r;
-        }
+        int color_yuv[3];
+        int a = get_ass_color(sb, temp, bits, rgb2yuv, color_yuv);
 
-        int bytes = (bits + 7) / 8;
         uint8_t *alpha_p = (uint8_t *)sb->bitmap + src_y * sb->stride + src_x;
+
+        struct mp_image dst = *temp;
+        mp_image_crop_rc(&dst, rc);
+
+        int bytes = (bits + 7) / 8;
         for (int p = 0; p < (temp->num_planes > 2 ? 3 : 1); p++) {
             blend_const_alpha(dst.planes[p], dst.stride[p], color_yuv[p],
                               alpha_p, sb->stride, a, dst.w, dst.h, bytes);
@@ -428,9 +464,9 @@ static struct part *get_cache(struct mp_draw_sub_cache *cache,
     return part;
 }
 
-// Return area of intersection between target and sub-bitmap as cropped image
-static bool get_sub_area(struct mp_rect bb, struct mp_image *temp,
-                         struct sub_bitmap *sb, struct mp_image *out_area,
+// Return area of intersection between target and sub-bitmap (relative to temp)
+static bool get_sub_rect(struct mp_rect bb, struct mp_image *temp,
+                         struct sub_bitmap *sb, struct mp_rect *out_rc,
                          int *out_src_x, int *out_src_y)
 {
     // coordinates are relative to the bbox
@@ -442,8 +478,7 @@ static bool get_sub_area(struct mp_rect bb, struct mp_image *temp,
 
     *out_src_x = (dst.x0 - sb->x) + bb.x0;
     *out_src_y = (dst.y0 - sb->y) + bb.y0;
-    *out_area = *temp;
-    mp_image_crop_rc(out_area, dst);
+    *out_rc = dst;
 
     return true;
 }
@@ -529,6 +564,193 @@ static void chroma_down(struct mp_image *old_src, struct mp_image *temp)
     }
 }
 
+// Whether the overlay path can be used for dst. bits is the depth of the 4:4:4
+// format the bitmaps are converted to.
+static bool overlay_supported(struct mp_image *dst, int bits)
+{
+    struct mp_imgfmt_desc desc = dst->fmt;
+    return (desc.flags & MP_IMGFLAG_YUV_P) && (desc.flags & MP_IMGFLAG_NE) &&
+           desc.num_planes >= 3 && desc.plane_bits == bits &&
+           (desc.bytes[0] == 1 || desc.bytes[0] == 2);
+}
+
+// Composite the bitmaps over the area ov->rc (RGBA bitmaps are converted to
+// the 4:4:4 format "format" first), then reduce to the chroma resolution of
+// dst's planes. Return false on OOM.
+static bool render_overlay(struct overlay_part *part, struct overlay *ov,
+                           struct mp_image *dst, int format, int bits,
+                           struct sub_bitmaps *sbs)
+{
+    int w = ov->rc.x1 - ov->rc.x0, h = ov->rc.y1 - ov->rc.y0;
+    void *tmp = talloc_new(NULL);
+    float *color[3], *alpha;
+    for (int p = 0; p < 3; p++)
+        color[p] = talloc_zero_array(tmp, float, w * h);
+    alpha = talloc_zero_array(tmp, float, w * h);
+
+    struct mp_image conv_fmt = {0};
+    mp_image_setfmt(&conv_fmt, format);
+    conv_fmt.params.colorspace = dst->params.colorspace;
+    conv_fmt.params.colorlevels = dst->params.colorlevels;
+
+    float rgb2yuv[3][4];
+    get_rgb2yuv(dst, bits, rgb2yuv);
+
+    for (int i = 0; i < sbs->num_parts; i++) {
+        struct sub_bitmap *sb = &sbs->parts[i];
+        struct mp_rect rc = {sb->x, sb->y, sb->x + sb->dw, sb->y + sb->dh};
+        if (sb->w < 1 || sb->h < 1 || !mp_rect_intersection(&rc, &ov->rc))
+            continue;
+
+        // Source: either constant color and A8 bitmap (libass), or converted
+        // 4:4:4 image with separate alpha (RGBA).
+        struct mp_image *sbi = NULL, *sba = NULL;
+        int const_color[3] = {0};
+        float amul = 1.0 / 255;
+        if (sbs->format == SUBBITMAP_RGBA) {
+            scale_sb_rgba(sb, &conv_fmt, &sbi, &sba);
+            if (!(sbi && sba))
+                continue; // on OOM, skip bitmap
+            talloc_steal(tmp, sbi);
+            talloc_steal(tmp, sba);
+        } else {
+            amul = get_ass_color(sb, dst, bits, rgb2yuv, const_color) / 65025.0;
+        }
+        int bytes = sbi ? sbi->fmt.bytes[0] : 0;
+
+        for (int y = rc.y0; y < rc.y1; y++) {
+            int sy = y - sb->y;
+            uint8_t *a_r = sba ? sba->planes[0] + sba->stride[0] * sy
+                               : (uint8_t *)sb->bitmap + sb->stride * sy;
+            int ia = (y - ov->rc.y0) * w - ov->rc.x0;
+            for (int x = rc.x0; x < rc.x1; x++) {
+                int sx = x - sb->x;
+                float a = a_r[sx] * amul;
+                float ainv = 1.0f - a;
+                for (int p = 0; p < 3; p++) {
+                    float c = const_color[p];
+                    if (sbi) {
+                        uint8_t *s_r = sbi->planes[p] + sbi->stride[p] * sy;
+                        c = bytes == 2 ? ((uint16_t *)s_r)[sx] : s_r[sx];
+                    }
+                    color[p][ia + x] = c * a + color[p][ia + x] * ainv;
+                }
+                alpha[ia + x] = a + alpha[ia + x] * ainv;
+            }
+        }
+    }
+
+    for (int p = 0; p < 3; p++) {
+        struct overlay_plane *op = &ov->planes[p];
+        int xs = dst->fmt.xs[p], ys = dst->fmt.ys[p];
+        op->w = ((ov->rc.x1 + (1 << xs) - 1) >> xs) - (ov->rc.x0 >> xs);
+        op->h = ((ov->rc.y1 + (1 << ys) - 1) >> ys) - (ov->rc.y0 >> ys);
+        op->color = talloc_array(part, float, op->w * op->h);
+        op->inv_alpha = talloc_array(part, float, op->w * op->h);
+        // Average over the samples covered by each plane sample. (rc.x0 and
+        // rc.y0 are aligned to the chroma subsampling.)
+        for (int y = 0; y < op->h; y++) {
+            for (int x = 0; x < op->w; x++) {
+                float sum_c = 0, sum_a = 0;
+                int n = 0;
+                for (int by = y << ys; by < FFMIN((y + 1) << ys, h); by++) {
+                    for (int bx = x << xs; bx < FFMIN((x + 1) << xs, w); bx++) {
+                        sum_c += color[p][by * w + bx];
+                        sum_a += alpha[by * w + bx];
+                        n++;
+                    }
+                }
+                op->color[y * op->w + x] = sum_c / n;
+                op->inv_alpha[y * op->w + x] = 1.0f - sum_a / n;
+            }
+        }
+    }
+
+    talloc_free(tmp);
+    return true;
+}
+
+static struct overlay_part *get_overlays(struct mp_draw_sub_cache *cache,
+                                         struct mp_image *dst, int format,
+                                         int bits, struct sub_bitmaps *sbs)
+{
+    struct overlay_part *part = cache->overlays[sbs->render_index];
+    if (part && part->bitmap_pos_id == sbs->bitmap_pos_id &&
+        part->imgfmt == dst->imgfmt && part->w == dst->w && part->h == dst->h &&
+        part->colorspace == dst->params.colorspace &&
+        part->levels == dst->params.colorlevels)
+        return part;
+
+    talloc_free(part);
+    part = talloc_ptrtype(cache, part);
+    *part = (struct overlay_part) {
+        .bitmap_pos_id = sbs->bitmap_pos_id,
+        .imgfmt = dst->imgfmt,
+        .w = dst->w,
+        .h = dst->h,
+        .colorspace = dst->params.colorspace,
+        .levels = dst->params.colorlevels,
+    };
+    cache->overlays[sbs->render_index] = part;
+
+    struct mp_rect rc_list[MP_SUB_BB_LIST_MAX];
+    int num_rc = mp_get_sub_bb_list(sbs, rc_list, MP_SUB_BB_LIST_MAX);
+
+    // Align to the chroma subsampling, and merge rectangles which overlap
+    // after that, so that no pixel is blended twice.
+    struct mp_rect img_rect = {0, 0, dst->w, dst->h};
+    for (int r = 0; r < num_rc; r++) {
+        align_bbox(1 << dst->fmt.chroma_xs, 1 << dst->fmt.chroma_ys,
+                   &rc_list[r]);
+        if (!mp_rect_intersection(&rc_list[r], &img_rect))
+            MP_TARRAY_REMOVE_AT(rc_list, num_rc, r--);
+    }
+    for (int a = 0; a < num_rc; a++) {
+        for (int b = a + 1; b < num_rc; b++) {
+            struct mp_rect isect = rc_list[a];
+            if (mp_rect_intersection(&isect, &rc_list[b])) {
+                mp_rect_union(&rc_list[a], &rc_list[b]);
+                MP_TARRAY_REMOVE_AT(rc_list, num_rc, b);
+                a = -1; // the union might intersect with previous entries
+                break;
+            }
+        }
+    }
+
+    part->overlays = talloc_zero_array(part, struct overlay, num_rc);
+    for (int r = 0; r < num_rc; r++) {
+        struct overlay *ov = &part->overlays[part->num_overlays];
+        ov->rc = rc_list[r];
+        if (render_overlay(part, ov, dst, format, bits, sbs))
+            part->num_overlays++;
+    }
+
+    return part;
+}
+
+static void blend_overlay(struct mp_image *dst, struct overlay *ov)
+{
+    for (int p = 0; p < 3; p++) {
+        struct overlay_plane *op = &ov->planes[p];
+        int x0 = ov->rc.x0 >> dst->fmt.xs[p];
+        int y0 = ov->rc.y0 >> dst->fmt.ys[p];
+        for (int y = 0; y < op->h; y++) {
+            float *c = op->color + y * op->w;
+            float *ainv = op->inv_alpha + y * op->w;
+            uint8_t *d = dst->planes[p] + (y0 + y) * dst->stride[p];
+            if (dst->fmt.bytes[p] == 2) {
+                uint16_t *d16 = (uint16_t *)d + x0;
+                for (int x = 0; x < op->w; x++)
+                    d16[x] = c[x] + d16[x] * ainv[x] + 0.5f;
+            } else {
+                uint8_t *d8 = d + x0;
+                for (int x = 0; x < op->w; x++)
+                    d8[x] = c[x] + d8[x] * ainv[x] + 0.5f;
+            }
+        }
+    }
+}
+
 // cache: if not NULL, the function will set *cache to a talloc-allocated cache
 //        containing scaled versions of sbs contents - free the cache with
 //        talloc_free()
@@ -546,6 +768,13 @@ void mp_draw_sub_bitmaps(struct mp_draw_sub_cache **cache, struct mp_image *dst,
     int format, bits;
     get_closest_y444_format(dst->imgfmt, &format, &bits);
 
+    if (overlay_supported(dst, bits)) {
+        struct overlay_part *part = get_overlays(cache_, dst, format, bits, sbs);
+        for (int n = 0; n < part->num_overlays; n++)
+            blend_overlay(dst, &part->overlays[n]);
+        goto done;
+    }
+
     struct mp_rect rc_list[MP_SUB_BB_LIST_MAX];
     int num_rc = mp_get_sub_bb_list(sbs, rc_list, MP_SUB_BB_LIST_MAX);
 
@@ -570,6 +799,7 @@ void mp_draw_sub_bitmaps(struct mp_draw_sub_cache **cache, struct mp_image *dst,
         chroma_down(&dst_region, temp);
     }
 
+done:
     if (cache) {
         *cache = cache_;
     } else {
@@ -3,6 +3,9 @@
 #include <strings.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "osdep/io.h"
 
@@ -48,6 +51,81 @@ bool mp_might_be_subtitle_file(const char *filename)
     return is_sub_ext(get_ext(bstr0(filename)));
 }
 
+#define MAX_CACHED_DIRS 16
+
+struct cached_dir {
+    char *path;
+    time_t mtime;
+    time_t scan_time;
+    char **names;       // only names with a subtitle extension
+    int num_names;
+};
+
+struct mp_subfile_cache {
+    struct cached_dir **dirs;   // least recently used first
+    int num_dirs;
+};
+
+struct mp_subfile_cache *mp_subfile_cache_new(void *talloc_ctx)
+{
+    return talloc_zero(talloc_ctx, struct mp_subfile_cache);
+}
+
+// Return the list of files with subtitle extensions in the directory, or NULL
+// if it can't be opened. The result is either owned by the cache, or allocated
+// with ta_ctx.
+static struct cached_dir *scan_dir(void *ta_ctx, struct mp_subfile_cache *cache,
+                                   const char *path)
+{
+    struct stat st;
+    bool have_mtime = stat(path, &st) == 0;
+
+    if (cache && have_mtime) {
+        for (int n = 0; n < cache->num_dirs; n++) {
+            struct cached_dir *dir = cache->dirs[n];
+            if (strcmp(dir->path, path) != 0)
+                continue;
+            // If the directory was changed in the same second it was scanned,
+            // the mtime can't tell us about later changes.
+            if (dir->mtime == st.st_mtime && dir->mtime < dir->scan_time) {
+                MP_TARRAY_REMOVE_AT(cache->dirs, cache->num_dirs, n);
+                MP_TARRAY_APPEND(cache, cache->dirs, cache->num_dirs, dir);
+                return dir;
+            }
+            MP_TARRAY_REMOVE_AT(cache->dirs, cache->num_dirs, n);
+            talloc_free(dir);
+            break;
+        }
+    }
+
+    DIR *d = opendir(path);
+    if (!d)
+        return NULL;
+
+    struct cached_dir *dir = talloc_zero(ta_ctx, struct cached_dir);
+    dir->path = talloc_strdup(dir, path);
+    dir->mtime = have_mtime ? st.st_mtime : 0;
+    dir->scan_time = time(NULL);
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (is_sub_ext(get_ext(bstr0(de->d_name)))) {
+            MP_TARRAY_APPEND(dir, dir->names, dir->num_names,
+                             talloc_strdup(dir, de->d_name));
+        }
+    }
+    closedir(d);
+
+    if (cache && have_mtime) {
+        if (cache->num_dirs == MAX_CACHED_DIRS) {
+            talloc_free(cache->dirs[0]);
+            MP_TARRAY_REMOVE_AT(cache->dirs, cache->num_dirs, 0);
+        }
+        MP_TARRAY_APPEND(cache, cache->dirs, cache->num_dirs, dir);
+        talloc_steal(cache, dir);
+    }
+    return dir;
+}
+
 static int compare_sub_filename(const void *a, const void *b)
 {
     const struct subfn *s1 = a;
@@ -95,11 +173,13 @@ static struct bstr guess_lang_from_filename(struct bstr name)
  * @param path Look for subtitles in this directory
  * @param fname Subtitle filename (pattern)
  * @param limit_fuzziness Ignore flag when sub_fuziness == 2
+ * @param cache Directory listing cache, or NULL
  */
 static void append_dir_subtitles(struct mpv_global *global,
                                  struct subfn **slist, int *nsub,
                                  struct bstr path, const char *fname,
-                                 int limit_fuzziness)
+                                 int limit_fuzziness,
+                                 struct mp_subfile_cache *cache)
 {
     void *tmpmem = talloc_new(NULL);
     struct MPOpts *opts = global->opts;
@@ -118,24 +198,20 @@ static void append_dir_subtitles(struct mpv_global *global,
     // 2 = any sub file containing movie name
     // 3 = sub file containing movie name and the lang extension
     char *path0 = bstrdup0(tmpmem, path);
-    DIR *d = opendir(path0);
-    if (!d)
+    struct cached_dir *dir = scan_dir(tmpmem, cache, path0);
+    if (!dir)
         goto out;
     mp_verbose(log, "Load subtitles in %.*s\n", BSTR_P(path));
-    struct dirent *de;
-    while ((de = readdir(d))) {
-        struct bstr dename = bstr0(de->d_name);
+    for (int i = 0; i < dir->num_names; i++) {
+        struct bstr dename = bstr0(dir->names[i]);
         void *tmpmem2 = talloc_new(tmpmem);
 
         // retrieve various parts of the filename
         struct bstr tmp_fname_noext = bstrdup(tmpmem2, strip_ext(dename));
         bstr_lower(tmp_fname_noext);
-        struct bstr tmp_fname_ext = get_ext(dename);
         struct bstr tmp_fname_trim = bstr_strip(tmp_fname_noext);
 
-        // does it end with a subtitle extension?
-        if (!is_sub_ext(tmp_fname_ext))
-            goto next_sub;
+        // (scan_dir() returns files with subtitle extensions only)
 
         // we have a (likely) subtitle file
         int prio = 0;
@@ -167,7 +243,7 @@ static void append_dir_subtitles(struct mpv_global *global,
             }
         }
 
-        mp_dbg(log, "Potential sub file: \"%s\"  Priority: %d\n", de->d_name, prio);
+        mp_dbg(log, "Potential sub file: \"%s\"  Priority: %d\n", dir->names[i], prio);
         if (prio) {
             prio += prio;
             char *subpath = mp_path_join(*slist, path, dename);
@@ -186,10 +262,8 @@ static void append_dir_subtitles(struct mpv_global *global,
                 talloc_free(subpath);
         }
 
-    next_sub:
         talloc_free(tmpmem2);
     }
-    closedir(d);
 
  out:
     talloc_free(tmpmem);
@@ -224,28 +298,31 @@ static void filter_subidx(struct subfn **slist, int *nsub)
 
 // Return a list of subtitles found, sorted by priority.
 // Last element is terminated with a fname==NULL entry.
-struct subfn *find_text_subtitles(struct mpv_global *global, const char *fname)
+struct subfn *find_text_subtitles(struct mpv_global *global, const char *fname,
+                                  struct mp_subfile_cache *cache)
 {
     struct MPOpts *opts = global->opts;
     struct subfn *slist = talloc_array_ptrtype(NULL, slist, 1);
     int n = 0;
 
     // Load subtitles from current media directory
-    append_dir_subtitles(global, &slist, &n, mp_dirname(fname), fname, 0);
+    append_dir_subtitles(global, &slist, &n, mp_dirname(fname), fname, 0, cache);
 
     // Load subtitles in dirs specified by sub-paths option
     if (opts->sub_paths) {
         for (int i = 0; opts->sub_paths[i]; i++) {
             char *path = mp_path_join(slist, mp_dirname(fname),
                                       bstr0(opts->sub_paths[i]));
-            append_dir_subtitles(global, &slist, &n, bstr0(path), fname, 0);
+            append_dir_subtitles(global, &slist, &n, bstr0(path), fname, 0,
+                                 cache);
         }
     }
 
     // Load subtitles in ~/.mpv/sub limiting sub fuzziness
     char *mp_subdir = mp_find_config_file(NULL, global, "sub/");
     if (mp_subdir)
-        append_dir_subtitles(global, &slist, &n, bstr0(mp_subdir), fname, 1);
+        append_dir_subtitles(global, &slist, &n, bstr0(mp_subdir), fname, 1,
+                             cache);
     talloc_free(mp_subdir);
 
     // Sort by name for filter_subidx()
@@ -28,7 +28,15 @@ struct subfn {
 };
 
 struct mpv_global;
-struct subfn *find_text_subtitles(struct mpv_global *global, const char *fname);
+struct mp_subfile_cache;
+
+// Caches the subtitle file names found in each scanned directory, until the
+// directory's mtime changes. Free with talloc_free().
+struct mp_subfile_cache *mp_subfile_cache_new(void *talloc_ctx);
+
+// cache can be NULL.
+struct subfn *find_text_subtitles(struct mpv_global *global, const char *fname,
+                                  struct mp_subfile_cache *cache);
 
 bool mp_might_be_subtitle_file(const char *filename);
 
@@ -57,6 +57,52 @@ static void rgba_to_premultiplied_rgba(uint32_t *colors, size_t count)
     }
 }
 
+static void expand_palette(uint32_t *dst, const uint8_t *src, int w,
+                           const uint32_t *palette)
+{
+    int x = 0;
+    // Unrolled: the table lookups are independent, and don't need to wait
+    // for the previous store.
+    for (; x + 4 <= w; x += 4) {
+        uint32_t c0 = palette[src[x + 0]];
+        uint32_t c1 = palette[src[x + 1]];
+        uint32_t c2 = palette[src[x + 2]];
+        uint32_t c3 = palette[src[x + 3]];
+        dst[x + 0] = c0;
+        dst[x + 1] = c1;
+        dst[x + 2] = c2;
+        dst[x + 3] = c3;
+    }
+    for (; x < w; x++)
+        dst[x] = palette[src[x]];
+}
+
+void osd_conv_idx_part_to_rgba(void *ta_parent, struct sub_bitmap *d,
+                               struct sub_bitmap *s)
+{
+    struct osd_bmp_indexed sb = *(struct osd_bmp_indexed *)s->bitmap;
+
+    rgba_to_premultiplied_rgba(sb.palette, 256);
+
+    *d = *s;
+    struct mp_image *image = mp_image_alloc(IMGFMT_BGRA, s->w, s->h);
+    talloc_steal(ta_parent, image);
+    if (!image) {
+        // on OOM, skip the region by making it 0 sized
+        d->w = d->h = d->dw = d->dh = 0;
+        return;
+    }
+
+    d->stride = image->stride[0];
+    d->bitmap = image->planes[0];
+
+    for (int y = 0; y < s->h; y++) {
+        uint8_t *inbmp = sb.bitmap + y * s->stride;
+        uint32_t *outbmp = (uint32_t*)((uint8_t*)d->bitmap + y * d->stride);
+        expand_palette(outbmp, inbmp, s->w, sb.palette);
+    }
+}
+
 bool osd_conv_idx_to_rgba(struct osd_conv_cache *c, struct sub_bitmaps *imgs)
 {
     struct sub_bitmaps src = *imgs;
@@ -67,32 +113,8 @@ bool osd_conv_idx_to_rgba(struct osd_conv_cache *c, struct sub_bitmaps *imgs)
     talloc_free(c->parts);
     imgs->parts = c->parts = talloc_array(c, struct sub_bitmap, src.num_parts);
 
-    for (int n = 0; n < src.num_parts; n++) {
-        struct sub_bitmap *d = &imgs->parts[n];
-        struct sub_bitmap *s = &src.parts[n];
-        struct osd_bmp_indexed sb = *(struct osd_bmp_indexed *)s->bitmap;
-
-        rgba_to_premultiplied_rgba(sb.palette, 256);
-
-        *d = *s;
-        struct mp_image *image = mp_image_alloc(IMGFMT_BGRA, s->w, s->h);
-        talloc_steal(c->parts, image);
-        if (!image) {
-            // on OOM, skip the region by making it 0 sized
-            d->w = d->h = d->dw = d->dh = 0;
-            continue;
-        }
-
-        d->stride = image->stride[0];
-        d->bitmap = image->planes[0];
-
-        for (int y = 0; y < s->h; y++) {
-            uint8_t *inbmp = sb.bitmap + y * s->stride;
-            uint32_t *outbmp = (uint32_t*)((uint8_t*)d->bitmap + y * d->stride);
-            for (int x = 0; x < s->w; x++)
-                *outbmp++ = sb.palette[*inbmp++];
-        }
-    }
+    for (int n = 0; n < src.num_parts; n++)
+        osd_conv_idx_part_to_rgba(c->parts, &imgs->parts[n], &src.parts[n]);
     return true;
 }
 
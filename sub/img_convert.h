@@ -4,6 +4,7 @@
 #include <stdbool.h>
 
 struct osd_conv_cache;
+struct sub_bitmap;
 struct sub_bitmaps;
 struct mp_rect;
 
@@ -13,6 +14,10 @@ struct osd_conv_cache *osd_conv_cache_new(void);
 // the converted image data into c, and change imgs to point to the data.
 bool osd_conv_idx_to_rgba(struct osd_conv_cache *c, struct sub_bitmaps *imgs);
 bool osd_conv_ass_to_rgba(struct osd_conv_cache *c, struct sub_bitmaps *imgs);
+// Convert a single SUBBITMAP_INDEXED part s to premultiplied RGBA in d. The
+// image data is allocated with ta_parent as talloc parent.
+void osd_conv_idx_part_to_rgba(void *ta_parent, struct sub_bitmap *d,
+                               struct sub_bitmap *s);
 // Sub postprocessing
 bool osd_conv_blur_rgba(struct osd_conv_cache *c, struct sub_bitmaps *imgs,
                         double gblur);
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <assert.h>
 
 #include <libavutil/common.h>
@@ -214,8 +215,54 @@ void osd_set_nav_highlight(struct osd_state *osd, void *priv)
     pthread_mutex_unlock(&osd->lock);
 }
 
+// Return the factor by which text subtitles are rendered smaller than the
+// OSD resolution (1 if they're rendered at full resolution).
+static double get_sub_render_scale(struct osd_state *osd, struct dec_sub *sub,
+                                   struct mp_osd_res res)
+{
+    int h = osd->opts->sub_render_height;
+    if (h < 0)
+        h = sub_get_video_height(sub);
+    if (h <= 0 || h >= res.h || !sub_has_get_text(sub))
+        return 1.0;
+    return h / (double)res.h;
+}
+
+static struct mp_osd_res scale_osd_res(struct mp_osd_res res, double f)
+{
+    return (struct mp_osd_res) {
+        .w = lrint(res.w * f), .h = lrint(res.h * f),
+        .ml = lrint(res.ml * f), .mt = lrint(res.mt * f),
+        .mr = lrint(res.mr * f), .mb = lrint(res.mb * f),
+        .display_par = res.display_par,
+    };
+}
+
+// Map subtitle parts rendered at a resolution reduced by f back to the OSD
+// resolution; the VO does the actual scaling. The parts are copied, because
+// the array belongs to the subtitle decoder.
+static void scale_sub_bitmaps(struct osd_object *obj, struct sub_bitmaps *imgs,
+                              double f)
+{
+    if (imgs->format != SUBBITMAP_LIBASS || !imgs->num_parts)
+        return;
+    MP_TARRAY_GROW(obj, obj->scaled_parts, imgs->num_parts);
+    for (int n = 0; n < imgs->num_parts; n++) {
+        struct sub_bitmap p = imgs->parts[n];
+        int x1 = lrint((p.x + p.dw) / f), y1 = lrint((p.y + p.dh) / f);
+        p.x = lrint(p.x / f);
+        p.y = lrint(p.y / f);
+        p.dw = x1 - p.x;
+        p.dh = y1 - p.y;
+        obj->scaled_parts[n] = p;
+    }
+    imgs->parts = obj->scaled_parts;
+    imgs->scaled = true;
+}
+
 static void render_object(struct osd_state *osd, struct osd_object *obj,
                           struct mp_osd_res res, double video_pts,
+                          int draw_flags,
                           const bool sub_formats[SUBBITMAP_COUNT],
                           struct sub_bitmaps *out_imgs)
 {
@@ -228,6 +275,10 @@ static void render_object(struct osd_state *osd, struct osd_object *obj,
 
     *out_imgs = (struct sub_bitmaps) {0};
 
+    // If set, the renderer's change flags are exact, and force_redraw doesn't
+    // need to invalidate the VO's copy.
+    bool exact_change = false;
+
     if (!osd_res_equals(res, obj->vo_res))
         obj->force_redraw = true;
     obj->vo_res = res;
@@ -238,9 +289,19 @@ static void render_object(struct osd_state *osd, struct osd_object *obj,
             double sub_pts = video_pts;
             if (sub_pts != MP_NOPTS_VALUE)
                 sub_pts -= sub->video_offset + opts->sub_delay;
-            sub_get_bitmaps(sub->dec_sub, obj->vo_res, sub_pts, out_imgs);
+            double f = 1.0;
+            if ((draw_flags & OSD_DRAW_SCALE_LIBASS) && formats[SUBBITMAP_LIBASS])
+                f = get_sub_render_scale(osd, sub->dec_sub, obj->vo_res);
+            if (f < 1.0) {
+                sub_get_bitmaps(sub->dec_sub, scale_osd_res(obj->vo_res, f),
+                                sub_pts, out_imgs);
+                scale_sub_bitmaps(obj, out_imgs, f);
+            } else {
+                sub_get_bitmaps(sub->dec_sub, obj->vo_res, sub_pts, out_imgs);
+            }
         } else {
             osd_object_get_bitmaps(osd, obj, out_imgs);
+            exact_change = true;
         }
     } else if (obj->type == OSDTYPE_EXTERNAL2) {
         if (obj->external2 && obj->external2->format) {
@@ -252,9 +313,10 @@ static void render_object(struct osd_state *osd, struct osd_object *obj,
             mp_nav_get_highlight(obj->highlight_priv, obj->vo_res, out_imgs);
     } else {
         osd_object_get_bitmaps(osd, obj, out_imgs);
+        exact_change = true;
     }
 
-    if (obj->force_redraw) {
+    if (obj->force_redraw && !exact_change) {
         out_imgs->bitmap_id++;
         out_imgs->bitmap_pos_id++;
     }
@@ -325,7 +387,7 @@ void osd_draw(struct osd_state *osd, struct mp_osd_res res,
             sub_lock(obj->sub_state.dec_sub);
 
         struct sub_bitmaps imgs;
-        render_object(osd, obj, res, video_pts, formats, &imgs);
+        render_object(osd, obj, res, video_pts, draw_flags, formats, &imgs);
         if (imgs.num_parts > 0) {
             if (formats[imgs.format]) {
                 cb(cb_ctx, &imgs);
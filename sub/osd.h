@@ -179,6 +179,8 @@ void osd_set_nav_highlight(struct osd_state *osd, void *priv);
 enum mp_osd_draw_flags {
     OSD_DRAW_SUB_FILTER = (1 << 0),
     OSD_DRAW_SUB_ONLY   = (1 << 1),
+    // The VO can scale SUBBITMAP_LIBASS parts (dw/dh != w/h) with filtering.
+    OSD_DRAW_SCALE_LIBASS = (1 << 2),
 };
 
 void osd_draw(struct osd_state *osd, struct mp_osd_res res,
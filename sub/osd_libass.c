@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <string.h>
 #include <assert.h>
 
@@ -50,17 +51,23 @@ static void create_ass_renderer(struct osd_state *osd, struct osd_object *obj)
     if (obj->osd_render)
         return;
 
-    struct mp_log *ass_log = mp_log_new(obj, osd->log, "libass");
-    obj->osd_ass_library = mp_ass_init(osd->global, ass_log);
-    ass_add_font(obj->osd_ass_library, "mpv-osd-symbols", (void *)osd_font_pfb,
-                 sizeof(osd_font_pfb) - 1);
+    // Each object keeps its own renderer (so libass change detection and the
+    // returned image lists stay per object), but the library and the memory
+    // font are shared.
+    if (!osd->osd_ass_library) {
+        if (!osd->ass_log)
+            osd->ass_log = mp_log_new(osd, osd->log, "libass");
+        osd->osd_ass_library = mp_ass_init(osd->global, osd->ass_log);
+        ass_add_font(osd->osd_ass_library, "mpv-osd-symbols",
+                     (void *)osd_font_pfb, sizeof(osd_font_pfb) - 1);
+    }
 
-    obj->osd_render = ass_renderer_init(obj->osd_ass_library);
+    obj->osd_render = ass_renderer_init(osd->osd_ass_library);
     if (!obj->osd_render)
         abort();
 
     mp_ass_configure_fonts(obj->osd_render, osd->opts->osd_style,
-                           osd->global, ass_log);
+                           osd->global, osd->ass_log);
     ass_set_aspect_ratio(obj->osd_render, 1.0, 1.0);
 }
 
@@ -74,10 +81,11 @@ void osd_destroy_backend(struct osd_state *osd)
         if (obj->osd_render)
             ass_renderer_done(obj->osd_render);
         obj->osd_render = NULL;
-        if (obj->osd_ass_library)
-            ass_library_done(obj->osd_ass_library);
-        obj->osd_ass_library = NULL;
+        obj->osd_imgs_valid = false;
     }
+    if (osd->osd_ass_library)
+        ass_library_done(osd->osd_ass_library);
+    osd->osd_ass_library = NULL;
 }
 
 static void create_ass_track(struct osd_state *osd, struct osd_object *obj,
@@ -87,7 +95,7 @@ static void create_ass_track(struct osd_state *osd, struct osd_object *obj,
 
     ASS_Track *track = obj->osd_track;
     if (!track)
-        track = ass_new_track(obj->osd_ass_library);
+        track = ass_new_track(osd->osd_ass_library);
 
     int old_res_x = track->PlayResX;
     int old_res_y = track->PlayResY;
@@ -295,6 +303,11 @@ static void ass_draw_reset(struct ass_draw *d)
     d->text = NULL;
 }
 
+// The bar uses a higher script resolution than the rest of the OSD, so that
+// the (integer) \clip coordinates below are precise enough. All sizes are
+// relative to it, so this doesn't change how it looks.
+#define BAR_PLAYRESY (MP_ASS_FONT_PLAYRESY * 8)
+
 static void get_osd_bar_box(struct osd_state *osd, struct osd_object *obj,
                             float *o_x, float *o_y, float *o_w, float *o_h,
                             float *o_border)
@@ -302,7 +315,7 @@ static void get_osd_bar_box(struct osd_state *osd, struct osd_object *obj,
     struct MPOpts *opts = osd->opts;
 
     bool new_track = !obj->osd_track;
-    create_ass_track(osd, obj, 0, 0);
+    create_ass_track(osd, obj, 0, BAR_PLAYRESY);
     ASS_Track *track = obj->osd_track;
     ASS_Style *style = track->styles + track->default_style;
 
@@ -354,22 +367,32 @@ static void update_progbar(struct osd_state *osd, struct osd_object *obj)
     add_osd_ass_event(obj->osd_track, buf.start);
     talloc_free(buf.start);
 
+    // The shapes that move with the value are drawn with constant coordinates,
+    // and only positioned or clipped per update. This way libass can reuse
+    // the rasterized shapes from its cache, instead of rendering new ones on
+    // every update (e.g. while seeking).
     struct ass_draw *d = &(struct ass_draw) { .scale = 4 };
-    // filled area
-    d->text = talloc_asprintf_append(d->text, "{\\bord0\\pos(%f,%f)}", px, py);
-    ass_draw_start(d);
     float pos = obj->progbar_state.value * width - border / 2;
-    ass_draw_rect_cw(d, 0, 0, pos, height);
+
+    // filled area: the full bar, clipped to the current position
+    int clip_x0 = floorf(px) - 1;
+    int clip_x1 = MPMAX(clip_x0, (int)lrintf(px + pos));
+    d->text = talloc_asprintf_append(d->text,
+                                     "{\\bord0\\pos(%f,%f)\\clip(%d,%d,%d,%d)}",
+                                     px, py, clip_x0, (int)floorf(py) - 1,
+                                     clip_x1, (int)ceilf(py + height) + 1);
+    ass_draw_start(d);
+    ass_draw_rect_cw(d, 0, 0, width, height);
     ass_draw_stop(d);
     add_osd_ass_event(obj->osd_track, d->text);
     ass_draw_reset(d);
 
     // position marker
     d->text = talloc_asprintf_append(d->text, "{\\bord%f\\pos(%f,%f)}",
-                                     border / 2, px, py);
+                                     border / 2, px + pos + border / 2, py);
     ass_draw_start(d);
-    ass_draw_move_to(d, pos + border / 2, 0);
-    ass_draw_line_to(d, pos + border / 2, height);
+    ass_draw_move_to(d, 0, 0);
+    ass_draw_line_to(d, 0, height);
     ass_draw_stop(d);
     add_osd_ass_event(obj->osd_track, d->text);
     ass_draw_reset(d);
@@ -432,7 +455,7 @@ static void update_sub(struct osd_state *osd, struct osd_object *obj)
 
     create_ass_renderer(osd, obj);
     if (!obj->osd_track)
-        obj->osd_track = mp_ass_default_track(obj->osd_ass_library, osd->opts);
+        obj->osd_track = mp_ass_default_track(osd->osd_ass_library, osd->opts);
 
     struct osd_style_opts font = *opts->sub_text_style;
     font.font_size *= opts->sub_scale;
@@ -468,13 +491,25 @@ static void update_object(struct osd_state *osd, struct osd_object *obj)
     }
 }
 
+// The change flags in out_imgs come from libass' change detection, so they're
+// only set if the rendered images really differ from the previous call.
 void osd_object_get_bitmaps(struct osd_state *osd, struct osd_object *obj,
                             struct sub_bitmaps *out_imgs)
 {
+    *out_imgs = (struct sub_bitmaps) {0};
+
+    // Nothing changed since the last render (force_redraw is also set on VO
+    // resolution changes): the libass images are still valid.
+    if (!obj->force_redraw && obj->osd_imgs_valid) {
+        *out_imgs = obj->osd_imgs;
+        out_imgs->bitmap_id = out_imgs->bitmap_pos_id = 0;
+        return;
+    }
+
     if (obj->force_redraw)
         update_object(osd, obj);
 
-    *out_imgs = (struct sub_bitmaps) {0};
+    obj->osd_imgs_valid = false;
     if (!obj->osd_track)
         return;
 
@@ -483,6 +518,9 @@ void osd_object_get_bitmaps(struct osd_state *osd, struct osd_object *obj,
     mp_ass_render_frame(obj->osd_render, obj->osd_track, 0,
                         &obj->parts_cache, out_imgs);
     talloc_steal(obj, obj->parts_cache);
+
+    obj->osd_imgs = *out_imgs;
+    obj->osd_imgs_valid = true;
 }
 
 void osd_object_get_resolution(struct osd_state *osd, int obj,
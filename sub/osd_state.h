@@ -34,6 +34,7 @@ struct osd_object {
     // caches for OSD conversion (internal to render_object())
     struct osd_conv_cache *cache[OSD_CONV_CACHE_MAX];
     struct sub_bitmaps cached;
+    struct sub_bitmap *scaled_parts; // see scale_sub_bitmaps()
 
     // VO cache state
     int vo_bitmap_id;
@@ -42,9 +43,10 @@ struct osd_object {
 
     // Internally used by osd_libass.c
     struct sub_bitmap *parts_cache;
+    struct sub_bitmaps osd_imgs; // last render result (valid if osd_imgs_valid)
+    bool osd_imgs_valid;
     struct ass_track *osd_track;
     struct ass_renderer *osd_render;
-    struct ass_library *osd_ass_library;
 };
 
 struct osd_state {
@@ -61,6 +63,10 @@ struct osd_state {
     struct mp_log *log;
 
     struct mp_draw_sub_cache *draw_cache;
+
+    // Internally used by osd_libass.c; shared by all OSD objects' renderers
+    struct ass_library *osd_ass_library;
+    struct mp_log *ass_log;
 };
 
 #endif
@@ -6,6 +6,7 @@
 
 struct sd {
     struct mp_log *log;
+    struct mpv_global *global;
     struct MPOpts *opts;
 
     const struct sd_functions *driver;
@@ -20,6 +20,8 @@
 #include <assert.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include <libavutil/common.h>
 #include <ass/ass.h>
@@ -28,13 +30,38 @@
 
 #include "options/options.h"
 #include "common/common.h"
+#include "common/mem_budget.h"
 #include "common/msg.h"
+#include "osdep/atomics.h"
 #include "video/csputils.h"
 #include "video/mp_image.h"
 #include "dec_sub.h"
 #include "ass_mp.h"
 #include "sd.h"
 
+#define MAX_RENDER_AHEAD 16
+
+// Events longer than this are not put into the sorted event index, but are
+// always checked. (There are normally only few of them, like permanent signs.)
+#define INDEX_LONG_MS (60 * 1000)
+
+// libass cache limits (glyphs, bitmap MB) after a soft/hard memory trim.
+#define TRIM_SOFT_GLYPHS 1000
+#define TRIM_SOFT_BITMAP_MB 16
+#define TRIM_HARD_GLYPHS 250
+#define TRIM_HARD_BITMAP_MB 4
+
+// A frame rendered with the private render-ahead renderer. The bitmaps are
+// copied, because libass reuses its own buffers on the next render call.
+struct ahead_frame {
+    void *alloc;                // talloc parent of parts/bitmaps; NULL if free
+    long long pts;              // ms; LLONG_MIN if invalidated
+    struct mp_osd_res dim;
+    struct sub_bitmaps imgs;
+    uint64_t serial;            // position in the renderer's frame sequence
+    int64_t bytes;              // size of the copied bitmaps
+};
+
 struct sd_ass_priv {
     struct ass_track *ass_track;
     bool is_converted;
@@ -43,9 +70,50 @@ struct sd_ass_priv {
     char last_text[500];
     struct mp_image_params video_params;
     struct mp_image_params last_params;
+
+    // Index of ass_track->events, for lookups by time without going through
+    // all events. Covers the first num_indexed events.
+    int *ev_sorted;             // event indexes, sorted by Start
+    int num_ev_sorted;
+    int *ev_long;               // events with Duration > INDEX_LONG_MS
+    int num_ev_long;
+    int num_indexed;
+    int *ev_tmp;
+    int num_ev_tmp;
+
+    struct mp_mem_user *mem;
+    atomic_int mem_trim;        // pending enum mp_mem_trim request
+    bool cache_limited;         // cache limits of sd->ass_renderer changed
+
+    // --sub-ass-render-ahead. While the thread exists, lock protects all
+    // fields below, and ass_track against concurrent modification.
+    int num_ahead;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    bool thread_exit;
+    ASS_Renderer *ahead_renderer;   // NULL until the thread has set it up
+    struct ahead_frame frames[MAX_RENDER_AHEAD + 1];
+    int shown;                  // index into frames, -1 if none
+    uint64_t serial;            // last serial assigned
+    uint64_t shown_serial;      // serial of the shown frame, 0 if none
+    long long last_pts;         // pts (ms) of the last get_bitmaps() call
+    double frame_ms;            // estimated frame duration, 0 if unknown
+    struct mp_osd_res ahead_dim;
 };
 
 static void mangle_colors(struct sd *sd, struct sub_bitmaps *parts);
+static void *ahead_thread(void *arg);
+static void invalidate_frames(struct sd_ass_priv *ctx, long long start,
+                              long long end);
+
+// Called by the memory budget monitor thread.
+static void mem_trim(void *p, enum mp_mem_trim level)
+{
+    struct sd_ass_priv *ctx = p;
+    if (level > atomic_load(&ctx->mem_trim))
+        atomic_store(&ctx->mem_trim, level);
+}
 
 static bool supports_format(const char *format)
 {
@@ -79,10 +147,135 @@ static int init(struct sd *sd)
 
     mp_ass_add_default_styles(ctx->ass_track, opts);
 
+    ctx->mem = mp_mem_user_new(ctx, "libass", mem_trim, ctx);
+
+    ctx->shown = -1;
+    ctx->last_pts = LLONG_MIN;
+    ctx->num_ahead = MPCLAMP(opts->ass_render_ahead, 0, MAX_RENDER_AHEAD);
+    if (ctx->num_ahead) {
+        pthread_mutex_init(&ctx->lock, NULL);
+        pthread_cond_init(&ctx->wakeup, NULL);
+        if (pthread_create(&ctx->thread, NULL, ahead_thread, sd)) {
+            MP_ERR(sd, "Could not create render-ahead thread.\n");
+            pthread_cond_destroy(&ctx->wakeup);
+            pthread_mutex_destroy(&ctx->lock);
+            ctx->num_ahead = 0;
+        }
+    }
+
     return 0;
 }
 
-static void decode(struct sd *sd, struct demux_packet *packet)
+static void reset_index(struct sd_ass_priv *ctx)
+{
+    ctx->num_ev_sorted = 0;
+    ctx->num_ev_long = 0;
+    ctx->num_indexed = 0;
+}
+
+// Return the first position in ev_sorted with Start >= pts.
+static int index_lower_bound(struct sd_ass_priv *ctx, long long pts)
+{
+    ASS_Event *events = ctx->ass_track->events;
+    int lo = 0, hi = ctx->num_ev_sorted;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (events[ctx->ev_sorted[mid]].Start < pts) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Add events appended since the last call. Events are only ever appended to
+// the track, except on ass_flush_events() (see reset()).
+static void update_index(struct sd_ass_priv *ctx)
+{
+    ASS_Track *track = ctx->ass_track;
+    if (track->n_events < ctx->num_indexed)
+        reset_index(ctx);
+    for (int i = ctx->num_indexed; i < track->n_events; i++) {
+        ASS_Event *event = &track->events[i];
+        if (event->Duration > INDEX_LONG_MS) {
+            MP_TARRAY_APPEND(ctx, ctx->ev_long, ctx->num_ev_long, i);
+        } else {
+            // Normally events come in order, so this is cheap.
+            int pos = index_lower_bound(ctx, event->Start + 1);
+            MP_TARRAY_INSERT_AT(ctx, ctx->ev_sorted, ctx->num_ev_sorted, pos, i);
+        }
+    }
+    ctx->num_indexed = track->n_events;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return ia < ib ? -1 : (ia > ib ? 1 : 0);
+}
+
+// Put the indexes of all events visible at pts into ctx->ev_tmp, in the order
+// they appear in the track.
+static void find_events(struct sd_ass_priv *ctx, long long pts)
+{
+    ASS_Event *events = ctx->ass_track->events;
+    update_index(ctx);
+    ctx->num_ev_tmp = 0;
+    for (int n = index_lower_bound(ctx, pts - INDEX_LONG_MS);
+         n < ctx->num_ev_sorted; n++)
+    {
+        ASS_Event *event = &events[ctx->ev_sorted[n]];
+        if (event->Start > pts)
+            break;
+        if (pts < event->Start + event->Duration)
+            MP_TARRAY_APPEND(ctx, ctx->ev_tmp, ctx->num_ev_tmp, ctx->ev_sorted[n]);
+    }
+    for (int n = 0; n < ctx->num_ev_long; n++) {
+        ASS_Event *event = &events[ctx->ev_long[n]];
+        if (pts >= event->Start && pts < event->Start + event->Duration)
+            MP_TARRAY_APPEND(ctx, ctx->ev_tmp, ctx->num_ev_tmp, ctx->ev_long[n]);
+    }
+    qsort(ctx->ev_tmp, ctx->num_ev_tmp, sizeof(ctx->ev_tmp[0]), cmp_int);
+}
+
+static bool is_duplicate_event(struct sd_ass_priv *ctx, long long pts,
+                               long long duration, const char *text)
+{
+    ASS_Event *events = ctx->ass_track->events;
+    update_index(ctx);
+    int *list = ctx->ev_sorted;
+    int num = ctx->num_ev_sorted;
+    int start = index_lower_bound(ctx, pts);
+    if (duration > INDEX_LONG_MS) {
+        list = ctx->ev_long;
+        num = ctx->num_ev_long;
+        start = 0;
+    }
+    for (int n = start; n < num; n++) {
+        ASS_Event *event = &events[list[n]];
+        if (list == ctx->ev_sorted && event->Start != pts)
+            break;
+        if (event->Start == pts && event->Duration == duration &&
+            strcmp(event->Text, text) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void lock_track(struct sd_ass_priv *ctx)
+{
+    if (ctx->num_ahead)
+        pthread_mutex_lock(&ctx->lock);
+}
+
+static void unlock_track(struct sd_ass_priv *ctx)
+{
+    if (ctx->num_ahead)
+        pthread_mutex_unlock(&ctx->lock);
+}
+
+static void decode_locked(struct sd *sd, struct demux_packet *packet)
 {
     struct sd_ass_priv *ctx = sd->priv;
     ASS_Track *track = ctx->ass_track;
@@ -90,11 +283,13 @@ static void decode(struct sd *sd, struct demux_packet *packet)
     long long iduration = packet->duration * 1000 + 0.5;
     if (strcmp(sd->codec, "ass") == 0) {
         ass_process_chunk(track, packet->buffer, packet->len, ipts, iduration);
+        invalidate_frames(ctx, ipts, ipts + iduration);
         return;
     } else if (strcmp(sd->codec, "ssa") == 0) {
         // broken ffmpeg ASS packet format
         ctx->flush_on_seek = true;
         ass_process_data(track, packet->buffer, packet->len);
+        invalidate_frames(ctx, LLONG_MIN, LLONG_MAX);
         return;
     }
     // plaintext subs
@@ -108,32 +303,32 @@ static void decode(struct sd *sd, struct demux_packet *packet)
         return;
     }
     unsigned char *text = packet->buffer;
-    if (!sd->no_remove_duplicates) {
-        for (int i = 0; i < track->n_events; i++) {
-            if (track->events[i].Start == ipts
-                && (track->events[i].Duration == iduration)
-                && strcmp(track->events[i].Text, text) == 0)
-                return;   // We've already added this subtitle
-        }
-    }
+    if (!sd->no_remove_duplicates &&
+        is_duplicate_event(ctx, ipts, iduration, text))
+        return;   // We've already added this subtitle
     int eid = ass_alloc_event(track);
     ASS_Event *event = track->events + eid;
     event->Start = ipts;
     event->Duration = iduration;
     event->Style = track->default_style;
     event->Text = strdup(text);
+    invalidate_frames(ctx, ipts, ipts + iduration);
 }
 
-static void get_bitmaps(struct sd *sd, struct mp_osd_res dim, double pts,
-                        struct sub_bitmaps *res)
+static void decode(struct sd *sd, struct demux_packet *packet)
 {
     struct sd_ass_priv *ctx = sd->priv;
-    struct MPOpts *opts = sd->opts;
+    lock_track(ctx);
+    decode_locked(sd, packet);
+    unlock_track(ctx);
+}
 
-    if (pts == MP_NOPTS_VALUE || !sd->ass_renderer)
-        return;
+static void configure_renderer(struct sd *sd, ASS_Renderer *renderer,
+                               struct mp_osd_res dim)
+{
+    struct sd_ass_priv *ctx = sd->priv;
+    struct MPOpts *opts = sd->opts;
 
-    ASS_Renderer *renderer = sd->ass_renderer;
     double scale = dim.display_par;
     if (!ctx->is_converted && (!opts->ass_style_override ||
                                opts->ass_vsfilter_aspect_compat))
@@ -156,9 +351,241 @@ static void get_bitmaps(struct sd *sd, struct mp_osd_res dim, double pts,
         ass_set_storage_size(renderer, 0, 0);
     }
 #endif
-    mp_ass_render_frame(renderer, ctx->ass_track, pts * 1000 + .5,
-                        &ctx->parts, res);
-    talloc_steal(ctx, ctx->parts);
+}
+
+static bool osd_res_equals(struct mp_osd_res a, struct mp_osd_res b)
+{
+    return a.w == b.w && a.h == b.h && a.ml == b.ml && a.mt == b.mt
+        && a.mr == b.mr && a.mb == b.mb
+        && a.display_par == b.display_par;
+}
+
+static void free_frame(struct ahead_frame *f)
+{
+    talloc_free(f->alloc);
+    *f = (struct ahead_frame){0};
+}
+
+// Report the size of the render-ahead frames. (libass doesn't tell how much
+// memory its caches use.)
+static void update_mem_usage(struct sd_ass_priv *ctx)
+{
+    int64_t bytes = 0;
+    for (int n = 0; n <= ctx->num_ahead; n++)
+        bytes += ctx->frames[n].bytes;
+    mp_mem_user_set_usage(ctx->mem, bytes);
+}
+
+// Drop rendered frames in the given pts range (e.g. because the events there
+// changed). The shown frame must stay allocated, but isn't matched anymore.
+static void invalidate_frames(struct sd_ass_priv *ctx, long long start,
+                              long long end)
+{
+    for (int n = 0; n <= ctx->num_ahead; n++) {
+        struct ahead_frame *f = &ctx->frames[n];
+        if (!f->alloc || f->pts < start || f->pts > end)
+            continue;
+        if (n == ctx->shown) {
+            f->pts = LLONG_MIN;
+        } else {
+            free_frame(f);
+        }
+    }
+    update_mem_usage(ctx);
+}
+
+// Allow 1ms difference, since predicted pts are rounded to ms.
+static struct ahead_frame *find_frame(struct sd_ass_priv *ctx, long long pts,
+                                      struct mp_osd_res dim)
+{
+    for (int n = 0; n <= ctx->num_ahead; n++) {
+        struct ahead_frame *f = &ctx->frames[n];
+        if (f->alloc && f->pts != LLONG_MIN && llabs(f->pts - pts) <= 1 &&
+            osd_res_equals(f->dim, dim))
+            return f;
+    }
+    return NULL;
+}
+
+// Return a slot that is unused, or holds a frame outside of [min, max].
+static struct ahead_frame *get_free_frame(struct sd_ass_priv *ctx,
+                                          long long min, long long max)
+{
+    struct ahead_frame *best = NULL;
+    for (int n = 0; n <= ctx->num_ahead; n++) {
+        struct ahead_frame *f = &ctx->frames[n];
+        if (n == ctx->shown)
+            continue;
+        if (!f->alloc)
+            return f;
+        if ((f->pts < min || f->pts > max) && (!best || f->pts < best->pts))
+            best = f;
+    }
+    return best;
+}
+
+static void render_ahead_frame(struct sd *sd, struct ahead_frame *f,
+                               long long pts, struct mp_osd_res dim)
+{
+    struct sd_ass_priv *ctx = sd->priv;
+
+    free_frame(f);
+    f->alloc = talloc_new(NULL);
+    f->pts = pts;
+    f->dim = dim;
+    f->serial = ++ctx->serial;
+
+    configure_renderer(sd, ctx->ahead_renderer, dim);
+    struct sub_bitmap *parts = NULL;
+    mp_ass_render_frame(ctx->ahead_renderer, ctx->ass_track, pts, &parts,
+                        &f->imgs);
+    talloc_steal(f->alloc, parts);
+    for (int n = 0; n < f->imgs.num_parts; n++) {
+        struct sub_bitmap *p = &f->imgs.parts[n];
+        p->bitmap = talloc_memdup(f->alloc, p->bitmap, p->stride * p->h);
+        f->bytes += p->stride * p->h;
+    }
+    update_mem_usage(ctx);
+}
+
+// Handle a memory trim request (see mp_mem_user_new()). Lower the libass cache
+// limits, which makes libass flush its caches when they are over the limit.
+// The limits of the shared renderer are restored in uninit(). A hard trim also
+// drops the render-ahead frames.
+static void apply_mem_trim(struct sd *sd, int level)
+{
+    struct sd_ass_priv *ctx = sd->priv;
+    bool hard = level == MP_MEM_TRIM_HARD;
+    int glyphs = hard ? TRIM_HARD_GLYPHS : TRIM_SOFT_GLYPHS;
+    int bitmap_mb = hard ? TRIM_HARD_BITMAP_MB : TRIM_SOFT_BITMAP_MB;
+    MP_VERBOSE(sd, "Memory trim: limiting libass caches to %d MB.\n", bitmap_mb);
+    ass_set_cache_limits(sd->ass_renderer, glyphs, bitmap_mb);
+    ctx->cache_limited = true;
+    if (ctx->num_ahead) {
+        pthread_mutex_lock(&ctx->lock);
+        if (ctx->ahead_renderer)
+            ass_set_cache_limits(ctx->ahead_renderer, glyphs, bitmap_mb);
+        if (hard)
+            invalidate_frames(ctx, LLONG_MIN, LLONG_MAX);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+}
+
+static void *ahead_thread(void *arg)
+{
+    struct sd *sd = arg;
+    struct sd_ass_priv *ctx = sd->priv;
+
+    // Setting up the fonts can take a while (fontconfig), so don't do it in
+    // init(). get_bitmaps() uses the shared renderer until this is done.
+    ASS_Renderer *renderer = ass_renderer_init(sd->ass_library);
+    if (renderer) {
+        mp_ass_configure_fonts(renderer, sd->opts->sub_text_style,
+                               sd->global, sd->log);
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->ahead_renderer = renderer;
+    while (!ctx->thread_exit) {
+        struct ahead_frame *f = NULL;
+        long long pts = 0;
+        if (ctx->ahead_renderer && ctx->frame_ms > 0) {
+            long long max = ctx->last_pts +
+                            llrint((ctx->num_ahead + 1) * ctx->frame_ms);
+            for (int n = 1; n <= ctx->num_ahead; n++) {
+                pts = ctx->last_pts + llrint(n * ctx->frame_ms);
+                if (!find_frame(ctx, pts, ctx->ahead_dim)) {
+                    f = get_free_frame(ctx, ctx->last_pts, max);
+                    break;
+                }
+            }
+        }
+        if (!f) {
+            pthread_cond_wait(&ctx->wakeup, &ctx->lock);
+            continue;
+        }
+        render_ahead_frame(sd, f, pts, ctx->ahead_dim);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return NULL;
+}
+
+static void get_bitmaps_ahead(struct sd *sd, struct mp_osd_res dim,
+                              long long pts, struct sub_bitmaps *res)
+{
+    struct sd_ass_priv *ctx = sd->priv;
+
+    // Redraws repeat the pts, and keep the previous estimate.
+    if (pts != ctx->last_pts) {
+        double diff = ctx->last_pts == LLONG_MIN ? 0 : pts - ctx->last_pts;
+        ctx->frame_ms = diff > 0 && diff < 1000 ? diff : 0;
+    }
+    ctx->last_pts = pts;
+    ctx->ahead_dim = dim;
+
+    if (!ctx->ahead_renderer) {
+        configure_renderer(sd, sd->ass_renderer, dim);
+        mp_ass_render_frame(sd->ass_renderer, ctx->ass_track, pts,
+                            &ctx->parts, res);
+        talloc_steal(ctx, ctx->parts);
+        if (ctx->shown_serial)
+            res->bitmap_id = res->bitmap_pos_id = 1;
+        ctx->shown_serial = 0;
+        return;
+    }
+
+    struct ahead_frame *f = find_frame(ctx, pts, dim);
+    if (!f) {
+        // Not rendered in time (or seeked): render it now.
+        f = get_free_frame(ctx, LLONG_MAX, LLONG_MAX);
+        render_ahead_frame(sd, f, pts, dim);
+    }
+    ctx->shown = f - ctx->frames;
+
+    // Copy the part list, so that mangle_colors() leaves the frame alone.
+    *res = f->imgs;
+    ctx->parts = talloc_realloc(ctx, ctx->parts, struct sub_bitmap,
+                                MPMAX(f->imgs.num_parts, 1));
+    memcpy(ctx->parts, f->imgs.parts,
+           f->imgs.num_parts * sizeof(struct sub_bitmap));
+    res->parts = ctx->parts;
+
+    // The change flags are relative to the frame rendered before this one,
+    // which is not necessarily the one that was shown last.
+    if (f->serial == ctx->shown_serial) {
+        res->bitmap_id = res->bitmap_pos_id = 0;
+    } else if (!ctx->shown_serial || f->serial != ctx->shown_serial + 1) {
+        res->bitmap_id = res->bitmap_pos_id = 1;
+    }
+    ctx->shown_serial = f->serial;
+
+    pthread_cond_signal(&ctx->wakeup);
+}
+
+static void get_bitmaps(struct sd *sd, struct mp_osd_res dim, double pts,
+                        struct sub_bitmaps *res)
+{
+    struct sd_ass_priv *ctx = sd->priv;
+
+    if (pts == MP_NOPTS_VALUE || !sd->ass_renderer)
+        return;
+
+    int trim = atomic_load(&ctx->mem_trim);
+    if (trim) {
+        atomic_store(&ctx->mem_trim, MP_MEM_TRIM_NONE);
+        apply_mem_trim(sd, trim);
+    }
+
+    if (ctx->num_ahead) {
+        pthread_mutex_lock(&ctx->lock);
+        get_bitmaps_ahead(sd, dim, pts * 1000 + .5, res);
+        pthread_mutex_unlock(&ctx->lock);
+    } else {
+        configure_renderer(sd, sd->ass_renderer, dim);
+        mp_ass_render_frame(sd->ass_renderer, ctx->ass_track, pts * 1000 + .5,
+                            &ctx->parts, res);
+        talloc_steal(ctx, ctx->parts);
+    }
 
     if (!ctx->is_converted)
         mangle_colors(sd, res);
@@ -238,17 +665,16 @@ static char *get_text(struct sd *sd, double pts)
 
     struct buf b = {ctx->last_text, sizeof(ctx->last_text) - 1};
 
-    for (int i = 0; i < track->n_events; ++i) {
-        ASS_Event *event = track->events + i;
-        if (ipts >= event->Start && ipts < event->Start + event->Duration) {
-            if (event->Text) {
-                int start = b.len;
-                ass_to_plaintext(&b, event->Text);
-                if (is_whitespace_only(&b.start[start], b.len - start)) {
-                    b.len = start;
-                } else {
-                    append(&b, '\n');
-                }
+    find_events(ctx, ipts);
+    for (int i = 0; i < ctx->num_ev_tmp; ++i) {
+        ASS_Event *event = track->events + ctx->ev_tmp[i];
+        if (event->Text) {
+            int start = b.len;
+            ass_to_plaintext(&b, event->Text);
+            if (is_whitespace_only(&b.start[start], b.len - start)) {
+                b.len = start;
+            } else {
+                append(&b, '\n');
             }
         }
     }
@@ -270,15 +696,38 @@ static void fix_events(struct sd *sd)
 static void reset(struct sd *sd)
 {
     struct sd_ass_priv *ctx = sd->priv;
-    if (ctx->flush_on_seek || sd->opts->sub_clear_on_seek)
+    lock_track(ctx);
+    if (ctx->flush_on_seek || sd->opts->sub_clear_on_seek) {
         ass_flush_events(ctx->ass_track);
+        reset_index(ctx);
+    }
     ctx->flush_on_seek = false;
+    invalidate_frames(ctx, LLONG_MIN, LLONG_MAX);
+    ctx->last_pts = LLONG_MIN;
+    ctx->frame_ms = 0;
+    unlock_track(ctx);
 }
 
 static void uninit(struct sd *sd)
 {
     struct sd_ass_priv *ctx = sd->priv;
 
+    if (ctx->num_ahead) {
+        pthread_mutex_lock(&ctx->lock);
+        ctx->thread_exit = true;
+        pthread_cond_signal(&ctx->wakeup);
+        pthread_mutex_unlock(&ctx->lock);
+        pthread_join(ctx->thread, NULL);
+        if (ctx->ahead_renderer)
+            ass_renderer_done(ctx->ahead_renderer);
+        for (int n = 0; n <= ctx->num_ahead; n++)
+            free_frame(&ctx->frames[n]);
+        pthread_cond_destroy(&ctx->wakeup);
+        pthread_mutex_destroy(&ctx->lock);
+    }
+    talloc_free(ctx->mem);
+    if (ctx->cache_limited)
+        ass_set_cache_limits(sd->ass_renderer, 0, 0);
     ass_free_track(ctx->ass_track);
     talloc_free(ctx);
 }
@@ -295,7 +744,10 @@ static int control(struct sd *sd, enum sd_ctrl cmd, void *arg)
         a[0] = res / 1000.0;
         return true;
     case SD_CTRL_SET_VIDEO_PARAMS:
+        lock_track(ctx);
         ctx->video_params = *(struct mp_image_params *)arg;
+        invalidate_frames(ctx, LLONG_MIN, LLONG_MAX);
+        unlock_track(ctx);
         return CONTROL_OK;
     }
     default:
@@ -31,6 +31,7 @@
 #include "video/csputils.h"
 #include "sd.h"
 #include "dec_sub.h"
+#include "img_convert.h"
 
 #define MAX_QUEUE 4
 
@@ -40,6 +41,9 @@ struct sub {
     int count;
     struct sub_bitmap *inbitmaps;
     struct osd_bmp_indexed *imgs;
+    // Premultiplied RGBA version of inbitmaps, converted once per sub (NULL
+    // if not converted yet). Allocated as child of rgba_parts.
+    struct sub_bitmap *rgba_parts;
     double pts;
     double endpts;
     int64_t id;
@@ -50,6 +54,7 @@ struct sd_lavc_priv {
     struct sub subs[MAX_QUEUE]; // most recent event first
     struct sub_bitmap *outbitmaps;
     int64_t displayed_id;
+    bool displayed_rgba;
     int64_t new_id;
     struct mp_image_params video_params;
 };
@@ -169,19 +174,42 @@ static void clear_sub(struct sub *sub)
     if (sub->valid)
         avsubtitle_free(&sub->avsub);
     sub->valid = false;
+    talloc_free(sub->rgba_parts);
+    sub->rgba_parts = NULL;
 }
 
 static void alloc_sub(struct sd_lavc_priv *priv)
 {
     clear_sub(&priv->subs[MAX_QUEUE - 1]);
+    struct sub tmp = priv->subs[MAX_QUEUE - 1];
     for (int n = MAX_QUEUE - 1; n > 0; n--)
         priv->subs[n] = priv->subs[n - 1];
-    // clear only some fields; the memory allocs can be reused
+    // clear only some fields; the memory allocs of the dropped sub can be
+    // reused (they must not be shared with subs[1])
+    priv->subs[0] = tmp;
     priv->subs[0].valid = false;
     priv->subs[0].count = 0;
     priv->subs[0].id = priv->new_id++;
 }
 
+// Subtitles are output as RGBA converted by us, unless a postprocessing step
+// in osd.c wants the paletted image.
+static bool use_rgba(struct sd *sd)
+{
+    return !sd->opts->sub_gray && sd->opts->sub_gauss == 0.0f;
+}
+
+static void convert_to_rgba(struct sub *sub)
+{
+    if (sub->rgba_parts)
+        return;
+    sub->rgba_parts = talloc_array(NULL, struct sub_bitmap, MPMAX(sub->count, 1));
+    for (int n = 0; n < sub->count; n++) {
+        osd_conv_idx_part_to_rgba(sub->rgba_parts, &sub->rgba_parts[n],
+                                  &sub->inbitmaps[n]);
+    }
+}
+
 static void decode(struct sd *sd, struct demux_packet *packet)
 {
     struct MPOpts *opts = sd->opts;
@@ -257,6 +285,10 @@ static void decode(struct sd *sd, struct demux_packet *packet)
         b->y = r->y;
         current->count++;
     }
+
+    // Convert now, so that get_bitmaps() (on the VO path) doesn't have to.
+    if (use_rgba(sd))
+        convert_to_rgba(current);
 }
 
 static void get_bitmaps(struct sd *sd, struct mp_osd_res d, double pts,
@@ -281,16 +313,23 @@ static void get_bitmaps(struct sd *sd, struct mp_osd_res d, double pts,
     if (!current)
         return;
 
+    bool rgba = use_rgba(sd);
+    if (rgba)
+        convert_to_rgba(current);
+    struct sub_bitmap *parts = rgba ? current->rgba_parts : current->inbitmaps;
+
+    // (Copy, because osd_rescale_bitmaps() changes the positions.)
     MP_TARRAY_GROW(priv, priv->outbitmaps, current->count);
     for (int n = 0; n < current->count; n++)
-        priv->outbitmaps[n] = current->inbitmaps[n];
+        priv->outbitmaps[n] = parts[n];
 
     res->parts = priv->outbitmaps;
     res->num_parts = current->count;
-    if (priv->displayed_id != current->id)
+    if (priv->displayed_id != current->id || priv->displayed_rgba != rgba)
         res->bitmap_id = ++res->bitmap_pos_id;
     priv->displayed_id = current->id;
-    res->format = SUBBITMAP_INDEXED;
+    priv->displayed_rgba = rgba;
+    res->format = rgba ? SUBBITMAP_RGBA : SUBBITMAP_INDEXED;
 
     double video_par = -1;
     if (priv->avctx->codec_id == AV_CODEC_ID_DVD_SUBTITLE &&
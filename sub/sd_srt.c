@@ -440,6 +440,72 @@ static void convert_subrip(struct sd *sd, const char *orig,
     new_line.buf[new_line.len] = 0;
 }
 
+/*
+ *      WebVTT
+ *
+ *      Support the basic tags (italic, bold, underline) and the HTML entities
+ *      allowed by the spec. Other tags (class, voice, language, ruby, and
+ *      karaoke timestamps) are removed, but their text is kept.
+ *
+ */
+
+static const struct tag_conv webvtt_entities[] = {
+    {"&amp;", "&"}, {"&lt;", "<"}, {"&gt;", ">"},
+    {"&nbsp;", "\\h"}, {"&lrm;", "\xe2\x80\x8e"}, {"&rlm;", "\xe2\x80\x8f"},
+};
+
+static void convert_webvtt(struct sd *sd, const char *orig,
+                           char *dest, int dest_buffer_size)
+{
+    const char *line = orig;
+    struct line new_line = {
+        .buf = dest,
+        .bufsize = dest_buffer_size,
+    };
+
+    while (*line && new_line.len < new_line.bufsize - 1) {
+        const char *orig_line = line;
+
+        if (*line == '<') {
+            const char *end = strchr(line, '>');
+            if (!end) {
+                // Not a tag; pass it through.
+                new_line.buf[new_line.len++] = *line++;
+                continue;
+            }
+            // Tags can have classes, e.g. <b.loud>.
+            bool closing = line[1] == '/';
+            char tag = line[1 + closing], next = line[2 + closing];
+            if ((tag == 'b' || tag == 'i' || tag == 'u') &&
+                (next == '>' || next == '.' || next == ' '))
+                append_text(&new_line, "{\\%c%d}", tag, !closing);
+            line = end + 1;
+        } else if (*line == '&') {
+            for (int i = 0; i < MP_ARRAY_SIZE(webvtt_entities); i++) {
+                const struct tag_conv *ent = &webvtt_entities[i];
+                int from_len = strlen(ent->from);
+                if (strncmp(line, ent->from, from_len) == 0) {
+                    append_text(&new_line, "%s", ent->to);
+                    line += from_len;
+                    break;
+                }
+            }
+        } else if (*line == '{' || *line == '}') {
+            append_text(&new_line, "\\%c", *line);
+            line++;
+        } else if (*line == '\r' || *line == '\n') {
+            if (line[0] == '\r' && line[1] == '\n')
+                line++;
+            append_text(&new_line, "\\N");
+            line++;
+        }
+
+        if (line == orig_line)
+            new_line.buf[new_line.len++] = *line++;
+    }
+    new_line.buf[new_line.len] = 0;
+}
+
 static const char *const srt_ass_extradata =
     "[Script Info]\n"
     "ScriptType: v4.00+\n"
@@ -449,7 +515,8 @@ static const char *const srt_ass_extradata =
 static bool supports_format(const char *format)
 {
     return format && (strcmp(format, "subrip") == 0 ||
-                      strcmp(format, "text") == 0);
+                      strcmp(format, "text") == 0 ||
+                      strcmp(format, "webvtt") == 0);
 }
 
 static int init(struct sd *sd)
@@ -464,7 +531,11 @@ static void decode(struct sd *sd, struct demux_packet *packet)
 {
     char dest[SD_MAX_LINE_LEN];
     // Assume input buffer is padded with 0
-    convert_subrip(sd, packet->buffer, dest, sizeof(dest));
+    if (strcmp(sd->codec, "webvtt") == 0) {
+        convert_webvtt(sd, packet->buffer, dest, sizeof(dest));
+    } else {
+        convert_subrip(sd, packet->buffer, dest, sizeof(dest));
+    }
     sd_conv_add_packet(sd, dest, strlen(dest), packet->pts, packet->duration);
 }
 
@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <assert.h>
 
 #define TA_NO_WRAPPERS
@@ -28,7 +29,7 @@
 #endif
 
 struct ta_header {
-    size_t size;                // size of the user allocation
+    size_t size;                // size of the user allocation (| ARENA_BLOCK)
     struct ta_header *prev;     // ring list containing siblings
     struct ta_header *next;
     struct ta_ext_header *ext;
@@ -37,6 +38,8 @@ struct ta_header {
     struct ta_header *leak_next;
     struct ta_header *leak_prev;
     const char *name;
+    struct ta_prof_site *prof_site; // if profiled: site the size is counted in
+    size_t prof_bytes;
 #endif
 };
 
@@ -55,13 +58,34 @@ union aligned_header {
 #define PTR_TO_HEADER(ptr) (&((union aligned_header *)(ptr) - 1)->ta)
 #define PTR_FROM_HEADER(h) ((void *)((union aligned_header *)(h) + 1))
 
-#define MAX_ALLOC (((size_t)-1) - sizeof(union aligned_header))
+// Set in ta_header.size if the allocation was made from an arena. The arena
+// pointer is stored in the MIN_ALIGN bytes before the header.
+#define ARENA_BLOCK (((size_t)-1) / 2 + 1)
+
+#define MAX_ALLOC ((((size_t)-1) / 2) - sizeof(union aligned_header) - MIN_ALIGN)
+
+#define ALIGN_UP(x) (((x) + MIN_ALIGN - 1) & ~(size_t)(MIN_ALIGN - 1))
 
 // Needed for non-leaf allocations, or extended features such as destructors.
 struct ta_ext_header {
     struct ta_header *header;  // points back to normal header
     struct ta_header children; // list of children, with this as sentinel
     void (*destructor)(void *);
+    struct ta_arena *arena;    // children are allocated from this arena
+};
+
+struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;               // usable size following the chunk header
+};
+
+#define CHUNK_HEADER ALIGN_UP(sizeof(struct arena_chunk))
+
+// User data of the allocation returned by ta_new_arena().
+struct ta_arena {
+    struct arena_chunk *chunks; // current chunk first
+    char *pos, *end;            // free space in the current chunk
+    size_t chunk_size;
 };
 
 // ta_ext_header.children.size is set to this
@@ -78,6 +102,98 @@ static struct ta_header *get_header(void *ptr)
     return h;
 }
 
+static size_t get_size(struct ta_header *h)
+{
+    return h->size & ~ARENA_BLOCK;
+}
+
+// Arena the allocation was made from, or NULL if it was malloc'ed.
+static struct ta_arena *get_arena(struct ta_header *h)
+{
+    return (h->size & ARENA_BLOCK) ? ((struct ta_arena **)h)[-1] : NULL;
+}
+
+// Arena to use for children of h.
+static struct ta_arena *get_child_arena(struct ta_header *h)
+{
+    if (!h)
+        return NULL;
+    return h->ext ? h->ext->arena : get_arena(h);
+}
+
+static bool is_arena_root(struct ta_header *h)
+{
+    return h->ext && h->ext->arena == PTR_FROM_HEADER(h);
+}
+
+// Return memory for a header plus size bytes, or NULL on OOM.
+static struct ta_header *arena_alloc(struct ta_arena *a, size_t size)
+{
+    size_t need = MIN_ALIGN + sizeof(union aligned_header) + ALIGN_UP(size);
+    if (need > (size_t)(a->end - a->pos)) {
+        // Large allocations get their own chunk, and the current chunk's free
+        // space is kept.
+        bool own = need > a->chunk_size / 4;
+        size_t chunk_size = own ? need : a->chunk_size;
+        struct arena_chunk *c = malloc(CHUNK_HEADER + chunk_size);
+        if (!c)
+            return NULL;
+        c->size = chunk_size;
+        char *start = (char *)c + CHUNK_HEADER;
+        if (own && a->chunks) {
+            c->next = a->chunks->next;
+            a->chunks->next = c;
+            struct ta_header *h = (void *)(start + MIN_ALIGN);
+            ((struct ta_arena **)h)[-1] = a;
+            return h;
+        }
+        c->next = a->chunks;
+        a->chunks = c;
+        a->pos = start;
+        a->end = start + chunk_size;
+    }
+    struct ta_header *h = (void *)(a->pos + MIN_ALIGN);
+    ((struct ta_arena **)h)[-1] = a;
+    a->pos += need;
+    return h;
+}
+
+// Try to resize the most recent allocation in place.
+static bool arena_resize_last(struct ta_arena *a, struct ta_header *h,
+                              size_t size)
+{
+    char *data = PTR_FROM_HEADER(h);
+    if (data + ALIGN_UP(get_size(h)) != a->pos)
+        return false;
+    if (ALIGN_UP(size) > (size_t)(a->end - data))
+        return false;
+    a->pos = data + ALIGN_UP(size);
+    return true;
+}
+
+// Free all chunks. If keep is set, keep the current chunk for reuse.
+static void arena_release(struct ta_arena *a, bool keep)
+{
+    struct arena_chunk *c = a->chunks;
+    struct arena_chunk *kept = NULL;
+    if (keep && c && c->size == a->chunk_size) {
+        kept = c;
+        c = c->next;
+        kept->next = NULL;
+    }
+    while (c) {
+        struct arena_chunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    a->chunks = kept;
+    a->pos = a->end = NULL;
+    if (kept) {
+        a->pos = (char *)kept + CHUNK_HEADER;
+        a->end = a->pos + kept->size;
+    }
+}
+
 static struct ta_ext_header *get_or_alloc_ext_header(void *ptr)
 {
     struct ta_header *h = get_header(ptr);
@@ -89,6 +205,7 @@ static struct ta_ext_header *get_or_alloc_ext_header(void *ptr)
             return NULL;
         *h->ext = (struct ta_ext_header) {
             .header = h,
+            .arena = get_arena(h),
             .children = {
                 .next = &h->ext->children,
                 .prev = &h->ext->children,
@@ -118,6 +235,8 @@ bool ta_set_parent(void *ptr, void *ta_parent)
     struct ta_ext_header *parent_eh = get_or_alloc_ext_header(ta_parent);
     if (ta_parent && !parent_eh) // do nothing on OOM
         return false;
+    // Arena memory can't outlive the arena.
+    assert(!get_arena(ch) || (parent_eh && parent_eh->arena == get_arena(ch)));
     // Unlink from previous parent
     if (ch->next) {
         ch->next->prev = ch->prev;
@@ -135,19 +254,36 @@ bool ta_set_parent(void *ptr, void *ta_parent)
     return true;
 }
 
+static struct ta_header *alloc_header(void *ta_parent, size_t size)
+{
+    struct ta_arena *arena = get_child_arena(get_header(ta_parent));
+    struct ta_header *h;
+    if (arena) {
+        h = arena_alloc(arena, size);
+        if (h)
+            *h = (struct ta_header) {.size = size | ARENA_BLOCK};
+    } else {
+        h = malloc(sizeof(union aligned_header) + size);
+        if (h)
+            *h = (struct ta_header) {.size = size};
+    }
+    return h;
+}
+
 /* Allocate size bytes of memory. If ta_parent is not NULL, this is used as
  * parent allocation (if ta_parent is freed, this allocation is automatically
  * freed as well). size==0 allocates a block of size 0 (i.e. returns non-NULL).
+ * If ta_parent is an arena (see ta_new_arena()), or an allocation made from
+ * one, the memory is taken from the arena.
  * Returns NULL on OOM.
  */
 void *ta_alloc_size(void *ta_parent, size_t size)
 {
     if (size >= MAX_ALLOC)
         return NULL;
-    struct ta_header *h = malloc(sizeof(union aligned_header) + size);
+    struct ta_header *h = alloc_header(ta_parent, size);
     if (!h)
         return NULL;
-    *h = (struct ta_header) {.size = size};
     ta_dbg_add(h);
     void *ptr = PTR_FROM_HEADER(h);
     if (!ta_set_parent(ptr, ta_parent)) {
@@ -164,10 +300,10 @@ void *ta_zalloc_size(void *ta_parent, size_t size)
 {
     if (size >= MAX_ALLOC)
         return NULL;
-    struct ta_header *h = calloc(1, sizeof(union aligned_header) + size);
+    struct ta_header *h = alloc_header(ta_parent, size);
     if (!h)
         return NULL;
-    *h = (struct ta_header) {.size = size};
+    memset(PTR_FROM_HEADER(h), 0, size);
     ta_dbg_add(h);
     void *ptr = PTR_FROM_HEADER(h);
     if (!ta_set_parent(ptr, ta_parent)) {
@@ -201,14 +337,34 @@ void *ta_realloc_size(void *ta_parent, void *ptr, size_t size)
         return ta_alloc_size(ta_parent, size);
     struct ta_header *h = get_header(ptr);
     struct ta_header *old_h = h;
-    if (h->size == size)
+    if (get_size(h) == size)
         return ptr;
-    ta_dbg_remove(h);
-    h = realloc(h, sizeof(union aligned_header) + size);
-    ta_dbg_add(h ? h : old_h);
-    if (!h)
-        return NULL;
-    h->size = size;
+    struct ta_arena *arena = get_arena(h);
+    if (arena) {
+        if (size < get_size(h) || arena_resize_last(arena, h, size)) {
+            ta_dbg_remove(h);
+            h->size = size | ARENA_BLOCK;
+            ta_dbg_add(h);
+            return ptr;
+        }
+        // The old block stays unused until the arena is reset or freed.
+        h = arena_alloc(arena, size);
+        if (!h)
+            return NULL;
+        ta_dbg_remove(old_h);
+        memcpy(h, old_h, sizeof(union aligned_header) + get_size(old_h));
+        h->size = size | ARENA_BLOCK;
+        ta_dbg_add(h);
+    } else {
+        ta_dbg_remove(h);
+        h = realloc(h, sizeof(union aligned_header) + size);
+        if (!h) {
+            ta_dbg_add(old_h);
+            return NULL;
+        }
+        h->size = size;
+        ta_dbg_add(h);
+    }
     if (h != old_h) {
         if (h->next) {
             // Relink siblings
@@ -232,11 +388,12 @@ void *ta_realloc_size(void *ta_parent, void *ptr, size_t size)
 size_t ta_get_size(void *ptr)
 {
     struct ta_header *h = get_header(ptr);
-    return h ? h->size : 0;
+    return h ? get_size(h) : 0;
 }
 
 /* Free all allocations that (recursively) have ptr as parent allocation, but
- * do not free ptr itself.
+ * do not free ptr itself. If ptr is an arena, its memory is reset, and can
+ * be reused by new allocations.
  */
 void ta_free_children(void *ptr)
 {
@@ -246,6 +403,8 @@ void ta_free_children(void *ptr)
         return;
     while (eh->children.next != &eh->children)
         ta_free(PTR_FROM_HEADER(eh->children.next));
+    if (is_arena_root(h))
+        arena_release(eh->arena, true);
 }
 
 /* Free the given allocation, and all of its direct and indirect children.
@@ -263,9 +422,41 @@ void ta_free(void *ptr)
         h->next->prev = h->prev;
         h->prev->next = h->next;
     }
+    if (is_arena_root(h))
+        arena_release(h->ext->arena, false);
     ta_dbg_remove(h);
     free(h->ext);
-    free(h);
+    if (!get_arena(h))
+        free(h);
+}
+
+/* Create an arena. All allocations which have the arena as (direct or
+ * indirect) parent are taken from larger chunks of memory, and there is no
+ * per-allocation malloc()/free(). Freeing such an allocation runs its
+ * destructor and frees its children as usual, but its memory is reclaimed
+ * only when the arena is freed, or reset with ta_free_children().
+ *
+ * This is meant for short-lived temporary allocations. Allocations made from
+ * the arena must not be moved out of it with ta_set_parent().
+ *
+ * chunk_size is the size of the memory chunks (0 picks a default).
+ * Returns NULL on OOM.
+ */
+void *ta_new_arena(void *ta_parent, size_t chunk_size)
+{
+    struct ta_arena *a = ta_alloc_size(ta_parent, sizeof(struct ta_arena));
+    if (!a)
+        return NULL;
+    *a = (struct ta_arena) {
+        .chunk_size = chunk_size ? ALIGN_UP(chunk_size) : 16 * 1024,
+    };
+    struct ta_ext_header *eh = get_or_alloc_ext_header(a);
+    if (!eh) {
+        ta_free(a);
+        return NULL;
+    }
+    eh->arena = a;
+    return a;
 }
 
 /* Set a destructor that is to be called when the given allocation is freed.
@@ -309,20 +500,108 @@ void *ta_find_parent(void *ptr)
 
 #include <pthread.h>
 
+struct ta_prof_site {
+    const char *name;           // key; NULL for unused hash table entries
+    struct ta_prof_entry stats;
+};
+
 static pthread_mutex_t ta_dbg_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool enable_leak_check; // pretty much constant
+static bool enable_profiling;
 static struct ta_header leak_node;
 static char allocation_is_string;
+static char allocation_is_unnamed;
+
+// Open addressing hash table, keyed by the name pointer. Sites are never
+// freed, because headers point to them (the number of sites is bounded by the
+// number of allocation call sites).
+static struct ta_prof_site **prof_sites;
+static size_t prof_sites_size; // power of 2
+static size_t prof_num_sites;
+
+static size_t prof_hash(const char *name)
+{
+    return ((uintptr_t)name >> 3) * 2654435761u;
+}
+
+// Must be called with ta_dbg_mutex held. Returns NULL on OOM.
+static struct ta_prof_site *prof_get_site(const char *name)
+{
+    if (!name)
+        name = &allocation_is_unnamed;
+    if ((prof_num_sites + 1) * 2 > prof_sites_size) {
+        size_t new_size = prof_sites_size ? prof_sites_size * 2 : 1024;
+        struct ta_prof_site **new = calloc(new_size, sizeof(new[0]));
+        if (!new)
+            return NULL;
+        for (size_t n = 0; n < prof_sites_size; n++) {
+            struct ta_prof_site *site = prof_sites[n];
+            if (!site)
+                continue;
+            size_t i = prof_hash(site->name) & (new_size - 1);
+            while (new[i])
+                i = (i + 1) & (new_size - 1);
+            new[i] = site;
+        }
+        free(prof_sites);
+        prof_sites = new;
+        prof_sites_size = new_size;
+    }
+    size_t i = prof_hash(name) & (prof_sites_size - 1);
+    while (prof_sites[i] && prof_sites[i]->name != name)
+        i = (i + 1) & (prof_sites_size - 1);
+    if (!prof_sites[i]) {
+        struct ta_prof_site *site = calloc(1, sizeof(*site));
+        if (!site)
+            return NULL;
+        site->name = name;
+        prof_sites[i] = site;
+        prof_num_sites++;
+    }
+    return prof_sites[i];
+}
+
+// Must be called with ta_dbg_mutex held.
+static void prof_remove(struct ta_header *h)
+{
+    struct ta_prof_site *site = h->prof_site;
+    if (site) {
+        site->stats.bytes -= h->prof_bytes;
+        site->stats.count -= 1;
+        h->prof_site = NULL;
+        h->prof_bytes = 0;
+    }
+}
+
+// Must be called with ta_dbg_mutex held.
+static void prof_add(struct ta_header *h)
+{
+    struct ta_prof_site *site = prof_get_site(h->name);
+    if (!site)
+        return;
+    h->prof_site = site;
+    h->prof_bytes = get_size(h);
+    site->stats.bytes += h->prof_bytes;
+    site->stats.peak = site->stats.bytes > site->stats.peak
+                     ? site->stats.bytes : site->stats.peak;
+    site->stats.count += 1;
+    site->stats.total += 1;
+}
 
 static void ta_dbg_add(struct ta_header *h)
 {
     h->canary = CANARY;
-    if (enable_leak_check) {
+    h->prof_site = NULL;
+    if (enable_leak_check || enable_profiling) {
         pthread_mutex_lock(&ta_dbg_mutex);
-        h->leak_next = &leak_node;
-        h->leak_prev = leak_node.leak_prev;
-        leak_node.leak_prev->leak_next = h;
-        leak_node.leak_prev = h;
+        if (enable_leak_check) {
+            h->leak_next = &leak_node;
+            h->leak_prev = leak_node.leak_prev;
+            leak_node.leak_prev->leak_next = h;
+            leak_node.leak_prev = h;
+        }
+        if (enable_profiling)
+            prof_add(h);
         pthread_mutex_unlock(&ta_dbg_mutex);
     }
 }
@@ -336,12 +615,16 @@ static void ta_dbg_check_header(struct ta_header *h)
 static void ta_dbg_remove(struct ta_header *h)
 {
     ta_dbg_check_header(h);
-    if (h->leak_next) { // assume checking for !=NULL invariant ok without lock
+    // assume checking for !=NULL invariant ok without lock
+    if (h->leak_next || h->prof_site) {
         pthread_mutex_lock(&ta_dbg_mutex);
-        h->leak_next->leak_prev = h->leak_prev;
-        h->leak_prev->leak_next = h->leak_next;
+        if (h->leak_next) {
+            h->leak_next->leak_prev = h->leak_prev;
+            h->leak_prev->leak_next = h->leak_next;
+            h->leak_next = h->leak_prev = NULL;
+        }
+        prof_remove(h);
         pthread_mutex_unlock(&ta_dbg_mutex);
-        h->leak_next = h->leak_prev = NULL;
     }
     h->canary = 0;
 }
@@ -352,7 +635,7 @@ static size_t get_children_size(struct ta_header *h)
     if (h->ext) {
         struct ta_header *s;
         for (s = h->ext->children.next; s != &h->ext->children; s = s->next)
-            size += s->size + get_children_size(s);
+            size += get_size(s) + get_children_size(s);
     }
     return size;
 }
@@ -376,16 +659,16 @@ static void print_leak_report(void)
                     snprintf(name, sizeof(name), "%s", cur->name);
                 if (cur->name == &allocation_is_string) {
                     snprintf(name, sizeof(name), "'%.*s'",
-                             (int)cur->size, (char *)PTR_FROM_HEADER(cur));
+                             (int)get_size(cur), (char *)PTR_FROM_HEADER(cur));
                 }
                 for (int n = 0; n < sizeof(name); n++) {
                     if (name[n] && name[n] < 0x20)
                         name[n] = '.';
                 }
                 fprintf(stderr, "  %-20p %10zu %10zu  %s\n",
-                        cur, cur->size, c_size, name);
+                        cur, get_size(cur), c_size, name);
             }
-            size += cur->size;
+            size += get_size(cur);
             num_blocks += 1;
             // Unlink, and don't confuse valgrind by leaving live pointers.
             cur->leak_next->leak_prev = cur->leak_prev;
@@ -410,7 +693,8 @@ void ta_enable_leak_report(void)
 }
 
 /* Set a (static) string that will be printed if the memory allocation in ptr
- * shows up on the leak report. The string must stay valid until ptr is freed.
+ * shows up on the leak report. The string must stay valid until ptr is freed
+ * (or forever, if profiling is enabled; see ta_enable_profiling()).
  * Calling it on ptr==NULL does nothing.
  * Typically used to set location info.
  * Always returns ptr (useful for chaining function calls).
@@ -418,11 +702,92 @@ void ta_enable_leak_report(void)
 void *ta_dbg_set_loc(void *ptr, const char *loc)
 {
     struct ta_header *h = get_header(ptr);
-    if (h)
+    if (h) {
         h->name = loc;
+        if (h->prof_site) {
+            // Count it for the new name.
+            pthread_mutex_lock(&ta_dbg_mutex);
+            prof_remove(h);
+            prof_add(h);
+            pthread_mutex_unlock(&ta_dbg_mutex);
+        }
+    }
     return ptr;
 }
 
+static const char *prof_site_name(const char *name)
+{
+    if (name == &allocation_is_unnamed)
+        return "(unknown)";
+    if (name == &allocation_is_string)
+        return "(string)";
+    return name;
+}
+
+static int compare_prof_entry(const void *a, const void *b)
+{
+    const struct ta_prof_entry *e1 = a, *e2 = b;
+    if (e1->bytes != e2->bytes)
+        return e1->bytes < e2->bytes ? 1 : -1;
+    return e1->peak < e2->peak ? 1 : (e1->peak > e2->peak ? -1 : 0);
+}
+
+/* Start or stop counting allocations per allocation site (the name set with
+ * ta_dbg_set_loc(), which is the source location for the normal wrappers).
+ * When stopped, allocations made while profiling was enabled remain counted
+ * until they are freed.
+ */
+void ta_enable_profiling(bool enable)
+{
+    pthread_mutex_lock(&ta_dbg_mutex);
+    enable_profiling = enable;
+    pthread_mutex_unlock(&ta_dbg_mutex);
+}
+
+bool ta_profiling_enabled(void)
+{
+    pthread_mutex_lock(&ta_dbg_mutex);
+    bool r = enable_profiling;
+    pthread_mutex_unlock(&ta_dbg_mutex);
+    return r;
+}
+
+/* Return the statistics of all allocation sites that were seen while profiling
+ * was enabled, sorted by the number of bytes currently allocated (descending).
+ * The array is allocated with ta_parent as parent, and *num is set to the
+ * number of entries. Returns NULL if nothing was recorded, or on OOM.
+ */
+struct ta_prof_entry *ta_get_profile(void *ta_parent, size_t *num)
+{
+    *num = 0;
+    // Copy the data with malloc, because allocating with TA while holding the
+    // lock would deadlock.
+    pthread_mutex_lock(&ta_dbg_mutex);
+    size_t count = prof_num_sites;
+    struct ta_prof_entry *tmp = count ? malloc(count * sizeof(tmp[0])) : NULL;
+    size_t n = 0;
+    for (size_t i = 0; tmp && i < prof_sites_size; i++) {
+        struct ta_prof_site *site = prof_sites[i];
+        if (site) {
+            tmp[n] = site->stats;
+            tmp[n].name = prof_site_name(site->name);
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&ta_dbg_mutex);
+    if (!tmp)
+        return NULL;
+    struct ta_prof_entry *res =
+        ta_alloc_size(ta_parent, ta_calc_array_size(sizeof(res[0]), n));
+    if (res) {
+        memcpy(res, tmp, n * sizeof(res[0]));
+        qsort(res, n, sizeof(res[0]), compare_prof_entry);
+        *num = n;
+    }
+    free(tmp);
+    return res;
+}
+
 /* Mark the allocation as string. The leak report will print it literally.
  */
 void *ta_dbg_mark_as_string(void *ptr)
@@ -440,5 +805,12 @@ static void ta_dbg_remove(struct ta_header *h){}
 void ta_enable_leak_report(void){}
 void *ta_dbg_set_loc(void *ptr, const char *loc){return ptr;}
 void *ta_dbg_mark_as_string(void *ptr){return ptr;}
+void ta_enable_profiling(bool enable){}
+bool ta_profiling_enabled(void){return false;}
+struct ta_prof_entry *ta_get_profile(void *ta_parent, size_t *num)
+{
+    *num = 0;
+    return NULL;
+}
 
 #endif
@@ -51,6 +51,7 @@ void ta_free_children(void *ptr);
 bool ta_set_destructor(void *ptr, void (*destructor)(void *));
 bool ta_set_parent(void *ptr, void *ta_parent);
 void *ta_find_parent(void *ptr);
+void *ta_new_arena(void *ta_parent, size_t chunk_size);
 
 // Utility functions
 size_t ta_calc_array_size(size_t element_size, size_t count);
@@ -104,6 +105,7 @@ bool ta_vasprintf_append_buffer(char **str, const char *fmt, va_list ap) TA_PRF(
 #define ta_xset_destructor(...)         ta_oom_b(ta_set_destructor(__VA_ARGS__))
 #define ta_xset_parent(...)             ta_oom_b(ta_set_parent(__VA_ARGS__))
 #define ta_xnew_context(...)            ta_oom_p(ta_new_context(__VA_ARGS__))
+#define ta_xnew_arena(...)              ta_oom_p(ta_new_arena(__VA_ARGS__))
 #define ta_xstrdup_append(...)          ta_oom_b(ta_strdup_append(__VA_ARGS__))
 #define ta_xstrdup_append_buffer(...)   ta_oom_b(ta_strdup_append_buffer(__VA_ARGS__))
 #define ta_xstrndup_append(...)         ta_oom_b(ta_strndup_append(__VA_ARGS__))
@@ -152,4 +154,17 @@ void ta_enable_leak_report(void);
 void *ta_dbg_set_loc(void *ptr, const char *name);
 void *ta_dbg_mark_as_string(void *ptr);
 
+// Statistics for one allocation site (see ta_get_profile()).
+struct ta_prof_entry {
+    const char *name;
+    size_t bytes;       // currently allocated bytes
+    size_t peak;        // maximum of bytes
+    size_t count;       // currently allocated blocks
+    size_t total;       // number of allocations ever made
+};
+
+void ta_enable_profiling(bool enable);
+bool ta_profiling_enabled(void);
+struct ta_prof_entry *ta_get_profile(void *ta_parent, size_t *num);
+
 #endif
@@ -33,6 +33,7 @@
 #define talloc_steal                    ta_xsteal
 #define talloc_realloc_size             ta_xrealloc_size
 #define talloc_new                      ta_xnew_context
+#define talloc_new_arena                ta_xnew_arena
 #define talloc_set_destructor           ta_xset_destructor
 #define talloc_parent                   ta_find_parent
 #define talloc_enable_leak_report       ta_enable_leak_report
@@ -99,6 +100,18 @@ char *ta_talloc_asprintf_append_buffer(char *s, const char *fmt, ...) TA_PRF(2,
         (idxvar)++;                                 \
     } while (0)
 
+// Insert the element at position at, moving the following elements.
+#define MP_TARRAY_INSERT_AT(ctx, p, idxvar, at, ...)\
+    do {                                            \
+        size_t at_ = (at);                          \
+        assert(at_ <= (idxvar));                    \
+        MP_TARRAY_GROW(ctx, p, idxvar);             \
+        memmove((p) + at_ + 1, (p) + at_,           \
+                ((idxvar) - at_) * sizeof((p)[0])); \
+        (idxvar)++;                                 \
+        (p)[at_] = (TA_EXPAND_ARGS(__VA_ARGS__));   \
+    } while (0)
+
 // Doesn't actually free any memory, or do any other talloc calls.
 #define MP_TARRAY_REMOVE_AT(p, idxvar, at)          \
     do {                                            \
@@ -21,10 +21,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <pthread.h>
 
+#include <libavcodec/avcodec.h>
+
+#include "talloc.h"
 #include "common/msg.h"
+#include "common/stats.h"
 
 #include "osdep/timer.h"
 
@@ -56,9 +62,237 @@ const vd_functions_t * const mpcodecs_vd_drivers[] = {
     NULL
 };
 
+struct vd_thread_packet {
+    struct demux_packet *packet;    // NULL: drain the decoder
+    int drop_frame;
+};
+
+struct vd_thread_frame {
+    struct mp_image *mpi;           // NULL: frame dropped or decoder drained
+    bool had_packet;
+};
+
+struct vd_thread {
+    struct dec_video *d_video;
+    pthread_t thread;
+
+    // Held by the thread while it uses the decoder. Taken by the user thread
+    // to access the decoder. Must be acquired before lock.
+    pthread_mutex_t decode_lock;
+
+    // Protects all fields below.
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    bool terminate;
+    int max_frames;
+
+    struct vd_thread_packet *packets;
+    int num_packets;
+    struct vd_thread_frame *frames;
+    int num_frames;
+    int in_flight;          // packets sent without a frame received
+    bool draining;          // NULL packet sent, no further packets accepted
+    bool eof;               // decoder completely drained
+
+    int has_broken_packet_pts; // copy of the d_video field
+
+    void (*wakeup_cb)(void *ctx);
+    void *wakeup_ctx;
+};
+
+static int vd_control(struct dec_video *d_video, int cmd, void *arg)
+{
+    const struct vd_functions *vd = d_video->vd_driver;
+    if (vd)
+        return vd->control(d_video, cmd, arg);
+    return CONTROL_UNKNOWN;
+}
+
+// Discard all queued packets and frames. The caller must hold decode_lock.
+static void thread_flush(struct vd_thread *t)
+{
+    pthread_mutex_lock(&t->lock);
+    for (int n = 0; n < t->num_packets; n++)
+        talloc_free(t->packets[n].packet);
+    for (int n = 0; n < t->num_frames; n++)
+        talloc_free(t->frames[n].mpi);
+    t->num_packets = t->num_frames = 0;
+    t->in_flight = 0;
+    t->draining = t->eof = false;
+    pthread_mutex_unlock(&t->lock);
+}
+
+static void *vd_thread(void *pctx)
+{
+    struct vd_thread *t = pctx;
+    struct dec_video *d_video = t->d_video;
+
+    pthread_mutex_lock(&t->lock);
+    while (!t->terminate) {
+        if (!t->num_packets) {
+            pthread_cond_wait(&t->wakeup, &t->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&t->lock);
+        pthread_mutex_lock(&t->decode_lock);
+        pthread_mutex_lock(&t->lock);
+        if (!t->num_packets) {
+            // Flushed while the lock was released.
+            pthread_mutex_unlock(&t->decode_lock);
+            continue;
+        }
+        struct vd_thread_packet p = t->packets[0];
+        MP_TARRAY_REMOVE_AT(t->packets, t->num_packets, 0);
+        pthread_mutex_unlock(&t->lock);
+
+        struct vd_thread_frame f = {
+            .mpi = video_decode(d_video, p.packet, p.drop_frame),
+            .had_packet = !!p.packet,
+        };
+        talloc_free(p.packet);
+
+        pthread_mutex_lock(&t->lock);
+        MP_TARRAY_APPEND(t, t->frames, t->num_frames, f);
+        t->has_broken_packet_pts = d_video->has_broken_packet_pts;
+        pthread_mutex_unlock(&t->decode_lock);
+        if (t->wakeup_cb)
+            t->wakeup_cb(t->wakeup_ctx);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+// Decode video in a separate thread. Up to max_frames packets are decoded
+// ahead of the frames returned by video_thread_receive(). wakeup_cb is called
+// from the thread whenever a new frame is available.
+// If the thread can't be created, decoding remains synchronous.
+void video_start_thread(struct dec_video *d_video, int max_frames,
+                        void (*wakeup_cb)(void *ctx), void *wakeup_ctx)
+{
+    assert(!d_video->thread);
+    struct vd_thread *t = talloc_ptrtype(NULL, t);
+    *t = (struct vd_thread){
+        .d_video = d_video,
+        .max_frames = max_frames,
+        .has_broken_packet_pts = d_video->has_broken_packet_pts,
+        .wakeup_cb = wakeup_cb,
+        .wakeup_ctx = wakeup_ctx,
+    };
+    pthread_mutex_init(&t->decode_lock, NULL);
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->wakeup, NULL);
+    if (pthread_create(&t->thread, NULL, vd_thread, t)) {
+        MP_ERR(d_video, "Could not create decoder thread.\n");
+        pthread_cond_destroy(&t->wakeup);
+        pthread_mutex_destroy(&t->lock);
+        pthread_mutex_destroy(&t->decode_lock);
+        talloc_free(t);
+        return;
+    }
+    MP_VERBOSE(d_video, "Decoding up to %d frames ahead.\n", max_frames);
+    d_video->thread = t;
+}
+
+static void stop_thread(struct dec_video *d_video)
+{
+    struct vd_thread *t = d_video->thread;
+    if (!t)
+        return;
+    pthread_mutex_lock(&t->lock);
+    t->terminate = true;
+    pthread_cond_signal(&t->wakeup);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    thread_flush(t);
+    pthread_cond_destroy(&t->wakeup);
+    pthread_mutex_destroy(&t->lock);
+    pthread_mutex_destroy(&t->decode_lock);
+    talloc_free(t);
+    d_video->thread = NULL;
+}
+
+// Whether video_thread_send() accepts another packet.
+bool video_thread_can_send(struct dec_video *d_video)
+{
+    struct vd_thread *t = d_video->thread;
+    pthread_mutex_lock(&t->lock);
+    bool r = t->in_flight < t->max_frames && !t->draining;
+    pthread_mutex_unlock(&t->lock);
+    return r;
+}
+
+// Queue a packet for decoding. Takes ownership of the packet. A NULL packet
+// starts draining the decoder after the last packet.
+void video_thread_send(struct dec_video *d_video, struct demux_packet *packet,
+                       int drop_frame)
+{
+    struct vd_thread *t = d_video->thread;
+    pthread_mutex_lock(&t->lock);
+    struct vd_thread_packet p = {packet, drop_frame};
+    MP_TARRAY_APPEND(t, t->packets, t->num_packets, p);
+    t->in_flight++;
+    t->draining |= !packet;
+    pthread_cond_signal(&t->wakeup);
+    pthread_mutex_unlock(&t->lock);
+}
+
+// Return the result of decoding the oldest sent packet. This is the same
+// video_decode() would have returned for it (*out_mpi=NULL for dropped frames,
+// *out_had_packet=false when draining).
+// Returns 1 on success, 0 if no result is available yet, and -1 if the decoder
+// was completely drained.
+int video_thread_receive(struct dec_video *d_video, struct mp_image **out_mpi,
+                         bool *out_had_packet)
+{
+    struct vd_thread *t = d_video->thread;
+    int r = 0;
+    *out_mpi = NULL;
+    *out_had_packet = false;
+    pthread_mutex_lock(&t->lock);
+    if (t->num_frames) {
+        struct vd_thread_frame f = t->frames[0];
+        MP_TARRAY_REMOVE_AT(t->frames, t->num_frames, 0);
+        t->in_flight--;
+        if (!f.had_packet) {
+            if (f.mpi) {
+                // Drain the next frame.
+                struct vd_thread_packet p = {0};
+                MP_TARRAY_APPEND(t, t->packets, t->num_packets, p);
+                t->in_flight++;
+                pthread_cond_signal(&t->wakeup);
+            } else {
+                t->eof = true;
+            }
+        }
+        *out_mpi = f.mpi;
+        *out_had_packet = f.had_packet;
+        r = 1;
+    }
+    if (t->eof && !*out_mpi)
+        r = -1;
+    pthread_mutex_unlock(&t->lock);
+    return r;
+}
+
+int video_get_broken_packet_pts(struct dec_video *d_video)
+{
+    struct vd_thread *t = d_video->thread;
+    if (!t)
+        return d_video->has_broken_packet_pts;
+    pthread_mutex_lock(&t->lock);
+    int r = t->has_broken_packet_pts;
+    pthread_mutex_unlock(&t->lock);
+    return r;
+}
+
 void video_reset_decoding(struct dec_video *d_video)
 {
-    video_vd_control(d_video, VDCTRL_RESET, NULL);
+    struct vd_thread *t = d_video->thread;
+    if (t) {
+        pthread_mutex_lock(&t->decode_lock);
+        thread_flush(t);
+    }
+    vd_control(d_video, VDCTRL_RESET, NULL);
     if (d_video->vfilter && d_video->vfilter->initialized == 1)
         vf_seek_reset(d_video->vfilter);
     mp_image_unrefp(&d_video->waiting_decoded_mpi);
@@ -70,14 +304,30 @@ void video_reset_decoding(struct dec_video *d_video)
     d_video->codec_dts = MP_NOPTS_VALUE;
     d_video->sorted_pts = MP_NOPTS_VALUE;
     d_video->unsorted_pts = MP_NOPTS_VALUE;
+    if (t)
+        pthread_mutex_unlock(&t->decode_lock);
 }
 
 int video_vd_control(struct dec_video *d_video, int cmd, void *arg)
 {
-    const struct vd_functions *vd = d_video->vd_driver;
-    if (vd)
-        return vd->control(d_video, cmd, arg);
-    return CONTROL_UNKNOWN;
+    struct vd_thread *t = d_video->thread;
+    if (t)
+        pthread_mutex_lock(&t->decode_lock);
+    int r = vd_control(d_video, cmd, arg);
+    if (t && cmd == VDCTRL_FORCE_HWDEC_FALLBACK && r == CONTROL_OK) {
+        // Frames decoded before the fallback have the hardware format.
+        pthread_mutex_lock(&t->lock);
+        for (int n = 0; n < t->num_frames; n++) {
+            talloc_free(t->frames[n].mpi);
+            t->eof |= !t->frames[n].had_packet;
+        }
+        t->in_flight -= t->num_frames;
+        t->num_frames = 0;
+        pthread_mutex_unlock(&t->lock);
+    }
+    if (t)
+        pthread_mutex_unlock(&t->decode_lock);
+    return r;
 }
 
 int video_set_colors(struct dec_video *d_video, const char *item, int value)
@@ -117,6 +367,7 @@ int video_get_colors(struct dec_video *d_video, const char *item, int *value)
 
 void video_uninit(struct dec_video *d_video)
 {
+    stop_thread(d_video);
     mp_image_unrefp(&d_video->waiting_decoded_mpi);
     if (d_video->vd_driver) {
         MP_VERBOSE(d_video, "Uninit video.\n");
@@ -127,6 +378,66 @@ void video_uninit(struct dec_video *d_video)
     talloc_free(d_video);
 }
 
+static char *append_hex(char *s, unsigned char *data, int len)
+{
+    for (int n = 0; n < len; n++)
+        s = talloc_asprintf_append_buffer(s, "%02x", data[n]);
+    return s;
+}
+
+// Return a string that is equal for two streams if a decoder opened for one
+// of them can decode the other. NULL if the stream is not suitable for reuse.
+static char *get_reuse_key(void *ta_parent, struct sh_stream *sh)
+{
+    struct sh_video *v = sh->video;
+    if (!sh->codec || sh->attached_picture)
+        return NULL;
+    char *key = talloc_asprintf(ta_parent, "%s/%x/%dx%d/%dx%d/%d/",
+                                sh->codec, sh->format, v->coded_width,
+                                v->coded_height, v->disp_w, v->disp_h,
+                                v->bits_per_coded_sample);
+    key = append_hex(key, v->extradata, v->extradata_len);
+    struct AVCodecContext *lavc = sh->lav_headers;
+    if (lavc) {
+        key = talloc_asprintf_append_buffer(key, "/%d/%x/%dx%d/%d/",
+                                            lavc->codec_id, lavc->codec_tag,
+                                            lavc->width, lavc->height,
+                                            lavc->bits_per_coded_sample);
+        key = append_hex(key, lavc->extradata, lavc->extradata_size);
+    }
+    return key;
+}
+
+// Dissociate the decoder from its stream, so that the stream (and its
+// demuxer) can be freed. The decoder can then be reused with video_reattach().
+void video_detach(struct dec_video *d_video)
+{
+    stop_thread(d_video);
+    video_reset_decoding(d_video);
+    talloc_free(d_video->reuse_key);
+    d_video->reuse_key = get_reuse_key(d_video, d_video->header);
+    d_video->header = NULL;
+}
+
+// Use a detached decoder for a new stream. Returns false if the stream is not
+// compatible, in which case the decoder must be destroyed.
+bool video_reattach(struct dec_video *d_video, struct sh_stream *sh)
+{
+    assert(!d_video->header);
+    char *key = get_reuse_key(NULL, sh);
+    bool ok = key && d_video->reuse_key && strcmp(key, d_video->reuse_key) == 0;
+    talloc_free(key);
+    if (!ok)
+        return false;
+    talloc_free(d_video->reuse_key);
+    d_video->reuse_key = NULL;
+    d_video->header = sh;
+    d_video->fps = sh->video->fps;
+    d_video->has_broken_packet_pts = -10;
+    MP_VERBOSE(d_video, "Reusing video decoder %s\n", d_video->decoder_desc);
+    return true;
+}
+
 static int init_video_codec(struct dec_video *d_video, const char *decoder)
 {
     if (!d_video->vd_driver->init(d_video, decoder)) {
@@ -209,7 +520,7 @@ static void add_pts_to_sort(struct dec_video *d_video, double pts)
 {
     if (pts != MP_NOPTS_VALUE) {
         int delay = -1;
-        video_vd_control(d_video, VDCTRL_QUERY_UNSEEN_FRAMES, &delay);
+        vd_control(d_video, VDCTRL_QUERY_UNSEEN_FRAMES, &delay);
         if (delay >= 0 && delay < d_video->num_buffered_pts)
             d_video->num_buffered_pts = delay;
         if (d_video->num_buffered_pts ==
@@ -310,13 +621,14 @@ struct mp_image *video_decode(struct dec_video *d_video,
     double prev_codec_pts = d_video->codec_pts;
     double prev_codec_dts = d_video->codec_dts;
 
-    MP_STATS(d_video, "start decode video");
+    MP_STATS_START(d_video, "decode video");
 
     struct mp_image *mpi = d_video->vd_driver->decode(d_video, packet, drop_frame);
 
-    MP_STATS(d_video, "end decode video");
+    MP_STATS_END(d_video, "decode video");
 
-    if (!mpi || drop_frame) {
+    // drop_frame==3 skips non-keyframes, but returns decoded keyframes.
+    if (!mpi || (drop_frame && drop_frame != 3)) {
         talloc_free(mpi);
         return NULL;            // error / skipped frame
     }
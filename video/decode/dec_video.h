@@ -78,12 +78,20 @@ struct dec_video {
 
     // State used only by player/video.c
     double last_pts;
+
+    // Decode-ahead thread (see video_start_thread()), or NULL.
+    struct vd_thread *thread;
+
+    // Stream parameters while detached (header==NULL), see video_detach().
+    char *reuse_key;
 };
 
 struct mp_decoder_list *video_decoder_list(void);
 
 bool video_init_best_codec(struct dec_video *d_video, char* video_decoders);
 void video_uninit(struct dec_video *d_video);
+void video_detach(struct dec_video *d_video);
+bool video_reattach(struct dec_video *d_video, struct sh_stream *sh);
 
 struct demux_packet;
 struct mp_image *video_decode(struct dec_video *d_video,
@@ -95,6 +103,15 @@ int video_set_colors(struct dec_video *d_video, const char *item, int value);
 void video_reset_decoding(struct dec_video *d_video);
 int video_vd_control(struct dec_video *d_video, int cmd, void *arg);
 
+void video_start_thread(struct dec_video *d_video, int max_frames,
+                        void (*wakeup_cb)(void *ctx), void *wakeup_ctx);
+bool video_thread_can_send(struct dec_video *d_video);
+void video_thread_send(struct dec_video *d_video, struct demux_packet *packet,
+                       int drop_frame);
+int video_thread_receive(struct dec_video *d_video, struct mp_image **out_mpi,
+                         bool *out_had_packet);
+int video_get_broken_packet_pts(struct dec_video *d_video);
+
 int video_reconfig_filters(struct dec_video *d_video,
                            const struct mp_image_params *params);
 
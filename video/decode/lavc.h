@@ -31,6 +31,15 @@ typedef struct lavc_ctx {
     int best_csp;
     enum AVDiscard skip_frame;
     const char *software_fallback_decoder;
+    char *decoder;
+
+    // Video size the thread count was chosen for, and size of the decoded
+    // video if the decoder was reopened because of a size change.
+    int threads_w, threads_h;
+    int frame_w, frame_h;
+
+    // Set if the VO refused allocating a direct rendering image.
+    bool dr_failed;
 
     // From VO
     struct mp_hwdec_info *hwdec_info;
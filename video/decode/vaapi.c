@@ -67,6 +67,7 @@ struct priv {
 
     struct mp_image_pool *pool;
     int rt_format;
+    int surface_w, surface_h;   // size of the surfaces in the pool
 
     struct mp_image_pool *sw_pool;
     bool printed_readback_warning;
@@ -200,8 +201,23 @@ static void destroy_decoder(struct lavc_ctx *ctx)
     }
 
     va_unlock(p->ctx);
+}
 
-    mp_image_pool_clear(p->pool);
+// Surfaces can be recycled for the next decoder only if none of them is still
+// in use (they must all be passed to the new decoder), and they have the
+// right size.
+static void recycle_surfaces(struct lavc_ctx *ctx, int num, int w, int h)
+{
+    struct priv *p = ctx->hwdec_priv;
+    int total, used;
+    mp_image_pool_get_usage(p->pool, &total, &used);
+    if (used || total > num || w != p->surface_w || h != p->surface_h) {
+        mp_image_pool_clear(p->pool);
+        total = 0;
+    }
+    p->surface_w = w;
+    p->surface_h = h;
+    MP_VERBOSE(p, "Using %d surfaces (%d recycled).\n", num, total);
 }
 
 static bool has_profile(VAProfile *va_profiles, int num_profiles, VAProfile p)
@@ -262,6 +278,8 @@ static int init_decoder(struct lavc_ctx *ctx, int fmt, int w, int h)
         goto error;
     }
 
+    recycle_surfaces(ctx, num_surfaces, w, h);
+
     VASurfaceID surfaces[MAX_SURFACES];
     if (!preallocate_surfaces(ctx, num_surfaces, w, h, surfaces)) {
         MP_ERR(p, "Could not allocate surfaces.\n");
@@ -318,8 +336,12 @@ static struct mp_image *allocate_image(struct lavc_ctx *ctx, int format,
 
     struct mp_image *img =
         mp_image_pool_get_no_alloc(p->pool, IMGFMT_VAAPI, w, h);
-    if (!img)
-        MP_ERR(p, "Insufficient number of surfaces.\n");
+    if (!img) {
+        int total, used;
+        mp_image_pool_get_usage(p->pool, &total, &used);
+        MP_ERR(p, "Insufficient number of surfaces (%d of %d in use).\n",
+               used, total);
+    }
     return img;
 }
 
@@ -46,6 +46,12 @@ enum vd_ctrl {
     VDCTRL_QUERY_UNSEEN_FRAMES, // current decoder lag
     VDCTRL_FORCE_HWDEC_FALLBACK, // force software decoding fallback
     VDCTRL_GET_HWDEC,
+    VDCTRL_GET_THREADING, // struct vd_threading*
+};
+
+struct vd_threading {
+    int threads;
+    const char *type; // "frame", "slice", or "none"
 };
 
 #endif /* MPLAYER_VD_H */
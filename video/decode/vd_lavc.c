@@ -34,6 +34,7 @@
 #include "options/options.h"
 #include "misc/bstr.h"
 #include "common/av_common.h"
+#include "osdep/numcores.h"
 #include "common/codecs.h"
 
 #include "video/fmt-conversion.h"
@@ -42,6 +43,7 @@
 #include "video/img_format.h"
 #include "video/filter/vf.h"
 #include "video/decode/dec_video.h"
+#include "video/out/vo.h"
 #include "demux/stheader.h"
 #include "demux/packet.h"
 #include "video/csputils.h"
@@ -59,6 +61,7 @@ static void init_avctx(struct dec_video *vd, const char *decoder,
 static void uninit_avctx(struct dec_video *vd);
 
 static int get_buffer2_hwdec(AVCodecContext *avctx, AVFrame *pic, int flags);
+static int get_buffer2_direct(AVCodecContext *avctx, AVFrame *pic, int flags);
 static enum AVPixelFormat get_format_hwdec(struct AVCodecContext *avctx,
                                            const enum AVPixelFormat *pix_fmt);
 
@@ -74,8 +77,11 @@ struct vd_lavc_params {
     int skip_frame;
     int framedrop;
     int threads;
+    int thread_type;
     int bitexact;
     int check_hw_profile;
+    int dr;
+    int lowres;
     char **avopts;
 };
 
@@ -100,9 +106,15 @@ const struct m_sub_options vd_lavc_conf = {
         OPT_DISCARD("skipidct", skip_idct, 0),
         OPT_DISCARD("skipframe", skip_frame, 0),
         OPT_DISCARD("framedrop", framedrop, 0),
-        OPT_INTRANGE("threads", threads, 0, 0, 16),
+        OPT_INTRANGE("threads", threads, 0, 0, 64),
+        OPT_CHOICE("thread-type", thread_type, 0,
+                   ({"auto", 0},
+                    {"frame", FF_THREAD_FRAME},
+                    {"slice", FF_THREAD_SLICE})),
         OPT_FLAG("bitexact", bitexact, 0),
         OPT_FLAG("check-hw-profile", check_hw_profile, 0),
+        OPT_FLAG("dr", dr, 0),
+        OPT_INTRANGE("lowres", lowres, 0, 0, 3),
         OPT_KEYVALUELIST("o", avopts, 0),
         {0}
     },
@@ -320,6 +332,65 @@ static int init(struct dec_video *vd, const char *decoder)
     return 1;
 }
 
+// Pick the number of threads and the threading type. With --vd-lavc-threads=0
+// the count is derived from the number of cores and the video size: small
+// videos don't decode faster with many threads, while every frame thread adds
+// a frame of delay. Small videos use slice threading if the codec supports it.
+static void choose_threads(struct dec_video *vd, AVCodec *codec, int w, int h,
+                           int *out_threads, int *out_type)
+{
+    struct vd_lavc_params *lavc_param = vd->opts->vd_lavc_params;
+    int64_t pixels = (int64_t)w * h;
+
+    int threads = lavc_param->threads;
+    if (threads == 0) {
+        int max_threads = 16; // unknown size
+        if (pixels > 0) {
+            if (pixels <= 720 * 576) {
+                max_threads = 4;
+            } else if (pixels <= 1920 * 1088) {
+                max_threads = 8;
+            } else if (pixels > 4096 * 2304) {
+                max_threads = 32;
+            }
+        }
+        threads = MPMIN(default_thread_count(), max_threads);
+        if (threads < 1) {
+            MP_WARN(vd, "Could not determine thread count to use, "
+                    "defaulting to 1.\n");
+            threads = 1;
+        }
+    }
+
+    int type = lavc_param->thread_type;
+    if (vd->opts->low_latency) {
+        // Frame threading delays output by one frame per thread.
+        type = FF_THREAD_SLICE;
+    } else if (!type) {
+        type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        if (pixels > 0 && pixels <= 720 * 576 &&
+            (codec->capabilities & CODEC_CAP_SLICE_THREADS))
+            type = FF_THREAD_SLICE;
+    }
+
+    *out_threads = threads;
+    *out_type = type;
+}
+
+static void setup_threads(struct dec_video *vd, AVCodec *codec, int w, int h)
+{
+    vd_ffmpeg_ctx *ctx = vd->priv;
+    AVCodecContext *avctx = ctx->avctx;
+    int threads, type;
+    choose_threads(vd, codec, w, h, &threads, &type);
+    avctx->thread_count = threads;
+    avctx->thread_type = type;
+    ctx->threads_w = w;
+    ctx->threads_h = h;
+    MP_VERBOSE(vd, "Requesting %d decoding threads for %dx%d.\n",
+               threads, w, h);
+}
+
 static void init_avctx(struct dec_video *vd, const char *decoder,
                        struct vd_lavc_hwdec *hwdec)
 {
@@ -341,6 +412,9 @@ static void init_avctx(struct dec_video *vd, const char *decoder,
 
     ctx->hwdec_info = vd->hwdec_info;
 
+    talloc_free(ctx->decoder);
+    ctx->decoder = talloc_strdup(ctx, decoder);
+
     ctx->pix_fmt = AV_PIX_FMT_NONE;
     ctx->hwdec = hwdec;
     ctx->hwdec_fmt = 0;
@@ -363,10 +437,20 @@ static void init_avctx(struct dec_video *vd, const char *decoder,
             return;
         }
     } else {
-        mp_set_avcodec_threads(avctx, lavc_param->threads);
+        // Use the size of the decoded video when reinitializing for a new
+        // size (see reinit_threads()), the container's size otherwise.
+        int w = ctx->frame_w ? ctx->frame_w : sh->video->disp_w;
+        int h = ctx->frame_h ? ctx->frame_h : sh->video->disp_h;
+        setup_threads(vd, lavc_codec, w, h);
+        ctx->dr_failed = false;
+        if (lavc_param->dr && vd->vo &&
+            (lavc_codec->capabilities & CODEC_CAP_DR1))
+            avctx->get_buffer2 = get_buffer2_direct;
+        avctx->lowres = MPMIN(lavc_param->lowres, lavc_codec->max_lowres);
     }
 
     avctx->flags |= lavc_param->bitexact ? CODEC_FLAG_BITEXACT : 0;
+    avctx->flags |= vd->opts->low_latency ? CODEC_FLAG_LOW_DELAY : 0;
     avctx->flags2 |= lavc_param->fast ? CODEC_FLAG2_FAST : 0;
 
     if (lavc_param->show_all) {
@@ -591,6 +675,44 @@ static int get_buffer2_hwdec(AVCodecContext *avctx, AVFrame *pic, int flags)
     return 0;
 }
 
+// Let the decoder render into VO-provided memory (see vo_get_image()), so that
+// the VO doesn't have to copy the image for uploading it.
+static int get_buffer2_direct(AVCodecContext *avctx, AVFrame *pic, int flags)
+{
+    struct dec_video *vd = avctx->opaque;
+    vd_ffmpeg_ctx *ctx = vd->priv;
+
+    int imgfmt = pixfmt2imgfmt(pic->format);
+    if (ctx->dr_failed || !imgfmt)
+        return avcodec_default_get_buffer2(avctx, pic, flags);
+
+    int w = pic->width;
+    int h = pic->height;
+    int linesize_align[AV_NUM_DATA_POINTERS] = {0};
+    avcodec_align_dimensions2(avctx, &w, &h, linesize_align);
+    int stride_align = 64; // enough for any SIMD code
+    for (int n = 0; n < AV_NUM_DATA_POINTERS; n++)
+        stride_align = MPMAX(stride_align, linesize_align[n]);
+
+    struct mp_image *mpi = vo_get_image(vd->vo, imgfmt, w, h, stride_align);
+    if (!mpi) {
+        MP_VERBOSE(vd, "Direct rendering not supported by VO.\n");
+        ctx->dr_failed = true;
+        return avcodec_default_get_buffer2(avctx, pic, flags);
+    }
+
+    for (int n = 0; n < 4; n++) {
+        pic->data[n] = mpi->planes[n];
+        pic->linesize[n] = mpi->stride[n];
+    }
+    pic->buf[0] = av_buffer_create(NULL, 0, free_mpi, mpi, 0);
+    if (!pic->buf[0]) {
+        talloc_free(mpi);
+        return -1;
+    }
+    return 0;
+}
+
 static int decode(struct dec_video *vd, struct demux_packet *packet,
                   int flags, struct mp_image **out_image)
 {
@@ -601,7 +723,10 @@ static int decode(struct dec_video *vd, struct demux_packet *packet,
     struct vd_lavc_params *lavc_param = ctx->opts->vd_lavc_params;
     AVPacket pkt;
 
-    if (flags) {
+    if (flags == 3) {
+        // scrubbing: decode keyframes only
+        avctx->skip_frame = AVDISCARD_NONKEY;
+    } else if (flags) {
         // hr-seek framedrop vs. normal framedrop
         avctx->skip_frame = flags == 2 ? AVDISCARD_NONREF : lavc_param->framedrop;
     } else {
@@ -675,6 +800,38 @@ static struct mp_image *decode_with_fallback(struct dec_video *vd,
     return mpi;
 }
 
+// The thread count can't be changed on an open decoder. If the video size
+// changed so much that the automatic choice would be different, reopen the
+// decoder. This is done on resets only, because decoding restarts from a
+// keyframe after them.
+static void reinit_threads(struct dec_video *vd)
+{
+    vd_ffmpeg_ctx *ctx = vd->priv;
+    struct vd_lavc_params *lavc_param = vd->opts->vd_lavc_params;
+    AVCodecContext *avctx = ctx->avctx;
+    if (ctx->hwdec || (lavc_param->threads && lavc_param->thread_type) ||
+        avctx->width <= 0 || avctx->height <= 0 ||
+        (avctx->width == ctx->threads_w && avctx->height == ctx->threads_h))
+        return;
+
+    int threads, type;
+    choose_threads(vd, (AVCodec *)avctx->codec, avctx->width, avctx->height,
+                   &threads, &type);
+    if (avctx->thread_count == threads && avctx->thread_type == type) {
+        ctx->threads_w = avctx->width;
+        ctx->threads_h = avctx->height;
+        return;
+    }
+
+    MP_VERBOSE(vd, "Video size changed, reopening decoder.\n");
+    char *decoder = talloc_strdup(NULL, ctx->decoder);
+    ctx->frame_w = avctx->width;
+    ctx->frame_h = avctx->height;
+    uninit_avctx(vd);
+    init_avctx(vd, decoder, NULL);
+    talloc_free(decoder);
+}
+
 static int control(struct dec_video *vd, int cmd, void *arg)
 {
     vd_ffmpeg_ctx *ctx = vd->priv;
@@ -682,6 +839,7 @@ static int control(struct dec_video *vd, int cmd, void *arg)
     switch (cmd) {
     case VDCTRL_RESET:
         avcodec_flush_buffers(avctx);
+        reinit_threads(vd);
         return CONTROL_TRUE;
     case VDCTRL_QUERY_UNSEEN_FRAMES:;
         int delay = avctx->has_b_frames;
@@ -699,6 +857,24 @@ static int control(struct dec_video *vd, int cmd, void *arg)
     }
     case VDCTRL_FORCE_HWDEC_FALLBACK:
         return force_fallback(vd);
+    case VDCTRL_GET_THREADING: {
+        struct vd_threading *t = arg;
+        if (!avctx)
+            return CONTROL_FALSE;
+        // Hardware decoding always uses a single thread.
+        if (ctx->hwdec)
+            return CONTROL_NA;
+        t->threads = avctx->thread_count;
+        t->type = "none";
+        if (avctx->thread_count > 1) {
+            if (avctx->active_thread_type & FF_THREAD_FRAME) {
+                t->type = "frame";
+            } else if (avctx->active_thread_type & FF_THREAD_SLICE) {
+                t->type = "slice";
+            }
+        }
+        return CONTROL_TRUE;
+    }
     }
     return CONTROL_UNKNOWN;
 }
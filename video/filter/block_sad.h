@@ -0,0 +1,52 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MP_BLOCK_SAD_H
+#define MP_BLOCK_SAD_H
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Sum of absolute differences of a block 8 pixels wide and h lines high.
+static inline int block_sad8(const uint8_t *a, int as,
+                             const uint8_t *b, int bs, int h)
+{
+#if defined(__SSE2__)
+    __m128i sum = _mm_setzero_si128();
+    for (int y = 0; y < h; y++) {
+        __m128i va = _mm_loadl_epi64((const __m128i *)(a + y * as));
+        __m128i vb = _mm_loadl_epi64((const __m128i *)(b + y * bs));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+    }
+    return _mm_cvtsi128_si32(sum);
+#else
+    int sum = 0;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < 8; x++) {
+            int d = a[y * as + x] - b[y * bs + x];
+            sum += d < 0 ? -d : d;
+        }
+    }
+    return sum;
+#endif
+}
+
+#endif
@@ -22,20 +22,45 @@
 #include "config.h"
 #include "pullup.h"
 #include "common/common.h"
+#include "block_sad.h"
 
 
 #define ABS(a) (((a)^((a)>>31))-((a)>>31))
 
 static int diff_y(unsigned char *a, unsigned char *b, int s)
 {
-        int i, j, diff=0;
-        for (i=4; i; i--) {
-                for (j=0; j<8; j++) diff += ABS(a[j]-b[j]);
-                a+=s; b+=s;
-        }
-        return diff;
+        return block_sad8(a, s, b, s, 4);
 }
 
+#if defined(__SSE2__)
+static inline __m128i comb_row(__m128i a, __m128i b0, __m128i b1)
+{
+        __m128i d = _mm_sub_epi16(_mm_add_epi16(a, a), _mm_add_epi16(b0, b1));
+        return _mm_max_epi16(d, _mm_sub_epi16(_mm_setzero_si128(), d));
+}
+
+static inline __m128i load_row(unsigned char *p)
+{
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)p),
+                                 _mm_setzero_si128());
+}
+
+static int licomb_y(unsigned char *a, unsigned char *b, int s)
+{
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < 4; i++) {
+                __m128i va = load_row(a), vb = load_row(b);
+                sum = _mm_add_epi16(sum, comb_row(va, load_row(b - s), vb));
+                sum = _mm_add_epi16(sum, comb_row(vb, va, load_row(a + s)));
+                a += s; b += s;
+        }
+        /* each 16 bit lane holds at most 8 * 510, so this can't overflow */
+        sum = _mm_madd_epi16(sum, _mm_set1_epi16(1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+}
+#else
 static int licomb_y(unsigned char *a, unsigned char *b, int s)
 {
         int i, j, diff=0;
@@ -47,6 +72,7 @@ static int licomb_y(unsigned char *a, unsigned char *b, int s)
         }
         return diff;
 }
+#endif
 
 #if 0
 static int qpcomb_y(unsigned char *a, unsigned char *b, int s)
@@ -71,14 +97,7 @@ static int licomb_y_test(unsigned char *a, unsigned char *b, int s)
 
 static int var_y(unsigned char *a, unsigned char *b, int s)
 {
-        int i, j, var=0;
-        for (i=3; i; i--) {
-                for (j=0; j<8; j++) {
-                        var += ABS(a[j]-a[j+s]);
-                }
-                a+=s; b+=s;
-        }
-        return 4*var; /* match comb scaling */
+        return 4*block_sad8(a, s, a + s, s, 3); /* match comb scaling */
 }
 
 
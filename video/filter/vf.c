@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <libavutil/common.h>
 #include <libavutil/mem.h>
@@ -40,6 +41,7 @@
 #include "vf.h"
 
 #include "video/memcpy_pic.h"
+#include "misc/thread_pool.h"
 
 extern const vf_info_t vf_info_crop;
 extern const vf_info_t vf_info_expand;
@@ -127,6 +129,10 @@ static const vf_info_t *const filter_list[] = {
 };
 
 static void vf_uninit_filter(vf_instance_t *vf);
+static void pipeline_pause(struct vf_chain *c);
+static void pipeline_resume(struct vf_chain *c);
+static void pipeline_start(struct vf_chain *c);
+static void pipeline_stop(struct vf_chain *c, bool discard);
 
 static bool get_desc(struct m_obj_desc *dst, int index)
 {
@@ -155,14 +161,17 @@ const struct m_obj_list vf_obj_list = {
 // filter which does not return CONTROL_UNKNOWN for it.
 int vf_control_any(struct vf_chain *c, int cmd, void *arg)
 {
+    int r = CONTROL_UNKNOWN;
+    pipeline_pause(c);
     for (struct vf_instance *cur = c->first; cur; cur = cur->next) {
         if (cur->control) {
-            int r = cur->control(cur, cmd, arg);
+            r = cur->control(cur, cmd, arg);
             if (r != CONTROL_UNKNOWN)
-                return r;
+                break;
         }
     }
-    return CONTROL_UNKNOWN;
+    pipeline_resume(c);
+    return r;
 }
 
 int vf_control_by_label(struct vf_chain *c,int cmd, void *arg, bstr label)
@@ -170,10 +179,13 @@ int vf_control_by_label(struct vf_chain *c,int cmd, void *arg, bstr label)
     char *label_str = bstrdup0(NULL, label);
     struct vf_instance *cur = vf_find_by_label(c, label_str);
     talloc_free(label_str);
-    if (cur)
-        return cur->control(cur, cmd, arg);
-    else
-        return CONTROL_UNKNOWN;
+    int r = CONTROL_UNKNOWN;
+    if (cur) {
+        pipeline_pause(c);
+        r = cur->control(cur, cmd, arg);
+        pipeline_resume(c);
+    }
+    return r;
 }
 
 static void vf_control_all(struct vf_chain *c, int cmd, void *arg)
@@ -209,6 +221,18 @@ struct mp_image *vf_alloc_out_image(struct vf_instance *vf)
 }
 
 // Returns false on failure; then the image can't be written to.
+// Return whether the chain contains only automatically inserted conversion
+// filters. Such a chain maps each input frame to one output frame with the
+// same timestamp, so any input frame can be skipped without side effects.
+bool vf_chain_is_trivial(struct vf_chain *c)
+{
+    for (struct vf_instance *cur = c->first; cur; cur = cur->next) {
+        if (cur != c->first && cur != c->last && !cur->autoinserted)
+            return false;
+    }
+    return true;
+}
+
 bool vf_make_out_image_writeable(struct vf_instance *vf, struct mp_image *img)
 {
     struct mp_image_params *p = &vf->fmt_out;
@@ -321,6 +345,7 @@ static vf_instance_t *vf_open_filter(struct vf_chain *c, const char *name,
 void vf_remove_filter(struct vf_chain *c, struct vf_instance *vf)
 {
     assert(vf != c->first && vf != c->last); // these are sentinels
+    pipeline_stop(c, false);
     struct vf_instance *prev = c->first;
     while (prev && prev->next != vf)
         prev = prev->next;
@@ -334,6 +359,7 @@ struct vf_instance *vf_append_filter(struct vf_chain *c, const char *name,
 {
     struct vf_instance *vf = vf_open_filter(c, name, args);
     if (vf) {
+        pipeline_stop(c, false);
         // Insert it before the last filter, which is the "out" pseudo-filter
         // (But after the "in" pseudo-filter)
         struct vf_instance **pprev = &c->first->next;
@@ -379,6 +405,57 @@ void vf_add_output_frame(struct vf_instance *vf, struct mp_image *img)
     }
 }
 
+// Don't bother splitting images into slices smaller than this many lines.
+#define MIN_SLICE_LINES 16
+
+struct slice_ctx {
+    void (*fn)(void *ctx, int y0, int y1);
+    void *ctx;
+    int h, slice_h;
+};
+
+static void run_slice(void *ptr, int job)
+{
+    struct slice_ctx *s = ptr;
+    int y0 = job * s->slice_h;
+    s->fn(s->ctx, y0, MPMIN(y0 + s->slice_h, s->h));
+}
+
+// Call fn(ctx, y0, y1) for horizontal slices covering the lines [0, h), and
+// run them in parallel on the shared thread pool. Each slice starts
+// at a multiple of align (e.g. to keep subsampled chroma lines together).
+// Returns when all slices are done.
+void vf_run_slices(struct vf_instance *vf, int h, int align,
+                   void (*fn)(void *ctx, int y0, int y1), void *ctx)
+{
+    static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+    struct vf_chain *c = vf->chain;
+    align = MPMAX(align, 1);
+    if (c) {
+        // With --vf-pipeline, this can be called from several filter threads.
+        pthread_mutex_lock(&pool_lock);
+        if (!c->thread_pool)
+            c->thread_pool = mp_thread_pool_get_shared(c);
+        pthread_mutex_unlock(&pool_lock);
+    }
+    int threads = c ? mp_thread_pool_get_threads(c->thread_pool) : 1;
+    int slices = MPMIN(threads, h / MIN_SLICE_LINES);
+    if (slices <= 1) {
+        fn(ctx, 0, h);
+        return;
+    }
+    int slice_h = (h + slices - 1) / slices;
+    slice_h = (slice_h + align - 1) / align * align;
+    struct slice_ctx s = {
+        .fn = fn,
+        .ctx = ctx,
+        .h = h,
+        .slice_h = slice_h,
+    };
+    mp_thread_pool_run(c->thread_pool, (h + slice_h - 1) / slice_h,
+                       run_slice, &s);
+}
+
 static bool vf_has_output_frame(struct vf_instance *vf)
 {
     if (!vf->num_out_queued && vf->filter_out) {
@@ -419,6 +496,235 @@ static int vf_do_filter(struct vf_instance *vf, struct mp_image *img)
     }
 }
 
+// Pipelined mode (--vf-pipeline): every filter runs on its own thread, and
+// frames are handed to the next filter through short queues. The rest of the
+// code in this file touches filters only while the pipeline is paused or
+// stopped.
+
+// Maximum number of frames queued in front of each filter (soft limit; a
+// filter can still output several frames at once).
+#define PIPELINE_QUEUE 2
+
+struct vf_worker {
+    struct vf_pipeline *p;
+    struct vf_instance *vf;
+    pthread_t thread;
+    // Protected by vf_pipeline.lock.
+    struct mp_image **queue;    // input frames not yet passed to vf
+    int num_queue;
+    bool busy;                  // thread is running vf without the lock
+};
+
+struct vf_pipeline {
+    struct vf_chain *chain;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    struct vf_worker *workers;
+    int num_workers;
+    int num_threads;            // threads actually started
+    bool terminate;
+    int paused;
+    // Output of the last filter.
+    struct mp_image **out;
+    int num_out;
+};
+
+// Frames queued for the filter after worker n.
+static int *pipeline_next_count(struct vf_pipeline *p, int n)
+{
+    return n + 1 < p->num_workers ? &p->workers[n + 1].num_queue : &p->num_out;
+}
+
+static void pipeline_add_output(struct vf_pipeline *p, int n,
+                                struct mp_image *img)
+{
+    if (n + 1 < p->num_workers) {
+        struct vf_worker *next = &p->workers[n + 1];
+        MP_TARRAY_APPEND(p, next->queue, next->num_queue, img);
+    } else {
+        MP_TARRAY_APPEND(p, p->out, p->num_out, img);
+        if (p->chain->wakeup_cb)
+            p->chain->wakeup_cb(p->chain->wakeup_cb_ctx);
+    }
+    pthread_cond_broadcast(&p->wakeup);
+}
+
+static void *pipeline_thread(void *arg)
+{
+    struct vf_worker *w = arg;
+    struct vf_pipeline *p = w->p;
+    int n = w - p->workers;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->terminate) {
+        if (p->paused || !w->num_queue ||
+            *pipeline_next_count(p, n) >= PIPELINE_QUEUE)
+        {
+            pthread_cond_wait(&p->wakeup, &p->lock);
+            continue;
+        }
+        struct mp_image *img = w->queue[0];
+        MP_TARRAY_REMOVE_AT(w->queue, w->num_queue, 0);
+        w->busy = true;
+        pthread_mutex_unlock(&p->lock);
+
+        vf_do_filter(w->vf, img);
+        while ((img = vf_dequeue_output_frame(w->vf))) {
+            pthread_mutex_lock(&p->lock);
+            pipeline_add_output(p, n, img);
+            pthread_mutex_unlock(&p->lock);
+        }
+
+        pthread_mutex_lock(&p->lock);
+        w->busy = false;
+        pthread_cond_broadcast(&p->wakeup);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static bool pipeline_busy(struct vf_pipeline *p)
+{
+    for (int n = 0; n < p->num_workers; n++) {
+        if (p->workers[n].busy)
+            return true;
+    }
+    return false;
+}
+
+// Start worker threads for all filters, if enabled and the chain is ready.
+static void pipeline_start(struct vf_chain *c)
+{
+    if (c->pipeline || !c->opts->vf_pipeline || c->initialized < 1)
+        return;
+
+    int num_workers = 0;
+    for (struct vf_instance *vf = c->first->next; vf && vf->next; vf = vf->next)
+        num_workers++;
+    if (!num_workers)
+        return;
+
+    struct vf_pipeline *p = talloc_zero(NULL, struct vf_pipeline);
+    p->chain = c;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wakeup, NULL);
+    p->workers = talloc_zero_array(p, struct vf_worker, num_workers);
+    p->num_workers = num_workers;
+    struct vf_instance *vf = c->first->next;
+    for (int n = 0; n < num_workers; n++) {
+        p->workers[n] = (struct vf_worker){ .p = p, .vf = vf };
+        vf = vf->next;
+    }
+    c->pipeline = p;
+
+    for (int n = 0; n < num_workers; n++) {
+        if (pthread_create(&p->workers[n].thread, NULL, pipeline_thread,
+                           &p->workers[n]))
+        {
+            MP_ERR(c, "Could not start filter threads.\n");
+            pipeline_stop(c, true);
+            return;
+        }
+        p->num_threads++;
+    }
+    MP_VERBOSE(c, "Running %d filters on separate threads.\n", num_workers);
+}
+
+// Terminate the worker threads. Unless discard is set, put all frames still
+// in flight back into the filters, so that the chain can continue
+// synchronously.
+static void pipeline_stop(struct vf_chain *c, bool discard)
+{
+    struct vf_pipeline *p = c->pipeline;
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->terminate = true;
+    pthread_cond_broadcast(&p->wakeup);
+    pthread_mutex_unlock(&p->lock);
+    for (int n = 0; n < p->num_threads; n++)
+        pthread_join(p->workers[n].thread, NULL);
+
+    // Frames queued at later filters are older, so they must come first.
+    struct vf_instance *out = p->workers[p->num_workers - 1].vf->next;
+    for (int n = 0; n < p->num_out; n++) {
+        if (discard) {
+            talloc_free(p->out[n]);
+        } else {
+            MP_TARRAY_APPEND(out, out->out_queued, out->num_out_queued,
+                             p->out[n]);
+        }
+    }
+    for (int n = p->num_workers - 1; n >= 0; n--) {
+        struct vf_worker *w = &p->workers[n];
+        for (int i = 0; i < w->num_queue; i++) {
+            if (discard) {
+                talloc_free(w->queue[i]);
+            } else {
+                vf_do_filter(w->vf, w->queue[i]);
+            }
+        }
+    }
+
+    pthread_cond_destroy(&p->wakeup);
+    pthread_mutex_destroy(&p->lock);
+    talloc_free(p);
+    c->pipeline = NULL;
+}
+
+// Wait until no filter is running, and keep them from starting.
+static void pipeline_pause(struct vf_chain *c)
+{
+    struct vf_pipeline *p = c->pipeline;
+    if (!p)
+        return;
+    pthread_mutex_lock(&p->lock);
+    p->paused++;
+    while (pipeline_busy(p))
+        pthread_cond_wait(&p->wakeup, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void pipeline_resume(struct vf_chain *c)
+{
+    struct vf_pipeline *p = c->pipeline;
+    if (!p)
+        return;
+    pthread_mutex_lock(&p->lock);
+    p->paused--;
+    pthread_cond_broadcast(&p->wakeup);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Queue a frame for the first filter. Blocks while its queue is full, unless
+// the chain has output ready (which the caller has to pick up first).
+static void pipeline_queue_frame(struct vf_chain *c, struct mp_image *img)
+{
+    struct vf_pipeline *p = c->pipeline;
+    struct vf_worker *w = &p->workers[0];
+    pthread_mutex_lock(&p->lock);
+    while (w->num_queue >= PIPELINE_QUEUE && !p->num_out)
+        pthread_cond_wait(&p->wakeup, &p->lock);
+    MP_TARRAY_APPEND(p, w->queue, w->num_queue, img);
+    pthread_cond_broadcast(&p->wakeup);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static struct mp_image *pipeline_dequeue_frame(struct vf_chain *c)
+{
+    struct vf_pipeline *p = c->pipeline;
+    struct mp_image *res = NULL;
+    pthread_mutex_lock(&p->lock);
+    if (p->num_out) {
+        res = p->out[0];
+        MP_TARRAY_REMOVE_AT(p->out, p->num_out, 0);
+        pthread_cond_broadcast(&p->wakeup);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return res;
+}
+
 // Input a frame into the filter chain. Ownership of img is transferred.
 // Return >= 0 on success, < 0 on failure (even if output frames were produced)
 int vf_filter_frame(struct vf_chain *c, struct mp_image *img)
@@ -430,6 +736,10 @@ int vf_filter_frame(struct vf_chain *c, struct mp_image *img)
     }
     assert(mp_image_params_equal(&img->params, &c->input_params));
     vf_fix_img_params(img, &c->override_params);
+    if (c->pipeline) {
+        pipeline_queue_frame(c, img);
+        return 0;
+    }
     return vf_do_filter(c->first, img);
 }
 
@@ -444,6 +754,16 @@ int vf_output_frame(struct vf_chain *c, bool eof)
         return 1;
     if (c->initialized < 1)
         return -1;
+    if (c->pipeline) {
+        c->output = pipeline_dequeue_frame(c);
+        if (c->output)
+            return 1;
+        if (!eof)
+            return 0;
+        // Flush the remaining frames synchronously on this thread. The
+        // pipeline stays off until the next seek reset or reconfig.
+        pipeline_stop(c, false);
+    }
     while (1) {
         struct vf_instance *last = NULL;
         for (struct vf_instance * cur = c->first; cur; cur = cur->next) {
@@ -495,8 +815,10 @@ static void vf_chain_forget_frames(struct vf_chain *c)
 
 void vf_seek_reset(struct vf_chain *c)
 {
+    pipeline_stop(c, true);
     vf_control_all(c, VFCTRL_SEEK_RESET, NULL);
     vf_chain_forget_frames(c);
+    pipeline_start(c);
 }
 
 int vf_next_config(struct vf_instance *vf,
@@ -614,6 +936,7 @@ int vf_reconfig(struct vf_chain *c, const struct mp_image_params *params,
                 const struct mp_image_params *override_params)
 {
     int r = 0;
+    pipeline_stop(c, true);
     vf_chain_forget_frames(c);
     for (struct vf_instance *vf = c->first; vf; ) {
         struct vf_instance *next = vf->next;
@@ -648,6 +971,7 @@ int vf_reconfig(struct vf_chain *c, const struct mp_image_params *params,
         c->input_params = c->override_params = c->output_params =
             (struct mp_image_params){0};
     }
+    pipeline_start(c);
     return r;
 }
 
@@ -714,6 +1038,7 @@ void vf_destroy(struct vf_chain *c)
 {
     if (!c)
         return;
+    pipeline_stop(c, true);
     while (c->first) {
         vf_instance_t *vf = c->first;
         c->first = vf->next;
@@ -123,6 +123,13 @@ struct vf_chain {
     struct mp_hwdec_info *hwdec;
 
     struct mp_image *output;
+
+    struct mp_thread_pool *thread_pool; // shared pool, set by vf_run_slices()
+    struct vf_pipeline *pipeline;       // --vf-pipeline worker threads
+
+    // Called (from any thread) when the pipelined chain has new output.
+    void (*wakeup_cb)(void *ctx);
+    void *wakeup_cb_ctx;
 };
 
 typedef struct vf_seteq {
@@ -159,6 +166,7 @@ struct vf_instance *vf_append_filter(struct vf_chain *c, const char *name,
 void vf_remove_filter(struct vf_chain *c, struct vf_instance *vf);
 int vf_append_filter_list(struct vf_chain *c, struct m_obj_settings *list);
 struct vf_instance *vf_find_by_label(struct vf_chain *c, const char *label);
+bool vf_chain_is_trivial(struct vf_chain *c);
 void vf_print_filter_chain(struct vf_chain *c, int msglevel,
                            struct vf_instance *vf);
 
@@ -166,6 +174,8 @@ void vf_print_filter_chain(struct vf_chain *c, int msglevel,
 struct mp_image *vf_alloc_out_image(struct vf_instance *vf);
 bool vf_make_out_image_writeable(struct vf_instance *vf, struct mp_image *img);
 void vf_add_output_frame(struct vf_instance *vf, struct mp_image *img);
+void vf_run_slices(struct vf_instance *vf, int h, int align,
+                   void (*fn)(void *ctx, int y0, int y1), void *ctx);
 
 // default wrappers:
 int vf_next_config(struct vf_instance *vf,
@@ -32,6 +32,7 @@
 #include "video/img_format.h"
 #include "video/mp_image.h"
 #include "vf.h"
+#include "block_sad.h"
 
 #include "video/memcpy_pic.h"
 
@@ -53,13 +54,7 @@ struct vf_priv_s
 
 static int diff(unsigned char *old, unsigned char *new, int os, int ns)
    {
-   int x, y, d=0;
-
-   for(y=8; y; y--, new+=ns, old+=os)
-      for(x=8; x; x--)
-         d+=abs(new[x]-old[x]);
-
-   return d;
+   return block_sad8(old+1, os, new+1, ns, 8);
    }
 
 static int diff_plane(unsigned char *old, unsigned char *new,
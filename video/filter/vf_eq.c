@@ -174,6 +174,33 @@ void apply_lut (eq2_param_t *par, unsigned char *dst, unsigned char *src,
   }
 }
 
+struct eq_slice_ctx {
+  vf_eq2_t *eq2;
+  struct mp_image *src, *dst;
+  int num_planes;
+};
+
+static void filter_slice(void *ptr, int y0, int y1)
+{
+  struct eq_slice_ctx *ctx = ptr;
+  vf_eq2_t *eq2 = ctx->eq2;
+
+  for (int i = 0; i < ctx->num_planes; i++) {
+    eq2_param_t *par = &eq2->param[i];
+    if (par->adjust == NULL)
+      continue;
+    int shift = i ? ctx->src->chroma_y_shift : 0;
+    int py0 = y0 >> shift;
+    int py1 = y1 == eq2->buf_h[0] ? eq2->buf_h[i] : y1 >> shift;
+    if (py1 <= py0)
+      continue;
+    par->adjust (par,
+      ctx->dst->planes[i] + py0 * ctx->dst->stride[i],
+      ctx->src->planes[i] + py0 * ctx->src->stride[i],
+      eq2->buf_w[i], py1 - py0, ctx->dst->stride[i], ctx->src->stride[i]);
+  }
+}
+
 static struct mp_image *filter(struct vf_instance *vf, struct mp_image *src)
 {
   vf_eq2_t      *eq2;
@@ -204,17 +231,27 @@ static struct mp_image *filter(struct vf_instance *vf, struct mp_image *src)
   }
 
   struct mp_image dst = *src;
+  int num_planes = (src->num_planes>1)?3:1;
 
-  for (int i = 0; i < ((src->num_planes>1)?3:1); i++) {
+  for (int i = 0; i < num_planes; i++) {
     if (eq2->param[i].adjust != NULL) {
       dst.planes[i] = eq2->buf[i];
       dst.stride[i] = eq2->buf_w[i];
 
-      eq2->param[i].adjust (&eq2->param[i], dst.planes[i], src->planes[i],
-        eq2->buf_w[i], eq2->buf_h[i], dst.stride[i], src->stride[i]);
+      /* build the LUT up front, so that the slices only read it */
+      if (!eq2->param[i].lut_clean)
+        create_lut (&eq2->param[i]);
     }
   }
 
+  struct eq_slice_ctx ctx = {
+    .eq2 = eq2,
+    .src = src,
+    .dst = &dst,
+    .num_planes = num_planes,
+  };
+  vf_run_slices(vf, eq2->buf_h[0], 1 << src->chroma_y_shift, filter_slice, &ctx);
+
   struct mp_image *new = vf_alloc_out_image(vf);
   if (new) {
     mp_image_copy(new, &dst);
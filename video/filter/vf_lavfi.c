@@ -65,6 +65,13 @@ struct vf_priv_s {
     AVFilterContext *out;
     bool eof;
 
+    // What the current graph was configured with, to reuse it if possible.
+    struct mp_image_params graph_params;
+    char *graph_str;
+    char *graph_fmts;
+    bool graph_used;        // frames were fed since the graph was created
+    bool need_recreate;     // graph contains stale frames (after seeking)
+
     AVRational timebase_in;
     AVRational timebase_out;
     AVRational par_in;
@@ -81,6 +88,7 @@ struct vf_priv_s {
     char *cfg_graph;
     int64_t cfg_sws_flags;
     char **cfg_avopts;
+    int cfg_seek_flush;
 };
 
 static const struct vf_priv_s vf_priv_dflt = {
@@ -93,6 +101,12 @@ static void destroy_graph(struct vf_instance *vf)
     avfilter_graph_free(&p->graph);
     p->in = p->out = NULL;
 
+    talloc_free(p->graph_str);
+    p->graph_str = NULL;
+    talloc_free(p->graph_fmts);
+    p->graph_fmts = NULL;
+    p->graph_used = p->need_recreate = false;
+
     if (p->metadata) {
         talloc_free(p->metadata);
         p->metadata = NULL;
@@ -123,6 +137,33 @@ static void dar_from_sar_par(int width, int height, AVRational par,
     }
 }
 
+// Build list of acceptable output pixel formats. libavfilter will insert
+// conversion filters if needed.
+static char *get_out_fmts(struct vf_instance *vf, void *ta_ctx)
+{
+    char *fmtstr = talloc_strdup(ta_ctx, "");
+    for (int n = IMGFMT_START; n < IMGFMT_END; n++) {
+        if (vf_next_query_format(vf, n)) {
+            const char *name = av_get_pix_fmt_name(imgfmt2pixfmt(n));
+            if (name) {
+                const char *s = fmtstr[0] ? "|" : "";
+                fmtstr = talloc_asprintf_append_buffer(fmtstr, "%s%s", s, name);
+            }
+        }
+    }
+    return fmtstr;
+}
+
+// Discard output the graph has queued already.
+static void drain_graph(struct vf_instance *vf)
+{
+    struct vf_priv_s *p = vf->priv;
+    AVFrame *frame = av_frame_alloc();
+    while (frame && av_buffersink_get_frame(p->out, frame) >= 0)
+        av_frame_unref(frame);
+    av_frame_free(&frame);
+}
+
 static bool recreate_graph(struct vf_instance *vf, int width, int height,
                            int d_width, int d_height, unsigned int fmt)
 {
@@ -135,6 +176,27 @@ static bool recreate_graph(struct vf_instance *vf, int width, int height,
         return false;
     }
 
+    char *fmtstr = get_out_fmts(vf, tmp);
+    struct mp_image_params params = {
+        .imgfmt = fmt,
+        .w = width, .h = height,
+        .d_w = d_width, .d_h = d_height,
+    };
+
+    // Graph initialization can be very slow, so keep the current graph if
+    // it was configured for the same thing and holds no old frames.
+    if (p->graph && !p->eof && !p->need_recreate &&
+        (!p->graph_used || p->cfg_seek_flush) &&
+        mp_image_params_equal(&p->graph_params, &params) &&
+        strcmp(p->graph_str, p->cfg_graph) == 0 &&
+        strcmp(p->graph_fmts, fmtstr) == 0)
+    {
+        MP_VERBOSE(vf, "lavfi: reusing graph\n");
+        drain_graph(vf);
+        talloc_free(tmp);
+        return true;
+    }
+
     destroy_graph(vf);
     MP_VERBOSE(vf, "lavfi: create graph: '%s'\n", p->cfg_graph);
 
@@ -150,19 +212,6 @@ static bool recreate_graph(struct vf_instance *vf, int width, int height,
     if (!outputs || !inputs)
         goto error;
 
-    // Build list of acceptable output pixel formats. libavfilter will insert
-    // conversion filters if needed.
-    char *fmtstr = talloc_strdup(tmp, "");
-    for (int n = IMGFMT_START; n < IMGFMT_END; n++) {
-        if (vf_next_query_format(vf, n)) {
-            const char *name = av_get_pix_fmt_name(imgfmt2pixfmt(n));
-            if (name) {
-                const char *s = fmtstr[0] ? "|" : "";
-                fmtstr = talloc_asprintf_append_buffer(fmtstr, "%s%s", s, name);
-            }
-        }
-    }
-
     char *sws_flags = talloc_asprintf(tmp, "flags=%"PRId64, p->cfg_sws_flags);
     graph->scale_sws_opts = av_strdup(sws_flags);
 
@@ -204,6 +253,9 @@ static bool recreate_graph(struct vf_instance *vf, int width, int height,
     p->in = in;
     p->out = out;
     p->graph = graph;
+    p->graph_params = params;
+    p->graph_str = talloc_strdup(p, p->cfg_graph);
+    p->graph_fmts = talloc_steal(p, fmtstr);
 
     assert(out->nb_inputs == 1);
     assert(in->nb_outputs == 1);
@@ -226,6 +278,21 @@ static void reset(vf_instance_t *vf)
         recreate_graph(vf, f->w, f->h, f->d_w, f->d_h, f->imgfmt);
 }
 
+// On seeking, filters might still hold frames from before the seek. Unless
+// the user says the graph has no such state, recreate the graph, but only once
+// new input arrives (consecutive seeks don't need to rebuild it every time).
+static void seek_reset(vf_instance_t *vf)
+{
+    struct vf_priv_s *p = vf->priv;
+    if (!p->graph)
+        return;
+    if (p->cfg_seek_flush && !p->eof) {
+        drain_graph(vf);
+    } else if (p->graph_used || p->eof) {
+        p->need_recreate = true;
+    }
+}
+
 static int reconfig(struct vf_instance *vf, struct mp_image_params *in,
                     struct mp_image_params *out)
 {
@@ -312,16 +379,22 @@ static int filter_ext(struct vf_instance *vf, struct mp_image *mpi)
 {
     struct vf_priv_s *p = vf->priv;
 
-    if (p->eof && mpi) {
+    if ((p->eof || p->need_recreate) && mpi) {
         // Once EOF is reached, libavfilter is "stuck" in the EOF state, and
         // won't accept new input. Forcefully override it. This helps e.g.
         // with cover art, where we always want to generate new output.
         reset(vf);
     }
 
-    if (!p->graph)
+    if (p->need_recreate && !mpi)
+        return 0; // nothing to flush
+
+    if (!p->graph || p->need_recreate)
         return -1;
 
+    if (mpi)
+        p->graph_used = true;
+
     AVFrame *frame = mp_to_av(vf, mpi);
     int r = av_buffersrc_add_frame(p->in, frame) < 0 ? -1 : 0;
     av_frame_free(&frame);
@@ -333,6 +406,9 @@ static int filter_out(struct vf_instance *vf)
 {
     struct vf_priv_s *p = vf->priv;
 
+    if (!p->graph || p->need_recreate)
+        return 0;
+
     AVFrame *frame = av_frame_alloc();
     int err = av_buffersink_get_frame(p->out, frame);
     if (err == AVERROR(EAGAIN) || err == AVERROR_EOF) {
@@ -358,7 +434,7 @@ static int control(vf_instance_t *vf, int request, void *data)
 {
     switch (request) {
     case VFCTRL_SEEK_RESET:
-        reset(vf);
+        seek_reset(vf);
         return CONTROL_OK;
     case VFCTRL_GET_METADATA:
       if (vf->priv && vf->priv->metadata) {
@@ -434,6 +510,7 @@ static const m_option_t vf_opts_fields[] = {
     OPT_STRING("graph", cfg_graph, M_OPT_MIN, .min = 1),
     OPT_INT64("sws-flags", cfg_sws_flags, 0),
     OPT_KEYVALUELIST("o", cfg_avopts, 0),
+    OPT_FLAG("seek-flush", cfg_seek_flush, 0),
     {0}
 };
 
@@ -57,6 +57,7 @@ typedef struct FilterParam{
         int8_t *noise;
         int8_t *prev_shift[MAX_RES][3];
         int nonTempRandShift[MAX_RES];
+        int lineShift[MAX_RES];
 }FilterParam;
 
 struct vf_priv_s {
@@ -170,7 +171,35 @@ static inline void lineNoiseAvg(uint8_t *dst, uint8_t *src, int len, int8_t **sh
 
 /***************************************************************************/
 
-static void donoise(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp){
+struct noise_slice_ctx {
+        uint8_t *dst, *src;
+        int dstStride, srcStride;
+        int width;
+        FilterParam *fp;
+};
+
+static void donoise_slice(void *ptr, int y0, int y1){
+        struct noise_slice_ctx *ctx= ptr;
+        FilterParam *fp= ctx->fp;
+        uint8_t *dst= ctx->dst + y0*ctx->dstStride;
+        uint8_t *src= ctx->src + y0*ctx->srcStride;
+        int y;
+
+        for(y=y0; y<y1; y++)
+        {
+                int shift= fp->lineShift[y];
+                if (fp->averaged) {
+                    lineNoiseAvg(dst, src, ctx->width, fp->prev_shift[y]);
+                    fp->prev_shift[y][fp->shiftptr] = fp->noise + shift;
+                } else {
+                    lineNoise(dst, src, fp->noise, ctx->width, shift);
+                }
+                dst+= ctx->dstStride;
+                src+= ctx->srcStride;
+        }
+}
+
+static void donoise(struct vf_instance *vf, uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp){
         int8_t *noise= fp->noise;
         int y;
         int shift=0;
@@ -192,21 +221,25 @@ static void donoise(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, in
                 return;
         }
 
+        // Pick the per-line shifts serially (rand() is not reentrant), then
+        // process the lines on multiple threads.
         for(y=0; y<height; y++)
         {
                 if(fp->temporal)        shift=  rand()&(MAX_SHIFT  -1);
                 else                    shift= fp->nonTempRandShift[y];
 
                 if(fp->quality==0) shift&= ~7;
-                if (fp->averaged) {
-                    lineNoiseAvg(dst, src, width, fp->prev_shift[y]);
-                    fp->prev_shift[y][fp->shiftptr] = noise + shift;
-                } else {
-                    lineNoise(dst, src, noise, width, shift);
-                }
-                dst+= dstStride;
-                src+= srcStride;
+                fp->lineShift[y]= shift;
         }
+
+        struct noise_slice_ctx ctx = {
+                .dst = dst, .src = src,
+                .dstStride = dstStride, .srcStride = srcStride,
+                .width = width,
+                .fp = fp,
+        };
+        vf_run_slices(vf, height, 1, donoise_slice, &ctx);
+
         fp->shiftptr++;
         if (fp->shiftptr == 3) fp->shiftptr = 0;
 }
@@ -221,9 +254,9 @@ static struct mp_image *filter(struct vf_instance *vf, struct mp_image *mpi)
             mp_image_copy_attributes(dmpi, mpi);
         }
 
-        donoise(dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w, mpi->h, &vf->priv->lumaParam);
-        donoise(dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
-        donoise(dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
+        donoise(vf, dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w, mpi->h, &vf->priv->lumaParam);
+        donoise(vf, dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
+        donoise(vf, dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
 
         if (dmpi != mpi)
             talloc_free(mpi);
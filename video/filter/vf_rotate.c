@@ -37,7 +37,7 @@ static const char *const rot[] = {
     "transpose=clock",
     "vflip,hflip",
     "transpose=cclock",
-    "null", // actually set in lavfi_recreate()
+    "null", // actually set in lavfi_reconfig()
 };
 
 static int lavfi_reconfig(struct vf_instance *vf,
@@ -53,6 +53,14 @@ static int lavfi_reconfig(struct vf_instance *vf,
         }
         vf_lw_update_graph(vf, NULL, "%s", rot[(r / 90) % 360]);
         out->rotate = 0;
+    } else if (p->angle && vf->next == vf->chain->last && in->rotate % 90 == 0) {
+        // Last filter: only tag the image, and let the VO rotate it on output.
+        // If the VO can't, the player appends an "autorotate" filter, after
+        // which this filter is reconfigured to rotate the pixels itself.
+        vf_lw_update_graph(vf, NULL, "null");
+        out->rotate = (in->rotate + p->angle * 90) % 360;
+    } else {
+        vf_lw_update_graph(vf, NULL, "%s", rot[p->angle]);
     }
     return 0;
 }
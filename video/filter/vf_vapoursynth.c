@@ -30,6 +30,7 @@
 
 #include "common/msg.h"
 #include "options/m_option.h"
+#include "osdep/numcores.h"
 
 #include "video/img_format.h"
 #include "video/mp_image.h"
@@ -53,6 +54,9 @@ struct vf_priv_s {
     struct mp_image **buffered; // oldest image first
     int num_buffered;
     int in_frameno;             // frame number of buffered[0] (the oldest)
+    struct mp_image **pending;  // decoded frames not in buffered[] yet
+    int num_pending;            // (only non-0 while buffered[] is full)
+    int max_pending;
     int out_frameno;            // frame number of first requested/ready frame
     double out_pts;             // pts corresponding to first requested/ready frame
     struct mp_image **requested;// frame callback results (can point to dummy_img)
@@ -66,6 +70,7 @@ struct vf_priv_s {
     char *cfg_file;
     int cfg_maxbuffer;
     int cfg_maxrequests;
+    int cfg_prefetch;
 };
 
 // priv->requested[n] points to this if a request for frame n is in-progress
@@ -172,6 +177,17 @@ static struct mp_image map_vs_frame(struct vf_priv_s *p, const VSFrameRef *ref,
     return img;
 }
 
+// Move prefetched frames into the window of frames VS can access.
+static void move_pending_frames(struct vf_priv_s *p)
+{
+    while (p->num_pending && p->num_buffered < MP_TALLOC_ELEMS(p->buffered)) {
+        p->buffered[p->num_buffered++] = talloc_steal(p->buffered, p->pending[0]);
+        for (int n = 0; n < p->num_pending - 1; n++)
+            p->pending[n] = p->pending[n + 1];
+        p->num_pending--;
+    }
+}
+
 static void drain_oldest_buffered_frame(struct vf_priv_s *p)
 {
     if (!p->num_buffered)
@@ -181,6 +197,7 @@ static void drain_oldest_buffered_frame(struct vf_priv_s *p)
         p->buffered[n] = p->buffered[n + 1];
     p->num_buffered--;
     p->in_frameno++;
+    move_pending_frames(p);
 }
 
 static void VS_CC vs_frame_done(void *userData, const VSFrameRef *f, int n,
@@ -223,10 +240,26 @@ static void VS_CC vs_frame_done(void *userData, const VSFrameRef *f, int n,
     pthread_mutex_unlock(&p->lock);
 }
 
+// Note that frames are accepted even if the VS input window is full, as long
+// as they fit into the prefetch queue. infiltGetFrame() can then advance the
+// window without having to wait for the player thread to decode more video.
 static bool locked_need_input(struct vf_instance *vf)
 {
     struct vf_priv_s *p = vf->priv;
-    return p->num_buffered < MP_TALLOC_ELEMS(p->buffered);
+    return p->num_buffered < MP_TALLOC_ELEMS(p->buffered) ||
+           p->num_pending < p->max_pending;
+}
+
+static void locked_add_input(struct vf_instance *vf, struct mp_image *mpi)
+{
+    struct vf_priv_s *p = vf->priv;
+    if (p->num_buffered < MP_TALLOC_ELEMS(p->buffered)) {
+        assert(!p->num_pending);
+        p->buffered[p->num_buffered++] = talloc_steal(p->buffered, mpi);
+    } else {
+        assert(p->num_pending < p->max_pending);
+        p->pending[p->num_pending++] = talloc_steal(p->pending, mpi);
+    }
 }
 
 // Return true if progress was made.
@@ -304,7 +337,7 @@ static int filter_ext(struct vf_instance *vf, struct mp_image *mpi)
 
         // Make the input frame available to infiltGetFrame().
         if (mpi && locked_need_input(vf)) {
-            p->buffered[p->num_buffered++] = talloc_steal(p->buffered, mpi);
+            locked_add_input(vf, mpi);
             mpi = NULL;
             pthread_cond_broadcast(&p->wakeup);
         }
@@ -488,6 +521,9 @@ static void destroy_vs(struct vf_instance *vf)
     for (int n = 0; n < p->num_buffered; n++)
         talloc_free(p->buffered[n]);
     p->num_buffered = 0;
+    for (int n = 0; n < p->num_pending; n++)
+        talloc_free(p->pending[n]);
+    p->num_pending = 0;
     talloc_free(p->next_image);
     p->next_image = NULL;
     p->out_pts = MP_NOPTS_VALUE;
@@ -648,9 +684,15 @@ static int vf_open(vf_instance_t *vf)
     vf->query_format = query_format;
     vf->control = control;
     vf->uninit = uninit;
-    int maxbuffer = p->cfg_maxbuffer * p->cfg_maxrequests;
-    p->buffered = talloc_array(vf, struct mp_image *, maxbuffer);
     p->max_requests = p->cfg_maxrequests;
+    if (p->max_requests < 0)
+        p->max_requests = MPCLAMP(default_thread_count(), 1, 99);
+    p->max_pending = p->cfg_prefetch < 0 ? p->max_requests : p->cfg_prefetch;
+    MP_VERBOSE(vf, "%d concurrent frames, prefetching %d frames.\n",
+               p->max_requests, p->max_pending);
+    int maxbuffer = p->cfg_maxbuffer * p->max_requests;
+    p->buffered = talloc_array(vf, struct mp_image *, maxbuffer);
+    p->pending = talloc_array(vf, struct mp_image *, MPMAX(p->max_pending, 1));
     p->requested = talloc_zero_array(vf, struct mp_image *, p->max_requests);
     return 1;
 }
@@ -659,7 +701,10 @@ static int vf_open(vf_instance_t *vf)
 static const m_option_t vf_opts_fields[] = {
     OPT_STRING("file", cfg_file, 0),
     OPT_INTRANGE("buffered-frames", cfg_maxbuffer, 0, 1, 9999, OPTDEF_INT(4)),
-    OPT_INTRANGE("concurrent-frames", cfg_maxrequests, 0, 1, 99, OPTDEF_INT(2)),
+    OPT_CHOICE_OR_INT("concurrent-frames", cfg_maxrequests, 0, 1, 99,
+                      ({"auto", -1}), OPTDEF_INT(-1)),
+    OPT_CHOICE_OR_INT("prefetch-frames", cfg_prefetch, 0, 0, 999,
+                      ({"auto", -1}), OPTDEF_INT(-1)),
     {0}
 };
 
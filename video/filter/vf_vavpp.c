@@ -52,6 +52,7 @@ struct vf_priv_s {
     double prev_pts;
     int deint_type; // 0: none, 1: discard, 2: double fps
     bool do_deint;
+    float denoise;
     VABufferID buffers[VAProcFilterCount];
     int num_buffers;
     VAConfigID config;
@@ -370,14 +371,32 @@ static bool initialize(struct vf_instance *vf)
                 buffers[VAProcFilterDeinterlacing] =
                     va_create_filter_buffer(vf, sizeof(param), 1, &param);
             }
+        } else if (filters[i] == VAProcFilterNoiseReduction) {
+            if (p->denoise <= 0)
+                continue;
+            VAProcFilterCap caps;
+            if (!va_query_filter_caps(vf, VAProcFilterNoiseReduction, &caps, 1))
+                continue;
+            // Map 0-1 to the driver's range.
+            VAProcFilterParameterBuffer param;
+            param.type = VAProcFilterNoiseReduction;
+            param.value = caps.range.min_value +
+                p->denoise * (caps.range.max_value - caps.range.min_value);
+            buffers[VAProcFilterNoiseReduction] =
+                va_create_filter_buffer(vf, sizeof(param), 1, &param);
         } // check other filters
     }
     p->num_buffers = 0;
+    // Deinterlacing must be the first filter; see update_pipeline().
     if (buffers[VAProcFilterDeinterlacing] != VA_INVALID_ID)
         p->buffers[p->num_buffers++] = buffers[VAProcFilterDeinterlacing];
     else
         p->deint_type = 0;
     p->do_deint = !!p->deint_type;
+    if (buffers[VAProcFilterNoiseReduction] != VA_INVALID_ID)
+        p->buffers[p->num_buffers++] = buffers[VAProcFilterNoiseReduction];
+    else if (p->denoise > 0)
+        MP_WARN(vf, "Noise reduction is not supported by the driver.\n");
     // next filters: p->buffers[p->num_buffers++] = buffers[next_filter];
     return true;
 }
@@ -408,6 +427,7 @@ static const m_option_t vf_opts_fields[] = {
                ({"no", 0},
                 {"first-field", 1},
                 {"bob", 2})),
+    OPT_FLOATRANGE("denoise", denoise, 0, 0, 1),
     {0}
 };
 
@@ -0,0 +1,81 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "gpu_memcpy.h"
+
+#if HAVE_SSE4_INTRINSICS
+
+#include <smmintrin.h>
+
+// MOVNTDQA reads a whole cache line from USWC memory into a fill buffer, so
+// read 64 bytes per iteration with aligned streaming loads.
+__attribute__((target("sse4.1")))
+static void copy_sse4(void *restrict d, const void *restrict s, size_t size)
+{
+    uint8_t *dst = d;
+    const uint8_t *src = s;
+
+    size_t head = (16 - ((uintptr_t)src & 15)) & 15;
+    if (head > size)
+        head = size;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    _mm_mfence();
+    while (size >= 64) {
+        __m128i x0 = _mm_stream_load_si128((__m128i *)(src + 0));
+        __m128i x1 = _mm_stream_load_si128((__m128i *)(src + 16));
+        __m128i x2 = _mm_stream_load_si128((__m128i *)(src + 32));
+        __m128i x3 = _mm_stream_load_si128((__m128i *)(src + 48));
+        _mm_storeu_si128((__m128i *)(dst + 0), x0);
+        _mm_storeu_si128((__m128i *)(dst + 16), x1);
+        _mm_storeu_si128((__m128i *)(dst + 32), x2);
+        _mm_storeu_si128((__m128i *)(dst + 48), x3);
+        src += 64;
+        dst += 64;
+        size -= 64;
+    }
+
+    memcpy(dst, src, size);
+}
+
+void *gpu_memcpy(void *restrict d, const void *restrict s, size_t size)
+{
+    if (__builtin_cpu_supports("sse4.1")) {
+        copy_sse4(d, s, size);
+    } else {
+        memcpy(d, s, size);
+    }
+    return d;
+}
+
+#else
+
+void *gpu_memcpy(void *restrict d, const void *restrict s, size_t size)
+{
+    return memcpy(d, s, size);
+}
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MP_GPU_MEMCPY_H
+#define MP_GPU_MEMCPY_H
+
+#include <stddef.h>
+
+// Like memcpy(), but optimized for reading from uncached write-combining
+// (USWC) memory, such as mapped hardware decoder surfaces. Reading such memory
+// with normal loads is very slow. Falls back to memcpy() if the CPU or the
+// compiler don't support SSE4.1.
+void *gpu_memcpy(void *restrict d, const void *restrict s, size_t size);
+
+#endif
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
+#include <pthread.h>
 
 #include <libavcodec/avcodec.h>
 #include <libavutil/mem.h>
@@ -33,6 +34,9 @@
 
 #include "image_writer.h"
 #include "talloc.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "osdep/numcores.h"
 #include "video/img_format.h"
 #include "video/mp_image.h"
 #include "video/fmt-conversion.h"
@@ -321,3 +325,204 @@ void dump_png(struct mp_image *image, const char *filename, struct mp_log *log)
     opts.format = "png";
     write_image(image, &opts, filename, log);
 }
+
+#define MAX_QUEUE_THREADS 16
+
+struct image_writer_job {
+    struct mp_image *image;
+    struct image_writer_opts opts;
+    char *filename;
+    size_t size;
+    bool running;
+};
+
+struct image_writer_queue {
+    struct mp_log *log;
+    size_t max_bytes;
+    bool drop;
+    pthread_t threads[MAX_QUEUE_THREADS];
+    int num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;      // new job or termination
+    pthread_cond_t done;        // a job was finished
+    bool terminate;
+    // Queued and running jobs, oldest first
+    struct image_writer_job **jobs;
+    int num_jobs;
+    struct image_writer_queue_stats stats;
+};
+
+static size_t image_size(struct mp_image *image)
+{
+    size_t size = 0;
+    for (int n = 0; n < image->num_planes; n++)
+        size += (size_t)abs(image->stride[n]) * image->plane_h[n];
+    return size;
+}
+
+static struct image_writer_job *get_next_job(struct image_writer_queue *q)
+{
+    for (int n = 0; n < q->num_jobs; n++) {
+        if (!q->jobs[n]->running)
+            return q->jobs[n];
+    }
+    return NULL;
+}
+
+static void *queue_thread(void *ptr)
+{
+    struct image_writer_queue *q = ptr;
+
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+        struct image_writer_job *job;
+        while (!(job = get_next_job(q)) && !q->terminate)
+            pthread_cond_wait(&q->wakeup, &q->lock);
+        if (!job)
+            break;
+        job->running = true;
+        pthread_mutex_unlock(&q->lock);
+
+        bool ok = write_image(job->image, &job->opts, job->filename, q->log);
+
+        pthread_mutex_lock(&q->lock);
+        for (int n = 0; n < q->num_jobs; n++) {
+            if (q->jobs[n] == job) {
+                MP_TARRAY_REMOVE_AT(q->jobs, q->num_jobs, n);
+                break;
+            }
+        }
+        q->stats.pending -= 1;
+        q->stats.pending_bytes -= job->size;
+        if (ok) {
+            q->stats.written += 1;
+        } else {
+            q->stats.failed += 1;
+        }
+        talloc_free(job);
+        pthread_cond_broadcast(&q->done);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+static void destroy_queue(void *ptr)
+{
+    struct image_writer_queue *q = ptr;
+
+    // Finish all queued images first.
+    pthread_mutex_lock(&q->lock);
+    q->terminate = true;
+    pthread_cond_broadcast(&q->wakeup);
+    pthread_mutex_unlock(&q->lock);
+    for (int n = 0; n < q->num_threads; n++)
+        pthread_join(q->threads[n], NULL);
+
+    pthread_cond_destroy(&q->wakeup);
+    pthread_cond_destroy(&q->done);
+    pthread_mutex_destroy(&q->lock);
+}
+
+// threads: number of encoder threads (<= 0: number of CPUs)
+// max_bytes: limit for the memory used by queued images (0: no limit); if the
+//            limit is reached, image_writer_queue_add() waits until enough
+//            images are written, or drops the new image if drop is set
+// Return NULL if no thread could be created.
+struct image_writer_queue *image_writer_queue_create(void *ta_parent,
+                                                     struct mp_log *log,
+                                                     int threads,
+                                                     size_t max_bytes,
+                                                     bool drop)
+{
+    if (threads <= 0)
+        threads = default_thread_count();
+    threads = MPCLAMP(threads, 1, MAX_QUEUE_THREADS);
+
+    struct image_writer_queue *q = talloc_zero(ta_parent,
+                                               struct image_writer_queue);
+    q->log = log;
+    q->max_bytes = max_bytes;
+    q->drop = drop;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wakeup, NULL);
+    pthread_cond_init(&q->done, NULL);
+    talloc_set_destructor(q, destroy_queue);
+    for (int n = 0; n < threads; n++) {
+        if (pthread_create(&q->threads[n], NULL, queue_thread, q))
+            break;
+        q->num_threads++;
+    }
+    if (!q->num_threads) {
+        talloc_free(q);
+        return NULL;
+    }
+    mp_verbose(log, "Using %d threads for writing images.\n", q->num_threads);
+    return q;
+}
+
+bool image_writer_queue_add(struct image_writer_queue *q,
+                            struct mp_image *image,
+                            const struct image_writer_opts *opts,
+                            const char *filename)
+{
+    struct image_writer_job *job = talloc_ptrtype(NULL, job);
+    *job = (struct image_writer_job) {
+        .image = talloc_steal(job, image),
+        .opts = opts ? *opts : image_writer_opts_defaults,
+        .filename = talloc_strdup(job, filename),
+        .size = image_size(image),
+    };
+    job->opts.format = talloc_strdup(job, job->opts.format);
+
+    pthread_mutex_lock(&q->lock);
+    // A single image larger than the limit is accepted if nothing is queued.
+    while (q->max_bytes && q->stats.pending &&
+           q->stats.pending_bytes + job->size > q->max_bytes)
+    {
+        if (q->drop) {
+            q->stats.dropped += 1;
+            pthread_mutex_unlock(&q->lock);
+            mp_warn(q->log, "Image queue full, dropping '%s'.\n", filename);
+            talloc_free(job);
+            return false;
+        }
+        q->stats.waited += 1;
+        pthread_cond_wait(&q->done, &q->lock);
+    }
+    MP_TARRAY_APPEND(q, q->jobs, q->num_jobs, job);
+    q->stats.queued += 1;
+    q->stats.pending += 1;
+    q->stats.pending_bytes += job->size;
+    pthread_cond_signal(&q->wakeup);
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+bool image_writer_queue_has_file(struct image_writer_queue *q,
+                                 const char *filename)
+{
+    bool found = false;
+    pthread_mutex_lock(&q->lock);
+    for (int n = 0; n < q->num_jobs; n++) {
+        if (strcmp(q->jobs[n]->filename, filename) == 0)
+            found = true;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+void image_writer_queue_flush(struct image_writer_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->num_jobs)
+        pthread_cond_wait(&q->done, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+}
+
+void image_writer_queue_get_stats(struct image_writer_queue *q,
+                                  struct image_writer_queue_stats *stats)
+{
+    pthread_mutex_lock(&q->lock);
+    *stats = q->stats;
+    pthread_mutex_unlock(&q->lock);
+}
@@ -15,6 +15,10 @@
  * with mplayer.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 struct mp_image;
 struct mp_log;
 
@@ -52,3 +56,42 @@ int write_image(struct mp_image *image, const struct image_writer_opts *opts,
 
 // Debugging helper.
 void dump_png(struct mp_image *image, const char *filename, struct mp_log *log);
+
+// Queue for writing images on background threads, so that the caller does
+// not have to wait until the image is encoded.
+struct image_writer_queue;
+
+struct image_writer_queue_stats {
+    uint64_t queued;        // images accepted by image_writer_queue_add()
+    uint64_t written;       // images written successfully
+    uint64_t failed;        // images that could not be written
+    uint64_t dropped;       // images dropped because the queue was full
+    uint64_t waited;        // times image_writer_queue_add() had to wait
+    int pending;            // images queued or being written
+    size_t pending_bytes;   // memory used by pending images
+};
+
+struct image_writer_queue *image_writer_queue_create(void *ta_parent,
+                                                     struct mp_log *log,
+                                                     int threads,
+                                                     size_t max_bytes,
+                                                     bool drop);
+
+// Write the image like write_image(). This takes over ownership of image
+// (use mp_image_new_ref() to keep a reference). opts and filename are copied.
+// Returns false if the image was dropped (the queue was full).
+bool image_writer_queue_add(struct image_writer_queue *q,
+                            struct mp_image *image,
+                            const struct image_writer_opts *opts,
+                            const char *filename);
+
+// Whether filename is queued or being written (and thus might not exist in
+// the filesystem yet).
+bool image_writer_queue_has_file(struct image_writer_queue *q,
+                                 const char *filename);
+
+// Wait until all queued images are written.
+void image_writer_queue_flush(struct image_writer_queue *q);
+
+void image_writer_queue_get_stats(struct image_writer_queue *q,
+                                  struct image_writer_queue_stats *stats);
@@ -26,9 +26,12 @@
 #define my_memcpy_pic memcpy_pic
 #define memcpy_pic2(d, s, b, h, ds, ss, unused) memcpy_pic(d, s, b, h, ds, ss)
 
-static inline void memcpy_pic(void *dst, const void *src,
-                              int bytesPerLine, int height,
-                              int dstStride, int srcStride)
+static inline void memcpy_pic_cb(void *dst, const void *src,
+                                 int bytesPerLine, int height,
+                                 int dstStride, int srcStride,
+                                 void *(*cpy)(void *restrict d,
+                                              const void *restrict s,
+                                              size_t size))
 {
     if (bytesPerLine == dstStride && dstStride == srcStride) {
         if (srcStride < 0) {
@@ -37,16 +40,24 @@ static inline void memcpy_pic(void *dst, const void *src,
             srcStride = -srcStride;
         }
 
-        memcpy(dst, src, srcStride * height);
+        cpy(dst, src, srcStride * height);
     } else {
         for (int i = 0; i < height; i++) {
-            memcpy(dst, src, bytesPerLine);
+            cpy(dst, src, bytesPerLine);
             src = (uint8_t*)src + srcStride;
             dst = (uint8_t*)dst + dstStride;
         }
     }
 }
 
+static inline void memcpy_pic(void *dst, const void *src,
+                              int bytesPerLine, int height,
+                              int dstStride, int srcStride)
+{
+    memcpy_pic_cb(dst, src, bytesPerLine, height, dstStride, srcStride,
+                  memcpy);
+}
+
 static inline void memset_pic(void *dst, int fill, int bytesPerLine, int height,
                               int stride)
 {
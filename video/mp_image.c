@@ -36,6 +36,7 @@
 #include "mp_image.h"
 #include "sws_utils.h"
 #include "memcpy_pic.h"
+#include "gpu_memcpy.h"
 #include "fmt-conversion.h"
 
 #include "video/filter/vf.h"
@@ -344,21 +345,35 @@ void mp_image_unrefp(struct mp_image **p_img)
     *p_img = NULL;
 }
 
-void mp_image_copy(struct mp_image *dst, struct mp_image *src)
+static void mp_image_copy_cb(struct mp_image *dst, struct mp_image *src,
+                             void *(*cpy)(void *restrict d,
+                                          const void *restrict s,
+                                          size_t size))
 {
     assert(dst->imgfmt == src->imgfmt);
     assert(dst->w == src->w && dst->h == src->h);
     assert(mp_image_is_writeable(dst));
     for (int n = 0; n < dst->num_planes; n++) {
         int line_bytes = (dst->plane_w[n] * dst->fmt.bpp[n] + 7) / 8;
-        memcpy_pic(dst->planes[n], src->planes[n], line_bytes, dst->plane_h[n],
-                   dst->stride[n], src->stride[n]);
+        memcpy_pic_cb(dst->planes[n], src->planes[n], line_bytes,
+                      dst->plane_h[n], dst->stride[n], src->stride[n], cpy);
     }
     // Watch out for AV_PIX_FMT_FLAG_PSEUDOPAL retardation
     if ((dst->fmt.flags & MP_IMGFLAG_PAL) && dst->planes[1] && src->planes[1])
         memcpy(dst->planes[1], src->planes[1], MP_PALETTE_SIZE);
 }
 
+void mp_image_copy(struct mp_image *dst, struct mp_image *src)
+{
+    mp_image_copy_cb(dst, src, memcpy);
+}
+
+// Like mp_image_copy(), but src is mapped GPU memory (see gpu_memcpy()).
+void mp_image_copy_gpu(struct mp_image *dst, struct mp_image *src)
+{
+    mp_image_copy_cb(dst, src, gpu_memcpy);
+}
+
 void mp_image_copy_attributes(struct mp_image *dst, struct mp_image *src)
 {
     dst->pict_type = src->pict_type;
@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <stddef.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <pthread.h>
 #include <assert.h>
@@ -26,6 +27,7 @@
 #include "talloc.h"
 
 #include "common/common.h"
+#include "common/mem_budget.h"
 #include "video/mp_image.h"
 
 #include "mp_image_pool.h"
@@ -34,9 +36,12 @@ static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
 #define pool_lock() pthread_mutex_lock(&pool_mutex)
 #define pool_unlock() pthread_mutex_unlock(&pool_mutex)
 
-// Thread-safety: the pool itself is not thread-safe, but pool-allocated images
-// can be referenced and unreferenced from other threads. (As long as the image
-// destructors are thread-safe.)
+// Thread-safety: all pool functions can be called from any thread, and
+// pool-allocated images can be referenced and unreferenced from any thread.
+// (As long as the image destructors and the allocator are thread-safe.)
+// Destroying the pool while it's being used by other threads is not allowed.
+// All pool state is protected by pool_mutex. It's a global lock, but it's
+// never held for long (in particular, not while allocating or freeing data).
 
 struct mp_image_pool {
     int max_count;
@@ -49,6 +54,9 @@ struct mp_image_pool {
 
     bool use_lru;
     unsigned int lru_counter;
+
+    struct mp_mem_user *mem;
+    int64_t bytes;              // data size of all images owned by the pool
 };
 
 // Used to gracefully handle the case when the pool is freed while image
@@ -58,14 +66,41 @@ struct image_flags {
     bool referenced;            // outside mp_image reference exists
     bool pool_alive;            // the mp_image_pool references this
     unsigned int order;         // for LRU allocation (basically a timestamp)
+    int64_t size;               // data size (0 for hwaccel surfaces)
 };
 
 static void image_pool_destructor(void *ptr)
 {
     struct mp_image_pool *pool = ptr;
+    talloc_free(pool->mem);
     mp_image_pool_clear(pool);
 }
 
+// Free the images not in use. Called by the memory budget monitor thread.
+// Images from a custom allocator are left alone, because their destructors
+// might not be safe to call from an unrelated thread.
+static void pool_mem_trim(void *ctx, enum mp_mem_trim level)
+{
+    struct mp_image_pool *pool = ctx;
+    struct mp_image **unused = NULL;
+    int num_unused = 0;
+    pool_lock();
+    for (int n = pool->num_images - 1; n >= 0 && !pool->allocator; n--) {
+        struct mp_image *img = pool->images[n];
+        struct image_flags *it = img->priv;
+        if (!it->referenced) {
+            pool->bytes -= it->size;
+            MP_TARRAY_REMOVE_AT(pool->images, pool->num_images, n);
+            MP_TARRAY_APPEND(NULL, unused, num_unused, img);
+        }
+    }
+    mp_mem_user_set_usage(pool->mem, pool->bytes);
+    pool_unlock();
+    for (int n = 0; n < num_unused; n++)
+        talloc_free(unused[n]);
+    talloc_free(unused);
+}
+
 struct mp_image_pool *mp_image_pool_new(int max_count)
 {
     struct mp_image_pool *pool = talloc_ptrtype(NULL, pool);
@@ -73,28 +108,51 @@ struct mp_image_pool *mp_image_pool_new(int max_count)
     *pool = (struct mp_image_pool) {
         .max_count = max_count,
     };
+    pool->mem = mp_mem_user_new(NULL, "image-pool", pool_mem_trim, pool);
     return pool;
 }
 
 void mp_image_pool_clear(struct mp_image_pool *pool)
 {
-    for (int n = 0; n < pool->num_images; n++) {
-        struct mp_image *img = pool->images[n];
-        struct image_flags *it = img->priv;
-        bool referenced;
-        pool_lock();
+    pool_lock();
+    struct mp_image **images = pool->images;
+    int num_images = pool->num_images;
+    pool->images = NULL;
+    pool->num_images = 0;
+    pool->bytes = 0;
+    mp_mem_user_set_usage(pool->mem, 0);
+    for (int n = 0; n < num_images; n++) {
+        struct image_flags *it = images[n]->priv;
         assert(it->pool_alive);
         it->pool_alive = false;
-        referenced = it->referenced;
-        pool_unlock();
-        if (!referenced)
-            talloc_free(img);
+        // Referenced images are freed by unref_image().
+        if (it->referenced)
+            images[n] = NULL;
     }
-    pool->num_images = 0;
+    pool_unlock();
+    for (int n = 0; n < num_images; n++)
+        talloc_free(images[n]);
+    talloc_free(images);
+}
+
+// Return the number of images owned by the pool, and how many of them are
+// currently referenced outside of the pool.
+void mp_image_pool_get_usage(struct mp_image_pool *pool, int *num_images,
+                             int *num_used)
+{
+    int used = 0;
+    pool_lock();
+    for (int n = 0; n < pool->num_images; n++) {
+        struct image_flags *it = pool->images[n]->priv;
+        used += it->referenced;
+    }
+    *num_images = pool->num_images;
+    pool_unlock();
+    *num_used = used;
 }
 
-// This is the only function that is allowed to run in a different thread.
-// (Consider passing an image to another thread, which frees it.)
+// Can run on any thread. (Consider passing an image to another thread, which
+// frees it.)
 static void unref_image(void *ptr)
 {
     struct mp_image *img = ptr;
@@ -133,13 +191,16 @@ struct mp_image *mp_image_pool_get_no_alloc(struct mp_image_pool *pool, int fmt,
             }
         }
     }
+    if (new) {
+        // Mark it as used before unlocking, so other threads can't pick it.
+        struct image_flags *it = new->priv;
+        assert(!it->referenced && it->pool_alive);
+        it->referenced = true;
+        it->order = ++pool->lru_counter;
+    }
     pool_unlock();
     if (!new)
         return NULL;
-    struct image_flags *it = new->priv;
-    assert(!it->referenced && it->pool_alive);
-    it->referenced = true;
-    it->order = ++pool->lru_counter;
     return mp_image_new_custom_ref(new, new, unref_image);
 }
 
@@ -153,7 +214,10 @@ struct mp_image *mp_image_pool_get(struct mp_image_pool *pool, int fmt,
 {
     struct mp_image *new = mp_image_pool_get_no_alloc(pool, fmt, w, h);
     if (!new) {
-        if (pool->num_images >= pool->max_count)
+        pool_lock();
+        bool full = pool->num_images >= pool->max_count;
+        pool_unlock();
+        if (full)
             mp_image_pool_clear(pool);
         if (pool->allocator) {
             new = pool->allocator(pool->allocator_ctx, fmt, w, h);
@@ -163,10 +227,18 @@ struct mp_image *mp_image_pool_get(struct mp_image_pool *pool, int fmt,
         if (!new)
             return NULL;
         struct image_flags *it = talloc_ptrtype(new, it);
-        *it = (struct image_flags) { .pool_alive = true };
+        *it = (struct image_flags) { .pool_alive = true, .referenced = true };
+        for (int n = 0; n < new->num_planes; n++)
+            it->size += (int64_t)abs(new->stride[n]) * new->plane_h[n];
         new->priv = it;
+        // Add it as referenced image, so that another thread can't take it.
+        pool_lock();
         MP_TARRAY_APPEND(pool, pool->images, pool->num_images, new);
-        new = mp_image_pool_get_no_alloc(pool, fmt, w, h);
+        it->order = ++pool->lru_counter;
+        pool->bytes += it->size;
+        mp_mem_user_set_usage(pool->mem, pool->bytes);
+        pool_unlock();
+        new = mp_image_new_custom_ref(new, new, unref_image);
     }
     return new;
 }
@@ -12,6 +12,9 @@ void mp_image_pool_clear(struct mp_image_pool *pool);
 
 void mp_image_pool_set_lru(struct mp_image_pool *pool);
 
+void mp_image_pool_get_usage(struct mp_image_pool *pool, int *num_images,
+                             int *num_used);
+
 struct mp_image *mp_image_pool_get_no_alloc(struct mp_image_pool *pool, int fmt,
                                             int w, int h);
 
@@ -20,6 +20,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <assert.h>
 #include <stdio.h>
 
@@ -207,6 +209,419 @@ int packer_pack_from_subbitmaps(struct bitmap_packer *packer,
     return packer_pack(packer);
 }
 
+/* Incremental packing.
+ *
+ * New rectangles are placed bottom-left on a skyline (the lowest occupied
+ * line for each x range). Space that gets covered below a rectangle, and the
+ * space of removed rectangles, is put on a list of free rectangles, which is
+ * tried first (best area fit, guillotine split). Adjacent free rectangles are
+ * merged, and free rectangles touching the skyline are given back to it.
+ */
+
+// Number of packer_pack_incremental() calls after which unused bitmaps are
+// removed from the surface.
+#define KEEP_UNUSED 16
+
+struct packer_segment {
+    int x, y, w;
+};
+
+struct packer_rect {
+    int x, y, w, h;
+};
+
+struct packer_entry {
+    uint64_t hash;
+    int w, h;                   // bitmap size (without padding)
+    // Bitmap contents, compared on hash matches. Entries own a copy; lookup
+    // keys point to the sub-bitmap.
+    const uint8_t *data;
+    int stride;
+    int line_len;               // bytes per line (w * pixel stride)
+    struct pos pos;
+    int last_used;
+};
+
+struct packer_incremental {
+    int w, h;                   // area, including padding
+    int padding;
+    int format;
+    struct packer_segment *skyline;
+    int num_skyline;
+    struct packer_rect *free_rects;
+    int num_free_rects;
+    struct packer_entry *entries; // sorted with cmp_entry()
+    int num_entries;
+    int generation;
+};
+
+static uint64_t hash_bitmap(struct sub_bitmap *s, int pixel_stride)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    int len = s->w * pixel_stride;
+    for (int y = 0; y < s->h; y++) {
+        const uint8_t *line = (const uint8_t *)s->bitmap + y * s->stride;
+        int x = 0;
+        for (; x + 8 <= len; x += 8) {
+            uint64_t v;
+            memcpy(&v, line + x, 8);
+            h = (h ^ v) * prime;
+            h ^= h >> 29;
+        }
+        for (; x < len; x++)
+            h = (h ^ line[x]) * prime;
+    }
+    return h;
+}
+
+static int cmp_entry(const void *pa, const void *pb)
+{
+    const struct packer_entry *a = pa, *b = pb;
+    if (a->hash != b->hash)
+        return a->hash > b->hash ? 1 : -1;
+    if (a->w != b->w)
+        return a->w > b->w ? 1 : -1;
+    if (a->h != b->h)
+        return a->h > b->h ? 1 : -1;
+    // Equal hashes: compare the contents too, so that a hash collision can't
+    // make a bitmap show up at the position of a different one.
+    for (int y = 0; y < a->h; y++) {
+        int r = memcmp(a->data + y * a->stride, b->data + y * b->stride,
+                       a->line_len);
+        if (r)
+            return r;
+    }
+    return 0;
+}
+
+// Make e (a copy of a lookup key) own a copy of the bitmap data.
+static void entry_copy_data(struct packer_incremental *s,
+                            struct packer_entry *e)
+{
+    uint8_t *data = talloc_size(s, e->line_len * e->h);
+    for (int y = 0; y < e->h; y++)
+        memcpy(data + y * e->line_len, e->data + y * e->stride, e->line_len);
+    e->data = data;
+    e->stride = e->line_len;
+}
+
+static void entry_free_data(struct packer_entry *e)
+{
+    talloc_free((void *)e->data);
+    e->data = NULL;
+}
+
+static void skyline_merge(struct packer_incremental *s)
+{
+    for (int n = s->num_skyline - 1; n > 0; n--) {
+        if (s->skyline[n - 1].y == s->skyline[n].y) {
+            s->skyline[n - 1].w += s->skyline[n].w;
+            MP_TARRAY_REMOVE_AT(s->skyline, s->num_skyline, n);
+        }
+    }
+}
+
+static void add_free_rect(struct packer_incremental *s, struct packer_rect r)
+{
+    if (r.w <= 0 || r.h <= 0)
+        return;
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int n = 0; n < s->num_free_rects; n++) {
+            struct packer_rect *f = &s->free_rects[n];
+            if (f->x == r.x && f->w == r.w &&
+                (f->y + f->h == r.y || r.y + r.h == f->y))
+            {
+                r.y = FFMIN(r.y, f->y);
+                r.h += f->h;
+            } else if (f->y == r.y && f->h == r.h &&
+                       (f->x + f->w == r.x || r.x + r.w == f->x))
+            {
+                r.x = FFMIN(r.x, f->x);
+                r.w += f->w;
+            } else {
+                continue;
+            }
+            MP_TARRAY_REMOVE_AT(s->free_rects, s->num_free_rects, n);
+            merged = true;
+            break;
+        }
+    }
+    // Free space directly above a skyline segment lowers the skyline.
+    for (int n = 0; n < s->num_skyline; n++) {
+        struct packer_segment *seg = &s->skyline[n];
+        if (seg->x == r.x && seg->w == r.w && seg->y == r.y + r.h) {
+            seg->y = r.y;
+            skyline_merge(s);
+            return;
+        }
+    }
+    MP_TARRAY_APPEND(s, s->free_rects, s->num_free_rects, r);
+}
+
+static bool free_rects_insert(struct packer_incremental *s, int w, int h,
+                              struct pos *out)
+{
+    int best = -1;
+    int64_t best_waste = INT64_MAX;
+    for (int n = 0; n < s->num_free_rects; n++) {
+        struct packer_rect *f = &s->free_rects[n];
+        int64_t waste = (int64_t)f->w * f->h - (int64_t)w * h;
+        if (f->w >= w && f->h >= h && waste < best_waste) {
+            best = n;
+            best_waste = waste;
+        }
+    }
+    if (best < 0)
+        return false;
+    struct packer_rect f = s->free_rects[best];
+    MP_TARRAY_REMOVE_AT(s->free_rects, s->num_free_rects, best);
+    *out = (struct pos){f.x, f.y};
+    // Split the remaining space along the shorter leftover axis.
+    if (f.w - w < f.h - h) {
+        add_free_rect(s, (struct packer_rect){f.x + w, f.y, f.w - w, h});
+        add_free_rect(s, (struct packer_rect){f.x, f.y + h, f.w, f.h - h});
+    } else {
+        add_free_rect(s, (struct packer_rect){f.x, f.y + h, w, f.h - h});
+        add_free_rect(s, (struct packer_rect){f.x + w, f.y, f.w - w, f.h});
+    }
+    return true;
+}
+
+// y position at which a rectangle of width w placed at segment i would rest,
+// or -1 if it doesn't fit horizontally.
+static int skyline_fit(struct packer_incremental *s, int i, int w)
+{
+    if (s->skyline[i].x + w > s->w)
+        return -1;
+    int y = 0;
+    for (int left = w; left > 0; i++) {
+        y = FFMAX(y, s->skyline[i].y);
+        left -= s->skyline[i].w;
+    }
+    return y;
+}
+
+static bool skyline_insert(struct packer_incremental *s, int w, int h,
+                           struct pos *out)
+{
+    int best = -1, best_bottom = INT_MAX, best_w = INT_MAX;
+    for (int n = 0; n < s->num_skyline; n++) {
+        int y = skyline_fit(s, n, w);
+        if (y < 0 || y + h > s->h)
+            continue;
+        if (y + h < best_bottom ||
+            (y + h == best_bottom && s->skyline[n].w < best_w))
+        {
+            best = n;
+            best_bottom = y + h;
+            best_w = s->skyline[n].w;
+        }
+    }
+    if (best < 0)
+        return false;
+    int x = s->skyline[best].x;
+    int y = best_bottom - h;
+    int end = x + w;
+    // Remove the covered segments; the space between them and the new
+    // rectangle can't be reached from the skyline anymore.
+    struct packer_rect waste[s->num_skyline];
+    int num_waste = 0;
+    int n = best;
+    while (n < s->num_skyline && s->skyline[n].x < end) {
+        struct packer_segment seg = s->skyline[n];
+        int seg_end = seg.x + seg.w;
+        waste[num_waste++] = (struct packer_rect){seg.x, seg.y,
+                                                  FFMIN(seg_end, end) - seg.x,
+                                                  y - seg.y};
+        if (seg_end > end) {
+            s->skyline[n].x = end;
+            s->skyline[n].w = seg_end - end;
+            break;
+        }
+        MP_TARRAY_REMOVE_AT(s->skyline, s->num_skyline, n);
+    }
+    MP_TARRAY_INSERT_AT(s, s->skyline, s->num_skyline, best,
+                        (struct packer_segment){x, y + h, w});
+    skyline_merge(s);
+    for (int i = 0; i < num_waste; i++)
+        add_free_rect(s, waste[i]);
+    *out = (struct pos){x, y};
+    return true;
+}
+
+static void incremental_reset(struct bitmap_packer *packer, int format)
+{
+    if (!packer->inc)
+        packer->inc = talloc_zero(packer, struct packer_incremental);
+    struct packer_incremental *s = packer->inc;
+    s->w = packer->w + packer->padding;
+    s->h = packer->h + packer->padding;
+    s->padding = packer->padding;
+    s->format = format;
+    s->num_skyline = 0;
+    MP_TARRAY_APPEND(s, s->skyline, s->num_skyline,
+                     (struct packer_segment){0, 0, s->w});
+    s->num_free_rects = 0;
+    for (int n = 0; n < s->num_entries; n++)
+        entry_free_data(&s->entries[n]);
+    s->num_entries = 0;
+}
+
+static struct packer_entry *find_entry(struct packer_incremental *s,
+                                       struct packer_entry *key, int num_sorted)
+{
+    struct packer_entry *e = NULL;
+    if (num_sorted)
+        e = bsearch(key, s->entries, num_sorted, sizeof(*key), cmp_entry);
+    for (int n = num_sorted; !e && n < s->num_entries; n++) {
+        if (cmp_entry(key, &s->entries[n]) == 0)
+            e = &s->entries[n];
+    }
+    return e;
+}
+
+static bool incremental_place(struct bitmap_packer *packer,
+                              struct sub_bitmaps *b, uint64_t *hashes)
+{
+    struct packer_incremental *s = packer->inc;
+    int pad = packer->padding;
+
+    int pixel_stride = b->format == SUBBITMAP_LIBASS ? 1 : 4;
+
+    s->generation++;
+    for (int i = 0; i < b->num_parts; i++) {
+        struct sub_bitmap *sb = &b->parts[i];
+        struct packer_entry key = {
+            .hash = hashes[i],
+            .w = sb->w,
+            .h = sb->h,
+            .data = sb->bitmap,
+            .stride = sb->stride,
+            .line_len = sb->w * pixel_stride,
+        };
+        struct packer_entry *e = find_entry(s, &key, s->num_entries);
+        if (e)
+            e->last_used = s->generation;
+    }
+
+    // Make the space of bitmaps that weren't used for a while available.
+    int num_kept = 0;
+    for (int n = 0; n < s->num_entries; n++) {
+        struct packer_entry *e = &s->entries[n];
+        if (s->generation - e->last_used > KEEP_UNUSED) {
+            add_free_rect(s, (struct packer_rect){e->pos.x, e->pos.y,
+                                                  e->w + pad, e->h + pad});
+            entry_free_data(e);
+        } else {
+            s->entries[num_kept++] = *e;
+        }
+    }
+    s->num_entries = num_kept;
+
+    int num_sorted = s->num_entries;
+    for (int i = 0; i < b->num_parts; i++) {
+        struct sub_bitmap *sb = &b->parts[i];
+        packer->changed[i] = false;
+        packer->result[i] = (struct pos){0, 0};
+        if (sb->w <= 0 || sb->h <= 0)
+            continue;
+        struct packer_entry key = {
+            .hash = hashes[i],
+            .w = sb->w,
+            .h = sb->h,
+            .data = sb->bitmap,
+            .stride = sb->stride,
+            .line_len = sb->w * pixel_stride,
+            .last_used = s->generation,
+        };
+        struct packer_entry *e = find_entry(s, &key, num_sorted);
+        if (!e) {
+            int w = sb->w + pad, h = sb->h + pad;
+            if (!free_rects_insert(s, w, h, &key.pos) &&
+                !skyline_insert(s, w, h, &key.pos))
+                return false;
+            entry_copy_data(s, &key);
+            MP_TARRAY_APPEND(s, s->entries, s->num_entries, key);
+            e = &s->entries[s->num_entries - 1];
+            packer->changed[i] = true;
+        }
+        packer->result[i] = e->pos;
+    }
+    qsort(s->entries, s->num_entries, sizeof(s->entries[0]), cmp_entry);
+
+    packer->used_width = packer->used_height = 0;
+    for (int n = 0; n < s->num_entries; n++) {
+        struct packer_entry *e = &s->entries[n];
+        packer->used_width = FFMAX(packer->used_width, e->pos.x + e->w + pad);
+        packer->used_height = FFMAX(packer->used_height, e->pos.y + e->h + pad);
+    }
+    packer->used_width = FFMIN(packer->used_width, packer->w);
+    packer->used_height = FFMIN(packer->used_height, packer->h);
+    return true;
+}
+
+int packer_pack_incremental(struct bitmap_packer *packer,
+                            struct sub_bitmaps *b)
+{
+    packer->count = 0;
+    if (b->format == SUBBITMAP_EMPTY)
+        return 0;
+    packer_set_size(packer, b->num_parts);
+    packer->changed = talloc_realloc(packer, packer->changed, bool,
+                                     FFMAX(packer->asize, 1));
+
+    int pixel_stride = b->format == SUBBITMAP_LIBASS ? 1 : 4;
+    uint64_t *hashes = talloc_array(NULL, uint64_t, b->num_parts);
+    for (int i = 0; i < b->num_parts; i++)
+        hashes[i] = hash_bitmap(&b->parts[i], pixel_stride);
+
+    struct packer_incremental *s = packer->inc;
+    int r = 0;
+    if (s && s->padding == packer->padding && s->format == b->format &&
+        s->w == packer->w + packer->padding &&
+        s->h == packer->h + packer->padding &&
+        incremental_place(packer, b, hashes))
+        goto done;
+
+    // Repack everything, growing the surface until it fits.
+    int w_orig = packer->w, h_orig = packer->h;
+    int xmax = 0, ymax = 0;
+    for (int i = 0; i < b->num_parts; i++) {
+        xmax = FFMAX(xmax, b->parts[i].w);
+        ymax = FFMAX(ymax, b->parts[i].h);
+    }
+    if (xmax > packer->w)
+        packer->w = 1 << (av_log2(xmax - 1) + 1);
+    if (ymax > packer->h)
+        packer->h = 1 << (av_log2(ymax - 1) + 1);
+    while (1) {
+        incremental_reset(packer, b->format);
+        if (incremental_place(packer, b, hashes)) {
+            r = packer->w != w_orig || packer->h != h_orig;
+            break;
+        }
+        if (packer->w <= packer->h && packer->w != packer->w_max)
+            packer->w = FFMIN(packer->w * 2, packer->w_max);
+        else if (packer->h != packer->h_max)
+            packer->h = FFMIN(packer->h * 2, packer->h_max);
+        else {
+            packer->w = w_orig;
+            packer->h = h_orig;
+            incremental_reset(packer, b->format);
+            packer->count = 0;
+            r = -1;
+            break;
+        }
+    }
+
+done:
+    talloc_free(hashes);
+    return r;
+}
+
 void packer_copy_subbitmaps(struct bitmap_packer *packer, struct sub_bitmaps *b,
                             void *data, int pixel_stride, int stride)
 {
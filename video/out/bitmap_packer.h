@@ -1,6 +1,8 @@
 #ifndef MPLAYER_PACK_RECTANGLES_H
 #define MPLAYER_PACK_RECTANGLES_H
 
+#include <stdbool.h>
+
 struct pos {
     int x;
     int y;
@@ -17,10 +19,14 @@ struct bitmap_packer {
     struct pos *result;
     int used_width;
     int used_height;
+    // Set by packer_pack_incremental(): whether the bitmap at the same index
+    // in packer->result needs to be uploaded.
+    bool *changed;
 
     // internal
     int *scratch;
     int asize;
+    struct packer_incremental *inc;
 };
 
 struct ass_image;
@@ -56,6 +62,18 @@ int packer_pack(struct bitmap_packer *packer);
 int packer_pack_from_subbitmaps(struct bitmap_packer *packer,
                                 struct sub_bitmaps *b);
 
+/* Like packer_pack_from_subbitmaps(), but keep the positions of bitmaps that
+ * were placed by previous calls. Bitmaps are identified by their contents
+ * (looked up by hash, and compared fully on a match); only the new ones are
+ * inserted into the free space, and bitmaps unused for a while are removed.
+ * packer->changed[i] is set for each bitmap that has to be uploaded to its
+ * new position (all of them if everything was repacked).
+ * If the free space is exhausted, everything is repacked, and w and h may be
+ * increased. The return value is as with packer_pack().
+ */
+int packer_pack_incremental(struct bitmap_packer *packer,
+                            struct sub_bitmaps *b);
+
 // Copy the (already packed) sub-bitmaps from b to the image in data.
 // data must point to an image that is at least (packer->w, packer->h) big.
 // The image has the given stride (bytes between (x, y) to (x, y + 1)), and the
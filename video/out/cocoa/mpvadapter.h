@@ -27,6 +27,7 @@
 - (void)performAsyncResize:(NSSize)size;
 - (void)handleFilesArray:(NSArray *)files;
 - (void)didChangeWindowedScreenProfile:(NSScreen *)screen;
+- (void)didChangeWindowScreen;
 
 - (BOOL)isInFullScreenMode;
 - (NSScreen *)fsScreen;
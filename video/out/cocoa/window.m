@@ -62,6 +62,11 @@
     [self.adapter didChangeWindowedScreenProfile:[self screen]];
 }
 
+- (void)windowDidChangeScreen:(NSNotification *)notification
+{
+    [self.adapter didChangeWindowScreen];
+}
+
 - (BOOL)isInFullScreenMode
 {
     return !!([self styleMask] & NSFullScreenWindowMask);
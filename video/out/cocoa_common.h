@@ -33,6 +33,8 @@ int vo_cocoa_config_window(struct vo *vo, uint32_t flags, void *gl_ctx);
 
 void vo_cocoa_set_current_context(struct vo *vo, bool current);
 void vo_cocoa_swap_buffers(struct vo *vo);
+bool vo_cocoa_get_present_feedback(struct vo *vo,
+                                   struct vo_present_feedback *fb);
 int vo_cocoa_check_events(struct vo *vo);
 int vo_cocoa_control(struct vo *vo, int *events, int request, void *arg);
 
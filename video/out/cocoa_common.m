@@ -20,7 +20,9 @@
 #import <Cocoa/Cocoa.h>
 #import <CoreServices/CoreServices.h> // for CGDisplayHideCursor
 #import <IOKit/pwr_mgt/IOPMLib.h>
+#import <CoreVideo/CoreVideo.h>
 #include <dlfcn.h>
+#include <pthread.h>
 
 #include "cocoa_common.h"
 #include "video/out/cocoa/window.h"
@@ -45,6 +47,7 @@
 #include "talloc.h"
 
 #include "common/msg.h"
+#include "osdep/timer.h"
 
 #define CF_RELEASE(a) if ((a) != NULL) CFRelease(a)
 
@@ -84,6 +87,14 @@ struct vo_cocoa_state {
     char *icc_wnd_profile_path;
     char *icc_fs_profile_path;
     id   fs_icc_changed_ns_observer;
+
+    // Display refresh timing from the CVDisplayLink (see display_link_cb())
+    CVDisplayLinkRef link;
+    CGDirectDisplayID link_display;
+    pthread_mutex_t vsync_lock;
+    int64_t vsync_count;        // display vsync counter
+    int64_t vsync_raw_us;       // mp_raw_time_us() time of that vsync
+    double vsync_period;        // in seconds, 0 if unknown
 };
 
 static void dispatch_on_main_thread(struct vo *vo, void(^block)(void))
@@ -132,6 +143,130 @@ static void disable_power_management(struct vo *vo)
             &s->power_mgmt_assertion);
 }
 
+// Called on a CoreVideo thread for each vsync of the display the window is
+// on. Only records the time, which is used as presentation feedback.
+static CVReturn display_link_cb(CVDisplayLinkRef link, const CVTimeStamp *now,
+                                const CVTimeStamp *output_time,
+                                CVOptionFlags flags_in, CVOptionFlags *flags_out,
+                                void *ctx)
+{
+    struct vo_cocoa_state *s = ctx;
+
+    // Host time uses the mach_absolute_time() clock, like mp_raw_time_us().
+    int64_t raw_us = now->hostTime * 1e6 / CVGetHostClockFrequency();
+
+    pthread_mutex_lock(&s->vsync_lock);
+    if ((now->flags & kCVTimeStampVideoRefreshPeriodValid) &&
+        now->videoRefreshPeriod > 0)
+    {
+        // Derived from the video time, so vsyncs without callback count too.
+        s->vsync_count = now->videoTime / now->videoRefreshPeriod;
+    } else {
+        s->vsync_count++;
+    }
+    s->vsync_raw_us = raw_us;
+    s->vsync_period = CVDisplayLinkGetActualOutputVideoRefreshPeriod(link);
+    pthread_mutex_unlock(&s->vsync_lock);
+
+    return kCVReturnSuccess;
+}
+
+// Make the display link follow the screen the window is on.
+static void update_display_link(struct vo *vo)
+{
+    struct vo_cocoa_state *s = vo->cocoa;
+    NSScreen *screen = vo->opts->fullscreen ? s->fs_screen : s->current_screen;
+    if (s->window && [s->window screen])
+        screen = [s->window screen];
+    if (!s->link || !screen)
+        return;
+
+    CGDirectDisplayID display = (CGDirectDisplayID)
+        [[screen deviceDescription][@"NSScreenNumber"] unsignedLongValue];
+    if (display == s->link_display && CVDisplayLinkIsRunning(s->link))
+        return;
+
+    CVDisplayLinkStop(s->link);
+    if (CVDisplayLinkSetCurrentCGDisplay(s->link, display) != kCVReturnSuccess) {
+        MP_WARN(s, "Could not set the display link display.\n");
+        s->link_display = 0;
+        return;
+    }
+    s->link_display = display;
+
+    pthread_mutex_lock(&s->vsync_lock);
+    s->vsync_raw_us = 0;
+    s->vsync_period = 0;
+    pthread_mutex_unlock(&s->vsync_lock);
+
+    if (CVDisplayLinkStart(s->link) != kCVReturnSuccess)
+        MP_WARN(s, "Could not start the display link.\n");
+}
+
+static void init_display_link(struct vo *vo)
+{
+    struct vo_cocoa_state *s = vo->cocoa;
+    if (CVDisplayLinkCreateWithActiveCGDisplays(&s->link) != kCVReturnSuccess) {
+        MP_VERBOSE(s, "Could not create a display link.\n");
+        s->link = NULL;
+        return;
+    }
+    CVDisplayLinkSetOutputCallback(s->link, display_link_cb, s);
+}
+
+static void uninit_display_link(struct vo *vo)
+{
+    struct vo_cocoa_state *s = vo->cocoa;
+    if (s->link) {
+        CVDisplayLinkStop(s->link);
+        CVDisplayLinkRelease(s->link);
+        s->link = NULL;
+    }
+}
+
+bool vo_cocoa_get_present_feedback(struct vo *vo,
+                                   struct vo_present_feedback *fb)
+{
+    struct vo_cocoa_state *s = vo->cocoa;
+    if (!s->link)
+        return false;
+
+    pthread_mutex_lock(&s->vsync_lock);
+    int64_t count = s->vsync_count;
+    int64_t raw_us = s->vsync_raw_us;
+    pthread_mutex_unlock(&s->vsync_lock);
+
+    if (!raw_us)
+        return false;
+
+    int64_t now = mp_time_us();
+    int64_t vsync_time = raw_us - (int64_t)mp_raw_time_us() + now;
+    if (vsync_time > now || vsync_time < now - 1000000)
+        return false;
+
+    *fb = (struct vo_present_feedback){
+        .vsync_count = count,
+        .vsync_time = vsync_time,
+    };
+    return true;
+}
+
+static bool get_display_fps(struct vo *vo, double *fps)
+{
+    struct vo_cocoa_state *s = vo->cocoa;
+    if (!s->link)
+        return false;
+    pthread_mutex_lock(&s->vsync_lock);
+    double period = s->vsync_period;
+    pthread_mutex_unlock(&s->vsync_lock);
+    if (period <= 0)
+        period = CVDisplayLinkGetActualOutputVideoRefreshPeriod(s->link);
+    if (period <= 0)
+        return false;
+    *fps = 1.0 / period;
+    return true;
+}
+
 int vo_cocoa_init(struct vo *vo)
 {
     struct vo_cocoa_state *s = talloc_zero(vo, struct vo_cocoa_state);
@@ -145,7 +280,9 @@ int vo_cocoa_init(struct vo *vo)
         .log = mp_log_new(s, vo->log, "cocoa"),
         .icc_profile_path_changed = false,
     };
+    pthread_mutex_init(&s->vsync_lock, NULL);
     vo->cocoa = s;
+    init_display_link(vo);
     return 1;
 }
 
@@ -164,6 +301,9 @@ static void vo_cocoa_set_cursor_visibility(struct vo *vo, bool *visible)
 
 void vo_cocoa_uninit(struct vo *vo)
 {
+    uninit_display_link(vo);
+    pthread_mutex_destroy(&vo->cocoa->vsync_lock);
+
     dispatch_sync(dispatch_get_main_queue(), ^{
         struct vo_cocoa_state *s = vo->cocoa;
         enable_power_management(vo);
@@ -444,6 +584,8 @@ int vo_cocoa_config_window(struct vo *vo, uint32_t flags, void *gl_ctx)
             cocoa_add_fs_screen_profile_observer(vo);
         }
 
+        update_display_link(vo);
+
         s->enable_resize_redraw = true;
     });
 
@@ -687,6 +829,8 @@ int vo_cocoa_control(struct vo *vo, int *events, int request, void *arg)
     case VOCTRL_GET_ICC_PROFILE_PATH:
         vo_cocoa_control_get_icc_profile_path(vo, arg);
         return VO_TRUE;
+    case VOCTRL_GET_DISPLAY_FPS:
+        return get_display_fps(vo, arg) ? VO_TRUE : VO_NOTIMPL;
     }
     return VO_NOTIMPL;
 }
@@ -767,4 +911,9 @@ void *vo_cocoa_cgl_pixel_format(struct vo *vo)
     cocoa_change_profile(self.vout, &s->icc_wnd_profile_path, screen);
     s->icc_profile_path_changed = true;
 }
+
+- (void)didChangeWindowScreen
+{
+    update_display_link(self.vout);
+}
 @end
@@ -33,9 +33,11 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "filter_kernels.h"
 
@@ -88,26 +90,91 @@ bool mp_init_filter(struct filter_kernel *filter, const int *sizes,
 void mp_compute_weights(struct filter_kernel *filter, double f, float *out_w)
 {
     assert(filter->size > 0);
+    double scale = 1.0 / filter->inv_scale;
+    double x = f + filter->size / 2 - 1; // distance to the first sample point
     double sum = 0;
     for (int n = 0; n < filter->size; n++) {
-        double x = f - (n - filter->size / 2 + 1);
-        double w = filter->weight(filter, fabs(x) / filter->inv_scale);
+        double w = filter->weight(filter, fabs(x) * scale);
         out_w[n] = w;
         sum += w;
+        x -= 1.0;
     }
     //normalize
+    double norm = 1.0 / sum;
     for (int n = 0; n < filter->size; n++)
-        out_w[n] /= sum;
+        out_w[n] *= norm;
+}
+
+// Computed LUTs, shared by all users (e.g. multiple VOs). Recomputing them
+// is slow with large filters, and resizing the window back and forth tends
+// to request the same LUTs again.
+#define LUT_CACHE_SIZE 8
+
+struct lut_cache_entry {
+    struct filter_kernel filter;
+    int count;
+    float *data;
+    unsigned int last_use;
+};
+
+static pthread_mutex_t lut_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct lut_cache_entry lut_cache[LUT_CACHE_SIZE];
+static unsigned int lut_cache_use;
+
+static bool same_lut(struct lut_cache_entry *e, struct filter_kernel *filter,
+                     int count)
+{
+    return e->data && e->count == count &&
+           e->filter.weight == filter->weight &&
+           e->filter.radius == filter->radius &&
+           e->filter.params[0] == filter->params[0] &&
+           e->filter.params[1] == filter->params[1] &&
+           e->filter.size == filter->size &&
+           e->filter.inv_scale == filter->inv_scale;
 }
 
 // Fill the given array with weights for the range [0.0, 1.0]. The array is
 // interpreted as rectangular array of count * filter->size items.
 void mp_compute_lut(struct filter_kernel *filter, int count, float *out_array)
 {
+    size_t size = sizeof(float) * filter->size * count;
+
+    pthread_mutex_lock(&lut_cache_lock);
+    struct lut_cache_entry *e = &lut_cache[0];
+    for (int n = 0; n < LUT_CACHE_SIZE; n++) {
+        struct lut_cache_entry *cur = &lut_cache[n];
+        if (same_lut(cur, filter, count)) {
+            cur->last_use = ++lut_cache_use;
+            memcpy(out_array, cur->data, size);
+            pthread_mutex_unlock(&lut_cache_lock);
+            return;
+        }
+        if (cur->last_use < e->last_use)
+            e = cur;
+    }
+    pthread_mutex_unlock(&lut_cache_lock);
+
     for (int n = 0; n < count; n++) {
         mp_compute_weights(filter, n / (double)(count - 1),
                            out_array + filter->size * n);
     }
+
+    // Replace the least recently used entry.
+    pthread_mutex_lock(&lut_cache_lock);
+    float *data = realloc(e->data, size);
+    if (data) {
+        memcpy(data, out_array, size);
+        *e = (struct lut_cache_entry){
+            .filter = *filter,
+            .count = count,
+            .data = data,
+            .last_use = ++lut_cache_use,
+        };
+    } else {
+        free(e->data);
+        *e = (struct lut_cache_entry){0};
+    }
+    pthread_mutex_unlock(&lut_cache_lock);
 }
 
 typedef struct filter_kernel kernel;
@@ -145,6 +145,12 @@ static void swapGlBuffers_cocoa(MPGLContext *ctx)
     vo_cocoa_swap_buffers(ctx->vo);
 }
 
+static bool get_present_feedback_cocoa(MPGLContext *ctx,
+                                       struct vo_present_feedback *fb)
+{
+    return vo_cocoa_get_present_feedback(ctx->vo, fb);
+}
+
 static void set_current_cocoa(MPGLContext *ctx, bool current)
 {
     vo_cocoa_set_current_context(ctx->vo, current);
@@ -156,6 +162,7 @@ void mpgl_set_backend_cocoa(MPGLContext *ctx)
     ctx->config_window = config_window_cocoa;
     ctx->releaseGlContext = releaseGlContext_cocoa;
     ctx->swapGlBuffers = swapGlBuffers_cocoa;
+    ctx->get_present_feedback = get_present_feedback_cocoa;
     ctx->vo_init = vo_cocoa_init;
     ctx->register_resize_callback = vo_cocoa_register_resize_callback;
     ctx->vo_uninit = vo_cocoa_uninit;
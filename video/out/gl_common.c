@@ -115,6 +115,7 @@ static const struct feature features[] = {
     {MPGL_CAP_SRGB_FB,          "sRGB framebuffers"},
     {MPGL_CAP_FLOAT_TEX,        "Float textures"},
     {MPGL_CAP_TEX_RG,           "RG textures"},
+    {MPGL_CAP_TIMER,            "Timer queries"},
     {MPGL_CAP_NO_SW,            "NO_SW"},
     {0},
 };
@@ -235,6 +236,7 @@ static const struct gl_functions gl_functions[] = {
             DEF_FN(BindAttribLocation),
             DEF_FN(Uniform1f),
             DEF_FN(Uniform2f),
+            DEF_FN(Uniform2i),
             DEF_FN(Uniform3f),
             DEF_FN(Uniform1i),
             DEF_FN(UniformMatrix2fv),
@@ -449,6 +451,68 @@ static const struct gl_functions gl_functions[] = {
             {0}
         },
     },
+    // Fences, extension in GL 3.1, core in GL 3.2.
+    {
+        .ver_core = MPGL_VER(3, 2),
+        .extension = "GL_ARB_sync",
+        .provides = MPGL_CAP_SYNC,
+        .functions = (const struct gl_function[]) {
+            DEF_FN(FenceSync),
+            DEF_FN(ClientWaitSync),
+            DEF_FN(DeleteSync),
+            {0}
+        },
+    },
+    // Immutable (and persistently mappable) buffers, core in GL 4.4.
+    {
+        .ver_core = MPGL_VER(4, 4),
+        .extension = "GL_ARB_buffer_storage",
+        .provides = MPGL_CAP_BUFFER_STORAGE,
+        .functions = (const struct gl_function[]) {
+            DEF_FN(BufferStorage),
+            DEF_FN(MapBufferRange),
+            {0}
+        },
+    },
+    // Retrieving and loading linked programs, core in GL 4.1.
+    {
+        .ver_core = MPGL_VER(4, 1),
+        .extension = "GL_ARB_get_program_binary",
+        .provides = MPGL_CAP_PROGRAM_BINARY,
+        .functions = (const struct gl_function[]) {
+            DEF_FN(GetProgramBinary),
+            DEF_FN(ProgramBinary),
+            DEF_FN(ProgramParameteri),
+            {0}
+        },
+    },
+    // Compute shaders and image load/store, both core in GL 4.3.
+    {
+        .ver_core = MPGL_VER(4, 3),
+        .provides = MPGL_CAP_COMPUTE_SHADER,
+        .functions = (const struct gl_function[]) {
+            DEF_FN(DispatchCompute),
+            DEF_FN(BindImageTexture),
+            DEF_FN(MemoryBarrier),
+            {0}
+        },
+    },
+    // Timer queries, core in GL 3.3. (Query objects themselves are GL 1.5,
+    // but GetQueryObjectui64v and GL_TIME_ELAPSED come with the extension.)
+    {
+        .ver_core = MPGL_VER(3, 3),
+        .extension = "GL_ARB_timer_query",
+        .provides = MPGL_CAP_TIMER,
+        .functions = (const struct gl_function[]) {
+            DEF_FN(GenQueries),
+            DEF_FN(DeleteQueries),
+            DEF_FN(BeginQuery),
+            DEF_FN(EndQuery),
+            DEF_FN(GetQueryObjectiv),
+            DEF_FN(GetQueryObjectui64v),
+            {0}
+        },
+    },
     // Apple Packed YUV Formats
     // For gl_hwdec_vda.c
     // http://www.opengl.org/registry/specs/APPLE/rgb_422.txt
@@ -469,20 +533,21 @@ static const struct gl_functions gl_functions[] = {
 
 // Fill the GL struct with function pointers and extensions from the current
 // GL context. Called by the backend.
-// getProcAddress: function to resolve function names, may be NULL
+// get_fn: function to resolve function names
+// fn_ctx: opaque caller context, passed to get_fn
 // ext2: an extra extension string
 // log: used to output messages
 // Note: if you create a CONTEXT_FORWARD_COMPATIBLE_BIT_ARB with OpenGL 3.0,
 //       you must append "GL_ARB_compatibility" to ext2.
-void mpgl_load_functions(GL *gl, void *(*getProcAddress)(const GLubyte *),
-                         const char *ext2, struct mp_log *log)
+void mpgl_load_functions2(GL *gl, void *(*get_fn)(void *ctx, const char *n),
+                          void *fn_ctx, const char *ext2, struct mp_log *log)
 {
     talloc_free_children(gl);
     *gl = (GL) {
         .extensions = talloc_strdup(gl, ext2 ? ext2 : ""),
     };
 
-    gl->GetString = getProcAddress ? getProcAddress("glGetString") : NULL;
+    gl->GetString = get_fn(fn_ctx, "glGetString");
     if (!gl->GetString) {
         mp_err(log, "Can't load OpenGL functions.\n");
         return;
@@ -508,8 +573,8 @@ void mpgl_load_functions(GL *gl, void *(*getProcAddress)(const GLubyte *),
 
     bool has_legacy = false;
     if (gl->version >= MPGL_VER(3, 0)) {
-        gl->GetStringi = getProcAddress("glGetStringi");
-        gl->GetIntegerv = getProcAddress("glGetIntegerv");
+        gl->GetStringi = get_fn(fn_ctx, "glGetStringi");
+        gl->GetIntegerv = get_fn(fn_ctx, "glGetIntegerv");
 
         if (!(gl->GetStringi && gl->GetIntegerv))
             return;
@@ -571,7 +636,7 @@ void mpgl_load_functions(GL *gl, void *(*getProcAddress)(const GLubyte *),
             const struct gl_function *fn = &section->functions[i];
             void *ptr = NULL;
             for (int x = 0; fn->funcnames[x]; x++) {
-                ptr = getProcAddress((const GLubyte *)fn->funcnames[x]);
+                ptr = get_fn(fn_ctx, fn->funcnames[x]);
                 if (ptr)
                     break;
             }
@@ -620,6 +685,21 @@ void mpgl_load_functions(GL *gl, void *(*getProcAddress)(const GLubyte *),
     list_features(gl->mpgl_caps, log, MSGL_V, false);
 }
 
+static void *get_procaddr_wrapper(void *ctx, const char *name)
+{
+    void *(*getProcAddress)(const GLubyte *) = ctx;
+    return getProcAddress ? getProcAddress((const GLubyte*)name) : NULL;
+}
+
+// Like mpgl_load_functions2(), but with a plain getProcAddress function,
+// which may be NULL.
+void mpgl_load_functions(GL *gl, void *(*getProcAddress)(const GLubyte *),
+                         const char *ext2, struct mp_log *log)
+{
+    mpgl_load_functions2(gl, get_procaddr_wrapper, (void *)getProcAddress,
+                         ext2, log);
+}
+
 /**
  * \brief return the number of bytes per pixel for the given format
  * \param format OpenGL format
@@ -89,6 +89,11 @@ enum {
     MPGL_CAP_TEX_RG             = (1 << 10),    // GL_ARB_texture_rg / GL 3.x
     MPGL_CAP_VDPAU              = (1 << 11),    // GL_NV_vdpau_interop
     MPGL_CAP_APPLE_RGB_422      = (1 << 12),    // GL_APPLE_rgb_422
+    MPGL_CAP_SYNC               = (1 << 13),    // GL_ARB_sync / GL 3.2
+    MPGL_CAP_BUFFER_STORAGE     = (1 << 14),    // GL_ARB_buffer_storage / GL 4.4
+    MPGL_CAP_PROGRAM_BINARY     = (1 << 15),    // GL_ARB_get_program_binary
+    MPGL_CAP_COMPUTE_SHADER     = (1 << 16),    // GL 4.3 compute shaders
+    MPGL_CAP_TIMER              = (1 << 17),    // GL_ARB_timer_query / GL 3.3
     MPGL_CAP_NO_SW              = (1 << 30),    // used to block sw. renderers
 };
 
@@ -116,6 +121,12 @@ typedef struct MPGLContext {
     void (*releaseGlContext)(struct MPGLContext *);
     void (*set_current)(struct MPGLContext *, bool current);
 
+    // Optional. Return information about the most recent vsync (see
+    // VOCTRL_GET_PRESENT_FEEDBACK); called after swapGlBuffers. Returns false
+    // if not available.
+    bool (*get_present_feedback)(struct MPGLContext *,
+                                 struct vo_present_feedback *fb);
+
     // Resize the window, or create a new window if there isn't one yet.
     // On the first call, it creates a GL context according to what's specified
     // in MPGLContext.requested_gl_version. This is just a hint, and if the
@@ -210,6 +221,8 @@ extern const struct gl_hwdec_driver *const mpgl_hwdec_drivers[];
 
 void mpgl_load_functions(GL *gl, void *(*getProcAddress)(const GLubyte *),
                          const char *ext2, struct mp_log *log);
+void mpgl_load_functions2(GL *gl, void *(*get_fn)(void *ctx, const char *n),
+                          void *fn_ctx, const char *ext2, struct mp_log *log);
 
 // print a multi line string with line numbers (e.g. for shader sources)
 // log, lev: module and log level, as in mp_msg()
@@ -350,6 +363,7 @@ struct GL {
 
     void (GLAPIENTRY *Uniform1f)(GLint, GLfloat);
     void (GLAPIENTRY *Uniform2f)(GLint, GLfloat, GLfloat);
+    void (GLAPIENTRY *Uniform2i)(GLint, GLint, GLint);
     void (GLAPIENTRY *Uniform3f)(GLint, GLfloat, GLfloat, GLfloat);
     void (GLAPIENTRY *Uniform4f)(GLint, GLfloat, GLfloat, GLfloat, GLfloat);
     void (GLAPIENTRY *Uniform1i)(GLint, GLint);
@@ -369,6 +383,32 @@ struct GL {
     void (GLAPIENTRY *VDPAUMapSurfacesNV)(GLsizei, const GLvdpauSurfaceNV *);
     void (GLAPIENTRY *VDPAUUnmapSurfacesNV)(GLsizei, const GLvdpauSurfaceNV *);
 
+    GLsync (GLAPIENTRY *FenceSync)(GLenum, GLbitfield);
+    GLenum (GLAPIENTRY *ClientWaitSync)(GLsync, GLbitfield, GLuint64);
+    void (GLAPIENTRY *DeleteSync)(GLsync);
+
+    void (GLAPIENTRY *BufferStorage)(GLenum, intptr_t, const GLvoid *,
+                                     GLbitfield);
+    GLvoid * (GLAPIENTRY *MapBufferRange)(GLenum, intptr_t, intptr_t,
+                                          GLbitfield);
+
+    void (GLAPIENTRY *GetProgramBinary)(GLuint, GLsizei, GLsizei *, GLenum *,
+                                        GLvoid *);
+    void (GLAPIENTRY *ProgramBinary)(GLuint, GLenum, const GLvoid *, GLsizei);
+    void (GLAPIENTRY *ProgramParameteri)(GLuint, GLenum, GLint);
+
+    void (GLAPIENTRY *DispatchCompute)(GLuint, GLuint, GLuint);
+    void (GLAPIENTRY *BindImageTexture)(GLuint, GLuint, GLint, GLboolean,
+                                        GLint, GLenum, GLenum);
+    void (GLAPIENTRY *MemoryBarrier)(GLbitfield);
+
+    void (GLAPIENTRY *GenQueries)(GLsizei, GLuint *);
+    void (GLAPIENTRY *DeleteQueries)(GLsizei, const GLuint *);
+    void (GLAPIENTRY *BeginQuery)(GLenum, GLuint);
+    void (GLAPIENTRY *EndQuery)(GLenum);
+    void (GLAPIENTRY *GetQueryObjectiv)(GLuint, GLenum, GLint *);
+    void (GLAPIENTRY *GetQueryObjectui64v)(GLuint, GLenum, GLuint64 *);
+
     GLint (GLAPIENTRY *GetVideoSync)(GLuint *);
     GLint (GLAPIENTRY *WaitVideoSync)(GLint, GLint, unsigned int *);
 };
@@ -21,6 +21,7 @@
  */
 
 #include <string.h>
+#include <inttypes.h>
 
 #include "talloc.h"
 
@@ -29,6 +30,7 @@
 #include "stream/stream.h"
 #include "common/common.h"
 #include "misc/bstr.h"
+#include "misc/thread_pool.h"
 #include "common/msg.h"
 #include "options/m_option.h"
 #include "options/path.h"
@@ -67,6 +69,7 @@ const struct m_sub_options mp_icc_conf = {
         OPT_STRING("icc-profile", profile, 0),
         OPT_FLAG("icc-profile-auto", profile_auto, 0),
         OPT_STRING("icc-cache", cache, 0),
+        OPT_STRING("icc-cache-dir", cache_dir, 0),
         OPT_INT("icc-intent", intent, 0),
         OPT_STRING_VALIDATE("3dlut-size", size_str, 0, validate_3dlut_size_opt),
         {0}
@@ -74,6 +77,7 @@ const struct m_sub_options mp_icc_conf = {
     .size = sizeof(struct mp_icc_opts),
     .defaults = &(const struct mp_icc_opts) {
         .size_str = "128x256x64",
+        .cache_dir = "~~/icc-cache",
         .intent = INTENT_RELATIVE_COLORIMETRIC,
     },
 };
@@ -112,6 +116,53 @@ bool mp_icc_set_profile(struct mp_icc_opts *opts, char *profile)
 
 #define LUT3D_CACHE_HEADER "mpv 3dlut cache 1.0\n"
 
+// Return the cache file for the given LUT parameters and profile, or NULL if
+// caching is disabled. An explicit --icc-cache file takes precedence.
+static char *get_cache_file(void *ta_ctx, struct mp_icc_opts *opts,
+                            struct mpv_global *global, const char *cache_info,
+                            struct bstr iccdata)
+{
+    if (opts->cache)
+        return mp_get_user_path(ta_ctx, global, opts->cache);
+    if (!opts->cache_dir || !opts->cache_dir[0])
+        return NULL;
+
+    // FNV-1a; collisions are caught by comparing the stored header and
+    // profile data.
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *s = cache_info; *s; s++)
+        hash = (hash ^ (unsigned char)*s) * 1099511628211ULL;
+    for (size_t n = 0; n < iccdata.len; n++)
+        hash = (hash ^ iccdata.start[n]) * 1099511628211ULL;
+
+    char *dir = mp_get_user_path(ta_ctx, global, opts->cache_dir);
+    char *name = talloc_asprintf(ta_ctx, "%016"PRIx64".3dlut", hash);
+    return mp_path_join(ta_ctx, bstr0(dir), bstr0(name));
+}
+
+struct lut_job {
+    cmsHTRANSFORM trafo;
+    uint16_t *output;
+    int s_r, s_g, s_b;
+};
+
+// Transform the (s_r)x(s_g) plane with blue index b.
+static void lut_job_run(void *ctx, int b)
+{
+    struct lut_job *job = ctx;
+    int s_r = job->s_r, s_g = job->s_g, s_b = job->s_b;
+    uint16_t input[512 * 3];
+    for (int g = 0; g < s_g; g++) {
+        for (int r = 0; r < s_r; r++) {
+            input[r * 3 + 0] = r * 65535 / (s_r - 1);
+            input[r * 3 + 1] = g * 65535 / (s_g - 1);
+            input[r * 3 + 2] = b * 65535 / (s_b - 1);
+        }
+        size_t base = (b * s_r * s_g + g * s_r) * 3;
+        cmsDoTransform(job->trafo, input, job->output + base, s_r);
+    }
+}
+
 struct lut3d *mp_load_icc(struct mp_icc_opts *opts, struct mp_log *log,
                           struct mpv_global *global)
 {
@@ -139,11 +190,13 @@ struct lut3d *mp_load_icc(struct mp_icc_opts *opts, struct mp_log *log,
         talloc_asprintf(tmp, "intent=%d, size=%dx%dx%d, gamma=2.4, prim=bt2020\n",
                         opts->intent, s_r, s_g, s_b);
 
+    char *cache_file = get_cache_file(tmp, opts, global, cache_info, iccdata);
+
     // check cache
-    if (opts->cache) {
+    if (cache_file && (opts->cache || mp_path_exists(cache_file))) {
         mp_msg(log, MSGL_INFO, "Opening 3D LUT cache in file '%s'.\n",
-                   opts->cache);
-        struct bstr cachedata = load_file(tmp, opts->cache, global);
+                   cache_file);
+        struct bstr cachedata = load_file(tmp, cache_file, global);
         if (bstr_eatstart(&cachedata, bstr0(LUT3D_CACHE_HEADER))
             && bstr_eatstart(&cachedata, bstr0(cache_info))
             && bstr_eatstart(&cachedata, iccdata)
@@ -185,39 +238,32 @@ struct lut3d *mp_load_icc(struct mp_icc_opts *opts, struct mp_log *log,
     cmsHTRANSFORM trafo = cmsCreateTransformTHR(cms, vid_profile, TYPE_RGB_16,
                                                 profile, TYPE_RGB_16,
                                                 opts->intent,
-                                                cmsFLAGS_HIGHRESPRECALC);
+                                                cmsFLAGS_HIGHRESPRECALC |
+                                                cmsFLAGS_NOCACHE);
     cmsCloseProfile(profile);
     cmsCloseProfile(vid_profile);
 
     if (!trafo)
         goto error_exit;
 
-    // transform a (s_r)x(s_g)x(s_b) cube, with 3 components per channel
-    uint16_t *input = talloc_array(tmp, uint16_t, s_r * 3);
-    for (int b = 0; b < s_b; b++) {
-        for (int g = 0; g < s_g; g++) {
-            for (int r = 0; r < s_r; r++) {
-                input[r * 3 + 0] = r * 65535 / (s_r - 1);
-                input[r * 3 + 1] = g * 65535 / (s_g - 1);
-                input[r * 3 + 2] = b * 65535 / (s_b - 1);
-            }
-            size_t base = (b * s_r * s_g + g * s_r) * 3;
-            cmsDoTransform(trafo, input, output + base, s_r);
-        }
-    }
+    // transform a (s_r)x(s_g)x(s_b) cube, with 3 components per channel,
+    // one job per blue plane (the transform is shared; it has no cache)
+    struct lut_job job = {trafo, output, s_r, s_g, s_b};
+    struct mp_thread_pool *pool = mp_thread_pool_get_shared(tmp);
+    mp_thread_pool_run(pool, s_b, lut_job_run, &job);
 
     cmsDeleteTransform(trafo);
 
-    if (opts->cache) {
-        char *fname = mp_get_user_path(NULL, global, opts->cache);
-        FILE *out = fopen(fname, "wb");
+    if (cache_file) {
+        if (!opts->cache)
+            mp_mkdirp(mp_get_user_path(tmp, global, opts->cache_dir));
+        FILE *out = fopen(cache_file, "wb");
         if (out) {
             fprintf(out, "%s%s", LUT3D_CACHE_HEADER, cache_info);
             fwrite(iccdata.start, iccdata.len, 1, out);
             fwrite(output, talloc_get_size(output), 1, out);
             fclose(out);
         }
-        talloc_free(fname);
     }
 
 done: ;
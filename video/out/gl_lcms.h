@@ -9,6 +9,7 @@ struct mp_icc_opts {
     char *profile;
     int profile_auto;
     char *cache;
+    char *cache_dir;
     char *size_str;
     int intent;
 };
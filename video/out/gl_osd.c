@@ -155,6 +155,32 @@ static void upload_tex(struct mpgl_osd *ctx, struct mpgl_osd_part *osd,
     }
 }
 
+// Upload the bitmaps that were newly placed by packer_pack_incremental().
+static void upload_changed(struct mpgl_osd *ctx, struct mpgl_osd_part *osd,
+                           struct sub_bitmaps *imgs)
+{
+    struct osd_fmt_entry fmt = ctx->fmt_table[imgs->format];
+    int pad = osd->packer->padding;
+    for (int n = 0; n < osd->packer->count; n++) {
+        if (!osd->packer->changed[n])
+            continue;
+        struct sub_bitmap *s = &imgs->parts[n];
+        struct pos p = osd->packer->result[n];
+
+        if (pad) {
+            // The left/top neighbours may be stale data in free space; they
+            // are sampled by the filter too.
+            int x0 = FFMAX(p.x - pad, 0), y0 = FFMAX(p.y - pad, 0);
+            int x1 = FFMIN(p.x + s->w + pad, osd->w);
+            int y1 = FFMIN(p.y + s->h + pad, osd->h);
+            glClearTex(ctx->gl, GL_TEXTURE_2D, fmt.format, fmt.type,
+                       x0, y0, x1 - x0, y1 - y0, 0, &ctx->scratch);
+        }
+        glUploadTex(ctx->gl, GL_TEXTURE_2D, fmt.format, fmt.type,
+                    s->bitmap, s->stride, p.x, p.y, s->w, s->h, 0);
+    }
+}
+
 static bool upload_osd(struct mpgl_osd *ctx, struct mpgl_osd_part *osd,
                        struct sub_bitmaps *imgs)
 {
@@ -162,7 +188,8 @@ static bool upload_osd(struct mpgl_osd *ctx, struct mpgl_osd_part *osd,
 
     // assume 2x2 filter on scaling
     osd->packer->padding = ctx->scaled || imgs->scaled;
-    int r = packer_pack_from_subbitmaps(osd->packer, imgs);
+    // Bitmaps that are already in the texture keep their place.
+    int r = packer_pack_incremental(osd->packer, imgs);
     if (r < 0) {
         MP_ERR(ctx, "OSD bitmaps do not fit on a surface with the maximum "
                "supported size %dx%d.\n", osd->packer->w_max, osd->packer->h_max);
@@ -195,13 +222,20 @@ static bool upload_osd(struct mpgl_osd *ctx, struct mpgl_osd_part *osd,
         if (gl->DeleteBuffers)
             gl->DeleteBuffers(1, &osd->buffer);
         osd->buffer = 0;
+        // Note that the packer repacks everything on format changes, so all
+        // bitmaps are marked as changed.
     }
 
-    bool uploaded = false;
-    if (ctx->use_pbo)
-        uploaded = upload_pbo(ctx, osd, imgs);
-    if (!uploaded)
-        upload_tex(ctx, osd, imgs);
+    if (r > 0) {
+        // Everything was repacked into a bigger surface; upload it in one go.
+        bool uploaded = false;
+        if (ctx->use_pbo)
+            uploaded = upload_pbo(ctx, osd, imgs);
+        if (!uploaded)
+            upload_tex(ctx, osd, imgs);
+    } else {
+        upload_changed(ctx, osd, imgs);
+    }
 
     gl->BindTexture(GL_TEXTURE_2D, 0);
 
@@ -31,6 +31,8 @@
 #include "gl_video.h"
 
 #include "misc/bstr.h"
+#include "options/path.h"
+#include "stream/stream.h"
 #include "gl_common.h"
 #include "gl_osd.h"
 #include "filter_kernels.h"
@@ -38,6 +40,7 @@
 #include "video/memcpy_pic.h"
 #include "bitmap_packer.h"
 #include "dither.h"
+#include "vo.h"
 
 static const char vo_opengl_shaders[] =
 // Generated from gl_video_shaders.glsl
@@ -99,6 +102,10 @@ struct vertex {
 // (GL_QUAD is deprecated, strips can't be used with OSD image lists)
 #define VERTICES_PER_QUAD 6
 
+// Number of PBOs per plane, used in turn, so that copying a frame into a PBO
+// doesn't have to wait for the GPU to finish uploading the previous frame.
+#define NUM_PBO_BUFFERS 3
+
 struct texplane {
     int w, h;
     int tex_w, tex_h;
@@ -106,15 +113,78 @@ struct texplane {
     GLenum gl_format;
     GLenum gl_type;
     GLuint gl_texture;
-    int gl_buffer;
-    int buffer_size;
-    void *buffer_ptr;
+    GLuint prev_texture;        // previous image, for temporal deinterlacing
+    GLuint gl_buffers[NUM_PBO_BUFFERS];
+    int buffer_size[NUM_PBO_BUFFERS];
+    void *buffer_ptr;           // mapped gl_buffers[video_image.pbo_index]
 };
 
 struct video_image {
     struct texplane planes[4];
     bool image_flipped;
+    int fields;                 // mp_image.fields of the current image
     struct mp_image *hwimage;   // if hw decoding is active
+    struct mp_image *mpi;       // reference to the uploaded image (for
+                                // screenshots without texture readback)
+    int pbo_index;              // gl_buffers[] entry used for the next upload
+    GLsync pbo_fences[NUM_PBO_BUFFERS]; // pending uploads from gl_buffers[]
+};
+
+// Persistently mapped PBO the decoder renders into (see gl_video_get_image()).
+struct dr_buffer {
+    GLuint pbo;
+    size_t size;
+    uint8_t *ptr;
+    GLsync fence;               // set after upload, until the GPU is done
+    bool in_use;                // referenced by a mp_image
+    bool orphaned;              // gl_video was destroyed while in use
+};
+
+// Render passes measured with GPU timer queries (see timer_begin()).
+enum pass_id {
+    PASS_UPLOAD,
+    PASS_DEINT,
+    PASS_INDIRECT,
+    PASS_DEBAND,
+    PASS_SCALE_SEP,
+    PASS_FINAL,
+    PASS_BLEND,
+    PASS_OSD,
+    PASS_COUNT
+};
+
+static const char *const pass_names[PASS_COUNT] = {
+    [PASS_UPLOAD]       = "upload",
+    [PASS_DEINT]        = "deint",
+    [PASS_INDIRECT]     = "indirect",
+    [PASS_DEBAND]       = "deband",
+    [PASS_SCALE_SEP]    = "scale-sep",
+    [PASS_FINAL]        = "final",
+    [PASS_BLEND]        = "blend",
+    [PASS_OSD]          = "osd",
+};
+
+// Several queries per pass are in flight, so that results can be read back
+// a few frames later without waiting for the GPU.
+#define NUM_TIMER_QUERIES 4
+// Number of results the average and peak values are computed from.
+#define NUM_TIMER_SAMPLES 64
+
+struct pass_timer {
+    GLuint queries[NUM_TIMER_QUERIES];
+    bool pending[NUM_TIMER_QUERIES];    // query ended, result not read yet
+    int query_idx;                      // queries[] entry used next
+    uint64_t samples[NUM_TIMER_SAMPLES];// ring buffer of results (ns)
+    int sample_idx;                     // samples[] entry written next
+    int num_samples;
+    uint64_t last;
+};
+
+// Linked program, looked up by its full source (see create_program()).
+struct program_cache_entry {
+    char *key;
+    GLuint program;
+    unsigned int last_use;
 };
 
 struct scaler {
@@ -140,24 +210,39 @@ struct gl_video {
     GL *gl;
 
     struct mp_log *log;
+    struct mpv_global *global;
     struct gl_video_opts opts;
+    struct gl_video_opts user_opts;     // opts before applying quality_drop
+    int quality_drop;                   // see gl_video_set_quality_drop()
     bool gl_debug;
 
     int depth_g;
 
     GLenum gl_target; // texture target (GL_TEXTURE_2D, ...) for video and FBOs
 
+    GLuint output_fbo; // FBO the final output is rendered to (0: backbuffer)
+
     GLuint vertex_buffer;
     GLuint vao;
 
+    // All programs are owned by program_cache.
     GLuint osd_programs[SUBBITMAP_COUNT];
     GLuint indirect_program, scale_sep_program, final_program;
+    GLuint scale_sep_compute;   // optional replacement for scale_sep_program
+    GLuint blend_program;       // for interpolation and redraws
+    GLuint deint_program;
+    GLuint deband_program;      // runs on the output of indirect_program
+
+    struct program_cache_entry *program_cache;
+    int num_program_cache;
+    unsigned int program_cache_use;
 
     struct osd_state *osd_state;
     struct mpgl_osd *osd;
     double osd_pts;
 
     GLuint lut_3d_texture;
+    bool lut_3d_loaded;                 // lut_3d_texture is valid
     bool use_lut_3d;
 
     GLuint dither_texture;
@@ -186,9 +271,29 @@ struct gl_video {
     struct video_image image;
     bool have_image;
 
+    struct dr_buffer **dr_buffers;
+    int num_dr_buffers;
+
     struct fbotex indirect_fbo;         // RGB target
+    struct fbotex deband_fbo;           // indirect_fbo after debanding
     struct fbotex scale_sep_fbo;        // first pass when doing 2 pass scaling
 
+    // With interpolation, the last 2 frames rendered at window size
+    struct fbotex output_fbos[2];
+    bool output_valid[2];
+    int output_cur;                     // index of the newest frame
+    bool output_new;                    // new image since last render
+
+    // Video rendered on redraws, so that OSD-only redraws can reuse it
+    struct fbotex redraw_fbo;
+    bool output_cached;                 // last rendered video is in an FBO
+
+    // Deinterlacing (see deint_planes())
+    bool deint;                         // enabled by gl_video_set_deinterlace()
+    struct fbotex deint_fbos[4];        // deinterlaced planes
+    bool deint_have_prev;               // planes[].prev_texture is valid
+    int deint_field;                    // 0: first field, 1: second field
+
     // state for luma (0) and chroma (1) scalers
     struct scaler scalers[2];
 
@@ -198,6 +303,11 @@ struct gl_video {
     // Source and destination color spaces for the CMS matrix
     struct mp_csp_primaries csp_src, csp_dest;
 
+    // Computed once by update_all_uniforms(), shared by all programs
+    float colormatrix[3][4];
+    float cms_matrix[3][3];
+    float inv_gamma[3];
+
     struct mp_rect src_rect;    // displayed part of the source video
     struct mp_rect src_rect_rot;// compensated for optional rotation
     struct mp_rect dst_rect;    // video rectangle on output window
@@ -206,6 +316,9 @@ struct gl_video {
 
     int frames_rendered;
 
+    struct pass_timer timers[PASS_COUNT];
+    int active_timer;                   // running query, or -1
+
     // Cached because computing it can take relatively long
     int last_dither_matrix_size;
     float *last_dither_matrix;
@@ -291,6 +404,10 @@ static const struct gl_video_opts gl_video_opts_def = {
     .scaler_params = {{NAN, NAN}, {NAN, NAN}},
     .scaler_radius = {NAN, NAN},
     .alpha_mode = 2,
+    .deband_iterations = 4,
+    .deband_threshold = 64,
+    .deband_range = 16,
+    .deband_grain = 48,
 };
 
 const struct gl_video_opts gl_video_opts_hq_def = {
@@ -303,6 +420,10 @@ const struct gl_video_opts gl_video_opts_hq_def = {
     .scaler_params = {{NAN, NAN}, {NAN, NAN}},
     .scaler_radius = {NAN, NAN},
     .alpha_mode = 2,
+    .deband_iterations = 4,
+    .deband_threshold = 64,
+    .deband_range = 16,
+    .deband_grain = 48,
 };
 
 static int validate_scaler_opt(struct mp_log *log, const m_option_t *opt,
@@ -317,6 +438,7 @@ const struct m_sub_options gl_video_conf = {
         OPT_FLAG("approx-gamma", approx_gamma, 0),
         OPT_FLAG("npot", npot, 0),
         OPT_FLAG("pbo", pbo, 0),
+        OPT_STRING("shader-cache-dir", shader_cache_dir, 0),
         OPT_CHOICE("stereo", stereo_mode, 0,
                    ({"no", 0},
                     {"red-cyan",        GL_3D_RED_CYAN},
@@ -334,6 +456,8 @@ const struct m_sub_options gl_video_conf = {
         OPT_FLAG("fancy-downscaling", fancy_downscaling, 0),
         OPT_FLAG("indirect", indirect, 0),
         OPT_FLAG("scale-sep", scale_sep, 0),
+        OPT_FLAG("scale-sep-compute", scale_sep_compute, 0),
+        OPT_FLAG("interpolation", interpolation, 0),
         OPT_CHOICE("fbo-format", fbo_format, 0,
                    ({"rgb",    GL_RGB},
                     {"rgba",   GL_RGBA},
@@ -362,6 +486,15 @@ const struct m_sub_options gl_video_conf = {
                     {"yes", 1}, {"", 1},
                     {"blend", 2})),
         OPT_FLAG("rectangle-textures", use_rectangle, 0),
+        OPT_CHOICE("deint", deint, 0,
+                   ({"no", 0},
+                    {"bob", 1},
+                    {"yadif", 2})),
+        OPT_FLAG("deband", deband, 0),
+        OPT_INTRANGE("deband-iterations", deband_iterations, 0, 1, 16),
+        OPT_FLOATRANGE("deband-threshold", deband_threshold, 0, 0.0, 4096.0),
+        OPT_FLOATRANGE("deband-range", deband_range, 0, 1.0, 64.0),
+        OPT_FLOATRANGE("deband-grain", deband_grain, 0, 0.0, 4096.0),
         {0}
     },
     .size = sizeof(struct gl_video_opts),
@@ -371,6 +504,7 @@ const struct m_sub_options gl_video_conf = {
 static void uninit_rendering(struct gl_video *p);
 static void delete_shaders(struct gl_video *p);
 static void check_gl_features(struct gl_video *p);
+static void apply_options(struct gl_video *p);
 static bool init_format(int fmt, struct gl_video *init);
 
 
@@ -388,11 +522,128 @@ static void debug_check_gl(struct gl_video *p, const char *msg)
         glCheckError(p->gl, p->log, msg);
 }
 
+// Render the final output to the given FBO instead of the default
+// framebuffer. Used when embedding into a foreign GL context.
+void gl_video_set_output_fbo(struct gl_video *p, GLuint fbo)
+{
+    p->output_fbo = fbo;
+}
+
 void gl_video_set_debug(struct gl_video *p, bool enable)
 {
     p->gl_debug = enable;
 }
 
+static void timer_add_sample(struct pass_timer *t, uint64_t ns)
+{
+    t->last = ns;
+    t->samples[t->sample_idx] = ns;
+    t->sample_idx = (t->sample_idx + 1) % NUM_TIMER_SAMPLES;
+    t->num_samples = MPMIN(t->num_samples + 1, NUM_TIMER_SAMPLES);
+}
+
+// Start measuring the GPU time of the given pass. Only one pass can be
+// measured at a time (GL doesn't allow nesting GL_TIME_ELAPSED queries).
+static void timer_begin(struct gl_video *p, enum pass_id id)
+{
+    GL *gl = p->gl;
+
+    if (!(gl->mpgl_caps & MPGL_CAP_TIMER) || p->active_timer >= 0)
+        return;
+
+    struct pass_timer *t = &p->timers[id];
+    if (!t->queries[0])
+        gl->GenQueries(NUM_TIMER_QUERIES, t->queries);
+
+    // Collect the result of the query that is about to be reused. If the GPU
+    // is still not done with it, drop the result instead of stalling.
+    int idx = t->query_idx;
+    if (t->pending[idx]) {
+        GLint available = 0;
+        gl->GetQueryObjectiv(t->queries[idx], GL_QUERY_RESULT_AVAILABLE,
+                             &available);
+        if (available) {
+            GLuint64 ns = 0;
+            gl->GetQueryObjectui64v(t->queries[idx], GL_QUERY_RESULT, &ns);
+            timer_add_sample(t, ns);
+        }
+        t->pending[idx] = false;
+    }
+
+    gl->BeginQuery(GL_TIME_ELAPSED, t->queries[idx]);
+    p->active_timer = id;
+}
+
+static void timer_end(struct gl_video *p, enum pass_id id)
+{
+    GL *gl = p->gl;
+
+    if (p->active_timer != id)
+        return;
+
+    struct pass_timer *t = &p->timers[id];
+    gl->EndQuery(GL_TIME_ELAPSED);
+    t->pending[t->query_idx] = true;
+    t->query_idx = (t->query_idx + 1) % NUM_TIMER_QUERIES;
+    p->active_timer = -1;
+}
+
+// Forget all measurements, e.g. because the set of passes changed.
+static void reset_timers(struct gl_video *p)
+{
+    for (int n = 0; n < PASS_COUNT; n++) {
+        struct pass_timer *t = &p->timers[n];
+        for (int i = 0; i < NUM_TIMER_QUERIES; i++)
+            t->pending[i] = false;
+        t->num_samples = 0;
+        t->sample_idx = 0;
+        t->last = 0;
+    }
+}
+
+static void uninit_timers(struct gl_video *p)
+{
+    GL *gl = p->gl;
+
+    for (int n = 0; n < PASS_COUNT; n++) {
+        struct pass_timer *t = &p->timers[n];
+        if (t->queries[0])
+            gl->DeleteQueries(NUM_TIMER_QUERIES, t->queries);
+        *t = (struct pass_timer){0};
+    }
+}
+
+// Return the GPU time used by each render pass. Only passes which actually
+// ran recently are listed. Returns false if timer queries are unavailable.
+// This doesn't call any GL functions.
+bool gl_video_get_pass_timings(struct gl_video *p,
+                               struct voctrl_pass_timings *out)
+{
+    *out = (struct voctrl_pass_timings){0};
+
+    if (!(p->gl->mpgl_caps & MPGL_CAP_TIMER))
+        return false;
+
+    for (int n = 0; n < PASS_COUNT; n++) {
+        struct pass_timer *t = &p->timers[n];
+        if (!t->num_samples || out->num_passes >= VO_MAX_PASS_TIMINGS)
+            continue;
+        uint64_t sum = 0, peak = 0;
+        for (int i = 0; i < t->num_samples; i++) {
+            sum += t->samples[i];
+            peak = MPMAX(peak, t->samples[i]);
+        }
+        out->passes[out->num_passes++] = (struct voctrl_pass_timing){
+            .name = pass_names[n],
+            .last_ns = t->last,
+            .avg_ns = sum / t->num_samples,
+            .peak_ns = peak,
+        };
+    }
+
+    return true;
+}
+
 static void texture_size(struct gl_video *p, int w, int h, int *texw, int *texh)
 {
     if (p->opts.npot) {
@@ -516,7 +767,7 @@ static bool fbotex_init(struct gl_video *p, struct fbotex *fbo, int w, int h,
         res = false;
     }
 
-    gl->BindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl->BindFramebuffer(GL_FRAMEBUFFER, p->output_fbo);
 
     debug_check_gl(p, "after creating framebuffer & associated texture");
 
@@ -555,23 +806,6 @@ static void update_uniforms(struct gl_video *p, GLuint program)
 
     gl->UseProgram(program);
 
-    struct mp_csp_details csp = MP_CSP_DETAILS_DEFAULTS;
-    csp.levels_in = p->image_params.colorlevels;
-    csp.levels_out = p->image_params.outputlevels;
-    csp.format = p->image_params.colorspace;
-
-    struct mp_csp_params cparams = {
-        .colorspace = csp,
-        .input_bits = p->plane_bits,
-        .texture_bits = (p->plane_bits + 7) & ~7,
-    };
-    mp_csp_copy_equalizer_values(&cparams, &p->video_eq);
-    if (p->image_desc.flags & MP_IMGFLAG_XYZ) {
-        cparams.colorspace.format = MP_CSP_XYZ;
-        cparams.input_bits = 8;
-        cparams.texture_bits = 8;
-    }
-
     loc = gl->GetUniformLocation(program, "transform");
     if (loc >= 0 && p->vp_w > 0 && p->vp_h > 0) {
         float matrix[3][3];
@@ -580,19 +814,8 @@ static void update_uniforms(struct gl_video *p, GLuint program)
     }
 
     loc = gl->GetUniformLocation(program, "colormatrix");
-    if (loc >= 0) {
-        float m[3][4] = {{0}};
-        if (p->image_desc.flags & MP_IMGFLAG_XYZ) {
-            // Hard-coded as relative colorimetric for now, since this transforms
-            // from the source file's D55 material to whatever color space our
-            // projector/display lives in, which should be D55 for a proper
-            // home cinema setup either way.
-            mp_get_xyz2rgb_coeffs(&cparams, p->csp_src, MP_INTENT_RELATIVE_COLORIMETRIC, m);
-        } else {
-            mp_get_yuv2rgb_coeffs(&cparams, m);
-        }
-        gl->UniformMatrix4x3fv(loc, 1, GL_TRUE, &m[0][0]);
-    }
+    if (loc >= 0)
+        gl->UniformMatrix4x3fv(loc, 1, GL_TRUE, &p->colormatrix[0][0]);
 
     gl->Uniform1f(gl->GetUniformLocation(program, "input_gamma"),
                   p->input_gamma);
@@ -600,11 +823,8 @@ static void update_uniforms(struct gl_video *p, GLuint program)
     gl->Uniform1f(gl->GetUniformLocation(program, "conv_gamma"),
                   p->conv_gamma);
 
-    float gamma = p->opts.gamma ? p->opts.gamma : 1.0;
     gl->Uniform3f(gl->GetUniformLocation(program, "inv_gamma"),
-                  1.0 / (cparams.rgamma * gamma),
-                  1.0 / (cparams.ggamma * gamma),
-                  1.0 / (cparams.bgamma * gamma));
+                  p->inv_gamma[0], p->inv_gamma[1], p->inv_gamma[2]);
 
     for (int n = 0; n < p->plane_count; n++) {
         char textures_n[32];
@@ -657,14 +877,8 @@ static void update_uniforms(struct gl_video *p, GLuint program)
     gl->Uniform1i(gl->GetUniformLocation(program, "lut_3d"), TEXUNIT_3DLUT);
 
     loc = gl->GetUniformLocation(program, "cms_matrix");
-    if (loc >= 0) {
-        float cms_matrix[3][3] = {{0}};
-        // Hard-coded to relative colorimetric - for a BT.2020 3DLUT we expect
-        // the input to be actual BT.2020 and not something red- or blueshifted,
-        // and for sRGB monitors we most likely want relative scaling either way.
-        mp_get_cms_matrix(p->csp_src, p->csp_dest, MP_INTENT_RELATIVE_COLORIMETRIC, cms_matrix);
-        gl->UniformMatrix3fv(loc, 1, GL_TRUE, &cms_matrix[0][0]);
-    }
+    if (loc >= 0)
+        gl->UniformMatrix3fv(loc, 1, GL_TRUE, &p->cms_matrix[0][0]);
 
     for (int n = 0; n < 2; n++) {
         const char *lut = p->scalers[n].lut_name;
@@ -673,6 +887,13 @@ static void update_uniforms(struct gl_video *p, GLuint program)
                           TEXUNIT_SCALERS + n);
     }
 
+    gl->Uniform1f(gl->GetUniformLocation(program, "deband_threshold"),
+                  p->opts.deband_threshold / 16384.0);
+    gl->Uniform1f(gl->GetUniformLocation(program, "deband_range"),
+                  p->opts.deband_range);
+    gl->Uniform1f(gl->GetUniformLocation(program, "deband_grain"),
+                  p->opts.deband_grain / 8192.0);
+
     gl->Uniform1i(gl->GetUniformLocation(program, "dither"), TEXUNIT_DITHER);
     gl->Uniform1f(gl->GetUniformLocation(program, "dither_quantization"),
                   p->dither_quantization);
@@ -691,13 +912,66 @@ static void update_uniforms(struct gl_video *p, GLuint program)
     debug_check_gl(p, "update_uniforms()");
 }
 
+// Compute the color conversion matrices and gamma values used by the programs.
+static void update_color_matrices(struct gl_video *p)
+{
+    struct mp_csp_details csp = MP_CSP_DETAILS_DEFAULTS;
+    csp.levels_in = p->image_params.colorlevels;
+    csp.levels_out = p->image_params.outputlevels;
+    csp.format = p->image_params.colorspace;
+
+    struct mp_csp_params cparams = {
+        .colorspace = csp,
+        .input_bits = p->plane_bits,
+        .texture_bits = (p->plane_bits + 7) & ~7,
+    };
+    mp_csp_copy_equalizer_values(&cparams, &p->video_eq);
+    if (p->image_desc.flags & MP_IMGFLAG_XYZ) {
+        cparams.colorspace.format = MP_CSP_XYZ;
+        cparams.input_bits = 8;
+        cparams.texture_bits = 8;
+    }
+
+    memset(p->colormatrix, 0, sizeof(p->colormatrix));
+    if (p->image_desc.flags & MP_IMGFLAG_XYZ) {
+        // Hard-coded as relative colorimetric for now, since this transforms
+        // from the source file's D55 material to whatever color space our
+        // projector/display lives in, which should be D55 for a proper
+        // home cinema setup either way.
+        mp_get_xyz2rgb_coeffs(&cparams, p->csp_src,
+                              MP_INTENT_RELATIVE_COLORIMETRIC, p->colormatrix);
+    } else {
+        mp_get_yuv2rgb_coeffs(&cparams, p->colormatrix);
+    }
+
+    // Hard-coded to relative colorimetric - for a BT.2020 3DLUT we expect
+    // the input to be actual BT.2020 and not something red- or blueshifted,
+    // and for sRGB monitors we most likely want relative scaling either way.
+    memset(p->cms_matrix, 0, sizeof(p->cms_matrix));
+    mp_get_cms_matrix(p->csp_src, p->csp_dest, MP_INTENT_RELATIVE_COLORIMETRIC,
+                      p->cms_matrix);
+
+    float gamma = p->opts.gamma ? p->opts.gamma : 1.0;
+    p->inv_gamma[0] = 1.0 / (cparams.rgamma * gamma);
+    p->inv_gamma[1] = 1.0 / (cparams.ggamma * gamma);
+    p->inv_gamma[2] = 1.0 / (cparams.bgamma * gamma);
+}
+
 static void update_all_uniforms(struct gl_video *p)
 {
+    update_color_matrices(p);
+
     for (int n = 0; n < SUBBITMAP_COUNT; n++)
         update_uniforms(p, p->osd_programs[n]);
     update_uniforms(p, p->indirect_program);
     update_uniforms(p, p->scale_sep_program);
+    update_uniforms(p, p->scale_sep_compute);
     update_uniforms(p, p->final_program);
+    update_uniforms(p, p->blend_program);
+    update_uniforms(p, p->deint_program);
+    update_uniforms(p, p->deband_program);
+
+    p->output_cached = false;
 }
 
 #define SECTION_HEADER "#!section "
@@ -740,7 +1014,8 @@ static GLuint create_shader(struct gl_video *p, GLenum type, const char *header,
     gl->GetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
 
     int pri = status ? (log_length > 1 ? MSGL_V : MSGL_DEBUG) : MSGL_ERR;
-    const char *typestr = type == GL_VERTEX_SHADER ? "vertex" : "fragment";
+    const char *typestr = type == GL_VERTEX_SHADER ? "vertex" :
+                          type == GL_COMPUTE_SHADER ? "compute" : "fragment";
     if (mp_msg_test(p->log, pri)) {
         MP_MSG(p, pri, "%s shader source:\n", typestr);
         mp_log_source(p->log, pri, full_source);
@@ -793,23 +1068,198 @@ static void bind_attrib_locs(GL *gl, GLuint program)
 
 #define PRELUDE_END "// -- prelude end\n"
 
+// Work group size of the compute shader scaler.
+#define COMPUTE_GROUP_W 32
+#define COMPUTE_GROUP_H 8
+
+// Maximum number of linked programs kept around (they're small).
+#define PROGRAM_CACHE_SIZE 32
+
+#define PROGRAM_CACHE_HEADER "mpv shader cache 1.0\n"
+
+static bool use_program_binary(struct gl_video *p)
+{
+    return p->opts.shader_cache_dir && p->opts.shader_cache_dir[0] &&
+           (p->gl->mpgl_caps & MPGL_CAP_PROGRAM_BINARY);
+}
+
+// Binaries are valid only for the driver they were created with.
+static char *program_cache_info(struct gl_video *p, void *ta_ctx)
+{
+    GL *gl = p->gl;
+    return talloc_asprintf(ta_ctx, "%s\n%s\n", gl->GetString(GL_RENDERER),
+                           gl->GetString(GL_VERSION));
+}
+
+static char *program_cache_file(struct gl_video *p, void *ta_ctx,
+                                const char *key)
+{
+    // FNV-1a; collisions are caught by comparing the stored source.
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *s = key; *s; s++)
+        hash = (hash ^ (unsigned char)*s) * 1099511628211ULL;
+    char *dir = mp_get_user_path(ta_ctx, p->global, p->opts.shader_cache_dir);
+    char *name = talloc_asprintf(ta_ctx, "%016"PRIx64".bin", hash);
+    return mp_path_join(ta_ctx, bstr0(dir), bstr0(name));
+}
+
+static GLuint load_program_binary(struct gl_video *p, const char *key)
+{
+    GL *gl = p->gl;
+    GLuint prog = 0;
+
+    if (!use_program_binary(p))
+        return 0;
+
+    void *tmp = talloc_new(NULL);
+    char *fname = program_cache_file(p, tmp, key);
+    struct bstr data = {0};
+    if (mp_path_exists(fname)) {
+        stream_t *s = stream_open(fname, p->global);
+        if (s) {
+            data = stream_read_complete(s, tmp, 1000000000);
+            free_stream(s);
+        }
+    }
+
+    uint32_t format;
+    if (bstr_eatstart0(&data, PROGRAM_CACHE_HEADER) &&
+        bstr_eatstart0(&data, program_cache_info(p, tmp)) &&
+        bstr_eatstart(&data, (struct bstr){(char *)key, strlen(key) + 1}) &&
+        data.len > sizeof(format))
+    {
+        memcpy(&format, data.start, sizeof(format));
+        data = bstr_cut(data, sizeof(format));
+        prog = gl->CreateProgram();
+        gl->ProgramBinary(prog, format, data.start, data.len);
+        GLint status = 0;
+        gl->GetProgramiv(prog, GL_LINK_STATUS, &status);
+        if (status) {
+            MP_VERBOSE(p, "Loaded shader program from '%s'.\n", fname);
+        } else {
+            MP_VERBOSE(p, "Shader cache file '%s' rejected.\n", fname);
+            gl->DeleteProgram(prog);
+            prog = 0;
+        }
+    }
+
+    talloc_free(tmp);
+    return prog;
+}
+
+static void save_program_binary(struct gl_video *p, const char *key,
+                                GLuint prog)
+{
+    GL *gl = p->gl;
+
+    if (!use_program_binary(p))
+        return;
+
+    GLint status = 0, size = 0;
+    gl->GetProgramiv(prog, GL_LINK_STATUS, &status);
+    gl->GetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (!status || size <= 0)
+        return;
+
+    void *tmp = talloc_new(NULL);
+    void *data = talloc_size(tmp, size);
+    GLenum format = 0;
+    GLsizei len = 0;
+    gl->GetProgramBinary(prog, size, &len, &format, data);
+
+    mp_mkdirp(mp_get_user_path(tmp, p->global, p->opts.shader_cache_dir));
+    char *fname = program_cache_file(p, tmp, key);
+    FILE *out = fopen(fname, "wb");
+    if (out && len > 0) {
+        uint32_t format32 = format;
+        fprintf(out, "%s%s", PROGRAM_CACHE_HEADER, program_cache_info(p, tmp));
+        fwrite(key, strlen(key) + 1, 1, out);
+        fwrite(&format32, sizeof(format32), 1, out);
+        fwrite(data, len, 1, out);
+    }
+    if (out)
+        fclose(out);
+    talloc_free(tmp);
+}
+
+// Return a linked program for the given source. Programs are reused if the
+// same source was requested before, so changing options back and forth
+// doesn't recompile anything.
+// If vertex is NULL, frag is a compute shader.
 static GLuint create_program(struct gl_video *p, const char *name,
                              const char *header, const char *vertex,
                              const char *frag)
 {
     GL *gl = p->gl;
-    MP_VERBOSE(p, "compiling shader program '%s', header:\n", name);
-    const char *real_header = strstr(header, PRELUDE_END);
-    real_header = real_header ? real_header + strlen(PRELUDE_END) : header;
-    mp_log_source(p->log, MSGL_V, real_header);
-    GLuint prog = gl->CreateProgram();
-    prog_create_shader(p, prog, GL_VERTEX_SHADER, header, vertex);
-    prog_create_shader(p, prog, GL_FRAGMENT_SHADER, header, frag);
-    bind_attrib_locs(gl, prog);
-    link_shader(p, prog);
+
+    char *key = talloc_asprintf(NULL, "%s\n// -- vertex\n%s\n// -- frag\n%s",
+                                header, vertex ? vertex : "(compute)", frag);
+    for (int n = 0; n < p->num_program_cache; n++) {
+        struct program_cache_entry *e = &p->program_cache[n];
+        if (strcmp(e->key, key) == 0) {
+            MP_DBG(p, "reusing shader program '%s'\n", name);
+            e->last_use = ++p->program_cache_use;
+            talloc_free(key);
+            return e->program;
+        }
+    }
+
+    GLuint prog = load_program_binary(p, key);
+    if (!prog) {
+        MP_VERBOSE(p, "compiling shader program '%s', header:\n", name);
+        const char *real_header = strstr(header, PRELUDE_END);
+        real_header = real_header ? real_header + strlen(PRELUDE_END) : header;
+        mp_log_source(p->log, MSGL_V, real_header);
+        prog = gl->CreateProgram();
+        if (vertex) {
+            prog_create_shader(p, prog, GL_VERTEX_SHADER, header, vertex);
+            prog_create_shader(p, prog, GL_FRAGMENT_SHADER, header, frag);
+            bind_attrib_locs(gl, prog);
+        } else {
+            prog_create_shader(p, prog, GL_COMPUTE_SHADER, header, frag);
+        }
+        if (use_program_binary(p))
+            gl->ProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+        link_shader(p, prog);
+        save_program_binary(p, key, prog);
+    }
+
+    // Evict the least recently used program. It's never one of the programs
+    // in use, because these were all requested more recently.
+    if (p->num_program_cache >= PROGRAM_CACHE_SIZE) {
+        int old = 0;
+        for (int n = 1; n < p->num_program_cache; n++) {
+            if (p->program_cache[n].last_use < p->program_cache[old].last_use)
+                old = n;
+        }
+        gl->DeleteProgram(p->program_cache[old].program);
+        talloc_free(p->program_cache[old].key);
+        MP_TARRAY_REMOVE_AT(p->program_cache, p->num_program_cache, old);
+    }
+
+    struct program_cache_entry entry = {
+        .key = talloc_steal(p, key),
+        .program = prog,
+        .last_use = ++p->program_cache_use,
+    };
+    MP_TARRAY_APPEND(p, p->program_cache, p->num_program_cache, entry);
     return prog;
 }
 
+// Image unit format qualifier for the given FBO format, or NULL if the format
+// can't be used with image load/store.
+static const char *compute_image_format(GLenum iformat)
+{
+    switch (iformat) {
+    case GL_RGBA8:      return "rgba8";
+    case GL_RGB10_A2:   return "rgb10_a2";
+    case GL_RGBA16:     return "rgba16";
+    case GL_RGBA16F:    return "rgba16f";
+    case GL_RGBA32F:    return "rgba32f";
+    }
+    return NULL;
+}
+
 static void shader_def(char **shader, const char *name,
                        const char *value)
 {
@@ -866,7 +1316,8 @@ static void compile_shaders(struct gl_video *p)
     struct bstr src = bstr0(vo_opengl_shaders);
     char *vertex_shader = get_section(tmp, src, "vertex_all");
     char *shader_prelude = get_section(tmp, src, "prelude");
-    char *s_video = get_section(tmp, src, "frag_video");
+    char *s_weights = get_section(tmp, src, "weights");
+    char *s_video = t_concat(tmp, s_weights, get_section(tmp, src, "frag_video"));
 
     char *header = talloc_asprintf(tmp, "#version %d\n%s%s", gl->glsl_version,
                                    shader_prelude, PRELUDE_END);
@@ -1027,6 +1478,11 @@ static void compile_shaders(struct gl_video *p)
     if (header_sep && p->plane_count > 1)
         use_indirect = true;
 
+    // Debanding runs as separate pass on the RGB output of the indirect pass,
+    // before any scaling.
+    if (p->opts.deband)
+        use_indirect = true;
+
     if (input_is_subsampled(p)) {
         shader_setup_scaler(&header_conv, &p->scalers[1], -1);
     } else {
@@ -1044,6 +1500,15 @@ static void compile_shaders(struct gl_video *p)
         header_conv = t_concat(tmp, header, header_conv);
         p->indirect_program =
             create_program(p, "indirect", header_conv, vertex_shader, s_video);
+        if (p->opts.deband) {
+            char *header_deband = talloc_strdup(tmp, header);
+            shader_def_opt(&header_deband, "FIXED_SCALE", true);
+            header_deband = talloc_asprintf_append(header_deband,
+                "#define DEBAND_ITERATIONS %d\n", p->opts.deband_iterations);
+            char *s_deband = get_section(tmp, src, "frag_deband");
+            p->deband_program = create_program(p, "deband", header_deband,
+                                               vertex_shader, s_deband);
+        }
     } else if (header_sep) {
         header_sep = t_concat(tmp, header_sep, header_conv);
     } else {
@@ -1056,30 +1521,86 @@ static void compile_shaders(struct gl_video *p)
             create_program(p, "scale_sep", header_sep, vertex_shader, s_video);
     }
 
+    if (header_sep && use_indirect && p->opts.scale_sep_compute) {
+        const char *format = compute_image_format(p->opts.fbo_format);
+        if (!(gl->mpgl_caps & MPGL_CAP_COMPUTE_SHADER)) {
+            MP_VERBOSE(p, "No compute shader support, not using "
+                       "scale-sep-compute.\n");
+        } else if (p->gl_target != GL_TEXTURE_2D || !format) {
+            MP_VERBOSE(p, "scale-sep-compute requires normal textures and "
+                       "an RGBA fbo-format.\n");
+        } else {
+            struct scaler *scaler = &p->scalers[0];
+            int size = scaler->kernel->size;
+            char *header_comp = talloc_asprintf(tmp, "#version 430\n%s%s",
+                                                shader_prelude, PRELUDE_END);
+            header_comp = talloc_asprintf_append(header_comp,
+                "#define GROUP_W %d\n#define GROUP_H %d\n#define TAPS %d\n",
+                COMPUTE_GROUP_W, COMPUTE_GROUP_H, size);
+            shader_def(&header_comp, "OUT_FORMAT", format);
+            shader_def(&header_comp, "LUT_NAME", scaler->lut_name);
+            shader_def(&header_comp, "LUT_SAMPLER",
+                       size > 4 ? "sampler2D" : "sampler1D");
+            shader_def(&header_comp, "WEIGHTS_FUNC",
+                       talloc_asprintf(tmp, "weights%d", size));
+            char *s_comp = t_concat(tmp, s_weights,
+                                    get_section(tmp, src, "compute_scale_sep"));
+            p->scale_sep_compute = create_program(p, "scale_sep_compute",
+                                                  header_comp, NULL, s_comp);
+        }
+    }
+
     header_final = t_concat(tmp, header, header_final);
     p->final_program =
         create_program(p, "final", header_final, vertex_shader, s_video);
 
+    // Also used to copy the cached video on redraws.
+    if (p->opts.interpolation || (gl->mpgl_caps & MPGL_CAP_FB)) {
+        char *header_blend = talloc_strdup(tmp, header);
+        shader_def_opt(&header_blend, "FIXED_SCALE", true);
+        char *s_blend = get_section(tmp, src, "frag_blend");
+        p->blend_program =
+            create_program(p, "blend", header_blend, vertex_shader, s_blend);
+    }
+
+    if (p->opts.deint && (gl->mpgl_caps & MPGL_CAP_FB)) {
+        char *header_deint = talloc_strdup(tmp, header);
+        shader_def_opt(&header_deint, "FIXED_SCALE", true);
+        shader_def_opt(&header_deint, "USE_DEINT_TEMPORAL", p->opts.deint == 2);
+        char *s_deint = get_section(tmp, src, "frag_deint");
+        p->deint_program =
+            create_program(p, "deint", header_deint, vertex_shader, s_deint);
+    }
+
     debug_check_gl(p, "shader compilation");
 
     talloc_free(tmp);
 }
 
-static void delete_program(GL *gl, GLuint *prog)
+// The programs stay in the program cache.
+static void delete_shaders(struct gl_video *p)
 {
-    gl->DeleteProgram(*prog);
-    *prog = 0;
+    for (int n = 0; n < SUBBITMAP_COUNT; n++)
+        p->osd_programs[n] = 0;
+    p->indirect_program = 0;
+    p->scale_sep_program = 0;
+    p->scale_sep_compute = 0;
+    p->final_program = 0;
+    p->blend_program = 0;
+    p->deint_program = 0;
+    p->deband_program = 0;
 }
 
-static void delete_shaders(struct gl_video *p)
+static void clear_program_cache(struct gl_video *p)
 {
     GL *gl = p->gl;
 
-    for (int n = 0; n < SUBBITMAP_COUNT; n++)
-        delete_program(gl, &p->osd_programs[n]);
-    delete_program(gl, &p->indirect_program);
-    delete_program(gl, &p->scale_sep_program);
-    delete_program(gl, &p->final_program);
+    delete_shaders(p);
+    for (int n = 0; n < p->num_program_cache; n++) {
+        gl->DeleteProgram(p->program_cache[n].program);
+        talloc_free(p->program_cache[n].key);
+    }
+    p->num_program_cache = 0;
 }
 
 static double get_scale_factor(struct gl_video *p)
@@ -1098,7 +1619,10 @@ static bool update_scale_factor(struct gl_video *p, struct filter_kernel *kernel
     double scale = get_scale_factor(p);
     if (!p->opts.fancy_downscaling && scale < 1.0)
         scale = 1.0;
-    return mp_init_filter(kernel, filter_sizes, FFMAX(1.0, 1.0 / scale));
+    // Round up the filter widening to 1/32 steps, so that the LUT doesn't
+    // have to be recomputed for each small window size change.
+    double inv_scale = ceil(FFMAX(1.0, 1.0 / scale) * 32) / 32;
+    return mp_init_filter(kernel, filter_sizes, inv_scale);
 }
 
 static void init_scaler(struct gl_video *p, struct scaler *scaler)
@@ -1269,6 +1793,7 @@ static void reinit_rendering(struct gl_video *p)
     debug_check_gl(p, "before scaler initialization");
 
     uninit_rendering(p);
+    reset_timers(p);
 
     if (!p->image_format)
         return;
@@ -1289,6 +1814,8 @@ static void reinit_rendering(struct gl_video *p)
 
     if (p->indirect_program && !p->indirect_fbo.fbo)
         fbotex_init(p, &p->indirect_fbo, w, h, p->opts.fbo_format);
+    if (p->deband_program && !p->deband_fbo.fbo)
+        fbotex_init(p, &p->deband_fbo, w, h, p->opts.fbo_format);
 
     recreate_osd(p);
 }
@@ -1315,9 +1842,9 @@ void gl_video_set_lut3d(struct gl_video *p, struct lut3d *lut3d)
     GL *gl = p->gl;
 
     if (!lut3d) {
-        if (p->use_lut_3d) {
-            p->use_lut_3d = false;
-            reinit_rendering(p);
+        if (p->lut_3d_loaded) {
+            p->lut_3d_loaded = false;
+            apply_options(p);
         }
         return;
     }
@@ -1338,12 +1865,11 @@ void gl_video_set_lut3d(struct gl_video *p, struct lut3d *lut3d)
     gl->TexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     gl->ActiveTexture(GL_TEXTURE0);
 
-    p->use_lut_3d = true;
-    check_gl_features(p);
+    p->lut_3d_loaded = true;
 
     debug_check_gl(p, "after 3d lut creation");
 
-    reinit_rendering(p);
+    apply_options(p);
 }
 
 static void set_image_textures(struct gl_video *p, struct video_image *vimg,
@@ -1479,20 +2005,41 @@ static void uninit_video(struct gl_video *p)
 
     struct video_image *vimg = &p->image;
 
-    for (int n = 0; n < 3; n++) {
+    for (int n = 0; n < 4; n++) {
         struct texplane *plane = &vimg->planes[n];
 
         gl->DeleteTextures(1, &plane->gl_texture);
         plane->gl_texture = 0;
-        gl->DeleteBuffers(1, &plane->gl_buffer);
-        plane->gl_buffer = 0;
+        gl->DeleteTextures(1, &plane->prev_texture);
+        plane->prev_texture = 0;
+        gl->DeleteBuffers(NUM_PBO_BUFFERS, plane->gl_buffers);
+        for (int i = 0; i < NUM_PBO_BUFFERS; i++) {
+            plane->gl_buffers[i] = 0;
+            plane->buffer_size[i] = 0;
+        }
         plane->buffer_ptr = NULL;
-        plane->buffer_size = 0;
     }
+    for (int i = 0; i < NUM_PBO_BUFFERS; i++) {
+        if (vimg->pbo_fences[i])
+            gl->DeleteSync(vimg->pbo_fences[i]);
+        vimg->pbo_fences[i] = NULL;
+    }
+    vimg->pbo_index = 0;
     mp_image_unrefp(&vimg->hwimage);
+    mp_image_unrefp(&vimg->mpi);
 
     fbotex_uninit(p, &p->indirect_fbo);
+    fbotex_uninit(p, &p->deband_fbo);
     fbotex_uninit(p, &p->scale_sep_fbo);
+    for (int n = 0; n < 2; n++) {
+        fbotex_uninit(p, &p->output_fbos[n]);
+        p->output_valid[n] = false;
+    }
+    fbotex_uninit(p, &p->redraw_fbo);
+    p->output_cached = false;
+    for (int n = 0; n < 4; n++)
+        fbotex_uninit(p, &p->deint_fbos[n]);
+    p->deint_have_prev = false;
 }
 
 static void change_dither_trafo(struct gl_video *p)
@@ -1599,14 +2146,217 @@ static void handle_pass(struct gl_video *p, struct pass *chain,
     };
 }
 
+// Like handle_pass(), but run the vertical scaling pass as compute shader.
+// Returns false (and does nothing) if that's not possible; the compute shader
+// reads a bounded number of source rows, so it works for upscaling only.
+static bool compute_pass(struct gl_video *p, struct pass *chain,
+                         struct fbotex *fbo, GLuint program)
+{
+    GL *gl = p->gl;
+
+    if (!program || fbo->vp_h < 1 || chain->f.vp_h > fbo->vp_h)
+        return false;
+
+    gl->BindTexture(p->gl_target, chain->f.texture);
+    gl->UseProgram(program);
+
+    gl->Uniform2i(gl->GetUniformLocation(program, "out_size"),
+                  fbo->vp_w, fbo->vp_h);
+    gl->Uniform2f(gl->GetUniformLocation(program, "src_y"),
+                  chain->f.vp_y, chain->f.vp_h / (double)fbo->vp_h);
+
+    MP_TRACE(p, "Pass %d (compute): [%d,%d,%d,%d] -> [%dx%d]\n", chain->num,
+             chain->f.vp_x, chain->f.vp_y, chain->f.vp_w, chain->f.vp_h,
+             fbo->vp_w, fbo->vp_h);
+
+    gl->BindImageTexture(0, fbo->texture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                         p->opts.fbo_format);
+    gl->DispatchCompute((fbo->vp_w + COMPUTE_GROUP_W - 1) / COMPUTE_GROUP_W,
+                        (fbo->vp_h + COMPUTE_GROUP_H - 1) / COMPUTE_GROUP_H, 1);
+    // The next pass samples the result as normal texture.
+    gl->MemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    *chain = (struct pass){
+        .num = chain->num + 1,
+        .f = *fbo,
+    };
+    return true;
+}
+
+// Draw the mix of the prev and cur FBOs to the screen. With mix=1.0, this
+// just copies cur.
+static void blend_pass(struct gl_video *p, struct fbotex *prev,
+                       struct fbotex *cur, double mix)
+{
+    GL *gl = p->gl;
+    struct vertex vb[VERTICES_PER_QUAD];
+
+    gl->BindFramebuffer(GL_FRAMEBUFFER, p->output_fbo);
+    gl->Viewport(p->vp_x, p->vp_y, p->vp_w, p->vp_h);
+    gl->UseProgram(p->blend_program);
+    gl->Uniform1i(gl->GetUniformLocation(p->blend_program, "texture1"), 1);
+    gl->Uniform1f(gl->GetUniformLocation(p->blend_program, "blend_mix"), mix);
+
+    gl->ActiveTexture(GL_TEXTURE0 + 1);
+    gl->BindTexture(p->gl_target, cur->texture);
+    gl->ActiveTexture(GL_TEXTURE0);
+    gl->BindTexture(p->gl_target, prev->texture);
+
+    write_quad(vb, -1, -1, 1, 1, 0, 0, cur->vp_w, cur->vp_h,
+               cur->tex_w, cur->tex_h, NULL, p->gl_target, 0);
+    draw_triangles(p, vb, VERTICES_PER_QUAD);
+
+    gl->ActiveTexture(GL_TEXTURE0 + 1);
+    gl->BindTexture(p->gl_target, 0);
+    gl->ActiveTexture(GL_TEXTURE0);
+    gl->BindTexture(p->gl_target, 0);
+}
+
+// Whether deint_planes() is used on the current image.
+static bool deint_active(struct gl_video *p)
+{
+    // Packed YUV is converted by the texture sampler, and GL_SRGB textures
+    // would be linearized by the copy.
+    return p->deint && p->deint_program && !p->hwdec_active &&
+           !p->is_packed_yuv && p->image.planes[0].gl_internal_format != GL_SRGB;
+}
+
+// Deinterlace each plane of the current image into p->deint_fbos, and replace
+// the textures in imgtex[] with the results. Which field is output depends on
+// the field order and p->deint_field. The missing lines are interpolated from
+// the field's own lines ("bob"), or, with the yadif mode, from the previous
+// image where there is no motion.
+static void deint_planes(struct gl_video *p, GLuint imgtex[4])
+{
+    GL *gl = p->gl;
+    struct video_image *vimg = &p->image;
+    GLuint program = p->deint_program;
+    GLenum iformat = p->plane_bits > 8 ? GL_RGBA16 : GL_RGBA;
+
+    bool tff = !(vimg->fields & MP_IMGFIELD_ORDERED) ||
+               (vimg->fields & MP_IMGFIELD_TOP_FIRST);
+    bool temporal = p->opts.deint == 2 && p->deint_have_prev;
+
+    for (int n = 0; n < p->plane_count; n++) {
+        struct texplane *plane = &vimg->planes[n];
+        struct fbotex *fbo = &p->deint_fbos[n];
+
+        if (fbo->vp_w != plane->w || fbo->vp_h != plane->h) {
+            fbotex_uninit(p, fbo);
+            if (!fbotex_init(p, fbo, plane->w, plane->h, iformat)) {
+                fbotex_uninit(p, fbo);
+                MP_ERR(p, "Deinterlacing disabled.\n");
+                p->deint = false;
+                return;
+            }
+        }
+
+        // Line 0 of the texture is the bottom line if the image is flipped.
+        int top = vimg->image_flipped ? (plane->h - 1) % 2 : 0;
+        int field = tff == (p->deint_field == 0) ? top : !top;
+
+        gl->UseProgram(program);
+        gl->Uniform1i(gl->GetUniformLocation(program, "texture1"), 1);
+        gl->Uniform1f(gl->GetUniformLocation(program, "field"), field);
+        gl->Uniform1f(gl->GetUniformLocation(program, "first_field"),
+                      p->deint_field == 0);
+        gl->Uniform1f(gl->GetUniformLocation(program, "have_prev"), temporal);
+        gl->Uniform2f(gl->GetUniformLocation(program, "texture_size"),
+                      plane->tex_w, plane->tex_h);
+        gl->Uniform1f(gl->GetUniformLocation(program, "plane_h"), plane->h);
+
+        gl->ActiveTexture(GL_TEXTURE0 + 1);
+        gl->BindTexture(p->gl_target, temporal ? plane->prev_texture : 0);
+        gl->ActiveTexture(GL_TEXTURE0);
+
+        struct pass chain = {
+            .f = {
+                .vp_w = plane->w,
+                .vp_h = plane->h,
+                .tex_w = plane->tex_w,
+                .tex_h = plane->tex_h,
+                .texture = imgtex[n],
+            },
+        };
+        handle_pass(p, &chain, fbo, program);
+        imgtex[n] = fbo->texture;
+    }
+
+    for (int n = 0; n < 4; n++) {
+        gl->ActiveTexture(GL_TEXTURE0 + n);
+        gl->BindTexture(p->gl_target, imgtex[n]);
+    }
+    gl->ActiveTexture(GL_TEXTURE0);
+}
+
 void gl_video_render_frame(struct gl_video *p)
+{
+    gl_video_render_frame_blend(p, 1.0);
+}
+
+// Like gl_video_render_frame(), but if interpolation is enabled, show the
+// current image blended with the image rendered before it. mix is the weight
+// of the current image (0.0-1.0).
+void gl_video_render_frame_blend(struct gl_video *p, double mix)
 {
     GL *gl = p->gl;
     struct video_image *vimg = &p->image;
 
+    bool redraw = !p->output_new;
+    bool interpolate = gl_video_has_interpolation(p) && p->output_fbos[0].fbo &&
+                       p->output_fbos[1].fbo && p->have_image;
+    if (interpolate && p->output_new)
+        p->output_cur = !p->output_cur;
+    p->output_new = false;
+
+    if (gl->mpgl_caps & MPGL_CAP_FB)
+        gl->BindFramebuffer(GL_FRAMEBUFFER, p->output_fbo);
+
+    if (!p->have_image) {
+        p->output_cached = false;
+        gl->Clear(GL_COLOR_BUFFER_BIT);
+        goto draw_osd;
+    }
+
+    // If the video must be rendered into an FBO anyway, or if the image is
+    // redrawn (typically because only the OSD changed), keep the rendered
+    // video, and reuse it as long as nothing else changes.
+    struct fbotex *out_fbo = NULL;
+    if (interpolate) {
+        out_fbo = &p->output_fbos[p->output_cur];
+    } else if (redraw && p->blend_program) {
+        struct fbotex *fbo = &p->redraw_fbo;
+        if (fbo->vp_w != p->vp_w || fbo->vp_h != p->vp_h) {
+            fbotex_uninit(p, fbo);
+            p->output_cached = false;
+            if (p->vp_w > 0 && p->vp_h > 0)
+                fbotex_init(p, fbo, p->vp_w, p->vp_h, p->opts.fbo_format);
+        }
+        if (fbo->fbo)
+            out_fbo = fbo;
+    }
+
+    if (redraw && out_fbo && p->output_cached)
+        goto draw_output;
+
+    p->output_cached = false;
+
     if (p->opts.temporal_dither)
         change_dither_trafo(p);
 
+    struct fbotex screen = {
+        .vp_x = p->vp_x,
+        .vp_y = p->vp_y,
+        .vp_w = p->vp_w,
+        .vp_h = p->vp_h,
+        .fbo = p->output_fbo, // the screen backbuffer, or the user's FBO
+    };
+
+    if (out_fbo) {
+        screen = *out_fbo;
+        gl->BindFramebuffer(GL_FRAMEBUFFER, screen.fbo);
+    }
+
     if (p->dst_rect.x0 > p->vp_x || p->dst_rect.y0 > p->vp_y
         || p->dst_rect.x1 < p->vp_x + p->vp_w
         || p->dst_rect.y1 < p->vp_y + p->vp_h)
@@ -1614,17 +2364,18 @@ void gl_video_render_frame(struct gl_video *p)
         gl->Clear(GL_COLOR_BUFFER_BIT);
     }
 
-    if (!p->have_image) {
-        gl->Clear(GL_COLOR_BUFFER_BIT);
-        goto draw_osd;
-    }
-
     // Order of processing:
     //  [indirect -> [scale_sep ->]] final
 
     GLuint imgtex[4] = {0};
     set_image_textures(p, vimg, imgtex);
 
+    if (deint_active(p)) {
+        timer_begin(p, PASS_DEINT);
+        deint_planes(p, imgtex);
+        timer_end(p, PASS_DEINT);
+    }
+
     struct pass chain = {
         .f = {
             .vp_w = p->image_w,
@@ -1635,7 +2386,24 @@ void gl_video_render_frame(struct gl_video *p)
         },
     };
 
-    handle_pass(p, &chain, &p->indirect_fbo, p->indirect_program);
+    if (p->indirect_program) {
+        timer_begin(p, PASS_INDIRECT);
+        handle_pass(p, &chain, &p->indirect_fbo, p->indirect_program);
+        timer_end(p, PASS_INDIRECT);
+    }
+
+    if (p->deband_program) {
+        GLuint program = p->deband_program;
+        gl->UseProgram(program);
+        gl->Uniform2f(gl->GetUniformLocation(program, "texture_size"),
+                      chain.f.tex_w, chain.f.tex_h);
+        // Changes the noise pattern for each frame.
+        gl->Uniform1f(gl->GetUniformLocation(program, "random"),
+                      (p->frames_rendered % 1024) / 1024.0);
+        timer_begin(p, PASS_DEBAND);
+        handle_pass(p, &chain, &p->deband_fbo, program);
+        timer_end(p, PASS_DEBAND);
+    }
 
     // Clip to visible height so that separate scaling scales the visible part
     // only (and the target FBO texture can have a bounded size).
@@ -1643,15 +2411,12 @@ void gl_video_render_frame(struct gl_video *p)
     chain.f.vp_y = p->src_rect_rot.y0;
     chain.f.vp_h = p->src_rect_rot.y1 - p->src_rect_rot.y0;
 
-    handle_pass(p, &chain, &p->scale_sep_fbo, p->scale_sep_program);
-
-    struct fbotex screen = {
-        .vp_x = p->vp_x,
-        .vp_y = p->vp_y,
-        .vp_w = p->vp_w,
-        .vp_h = p->vp_h,
-        .texture = 0, //makes BindFramebuffer select the screen backbuffer
-    };
+    if (p->scale_sep_program || p->scale_sep_compute) {
+        timer_begin(p, PASS_SCALE_SEP);
+        if (!compute_pass(p, &chain, &p->scale_sep_fbo, p->scale_sep_compute))
+            handle_pass(p, &chain, &p->scale_sep_fbo, p->scale_sep_program);
+        timer_end(p, PASS_SCALE_SEP);
+    }
 
     // For Y direction, use the whole source viewport; it has been fit to the
     // correct origin/height before.
@@ -1666,27 +2431,80 @@ void gl_video_render_frame(struct gl_video *p)
                 | (vimg->image_flipped ? 4 : 0);
     chain.render_stereo = true;
 
+    timer_begin(p, PASS_FINAL);
     handle_pass(p, &chain, &screen, p->final_program);
-
-    gl->UseProgram(0);
-    gl->BindFramebuffer(GL_FRAMEBUFFER, 0);
-    gl->Viewport(p->vp_x, p->vp_y, p->vp_w, p->vp_h);
+    timer_end(p, PASS_FINAL);
 
     unset_image_textures(p);
 
     p->frames_rendered++;
 
+    if (out_fbo) {
+        p->output_cached = true;
+        if (interpolate)
+            p->output_valid[p->output_cur] = true;
+    }
+
+draw_output:
+    timer_begin(p, PASS_BLEND);
+    if (interpolate) {
+        int prev = !p->output_cur;
+        if (!p->output_valid[prev])
+            mix = 1.0;
+        blend_pass(p, &p->output_fbos[prev], out_fbo, mix);
+    } else if (out_fbo) {
+        blend_pass(p, out_fbo, out_fbo, 1.0);
+    }
+    timer_end(p, PASS_BLEND);
+
+    gl->UseProgram(0);
+    gl->BindFramebuffer(GL_FRAMEBUFFER, p->output_fbo);
+    gl->Viewport(p->vp_x, p->vp_y, p->vp_w, p->vp_h);
+
     debug_check_gl(p, "after video rendering");
 
 draw_osd:
     assert(p->osd);
 
-    osd_draw(p->osd_state, p->osd_rect, p->osd_pts, 0, p->osd->formats,
-             draw_osd_cb, p);
+    timer_begin(p, PASS_OSD);
+    osd_draw(p->osd_state, p->osd_rect, p->osd_pts, OSD_DRAW_SCALE_LIBASS,
+             p->osd->formats, draw_osd_cb, p);
+    timer_end(p, PASS_OSD);
+}
+
+// Render the second field of the current image, if it's deinterlaced. Returns
+// false if there is no second field to show.
+bool gl_video_render_second_field(struct gl_video *p)
+{
+    if (!p->have_image || !deint_active(p) || p->deint_field)
+        return false;
+    p->deint_field = 1;
+    p->output_cached = false;
+    gl_video_render_frame(p);
+    return true;
+}
+
+// Whether gl_video_render_frame_blend() actually blends frames.
+bool gl_video_has_interpolation(struct gl_video *p)
+{
+    return p->opts.interpolation && p->blend_program;
 }
 
 static void update_window_sized_objects(struct gl_video *p)
 {
+    for (int n = 0; n < 2; n++) {
+        struct fbotex *fbo = &p->output_fbos[n];
+        if (!gl_video_has_interpolation(p)) {
+            fbotex_uninit(p, fbo);
+        } else if ((fbo->vp_w != p->vp_w || fbo->vp_h != p->vp_h) &&
+                   p->vp_w > 0 && p->vp_h > 0)
+        {
+            fbotex_uninit(p, fbo);
+            fbotex_init(p, fbo, p->vp_w, p->vp_h, p->opts.fbo_format);
+        }
+        if (!fbo->fbo)
+            p->output_valid[n] = false;
+    }
     if (p->scale_sep_program) {
         int w = p->dst_rect.x1 - p->dst_rect.x0;
         int h = p->dst_rect.y1 - p->dst_rect.y0;
@@ -1763,6 +2581,21 @@ void gl_video_resize(struct gl_video *p, struct mp_rect *window,
     check_resize(p);
 }
 
+// Wait until the GPU has passed the fence, and delete it.
+static void wait_fence(struct gl_video *p, GLsync *fence)
+{
+    GL *gl = p->gl;
+
+    if (!*fence)
+        return;
+    GLenum res = gl->ClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                    1000000000); // 1 second in ns
+    if (res == GL_TIMEOUT_EXPIRED || res == GL_WAIT_FAILED)
+        MP_WARN(p, "Waiting for PBO upload failed.\n");
+    gl->DeleteSync(*fence);
+    *fence = NULL;
+}
+
 static bool get_image(struct gl_video *p, struct mp_image *mpi)
 {
     GL *gl = p->gl;
@@ -1776,16 +2609,24 @@ static bool get_image(struct gl_video *p, struct mp_image *mpi)
     // The normal upload path does this too, but less explicit.
     mp_image_set_size(mpi, vimg->planes[0].w, vimg->planes[0].h);
 
+    int index = vimg->pbo_index;
+    if (gl->mpgl_caps & MPGL_CAP_SYNC)
+        wait_fence(p, &vimg->pbo_fences[index]);
+
     for (int n = 0; n < p->plane_count; n++) {
         struct texplane *plane = &vimg->planes[n];
         mpi->stride[n] = mpi->plane_w[n] * p->image_desc.bytes[n];
         int needed_size = mpi->plane_h[n] * mpi->stride[n];
-        if (!plane->gl_buffer)
-            gl->GenBuffers(1, &plane->gl_buffer);
-        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, plane->gl_buffer);
-        if (needed_size > plane->buffer_size) {
-            plane->buffer_size = needed_size;
-            gl->BufferData(GL_PIXEL_UNPACK_BUFFER, plane->buffer_size,
+        if (!plane->gl_buffers[index])
+            gl->GenBuffers(1, &plane->gl_buffers[index]);
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, plane->gl_buffers[index]);
+        // Without fences, orphan the old storage instead of waiting for it.
+        if (needed_size > plane->buffer_size[index] ||
+            !(gl->mpgl_caps & MPGL_CAP_SYNC))
+        {
+            plane->buffer_size[index] = MPMAX(plane->buffer_size[index],
+                                              needed_size);
+            gl->BufferData(GL_PIXEL_UNPACK_BUFFER, plane->buffer_size[index],
                            NULL, GL_DYNAMIC_DRAW);
         }
         if (!plane->buffer_ptr)
@@ -1797,6 +2638,139 @@ static bool get_image(struct gl_video *p, struct mp_image *mpi)
     return true;
 }
 
+static void destroy_dr_buffer(struct gl_video *p, int index)
+{
+    GL *gl = p->gl;
+    struct dr_buffer *buf = p->dr_buffers[index];
+
+    if (buf->fence)
+        gl->DeleteSync(buf->fence);
+    gl->DeleteBuffers(1, &buf->pbo); // implicitly unmaps it
+    MP_TARRAY_REMOVE_AT(p->dr_buffers, p->num_dr_buffers, index);
+    if (buf->in_use) {
+        MP_ERR(p, "Direct rendering buffer still in use on destruction.\n");
+        buf->orphaned = true;
+    } else {
+        talloc_free(buf);
+    }
+}
+
+// Called on the VO thread, not necessarily with the GL context current.
+static void unref_dr_buffer(void *ptr)
+{
+    struct dr_buffer *buf = ptr;
+    buf->in_use = false;
+    if (buf->orphaned)
+        talloc_free(buf);
+}
+
+// Return an image for direct rendering. Its planes are in a persistently
+// mapped PBO, which gl_video_upload_image() uploads without copying.
+// The image can be freed only on the thread gl_video is used on.
+// stride_align must be a power of 2.
+struct mp_image *gl_video_get_image(struct gl_video *p, int imgfmt, int w,
+                                    int h, int stride_align)
+{
+    GL *gl = p->gl;
+
+    int caps = MPGL_CAP_SYNC | MPGL_CAP_BUFFER_STORAGE;
+    if (!p->opts.pbo || (gl->mpgl_caps & caps) != caps)
+        return NULL;
+    if (IMGFMT_IS_HWACCEL(imgfmt) || !gl_video_check_format(p, imgfmt))
+        return NULL;
+
+    assert(!(stride_align & (stride_align - 1)));
+    stride_align = MPMAX(stride_align, 16);
+
+    struct mp_image mpi = {0};
+    mp_image_setfmt(&mpi, imgfmt);
+    mp_image_set_size(&mpi, w, h);
+    if (mpi.fmt.flags & MP_IMGFLAG_PAL)
+        return NULL;
+
+    size_t offset[MP_MAX_PLANES] = {0};
+    size_t size = 0;
+    for (int n = 0; n < mpi.num_planes; n++) {
+        int bytes = mpi.fmt.bytes[n];
+        if (!bytes)
+            return NULL;
+        mpi.stride[n] = MP_ALIGN_UP(mpi.plane_w[n] * bytes, stride_align);
+        // glUploadTex() sets GL_UNPACK_ROW_LENGTH in pixels
+        if (mpi.stride[n] % bytes)
+            return NULL;
+        offset[n] = size;
+        // One additional line, as decoders can write past the image.
+        size += mpi.stride[n] * (size_t)(mpi.plane_h[n] + 1);
+    }
+    size += stride_align; // for aligning the mapped pointer
+
+    // Free buffers of other sizes are most likely never going to be reused.
+    struct dr_buffer *buf = NULL;
+    for (int n = p->num_dr_buffers - 1; n >= 0; n--) {
+        struct dr_buffer *cur = p->dr_buffers[n];
+        if (cur->in_use)
+            continue;
+        if (cur->size != size) {
+            destroy_dr_buffer(p, n);
+        } else if (!buf) {
+            buf = cur;
+        }
+    }
+
+    if (!buf) {
+        buf = talloc_ptrtype(NULL, buf);
+        *buf = (struct dr_buffer){ .size = size };
+        GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT |
+                           GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gl->GenBuffers(1, &buf->pbo);
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, buf->pbo);
+        gl->BufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL,
+                          flags | GL_CLIENT_STORAGE_BIT);
+        buf->ptr = gl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!buf->ptr) {
+            MP_WARN(p, "Could not map direct rendering buffer.\n");
+            gl->DeleteBuffers(1, &buf->pbo);
+            talloc_free(buf);
+            return NULL;
+        }
+        MP_TARRAY_APPEND(p, p->dr_buffers, p->num_dr_buffers, buf);
+    }
+
+    // The GPU might still be reading from the previous upload.
+    wait_fence(p, &buf->fence);
+
+    uint8_t *base = (uint8_t *)MP_ALIGN_UP((uintptr_t)buf->ptr, stride_align);
+    for (int n = 0; n < mpi.num_planes; n++)
+        mpi.planes[n] = base + offset[n];
+    buf->in_use = true;
+    return mp_image_new_custom_ref(&mpi, buf, unref_dr_buffer);
+}
+
+// Return the DR buffer the image was rendered into, if it can be uploaded
+// directly from it.
+static struct dr_buffer *find_dr_buffer(struct gl_video *p,
+                                        struct mp_image *mpi)
+{
+    struct video_image *vimg = &p->image;
+
+    for (int n = 0; n < p->num_dr_buffers; n++) {
+        struct dr_buffer *buf = p->dr_buffers[n];
+        uint8_t *end = buf->ptr + buf->size;
+        bool ok = buf->in_use;
+        for (int i = 0; i < p->plane_count; i++) {
+            struct texplane *plane = &vimg->planes[i];
+            uint8_t *last = mpi->planes[i] + mpi->stride[i] * (plane->h - 1) +
+                            plane->w * p->image_desc.bytes[i];
+            ok &= mpi->stride[i] > 0 && mpi->planes[i] >= buf->ptr &&
+                  last <= end;
+        }
+        if (ok)
+            return buf;
+    }
+    return NULL;
+}
+
 void gl_video_upload_image(struct gl_video *p, struct mp_image *mpi)
 {
     GL *gl = p->gl;
@@ -1804,6 +2778,10 @@ void gl_video_upload_image(struct gl_video *p, struct mp_image *mpi)
     struct video_image *vimg = &p->image;
 
     p->osd_pts = mpi->pts;
+    p->output_new = true;
+    p->output_cached = false;
+    vimg->fields = mpi->fields;
+    p->deint_field = 0;
 
     if (p->hwdec_active) {
         talloc_free(vimg->hwimage);
@@ -1814,6 +2792,53 @@ void gl_video_upload_image(struct gl_video *p, struct mp_image *mpi)
 
     assert(mpi->num_planes == p->plane_count);
 
+    timer_begin(p, PASS_UPLOAD);
+
+    // Keep the previous image for temporal deinterlacing. The new image is
+    // uploaded into the texture with the image before it.
+    p->deint_have_prev = false;
+    if (deint_active(p) && p->opts.deint == 2) {
+        for (int n = 0; n < p->plane_count; n++) {
+            struct texplane *plane = &vimg->planes[n];
+            if (!plane->prev_texture) {
+                gl->GenTextures(1, &plane->prev_texture);
+                gl->BindTexture(p->gl_target, plane->prev_texture);
+                gl->TexImage2D(p->gl_target, 0, plane->gl_internal_format,
+                               plane->tex_w, plane->tex_h, 0,
+                               plane->gl_format, plane->gl_type, NULL);
+                default_tex_params(gl, p->gl_target, GL_LINEAR);
+                gl->BindTexture(p->gl_target, 0);
+            }
+            MPSWAP(GLuint, plane->gl_texture, plane->prev_texture);
+        }
+        p->deint_have_prev = p->have_image;
+    }
+
+    struct dr_buffer *dr = find_dr_buffer(p, mpi);
+    if (dr) {
+        // The decoder rendered directly into the PBO.
+        vimg->image_flipped = false;
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, dr->pbo);
+        for (int n = 0; n < p->plane_count; n++) {
+            struct texplane *plane = &vimg->planes[n];
+            gl->ActiveTexture(GL_TEXTURE0 + n);
+            gl->BindTexture(p->gl_target, plane->gl_texture);
+            glUploadTex(gl, p->gl_target, plane->gl_format, plane->gl_type,
+                        (void *)(mpi->planes[n] - dr->ptr), mpi->stride[n],
+                        0, 0, plane->w, plane->h, 0);
+        }
+        gl->ActiveTexture(GL_TEXTURE0);
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (dr->fence)
+            gl->DeleteSync(dr->fence);
+        dr->fence = gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        timer_end(p, PASS_UPLOAD);
+        p->have_image = true;
+        talloc_free(vimg->mpi);
+        vimg->mpi = mpi;
+        return;
+    }
+
     mp_image_t mpi2 = *mpi;
     bool pbo = false;
     if (!vimg->planes[0].buffer_ptr && get_image(p, &mpi2)) {
@@ -1829,7 +2854,8 @@ void gl_video_upload_image(struct gl_video *p, struct mp_image *mpi)
         struct texplane *plane = &vimg->planes[n];
         void *plane_ptr = mpi2.planes[n];
         if (pbo) {
-            gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, plane->gl_buffer);
+            gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER,
+                           plane->gl_buffers[vimg->pbo_index]);
             if (!gl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
                 MP_FATAL(p, "Video PBO upload failed. "
                          "Remove the 'pbo' suboption.\n");
@@ -1843,9 +2869,19 @@ void gl_video_upload_image(struct gl_video *p, struct mp_image *mpi)
     }
     gl->ActiveTexture(GL_TEXTURE0);
     gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (pbo) {
+        int index = vimg->pbo_index;
+        if (gl->mpgl_caps & MPGL_CAP_SYNC)
+            vimg->pbo_fences[index] =
+                gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        vimg->pbo_index = (index + 1) % NUM_PBO_BUFFERS;
+    }
+
+    timer_end(p, PASS_UPLOAD);
 
     p->have_image = true;
-    talloc_free(mpi);
+    talloc_free(vimg->mpi);
+    vimg->mpi = mpi;
 }
 
 struct mp_image *gl_video_download_image(struct gl_video *p)
@@ -1865,6 +2901,16 @@ struct mp_image *gl_video_download_image(struct gl_video *p)
         return dlimage;
     }
 
+    // The uploaded image is still referenced, so return it instead of
+    // reading back the textures, which would stall the GPU pipeline.
+    if (vimg->mpi) {
+        struct mp_image *image = mp_image_new_ref(vimg->mpi);
+        if (image) {
+            mp_image_set_attributes(image, &p->image_params);
+            return image;
+        }
+    }
+
     set_image_textures(p, vimg, NULL);
 
     assert(p->texture_w >= p->image_params.w);
@@ -1965,7 +3011,7 @@ static bool test_fbo(struct gl_video *p, GLenum format)
             gl->ReadPixels(0, 0, 1, 1, GL_RED, GL_FLOAT, &pixel);
             MP_VERBOSE(p, "   %s: %a\n", val_names[i], val - pixel);
         }
-        gl->BindFramebuffer(GL_FRAMEBUFFER, 0);
+        gl->BindFramebuffer(GL_FRAMEBUFFER, p->output_fbo);
         glCheckError(gl, p->log, "after FBO read");
         success = true;
     }
@@ -2046,6 +3092,9 @@ static void check_gl_features(struct gl_video *p)
     if (!have_fbo) {
         p->opts.scale_sep = false;
         p->opts.indirect = false;
+        p->opts.interpolation = false;
+        p->opts.deint = 0;
+        p->opts.deband = 0;
     }
 
     if (n_disabled) {
@@ -2118,6 +3167,12 @@ void gl_video_uninit(struct gl_video *p)
 
     uninit_video(p);
 
+    while (p->num_dr_buffers)
+        destroy_dr_buffer(p, p->num_dr_buffers - 1);
+
+    clear_program_cache(p);
+    uninit_timers(p);
+
     if (gl->DeleteVertexArrays)
         gl->DeleteVertexArrays(1, &p->vao);
     gl->DeleteBuffers(1, &p->vertex_buffer);
@@ -2274,7 +3329,9 @@ bool gl_video_check_format(struct gl_video *p, int mp_format)
 void gl_video_config(struct gl_video *p, struct mp_image_params *params)
 {
     p->have_image = false;
+    p->output_cached = false;
     mp_image_unrefp(&p->image.hwimage);
+    mp_image_unrefp(&p->image.mpi);
 
     if (!mp_image_params_equal(&p->image_params, params)) {
         uninit_video(p);
@@ -2288,14 +3345,18 @@ void gl_video_set_output_depth(struct gl_video *p, int r, int g, int b)
     p->depth_g = g;
 }
 
-struct gl_video *gl_video_init(GL *gl, struct mp_log *log, struct osd_state *osd)
+struct gl_video *gl_video_init(GL *gl, struct mp_log *log,
+                               struct mpv_global *global,
+                               struct osd_state *osd)
 {
     struct gl_video *p = talloc_ptrtype(NULL, p);
     *p = (struct gl_video) {
         .gl = gl,
         .log = log,
+        .global = global,
         .osd_state = osd,
         .opts = gl_video_opts_def,
+        .user_opts = gl_video_opts_def,
         .gl_target = GL_TEXTURE_2D,
         .gl_debug = true,
         .scalers = {
@@ -2303,6 +3364,7 @@ struct gl_video *gl_video_init(GL *gl, struct mp_log *log, struct osd_state *osd
             { .index = 1, .name = "bilinear" },
         },
         .scratch = talloc_zero_array(p, char *, 1),
+        .active_timer = -1,
     };
     init_gl(p);
     recreate_osd(p);
@@ -2335,19 +3397,94 @@ static const char* handle_scaler_opt(const char *name)
 
 // Set the options, and possibly update the filter chain too.
 // Note: assumes all options are valid and verified by the option parser.
-void gl_video_set_options(struct gl_video *p, struct gl_video_opts *opts)
+// Quality drop levels. Each level includes the reductions of the lower ones.
+enum {
+    QUALITY_DROP_FBO = 1,       // no debanding and fancy downscaling, FBO
+                                // precision reduced to 10 bit
+    QUALITY_DROP_CHROMA,        // bilinear chroma scaling
+    QUALITY_DROP_LUMA,          // no convolution filter for luma scaling
+    QUALITY_DROP_CMS,           // no dithering and 3D LUT
+};
+
+static bool is_high_precision_fbo(int format)
 {
-    p->opts = *opts;
-    for (int n = 0; n < 2; n++) {
-        p->opts.scalers[n] = (char *)handle_scaler_opt(p->opts.scalers[n]);
-        assert(p->opts.scalers[n]);
-        p->scalers[n].name = p->opts.scalers[n];
+    switch (format) {
+    case GL_RGB16:
+    case GL_RGB16F:
+    case GL_RGB32F:
+    case GL_RGBA12:
+    case GL_RGBA16:
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+        return true;
+    }
+    return false;
+}
+
+static void reduce_quality(struct gl_video *p, struct gl_video_opts *opts,
+                           int level)
+{
+    if (level >= QUALITY_DROP_FBO) {
+        opts->deband = 0;
+        opts->fancy_downscaling = 0;
+        // GL_RGB10_A2 is guaranteed to be renderable since GL 3.0 only.
+        if ((p->gl->mpgl_caps & MPGL_CAP_GL3) &&
+            is_high_precision_fbo(opts->fbo_format))
+            opts->fbo_format = GL_RGB10_A2;
+    }
+    if (level >= QUALITY_DROP_CHROMA) {
+        opts->scalers[1] = "bilinear";
+        opts->scaler_params[1][0] = opts->scaler_params[1][1] = NAN;
+        opts->scaler_radius[1] = NAN;
+    }
+    if (level >= QUALITY_DROP_LUMA && mp_find_filter_kernel(opts->scalers[0])) {
+        opts->scalers[0] = "bicubic_fast";
+        opts->scaler_params[0][0] = opts->scaler_params[0][1] = NAN;
+        opts->scaler_radius[0] = NAN;
+    }
+    if (level >= QUALITY_DROP_CMS) {
+        opts->dither_depth = -1;
+        opts->temporal_dither = 0;
     }
+}
+
+// Derive the effective options from user_opts and the quality drop level.
+static void apply_options(struct gl_video *p)
+{
+    p->opts = p->user_opts;
+    reduce_quality(p, &p->opts, p->quality_drop);
+    for (int n = 0; n < 2; n++)
+        p->scalers[n].name = p->opts.scalers[n];
+    p->use_lut_3d = p->lut_3d_loaded && p->quality_drop < QUALITY_DROP_CMS;
 
     check_gl_features(p);
     reinit_rendering(p);
 }
 
+void gl_video_set_options(struct gl_video *p, struct gl_video_opts *opts)
+{
+    p->user_opts = *opts;
+    for (int n = 0; n < 2; n++) {
+        p->user_opts.scalers[n] =
+            (char *)handle_scaler_opt(p->user_opts.scalers[n]);
+        assert(p->user_opts.scalers[n]);
+    }
+
+    apply_options(p);
+}
+
+// Trade rendering quality for speed. level 0 renders as configured with the
+// options, higher levels (up to GL_VIDEO_MAX_QUALITY_DROP) disable more and
+// more expensive features. Options set later are reduced in the same way.
+void gl_video_set_quality_drop(struct gl_video *p, int level)
+{
+    level = MPCLAMP(level, 0, GL_VIDEO_MAX_QUALITY_DROP);
+    if (level == p->quality_drop)
+        return;
+    p->quality_drop = level;
+    apply_options(p);
+}
+
 void gl_video_get_colorspace(struct gl_video *p, struct mp_image_params *params)
 {
     *params = p->image_params; // supports everything
@@ -2367,6 +3504,26 @@ bool gl_video_set_equalizer(struct gl_video *p, const char *name, int val)
     return false;
 }
 
+// Returns false if deinterlacing is not supported (not enabled with the deint
+// suboption).
+bool gl_video_set_deinterlace(struct gl_video *p, bool enable)
+{
+    if (!p->opts.deint || p->hwdec_active)
+        return false;
+    p->deint = enable;
+    p->deint_have_prev = false;
+    p->output_cached = false;
+    return true;
+}
+
+bool gl_video_get_deinterlace(struct gl_video *p, bool *enable)
+{
+    if (!p->opts.deint || p->hwdec_active)
+        return false;
+    *enable = p->deint;
+    return true;
+}
+
 bool gl_video_get_equalizer(struct gl_video *p, const char *name, int *val)
 {
     return mp_csp_equalizer_get(&p->video_eq, name, val) >= 0;
@@ -2397,6 +3554,7 @@ void gl_video_resize_redraw(struct gl_video *p, int w, int h)
     p->gl->Viewport(p->vp_x, p->vp_y, w, h);
     p->vp_w = w;
     p->vp_h = h;
+    p->output_cached = false;
     gl_video_render_frame(p);
 }
 
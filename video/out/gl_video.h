@@ -36,6 +36,8 @@ struct gl_video_opts {
     int srgb;
     int approx_gamma;
     int scale_sep;
+    int scale_sep_compute;
+    int interpolation;
     int fancy_downscaling;
     int scaler_resizes_only;
     int npot;
@@ -49,6 +51,13 @@ struct gl_video_opts {
     int alpha_mode;
     int chroma_location;
     int use_rectangle;
+    int deint;
+    int deband;
+    int deband_iterations;
+    float deband_threshold;
+    float deband_range;
+    float deband_grain;
+    char *shader_cache_dir;
 };
 
 extern const struct m_sub_options gl_video_conf;
@@ -56,15 +65,25 @@ extern const struct gl_video_opts gl_video_opts_hq_def;
 
 struct gl_video;
 
-struct gl_video *gl_video_init(GL *gl, struct mp_log *log, struct osd_state *osd);
+struct mpv_global;
+struct gl_video *gl_video_init(GL *gl, struct mp_log *log,
+                               struct mpv_global *global,
+                               struct osd_state *osd);
 void gl_video_uninit(struct gl_video *p);
 void gl_video_set_options(struct gl_video *p, struct gl_video_opts *opts);
+#define GL_VIDEO_MAX_QUALITY_DROP 4
+void gl_video_set_quality_drop(struct gl_video *p, int level);
 bool gl_video_check_format(struct gl_video *p, int mp_format);
 void gl_video_config(struct gl_video *p, struct mp_image_params *params);
 void gl_video_set_output_depth(struct gl_video *p, int r, int g, int b);
 void gl_video_set_lut3d(struct gl_video *p, struct lut3d *lut3d);
 void gl_video_upload_image(struct gl_video *p, struct mp_image *img);
+struct mp_image *gl_video_get_image(struct gl_video *p, int imgfmt, int w,
+                                    int h, int stride_align);
 void gl_video_render_frame(struct gl_video *p);
+void gl_video_render_frame_blend(struct gl_video *p, double mix);
+bool gl_video_has_interpolation(struct gl_video *p);
+bool gl_video_render_second_field(struct gl_video *p);
 struct mp_image *gl_video_download_image(struct gl_video *p);
 void gl_video_resize(struct gl_video *p, struct mp_rect *window,
                      struct mp_rect *src, struct mp_rect *dst,
@@ -72,8 +91,15 @@ void gl_video_resize(struct gl_video *p, struct mp_rect *window,
 void gl_video_get_colorspace(struct gl_video *p, struct mp_image_params *params);
 bool gl_video_set_equalizer(struct gl_video *p, const char *name, int val);
 bool gl_video_get_equalizer(struct gl_video *p, const char *name, int *val);
+bool gl_video_set_deinterlace(struct gl_video *p, bool enable);
+bool gl_video_get_deinterlace(struct gl_video *p, bool *enable);
+
+struct voctrl_pass_timings;
+bool gl_video_get_pass_timings(struct gl_video *p,
+                               struct voctrl_pass_timings *out);
 
 void gl_video_set_debug(struct gl_video *p, bool enable);
+void gl_video_set_output_fbo(struct gl_video *p, GLuint fbo);
 void gl_video_resize_redraw(struct gl_video *p, int w, int h);
 
 struct gl_hwdec;
@@ -136,6 +136,50 @@ void main() {
     out_color = texture(texture0, texcoord);
 }
 
+#!section weights
+// Weight lookup for the convolution filters; shared between frag_video and
+// the compute shader scaler.
+
+float[2] weights2(sampler1D lookup, float f) {
+    vec4 c = texture1D(lookup, f);
+    return float[2](c.r, c.g);
+}
+
+float[4] weights4(sampler1D lookup, float f) {
+    vec4 c = texture1D(lookup, f);
+    return float[4](c.r, c.g, c.b, c.a);
+}
+
+float[6] weights6(sampler2D lookup, float f) {
+    vec4 c1 = texture(lookup, vec2(0.25, f));
+    vec4 c2 = texture(lookup, vec2(0.75, f));
+    return float[6](c1.r, c1.g, c1.b, c2.r, c2.g, c2.b);
+}
+
+float[8] weights8(sampler2D lookup, float f) {
+    vec4 c1 = texture(lookup, vec2(0.25, f));
+    vec4 c2 = texture(lookup, vec2(0.75, f));
+    return float[8](c1.r, c1.g, c1.b, c1.a, c2.r, c2.g, c2.b, c2.a);
+}
+
+float[12] weights12(sampler2D lookup, float f) {
+    vec4 c1 = texture(lookup, vec2(1.0/6.0, f));
+    vec4 c2 = texture(lookup, vec2(0.5, f));
+    vec4 c3 = texture(lookup, vec2(5.0/6.0, f));
+    return float[12](c1.r, c1.g, c1.b, c1.a,
+                     c2.r, c2.g, c2.b, c2.a,
+                     c3.r, c3.g, c3.b, c3.a);
+}
+
+float[16] weights16(sampler2D lookup, float f) {
+    vec4 c1 = texture(lookup, vec2(0.125, f));
+    vec4 c2 = texture(lookup, vec2(0.375, f));
+    vec4 c3 = texture(lookup, vec2(0.625, f));
+    vec4 c4 = texture(lookup, vec2(0.875, f));
+    return float[16](c1.r, c1.g, c1.b, c1.a, c2.r, c2.g, c2.b, c2.a,
+                     c3.r, c3.g, c3.b, c3.a, c4.r, c4.g, c4.b, c4.a);
+}
+
 #!section frag_video
 uniform VIDEO_SAMPLER texture0;
 uniform VIDEO_SAMPLER texture1;
@@ -211,46 +255,6 @@ vec4 sample_bicubic_fast(VIDEO_SAMPLER tex, vec2 texsize, vec2 texcoord, float p
     return mix(aa, ab, parmx.b);
 }
 
-float[2] weights2(sampler1D lookup, float f) {
-    vec4 c = texture1D(lookup, f);
-    return float[2](c.r, c.g);
-}
-
-float[4] weights4(sampler1D lookup, float f) {
-    vec4 c = texture1D(lookup, f);
-    return float[4](c.r, c.g, c.b, c.a);
-}
-
-float[6] weights6(sampler2D lookup, float f) {
-    vec4 c1 = texture(lookup, vec2(0.25, f));
-    vec4 c2 = texture(lookup, vec2(0.75, f));
-    return float[6](c1.r, c1.g, c1.b, c2.r, c2.g, c2.b);
-}
-
-float[8] weights8(sampler2D lookup, float f) {
-    vec4 c1 = texture(lookup, vec2(0.25, f));
-    vec4 c2 = texture(lookup, vec2(0.75, f));
-    return float[8](c1.r, c1.g, c1.b, c1.a, c2.r, c2.g, c2.b, c2.a);
-}
-
-float[12] weights12(sampler2D lookup, float f) {
-    vec4 c1 = texture(lookup, vec2(1.0/6.0, f));
-    vec4 c2 = texture(lookup, vec2(0.5, f));
-    vec4 c3 = texture(lookup, vec2(5.0/6.0, f));
-    return float[12](c1.r, c1.g, c1.b, c1.a,
-                     c2.r, c2.g, c2.b, c2.a,
-                     c3.r, c3.g, c3.b, c3.a);
-}
-
-float[16] weights16(sampler2D lookup, float f) {
-    vec4 c1 = texture(lookup, vec2(0.125, f));
-    vec4 c2 = texture(lookup, vec2(0.375, f));
-    vec4 c3 = texture(lookup, vec2(0.625, f));
-    vec4 c4 = texture(lookup, vec2(0.875, f));
-    return float[16](c1.r, c1.g, c1.b, c1.a, c2.r, c2.g, c2.b, c2.a,
-                     c3.r, c3.g, c3.b, c3.a, c4.r, c4.g, c4.b, c4.a);
-}
-
 #define CONVOLUTION_SEP_N(NAME, N)                                          \
     vec4 NAME(VIDEO_SAMPLER tex, vec2 texcoord, vec2 pt, float weights[N]) {\
         vec4 res = vec4(0);                                                 \
@@ -498,3 +502,179 @@ void main() {
     out_color = vec4(color, 1.0);
 #endif
 }
+
+#!section compute_scale_sep
+// The first (vertical) pass of separated scaling, as compute shader. Each work
+// group loads the source rows its output block needs into shared memory once,
+// and all taps of all pixels in the block read from there. This is only used
+// when upscaling, so that the number of rows needed is bounded.
+
+layout(local_size_x = GROUP_W, local_size_y = GROUP_H) in;
+
+uniform sampler2D texture0;
+uniform LUT_SAMPLER LUT_NAME;
+layout(binding = 0, OUT_FORMAT) writeonly uniform image2D out_image;
+uniform ivec2 out_size;
+uniform vec2 src_y; // offset and step per output row, in source texels
+
+shared vec4 rows[GROUP_H + TAPS][GROUP_W];
+
+// Position of the given output row in the source (texel centers at .0)
+float src_pos(int y) {
+    return src_y.x + (y + 0.5) * src_y.y - 0.5;
+}
+
+void main() {
+    ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 lpos = ivec2(gl_LocalInvocationID.xy);
+    ivec2 src_size = textureSize(texture0, 0);
+    int x = min(pos.x, src_size.x - 1);
+    int first = int(floor(src_pos(int(gl_WorkGroupID.y) * GROUP_H)))
+              - (TAPS / 2 - 1);
+    for (int r = lpos.y; r < GROUP_H + TAPS; r += GROUP_H) {
+        int y = clamp(first + r, 0, src_size.y - 1);
+        rows[r][lpos.x] = texelFetch(texture0, ivec2(x, y), 0);
+    }
+    barrier();
+
+    float p = src_pos(pos.y);
+    float base = floor(p);
+    float weights[TAPS] = WEIGHTS_FUNC(LUT_NAME, p - base);
+    int row = int(base) - (TAPS / 2 - 1) - first;
+    vec4 res = vec4(0);
+    for (int n = 0; n < TAPS; n++)
+        res += weights[n] * rows[row + n][lpos.x];
+    if (pos.x < out_size.x && pos.y < out_size.y)
+        imageStore(out_image, pos, res);
+}
+
+#!section frag_blend
+uniform VIDEO_SAMPLER texture0;
+uniform VIDEO_SAMPLER texture1;
+uniform float blend_mix;
+
+in vec2 texcoord;
+DECLARE_FRAGPARMS
+
+void main() {
+    out_color = mix(texture(texture0, texcoord), texture(texture1, texcoord),
+                    blend_mix);
+}
+
+#!section frag_deint
+uniform VIDEO_SAMPLER texture0;     // current image (one plane)
+uniform VIDEO_SAMPLER texture1;     // previous image (USE_DEINT_TEMPORAL)
+uniform vec2 texture_size;
+uniform float plane_h;
+uniform float field;                // parity of the lines of the output field
+uniform float first_field;          // 1.0 if it's the first field of the image
+uniform float have_prev;            // 1.0 if texture1 is valid
+
+in vec2 texcoord;
+DECLARE_FRAGPARMS
+
+// pos is in texels
+vec4 fetch(VIDEO_SAMPLER tex, vec2 pos) {
+    pos.y = clamp(pos.y, 0.5, plane_h - 0.5);
+#ifdef USE_RECTANGLE
+    return texture(tex, pos);
+#else
+    return texture(tex, pos / texture_size);
+#endif
+}
+
+void main() {
+#ifdef USE_RECTANGLE
+    vec2 pos = texcoord;
+#else
+    vec2 pos = texcoord * texture_size;
+#endif
+    float line = floor(pos.y);
+    pos.y = line + 0.5;
+    vec4 cur = fetch(texture0, pos);
+    // Lines of the output field are passed through.
+    if (mod(line, 2.0) == field) {
+        out_color = cur;
+        return;
+    }
+    vec2 up = vec2(0, 1);
+    vec4 a = fetch(texture0, pos - up);
+    vec4 b = fetch(texture0, pos + up);
+    vec4 spatial = (a + b) * 0.5;
+#ifdef USE_DEINT_TEMPORAL
+    if (have_prev > 0.5) {
+        // Simplified yadif: the missing line at the same position in the
+        // other field is the temporal prediction. It's used as long as the
+        // spatial prediction doesn't deviate more than the motion measured
+        // between the images. There is no lookahead, so for the second field
+        // the current image is the only temporal neighbour.
+        vec4 t0 = first_field > 0.5 ? fetch(texture1, pos) : cur;
+        vec4 d = (t0 + cur) * 0.5;
+        vec4 diff0 = abs(t0 - cur) * 0.5;
+        vec4 diff1 = (abs(fetch(texture1, pos - up) - a) +
+                      abs(fetch(texture1, pos + up) - b)) * 0.5;
+        vec4 diff = max(diff0, diff1);
+        spatial = clamp(spatial, d - diff, d + diff);
+    }
+#endif
+    out_color = spatial;
+}
+
+#!section frag_deband
+uniform VIDEO_SAMPLER texture0;
+uniform vec2 texture_size;
+uniform float deband_threshold;     // max. difference to the average
+uniform float deband_range;         // initial sample radius in pixels
+uniform float deband_grain;         // amount of noise added
+uniform float random;               // changes each frame
+
+in vec2 texcoord;
+DECLARE_FRAGPARMS
+
+// Cheap PRNG, good enough to pick sample positions and noise.
+float mod289(float x) { return x - floor(x / 289.0) * 289.0; }
+float permute(float x) { return mod289((34.0 * x + 1.0) * x); }
+float rand(float x) { return fract(x / 41.0); }
+
+// pos and o are in pixels
+vec4 sample_avg(vec2 pos, vec2 o) {
+#ifndef USE_RECTANGLE
+    pos /= texture_size;
+    o /= texture_size;
+#endif
+    return 0.25 * (texture(texture0, pos + o) +
+                   texture(texture0, pos - o) +
+                   texture(texture0, pos + vec2(-o.y, o.x)) +
+                   texture(texture0, pos + vec2(o.y, -o.x)));
+}
+
+void main() {
+#ifdef USE_RECTANGLE
+    vec2 pos = texcoord;
+#else
+    vec2 pos = texcoord * texture_size;
+#endif
+    vec3 m = vec3(pos, random) + vec3(1.0);
+    float h = permute(permute(permute(m.x) + m.y) + m.z);
+
+    // Compare with the average of random pixels in growing radii, and replace
+    // the pixel with it if the difference is small enough (i.e. smooth area).
+    vec4 ref = texture(texture0, texcoord);
+    for (int i = 1; i <= DEBAND_ITERATIONS; i++) {
+        float dist = rand(h) * deband_range * float(i);
+        h = permute(h);
+        float dir = rand(h) * 6.2831853;
+        h = permute(h);
+        vec4 avg = sample_avg(pos, dist * vec2(cos(dir), sin(dir)));
+        vec4 diff = abs(ref - avg);
+        ref = mix(avg, ref, step(vec4(deband_threshold / float(i)), diff));
+    }
+
+    // Add some noise to hide the remaining quantization.
+    vec3 noise;
+    noise.x = rand(h); h = permute(h);
+    noise.y = rand(h); h = permute(h);
+    noise.z = rand(h);
+    ref.rgb += deband_grain * (noise - vec3(0.5));
+    out_color = ref;
+}
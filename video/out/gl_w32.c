@@ -28,6 +28,7 @@ struct w32_context {
     HGLRC context;
     HDC hdc;
     int flags;
+    BOOL (GLAPIENTRY *wglGetSyncValuesOML)(HDC, INT64 *, INT64 *, INT64 *);
 };
 
 static bool create_dc(struct MPGLContext *ctx, int flags)
@@ -107,6 +108,7 @@ static bool create_context_w32_old(struct MPGLContext *ctx)
     w32_ctx->context = context;
 
     mpgl_load_functions(ctx->gl, w32gpa, NULL, ctx->vo->log);
+    w32_ctx->wglGetSyncValuesOML = w32gpa((const GLubyte*)"wglGetSyncValuesOML");
     return true;
 }
 
@@ -183,6 +185,7 @@ static bool create_context_w32_gl3(struct MPGLContext *ctx)
 
     /* update function pointers */
     mpgl_load_functions(ctx->gl, w32gpa, NULL, ctx->vo->log);
+    w32_ctx->wglGetSyncValuesOML = w32gpa((const GLubyte*)"wglGetSyncValuesOML");
 
     return true;
 
@@ -252,12 +255,30 @@ static void swapGlBuffers_w32(MPGLContext *ctx)
     SwapBuffers(w32_ctx->hdc);
 }
 
+static bool get_present_feedback_w32(MPGLContext *ctx,
+                                     struct vo_present_feedback *fb)
+{
+    struct w32_context *w32_ctx = ctx->priv;
+
+    INT64 ust, msc, sbc;
+    if (!w32_ctx->wglGetSyncValuesOML ||
+        !w32_ctx->wglGetSyncValuesOML(w32_ctx->hdc, &ust, &msc, &sbc))
+        return false;
+
+    // The UST unit is unspecified with WGL, so only the counter is used.
+    *fb = (struct vo_present_feedback){
+        .vsync_count = msc,
+    };
+    return true;
+}
+
 void mpgl_set_backend_w32(MPGLContext *ctx)
 {
     ctx->priv = talloc_zero(ctx, struct w32_context);
     ctx->config_window = config_window_w32;
     ctx->releaseGlContext = releaseGlContext_w32;
     ctx->swapGlBuffers = swapGlBuffers_w32;
+    ctx->get_present_feedback = get_present_feedback_w32;
     ctx->vo_init = vo_w32_init;
     ctx->vo_uninit = vo_w32_uninit;
     ctx->vo_control = vo_w32_control;
@@ -198,9 +198,21 @@ static void releaseGlContext_wayland(MPGLContext *ctx)
 static void swapGlBuffers_wayland(MPGLContext *ctx)
 {
     struct vo_wayland_state *wl = ctx->vo->wayland;
+
+    // Keep at most one frame queued in the compositor: wait until it showed
+    // the previous one, and request a callback for this one (the swap commits
+    // the surface).
+    vo_wayland_wait_frame(ctx->vo);
+    vo_wayland_request_frame(ctx->vo);
     eglSwapBuffers(wl->egl_context.egl.dpy, wl->egl_context.egl_surface);
 }
 
+static bool get_present_feedback_wayland(MPGLContext *ctx,
+                                         struct vo_present_feedback *fb)
+{
+    return vo_wayland_get_present_feedback(ctx->vo, fb);
+}
+
 static int control(struct vo *vo, int *events, int request, void *data)
 {
     struct vo_wayland_state *wl = vo->wayland;
@@ -217,6 +229,7 @@ void mpgl_set_backend_wayland(MPGLContext *ctx)
     ctx->config_window = config_window_wayland;
     ctx->releaseGlContext = releaseGlContext_wayland;
     ctx->swapGlBuffers = swapGlBuffers_wayland;
+    ctx->get_present_feedback = get_present_feedback_wayland;
     ctx->vo_control = control;
     ctx->vo_init = vo_wayland_init;
     ctx->vo_uninit = vo_wayland_uninit;
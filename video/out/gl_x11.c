@@ -25,15 +25,32 @@
 #define MP_GET_GLX_WORKAROUNDS
 #include "gl_header_fixes.h"
 
+#include "osdep/timer.h"
 #include "x11_common.h"
 #include "gl_common.h"
 
+typedef Bool (*glXGetSyncValuesOMLProc)
+    (Display*, GLXDrawable, int64_t*, int64_t*, int64_t*);
+
 struct glx_context {
     XVisualInfo *vinfo;
     GLXContext context;
     GLXFBConfig fbc;
+    glXGetSyncValuesOMLProc glXGetSyncValuesOML;
 };
 
+static void init_sync_control(struct MPGLContext *ctx, const char *glxstr)
+{
+    struct glx_context *glx_ctx = ctx->priv;
+
+    if (glxstr && strstr(glxstr, "GLX_OML_sync_control")) {
+        glx_ctx->glXGetSyncValuesOML = (glXGetSyncValuesOMLProc)
+            glXGetProcAddressARB((const GLubyte *)"glXGetSyncValuesOML");
+    }
+    if (glx_ctx->glXGetSyncValuesOML)
+        MP_VERBOSE(ctx->vo, "Using GLX_OML_sync_control.\n");
+}
+
 static bool create_context_x11_old(struct MPGLContext *ctx)
 {
     struct glx_context *glx_ctx = ctx->priv;
@@ -65,6 +82,7 @@ static bool create_context_x11_old(struct MPGLContext *ctx)
     const char *glxstr = glXQueryExtensionsString(display, ctx->vo->x11->screen);
 
     mpgl_load_functions(gl, (void *)glXGetProcAddressARB, glxstr, vo->log);
+    init_sync_control(ctx, glxstr);
 
     glx_ctx->context = new_context;
 
@@ -123,6 +141,7 @@ static bool create_context_x11_gl3(struct MPGLContext *ctx, bool debug)
     glx_ctx->context = context;
 
     mpgl_load_functions(ctx->gl, (void *)glXGetProcAddress, glxstr, vo->log);
+    init_sync_control(ctx, glxstr);
 
     if (!glXIsDirect(vo->x11->display, context))
         ctx->gl->mpgl_caps &= ~MPGL_CAP_NO_SW;
@@ -290,12 +309,41 @@ static void swapGlBuffers_x11(MPGLContext *ctx)
     glXSwapBuffers(ctx->vo->x11->display, ctx->vo->x11->window);
 }
 
+static bool get_present_feedback_x11(MPGLContext *ctx,
+                                     struct vo_present_feedback *fb)
+{
+    struct glx_context *glx_ctx = ctx->priv;
+
+    if (!glx_ctx->glXGetSyncValuesOML)
+        return false;
+
+    int64_t ust, msc, sbc;
+    if (!glx_ctx->glXGetSyncValuesOML(ctx->vo->x11->display,
+                                      ctx->vo->x11->window, &ust, &msc, &sbc))
+        return false;
+
+    // UST is in microseconds, and with Mesa uses CLOCK_MONOTONIC, the same
+    // clock as mp_time_us(). Offsets are not the same, and other drivers
+    // might use a different clock, so check whether the result is plausible.
+    int64_t now = mp_time_us();
+    int64_t vsync_time = ust - (int64_t)mp_raw_time_us() + now;
+    if (vsync_time > now || vsync_time < now - 1000000)
+        vsync_time = 0;
+
+    *fb = (struct vo_present_feedback){
+        .vsync_count = msc,
+        .vsync_time = vsync_time,
+    };
+    return true;
+}
+
 void mpgl_set_backend_x11(MPGLContext *ctx)
 {
     ctx->priv = talloc_zero(ctx, struct glx_context);
     ctx->config_window = config_window_x11;
     ctx->releaseGlContext = releaseGlContext_x11;
     ctx->swapGlBuffers = swapGlBuffers_x11;
+    ctx->get_present_feedback = get_present_feedback_x11;
     ctx->vo_init = vo_x11_init;
     ctx->vo_uninit = vo_x11_uninit;
     ctx->vo_control = vo_x11_control;
@@ -42,6 +42,7 @@
 #include "input/input.h"
 #include "options/m_config.h"
 #include "common/msg.h"
+#include "common/stats.h"
 #include "common/global.h"
 #include "video/mp_image.h"
 #include "video/vfcap.h"
@@ -54,6 +55,7 @@ extern const struct vo_driver video_out_xv;
 extern const struct vo_driver video_out_opengl;
 extern const struct vo_driver video_out_opengl_hq;
 extern const struct vo_driver video_out_opengl_old;
+extern const struct vo_driver video_out_opengl_cb;
 extern const struct vo_driver video_out_null;
 extern const struct vo_driver video_out_image;
 extern const struct vo_driver video_out_lavc;
@@ -102,6 +104,7 @@ const struct vo_driver *const video_out_drivers[] =
 #endif
 #if HAVE_GL
         &video_out_opengl_hq,
+        &video_out_opengl_cb,
 #endif
 #if HAVE_WAYLAND
         &video_out_wayland,
@@ -109,6 +112,23 @@ const struct vo_driver *const video_out_drivers[] =
         NULL
 };
 
+// Maximum number of frames queued for display (not counting the frame being
+// rendered). With --low-latency, only 1 frame is queued.
+#define VO_MAX_QUEUE 3
+
+// Frames are accepted at most this long before they should be displayed.
+// With --low-latency, frames are accepted only once they're due.
+#define VO_QUEUE_AHEAD (0.100 * 1e6)
+
+// Frames are rendered at most this long before they should be displayed.
+#define VO_RENDER_AHEAD (0.050 * 1e6)
+
+struct vo_queued_frame {
+    struct mp_image *image;
+    int64_t pts;                    // realtime of intended display
+    int64_t duration;               // realtime frame duration (for framedrop)
+};
+
 struct vo_internal {
     pthread_t thread;
     struct mp_dispatch_queue *dispatch;
@@ -131,20 +151,34 @@ struct vo_internal {
     int64_t flip_queue_offset; // queue flip events at most this much in advance
 
     int64_t drop_count;
+    int64_t missed_count;           // vsyncs missed according to feedback
     bool dropped_frame;             // the previous frame was dropped
     struct mp_image *dropped_image; // used to possibly redraw the dropped frame
 
     int64_t wakeup_pts;             // time at which to pull frame from decoder
 
+    int64_t last_resize;            // time of the last window size change
+    int64_t resize_check;           // time at which to check events again
+
     bool rendering;                 // true if an image is being rendered
-    struct mp_image *frame_queued;  // the image that should be rendered
-    int64_t frame_pts;              // realtime of intended display
-    int64_t frame_duration;         // realtime frame duration (for framedrop)
+    // Frames that should be rendered, in display order
+    struct vo_queued_frame queue[VO_MAX_QUEUE];
+    int num_queued;
+    int64_t frame_pts;              // realtime of intended display, and
+    int64_t frame_duration;         // duration, of the last rendered frame
 
     // --- The following fields can be accessed from the VO thread only
     int64_t vsync_interval;
+    bool interpolation;
     int64_t last_flip;
     char *window_title;
+
+    // Presentation feedback (VOCTRL_GET_PRESENT_FEEDBACK)
+    bool have_feedback;             // feedback and pts for the last flip
+    struct vo_present_feedback feedback;
+    int64_t feedback_pts;
+    struct vo_present_feedback feedback_base; // start of measurement
+    int64_t measured_vsync;         // vsync interval from feedback, or 0
 };
 
 static void forget_frames(struct vo *vo);
@@ -200,7 +234,8 @@ static void dealloc_vo(struct vo *vo)
 static struct vo *vo_create(struct mpv_global *global,
                             struct input_ctx *input_ctx, struct osd_state *osd,
                             struct encode_lavc_context *encode_lavc_ctx,
-                            char *name, char **args)
+                            struct mpv_opengl_cb_context *opengl_cb_ctx,
+                            struct mp_vo_opts *opts, char *name, char **args)
 {
     struct mp_log *log = mp_log_new(NULL, global->log, "vo");
     struct m_obj_desc desc;
@@ -213,9 +248,10 @@ static struct vo *vo_create(struct mpv_global *global,
     *vo = (struct vo) {
         .log = mp_log_new(vo, log, name),
         .driver = desc.p,
-        .opts = &global->opts->vo,
+        .opts = opts,
         .global = global,
         .encode_lavc_ctx = encode_lavc_ctx,
+        .opengl_cb_context = opengl_cb_ctx,
         .input_ctx = input_ctx,
         .osd = osd,
         .event_fd = -1,
@@ -254,10 +290,12 @@ error:
     return NULL;
 }
 
-struct vo *init_best_video_out(struct mpv_global *global,
-                               struct input_ctx *input_ctx,
-                               struct osd_state *osd,
-                               struct encode_lavc_context *encode_lavc_ctx)
+static struct vo *create_best_vo(struct mpv_global *global,
+                                 struct input_ctx *input_ctx,
+                                 struct osd_state *osd,
+                                 struct encode_lavc_context *encode_lavc_ctx,
+                                 struct mpv_opengl_cb_context *opengl_cb_ctx,
+                                 struct mp_vo_opts *opts)
 {
     struct m_obj_settings *vo_list = global->opts->vo.video_driver_list;
     // first try the preferred drivers, with their optional subdevice param:
@@ -267,7 +305,8 @@ struct vo *init_best_video_out(struct mpv_global *global,
             if (strlen(vo_list[n].name) == 0)
                 goto autoprobe;
             struct vo *vo = vo_create(global, input_ctx, osd, encode_lavc_ctx,
-                                      vo_list[n].name, vo_list[n].attribs);
+                                      opengl_cb_ctx, opts, vo_list[n].name,
+                                      vo_list[n].attribs);
             if (vo)
                 return vo;
         }
@@ -277,6 +316,7 @@ autoprobe:
     // now try the rest...
     for (int i = 0; video_out_drivers[i]; i++) {
         struct vo *vo = vo_create(global, input_ctx, osd, encode_lavc_ctx,
+                                  opengl_cb_ctx, opts,
                                   (char *)video_out_drivers[i]->name, NULL);
         if (vo)
             return vo;
@@ -284,6 +324,28 @@ autoprobe:
     return NULL;
 }
 
+struct vo *init_best_video_out(struct mpv_global *global,
+                               struct input_ctx *input_ctx,
+                               struct osd_state *osd,
+                               struct encode_lavc_context *encode_lavc_ctx,
+                               struct mpv_opengl_cb_context *opengl_cb_ctx)
+{
+    return create_best_vo(global, input_ctx, osd, encode_lavc_ctx,
+                          opengl_cb_ctx, &global->opts->vo);
+}
+
+// Create an additional VO, selected the same way as with
+// init_best_video_out(), but using the given window options instead of the
+// global ones. opts must stay valid until the VO is destroyed.
+struct vo *init_secondary_video_out(struct mpv_global *global,
+                                    struct input_ctx *input_ctx,
+                                    struct osd_state *osd,
+                                    struct encode_lavc_context *encode_lavc_ctx,
+                                    struct mp_vo_opts *opts)
+{
+    return create_best_vo(global, input_ctx, osd, encode_lavc_ctx, NULL, opts);
+}
+
 void vo_destroy(struct vo *vo)
 {
     struct vo_internal *in = vo->in;
@@ -304,9 +366,20 @@ static void update_display_fps(struct vo *vo)
         vo->driver->control(vo, VOCTRL_GET_DISPLAY_FPS, &display_fps);
     }
     int64_t n_interval = MPMAX((int64_t)(1e6 / display_fps), 1);
-    if (vo->in->vsync_interval != n_interval)
-        MP_VERBOSE(vo, "Assuming %f FPS for framedrop.\n", display_fps);
+    // The measured rate includes the drift against our clock.
+    if (vo->in->measured_vsync > 0 && !(vo->global->opts->frame_drop_fps > 0))
+        n_interval = vo->in->measured_vsync;
+    int64_t old_interval = vo->in->vsync_interval;
+    if (llabs(old_interval - n_interval) > n_interval / 1000)
+        MP_VERBOSE(vo, "Assuming %f FPS for framedrop.\n", 1e6 / n_interval);
     vo->in->vsync_interval = n_interval;
+
+    bool interpolation = false;
+    if (vo->driver->draw_image_blend)
+        vo->driver->control(vo, VOCTRL_GET_INTERPOLATION, &interpolation);
+    if (vo->in->interpolation != interpolation)
+        MP_VERBOSE(vo, "Frame interpolation %s.\n", interpolation ? "on" : "off");
+    vo->in->interpolation = interpolation;
 }
 
 static void check_vo_caps(struct vo *vo)
@@ -383,7 +456,10 @@ static void forget_frames(struct vo *vo)
     in->hasframe = false;
     in->hasframe_rendered = false;
     in->drop_count = 0;
-    mp_image_unrefp(&in->frame_queued);
+    in->missed_count = 0;
+    for (int n = 0; n < in->num_queued; n++)
+        mp_image_unrefp(&in->queue[n].image);
+    in->num_queued = 0;
     mp_image_unrefp(&in->dropped_image);
 }
 
@@ -464,9 +540,35 @@ void vo_wakeup(struct vo *vo)
     pthread_mutex_unlock(&in->lock);
 }
 
-// Whether vo_queue_frame() can be called. If the VO is not ready yet, the
-// function will return false, and the VO will call the wakeup callback once
-// it's ready.
+// Minimum time between window size changes applied by the VO.
+#define RESIZE_INTERVAL (50 * 1000)
+
+// Called by the windowing code when the window size changed, before it sets
+// vo->dwidth/dheight and sends VO_EVENT_RESIZE. If this returns false, the
+// window is being resized interactively, and the new size should be left
+// pending; the VO thread checks events again when the interval has passed,
+// so the final size is always applied. This bounds the number of times the
+// VO reallocates its window-sized buffers during a resize.
+bool vo_resize_allowed(struct vo *vo)
+{
+    struct vo_internal *in = vo->in;
+    int64_t now = mp_time_us();
+
+    pthread_mutex_lock(&in->lock);
+    bool allowed = now - in->last_resize >= RESIZE_INTERVAL;
+    if (allowed) {
+        in->last_resize = now;
+        in->resize_check = 0;
+    } else {
+        in->resize_check = in->last_resize + RESIZE_INTERVAL;
+    }
+    pthread_mutex_unlock(&in->lock);
+    return allowed;
+}
+
+// Whether vo_queue_frame() can be called. If the VO is not ready yet (the
+// queue is full), the function will return false, and the VO will call the
+// wakeup callback once it's ready.
 // next_pts is the exact time when the next frame should be displayed. If the
 // VO is ready, but the time is too "early", return false, and call the wakeup
 // callback once the time is right.
@@ -474,12 +576,14 @@ bool vo_is_ready_for_frame(struct vo *vo, int64_t next_pts)
 {
     struct vo_internal *in = vo->in;
     pthread_mutex_lock(&in->lock);
-    bool r = vo->config_ok && !in->frame_queued;
+    bool low_latency = vo->global->opts->low_latency;
+    int max_queue = low_latency ? 1 : VO_MAX_QUEUE;
+    bool r = vo->config_ok && in->num_queued < max_queue;
     if (r) {
-        // Don't show the frame too early - it would basically freeze the
-        // display by disallowing OSD redrawing or VO interaction.
-        // Actually render the frame at earliest 50ms before target time.
-        next_pts -= 0.050 * 1e6;
+        // Don't queue frames too early, so that the player can still adjust
+        // A/V sync with the frames that follow.
+        if (!low_latency)
+            next_pts -= VO_QUEUE_AHEAD;
         next_pts -= in->flip_queue_offset;
         int64_t now = mp_time_us();
         if (next_pts > now)
@@ -493,7 +597,8 @@ bool vo_is_ready_for_frame(struct vo *vo, int64_t next_pts)
     return r;
 }
 
-// Direct the VO thread to put the currently queued image on the screen.
+// Append the image to the queue of frames the VO thread puts on the screen at
+// their display time (pts_us).
 // vo_is_ready_for_frame() must have returned true before this call.
 // Ownership of the image is handed to the vo.
 void vo_queue_frame(struct vo *vo, struct mp_image *image,
@@ -501,23 +606,25 @@ void vo_queue_frame(struct vo *vo, struct mp_image *image,
 {
     struct vo_internal *in = vo->in;
     pthread_mutex_lock(&in->lock);
-    assert(vo->config_ok && !in->frame_queued);
+    assert(vo->config_ok && in->num_queued < VO_MAX_QUEUE);
     in->hasframe = true;
-    in->frame_queued = image;
-    in->frame_pts = pts_us;
-    in->frame_duration = duration;
-    in->wakeup_pts = in->frame_pts + MPMAX(duration, 0);
+    in->queue[in->num_queued++] = (struct vo_queued_frame){
+        .image = image,
+        .pts = pts_us,
+        .duration = duration,
+    };
+    in->wakeup_pts = pts_us + MPMAX(duration, 0);
     wakeup_locked(vo);
     pthread_mutex_unlock(&in->lock);
 }
 
-// If a frame is currently being rendered (or queued), wait until it's done.
+// If frames are currently being rendered (or queued), wait until they're done.
 // Otherwise, return immediately.
 void vo_wait_frame(struct vo *vo)
 {
     struct vo_internal *in = vo->in;
     pthread_mutex_lock(&in->lock);
-    while (in->frame_queued || in->rendering)
+    while (in->num_queued || in->rendering)
         pthread_cond_wait(&in->wakeup, &in->lock);
     pthread_mutex_unlock(&in->lock);
 }
@@ -533,6 +640,66 @@ static int64_t prev_sync(struct vo *vo, int64_t ts)
     return ts - offset;
 }
 
+// Time at which the first queued frame should be rendered. Must be called
+// locked, with a non-empty queue.
+static int64_t get_render_time(struct vo *vo)
+{
+    struct vo_internal *in = vo->in;
+    return in->queue[0].pts - VO_RENDER_AHEAD - in->flip_queue_offset;
+}
+
+// Called after a video frame was flipped. If the VO provides presentation
+// feedback, use it to get the exact vsync phase and refresh rate, and to
+// count vsyncs which were missed (frames shown later than intended).
+static void update_present_feedback(struct vo *vo, int64_t pts)
+{
+    struct vo_internal *in = vo->in;
+
+    struct vo_present_feedback fb = {0};
+    if (vo->driver->control(vo, VOCTRL_GET_PRESENT_FEEDBACK, &fb) < 1) {
+        in->have_feedback = false;
+        return;
+    }
+
+    if (in->have_feedback && fb.vsync_count >= in->feedback.vsync_count) {
+        int64_t vsyncs = fb.vsync_count - in->feedback.vsync_count;
+        int64_t expected = (pts - in->feedback_pts + in->vsync_interval / 2)
+                           / in->vsync_interval;
+        expected = MPMAX(expected, 1);
+        if (vsyncs > expected) {
+            MP_DBG(vo, "Missed %"PRId64" vsyncs.\n", vsyncs - expected);
+            pthread_mutex_lock(&in->lock);
+            in->missed_count += vsyncs - expected;
+            pthread_mutex_unlock(&in->lock);
+        }
+    }
+
+    if (fb.vsync_time) {
+        in->last_flip = fb.vsync_time;
+
+        struct vo_present_feedback *base = &in->feedback_base;
+        if (!base->vsync_time || fb.vsync_count < base->vsync_count ||
+            fb.vsync_time < base->vsync_time)
+        {
+            *base = fb;
+        } else {
+            // Average over at least 100 vsyncs. Restart the measurement from
+            // time to time, so that changes of the actual rate are picked up.
+            int64_t count = fb.vsync_count - base->vsync_count;
+            if (count >= 100) {
+                in->measured_vsync =
+                    (fb.vsync_time - base->vsync_time + count / 2) / count;
+            }
+            if (count >= 3000)
+                *base = fb;
+        }
+    }
+
+    in->have_feedback = true;
+    in->feedback = fb;
+    in->feedback_pts = pts;
+}
+
 static bool render_frame(struct vo *vo)
 {
     struct vo_internal *in = vo->in;
@@ -541,22 +708,29 @@ static bool render_frame(struct vo *vo)
 
     pthread_mutex_lock(&in->lock);
 
-    int64_t pts = in->frame_pts;
-    int64_t duration = in->frame_duration;
-    struct mp_image *img = in->frame_queued;
-    if (!img) {
+    if (!in->num_queued || get_render_time(vo) > mp_time_us()) {
         pthread_mutex_unlock(&in->lock);
         return false;
     }
 
+    struct vo_queued_frame frame = in->queue[0];
+    MP_TARRAY_REMOVE_AT(in->queue, in->num_queued, 0);
+    int64_t pts = frame.pts;
+    int64_t duration = frame.duration;
+    struct mp_image *img = frame.image;
+    in->frame_pts = pts;
+    in->frame_duration = duration;
+
     mp_image_unrefp(&in->dropped_image);
 
     in->rendering = true;
-    in->frame_queued = NULL;
 
     // The next time a flip (probably) happens.
     int64_t next_vsync = prev_sync(vo, mp_time_us()) + in->vsync_interval;
     int64_t end_time = pts + duration;
+    // The frame is replaced before its end if the next one is due earlier.
+    if (in->num_queued)
+        end_time = MPMIN(end_time, in->queue[0].pts);
 
     if (!(vo->global->opts->frame_dropping & 1) || !in->hasframe_rendered ||
         vo->driver->untimed || vo->driver->encode)
@@ -568,6 +742,22 @@ static bool render_frame(struct vo *vo)
     // instead of just freezing the display forever.
     in->dropped_frame &= mp_time_us() - in->last_flip < 100 * 1000;
 
+    // With interpolation, the vsync during which the frame starts shows a
+    // mix of the previous and the new frame, weighted by how much of the
+    // vsync interval each of them covers. The vsync after it shows the new
+    // frame alone, so frames must last at least 2 vsyncs.
+    double mix = 1.0;
+    if (in->interpolation && in->hasframe_rendered && !in->paused &&
+        !vo->driver->untimed && !vo->driver->encode &&
+        in->frame_duration >= 2 * in->vsync_interval)
+    {
+        int64_t flip_vsync = prev_sync(vo, pts) + in->vsync_interval;
+        mix = (flip_vsync - pts) / (double)in->vsync_interval;
+        // Not worth it if one of the frames dominates anyway.
+        if (mix < 1 / 16.0 || mix > 15 / 16.0)
+            mix = 1.0;
+    }
+
     if (in->dropped_frame) {
         in->dropped_image = img;
     } else {
@@ -575,24 +765,51 @@ static bool render_frame(struct vo *vo)
         pthread_mutex_unlock(&in->lock);
         mp_input_wakeup(vo->input_ctx); // core can queue new video now
 
-        MP_STATS(vo, "start video");
+        MP_STATS_START(vo, "video");
 
-        vo->driver->draw_image(vo, img);
-
-        int64_t target = pts - in->flip_queue_offset;
-        while (1) {
-            int64_t now = mp_time_us();
-            if (target <= now)
-                break;
-            mp_sleep_us(target - now);
+        if (mix < 1.0) {
+            vo->driver->draw_image_blend(vo, img, mix);
+        } else {
+            vo->driver->draw_image(vo, img);
         }
 
+        mp_sleep_until_us(pts - in->flip_queue_offset);
+
         bool drop = false;
         if (vo->driver->flip_page_timed)
             drop = vo->driver->flip_page_timed(vo, pts, duration) < 1;
         else
             vo->driver->flip_page(vo);
 
+        if (mix < 1.0) {
+            // Show the new frame alone on the next vsync.
+            vo->driver->control(vo, VOCTRL_REDRAW_FRAME, NULL);
+            if (vo->driver->flip_page_timed)
+                vo->driver->flip_page_timed(vo, 0, -1);
+            else
+                vo->driver->flip_page(vo);
+        }
+
+        // With field rate deinterlacing, the second field is shown halfway
+        // through the frame, unless the next frame replaces it before that.
+        if (mix >= 1.0 && !drop && frame.duration > 0 && !in->paused &&
+            !vo->driver->untimed && !vo->driver->encode)
+        {
+            int64_t field_pts = pts + frame.duration / 2;
+            pthread_mutex_lock(&in->lock);
+            bool replaced = in->num_queued && in->queue[0].pts <= field_pts;
+            pthread_mutex_unlock(&in->lock);
+            if (!replaced &&
+                vo->driver->control(vo, VOCTRL_DRAW_SECOND_FIELD, NULL) == VO_TRUE)
+            {
+                mp_sleep_until_us(field_pts - in->flip_queue_offset);
+                if (vo->driver->flip_page_timed)
+                    vo->driver->flip_page_timed(vo, 0, -1);
+                else
+                    vo->driver->flip_page(vo);
+            }
+        }
+
         in->last_flip = -1;
 
         vo->driver->control(vo, VOCTRL_GET_RECENT_FLIP_TIME, &in->last_flip);
@@ -600,11 +817,13 @@ static bool render_frame(struct vo *vo)
         if (in->last_flip < 0)
             in->last_flip = mp_time_us();
 
+        update_present_feedback(vo, pts);
+
         long phase = in->last_flip % in->vsync_interval;
         MP_DBG(vo, "phase: %ld\n", phase);
-        MP_STATS(vo, "value %ld phase", phase);
+        MP_STATS_VALUE(vo, "phase", phase);
 
-        MP_STATS(vo, "end video");
+        MP_STATS_END(vo, "video");
 
         pthread_mutex_lock(&in->lock);
         in->dropped_frame = drop;
@@ -645,6 +864,8 @@ static void do_redraw(struct vo *vo)
     if (!vo->config_ok || skip)
         return;
 
+    in->have_feedback = false;
+
     if (img) {
         vo->driver->draw_image(vo, img);
     } else {
@@ -663,6 +884,10 @@ static void *vo_thread(void *ptr)
     struct vo *vo = ptr;
     struct vo_internal *in = vo->in;
 
+    struct mp_thread_sched_opts *sched = &vo->global->opts->video_thread_sched;
+    mpthread_set_sched(vo->log, sched->priority, sched->cpu);
+    mpthread_set_timer_slack(1);
+
     int r = vo->driver->preinit(vo) ? -1 : 0;
     mp_rendezvous(vo, r); // init barrier
     if (r < 0)
@@ -677,6 +902,13 @@ static void *vo_thread(void *ptr)
         int64_t now = mp_time_us();
         int64_t wait_until = now + (frame_shown ? 0 : (int64_t)1e9);
         pthread_mutex_lock(&in->lock);
+        if (in->num_queued)
+            wait_until = MPMIN(wait_until, get_render_time(vo));
+        if (in->resize_check) {
+            wait_until = MPMIN(wait_until, in->resize_check);
+            if (in->resize_check <= now)
+                in->resize_check = 0;
+        }
         if (in->wakeup_pts) {
             if (in->wakeup_pts > now) {
                 wait_until = MPMIN(wait_until, in->wakeup_pts);
@@ -719,6 +951,16 @@ int64_t vo_get_drop_count(struct vo *vo)
     return r;
 }
 
+// Number of vsyncs missed since the last seek, according to the VO's
+// presentation feedback. 0 if the VO doesn't provide it.
+int64_t vo_get_missed_count(struct vo *vo)
+{
+    pthread_mutex_lock(&vo->in->lock);
+    int64_t r = vo->in->missed_count;
+    pthread_mutex_unlock(&vo->in->lock);
+    return r;
+}
+
 // Make the VO redraw the OSD at some point in the future.
 void vo_redraw(struct vo *vo)
 {
@@ -747,7 +989,7 @@ bool vo_still_displaying(struct vo *vo)
     pthread_mutex_lock(&vo->in->lock);
     int64_t now = mp_time_us();
     int64_t frame_end = in->frame_pts + MPMAX(in->frame_duration, 0);
-    bool working = now < frame_end || in->rendering || in->frame_queued;
+    bool working = now < frame_end || in->rendering || in->num_queued;
     pthread_mutex_unlock(&vo->in->lock);
     return working && in->hasframe;
 }
@@ -773,6 +1015,56 @@ int vo_query_format(struct vo *vo, int format)
     return ret;
 }
 
+struct vo_dr_image {
+    struct vo *vo;
+    struct mp_image *img;
+};
+
+static void run_free_dr_image(void *p)
+{
+    struct vo_dr_image *dr = p;
+    talloc_free(dr->img);
+}
+
+// Can be called from any thread.
+static void free_dr_image(void *p)
+{
+    struct vo_dr_image *dr = p;
+    struct vo *vo = dr->vo;
+    if (pthread_equal(pthread_self(), vo->in->thread)) {
+        run_free_dr_image(dr);
+        talloc_free(dr);
+    } else {
+        mp_dispatch_enqueue_autofree(vo->in->dispatch, run_free_dr_image, dr);
+    }
+}
+
+static void run_get_image(void *p)
+{
+    void **pp = p;
+    struct vo *vo = pp[0];
+    *(struct mp_image **)pp[5] = vo->driver->get_image(vo, *(int *)pp[1],
+                            *(int *)pp[2], *(int *)pp[3], *(int *)pp[4]);
+}
+
+// Return an image for direct rendering (see vo_driver.get_image), or NULL.
+// The image can be freed from any thread, but all images must be freed before
+// the VO is destroyed.
+struct mp_image *vo_get_image(struct vo *vo, int imgfmt, int w, int h,
+                              int stride_align)
+{
+    if (!vo->driver->get_image)
+        return NULL;
+    struct mp_image *img = NULL;
+    void *p[] = {vo, &imgfmt, &w, &h, &stride_align, &img};
+    mp_dispatch_run(vo->in->dispatch, run_get_image, p);
+    if (!img)
+        return NULL;
+    struct vo_dr_image *dr = talloc_ptrtype(NULL, dr);
+    *dr = (struct vo_dr_image){ .vo = vo, .img = img };
+    return mp_image_new_custom_ref(img, dr, free_dr_image);
+}
+
 // Calculate the appropriate source and destination rectangle to
 // get a correctly scaled picture, including pan-scan.
 // out_src: visible part of the video
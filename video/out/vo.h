@@ -72,6 +72,11 @@ enum mp_voctrl {
     VOCTRL_SET_DEINTERLACE,
     VOCTRL_GET_DEINTERLACE,
 
+    // Render the second field of the image passed to draw_image(), if the VO
+    // deinterlaces at field rate. Returns VO_TRUE if it was rendered; it is
+    // shown with the next flip_page.
+    VOCTRL_DRAW_SECOND_FIELD,
+
     // Return or set window size (not-fullscreen mode only - if fullscreened,
     // these must access the not-fullscreened window size only).
     VOCTRL_GET_UNFS_WINDOW_SIZE,        // int[2] (w/h)
@@ -89,8 +94,12 @@ enum mp_voctrl {
     VOCTRL_GET_ICC_PROFILE_PATH,        // char**
     VOCTRL_GET_DISPLAY_FPS,             // double*
     VOCTRL_GET_RECENT_FLIP_TIME,        // int64_t* (using mp_time_us())
+    VOCTRL_GET_INTERPOLATION,           // bool* (draw_image_blend enabled)
+    VOCTRL_GET_PRESENT_FEEDBACK,        // struct vo_present_feedback*
 
     VOCTRL_GET_PREF_DEINT,              // int*
+
+    VOCTRL_GET_PASS_TIMINGS,            // struct voctrl_pass_timings*
 };
 
 // VOCTRL_SET_EQUALIZER
@@ -124,6 +133,18 @@ struct voctrl_screenshot_args {
     bool has_osd;
 };
 
+// VOCTRL_GET_PASS_TIMINGS
+#define VO_MAX_PASS_TIMINGS 16
+struct voctrl_pass_timings {
+    int num_passes;
+    struct voctrl_pass_timing {
+        const char *name;       // static string
+        int64_t last_ns;        // most recent measurement
+        int64_t avg_ns;         // average over the recent frames
+        int64_t peak_ns;        // maximum over the recent frames
+    } passes[VO_MAX_PASS_TIMINGS];
+};
+
 #define VO_TRUE         true
 #define VO_FALSE        false
 #define VO_ERROR        -1
@@ -136,6 +157,12 @@ struct voctrl_screenshot_args {
 #define VOFLAG_GL_DEBUG         0x40  // Hint to request debug OpenGL context
 #define VOFLAG_ALPHA            0x80  // Hint to request alpha framebuffer
 
+// VOCTRL_GET_PRESENT_FEEDBACK, queried after each flip.
+struct vo_present_feedback {
+    int64_t vsync_count;    // counter of the most recent display vsync
+    int64_t vsync_time;     // mp_time_us() time of that vsync, 0 if unknown
+};
+
 // VO does handle mp_image_params.rotate in 90 degree steps
 #define VO_CAP_ROTATE90 1
 // VO does framedrop itself (vo_vdpau). Untimed/encoding VOs never drop.
@@ -143,6 +170,7 @@ struct voctrl_screenshot_args {
 
 struct vo;
 struct osd_state;
+struct mpv_opengl_cb_context;
 struct mp_image;
 struct mp_image_params;
 
@@ -193,6 +221,14 @@ struct vo_driver {
      */
     void (*draw_image)(struct vo *vo, struct mp_image *mpi);
 
+    /*
+     * Like draw_image, but render mpi blended with the frame drawn before it
+     * (optional, used if VOCTRL_GET_INTERPOLATION returns true). mix is the
+     * weight of mpi, from 0.0 to 1.0. VOCTRL_REDRAW_FRAME must render mpi
+     * without blending.
+     */
+    void (*draw_image_blend)(struct vo *vo, struct mp_image *mpi, double mix);
+
     /*
      * Blit/Flip buffer to the screen. Must be called after each frame!
      */
@@ -209,6 +245,16 @@ struct vo_driver {
      */
     int (*flip_page_timed)(struct vo *vo, int64_t pts_us, int duration);
 
+    /*
+     * Allocate an image the decoder can render into directly (optional).
+     * The image must be freed on the VO thread (vo_get_image() takes care of
+     * it). Images are at least w/h in size, and plane pointers and strides
+     * are aligned to stride_align.
+     * Returns NULL if direct rendering is not possible.
+     */
+    struct mp_image *(*get_image)(struct vo *vo, int imgfmt, int w, int h,
+                                  int stride_align);
+
     /* These optional callbacks can be provided if the GUI framework used by
      * the VO requires entering a message loop for receiving events, does not
      * provide event_fd, and does not call vo_wakeup() from a separate thread
@@ -252,6 +298,7 @@ struct vo {
     struct input_ctx *input_ctx;
     struct osd_state *osd;
     struct encode_lavc_context *encode_lavc_ctx;
+    struct mpv_opengl_cb_context *opengl_cb_context; // for --vo=opengl-cb
     struct vo_internal *in;
     struct mp_vo_opts *opts;
 
@@ -281,7 +328,13 @@ struct mpv_global;
 struct vo *init_best_video_out(struct mpv_global *global,
                                struct input_ctx *input_ctx,
                                struct osd_state *osd,
-                               struct encode_lavc_context *encode_lavc_ctx);
+                               struct encode_lavc_context *encode_lavc_ctx,
+                               struct mpv_opengl_cb_context *opengl_cb_ctx);
+struct vo *init_secondary_video_out(struct mpv_global *global,
+                                    struct input_ctx *input_ctx,
+                                    struct osd_state *osd,
+                                    struct encode_lavc_context *encode_lavc_ctx,
+                                    struct mp_vo_opts *opts);
 int vo_reconfig(struct vo *vo, struct mp_image_params *p, int flags);
 
 int vo_control(struct vo *vo, uint32_t request, void *data);
@@ -296,11 +349,15 @@ void vo_seek_reset(struct vo *vo);
 void vo_destroy(struct vo *vo);
 void vo_set_paused(struct vo *vo, bool paused);
 int64_t vo_get_drop_count(struct vo *vo);
+int64_t vo_get_missed_count(struct vo *vo);
 int vo_query_format(struct vo *vo, int format);
+struct mp_image *vo_get_image(struct vo *vo, int imgfmt, int w, int h,
+                              int stride_align);
 
 void vo_set_flip_queue_offset(struct vo *vo, int64_t us);
 int64_t vo_get_vsync_interval(struct vo *vo);
 void vo_wakeup(struct vo *vo);
+bool vo_resize_allowed(struct vo *vo);
 
 const char *vo_get_window_title(struct vo *vo);
 
@@ -55,6 +55,11 @@
 
 #define D3DFVF_OSD_VERTEX (D3DFVF_XYZ | D3DFVF_TEX1 | D3DFVF_DIFFUSE)
 
+// Number of textures per video plane. New frames are uploaded into the next
+// texture in the ring, so the CPU never writes a texture the GPU could still
+// be reading for the previous frame.
+#define NUM_VIDEO_TEXTURES 3
+
 typedef struct {
     float x, y, z;
     D3DCOLOR color;
@@ -94,9 +99,10 @@ struct texplane {
     // e.g. get the plane's width in pixels with (priv->src_width >> shift_x)
     int shift_x, shift_y;
     D3DFORMAT d3d_format;
-    struct d3dtex texture;
+    struct d3dtex texture[NUM_VIDEO_TEXTURES];
     // temporary locking during uploading the frame (e.g. for draw_slice)
     D3DLOCKED_RECT locked_rect;
+    struct d3dtex *locked_texture;
     // value used to clear the image with memset (YUV chroma planes do not use
     // the value 0 for this)
     uint8_t clearval;
@@ -150,6 +156,8 @@ typedef struct d3d_priv {
 
     int plane_count;
     struct texplane planes[3];
+    int cur_texture;            /**< index of the textures with the current
+                                frame in the ring */
 
     IDirect3DPixelShader9 *pixel_shader;
     const BYTE *pixel_shader_data;
@@ -411,10 +419,12 @@ static void d3d_unlock_video_objects(d3d_priv *priv)
     for (int n = 0; n < priv->plane_count; n++) {
         struct texplane *plane = &priv->planes[n];
         if (plane->locked_rect.pBits) {
-            if (FAILED(IDirect3DTexture9_UnlockRect(plane->texture.system, 0)))
+            if (FAILED(IDirect3DTexture9_UnlockRect(
+                            plane->locked_texture->system, 0)))
                 any_failed = true;
         }
         plane->locked_rect.pBits = NULL;
+        plane->locked_texture = NULL;
     }
 
     if (any_failed) {
@@ -432,8 +442,10 @@ static void d3d_destroy_video_objects(d3d_priv *priv)
     priv->d3d_surface = NULL;
 
     for (int n = 0; n < priv->plane_count; n++) {
-        d3dtex_release(priv, &priv->planes[n].texture);
+        for (int i = 0; i < NUM_VIDEO_TEXTURES; i++)
+            d3dtex_release(priv, &priv->planes[n].texture[i]);
     }
+    priv->cur_texture = 0;
 
     if (priv->pixel_shader)
         IDirect3DPixelShader9_Release(priv->pixel_shader);
@@ -473,24 +485,27 @@ static bool d3d_configure_video_objects(d3d_priv *priv)
         for (n = 0; n < priv->plane_count; n++) {
             struct texplane *plane = &priv->planes[n];
 
-            if (!plane->texture.system) {
-                if (!d3dtex_allocate(priv,
-                                     &plane->texture,
-                                     plane->d3d_format,
-                                     priv->src_width >> plane->shift_x,
-                                     priv->src_height >> plane->shift_y))
-                {
-                    MP_ERR(priv, "Allocating plane %d"
-                           " failed.\n", n);
-                    return false;
+            if (!plane->texture[0].system) {
+                for (int i = 0; i < NUM_VIDEO_TEXTURES; i++) {
+                    if (!d3dtex_allocate(priv,
+                                         &plane->texture[i],
+                                         plane->d3d_format,
+                                         priv->src_width >> plane->shift_x,
+                                         priv->src_height >> plane->shift_y))
+                    {
+                        MP_ERR(priv, "Allocating plane %d"
+                               " failed.\n", n);
+                        return false;
+                    }
                 }
 
                 MP_VERBOSE(priv, "Allocated plane %d:"
-                       " %d bit, shift=%d/%d size=%d/%d (%d/%d).\n", n,
+                       " %d bit, shift=%d/%d size=%d/%d (%d/%d) x%d.\n", n,
                        plane->bits_per_pixel,
                        plane->shift_x, plane->shift_y,
-                       plane->texture.w, plane->texture.h,
-                       plane->texture.tex_w, plane->texture.tex_h);
+                       plane->texture[0].w, plane->texture[0].h,
+                       plane->texture[0].tex_w, plane->texture[0].tex_h,
+                       NUM_VIDEO_TEXTURES);
 
                 need_clear = true;
             }
@@ -525,19 +540,34 @@ static bool d3d_configure_video_objects(d3d_priv *priv)
     return true;
 }
 
-static bool d3d_lock_video_textures(d3d_priv *priv)
+// Lock the textures with the given index in the ring. If write is set, the
+// previous contents are discarded where possible (dynamic textures in
+// D3DPOOL_DEFAULT), which lets the driver hand out fresh memory instead of
+// waiting until the GPU is done with the texture.
+static bool d3d_lock_video_textures(d3d_priv *priv, int index, bool write)
 {
+    DWORD flags = D3DLOCK_READONLY;
+    if (write)
+        flags = priv->opt_texture_memory == 2 ? D3DLOCK_DISCARD : 0;
+
+    struct d3dtex *locked = priv->planes[0].locked_texture;
+    if (locked && locked != &priv->planes[0].texture[index])
+        d3d_unlock_video_objects(priv);
+
     for (int n = 0; n < priv->plane_count; n++) {
         struct texplane *plane = &priv->planes[n];
+        struct d3dtex *tex = &plane->texture[index];
 
         if (!plane->locked_rect.pBits) {
-            if (FAILED(IDirect3DTexture9_LockRect(plane->texture.system, 0,
-                                                  &plane->locked_rect, NULL, 0)))
+            if (FAILED(IDirect3DTexture9_LockRect(tex->system, 0,
+                                                  &plane->locked_rect, NULL,
+                                                  flags)))
             {
                 MP_VERBOSE(priv, "Texture lock failure.\n");
                 d3d_unlock_video_objects(priv);
                 return false;
             }
+            plane->locked_texture = tex;
         }
     }
 
@@ -546,16 +576,21 @@ static bool d3d_lock_video_textures(d3d_priv *priv)
 
 static void d3d_clear_video_textures(d3d_priv *priv)
 {
-    if (!d3d_lock_video_textures(priv))
-        return;
+    for (int i = 0; i < NUM_VIDEO_TEXTURES; i++) {
+        if (!d3d_lock_video_textures(priv, i, true))
+            return;
 
-    for (int n = 0; n < priv->plane_count; n++) {
-        struct texplane *plane = &priv->planes[n];
-        memset(plane->locked_rect.pBits, plane->clearval,
-               plane->locked_rect.Pitch * plane->texture.tex_h);
-    }
+        for (int n = 0; n < priv->plane_count; n++) {
+            struct texplane *plane = &priv->planes[n];
+            memset(plane->locked_rect.pBits, plane->clearval,
+                   plane->locked_rect.Pitch * plane->texture[i].tex_h);
+        }
 
-    d3d_unlock_video_objects(priv);
+        d3d_unlock_video_objects(priv);
+
+        for (int n = 0; n < priv->plane_count; n++)
+            d3dtex_update(priv, &priv->planes[n].texture[i]);
+    }
 }
 
 // Recreate and initialize D3D objects if necessary. The amount of work that
@@ -852,8 +887,9 @@ static uint32_t d3d_draw_frame(d3d_priv *priv)
     if (priv->use_textures) {
 
         for (n = 0; n < priv->plane_count; n++) {
+            struct d3dtex *tex = &priv->planes[n].texture[priv->cur_texture];
             IDirect3DDevice9_SetTexture(priv->d3d_device, n,
-                d3dtex_get_render_texture(priv, &priv->planes[n].texture));
+                d3dtex_get_render_texture(priv, tex));
         }
 
         RECT rm = priv->fs_movie_rect;
@@ -875,9 +911,9 @@ static uint32_t d3d_draw_frame(d3d_priv *priv)
 
         for (n = 0; n < priv->plane_count; n++) {
             float s_x = (1.0f / (1 << priv->planes[n].shift_x))
-                        / priv->planes[n].texture.tex_w;
+                        / priv->planes[n].texture[0].tex_w;
             float s_y = (1.0f / (1 << priv->planes[n].shift_y))
-                        / priv->planes[n].texture.tex_h;
+                        / priv->planes[n].texture[0].tex_h;
             for (int i = 0; i < 4; i++) {
                 vb[i].t[n][0] = texc[i][0] * s_x;
                 vb[i].t[n][1] = texc[i][1] * s_y;
@@ -1343,9 +1379,12 @@ static void uninit(struct vo *vo)
     priv->d3d9_dll = NULL;
 }
 
-// Lock buffers and fill out to point to them.
+// Lock buffers and fill out to point to them. With textures, index selects
+// the entry in the texture ring, and write whether the frame is about to be
+// overwritten.
 // Must call d3d_unlock_video_objects() to unlock the buffers again.
-static bool get_video_buffer(d3d_priv *priv, struct mp_image *out)
+static bool get_video_buffer(d3d_priv *priv, struct mp_image *out, int index,
+                             bool write)
 {
     *out = (struct mp_image) {0};
     mp_image_set_size(out, priv->src_width, priv->src_height);
@@ -1355,7 +1394,7 @@ static bool get_video_buffer(d3d_priv *priv, struct mp_image *out)
         return false;
 
     if (priv->use_textures) {
-        if (!d3d_lock_video_textures(priv))
+        if (!d3d_lock_video_textures(priv, index, write))
             return false;
 
         for (int n = 0; n < priv->plane_count; n++) {
@@ -1402,8 +1441,10 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
     if (!priv->d3d_device)
         goto done;
 
+    int index = (priv->cur_texture + 1) % NUM_VIDEO_TEXTURES;
+
     struct mp_image buffer;
-    if (!get_video_buffer(priv, &buffer))
+    if (!get_video_buffer(priv, &buffer, index, true))
         goto done;
 
     mp_image_copy(&buffer, mpi);
@@ -1412,8 +1453,9 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
 
     if (priv->use_textures) {
         for (int n = 0; n < priv->plane_count; n++) {
-            d3dtex_update(priv, &priv->planes[n].texture);
+            d3dtex_update(priv, &priv->planes[n].texture[index]);
         }
+        priv->cur_texture = index;
     }
 
     priv->have_image = true;
@@ -1437,7 +1479,7 @@ static mp_image_t *get_screenshot(d3d_priv *priv)
         return NULL;
 
     struct mp_image buffer;
-    if (!get_video_buffer(priv, &buffer))
+    if (!get_video_buffer(priv, &buffer, priv->cur_texture, false))
         return NULL;
 
     struct mp_image *image = mp_image_new_copy(&buffer);
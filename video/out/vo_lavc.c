@@ -22,10 +22,24 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+
+#include "config.h"
+
+#if HAVE_VAAPI_ENCODE
+#include <fcntl.h>
+#include <unistd.h>
+#include <va/va_drm.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/hwcontext_vaapi.h>
+#include "video/vaapi.h"
+#include "video/hwdec.h"
+#endif
+
 #include "common/common.h"
 #include "options/options.h"
 #include "video/fmt-conversion.h"
 #include "video/mp_image.h"
+#include "video/sws_utils.h"
 #include "video/vfcap.h"
 #include "talloc.h"
 #include "vo.h"
@@ -56,8 +70,143 @@ struct priv {
     int worst_time_base_is_stream;
 
     struct mp_image_params real_colorspace;
+
+    // For --orendition outputs, input frames are scaled to out_params.
+    struct mp_sws_context *sws;
+    struct mp_image_params out_params;
+    bool scale;
+
+#if HAVE_VAAPI_ENCODE
+    // Set if the encoder is a VAAPI one and the device could be opened.
+    AVBufferRef *hw_device;
+    AVBufferRef *hw_frames;
+    struct mp_hwdec_info hwdec_info;
+    bool upload; // input frames are not VAAPI surfaces
+#endif
+};
+
+#if HAVE_VAAPI_ENCODE
+
+// Owned by the AVHWDeviceContext: the encoder can outlive the VO, because the
+// codec is closed only when the output file is finished.
+struct hw_device {
+    int drm_fd;
+    struct mp_vaapi_ctx *va;
 };
 
+static void free_hw_device(AVHWDeviceContext *dev)
+{
+    struct hw_device *hw = dev->user_opaque;
+    va_destroy(hw->va);
+    if (hw->drm_fd >= 0)
+        close(hw->drm_fd);
+    talloc_free(hw);
+}
+
+// Open the VAAPI device for a VAAPI encoder. The same VADisplay is given to
+// hwdec and vf_vavpp through VOCTRL_GET_HWDEC_INFO, so that decoded surfaces
+// can be encoded without copying them back to system memory.
+static bool hw_init(struct vo *vo)
+{
+    struct priv *vc = vo->priv;
+    const char *path = vo->encode_lavc_ctx->options->vaapi_device;
+
+    struct hw_device *hw = talloc_zero(NULL, struct hw_device);
+    hw->drm_fd = open(path ? path : "", O_RDWR | O_CLOEXEC);
+    if (hw->drm_fd < 0) {
+        MP_WARN(vo, "could not open VAAPI device '%s'\n", path ? path : "");
+        goto error;
+    }
+    VADisplay display = vaGetDisplayDRM(hw->drm_fd);
+    if (display)
+        hw->va = va_initialize(display, vo->log);
+    if (!hw->va) {
+        MP_WARN(vo, "could not initialize VAAPI on '%s'\n", path);
+        goto error;
+    }
+
+    vc->hw_device = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_VAAPI);
+    if (!vc->hw_device)
+        goto error;
+    AVHWDeviceContext *dev = (void *)vc->hw_device->data;
+    AVVAAPIDeviceContext *hwctx = dev->hwctx;
+    hwctx->display = hw->va->display;
+    dev->free = free_hw_device;
+    dev->user_opaque = hw;
+    hw = NULL; // unreffing hw_device frees it now
+    if (av_hwdevice_ctx_init(vc->hw_device) < 0) {
+        MP_WARN(vo, "could not create the libavutil VAAPI device\n");
+        av_buffer_unref(&vc->hw_device);
+        return false;
+    }
+
+    vc->hwdec_info.vaapi_ctx = ((struct hw_device *)dev->user_opaque)->va;
+    return true;
+
+error:
+    if (hw) {
+        va_destroy(hw->va);
+        if (hw->drm_fd >= 0)
+            close(hw->drm_fd);
+        talloc_free(hw);
+    }
+    return false;
+}
+
+static int destroy_priv(void *ptr)
+{
+    struct priv *vc = ptr;
+    av_buffer_unref(&vc->hw_frames);
+    av_buffer_unref(&vc->hw_device);
+    return 0;
+}
+
+// Copy a software frame to a new surface of the encoder's frame pool.
+// Returns NULL on failure. mpi is freed.
+static struct mp_image *upload_image(struct vo *vo, struct mp_image *mpi)
+{
+    struct priv *vc = vo->priv;
+    struct mp_image *res = NULL;
+    AVFrame *sw = av_frame_alloc();
+    AVFrame *hw = av_frame_alloc();
+    if (!sw || !hw)
+        goto done;
+    mp_image_copy_fields_to_av_frame(sw, mpi);
+    if (av_hwframe_get_buffer(vc->hw_frames, hw, 0) < 0 ||
+        av_hwframe_transfer_data(hw, sw, 0) < 0)
+    {
+        MP_ERR(vo, "could not upload the video frame\n");
+        goto done;
+    }
+    res = mp_image_from_av_frame(hw);
+    if (res)
+        mp_image_copy_attributes(res, mpi);
+done:
+    av_frame_free(&sw);
+    av_frame_free(&hw);
+    talloc_free(mpi);
+    return res;
+}
+
+static void free_hw_ref(void *opaque, uint8_t *data)
+{
+    talloc_free(opaque);
+}
+
+// Make frame (filled from a VAAPI mp_image) usable by the encoder: it keeps
+// a reference to the surface for as long as it needs it.
+static void ref_hw_frame(struct vo *vo, AVFrame *frame, struct mp_image *img)
+{
+    struct priv *vc = vo->priv;
+    frame->format = AV_PIX_FMT_VAAPI;
+    frame->buf[0] = av_buffer_create(NULL, 0, free_hw_ref,
+                                     mp_image_new_ref(img),
+                                     AV_BUFFER_FLAG_READONLY);
+    frame->hw_frames_ctx = av_buffer_ref(vc->hw_frames);
+}
+
+#endif /* HAVE_VAAPI_ENCODE */
+
 static int preinit(struct vo *vo)
 {
     struct priv *vc;
@@ -68,6 +217,24 @@ static int preinit(struct vo *vo)
     vo->priv = talloc_zero(vo, struct priv);
     vc = vo->priv;
     vc->harddup = vo->encode_lavc_ctx->options->harddup;
+    vc->sws = mp_sws_alloc(vc);
+    vc->sws->log = vo->log;
+    vc->sws->flags = mp_sws_hq_flags;
+
+#if HAVE_VAAPI_ENCODE
+    talloc_set_destructor(vc, destroy_priv);
+    struct encode_lavc_context *ectx = vo->encode_lavc_ctx;
+    pthread_mutex_lock(&ectx->lock);
+    if (ectx->vc && encode_lavc_is_vaapi_encoder(ectx->vc) && !hw_init(vo)) {
+        if (ectx->vc_fallback) {
+            MP_WARN(vo, "falling back to encoder %s\n", ectx->vc_fallback->name);
+            ectx->vc = ectx->vc_fallback;
+        } else {
+            MP_ERR(vo, "no fallback encoder given with --ovc\n");
+        }
+    }
+    pthread_mutex_unlock(&ectx->lock);
+#endif
     return 0;
 }
 
@@ -102,6 +269,21 @@ static int reconfig(struct vo *vo, struct mp_image_params *params, int flags)
 
     pthread_mutex_lock(&vo->encode_lavc_ctx->lock);
 
+    struct encode_lavc_context *ectx = vo->encode_lavc_ctx;
+    vc->out_params = *params;
+    vc->scale = ectx->rendition_w || ectx->rendition_h;
+    if (vc->scale) {
+        // A missing dimension is derived from the display aspect ratio. Keep
+        // the size even, as most encoders require it for subsampled chroma.
+        int w = ectx->rendition_w, h = ectx->rendition_h;
+        if (!w)
+            w = lrint(h * (double)params->d_w / params->d_h);
+        if (!h)
+            h = lrint(w * (double)params->d_h / params->d_w);
+        vc->out_params.w = width = MPMAX(w & ~1, 2);
+        vc->out_params.h = height = MPMAX(h & ~1, 2);
+    }
+
     display_aspect_ratio.num = params->d_w;
     display_aspect_ratio.den = params->d_h;
     image_aspect_ratio.num = width;
@@ -127,6 +309,7 @@ static int reconfig(struct vo *vo, struct mp_image_params *params, int flags)
             goto done;
         }
 
+        // (Renditions always have the same size, so they never get here.)
         /* FIXME Is it possible with raw video? */
         MP_ERR(vo, "resolution changes not supported.\n");
         goto error;
@@ -150,6 +333,27 @@ static int reconfig(struct vo *vo, struct mp_image_params *params, int flags)
     vc->stream->codec->height = height;
     vc->stream->codec->pix_fmt = pix_fmt;
 
+#if HAVE_VAAPI_ENCODE
+    if (vc->hw_device) {
+        vc->hw_frames = av_hwframe_ctx_alloc(vc->hw_device);
+        if (!vc->hw_frames)
+            goto error;
+        AVHWFramesContext *fctx = (void *)vc->hw_frames->data;
+        fctx->format = AV_PIX_FMT_VAAPI;
+        fctx->sw_format = AV_PIX_FMT_NV12;
+        fctx->width = width;
+        fctx->height = height;
+        if (av_hwframe_ctx_init(vc->hw_frames) < 0) {
+            MP_FATAL(vo, "could not create VAAPI frames of %dx%d\n",
+                     (int)width, (int)height);
+            goto error;
+        }
+        vc->stream->codec->pix_fmt = AV_PIX_FMT_VAAPI;
+        vc->stream->codec->hw_frames_ctx = av_buffer_ref(vc->hw_frames);
+        vc->upload = params->imgfmt != IMGFMT_VAAPI;
+    }
+#endif
+
     encode_lavc_set_csp(vo->encode_lavc_ctx, vc->stream, params->colorspace);
     encode_lavc_set_csp_levels(vo->encode_lavc_ctx, vc->stream, params->colorlevels);
 
@@ -192,6 +396,18 @@ static int query_format(struct vo *vo, uint32_t format)
     int flags = 0;
     if (encode_lavc_supports_pixfmt(vo->encode_lavc_ctx, pix_fmt))
         flags = VFCAP_CSP_SUPPORTED | VFCAP_CSP_SUPPORTED_BY_HW;
+#if HAVE_VAAPI_ENCODE
+    struct priv *vc = vo->priv;
+    if (vc && vc->hw_device) {
+        // Surfaces are passed through, unless they must be scaled for a
+        // rendition; software frames are uploaded.
+        struct encode_lavc_context *ectx = vo->encode_lavc_ctx;
+        bool scale = ectx->rendition_w || ectx->rendition_h;
+        flags = 0;
+        if (format == IMGFMT_NV12 || (format == IMGFMT_VAAPI && !scale))
+            flags = VFCAP_CSP_SUPPORTED | VFCAP_CSP_SUPPORTED_BY_HW;
+    }
+#endif
     pthread_mutex_unlock(&vo->encode_lavc_ctx->lock);
     return flags;
 }
@@ -262,8 +478,12 @@ static int encode_video(struct vo *vo, AVFrame *frame, AVPacket *packet)
         return packet->size;
     } else {
         int got_packet = 0;
+        // The encoder context is owned by us, so release the lock while the
+        // potentially slow encoding runs, and let ao_lavc encode and mux.
+        pthread_mutex_unlock(&vo->encode_lavc_ctx->lock);
         int status = avcodec_encode_video2(vc->stream->codec, packet,
                                            frame, &got_packet);
+        pthread_mutex_lock(&vo->encode_lavc_ctx->lock);
         int size = (status < 0) ? status : got_packet ? packet->size : 0;
 
         if (frame)
@@ -435,6 +655,11 @@ static void draw_image_unlocked(struct vo *vo, mp_image_t *mpi)
 
                 frame->quality = avc->global_quality;
 
+#if HAVE_VAAPI_ENCODE
+                if (vc->hw_frames)
+                    ref_hw_frame(vo, frame, vc->lastimg);
+#endif
+
                 av_init_packet(&packet);
                 packet.data = vc->buffer;
                 packet.size = vc->buffer_size;
@@ -483,19 +708,57 @@ static void draw_image_unlocked(struct vo *vo, mp_image_t *mpi)
         }
     }
 
-    if (vc->lastimg && vc->lastimg_wants_osd && vo->params) {
-        struct mp_osd_res dim = osd_res_from_image_params(vo->params);
+    // (Subtitles can't be drawn on surfaces that were passed through.)
+    if (vc->lastimg && vc->lastimg_wants_osd && vo->params &&
+        !IMGFMT_IS_HWACCEL(vc->lastimg->imgfmt))
+    {
+        struct mp_osd_res dim = osd_res_from_image_params(&vc->out_params);
 
         osd_draw_on_image(vo->osd, dim, vc->lastimg->pts, OSD_DRAW_SUB_ONLY,
                           vc->lastimg);
     }
 
+#if HAVE_VAAPI_ENCODE
+    if (vc->lastimg && vc->upload && !IMGFMT_IS_HWACCEL(vc->lastimg->imgfmt)) {
+        vc->lastimg = upload_image(vo, vc->lastimg);
+        if (!vc->lastimg)
+            encode_lavc_fail(ectx, "vo-lavc: VAAPI upload failed\n");
+    }
+#endif
+
 done:
     talloc_free(mpi);
 }
 
+// Scale mpi to the rendition size. Return NULL on failure (mpi is freed).
+static struct mp_image *scale_image(struct vo *vo, struct mp_image *mpi)
+{
+    struct priv *vc = vo->priv;
+    struct mp_image *res = mp_image_alloc(vc->out_params.imgfmt,
+                                          vc->out_params.w, vc->out_params.h);
+    if (res) {
+        mp_image_copy_attributes(res, mpi);
+        res->params.d_w = vc->out_params.d_w;
+        res->params.d_h = vc->out_params.d_h;
+        if (mp_sws_scale(vc->sws, res, mpi) < 0) {
+            MP_ERR(vo, "could not scale the video\n");
+            talloc_free(res);
+            res = NULL;
+        }
+    }
+    talloc_free(mpi);
+    return res;
+}
+
 static void draw_image(struct vo *vo, mp_image_t *mpi)
 {
+    struct priv *vc = vo->priv;
+    // Each output has its own VO thread, so renditions scale in parallel.
+    if (vc && vc->scale) {
+        mpi = scale_image(vo, mpi);
+        if (!mpi)
+            return;
+    }
     pthread_mutex_lock(&vo->encode_lavc_ctx->lock);
     draw_image_unlocked(vo, mpi);
     pthread_mutex_unlock(&vo->encode_lavc_ctx->lock);
@@ -515,6 +778,12 @@ static int control(struct vo *vo, uint32_t request, void *data)
         *(struct mp_image_params *)data = vc->real_colorspace;
         r = 1;
         break;
+#if HAVE_VAAPI_ENCODE
+    case VOCTRL_GET_HWDEC_INFO:
+        *(struct mp_hwdec_info **)data = &vc->hwdec_info;
+        r = 1;
+        break;
+#endif
     }
     pthread_mutex_unlock(&vo->encode_lavc_ctx->lock);
     return r;
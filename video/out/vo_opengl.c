@@ -70,6 +70,7 @@ struct gl_priv {
     int use_gl_debug;
     int allow_sw;
     int swap_interval;
+    int adaptive_quality;
     char *backend;
 
     int vo_flipped;
@@ -77,6 +78,16 @@ struct gl_priv {
     int frames_rendered;
     unsigned int prev_sgi_sync_count;
 
+    // adaptive-quality state (see update_quality())
+    int quality_drop;           // current gl_video_set_quality_drop() level
+    int64_t last_late_count;    // VO drop + missed vsync count at last check
+    int window_frames;          // frames rendered in the current window
+    int window_late;            // late frames in the current window
+    int clean_frames;           // frames rendered since the last late frame
+    int frames_since_change;    // frames rendered since the last level change
+    bool last_change_raise;     // last level change raised the quality
+    int raise_delay;            // clean frames required before raising
+
     // check-pattern sub-option; for testing/debugging
     int opt_pattern[2];
     int last_pattern;
@@ -100,6 +111,94 @@ static void resize(struct gl_priv *p)
     vo->want_redraw = true;
 }
 
+// adaptive-quality: frames per window in which late frames are counted, and
+// the number of late frames in a window that lowers the quality.
+#define QUALITY_WINDOW 60
+#define QUALITY_LATE_FRAMES 3
+// Frames after a level change in which late frames are ignored (the change
+// recompiles shaders and reallocates FBOs, which can delay a frame or two).
+#define QUALITY_GRACE_FRAMES 10
+// Range of clean frames required before the quality is raised again. The
+// delay is doubled each time a raise had to be reverted quickly.
+#define QUALITY_RAISE_DELAY_MIN 300
+#define QUALITY_RAISE_DELAY_MAX 9600
+
+// Whether the GPU time of the last frames leaves room for higher quality.
+// Assume it does if the GPU time can't be measured.
+static bool have_gpu_headroom(struct gl_priv *p)
+{
+    struct voctrl_pass_timings t;
+    if (!gl_video_get_pass_timings(p->renderer, &t))
+        return true;
+    int64_t total_ns = 0;
+    for (int n = 0; n < t.num_passes; n++)
+        total_ns += t.passes[n].avg_ns;
+    int64_t interval_ns = vo_get_vsync_interval(p->vo) * 1000;
+    return interval_ns <= 0 || total_ns < interval_ns / 2;
+}
+
+// Called under mpgl_lock before rendering a new frame. Lower the rendering
+// quality if frames are late (dropped or displayed on a later vsync than
+// intended), and raise it again after a while without late frames.
+static void update_quality(struct gl_priv *p)
+{
+    struct vo *vo = p->vo;
+
+    int64_t late_count = vo_get_drop_count(vo) + vo_get_missed_count(vo);
+    int64_t late = late_count - p->last_late_count;
+    p->last_late_count = late_count;
+    if (late < 0) // counters are reset on seeks
+        late = 0;
+    if (p->frames_since_change < QUALITY_GRACE_FRAMES)
+        late = 0;
+
+    p->frames_since_change++;
+    p->window_frames++;
+    p->window_late += late;
+    p->clean_frames = late ? 0 : p->clean_frames + 1;
+    if (!p->raise_delay)
+        p->raise_delay = QUALITY_RAISE_DELAY_MIN;
+
+    int level = p->quality_drop;
+    if (p->window_late >= QUALITY_LATE_FRAMES &&
+        level < GL_VIDEO_MAX_QUALITY_DROP)
+    {
+        // Hysteresis: if the previous raise didn't hold, wait longer before
+        // trying again.
+        if (p->last_change_raise &&
+            p->frames_since_change < p->raise_delay + QUALITY_WINDOW)
+        {
+            p->raise_delay = MPMIN(p->raise_delay * 2,
+                                   QUALITY_RAISE_DELAY_MAX);
+        }
+        level++;
+    } else if (level > 0 && p->clean_frames >= p->raise_delay &&
+               have_gpu_headroom(p))
+    {
+        level--;
+    }
+
+    if (p->window_frames >= QUALITY_WINDOW) {
+        p->window_frames = 0;
+        p->window_late = 0;
+    }
+
+    if (level == p->quality_drop)
+        return;
+
+    MP_VERBOSE(vo, "%s rendering quality (drop level %d).\n",
+               level > p->quality_drop ? "Lowering" : "Raising", level);
+    p->last_change_raise = level < p->quality_drop;
+    p->quality_drop = level;
+    p->frames_since_change = 0;
+    p->window_frames = 0;
+    p->window_late = 0;
+    p->clean_frames = 0;
+    if (level == 0)
+        p->raise_delay = QUALITY_RAISE_DELAY_MIN;
+    gl_video_set_quality_drop(p->renderer, level);
+}
+
 static void check_pattern(struct vo *vo, int item)
 {
     struct gl_priv *p = vo->priv;
@@ -153,7 +252,7 @@ static void flip_page(struct vo *vo)
     mpgl_unlock(p->glctx);
 }
 
-static void draw_image(struct vo *vo, mp_image_t *mpi)
+static void draw_image_blend(struct vo *vo, mp_image_t *mpi, double mix)
 {
     struct gl_priv *p = vo->priv;
     GL *gl = p->gl;
@@ -163,8 +262,11 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
 
     mpgl_lock(p->glctx);
 
+    if (p->adaptive_quality)
+        update_quality(p);
+
     gl_video_upload_image(p->renderer, mpi);
-    gl_video_render_frame(p->renderer);
+    gl_video_render_frame_blend(p->renderer, mix);
 
     // The playloop calls this last before waiting some time until it decides
     // to call flip_page(). Tell OpenGL to start execution of the GPU commands
@@ -177,6 +279,23 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
     mpgl_unlock(p->glctx);
 }
 
+static void draw_image(struct vo *vo, mp_image_t *mpi)
+{
+    draw_image_blend(vo, mpi, 1.0);
+}
+
+static struct mp_image *get_image(struct vo *vo, int imgfmt, int w, int h,
+                                  int stride_align)
+{
+    struct gl_priv *p = vo->priv;
+
+    mpgl_lock(p->glctx);
+    struct mp_image *mpi =
+        gl_video_get_image(p->renderer, imgfmt, w, h, stride_align);
+    mpgl_unlock(p->glctx);
+    return mpi;
+}
+
 static int query_format(struct vo *vo, uint32_t format)
 {
     struct gl_priv *p = vo->priv;
@@ -422,6 +541,48 @@ static int control(struct vo *vo, uint32_t request, void *data)
         gl_video_render_frame(p->renderer);
         mpgl_unlock(p->glctx);
         return true;
+    case VOCTRL_GET_PRESENT_FEEDBACK: {
+        if (!p->glctx->get_present_feedback)
+            return VO_NOTIMPL;
+        mpgl_lock(p->glctx);
+        bool r = p->glctx->get_present_feedback(p->glctx, data);
+        mpgl_unlock(p->glctx);
+        return r ? VO_TRUE : VO_NOTAVAIL;
+    }
+    case VOCTRL_DRAW_SECOND_FIELD: {
+        mpgl_lock(p->glctx);
+        bool r = gl_video_render_second_field(p->renderer);
+        mpgl_unlock(p->glctx);
+        return r ? VO_TRUE : VO_FALSE;
+    }
+    case VOCTRL_GET_DEINTERLACE: {
+        bool enable;
+        mpgl_lock(p->glctx);
+        bool r = gl_video_get_deinterlace(p->renderer, &enable);
+        mpgl_unlock(p->glctx);
+        if (r)
+            *(int *)data = enable;
+        return r ? VO_TRUE : VO_NOTIMPL;
+    }
+    case VOCTRL_SET_DEINTERLACE: {
+        mpgl_lock(p->glctx);
+        bool r = gl_video_set_deinterlace(p->renderer, *(int *)data);
+        mpgl_unlock(p->glctx);
+        if (r)
+            vo->want_redraw = true;
+        return r ? VO_TRUE : VO_NOTIMPL;
+    }
+    case VOCTRL_GET_INTERPOLATION:
+        mpgl_lock(p->glctx);
+        *(bool *)data = gl_video_has_interpolation(p->renderer);
+        mpgl_unlock(p->glctx);
+        return true;
+    case VOCTRL_GET_PASS_TIMINGS: {
+        mpgl_lock(p->glctx);
+        bool r = gl_video_get_pass_timings(p->renderer, data);
+        mpgl_unlock(p->glctx);
+        return r ? VO_TRUE : VO_NOTAVAIL;
+    }
     case VOCTRL_SET_COMMAND_LINE: {
         char *arg = data;
         return reparse_cmdline(p, arg);
@@ -474,7 +635,7 @@ static int preinit(struct vo *vo)
     if (p->gl->SwapInterval)
         p->gl->SwapInterval(p->swap_interval);
 
-    p->renderer = gl_video_init(p->gl, vo->log, vo->osd);
+    p->renderer = gl_video_init(p->gl, vo->log, vo->global, vo->osd);
     gl_video_set_output_depth(p->renderer, p->glctx->depth_r, p->glctx->depth_g,
                               p->glctx->depth_b);
     gl_video_set_options(p->renderer, p->renderer_opts);
@@ -498,6 +659,7 @@ const struct m_option options[] = {
     OPT_FLAG("glfinish", use_glFinish, 0),
     OPT_FLAG("waitvsync", waitvsync, 0),
     OPT_INT("swapinterval", swap_interval, 0, OPTDEF_INT(1)),
+    OPT_FLAG("adaptive-quality", adaptive_quality, 0),
     OPT_FLAG("debug", use_gl_debug, 0),
     OPT_STRING_VALIDATE("backend", backend, 0, mpgl_validate_backend_opt),
     OPT_FLAG("sw", allow_sw, 0),
@@ -519,7 +681,9 @@ const struct vo_driver video_out_opengl = {
     .reconfig = reconfig,
     .control = control,
     .draw_image = draw_image,
+    .draw_image_blend = draw_image_blend,
     .flip_page = flip_page,
+    .get_image = get_image,
     .uninit = uninit,
     .priv_size = sizeof(struct gl_priv),
     .options = options,
@@ -534,7 +698,9 @@ const struct vo_driver video_out_opengl_hq = {
     .reconfig = reconfig,
     .control = control,
     .draw_image = draw_image,
+    .draw_image_blend = draw_image_blend,
     .flip_page = flip_page,
+    .get_image = get_image,
     .uninit = uninit,
     .priv_size = sizeof(struct gl_priv),
     .priv_defaults = &(const struct gl_priv){
@@ -0,0 +1,388 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "config.h"
+
+#include "talloc.h"
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "options/m_config.h"
+#include "options/options.h"
+#include "aspect.h"
+#include "vo.h"
+#include "video/vfcap.h"
+#include "video/mp_image.h"
+#include "sub/osd.h"
+#include "player/client.h"
+
+#include "gl_common.h"
+#include "gl_video.h"
+
+#include "libmpv/opengl_cb.h"
+
+/*
+ * mpv_opengl_cb_context is created by the client API (once per core), and
+ * lives until the core is destroyed. The "opengl-cb" VO attaches to it while
+ * it exists. Video frames are passed from the VO thread to the API user's
+ * render thread, which owns the GL context and the renderer.
+ *
+ * Locking: ctx->lock protects the fields marked as such. The renderer and the
+ * GL struct are accessed only by the thread calling the mpv_opengl_cb_* GL
+ * functions (plus query_format(), see there).
+ */
+
+struct mpv_opengl_cb_context {
+    struct mp_log *log;
+    struct mpv_global *global;
+    struct osd_state *osd;
+
+    pthread_mutex_t lock;
+
+    // --- Protected by lock
+    bool initialized;
+    mpv_opengl_cb_update_fn update_cb;
+    void *update_cb_ctx;
+    struct vo *active;              // the VO using this context, or NULL
+    struct mp_image *next_frame;    // frame to upload on the next render
+    struct mp_image_params img_params;
+    bool reconfigured;              // img_params changed
+    bool force_update;              // src/dst rects need to be recomputed
+    struct mp_vo_opts vo_opts;      // copy, for the aspect calculation
+    struct gl_video_opts *renderer_opts;    // deep copy of the VO's options
+    struct gl_video_opts *applied_opts;     // copy referenced by the renderer
+    bool update_renderer_opts;
+
+    // --- Accessed only by the API user's render thread
+    GL *gl;
+    struct gl_video *renderer;
+    int vp_w, vp_h;
+};
+
+struct vo_priv {
+    struct mpv_opengl_cb_context *ctx;
+
+    // Options
+    struct gl_video_opts *renderer_opts;
+};
+
+static void free_ctx(void *ptr)
+{
+    struct mpv_opengl_cb_context *ctx = ptr;
+
+    // The API user must have called mpv_opengl_cb_uninit_gl() before
+    // destroying the core, and the VO must be gone by now.
+    assert(!ctx->renderer);
+    assert(!ctx->active);
+
+    pthread_mutex_destroy(&ctx->lock);
+}
+
+struct mpv_opengl_cb_context *mp_opengl_create(void *talloc_ctx,
+                                               struct mpv_global *g,
+                                               struct osd_state *osd)
+{
+    struct mpv_opengl_cb_context *ctx =
+        talloc_zero(talloc_ctx, struct mpv_opengl_cb_context);
+    talloc_set_destructor(ctx, free_ctx);
+    pthread_mutex_init(&ctx->lock, NULL);
+
+    ctx->log = mp_log_new(ctx, g->log, "opengl-cb");
+    ctx->global = g;
+    ctx->osd = osd;
+
+    return ctx;
+}
+
+// Must be called with ctx->lock held.
+static void update(struct mpv_opengl_cb_context *ctx)
+{
+    if (ctx->update_cb)
+        ctx->update_cb(ctx->update_cb_ctx);
+}
+
+void mpv_opengl_cb_set_update_callback(struct mpv_opengl_cb_context *ctx,
+                                       mpv_opengl_cb_update_fn callback,
+                                       void *callback_ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+    ctx->update_cb = callback;
+    ctx->update_cb_ctx = callback_ctx;
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+int mpv_opengl_cb_init_gl(struct mpv_opengl_cb_context *ctx, const char *exts,
+                          mpv_opengl_cb_get_proc_address_fn get_proc_address,
+                          void *get_proc_address_ctx)
+{
+    if (ctx->renderer)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    ctx->gl = talloc_zero(ctx, GL);
+
+    mpgl_load_functions2(ctx->gl, get_proc_address, get_proc_address_ctx,
+                         exts, ctx->log);
+    int caps = MPGL_CAP_GL21 | MPGL_CAP_TEX_RG | MPGL_CAP_FB;
+    if ((ctx->gl->mpgl_caps & caps) != caps) {
+        MP_FATAL(ctx, "Missing OpenGL features.\n");
+        goto error;
+    }
+    struct gl_video *renderer =
+        gl_video_init(ctx->gl, ctx->log, ctx->global, ctx->osd);
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->renderer = renderer;
+    // Renderer options are set by the VO; apply them if it's already active.
+    ctx->update_renderer_opts = !!ctx->active;
+    ctx->reconfigured = ctx->img_params.imgfmt != 0;
+    ctx->force_update = true;
+    ctx->initialized = true;
+    pthread_mutex_unlock(&ctx->lock);
+
+    return 0;
+
+error:
+    talloc_free(ctx->gl);
+    ctx->gl = NULL;
+    return MPV_ERROR_INVALID_PARAMETER;
+}
+
+int mpv_opengl_cb_uninit_gl(struct mpv_opengl_cb_context *ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+    ctx->initialized = false;
+    mp_image_unrefp(&ctx->next_frame);
+    struct gl_video *renderer = ctx->renderer;
+    ctx->renderer = NULL;
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (renderer)
+        gl_video_uninit(renderer);
+    talloc_free(ctx->gl);
+    ctx->gl = NULL;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->applied_opts != ctx->renderer_opts)
+        talloc_free(ctx->applied_opts);
+    ctx->applied_opts = NULL;
+    pthread_mutex_unlock(&ctx->lock);
+    return 0;
+}
+
+int mpv_opengl_cb_render(struct mpv_opengl_cb_context *ctx, int fbo, int vp[4])
+{
+    if (!ctx->renderer || vp[2] < 1 || vp[3] < 1)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    struct gl_video *renderer = ctx->renderer;
+
+    pthread_mutex_lock(&ctx->lock);
+
+    struct vo *vo = ctx->active;
+
+    if (ctx->update_renderer_opts) {
+        gl_video_set_options(renderer, ctx->renderer_opts);
+        // The renderer keeps pointers to the strings of the previous copy
+        // until now.
+        if (ctx->applied_opts != ctx->renderer_opts)
+            talloc_free(ctx->applied_opts);
+        ctx->applied_opts = ctx->renderer_opts;
+        ctx->update_renderer_opts = false;
+    }
+
+    if (ctx->reconfigured) {
+        gl_video_config(renderer, &ctx->img_params);
+        ctx->reconfigured = false;
+        ctx->force_update = true;
+    }
+
+    if (ctx->vp_w != vp[2] || ctx->vp_h != vp[3])
+        ctx->force_update = true;
+
+    gl_video_set_output_fbo(renderer, fbo);
+
+    if (ctx->force_update && vo) {
+        ctx->force_update = false;
+        ctx->vp_w = vp[2];
+        ctx->vp_h = vp[3];
+
+        struct mp_rect wnd = {vp[0], vp[1], vp[0] + vp[2], vp[1] + vp[3]};
+        struct mp_rect src, dst;
+        struct mp_osd_res osd;
+        mp_get_src_dst_rects(ctx->log, &ctx->vo_opts, vo->driver->caps,
+                             &ctx->img_params, vp[2], vp[3], 1.0,
+                             &src, &dst, &osd);
+
+        gl_video_resize(renderer, &wnd, &src, &dst, &osd);
+    }
+
+    struct mp_image *mpi = ctx->next_frame;
+    ctx->next_frame = NULL;
+
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (mpi)
+        gl_video_upload_image(renderer, mpi);
+
+    gl_video_render_frame(renderer);
+
+    return 0;
+}
+
+static void draw_image(struct vo *vo, struct mp_image *mpi)
+{
+    struct vo_priv *p = vo->priv;
+
+    pthread_mutex_lock(&p->ctx->lock);
+    // If the previous frame wasn't rendered yet, it's dropped.
+    mp_image_unrefp(&p->ctx->next_frame);
+    p->ctx->next_frame = mpi;
+    update(p->ctx);
+    pthread_mutex_unlock(&p->ctx->lock);
+}
+
+static void flip_page(struct vo *vo)
+{
+    // Presentation is done by the API user.
+}
+
+static int query_format(struct vo *vo, uint32_t format)
+{
+    struct vo_priv *p = vo->priv;
+
+    // gl_video_check_format() only reads state set on renderer creation.
+    bool ok = false;
+    pthread_mutex_lock(&p->ctx->lock);
+    if (p->ctx->renderer)
+        ok = gl_video_check_format(p->ctx->renderer, format);
+    pthread_mutex_unlock(&p->ctx->lock);
+    return ok ? VFCAP_CSP_SUPPORTED | VFCAP_CSP_SUPPORTED_BY_HW : 0;
+}
+
+static int reconfig(struct vo *vo, struct mp_image_params *params, int flags)
+{
+    struct vo_priv *p = vo->priv;
+
+    pthread_mutex_lock(&p->ctx->lock);
+    mp_image_unrefp(&p->ctx->next_frame);
+    p->ctx->img_params = *params;
+    p->ctx->vo_opts = *vo->opts;
+    p->ctx->reconfigured = true;
+    pthread_mutex_unlock(&p->ctx->lock);
+
+    return 0;
+}
+
+static int control(struct vo *vo, uint32_t request, void *data)
+{
+    struct vo_priv *p = vo->priv;
+
+    switch (request) {
+    case VOCTRL_GET_PANSCAN:
+        return VO_TRUE;
+    case VOCTRL_SET_PANSCAN:
+        pthread_mutex_lock(&p->ctx->lock);
+        p->ctx->vo_opts = *vo->opts;
+        p->ctx->force_update = true;
+        update(p->ctx);
+        pthread_mutex_unlock(&p->ctx->lock);
+        return VO_TRUE;
+    case VOCTRL_REDRAW_FRAME:
+        pthread_mutex_lock(&p->ctx->lock);
+        update(p->ctx);
+        pthread_mutex_unlock(&p->ctx->lock);
+        return VO_TRUE;
+    }
+
+    return VO_NOTIMPL;
+}
+
+static void uninit(struct vo *vo)
+{
+    struct vo_priv *p = vo->priv;
+
+    pthread_mutex_lock(&p->ctx->lock);
+    mp_image_unrefp(&p->ctx->next_frame);
+    // Make the renderer drop the last frame (see gl_video_config()).
+    p->ctx->reconfigured = p->ctx->img_params.imgfmt != 0;
+    p->ctx->active = NULL;
+    update(p->ctx);
+    pthread_mutex_unlock(&p->ctx->lock);
+}
+
+static int preinit(struct vo *vo)
+{
+    struct vo_priv *p = vo->priv;
+    p->ctx = vo->opengl_cb_context;
+    if (!p->ctx) {
+        MP_FATAL(vo, "No context set.\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&p->ctx->lock);
+    if (!p->ctx->initialized) {
+        MP_FATAL(vo, "OpenGL context not initialized.\n");
+        pthread_mutex_unlock(&p->ctx->lock);
+        return -1;
+    }
+    if (p->ctx->active) {
+        MP_FATAL(vo, "There is already a VO using the OpenGL context.\n");
+        pthread_mutex_unlock(&p->ctx->lock);
+        return -1;
+    }
+    p->ctx->active = vo;
+    p->ctx->reconfigured = false;
+    p->ctx->img_params = (struct mp_image_params){0};
+    p->ctx->vo_opts = *vo->opts;
+    // The options must outlive the VO, since the renderer keeps using them.
+    if (p->ctx->renderer_opts != p->ctx->applied_opts)
+        talloc_free(p->ctx->renderer_opts);
+    p->ctx->renderer_opts =
+        m_sub_options_copy(p->ctx, &gl_video_conf, p->renderer_opts);
+    p->ctx->update_renderer_opts = true;
+    pthread_mutex_unlock(&p->ctx->lock);
+
+    return 0;
+}
+
+#define OPT_BASE_STRUCT struct vo_priv
+static const struct m_option options[] = {
+    OPT_SUBSTRUCT("", renderer_opts, gl_video_conf, 0),
+    {0},
+};
+
+const struct vo_driver video_out_opengl_cb = {
+    .description = "OpenGL Callbacks for libmpv",
+    .name = "opengl-cb",
+    .caps = VO_CAP_ROTATE90,
+    .preinit = preinit,
+    .query_format = query_format,
+    .reconfig = reconfig,
+    .control = control,
+    .draw_image = draw_image,
+    .flip_page = flip_page,
+    .uninit = uninit,
+    .priv_size = sizeof(struct vo_priv),
+    .options = options,
+};
@@ -43,6 +43,8 @@
 #include "video/mp_image.h"
 #include "video/vfcap.h"
 
+#include "bitmap_packer.h"
+
 #include "win_state.h"
 #include "config.h"
 #include "vo.h"
@@ -164,14 +166,39 @@ const struct keymap_entry keys[] = {
     {SDLK_F24, MP_KEY_F + 24}
 };
 
+#define MAX_VIDEO_TEXTURES 8
+
+// Renderers which upload streaming textures from a system memory copy that
+// stays valid after SDL_UnlockTexture(). Only with these, the decoder can keep
+// reading frames it rendered into a texture (as references) after display.
+static const char *const dr_renderers[] = {
+    "opengl", "opengles2", "opengles", "software", NULL
+};
+
+// Streaming texture for the video. Frames are either copied into the next
+// texture of a ring, or rendered directly into a locked texture by the
+// decoder (see get_image()).
+struct video_tex {
+    SDL_Texture *tex;
+    Uint32 format;
+    int w, h;
+    struct mp_image locked;     // mapping while locked (planes[0] != NULL)
+    bool in_use;                // direct rendering: referenced by a mp_image
+};
+
 struct priv {
     bool reinit_renderer;
     SDL_Window *window;
     SDL_Renderer *renderer;
     int renderer_index;
     SDL_RendererInfo renderer_info;
-    SDL_Texture *tex;
-    int tex_swapped;
+    bool can_dr;
+    Uint32 texfmt;
+    struct video_tex ring[MAX_VIDEO_TEXTURES];
+    int ring_pos;
+    struct video_tex **dr_textures;
+    int num_dr_textures;
+    struct video_tex *cur_tex;  // texture with the current frame
     struct mp_image_params params;
     mp_image_t *ssmpi;
     struct mp_rect src_rect;
@@ -181,15 +208,19 @@ struct priv {
     struct osd_bitmap_surface {
         int bitmap_id;
         int bitmap_pos_id;
+        // All bitmaps are packed into one texture pair.
+        struct bitmap_packer *packer;
+        SDL_Texture *tex;       // alpha blended
+        SDL_Texture *tex2;      // added
+        int w, h;
         struct osd_target {
             SDL_Rect source;
             SDL_Rect dest;
-            SDL_Texture *tex;
-            SDL_Texture *tex2;
         } *targets;
         int num_targets;
         int targets_size;
     } osd_surfaces[MAX_OSD_PARTS];
+    void *osd_scratch;
     double osd_pts;
     int mouse_hidden;
     int brightness, contrast;
@@ -199,13 +230,17 @@ struct priv {
     int allow_sw;
     int switch_mode;
     int vsync;
+    int num_textures;
 };
 
-static bool lock_texture(struct vo *vo, struct mp_image *texmpi)
+static bool lock_texture(struct vo *vo, struct video_tex *t)
 {
     struct priv *vc = vo->priv;
+    struct mp_image *texmpi = &t->locked;
+    if (texmpi->planes[0])
+        return true;
     *texmpi = (struct mp_image){0};
-    mp_image_set_size(texmpi, vc->params.w, vc->params.h);
+    mp_image_set_size(texmpi, t->w, t->h);
     mp_image_setfmt(texmpi, vc->params.imgfmt);
     switch (texmpi->num_planes) {
     case 1:
@@ -217,14 +252,14 @@ static bool lock_texture(struct vo *vo, struct mp_image *texmpi)
     }
     void *pixels;
     int pitch;
-    if (SDL_LockTexture(vc->tex, NULL, &pixels, &pitch)) {
+    if (SDL_LockTexture(t->tex, NULL, &pixels, &pitch)) {
         MP_ERR(vo, "SDL_LockTexture failed\n");
         return false;
     }
     texmpi->planes[0] = pixels;
     texmpi->stride[0] = pitch;
     if (texmpi->num_planes == 3) {
-        if (vc->tex_swapped) {
+        if (t->format == SDL_PIXELFORMAT_YV12) {
             texmpi->planes[2] =
                 ((Uint8 *) texmpi->planes[0] + texmpi->h * pitch);
             texmpi->stride[2] = pitch / 2;
@@ -243,6 +278,48 @@ static bool lock_texture(struct vo *vo, struct mp_image *texmpi)
     return true;
 }
 
+static void unlock_texture(struct video_tex *t)
+{
+    if (t->locked.planes[0]) {
+        SDL_UnlockTexture(t->tex);
+        t->locked.planes[0] = NULL;
+    }
+}
+
+static bool create_texture(struct vo *vo, struct video_tex *t, int w, int h)
+{
+    struct priv *vc = vo->priv;
+    *t = (struct video_tex){
+        .tex = SDL_CreateTexture(vc->renderer, vc->texfmt,
+                                 SDL_TEXTUREACCESS_STREAMING, w, h),
+        .format = vc->texfmt,
+        .w = w,
+        .h = h,
+    };
+    if (!t->tex) {
+        MP_ERR(vo, "Could not create a texture\n");
+        return false;
+    }
+    return true;
+}
+
+static void destroy_texture(struct video_tex *t)
+{
+    if (t->tex)
+        SDL_DestroyTexture(t->tex);
+    *t = (struct video_tex){0};
+}
+
+static void destroy_dr_texture(struct priv *vc, int index)
+{
+    struct video_tex *t = vc->dr_textures[index];
+    if (vc->cur_tex == t)
+        vc->cur_tex = NULL;
+    destroy_texture(t);
+    talloc_free(t);
+    MP_TARRAY_REMOVE_AT(vc->dr_textures, vc->num_dr_textures, index);
+}
+
 static bool is_good_renderer(SDL_RendererInfo *ri,
                              const char *driver_name_wanted, int allow_sw,
                              struct formatmap_entry *osd_format)
@@ -273,23 +350,26 @@ static void destroy_renderer(struct vo *vo)
     struct priv *vc = vo->priv;
 
     // free ALL the textures
-    if (vc->tex) {
-        SDL_DestroyTexture(vc->tex);
-        vc->tex = NULL;
-    }
-
-    int i, j;
-    for (i = 0; i < MAX_OSD_PARTS; ++i) {
-        for (j = 0; j < vc->osd_surfaces[i].targets_size; ++j) {
-            if (vc->osd_surfaces[i].targets[j].tex) {
-                SDL_DestroyTexture(vc->osd_surfaces[i].targets[j].tex);
-                vc->osd_surfaces[i].targets[j].tex = NULL;
-            }
-            if (vc->osd_surfaces[i].targets[j].tex2) {
-                SDL_DestroyTexture(vc->osd_surfaces[i].targets[j].tex2);
-                vc->osd_surfaces[i].targets[j].tex2 = NULL;
-            }
+    for (int i = 0; i < MAX_VIDEO_TEXTURES; ++i)
+        destroy_texture(&vc->ring[i]);
+    // Direct rendering starts only after the renderer was created for the
+    // video, so no image can reference these textures.
+    while (vc->num_dr_textures)
+        destroy_dr_texture(vc, vc->num_dr_textures - 1);
+    vc->cur_tex = NULL;
+
+    for (int i = 0; i < MAX_OSD_PARTS; ++i) {
+        struct osd_bitmap_surface *sfc = &vc->osd_surfaces[i];
+        if (sfc->tex) {
+            SDL_DestroyTexture(sfc->tex);
+            sfc->tex = NULL;
+        }
+        if (sfc->tex2) {
+            SDL_DestroyTexture(sfc->tex2);
+            sfc->tex2 = NULL;
         }
+        sfc->bitmap_id = sfc->bitmap_pos_id = -1;
+        sfc->num_targets = 0;
     }
 
     if (vc->renderer) {
@@ -356,6 +436,19 @@ static bool try_create_renderer(struct vo *vo, int i, const char *driver,
         vc->renderer_index = i;
     }
 
+    vc->can_dr = false;
+    for (int n = 0; dr_renderers[n]; n++)
+        vc->can_dr |= strcmp(vc->renderer_info.name, dr_renderers[n]) == 0;
+
+    int max_w = vc->renderer_info.max_texture_width;
+    int max_h = vc->renderer_info.max_texture_height;
+    for (int n = 0; n < MAX_OSD_PARTS; n++) {
+        struct bitmap_packer *packer = vc->osd_surfaces[n].packer;
+        packer_reset(packer);
+        packer->w_max = max_w > 0 ? max_w : 4096;
+        packer->h_max = max_h > 0 ? max_h : 4096;
+    }
+
     return true;
 }
 
@@ -482,8 +575,9 @@ static int reconfig(struct vo *vo, struct mp_image_params *params, int flags)
             return -1;
     }
 
-    if (vc->tex)
-        SDL_DestroyTexture(vc->tex);
+    for (int n = 0; n < MAX_VIDEO_TEXTURES; n++)
+        destroy_texture(&vc->ring[n]);
+    vc->cur_tex = NULL;
     Uint32 texfmt = SDL_PIXELFORMAT_UNKNOWN;
     int i, j;
     for (i = 0; i < vc->renderer_info.num_texture_formats; ++i)
@@ -496,25 +590,23 @@ static int reconfig(struct vo *vo, struct mp_image_params *params, int flags)
         return -1;
     }
 
-    vc->tex_swapped = texfmt == SDL_PIXELFORMAT_YV12;
-    vc->tex = SDL_CreateTexture(vc->renderer, texfmt,
-                                SDL_TEXTUREACCESS_STREAMING,
-                                params->w, params->h);
-    if (!vc->tex) {
-        MP_ERR(vo, "Could not create a texture\n");
-        return -1;
-    }
-
+    vc->texfmt = texfmt;
     vc->params = *params;
 
-    struct mp_image tmp;
-    if (!lock_texture(vo, &tmp)) {
-        SDL_DestroyTexture(vc->tex);
-        vc->tex = NULL;
+    for (int n = 0; n < vc->num_textures; n++) {
+        if (!create_texture(vo, &vc->ring[n], params->w, params->h))
+            return -1;
+    }
+    vc->ring_pos = 1 % vc->num_textures;
+
+    struct video_tex *t = &vc->ring[0];
+    if (!lock_texture(vo, t)) {
+        destroy_texture(t);
         return -1;
     }
-    mp_image_clear(&tmp, 0, 0, tmp.w, tmp.h);
-    SDL_UnlockTexture(vc->tex);
+    mp_image_clear(&t->locked, 0, 0, t->w, t->h);
+    unlock_texture(t);
+    vc->cur_tex = t;
 
     resize(vo, win_w, win_h);
 
@@ -643,22 +735,23 @@ static void uninit(struct vo *vo)
     talloc_free(vc);
 }
 
-static inline void upload_to_texture(struct vo *vo, SDL_Texture *tex,
-                                     int w, int h, void *bitmap, int stride)
+static void upload_to_texture(struct vo *vo, SDL_Texture *tex,
+                              int w, int h, void *bitmap, int stride)
 {
     struct priv *vc = vo->priv;
+    SDL_Rect rc = {0, 0, w, h};
 
     if (vc->osd_format.sdl == SDL_PIXELFORMAT_ARGB8888) {
         // NOTE: this optimization is questionable, because SDL docs say
         // that this way is slow.
         // It did measure up faster, though...
-        SDL_UpdateTexture(tex, NULL, bitmap, stride);
+        SDL_UpdateTexture(tex, &rc, bitmap, stride);
         return;
     }
 
     void *pixels;
     int pitch;
-    if (SDL_LockTexture(tex, NULL, &pixels, &pitch)) {
+    if (SDL_LockTexture(tex, &rc, &pixels, &pitch)) {
         MP_ERR(vo, "Could not lock texture\n");
     } else {
         SDL_ConvertPixels(w, h, SDL_PIXELFORMAT_ARGB8888,
@@ -669,31 +762,65 @@ static inline void upload_to_texture(struct vo *vo, SDL_Texture *tex,
     }
 }
 
-static inline void subbitmap_to_texture(struct vo *vo, SDL_Texture *tex,
-                                        struct sub_bitmap *bmp,
-                                        uint32_t ormask)
+static SDL_Texture *create_osd_texture(struct vo *vo, int w, int h,
+                                       SDL_BlendMode mode)
 {
-    if (ormask == 0) {
-        upload_to_texture(vo, tex, bmp->w, bmp->h,
-                          bmp->bitmap, bmp->stride);
-    } else {
-        uint32_t *temppixels;
-        temppixels = talloc_array(vo, uint32_t, bmp->w * bmp->h);
-
-        int x, y;
-        for (y = 0; y < bmp->h; ++y) {
-            const uint32_t *src =
-                (const uint32_t *) ((const char *) bmp->bitmap + y * bmp->stride);
-            uint32_t *dst = temppixels + y * bmp->w;
-            for (x = 0; x < bmp->w; ++x)
-                dst[x] = src[x] | ormask;
-        }
+    struct priv *vc = vo->priv;
+    SDL_Texture *tex = SDL_CreateTexture(vc->renderer, vc->osd_format.sdl,
+                                         SDL_TEXTUREACCESS_STREAMING, w, h);
+    if (!tex) {
+        MP_ERR(vo, "Could not create texture\n");
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(tex, mode);
+    return tex;
+}
 
-        upload_to_texture(vo, tex, bmp->w, bmp->h,
-                          temppixels, sizeof(uint32_t) * bmp->w);
+// Pack all bitmaps into the surface's textures, uploading each texture with
+// a single update.
+static bool upload_osd(struct vo *vo, struct osd_bitmap_surface *sfc,
+                       struct sub_bitmaps *imgs)
+{
+    struct priv *vc = vo->priv;
+    struct bitmap_packer *packer = sfc->packer;
 
-        talloc_free(temppixels);
+    // The renderer filters scaled bitmaps, so keep them apart.
+    packer->padding = 1;
+    if (packer_pack_from_subbitmaps(packer, imgs) < 0) {
+        MP_ERR(vo, "OSD bitmaps do not fit on a texture with the maximum "
+               "supported size %dx%d.\n", packer->w_max, packer->h_max);
+        return false;
     }
+
+    if (!sfc->tex || !sfc->tex2 || packer->w > sfc->w || packer->h > sfc->h) {
+        if (sfc->tex)
+            SDL_DestroyTexture(sfc->tex);
+        if (sfc->tex2)
+            SDL_DestroyTexture(sfc->tex2);
+        sfc->w = MPMAX(32, packer->w);
+        sfc->h = MPMAX(32, packer->h);
+        sfc->tex = create_osd_texture(vo, sfc->w, sfc->h, SDL_BLENDMODE_BLEND);
+        sfc->tex2 = create_osd_texture(vo, sfc->w, sfc->h, SDL_BLENDMODE_ADD);
+        if (!sfc->tex || !sfc->tex2)
+            return false;
+        SDL_SetTextureColorMod(sfc->tex, 0, 0, 0); // RGBA -> 000A
+    }
+
+    // With padding set, packer_copy_subbitmaps() clears the gaps too.
+    struct pos bb[2];
+    packer_get_bb(packer, bb);
+    int w = bb[1].x, h = bb[1].y;
+    int stride = w * 4;
+    vc->osd_scratch = talloc_realloc_size(vc, vc->osd_scratch, stride * h);
+    uint32_t *pixels = vc->osd_scratch;
+    packer_copy_subbitmaps(packer, imgs, pixels, 4, stride);
+
+    upload_to_texture(vo, sfc->tex, w, h, pixels, stride);
+    for (int n = 0; n < w * h; n++)
+        pixels[n] |= 0xFF000000; // RGBA -> RGB1
+    upload_to_texture(vo, sfc->tex2, w, h, pixels, stride);
+
+    return true;
 }
 
 static void generate_osd_part(struct vo *vo, struct sub_bitmaps *imgs)
@@ -707,11 +834,17 @@ static void generate_osd_part(struct vo *vo, struct sub_bitmaps *imgs)
     if (imgs->bitmap_pos_id == sfc->bitmap_pos_id)
         return;
 
+    sfc->num_targets = 0;
+    if (imgs->bitmap_id != sfc->bitmap_id || !sfc->tex) {
+        if (!upload_osd(vo, sfc, imgs)) {
+            sfc->bitmap_id = sfc->bitmap_pos_id = -1;
+            return;
+        }
+    }
+
     if (imgs->num_parts > sfc->targets_size) {
         sfc->targets = talloc_realloc(vc, sfc->targets,
                                       struct osd_target, imgs->num_parts);
-        memset(&sfc->targets[sfc->targets_size], 0, sizeof(struct osd_target) *
-               (imgs->num_parts - sfc->targets_size));
         sfc->targets_size = imgs->num_parts;
     }
     sfc->num_targets = imgs->num_parts;
@@ -719,53 +852,14 @@ static void generate_osd_part(struct vo *vo, struct sub_bitmaps *imgs)
     for (int i = 0; i < imgs->num_parts; i++) {
         struct osd_target *target = sfc->targets + i;
         struct sub_bitmap *bmp = imgs->parts + i;
+        struct pos pos = sfc->packer->result[i];
 
         target->source = (SDL_Rect){
-            0, 0, bmp->w, bmp->h
+            pos.x, pos.y, bmp->w, bmp->h
         };
         target->dest = (SDL_Rect){
             bmp->x, bmp->y, bmp->dw, bmp->dh
         };
-
-        if (imgs->bitmap_id != sfc->bitmap_id || !target->tex) {
-            // tex: alpha blended texture
-            if (target->tex) {
-                SDL_DestroyTexture(target->tex);
-                target->tex = NULL;
-            }
-            if (!target->tex)
-                target->tex = SDL_CreateTexture(vc->renderer,
-                        vc->osd_format.sdl, SDL_TEXTUREACCESS_STREAMING,
-                        bmp->w, bmp->h);
-            if (!target->tex) {
-                MP_ERR(vo, "Could not create texture\n");
-            }
-            if (target->tex) {
-                SDL_SetTextureBlendMode(target->tex,
-                                        SDL_BLENDMODE_BLEND);
-                SDL_SetTextureColorMod(target->tex, 0, 0, 0);
-                subbitmap_to_texture(vo, target->tex, bmp, 0); // RGBA -> 000A
-            }
-
-            // tex2: added texture
-            if (target->tex2) {
-                SDL_DestroyTexture(target->tex2);
-                target->tex2 = NULL;
-            }
-            if (!target->tex2)
-                target->tex2 = SDL_CreateTexture(vc->renderer,
-                        vc->osd_format.sdl, SDL_TEXTUREACCESS_STREAMING,
-                        bmp->w, bmp->h);
-            if (!target->tex2) {
-                MP_ERR(vo, "Could not create texture\n");
-            }
-            if (target->tex2) {
-                SDL_SetTextureBlendMode(target->tex2,
-                                        SDL_BLENDMODE_ADD);
-                subbitmap_to_texture(vo, target->tex2, bmp,
-                                     0xFF000000); // RGBA -> RGB1
-            }
-        }
     }
 
     sfc->bitmap_id = imgs->bitmap_id;
@@ -780,12 +874,10 @@ static void draw_osd_part(struct vo *vo, int index)
 
     for (i = 0; i < sfc->num_targets; i++) {
         struct osd_target *target = sfc->targets + i;
-        if (target->tex)
-            SDL_RenderCopy(vc->renderer, target->tex,
-                           &target->source, &target->dest);
-        if (target->tex2)
-            SDL_RenderCopy(vc->renderer, target->tex2,
-                           &target->source, &target->dest);
+        SDL_RenderCopy(vc->renderer, sfc->tex,
+                       &target->source, &target->dest);
+        SDL_RenderCopy(vc->renderer, sfc->tex2,
+                       &target->source, &target->dest);
     }
 }
 
@@ -831,6 +923,9 @@ static int preinit(struct vo *vo)
         return -1;
     }
 
+    for (int n = 0; n < MAX_OSD_PARTS; n++)
+        vc->osd_surfaces[n].packer = talloc_zero(vc, struct bitmap_packer);
+
     // try creating a renderer (this also gets the renderer_info data
     // for query_format to use!)
     if (init_renderer(vo, &(struct mp_rect){.x1 = 640, .y1 = 480}, 0) != 0)
@@ -859,6 +954,80 @@ static int query_format(struct vo *vo, uint32_t format)
     return 0;
 }
 
+static void unref_dr_texture(void *ptr)
+{
+    struct video_tex *t = ptr;
+    t->in_use = false;
+}
+
+// Direct rendering: the decoder renders into a locked texture. The texture is
+// unlocked (uploaded) when the frame is drawn, and not reused before the last
+// reference to the image is gone.
+static struct mp_image *get_image(struct vo *vo, int imgfmt, int w, int h,
+                                  int stride_align)
+{
+    struct priv *vc = vo->priv;
+
+    if (!vc->can_dr || !vc->texfmt || imgfmt != vc->params.imgfmt ||
+        w < vc->params.w || h < vc->params.h)
+        return NULL;
+
+    // Some lines of slack, as decoders can write past the image.
+    int tex_h = MP_ALIGN_UP(h + 1, 2);
+
+    // Free textures of other sizes are most likely never going to be reused.
+    struct video_tex *t = NULL;
+    for (int n = vc->num_dr_textures - 1; n >= 0; n--) {
+        struct video_tex *cur = vc->dr_textures[n];
+        if (cur->in_use || cur == vc->cur_tex)
+            continue;
+        if (cur->w != w || cur->h != tex_h || cur->format != vc->texfmt) {
+            destroy_dr_texture(vc, n);
+        } else if (!t) {
+            t = cur;
+        }
+    }
+
+    if (!t) {
+        t = talloc_zero(NULL, struct video_tex);
+        if (!create_texture(vo, t, w, tex_h)) {
+            talloc_free(t);
+            return NULL;
+        }
+        MP_TARRAY_APPEND(vc, vc->dr_textures, vc->num_dr_textures, t);
+    }
+
+    if (!lock_texture(vo, t))
+        return NULL;
+
+    struct mp_image mpi = t->locked;
+    mp_image_set_size(&mpi, w, h);
+    for (int n = 0; n < mpi.num_planes; n++) {
+        if ((uintptr_t)mpi.planes[n] % stride_align ||
+            mpi.stride[n] % stride_align)
+        {
+            MP_VERBOSE(vo, "Texture memory is not aligned for direct "
+                       "rendering.\n");
+            return NULL;
+        }
+    }
+
+    t->in_use = true;
+    return mp_image_new_custom_ref(&mpi, t, unref_dr_texture);
+}
+
+// Return the texture the image was rendered into with get_image(), or NULL.
+static struct video_tex *find_dr_texture(struct priv *vc, struct mp_image *mpi)
+{
+    for (int n = 0; n < vc->num_dr_textures; n++) {
+        struct video_tex *t = vc->dr_textures[n];
+        if (t->in_use && t->locked.planes[0] &&
+            t->locked.planes[0] == mpi->planes[0])
+            return t;
+    }
+    return NULL;
+}
+
 static void draw_image(struct vo *vo, mp_image_t *mpi)
 {
     struct priv *vc = vo->priv;
@@ -895,30 +1064,42 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
     SDL_SetRenderDrawColor(vc->renderer, color_add, color_add, color_add, 255);
     SDL_RenderClear(vc->renderer);
 
-    // use additive blending for the video texture only if the clear color is
-    // not black (faster especially for the software renderer)
-    if (color_add)
-        SDL_SetTextureBlendMode(vc->tex, SDL_BLENDMODE_ADD);
-    else
-        SDL_SetTextureBlendMode(vc->tex, SDL_BLENDMODE_NONE);
-
     if (mpi) {
         vc->osd_pts = mpi->pts;
 
-        mp_image_t texmpi;
-        if (!lock_texture(vo, &texmpi)) {
-            talloc_free(mpi);
-            return;
+        struct video_tex *t = find_dr_texture(vc, mpi);
+        if (!t) {
+            // Use the next texture of the ring, so that the renderer doesn't
+            // have to wait until it's done with the previous frames.
+            t = &vc->ring[vc->ring_pos];
+            vc->ring_pos = (vc->ring_pos + 1) % vc->num_textures;
+            if (!t->tex || !lock_texture(vo, t)) {
+                talloc_free(mpi);
+                return;
+            }
+            struct mp_image texmpi = t->locked;
+            mp_image_set_size(&texmpi, mpi->w, mpi->h);
+            mp_image_copy(&texmpi, mpi);
         }
 
-        mp_image_copy(&texmpi, mpi);
-
-        SDL_UnlockTexture(vc->tex);
+        unlock_texture(t);
+        vc->cur_tex = t;
 
         talloc_free(vc->ssmpi);
         vc->ssmpi = mpi;
     }
 
+    struct video_tex *t = vc->cur_tex;
+    if (!t)
+        return;
+
+    // use additive blending for the video texture only if the clear color is
+    // not black (faster especially for the software renderer)
+    if (color_add)
+        SDL_SetTextureBlendMode(t->tex, SDL_BLENDMODE_ADD);
+    else
+        SDL_SetTextureBlendMode(t->tex, SDL_BLENDMODE_NONE);
+
     SDL_Rect src, dst;
     src.x = vc->src_rect.x0;
     src.y = vc->src_rect.y0;
@@ -931,12 +1112,12 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
 
     // typically this runs in parallel with the following mp_image_copy call
     if (color_mod > 255) {
-        SDL_SetTextureColorMod(vc->tex, color_mod / 2, color_mod / 2, color_mod / 2);
-        SDL_RenderCopy(vc->renderer, vc->tex, &src, &dst);
-        SDL_RenderCopy(vc->renderer, vc->tex, &src, &dst);
+        SDL_SetTextureColorMod(t->tex, color_mod / 2, color_mod / 2, color_mod / 2);
+        SDL_RenderCopy(vc->renderer, t->tex, &src, &dst);
+        SDL_RenderCopy(vc->renderer, t->tex, &src, &dst);
     } else {
-        SDL_SetTextureColorMod(vc->tex, color_mod, color_mod, color_mod);
-        SDL_RenderCopy(vc->renderer, vc->tex, &src, &dst);
+        SDL_SetTextureColorMod(t->tex, color_mod, color_mod, color_mod);
+        SDL_RenderCopy(vc->renderer, t->tex, &src, &dst);
     }
 
     draw_osd(vo);
@@ -1046,11 +1227,13 @@ const struct vo_driver video_out_sdl = {
     .priv_defaults = &(const struct priv) {
         .renderer_index = -1,
         .vsync = 1,
+        .num_textures = 3,
     },
     .options = (const struct m_option []){
         OPT_FLAG("sw", allow_sw, 0),
         OPT_FLAG("switch-mode", switch_mode, 0),
         OPT_FLAG("vsync", vsync, 0),
+        OPT_INTRANGE("buffers", num_textures, 0, 1, MAX_VIDEO_TEXTURES),
         {NULL}
     },
     .preinit = preinit,
@@ -1058,6 +1241,7 @@ const struct vo_driver video_out_sdl = {
     .reconfig = reconfig,
     .control = control,
     .draw_image = draw_image,
+    .get_image = get_image,
     .uninit = uninit,
     .flip_page = flip_page,
     .wait_events = wait_events,
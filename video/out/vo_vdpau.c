@@ -30,7 +30,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <math.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include <libavutil/common.h>
 
@@ -141,6 +143,26 @@ struct vdpctx {
         int bitmap_id;
         int bitmap_pos_id;
     } osd_surfaces[MAX_OSD_PARTS];
+    // talloc parent for OSD data; separate from vc, because the OSD thread
+    // allocates from it
+    void *osd_ta;
+
+    // Background OSD preparation. While osd_busy is set, the OSD thread owns
+    // osd_surfaces and osd_ta. All fields are protected by osd_lock.
+    int osd_thread_opt;
+    bool osd_thread_running;
+    pthread_t osd_thread;
+    pthread_mutex_t osd_lock;
+    pthread_cond_t osd_wakeup;
+    bool osd_terminate;
+    bool osd_request;
+    bool osd_busy;
+    double osd_prep_pts;
+    struct mp_osd_res osd_prep_res;
+    // osd_surfaces contains the OSD prepared for osd_prep_pts/osd_prep_res
+    bool osd_prep_ready;
+    bool osd_prep_parts[MAX_OSD_PARTS];
+    double prev_pts;
 
     // Video equalizer
     struct mp_csp_equalizer video_eq;
@@ -148,6 +170,7 @@ struct vdpctx {
 
 static bool status_ok(struct vo *vo);
 static void draw_osd(struct vo *vo);
+static void osd_wait_idle(struct vo *vo);
 
 static int render_video_to_output_surface(struct vo *vo,
                                           VdpOutputSurface output_surface,
@@ -231,6 +254,7 @@ static void forget_frames(struct vo *vo, bool seek_reset)
     if (!seek_reset)
         mp_image_unrefp(&vc->current_image);
 
+    vc->prev_pts = MP_NOPTS_VALUE;
     vc->dropped_frame = false;
 }
 
@@ -404,6 +428,8 @@ static void mark_vdpau_objects_uninitialized(struct vo *vo)
         vc->output_surfaces[i] = VDP_INVALID_HANDLE;
     vc->screenshot_surface = VDP_INVALID_HANDLE;
     vc->vdp_device = VDP_INVALID_HANDLE;
+    osd_wait_idle(vo);
+    vc->osd_prep_ready = false;
     for (int i = 0; i < MAX_OSD_PARTS; i++) {
         struct osd_bitmap_surface *sfc = &vc->osd_surfaces[i];
         talloc_free(sfc->packer);
@@ -469,7 +495,7 @@ static struct bitmap_packer *make_packer(struct vo *vo, VdpRGBAFormat format)
     struct vdpctx *vc = vo->priv;
     struct vdp_functions *vdp = vc->vdp;
 
-    struct bitmap_packer *packer = talloc_zero(vo, struct bitmap_packer);
+    struct bitmap_packer *packer = talloc_zero(vc->osd_ta, struct bitmap_packer);
     uint32_t w_max = 0, h_max = 0;
     VdpStatus vdp_st = vdp->
         bitmap_surface_query_capabilities(vc->vdp_device, format,
@@ -565,7 +591,8 @@ static void generate_osd_part(struct vo *vo, struct sub_bitmaps *imgs)
     if (!sfc->packer)
         sfc->packer = make_packer(vo, format);
     sfc->packer->padding = imgs->scaled; // assume 2x2 filter on scaling
-    int r = packer_pack_from_subbitmaps(sfc->packer, imgs);
+    // Bitmaps that are already on the surface keep their place.
+    int r = packer_pack_incremental(sfc->packer, imgs);
     if (r < 0) {
         MP_ERR(vo, "OSD bitmaps do not fit on a surface with the maximum "
                "supported size\n");
@@ -584,13 +611,27 @@ static void generate_osd_part(struct vo *vo, struct sub_bitmaps *imgs)
             sfc->surface = VDP_INVALID_HANDLE;
         CHECK_VDP_WARNING(vo, "OSD: error when creating surface");
     }
-    if (imgs->scaled) {
-        char zeros[sfc->packer->used_width * format_size];
+    if (imgs->scaled && sfc->surface != VDP_INVALID_HANDLE) {
+        // Clear the padding around new bitmaps. Include the left/top
+        // neighbours, which are sampled by the filter too, and may contain
+        // stale data.
+        char zeros[sfc->packer->w * format_size];
         memset(zeros, 0, sizeof(zeros));
-        vdp_st = vdp->bitmap_surface_put_bits_native(sfc->surface,
-                &(const void *){zeros}, &(uint32_t){0},
-                &(VdpRect){0, 0, sfc->packer->used_width,
-                                 sfc->packer->used_height});
+        int pad = sfc->packer->padding;
+        for (int i = 0; i < sfc->packer->count; i++) {
+            if (!sfc->packer->changed[i])
+                continue;
+            struct sub_bitmap *b = &imgs->parts[i];
+            struct pos p = sfc->packer->result[i];
+            VdpRect rc = {
+                FFMAX(p.x - pad, 0), FFMAX(p.y - pad, 0),
+                FFMIN(p.x + b->w + pad, sfc->packer->w),
+                FFMIN(p.y + b->h + pad, sfc->packer->h),
+            };
+            vdp_st = vdp->bitmap_surface_put_bits_native(sfc->surface,
+                    &(const void *){zeros}, &(uint32_t){0}, &rc);
+            CHECK_VDP_WARNING(vo, "OSD: clearing failed");
+        }
     }
 
 osd_skip_upload:
@@ -599,7 +640,7 @@ osd_skip_upload:
     if (sfc->packer->count > sfc->targets_size) {
         talloc_free(sfc->targets);
         sfc->targets_size = sfc->packer->count;
-        sfc->targets = talloc_size(vc, sfc->targets_size
+        sfc->targets = talloc_size(vc->osd_ta, sfc->targets_size
                                        * sizeof(*sfc->targets));
     }
 
@@ -618,7 +659,7 @@ osd_skip_upload:
             target->color.green = ((color >> 16) & 0xff) / 255.0;
             target->color.red   = ((color >> 24) & 0xff) / 255.0;
         }
-        if (need_upload) {
+        if (need_upload && sfc->packer->changed[i]) {
             vdp_st = vdp->
                 bitmap_surface_put_bits_native(sfc->surface,
                                                &(const void *){b->bitmap},
@@ -633,6 +674,11 @@ osd_skip_upload:
     sfc->bitmap_pos_id = imgs->bitmap_pos_id;
 }
 
+static const bool osd_formats[SUBBITMAP_COUNT] = {
+    [SUBBITMAP_LIBASS] = true,
+    [SUBBITMAP_RGBA] = true,
+};
+
 static void draw_osd_cb(void *ctx, struct sub_bitmaps *imgs)
 {
     struct vo *vo = ctx;
@@ -640,6 +686,81 @@ static void draw_osd_cb(void *ctx, struct sub_bitmaps *imgs)
     draw_osd_part(vo, imgs->render_index);
 }
 
+static void prepare_osd_cb(void *ctx, struct sub_bitmaps *imgs)
+{
+    struct vo *vo = ctx;
+    struct vdpctx *vc = vo->priv;
+    generate_osd_part(vo, imgs);
+    vc->osd_prep_parts[imgs->render_index] = true;
+}
+
+// Generate the OSD bitmap surfaces for the next frame ahead of time, so that
+// rendering the frame only needs to blit them. This runs osd_draw(), and thus
+// libass, which can take a while with complex subtitles.
+static void *osd_thread(void *ptr)
+{
+    struct vo *vo = ptr;
+    struct vdpctx *vc = vo->priv;
+
+    pthread_mutex_lock(&vc->osd_lock);
+    while (1) {
+        while (!vc->osd_request && !vc->osd_terminate)
+            pthread_cond_wait(&vc->osd_wakeup, &vc->osd_lock);
+        if (vc->osd_terminate)
+            break;
+        vc->osd_request = false;
+        double pts = vc->osd_prep_pts;
+        struct mp_osd_res res = vc->osd_prep_res;
+        pthread_mutex_unlock(&vc->osd_lock);
+
+        // osd_busy is set, so nothing else touches the OSD surfaces.
+        for (int n = 0; n < MAX_OSD_PARTS; n++)
+            vc->osd_prep_parts[n] = false;
+        osd_draw(vo->osd, res, pts, 0, osd_formats, prepare_osd_cb, vo);
+
+        pthread_mutex_lock(&vc->osd_lock);
+        vc->osd_prep_ready = true;
+        vc->osd_busy = false;
+        pthread_cond_broadcast(&vc->osd_wakeup);
+    }
+    pthread_mutex_unlock(&vc->osd_lock);
+    return NULL;
+}
+
+static void osd_wait_idle(struct vo *vo)
+{
+    struct vdpctx *vc = vo->priv;
+
+    if (!vc->osd_thread_running)
+        return;
+    pthread_mutex_lock(&vc->osd_lock);
+    while (vc->osd_busy)
+        pthread_cond_wait(&vc->osd_wakeup, &vc->osd_lock);
+    pthread_mutex_unlock(&vc->osd_lock);
+}
+
+static void osd_request_prepare(struct vo *vo, double pts)
+{
+    struct vdpctx *vc = vo->priv;
+
+    pthread_mutex_lock(&vc->osd_lock);
+    if (!vc->osd_busy) {
+        vc->osd_prep_pts = pts;
+        vc->osd_prep_res = vc->osd_rect;
+        vc->osd_prep_ready = false;
+        vc->osd_request = true;
+        vc->osd_busy = true;
+        pthread_cond_broadcast(&vc->osd_wakeup);
+    }
+    pthread_mutex_unlock(&vc->osd_lock);
+}
+
+static bool osd_res_equal(struct mp_osd_res a, struct mp_osd_res b)
+{
+    return a.w == b.w && a.h == b.h && a.mt == b.mt && a.mb == b.mb &&
+           a.ml == b.ml && a.mr == b.mr && a.display_par == b.display_par;
+}
+
 static void draw_osd(struct vo *vo)
 {
     struct vdpctx *vc = vo->priv;
@@ -647,13 +768,25 @@ static void draw_osd(struct vo *vo)
     if (!status_ok(vo))
         return;
 
-    static const bool formats[SUBBITMAP_COUNT] = {
-        [SUBBITMAP_LIBASS] = true,
-        [SUBBITMAP_RGBA] = true,
-    };
-
     double pts = vc->current_image ? vc->current_image->pts : 0;
-    osd_draw(vo->osd, vc->osd_rect, pts, 0, formats, draw_osd_cb, vo);
+
+    osd_wait_idle(vo);
+
+    // Use the surfaces prepared by the OSD thread if they are for this frame.
+    // Changes to the OSD made after the preparation show up one frame later.
+    bool prepared = vc->osd_prep_ready &&
+                    fabs(vc->osd_prep_pts - pts) < 0.001 &&
+                    osd_res_equal(vc->osd_prep_res, vc->osd_rect);
+    vc->osd_prep_ready = false;
+    if (prepared) {
+        for (int n = 0; n < MAX_OSD_PARTS; n++) {
+            if (vc->osd_prep_parts[n])
+                draw_osd_part(vo, n);
+        }
+        return;
+    }
+
+    osd_draw(vo->osd, vc->osd_rect, pts, 0, osd_formats, draw_osd_cb, vo);
 }
 
 static int update_presentation_queue_status(struct vo *vo)
@@ -848,8 +981,18 @@ static void draw_image(struct vo *vo, struct mp_image *mpi)
     talloc_free(vc->current_image);
     vc->current_image = vdp_mpi;
 
-    if (status_ok(vo))
+    if (status_ok(vo)) {
         video_to_output_surface(vo);
+
+        // Guess the next frame's pts from the current frame duration, and
+        // let the OSD thread prepare the OSD for it while we wait for the
+        // flip.
+        double pts = vdp_mpi ? vdp_mpi->pts : MP_NOPTS_VALUE;
+        if (vc->osd_thread_running && pts != MP_NOPTS_VALUE &&
+            vc->prev_pts != MP_NOPTS_VALUE && pts > vc->prev_pts)
+            osd_request_prepare(vo, pts + (pts - vc->prev_pts));
+        vc->prev_pts = pts;
+    }
 }
 
 // warning: the size and pixel format of surface must match that of the
@@ -956,6 +1099,7 @@ static void destroy_vdpau_objects(struct vo *vo)
         CHECK_VDP_WARNING(vo, "Error when calling vdp_output_surface_destroy");
     }
 
+    osd_wait_idle(vo);
     for (int i = 0; i < MAX_OSD_PARTS; i++) {
         struct osd_bitmap_surface *sfc = &vc->osd_surfaces[i];
         if (sfc->surface != VDP_INVALID_HANDLE) {
@@ -972,10 +1116,23 @@ static void uninit(struct vo *vo)
 {
     struct vdpctx *vc = vo->priv;
 
+    if (vc->osd_thread_running) {
+        pthread_mutex_lock(&vc->osd_lock);
+        vc->osd_terminate = true;
+        pthread_cond_broadcast(&vc->osd_wakeup);
+        pthread_mutex_unlock(&vc->osd_lock);
+        pthread_join(vc->osd_thread, NULL);
+        vc->osd_thread_running = false;
+    }
+    pthread_cond_destroy(&vc->osd_wakeup);
+    pthread_mutex_destroy(&vc->osd_lock);
+
     /* Destroy all vdpau objects */
     mp_vdpau_mixer_destroy(vc->video_mixer);
     destroy_vdpau_objects(vo);
 
+    talloc_free(vc->osd_ta);
+
     vo_x11_uninit(vo);
 }
 
@@ -994,6 +1151,11 @@ static int preinit(struct vo *vo)
 
     vc->hwdec_info.vdpau_ctx = vc->mpvdp;
 
+    vc->osd_ta = talloc_new(NULL);
+    vc->prev_pts = MP_NOPTS_VALUE;
+    pthread_mutex_init(&vc->osd_lock, NULL);
+    pthread_cond_init(&vc->osd_wakeup, NULL);
+
     vc->video_mixer = mp_vdpau_mixer_create(vc->mpvdp, vo->log);
 
     if (mp_vdpau_guess_if_emulated(vc->mpvdp)) {
@@ -1012,6 +1174,14 @@ static int preinit(struct vo *vo)
 
     vc->video_eq.capabilities = MP_CSP_EQ_CAPS_COLORMATRIX;
 
+    if (vc->osd_thread_opt) {
+        if (pthread_create(&vc->osd_thread, NULL, osd_thread, vo)) {
+            MP_WARN(vo, "Could not create OSD thread.\n");
+        } else {
+            vc->osd_thread_running = true;
+        }
+    }
+
     return 0;
 }
 
@@ -1151,6 +1321,7 @@ const struct vo_driver video_out_vdpau = {
                       .r = 2, .g = 5, .b = 7, .a = 255,
                   }),
         OPT_FLAG("force-yuv", force_yuv, 0),
+        OPT_FLAG("osd-thread", osd_thread_opt, 0, OPTDEF_INT(1)),
         {NULL},
     }
 };
@@ -83,16 +83,29 @@ static const format_t const format_table[] = {
 #define DEFAULT_FORMAT_ENTRY 1
 #define DEFAULT_ALPHA_FORMAT_ENTRY 0
 
+// Maximum number of video buffers. The pool starts with 2 buffers, and grows
+// if the compositor holds on to all of them when a new frame is drawn.
+#define MAX_VIDEO_BUFFERS 4
+
 struct priv;
 
-// We only use double buffering but the creation and usage is still open to
-// triple buffering. Tripple buffering is now removed, because double buffering
-// is now pixel-perfect.
 struct buffer_pool {
-    shm_buffer_t **buffers;
-    shm_buffer_t *front_buffer; // just pointers to any of the buffers
-    shm_buffer_t *back_buffer;
+    shm_buffer_t *buffers[MAX_VIDEO_BUFFERS];
     uint32_t buffer_no;
+    shm_buffer_t *front_buffer; // finished frame (any of the buffers, or DR)
+    shm_buffer_t *back_buffer;  // frame being drawn, until flip_page
+    bool front_new;             // front_buffer wasn't attached yet
+    // for growing the pool
+    uint32_t width, height;
+    format_t format;
+    struct wl_shm *shm;
+};
+
+// shm buffer the decoder renders into directly (see get_image())
+struct dr_buffer {
+    struct priv *p;
+    shm_buffer_t *buf;
+    bool in_use;                // referenced by a mp_image
 };
 
 struct supported_format {
@@ -121,6 +134,9 @@ struct priv {
 
     struct buffer_pool video_bufpool;
 
+    struct dr_buffer **dr_buffers;
+    int num_dr_buffers;
+
     struct mp_image *original_image;
     int width;  // width of the original image
     int height;
@@ -132,6 +148,8 @@ struct priv {
     shm_buffer_t *osd_buffers[MAX_OSD_PARTS];
     // this id tells us if the subtitle part has changed or not
     int bitmap_pos_id[MAX_OSD_PARTS];
+    bool osd_attached[MAX_OSD_PARTS];
+    bool osd_drawn[MAX_OSD_PARTS];      // part was drawn by the current draw
 
     int64_t recent_flip_time; // last frame event
 
@@ -196,12 +214,24 @@ static void buffer_pool_reinit(struct priv *p,
                                format_t fmt,
                                struct wl_shm *shm)
 {
-    if (!pool->buffers)
-        pool->buffers = calloc(buffer_no, sizeof(shm_buffer_t*));
+    pool->width = width;
+    pool->height = height;
+    pool->format = fmt;
+    pool->shm = shm;
+
+    // a format change requires new buffers
+    for (uint32_t i = 0; i < pool->buffer_no; ++i) {
+        if (pool->buffers[i] &&
+            pool->buffers[i]->format.wl_format != fmt.wl_format)
+        {
+            shm_buffer_destroy(pool->buffers[i]);
+            pool->buffers[i] = NULL;
+        }
+    }
 
-    pool->buffer_no = buffer_no;
+    pool->buffer_no = MPMAX(pool->buffer_no, buffer_no);
 
-    for (uint32_t i = 0; i < buffer_no; ++i) {
+    for (uint32_t i = 0; i < pool->buffer_no; ++i) {
         if (pool->buffers[i] == NULL)
             pool->buffers[i] = shm_buffer_create(width, height, fmt,
                                                  shm, &buffer_listener);
@@ -209,8 +239,9 @@ static void buffer_pool_reinit(struct priv *p,
             shm_buffer_resize(pool->buffers[i], width, height);
     }
 
-    pool->back_buffer = pool->buffers[0];
-    pool->front_buffer = pool->buffers[1];
+    pool->back_buffer = NULL;
+    pool->front_buffer = NULL;
+    pool->front_new = false;
 }
 
 static bool buffer_pool_resize(struct buffer_pool *pool,
@@ -219,8 +250,14 @@ static bool buffer_pool_resize(struct buffer_pool *pool,
 {
     bool ret = true;
 
-    for (uint32_t i = 0; ret && i < pool->buffer_no; ++i)
-        shm_buffer_resize(pool->buffers[i], width, height);
+    pool->width = width;
+    pool->height = height;
+
+    // busy buffers are resized on release, and not drawn into until then
+    for (uint32_t i = 0; ret && i < pool->buffer_no; ++i) {
+        if (pool->buffers[i])
+            shm_buffer_resize(pool->buffers[i], width, height);
+    }
 
     return ret;
 }
@@ -230,26 +267,53 @@ static void buffer_pool_destroy(struct buffer_pool *pool)
     for (uint32_t i = 0; i < pool->buffer_no; ++i)
         shm_buffer_destroy(pool->buffers[i]);
 
-    free(pool->buffers);
-    pool->front_buffer = NULL;
-    pool->back_buffer = NULL;
-    pool->buffers = NULL;
+    *pool = (struct buffer_pool){0};
 }
 
+// the drawn back buffer becomes the front buffer, which is attached with the
+// next frame callback
 static void buffer_pool_swap(struct buffer_pool *pool)
 {
-    if (SHM_BUFFER_IS_DIRTY(pool->back_buffer)) {
-        shm_buffer_t *tmp = pool->back_buffer;
-        pool->back_buffer = pool->front_buffer;
-        pool->front_buffer = tmp;
+    if (pool->back_buffer && SHM_BUFFER_IS_DIRTY(pool->back_buffer)) {
+        pool->front_buffer = pool->back_buffer;
+        pool->front_new = true;
+        pool->back_buffer = NULL;
     }
 }
 
-// returns NULL if the back buffer is busy
+// returns a buffer to draw the next frame into, or NULL if all are busy and
+// the pool can't grow
 static shm_buffer_t * buffer_pool_get_back(struct buffer_pool *pool)
 {
-    if (!pool->back_buffer || SHM_BUFFER_IS_BUSY(pool->back_buffer))
-        return NULL;
+    // (the back buffer can also be a DR buffer; don't draw into those)
+    for (uint32_t i = 0; i < pool->buffer_no; ++i) {
+        if (pool->back_buffer && pool->buffers[i] == pool->back_buffer &&
+            !SHM_BUFFER_IS_BUSY(pool->back_buffer))
+            return pool->back_buffer;
+    }
+
+    pool->back_buffer = NULL;
+    for (uint32_t i = 0; i < pool->buffer_no; ++i) {
+        shm_buffer_t *buf = pool->buffers[i];
+        // a front buffer that wasn't attached yet is still needed
+        if (!buf || SHM_BUFFER_IS_BUSY(buf) || SHM_BUFFER_PENDING_RESIZE(buf) ||
+            (buf == pool->front_buffer && pool->front_new))
+            continue;
+        pool->back_buffer = buf;
+        return buf;
+    }
+
+    // All buffers are held by the compositor (or the last one wasn't shown
+    // yet): add a buffer instead of waiting for a release.
+    if (pool->buffer_no < MAX_VIDEO_BUFFERS && pool->shm) {
+        shm_buffer_t *buf = shm_buffer_create(pool->width, pool->height,
+                                              pool->format, pool->shm,
+                                              &buffer_listener);
+        if (buf) {
+            pool->buffers[pool->buffer_no++] = buf;
+            pool->back_buffer = buf;
+        }
+    }
 
     return pool->back_buffer;
 }
@@ -277,9 +341,6 @@ static bool resize(struct priv *p)
 {
     struct vo_wayland_state *wl = p->wl;
 
-    if (SHM_BUFFER_IS_BUSY(p->video_bufpool.back_buffer))
-        return false; // skip resizing if we can't garantuee pixel perfectness!
-
     int32_t x = wl->window.sh_x;
     int32_t y = wl->window.sh_y;
     wl->vo->dwidth = wl->window.sh_width;
@@ -373,19 +434,30 @@ static void frame_handle_redraw(void *data,
     struct vo_wayland_state *wl = p->wl;
     shm_buffer_t *buf = buffer_pool_get_front(&p->video_bufpool);
 
-    wl_surface_attach(wl->window.video_surface, buf->buffer, p->x, p->y);
-    wl_surface_damage(wl->window.video_surface, 0, 0, p->dst_w, p->dst_h);
+    // Only attach and damage the surface if there is a new frame. Otherwise
+    // the commit just requests the next frame callback, and the compositor
+    // doesn't need to repaint the video.
+    bool attach = buf && p->video_bufpool.front_new;
+    if (attach) {
+        wl_surface_attach(wl->window.video_surface, buf->buffer, p->x, p->y);
+        wl_surface_damage(wl->window.video_surface, 0, 0, p->dst_w, p->dst_h);
+    }
 
-    if (callback)
+    if (callback) {
         wl_callback_destroy(callback);
+        vo_wayland_frame_done(wl, time);
+    }
 
     p->redraw_callback = wl_surface_frame(wl->window.video_surface);
     wl_callback_add_listener(p->redraw_callback, &frame_listener, p);
     wl_surface_commit(wl->window.video_surface);
-    buffer_finalise_front(buf);
 
-    p->x = 0;
-    p->y = 0;
+    if (attach) {
+        buffer_finalise_front(buf);
+        p->video_bufpool.front_new = false;
+        p->x = 0;
+        p->y = 0;
+    }
     p->recent_flip_time = mp_time_us();
 }
 
@@ -417,16 +489,47 @@ static const struct wl_shm_listener shm_listener = {
 
 /* mpv interface */
 
+static struct dr_buffer *find_dr_buffer(struct priv *p, struct mp_image *mpi)
+{
+    for (int n = 0; n < p->num_dr_buffers; n++) {
+        struct dr_buffer *dr = p->dr_buffers[n];
+        uint8_t *data = dr->buf->data;
+        if (dr->in_use && mpi->planes[0] >= data &&
+            mpi->planes[0] < data + dr->buf->pool_size)
+            return dr;
+    }
+    return NULL;
+}
+
+// Whether images can be shown as they are, without scaling or conversion.
+static bool can_show_direct(struct priv *p)
+{
+    return p->video_format->mp_format == p->in_format.imgfmt &&
+           p->src.x0 == 0 && p->src.y0 == 0 &&
+           p->src_w == p->width && p->src_h == p->height &&
+           p->dst_w == p->width && p->dst_h == p->height;
+}
+
 static void draw_image(struct vo *vo, mp_image_t *mpi)
 {
     struct priv *p = vo->priv;
-    shm_buffer_t *buf = buffer_pool_get_back(&p->video_bufpool);
 
     if (mpi) {
         talloc_free(p->original_image);
         p->original_image = mpi;
+
+        // The decoder rendered into a shm buffer: show it without copying.
+        struct dr_buffer *dr = find_dr_buffer(p, mpi);
+        if (dr && can_show_direct(p) && !SHM_BUFFER_IS_BUSY(dr->buf)) {
+            p->video_bufpool.back_buffer = dr->buf;
+            buffer_finalise_back(dr->buf);
+            draw_osd(vo);
+            return;
+        }
     }
 
+    shm_buffer_t *buf = buffer_pool_get_back(&p->video_bufpool);
+
     if (!buf) {
         // TODO: use similar handling of busy buffers as the osd buffers
         // if the need arises
@@ -460,7 +563,9 @@ static void draw_osd_cb(void *ctx, struct sub_bitmaps *imgs)
 
     struct wl_surface *s = p->osd_surfaces[id];
 
-    if (imgs->bitmap_pos_id != p->bitmap_pos_id[id]) {
+    p->osd_drawn[id] = true;
+
+    if (imgs->bitmap_pos_id != p->bitmap_pos_id[id] || !p->osd_attached[id]) {
         p->bitmap_pos_id[id] = imgs->bitmap_pos_id;
 
         struct mp_rect bb;
@@ -506,13 +611,9 @@ static void draw_osd_cb(void *ctx, struct sub_bitmaps *imgs)
         wl_surface_attach(s, buf->buffer, bb.x0, bb.y0);
         wl_surface_damage(s, 0, 0, width, height);
         wl_surface_commit(s);
+        p->osd_attached[id] = true;
     }
-    else {
-        // p->osd_buffer, garantueed to exist here
-        assert(p->osd_buffers[id]);
-        wl_surface_attach(s, p->osd_buffers[id]->buffer, 0, 0);
-        wl_surface_commit(s);
-    }
+    // unchanged parts stay attached, and need no commit or damage
 }
 
 static const bool osd_formats[SUBBITMAP_COUNT] = {
@@ -523,18 +624,23 @@ static void draw_osd(struct vo *vo)
 {
     struct priv *p = vo->priv;
 
-    // deattach all buffers and attach all needed buffers in osd_draw
+    for (int i = 0; i < MAX_OSD_PARTS; ++i)
+        p->osd_drawn[i] = false;
+
+    double pts = p->original_image ? p->original_image->pts : 0;
+    osd_draw(vo->osd, p->osd, pts, 0, osd_formats, draw_osd_cb, p);
+
+    // detach the parts that disappeared
     // only the most recent attach & commit is applied once the parent surface
     // is committed
     for (int i = 0; i < MAX_OSD_PARTS; ++i) {
-        struct wl_surface *s = p->osd_surfaces[i];
-        wl_surface_attach(s, NULL, 0, 0);
-        wl_surface_damage(s, 0, 0, p->dst_w, p->dst_h);
-        wl_surface_commit(s);
+        if (p->osd_attached[i] && !p->osd_drawn[i]) {
+            struct wl_surface *s = p->osd_surfaces[i];
+            wl_surface_attach(s, NULL, 0, 0);
+            wl_surface_commit(s);
+            p->osd_attached[i] = false;
+        }
     }
-
-    double pts = p->original_image ? p->original_image->pts : 0;
-    osd_draw(vo->osd, p->osd, pts, 0, osd_formats, draw_osd_cb, p);
 }
 
 static void flip_page(struct vo *vo)
@@ -549,6 +655,77 @@ static void flip_page(struct vo *vo)
     }
 }
 
+static void destroy_dr_buffer(struct priv *p, int index)
+{
+    struct dr_buffer *dr = p->dr_buffers[index];
+    shm_buffer_destroy(dr->buf);
+    talloc_free(dr);
+    MP_TARRAY_REMOVE_AT(p->dr_buffers, p->num_dr_buffers, index);
+}
+
+static void unref_dr_buffer(void *ptr)
+{
+    struct dr_buffer *dr = ptr;
+    dr->in_use = false;
+}
+
+static struct mp_image *get_image(struct vo *vo, int imgfmt, int w, int h,
+                                  int stride_align)
+{
+    struct priv *p = vo->priv;
+
+    if (!p->video_format || imgfmt != p->video_format->mp_format ||
+        !can_show_direct(p) || w < p->width || h < p->height)
+        return NULL;
+
+    struct mp_image mpi = {0};
+    mp_image_setfmt(&mpi, imgfmt);
+    mp_image_set_size(&mpi, w, h);
+    if (mpi.num_planes != 1 || (mpi.fmt.flags & MP_IMGFLAG_PAL))
+        return NULL;
+
+    // Free buffers of other sizes are most likely never going to be reused.
+    struct dr_buffer *dr = NULL;
+    for (int n = p->num_dr_buffers - 1; n >= 0; n--) {
+        struct dr_buffer *cur = p->dr_buffers[n];
+        if (cur->in_use || SHM_BUFFER_IS_BUSY(cur->buf) ||
+            cur->buf == p->video_bufpool.front_buffer)
+            continue;
+        if (cur->buf->stride != SHM_BUFFER_STRIDE(w, cur->buf->bytes) ||
+            cur->buf->height != h + 1 ||
+            cur->buf->format.wl_format != p->video_format->wl_format)
+        {
+            destroy_dr_buffer(p, n);
+        } else if (!dr) {
+            dr = cur;
+        }
+    }
+
+    if (!dr) {
+        // One additional line, as decoders can write past the image.
+        shm_buffer_t *buf = shm_buffer_create(w, h + 1, *p->video_format,
+                                              p->wl->display.shm,
+                                              &buffer_listener);
+        if (!buf)
+            return NULL;
+        if (buf->stride % stride_align ||
+            shm_buffer_crop(buf, p->width, p->height) < 0)
+        {
+            shm_buffer_destroy(buf);
+            return NULL;
+        }
+        dr = talloc_ptrtype(NULL, dr);
+        *dr = (struct dr_buffer){ .p = p, .buf = buf };
+        MP_TARRAY_APPEND(p, p->dr_buffers, p->num_dr_buffers, dr);
+    }
+
+    mpi.planes[0] = dr->buf->data;
+    mpi.stride[0] = dr->buf->stride;
+    dr->in_use = true;
+
+    return mp_image_new_custom_ref(&mpi, dr, unref_dr_buffer);
+}
+
 static int query_format(struct vo *vo, uint32_t format)
 {
     struct priv *p = vo->priv;
@@ -603,6 +780,12 @@ static int reconfig(struct vo *vo, struct mp_image_params *fmt, int flags)
             p->video_format = entry;
     }
 
+    for (int n = p->num_dr_buffers - 1; n >= 0; n--) {
+        struct dr_buffer *dr = p->dr_buffers[n];
+        if (!dr->in_use && !SHM_BUFFER_IS_BUSY(dr->buf))
+            destroy_dr_buffer(p, n);
+    }
+
     buffer_pool_reinit(p, &p->video_bufpool, 2, p->width, p->height,
                        *p->video_format, p->wl->display.shm);
 
@@ -618,6 +801,10 @@ static void uninit(struct vo *vo)
     struct priv *p = vo->priv;
     buffer_pool_destroy(&p->video_bufpool);
 
+    // all images must have been freed at this point
+    while (p->num_dr_buffers)
+        destroy_dr_buffer(p, p->num_dr_buffers - 1);
+
     if (p->redraw_callback)
         wl_callback_destroy(p->redraw_callback);
 
@@ -645,6 +832,7 @@ static int preinit(struct vo *vo)
     p->vo = vo;
     p->wl = wl;
     p->sws = mp_sws_alloc(vo);
+    p->sws->threads = 0;
 
     wl_list_init(&p->format_list);
 
@@ -718,6 +906,7 @@ const struct vo_driver video_out_wayland = {
     .reconfig = reconfig,
     .control = control,
     .draw_image = draw_image,
+    .get_image = get_image,
     .flip_page = flip_page,
     .uninit = uninit,
     .options = (const struct m_option[]) {
@@ -56,18 +56,23 @@
 #include "options/options.h"
 #include "osdep/timer.h"
 
+/* Images are used in turn. With XShm, an image is reused only after the X
+ * server has finished reading it, so converting the next frame can overlap
+ * with the server copying the previous ones. */
+#define MAX_BUFFERS 3
+
 struct priv {
     struct vo *vo;
 
     struct mp_image *original_image;
 
     /* local data */
-    unsigned char *ImageData[2];
+    unsigned char *ImageData[MAX_BUFFERS];
     //! original unaligned pointer for free
-    unsigned char *ImageDataOrig[2];
+    unsigned char *ImageDataOrig[MAX_BUFFERS];
 
     /* X11 related variables */
-    XImage *myximage[2];
+    XImage *myximage[MAX_BUFFERS];
     int depth, bpp;
     XWindowAttributes attribs;
 
@@ -95,11 +100,12 @@ struct priv {
 #if HAVE_SHM
     int Shm_Warned_Slow;
 
-    XShmSegmentInfo Shminfo[2];
+    XShmSegmentInfo Shminfo[MAX_BUFFERS];
 #endif
 };
 
 static bool resize(struct vo *vo);
+static void wait_for_completion(struct vo *vo, int max_outstanding);
 
 /* Scan the available visuals on this Display/Screen.  Try to find
  * the 'best' available TrueColor visual that has a decent color
@@ -316,6 +322,8 @@ static bool resize(struct vo *vo)
 {
     struct priv *p = vo->priv;
 
+    // the X server might still be reading from the images
+    wait_for_completion(vo, 0);
     for (int i = 0; i < p->num_buffers; i++)
         freeMyXImage(p, i);
 
@@ -341,7 +349,8 @@ static bool resize(struct vo *vo)
     p->image_width = (p->dst_w + 7) & (~7);
     p->image_height = p->dst_h;
 
-    p->num_buffers = 2;
+    p->num_buffers = MAX_BUFFERS;
+    p->current_buf = 0;
     for (int i = 0; i < p->num_buffers; i++)
         getMyXImage(p, i);
 
@@ -434,16 +443,13 @@ static void wait_for_completion(struct vo *vo, int max_outstanding)
 #if HAVE_SHM && HAVE_XEXT
     struct priv *ctx = vo->priv;
     struct vo_x11_state *x11 = vo->x11;
-    if (ctx->Shmem_Flag) {
-        while (x11->ShmCompletionWaitCount > max_outstanding) {
-            if (!ctx->Shm_Warned_Slow) {
-                MP_WARN(vo, "can't keep up! Waiting"
-                            " for XShm completion events...\n");
-                ctx->Shm_Warned_Slow = 1;
-            }
-            mp_sleep_us(1000);
-            vo_x11_check_events(vo);
+    if (ctx->Shmem_Flag && x11->ShmCompletionWaitCount > max_outstanding) {
+        if (!ctx->Shm_Warned_Slow && max_outstanding > 0) {
+            MP_WARN(vo, "can't keep up! Waiting"
+                        " for XShm completion events...\n");
+            ctx->Shm_Warned_Slow = 1;
         }
+        vo_x11_wait_shm_completion(vo, max_outstanding);
     }
 #endif
 }
@@ -569,10 +575,11 @@ static void find_x11_depth(struct vo *vo)
 static void uninit(struct vo *vo)
 {
     struct priv *p = vo->priv;
-    if (p->myximage[0])
-        freeMyXImage(p, 0);
-    if (p->myximage[1])
-        freeMyXImage(p, 1);
+    wait_for_completion(vo, 0);
+    for (int i = 0; i < MAX_BUFFERS; i++) {
+        if (p->myximage[i])
+            freeMyXImage(p, i);
+    }
 
     talloc_free(p->original_image);
 
@@ -588,6 +595,8 @@ static int preinit(struct vo *vo)
         return -1;              // Can't open X11
     find_x11_depth(vo);
     p->sws = mp_sws_alloc(vo);
+    p->sws->log = vo->log;
+    p->sws->threads = 0;
     return 0;
 }
 
@@ -68,6 +68,11 @@
 #define CK_SRC_SET           1 // use and set specified / default colorkey
 #define CK_SRC_CUR           2 // use current colorkey (get it from xv)
 
+/* Images are used in turn. With XShm, an image is reused only after the X
+ * server has finished reading it, so copying the next frame can overlap with
+ * the server processing the previous ones. */
+#define MAX_BUFFERS 3
+
 struct xvctx {
     struct xv_ck_info_s {
         int method; // CK_METHOD_* constants
@@ -83,7 +88,7 @@ struct xvctx {
     int current_buf;
     int current_ip_buf;
     int num_buffers;
-    XvImage *xvimage[2];
+    XvImage *xvimage[MAX_BUFFERS];
     struct mp_image *original_image;
     uint32_t image_width;
     uint32_t image_height;
@@ -94,7 +99,7 @@ struct xvctx {
     uint32_t max_width, max_height; // zero means: not set
     int Shmem_Flag;
 #if HAVE_SHM && HAVE_XEXT
-    XShmSegmentInfo Shminfo[2];
+    XShmSegmentInfo Shminfo[MAX_BUFFERS];
     int Shm_Warned_Slow;
 #endif
 };
@@ -114,6 +119,7 @@ static const struct fmt_entry fmt_table[] = {
 static bool allocate_xvimage(struct vo *, int);
 static void deallocate_xvimage(struct vo *vo, int foo);
 static struct mp_image get_xv_buffer(struct vo *vo, int buf_index);
+static void wait_for_completion(struct vo *vo, int max_outstanding);
 
 static int find_xv_format(int imgfmt)
 {
@@ -463,10 +469,11 @@ static int reconfig(struct vo *vo, struct mp_image_params *params, int flags)
     MP_VERBOSE(vo, "using Xvideo port %d for hw scaling\n", ctx->xv_port);
 
     // In case config has been called before
+    wait_for_completion(vo, 0);
     for (i = 0; i < ctx->num_buffers; i++)
         deallocate_xvimage(vo, i);
 
-    ctx->num_buffers = 2;
+    ctx->num_buffers = MAX_BUFFERS;
 
     for (i = 0; i < ctx->num_buffers; i++) {
         if (!allocate_xvimage(vo, i)) {
@@ -623,16 +630,13 @@ static void wait_for_completion(struct vo *vo, int max_outstanding)
 #if HAVE_SHM && HAVE_XEXT
     struct xvctx *ctx = vo->priv;
     struct vo_x11_state *x11 = vo->x11;
-    if (ctx->Shmem_Flag) {
-        while (x11->ShmCompletionWaitCount > max_outstanding) {
-            if (!ctx->Shm_Warned_Slow) {
-                MP_WARN(vo, "X11 can't keep up! Waiting"
+    if (ctx->Shmem_Flag && x11->ShmCompletionWaitCount > max_outstanding) {
+        if (!ctx->Shm_Warned_Slow && max_outstanding > 0) {
+            MP_WARN(vo, "X11 can't keep up! Waiting"
                         " for XShm completion events...\n");
-                ctx->Shm_Warned_Slow = 1;
-            }
-            mp_sleep_us(1000);
-            vo_x11_check_events(vo);
+            ctx->Shm_Warned_Slow = 1;
         }
+        vo_x11_wait_shm_completion(vo, max_outstanding);
     }
 #endif
 }
@@ -711,6 +715,7 @@ static void uninit(struct vo *vo)
         XFree(ctx->fo);
         ctx->fo = NULL;
     }
+    wait_for_completion(vo, 0);
     for (i = 0; i < ctx->num_buffers; i++)
         deallocate_xvimage(vo, i);
     // uninit() shouldn't get called unless initialization went past vo_init()
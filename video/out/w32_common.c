@@ -500,6 +500,10 @@ static bool handle_char(struct vo_w32_state *w32, wchar_t wc)
 
 static void signal_events(struct vo_w32_state *w32, int events)
 {
+    // The VO reads all pending events at once, so a burst of messages (e.g.
+    // WM_SIZE and WM_PAINT while the window is resized) wakes it up once.
+    if ((w32->event_flags | events) == w32->event_flags)
+        return;
     w32->event_flags |= events;
     vo_wakeup(w32->vo);
 }
@@ -1190,8 +1194,17 @@ static void do_control(void *ptr)
     void *arg = p[3];
     int *ret = p[4];
     *ret = gui_thread_control(w32, events, request, arg);
-    *events |= w32->event_flags;
+    int pending = w32->event_flags;
     w32->event_flags = 0;
+    // Size changes from window messages are rate limited. A resize that is
+    // held back stays pending, and is applied with the size current by then.
+    if ((pending & VO_EVENT_RESIZE) && !(*events & VO_EVENT_RESIZE) &&
+        !vo_resize_allowed(w32->vo))
+    {
+        pending &= ~VO_EVENT_RESIZE;
+        w32->event_flags = VO_EVENT_RESIZE;
+    }
+    *events |= pending;
     // Safe access, since caller (owner of vo) is blocked.
     if (*events & VO_EVENT_RESIZE) {
         w32->vo->dwidth = w32->dw;
@@ -124,6 +124,24 @@ int shm_buffer_pending_resize(shm_buffer_t *buffer)
     }
 }
 
+int shm_buffer_crop(shm_buffer_t *buffer, uint32_t width, uint32_t height)
+{
+    if (width * buffer->bytes > buffer->stride || height > buffer->height ||
+        SHM_BUFFER_IS_BUSY(buffer))
+        return -1;
+
+    const void *listener = wl_proxy_get_listener((struct wl_proxy*)buffer->buffer);
+
+    wl_buffer_destroy(buffer->buffer);
+    buffer->buffer = wl_shm_pool_create_buffer(buffer->shm_pool,
+                                               0, width, height, buffer->stride,
+                                               buffer->format.wl_format);
+
+    wl_buffer_add_listener(buffer->buffer, listener, buffer);
+
+    return 0;
+}
+
 void shm_buffer_destroy(shm_buffer_t *buffer)
 {
     if (!buffer)
@@ -96,6 +96,10 @@ int shm_buffer_resize(shm_buffer_t *buffer, uint32_t width, uint32_t height);
 // returns 0 if no pending resize flag was set and -1 on errors
 int shm_buffer_pending_resize(shm_buffer_t *buffer);
 
+// make the wl_buffer cover only the top left width x height pixels, keeping
+// the stride (for buffers with padding); returns 0 on success
+int shm_buffer_crop(shm_buffer_t *buffer, uint32_t width, uint32_t height);
+
 // buffer is freed, don't use the buffer after calling this function on it
 void shm_buffer_destroy(shm_buffer_t *buffer);
 
@@ -977,6 +977,8 @@ int vo_wayland_init (struct vo *vo)
 void vo_wayland_uninit (struct vo *vo)
 {
     struct vo_wayland_state *wl = vo->wayland;
+    if (wl->frame.callback)
+        wl_callback_destroy(wl->frame.callback);
     destroy_cursor(wl);
     destroy_window(wl);
     destroy_display(wl);
@@ -1206,10 +1208,109 @@ int vo_wayland_control (struct vo *vo, int *events, int request, void *arg)
         *(double*) arg = fps;
         return VO_TRUE;
     }
+    case VOCTRL_GET_PRESENT_FEEDBACK:
+        return vo_wayland_get_present_feedback(vo, arg) ? VO_TRUE : VO_NOTAVAIL;
     }
     return VO_NOTIMPL;
 }
 
+// Refresh period of the current output in microseconds, or 0 if unknown.
+static int64_t get_vsync_period(struct vo_wayland_state *wl)
+{
+    struct vo_wayland_output *o = wl->display.current_output;
+    // refresh rate is stored in milli-Hertz (mHz)
+    return o && o->refresh_rate > 0 ? 1000000000LL / o->refresh_rate : 0;
+}
+
+// Record a frame callback. Callers which request a new callback each time
+// one arrives (vo_wayland) get one per display refresh, while others get one
+// per presented frame; vsyncs in between are estimated from the refresh rate.
+void vo_wayland_frame_done(struct vo_wayland_state *wl, uint32_t time)
+{
+    int64_t now = mp_time_us();
+
+    // The timestamp has millisecond resolution and an unspecified base, which
+    // in practice is CLOCK_MONOTONIC (as with mp_raw_time_us()). Use it only
+    // if the result is plausible.
+    int64_t vsync_time = now;
+    int32_t age_ms = (uint32_t)(mp_raw_time_us() / 1000) - time;
+    if (age_ms >= 0 && age_ms < 1000)
+        vsync_time = now - age_ms * 1000LL;
+
+    int64_t period = get_vsync_period(wl);
+    int64_t vsyncs = 1;
+    if (wl->frame.vsync_time && period)
+        vsyncs = MPMAX((vsync_time - wl->frame.vsync_time + period / 2) / period, 1);
+    wl->frame.vsync_count += vsyncs;
+    wl->frame.vsync_time = MPMAX(vsync_time, wl->frame.vsync_time);
+}
+
+static void frame_callback_done(void *data, struct wl_callback *callback,
+                                uint32_t time)
+{
+    struct vo_wayland_state *wl = data;
+    wl_callback_destroy(callback);
+    wl->frame.callback = NULL;
+    vo_wayland_frame_done(wl, time);
+}
+
+static const struct wl_callback_listener frame_callback_listener = {
+    frame_callback_done
+};
+
+// Request a frame callback with the next commit of the video surface, unless
+// one is still pending.
+void vo_wayland_request_frame(struct vo *vo)
+{
+    struct vo_wayland_state *wl = vo->wayland;
+    if (wl->frame.callback || !wl->window.video_surface)
+        return;
+    wl->frame.callback = wl_surface_frame(wl->window.video_surface);
+    wl_callback_add_listener(wl->frame.callback, &frame_callback_listener, wl);
+}
+
+// Wait until the callback requested by vo_wayland_request_frame() arrives,
+// i.e. the compositor started showing the frame committed with it. The wait
+// is limited, because the compositor sends no callbacks for hidden windows.
+// Returns false on timeout.
+bool vo_wayland_wait_frame(struct vo *vo)
+{
+    struct vo_wayland_state *wl = vo->wayland;
+    struct wl_display *dp = wl->display.display;
+
+    int64_t period = get_vsync_period(wl);
+    int64_t deadline = mp_time_us() + (period ? MPMAX(period * 2, 20000) : 50000);
+
+    wl_display_dispatch_pending(dp);
+    while (wl->frame.callback) {
+        wl_display_flush(dp);
+        int64_t wait_us = deadline - mp_time_us();
+        if (wait_us <= 0)
+            return false;
+        struct pollfd fd = { wl->display.display_fd, POLLIN, 0 };
+        if (poll(&fd, 1, (wait_us + 999) / 1000) < 0 ||
+            (fd.revents & (POLLERR | POLLHUP)))
+            return false;
+        if (fd.revents & POLLIN)
+            wl_display_dispatch(dp);
+    }
+    return true;
+}
+
+bool vo_wayland_get_present_feedback(struct vo *vo,
+                                     struct vo_present_feedback *fb)
+{
+    struct vo_wayland_state *wl = vo->wayland;
+    int64_t now = mp_time_us();
+    if (!wl->frame.vsync_time || wl->frame.vsync_time < now - 1000000)
+        return false;
+    *fb = (struct vo_present_feedback){
+        .vsync_count = wl->frame.vsync_count,
+        .vsync_time = wl->frame.vsync_time,
+    };
+    return true;
+}
+
 bool vo_wayland_config (struct vo *vo, uint32_t flags)
 {
     struct vo_wayland_state *wl = vo->wayland;
@@ -133,6 +133,13 @@ struct vo_wayland_state {
         struct wl_data_offer *offer;
         int dnd_fd;
     } input;
+
+    // wl_surface.frame callbacks, used for pacing and presentation feedback
+    struct {
+        struct wl_callback *callback;   // requested by vo_wayland_request_frame
+        int64_t vsync_count;            // estimated display vsyncs
+        int64_t vsync_time;             // mp_time_us() of the last callback
+    } frame;
 };
 
 int vo_wayland_init(struct vo *vo);
@@ -140,5 +147,12 @@ void vo_wayland_uninit(struct vo *vo);
 bool vo_wayland_config(struct vo *vo, uint32_t flags);
 int vo_wayland_control(struct vo *vo, int *events, int request, void *arg);
 
+struct vo_present_feedback;
+void vo_wayland_frame_done(struct vo_wayland_state *wl, uint32_t time);
+void vo_wayland_request_frame(struct vo *vo);
+bool vo_wayland_wait_frame(struct vo *vo);
+bool vo_wayland_get_present_feedback(struct vo *vo,
+                                     struct vo_present_feedback *fb);
+
 #endif /* MPLAYER_WAYLAND_COMMON_H */
 
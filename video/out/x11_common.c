@@ -34,6 +34,7 @@
 
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
 #include <assert.h>
 
 #include "vo.h"
@@ -797,11 +798,15 @@ static void vo_x11_dnd_handle_selection(struct vo *vo, XSelectionEvent *se)
     dnd_reset(vo);
 }
 
-static void update_vo_size(struct vo *vo)
+// throttle: rate limit size changes caused by window events (see
+// vo_resize_allowed()), instead of applying them immediately
+static void update_vo_size(struct vo *vo, bool throttle)
 {
     struct vo_x11_state *x11 = vo->x11;
 
-    if (RC_W(x11->winrc) != vo->dwidth || RC_H(x11->winrc) != vo->dheight) {
+    if ((RC_W(x11->winrc) != vo->dwidth || RC_H(x11->winrc) != vo->dheight) &&
+        (!throttle || vo_resize_allowed(vo)))
+    {
         vo->dwidth = RC_W(x11->winrc);
         vo->dheight = RC_H(x11->winrc);
         x11->pending_vo_events |= VO_EVENT_RESIZE;
@@ -822,11 +827,45 @@ static int get_mods(unsigned int state)
     return modifiers;
 }
 
+// Wait until at most max_outstanding XShmPutImage requests are unfinished.
+// Completion events arrive in request order, so with images used in turn, this
+// means the oldest image can be reused. Other events are processed as with
+// vo_x11_check_events().
+void vo_x11_wait_shm_completion(struct vo *vo, int max_outstanding)
+{
+    struct vo_x11_state *x11 = vo->x11;
+    Display *display = x11->display;
+    int64_t deadline = mp_time_us() + 500 * 1000;
+
+    XFlush(display);
+    while (x11->ShmCompletionWaitCount > max_outstanding) {
+        int64_t now = mp_time_us();
+        if (now >= deadline) {
+            // Don't block forever if the server lost or never sent an event.
+            MP_WARN(x11, "Timeout waiting for XShm completion events.\n");
+            x11->ShmCompletionWaitCount = max_outstanding;
+            break;
+        }
+        if (!XPending(display)) {
+            struct pollfd fd = {
+                .fd = ConnectionNumber(display),
+                .events = POLLIN,
+            };
+            poll(&fd, 1, (deadline - now) / 1000 + 1);
+        }
+        vo_x11_check_events(vo);
+    }
+}
+
 int vo_x11_check_events(struct vo *vo)
 {
     struct vo_x11_state *x11 = vo->x11;
     Display *display = vo->x11->display;
     XEvent Event;
+    // Geometry changes are handled once after all queued events were read,
+    // because querying the geometry needs server round trips.
+    bool update_geometry = false;
+    bool resize_parent = false;
 
     xscreensaver_heartbeat(vo->x11);
 
@@ -839,12 +878,9 @@ int vo_x11_check_events(struct vo *vo)
         case ConfigureNotify:
             if (x11->window == None)
                 break;
-            vo_x11_update_geometry(vo);
-            if (Event.xconfigure.window == (Window)vo->opts->WinID) {
-                XMoveResizeWindow(x11->display, x11->window,
-                                  x11->winrc.x0, x11->winrc.y0,
-                                  RC_W(x11->winrc), RC_H(x11->winrc));
-            }
+            update_geometry = true;
+            if (Event.xconfigure.window == (Window)vo->opts->WinID)
+                resize_parent = true;
             break;
         case KeyPress: {
             char buf[100];
@@ -883,6 +919,16 @@ int vo_x11_check_events(struct vo *vo)
             break;
         }
         case MotionNotify:
+            // Skip positions that are superseded by the next queued event.
+            if (!x11->win_drag_button1_down &&
+                XEventsQueued(display, QueuedAlready))
+            {
+                XEvent next;
+                XPeekEvent(display, &next);
+                if (next.type == MotionNotify &&
+                    next.xmotion.window == Event.xmotion.window)
+                    break;
+            }
             if (x11->win_drag_button1_down && !x11->fs &&
                 !mp_input_test_dragging(vo->input_ctx, Event.xmotion.x,
                                                        Event.xmotion.y))
@@ -926,7 +972,7 @@ int vo_x11_check_events(struct vo *vo)
                 vo_x11_clearwindow(vo, x11->window);
             x11->window_hidden = false;
             x11->pseudo_mapped = true;
-            vo_x11_update_geometry(vo);
+            update_geometry = true;
             break;
         case DestroyNotify:
             MP_WARN(x11, "Our window was destroyed, exiting\n");
@@ -956,13 +1002,22 @@ int vo_x11_check_events(struct vo *vo)
             }
             if (Event.type == x11->xrandr_event) {
                 xrandr_read(x11);
-                vo_x11_update_geometry(vo);
+                update_geometry = true;
             }
             break;
         }
     }
 
-    update_vo_size(vo);
+    if (update_geometry) {
+        vo_x11_update_geometry(vo);
+        if (resize_parent && x11->window) {
+            XMoveResizeWindow(x11->display, x11->window,
+                              x11->winrc.x0, x11->winrc.y0,
+                              RC_W(x11->winrc), RC_H(x11->winrc));
+        }
+    }
+
+    update_vo_size(vo, true);
     int ret = x11->pending_vo_events;
     x11->pending_vo_events = 0;
     return ret;
@@ -1289,7 +1344,7 @@ static void vo_x11_highlevel_resize(struct vo *vo, struct mp_rect rc)
     }
 
     vo_x11_update_geometry(vo);
-    update_vo_size(vo);
+    update_vo_size(vo, false);
 }
 
 static void wait_until_mapped(struct vo *vo)
@@ -1364,7 +1419,7 @@ void vo_x11_config_vo_window(struct vo *vo, XVisualInfo *vis, int flags,
 
     wait_until_mapped(vo);
     vo_x11_update_geometry(vo);
-    update_vo_size(vo);
+    update_vo_size(vo, false);
     x11->pending_vo_events &= ~VO_EVENT_RESIZE; // implicitly done by the VO
 }
 
@@ -33,6 +33,7 @@
 #include "fmt-conversion.h"
 #include "csputils.h"
 #include "common/msg.h"
+#include "misc/thread_pool.h"
 #include "video/filter/vf.h"
 
 //global sws_flags from the command line
@@ -83,6 +84,10 @@ const int mp_sws_hq_flags = SWS_LANCZOS | SWS_FULL_CHR_H_INT |
 // Fast, lossy.
 const int mp_sws_fast_flags = SWS_BILINEAR;
 
+// Don't split images into slices smaller than this. Also used as slice
+// alignment, so that subsampled chroma lines never straddle two slices.
+#define MIN_SLICE_LINES 16
+
 // Set ctx parameters to global command line flags.
 void mp_sws_set_from_cmdline(struct mp_sws_context *ctx, struct sws_opts *opts)
 {
@@ -122,14 +127,25 @@ static bool cache_valid(struct mp_sws_context *ctx)
     return mp_image_params_equal(&ctx->src, &old->src) &&
            mp_image_params_equal(&ctx->dst, &old->dst) &&
            ctx->flags == old->flags &&
+           ctx->threads == old->threads &&
            ctx->brightness == old->brightness &&
            ctx->contrast == old->contrast &&
            ctx->saturation == old->saturation;
 }
 
+static void free_slices(struct mp_sws_context *ctx)
+{
+    for (int n = 0; n < ctx->num_slices; n++)
+        sws_freeContext(ctx->slice_sws[n]);
+    talloc_free(ctx->slice_sws);
+    ctx->slice_sws = NULL;
+    ctx->num_slices = 0;
+}
+
 static void free_mp_sws(void *p)
 {
     struct mp_sws_context *ctx = p;
+    free_slices(ctx);
     sws_freeContext(ctx->sws);
     sws_freeFilter(ctx->src_filter);
     sws_freeFilter(ctx->dst_filter);
@@ -145,6 +161,7 @@ struct mp_sws_context *mp_sws_alloc(void *talloc_ctx)
         .flags = SWS_BILINEAR,
         .contrast = 1 << 16,    // 1.0 in 16.16 fixed point
         .saturation = 1 << 16,
+        .threads = 1,
         .force_reload = true,
         .params = {SWS_PARAM_DEFAULT, SWS_PARAM_DEFAULT},
         .cached = talloc_zero(ctx, struct mp_sws_context),
@@ -153,47 +170,21 @@ struct mp_sws_context *mp_sws_alloc(void *talloc_ctx)
     return ctx;
 }
 
-// Reinitialize (if needed) - return error code.
-// Optional, but possibly useful to avoid having to handle mp_sws_scale errors.
-int mp_sws_reinit(struct mp_sws_context *ctx)
+// Create a swscale context for ctx->src/ctx->dst, with the image heights
+// replaced by src_h/dst_h (used for slices).
+static struct SwsContext *create_sws(struct mp_sws_context *ctx,
+                                     int src_h, int dst_h)
 {
     struct mp_image_params *src = &ctx->src;
     struct mp_image_params *dst = &ctx->dst;
-
-    // Neutralize unsupported or ignored parameters.
-    src->d_w = dst->d_w = 0;
-    src->d_h = dst->d_h = 0;
-    src->outputlevels = dst->outputlevels = MP_CSP_LEVELS_AUTO;
-
-    if (cache_valid(ctx))
-        return 0;
-
-    sws_freeContext(ctx->sws);
-    ctx->sws = sws_alloc_context();
-    if (!ctx->sws)
-        return -1;
-
-    mp_image_params_guess_csp(src); // sanitize colorspace/colorlevels
-    mp_image_params_guess_csp(dst);
-
     struct mp_imgfmt_desc src_fmt = mp_imgfmt_get_desc(src->imgfmt);
     struct mp_imgfmt_desc dst_fmt = mp_imgfmt_get_desc(dst->imgfmt);
-    if (!src_fmt.id || !dst_fmt.id)
-        return -1;
-
     enum AVPixelFormat s_fmt = imgfmt2pixfmt(src->imgfmt);
-    if (s_fmt == AV_PIX_FMT_NONE || sws_isSupportedInput(s_fmt) < 1) {
-        MP_ERR(ctx, "Input image format %s not supported by libswscale.\n",
-               mp_imgfmt_to_name(src->imgfmt));
-        return -1;
-    }
-
     enum AVPixelFormat d_fmt = imgfmt2pixfmt(dst->imgfmt);
-    if (d_fmt == AV_PIX_FMT_NONE || sws_isSupportedOutput(d_fmt) < 1) {
-        MP_ERR(ctx, "Output image format %s not supported by libswscale.\n",
-               mp_imgfmt_to_name(dst->imgfmt));
-        return -1;
-    }
+
+    struct SwsContext *sws = sws_alloc_context();
+    if (!sws)
+        return NULL;
 
     int s_csp = mp_csp_to_sws_colorspace(src->colorspace);
     int s_range = src->colorlevels == MP_CSP_LEVELS_PC;
@@ -207,47 +198,155 @@ int mp_sws_reinit(struct mp_sws_context *ctx)
     s_range = s_range && (src_fmt.flags & MP_IMGFLAG_YUV);
     d_range = d_range && (dst_fmt.flags & MP_IMGFLAG_YUV);
 
-    av_opt_set_int(ctx->sws, "sws_flags", ctx->flags, 0);
+    av_opt_set_int(sws, "sws_flags", ctx->flags, 0);
 
-    av_opt_set_int(ctx->sws, "srcw", src->w, 0);
-    av_opt_set_int(ctx->sws, "srch", src->h, 0);
-    av_opt_set_int(ctx->sws, "src_format", s_fmt, 0);
+    av_opt_set_int(sws, "srcw", src->w, 0);
+    av_opt_set_int(sws, "srch", src_h, 0);
+    av_opt_set_int(sws, "src_format", s_fmt, 0);
 
-    av_opt_set_int(ctx->sws, "dstw", dst->w, 0);
-    av_opt_set_int(ctx->sws, "dsth", dst->h, 0);
-    av_opt_set_int(ctx->sws, "dst_format", d_fmt, 0);
+    av_opt_set_int(sws, "dstw", dst->w, 0);
+    av_opt_set_int(sws, "dsth", dst_h, 0);
+    av_opt_set_int(sws, "dst_format", d_fmt, 0);
 
-    av_opt_set_double(ctx->sws, "param0", ctx->params[0], 0);
-    av_opt_set_double(ctx->sws, "param1", ctx->params[1], 0);
+    av_opt_set_double(sws, "param0", ctx->params[0], 0);
+    av_opt_set_double(sws, "param1", ctx->params[1], 0);
 
 #if HAVE_AVCODEC_CHROMA_POS_API
     int cr_src = mp_chroma_location_to_av(src->chroma_location);
     int cr_dst = mp_chroma_location_to_av(dst->chroma_location);
     int cr_xpos, cr_ypos;
     if (avcodec_enum_to_chroma_pos(&cr_xpos, &cr_ypos, cr_src) >= 0) {
-        av_opt_set_int(ctx->sws, "src_h_chr_pos", cr_xpos, 0);
-        av_opt_set_int(ctx->sws, "src_v_chr_pos", cr_ypos, 0);
+        av_opt_set_int(sws, "src_h_chr_pos", cr_xpos, 0);
+        av_opt_set_int(sws, "src_v_chr_pos", cr_ypos, 0);
     }
     if (avcodec_enum_to_chroma_pos(&cr_xpos, &cr_ypos, cr_dst) >= 0) {
-        av_opt_set_int(ctx->sws, "dst_h_chr_pos", cr_xpos, 0);
-        av_opt_set_int(ctx->sws, "dst_v_chr_pos", cr_ypos, 0);
+        av_opt_set_int(sws, "dst_h_chr_pos", cr_xpos, 0);
+        av_opt_set_int(sws, "dst_v_chr_pos", cr_ypos, 0);
     }
 #endif
 
     // This can fail even with normal operation, e.g. if a conversion path
     // simply does not support these settings.
-    sws_setColorspaceDetails(ctx->sws, sws_getCoefficients(s_csp), s_range,
+    sws_setColorspaceDetails(sws, sws_getCoefficients(s_csp), s_range,
                              sws_getCoefficients(d_csp), d_range,
                              ctx->brightness, ctx->contrast, ctx->saturation);
 
-    if (sws_init_context(ctx->sws, ctx->src_filter, ctx->dst_filter) < 0)
+    if (sws_init_context(sws, ctx->src_filter, ctx->dst_filter) < 0) {
+        sws_freeContext(sws);
+        return NULL;
+    }
+
+    return sws;
+}
+
+// Set up per-slice contexts, so that mp_sws_scale() can convert horizontal
+// slices in parallel. Only done if there is no scaling, because swscale
+// would need context lines from neighbouring slices for vertical filtering.
+static void init_slices(struct mp_sws_context *ctx)
+{
+    struct mp_image_params *src = &ctx->src;
+    struct mp_image_params *dst = &ctx->dst;
+    if (ctx->threads == 1 || src->w != dst->w || src->h != dst->h)
+        return;
+
+    if (!ctx->thread_pool)
+        ctx->thread_pool = mp_thread_pool_create(ctx, ctx->threads);
+    int threads = mp_thread_pool_get_threads(ctx->thread_pool);
+    int slices = MPMIN(threads, src->h / MIN_SLICE_LINES);
+    if (slices <= 1)
+        return;
+
+    int slice_h = (src->h + slices - 1) / slices;
+    slice_h = MP_ALIGN_UP(slice_h, MIN_SLICE_LINES);
+    slices = (src->h + slice_h - 1) / slice_h;
+
+    ctx->slice_sws = talloc_zero_array(NULL, struct SwsContext *, slices);
+    ctx->slice_h = slice_h;
+    for (int n = 0; n < slices; n++) {
+        int h = MPMIN(slice_h, src->h - n * slice_h);
+        ctx->slice_sws[n] = create_sws(ctx, h, h);
+        ctx->num_slices = n + 1;
+        if (!ctx->slice_sws[n]) {
+            MP_VERBOSE(ctx, "Could not create slice contexts, not using "
+                       "threads.\n");
+            free_slices(ctx);
+            return;
+        }
+    }
+    MP_VERBOSE(ctx, "Converting in %d slices.\n", slices);
+}
+
+// Reinitialize (if needed) - return error code.
+// Optional, but possibly useful to avoid having to handle mp_sws_scale errors.
+int mp_sws_reinit(struct mp_sws_context *ctx)
+{
+    struct mp_image_params *src = &ctx->src;
+    struct mp_image_params *dst = &ctx->dst;
+
+    // Neutralize unsupported or ignored parameters.
+    src->d_w = dst->d_w = 0;
+    src->d_h = dst->d_h = 0;
+    src->outputlevels = dst->outputlevels = MP_CSP_LEVELS_AUTO;
+
+    if (cache_valid(ctx))
+        return 0;
+
+    free_slices(ctx);
+    sws_freeContext(ctx->sws);
+    ctx->sws = NULL;
+
+    mp_image_params_guess_csp(src); // sanitize colorspace/colorlevels
+    mp_image_params_guess_csp(dst);
+
+    struct mp_imgfmt_desc src_fmt = mp_imgfmt_get_desc(src->imgfmt);
+    struct mp_imgfmt_desc dst_fmt = mp_imgfmt_get_desc(dst->imgfmt);
+    if (!src_fmt.id || !dst_fmt.id)
+        return -1;
+
+    enum AVPixelFormat s_fmt = imgfmt2pixfmt(src->imgfmt);
+    if (s_fmt == AV_PIX_FMT_NONE || sws_isSupportedInput(s_fmt) < 1) {
+        MP_ERR(ctx, "Input image format %s not supported by libswscale.\n",
+               mp_imgfmt_to_name(src->imgfmt));
+        return -1;
+    }
+
+    enum AVPixelFormat d_fmt = imgfmt2pixfmt(dst->imgfmt);
+    if (d_fmt == AV_PIX_FMT_NONE || sws_isSupportedOutput(d_fmt) < 1) {
+        MP_ERR(ctx, "Output image format %s not supported by libswscale.\n",
+               mp_imgfmt_to_name(dst->imgfmt));
+        return -1;
+    }
+
+    ctx->sws = create_sws(ctx, src->h, dst->h);
+    if (!ctx->sws)
         return -1;
 
+    if (!(src_fmt.flags & MP_IMGFLAG_PAL) && !(dst_fmt.flags & MP_IMGFLAG_PAL))
+        init_slices(ctx);
+
     ctx->force_reload = false;
     *ctx->cached = *ctx;
     return 1;
 }
 
+struct slice_job {
+    struct mp_sws_context *ctx;
+    struct mp_image *dst, *src;
+};
+
+static void scale_slice(void *ptr, int n)
+{
+    struct slice_job *job = ptr;
+    struct mp_sws_context *ctx = job->ctx;
+    int y0 = n * ctx->slice_h;
+    int y1 = MPMIN(y0 + ctx->slice_h, job->src->h);
+    struct mp_image src = *job->src, dst = *job->dst;
+    mp_image_crop(&src, 0, y0, src.w, y1);
+    mp_image_crop(&dst, 0, y0, dst.w, y1);
+    sws_scale(ctx->slice_sws[n], (const uint8_t *const *) src.planes,
+              src.stride, 0, src.h, dst.planes, dst.stride);
+}
+
 // Scale from src to dst - if src/dst have different parameters from previous
 // calls, the context is reinitialized. Return error code. (It can fail if
 // reinitialization was necessary, and swscale returned an error.)
@@ -263,6 +362,13 @@ int mp_sws_scale(struct mp_sws_context *ctx, struct mp_image *dst,
         return r;
     }
 
+    if (ctx->num_slices > 1) {
+        struct slice_job job = {ctx, dst, src};
+        mp_thread_pool_run(ctx->thread_pool, ctx->num_slices, scale_slice,
+                           &job);
+        return 0;
+    }
+
     sws_scale(ctx->sws, (const uint8_t *const *) src->planes, src->stride,
               0, src->h, dst->planes, dst->stride);
     return 0;
@@ -32,6 +32,10 @@ struct mp_sws_context {
     // mp_sws_scale() will handle the changes transparently.
     int flags;
     int brightness, contrast, saturation;
+    // Number of threads used to convert horizontal slices of the image in
+    // parallel (1: no threading, 0: number of CPUs). Only used if the image
+    // size is not changed, i.e. for pure format conversion.
+    int threads;
     bool force_reload;
     // These are also implicitly set by mp_sws_scale(), and thus optional.
     // Setting them before that call makes sense when using mp_sws_reinit().
@@ -46,6 +50,11 @@ struct mp_sws_context {
     // Cached context (if any)
     struct SwsContext *sws;
 
+    // Per-slice contexts for threaded conversion (if any)
+    struct SwsContext **slice_sws;
+    int num_slices, slice_h;
+    struct mp_thread_pool *thread_pool;
+
     // Contains parameters for which sws is valid
     struct mp_sws_context *cached;
 };
@@ -405,7 +405,7 @@ static struct mp_image *try_download(struct mp_image *src,
         dst = pool ? mp_image_pool_get(pool, tmp.imgfmt, tmp.w, tmp.h)
                    : mp_image_alloc(tmp.imgfmt, tmp.w, tmp.h);
         if (dst)
-            mp_image_copy(dst, &tmp);
+            mp_image_copy_gpu(dst, &tmp);
         va_image_unmap(p->ctx, image);
     }
     return dst;
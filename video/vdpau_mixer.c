@@ -114,21 +114,87 @@ static int set_video_attribute(struct mp_vdpau_mixer *mixer,
 #define SET_VIDEO_ATTR(attr_name, attr_type, value) set_video_attribute(mixer, \
                  VDP_VIDEO_MIXER_ATTRIBUTE_ ## attr_name, &(attr_type){value},\
                  # attr_name)
+
+// Features that can be switched on and off on an existing mixer. (HQ scaling
+// is handled separately, as it needs a support check and rarely changes.)
+static int get_toggle_features(struct mp_vdpau_mixer_opts *opts,
+                               VdpVideoMixerFeature *features)
+{
+    int count = 0;
+    if (opts->deint >= 3)
+        features[count++] = VDP_VIDEO_MIXER_FEATURE_DEINTERLACE_TEMPORAL;
+    if (opts->deint == 4)
+        features[count++] = VDP_VIDEO_MIXER_FEATURE_DEINTERLACE_TEMPORAL_SPATIAL;
+    if (opts->pullup)
+        features[count++] = VDP_VIDEO_MIXER_FEATURE_INVERSE_TELECINE;
+    if (opts->denoise)
+        features[count++] = VDP_VIDEO_MIXER_FEATURE_NOISE_REDUCTION;
+    if (opts->sharpen)
+        features[count++] = VDP_VIDEO_MIXER_FEATURE_SHARPNESS;
+    return count;
+}
+
+static bool has_feature(struct mp_vdpau_mixer *mixer, VdpVideoMixerFeature f)
+{
+    for (int n = 0; n < mixer->num_features; n++) {
+        if (mixer->features[n] == f)
+            return true;
+    }
+    return false;
+}
+
+// Whether the current mixer can't be reused for the given parameters.
+static bool need_recreate(struct mp_vdpau_mixer *mixer,
+                          struct mp_vdpau_mixer_opts *opts,
+                          struct mp_image_params *params)
+{
+    if (mixer->video_mixer == VDP_INVALID_HANDLE)
+        return true;
+    if (params->w != mixer->mixer_w || params->h != mixer->mixer_h ||
+        mixer->chroma_type != mixer->mixer_chroma_type ||
+        opts->hqscaling != mixer->mixer_hqscaling)
+        return true;
+    VdpVideoMixerFeature features[MP_VDP_MAX_FEATURES];
+    int count = get_toggle_features(opts, features);
+    for (int n = 0; n < count; n++) {
+        if (!has_feature(mixer, features[n]))
+            return true;
+    }
+    return false;
+}
+
+// Create the mixer with all features that were ever requested, so that
+// switching them off and on again doesn't require recreating it.
 static int create_vdp_mixer(struct mp_vdpau_mixer *mixer)
 {
     struct vdp_functions *vdp = &mixer->ctx->vdp;
     VdpDevice vdp_device = mixer->ctx->vdp_device;
     struct mp_vdpau_mixer_opts *opts = &mixer->opts;
 #define VDP_NUM_MIXER_PARAMETER 3
-#define MAX_NUM_FEATURES 6
-    int i;
     VdpStatus vdp_st;
 
     MP_VERBOSE(mixer, "Recreating vdpau video mixer.\n");
 
+    if (mixer->video_mixer != VDP_INVALID_HANDLE) {
+        vdp_st = vdp->video_mixer_destroy(mixer->video_mixer);
+        CHECK_VDP_WARNING(mixer, "Error when calling vdp_video_mixer_destroy");
+    }
+    mixer->video_mixer = VDP_INVALID_HANDLE;
+
+    VdpVideoMixerFeature wanted[MP_VDP_MAX_FEATURES];
+    int num_wanted = get_toggle_features(opts, wanted);
+    VdpVideoMixerFeature features[MP_VDP_MAX_FEATURES];
     int feature_count = 0;
-    VdpVideoMixerFeature features[MAX_NUM_FEATURES];
-    VdpBool feature_enables[MAX_NUM_FEATURES];
+    for (int n = 0; n < mixer->num_features; n++) {
+        if (mixer->features[n] < VDP_VIDEO_MIXER_FEATURE_HIGH_QUALITY_SCALING_L1)
+            features[feature_count++] = mixer->features[n];
+    }
+    for (int n = 0; n < num_wanted; n++) {
+        if (!has_feature(mixer, wanted[n]))
+            features[feature_count++] = wanted[n];
+    }
+    mixer->num_features = 0;
+
     static const VdpVideoMixerParameter parameters[VDP_NUM_MIXER_PARAMETER] = {
         VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_WIDTH,
         VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_HEIGHT,
@@ -139,17 +205,6 @@ static int create_vdp_mixer(struct mp_vdpau_mixer *mixer)
         &(uint32_t){mixer->image_params.h},
         &(VdpChromaType){mixer->chroma_type},
     };
-    if (opts->deint >= 3)
-        features[feature_count++] = VDP_VIDEO_MIXER_FEATURE_DEINTERLACE_TEMPORAL;
-    if (opts->deint == 4)
-        features[feature_count++] =
-            VDP_VIDEO_MIXER_FEATURE_DEINTERLACE_TEMPORAL_SPATIAL;
-    if (opts->pullup)
-        features[feature_count++] = VDP_VIDEO_MIXER_FEATURE_INVERSE_TELECINE;
-    if (opts->denoise)
-        features[feature_count++] = VDP_VIDEO_MIXER_FEATURE_NOISE_REDUCTION;
-    if (opts->sharpen)
-        features[feature_count++] = VDP_VIDEO_MIXER_FEATURE_SHARPNESS;
     if (opts->hqscaling) {
         VdpVideoMixerFeature hqscaling_feature =
             VDP_VIDEO_MIXER_FEATURE_HIGH_QUALITY_SCALING_L1 + opts->hqscaling - 1;
@@ -175,13 +230,37 @@ static int create_vdp_mixer(struct mp_vdpau_mixer *mixer)
 
     CHECK_VDP_ERROR(mixer, "Error when calling vdp_video_mixer_create");
 
-    mixer->initialized = true;
+    for (int n = 0; n < feature_count; n++)
+        mixer->features[n] = features[n];
+    mixer->num_features = feature_count;
+    mixer->mixer_w = mixer->image_params.w;
+    mixer->mixer_h = mixer->image_params.h;
+    mixer->mixer_chroma_type = mixer->chroma_type;
+    mixer->mixer_hqscaling = opts->hqscaling;
+    return 0;
+}
 
-    for (i = 0; i < feature_count; i++)
-        feature_enables[i] = VDP_TRUE;
-    if (feature_count) {
+// Apply mixer->opts, the image colorspace and the equalizer to the mixer.
+static int update_vdp_mixer(struct mp_vdpau_mixer *mixer)
+{
+    struct vdp_functions *vdp = &mixer->ctx->vdp;
+    struct mp_vdpau_mixer_opts *opts = &mixer->opts;
+    VdpStatus vdp_st;
+
+    VdpVideoMixerFeature wanted[MP_VDP_MAX_FEATURES];
+    int num_wanted = get_toggle_features(opts, wanted);
+    VdpBool feature_enables[MP_VDP_MAX_FEATURES];
+    for (int n = 0; n < mixer->num_features; n++) {
+        VdpVideoMixerFeature f = mixer->features[n];
+        bool enable = f >= VDP_VIDEO_MIXER_FEATURE_HIGH_QUALITY_SCALING_L1;
+        for (int i = 0; i < num_wanted; i++)
+            enable |= wanted[i] == f;
+        feature_enables[n] = enable ? VDP_TRUE : VDP_FALSE;
+    }
+    if (mixer->num_features) {
         vdp_st = vdp->video_mixer_set_feature_enables(mixer->video_mixer,
-                                                      feature_count, features,
+                                                      mixer->num_features,
+                                                      mixer->features,
                                                       feature_enables);
         CHECK_VDP_WARNING(mixer, "Error calling vdp_video_mixer_set_feature_enables");
     }
@@ -189,8 +268,7 @@ static int create_vdp_mixer(struct mp_vdpau_mixer *mixer)
         SET_VIDEO_ATTR(NOISE_REDUCTION_LEVEL, float, opts->denoise);
     if (opts->sharpen)
         SET_VIDEO_ATTR(SHARPNESS_LEVEL, float, opts->sharpen);
-    if (!opts->chroma_deint)
-        SET_VIDEO_ATTR(SKIP_CHROMA_DEINTERLACE, uint8_t, 1);
+    SET_VIDEO_ATTR(SKIP_CHROMA_DEINTERLACE, uint8_t, !opts->chroma_deint);
 
     // VdpCSCMatrix happens to be compatible with mpv's CSC matrix type
     // both are float[3][4]
@@ -206,6 +284,7 @@ static int create_vdp_mixer(struct mp_vdpau_mixer *mixer)
     set_video_attribute(mixer, VDP_VIDEO_MIXER_ATTRIBUTE_CSC_MATRIX,
                         &matrix, "CSC matrix");
 
+    mixer->initialized = true;
     return 0;
 }
 
@@ -233,21 +312,22 @@ int mp_vdpau_mixer_render(struct mp_vdpau_mixer *mixer,
     if (!opts)
         opts = &frame->opts;
 
-    if (mixer->video_mixer == VDP_INVALID_HANDLE)
+    if (mixer->video_mixer == VDP_INVALID_HANDLE) {
         mixer->initialized = false;
+        // All state of the old mixer is gone (e.g. display preemption).
+        mixer->num_features = 0;
+    }
 
     if (!mixer->initialized || !opts_equal(opts, &mixer->opts) ||
         !mp_image_params_equal(&video->params, &mixer->image_params))
     {
+        bool recreate = need_recreate(mixer, opts, &video->params);
         mixer->opts = *opts;
         mixer->image_params = video->params;
-        if (mixer->video_mixer != VDP_INVALID_HANDLE) {
-            vdp_st = vdp->video_mixer_destroy(mixer->video_mixer);
-            CHECK_VDP_WARNING(mixer, "Error when calling vdp_video_mixer_destroy");
-        }
-        mixer->video_mixer = VDP_INVALID_HANDLE;
         mixer->initialized = false;
-        if (create_vdp_mixer(mixer) < 0)
+        if (recreate && create_vdp_mixer(mixer) < 0)
+            return -1;
+        if (update_vdp_mixer(mixer) < 0)
             return -1;
     }
 
@@ -17,6 +17,9 @@ struct mp_vdpau_mixer_opts {
 
 #define MP_VDP_HISTORY_FRAMES 2
 
+// Max. number of mixer features used at once
+#define MP_VDP_MAX_FEATURES 6
+
 struct mp_vdpau_mixer_frame {
     // settings
     struct mp_vdpau_mixer_opts opts;
@@ -36,10 +39,17 @@ struct mp_vdpau_mixer {
     struct mp_vdpau_mixer_opts opts;
     VdpChromaType chroma_type;
 
-    // set initialized=false to force reinit when changed
+    // set initialized=false to force the settings to be reapplied when changed
     struct mp_csp_equalizer video_eq;
 
     VdpVideoMixer video_mixer;
+
+    // Parameters the current video_mixer was created with
+    VdpVideoMixerFeature features[MP_VDP_MAX_FEATURES];
+    int num_features;
+    int mixer_w, mixer_h;
+    VdpChromaType mixer_chroma_type;
+    int mixer_hqscaling;
 };
 
 struct mp_image *mp_vdpau_mixed_frame_create(struct mp_image *base);
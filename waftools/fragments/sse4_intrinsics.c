@@ -0,0 +1,8 @@
+#include <smmintrin.h>
+__attribute__((target("sse4.1")))
+static __m128i load(void *p) { return _mm_stream_load_si128(p); }
+int main(void) {
+    __m128i x[1] = {0};
+    (void)load(x);
+    return !__builtin_cpu_supports("sse4.1");
+}
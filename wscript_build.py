@@ -93,6 +93,7 @@ def build(ctx):
         ## Audio
         ( "audio/audio.c" ),
         ( "audio/audio_buffer.c" ),
+        ( "audio/audio_export.c" ),
         ( "audio/chmap.c" ),
         ( "audio/chmap_sel.c" ),
         ( "audio/fmt-conversion.c" ),
@@ -164,6 +165,8 @@ def build(ctx):
         ( "common/tags.c" ),
         ( "common/msg.c" ),
         ( "common/playlist.c" ),
+        ( "common/stats.c" ),
+        ( "common/mem_budget.c" ),
         ( "common/version.c" ),
 
         ## Demuxers
@@ -189,6 +192,7 @@ def build(ctx):
         ( "input/cmd_parse.c" ),
         ( "input/event.c" ),
         ( "input/input.c" ),
+        ( "input/ipc.c",                         "!mingw" ),
         ( "input/keycodes.c" ),
         ( "input/pipe-unix.c",                   "!mingw" ),
         ( "input/pipe-win32.c",                  "waio" ),
@@ -201,6 +205,7 @@ def build(ctx):
         ( "misc/dispatch.c" ),
         ( "misc/ring.c" ),
         ( "misc/rendezvous.c" ),
+        ( "misc/thread_pool.c" ),
 
         ## Options
         ( "options/m_config.c" ),
@@ -217,6 +222,7 @@ def build(ctx):
         ( "player/command.c" ),
         ( "player/configfiles.c" ),
         ( "player/discnav.c" ),
+        ( "player/frame_cb.c" ),
         ( "player/loadfile.c" ),
         ( "player/main.c" ),
         ( "player/misc.c" ),
@@ -263,6 +269,7 @@ def build(ctx):
         ( "stream/tv.c",                         "tv" ),
         ( "stream/tvi_dummy.c",                  "tv" ),
         ( "stream/tvi_v4l2.c",                   "tv-v4l2"),
+        ( "stream/resolve/resolve.c" ),
         ( "stream/resolve/resolve_quvi.c",       "libquvi4" ),
         ( "stream/resolve/resolve_quvi9.c",      "libquvi9" ),
 
@@ -286,6 +293,7 @@ def build(ctx):
         ## Video
         ( "video/csputils.c" ),
         ( "video/fmt-conversion.c" ),
+        ( "video/gpu_memcpy.c" ),
         ( "video/image_writer.c" ),
         ( "video/img_format.c" ),
         ( "video/mp_image.c" ),
@@ -360,6 +368,7 @@ def build(ctx):
         ( "video/out/vo_lavc.c",                 "encoding" ),
         ( "video/out/vo_null.c" ),
         ( "video/out/vo_opengl.c",               "gl" ),
+        ( "video/out/vo_opengl_cb.c",            "gl" ),
         ( "video/out/vo_opengl_old.c",           "gl" ),
         ( "video/out/vo_sdl.c",                  "sdl2" ),
         ( "video/out/vo_vaapi.c",                "vaapi" ),
@@ -448,6 +457,18 @@ def build(ctx):
             **cprog_kwargs
         )
 
+    if ctx.dependency_satisfied('microbench'):
+        ctx(
+            target       = "mpv-microbench",
+            source       = ctx.filtered_sources(sources) + \
+                           ["TOOLS/microbench/microbench.c"],
+            use          = ctx.dependencies_use(),
+            includes     = [ctx.bldnode.abspath(), ctx.srcnode.abspath()] + \
+                           ctx.dependencies_includes(),
+            features     = "c cprogram",
+            install_path = None,
+        )
+
     build_shared = ctx.dependency_satisfied('libmpv-shared')
     build_static = ctx.dependency_satisfied('libmpv-static')
     if build_shared or build_static:
@@ -500,7 +521,7 @@ def build(ctx):
             PRIV_LIBS    = get_deps(),
         )
 
-        headers = ["client.h"]
+        headers = ["client.h", "opengl_cb.h", "frame_cb.h", "audio_export.h"]
         for f in headers:
             ctx.install_as(ctx.env.INCDIR + '/mpv/' + f, 'libmpv/' + f)
 